@@ -195,6 +195,10 @@ namespace libsurvive
 				   EntryPoint = "survive_simple_object_get_latest_pose")]
 		public static extern double survive_simple_object_get_latest_pose(SurviveSimpleObjectPtr aso, IntPtr pose);
 
+		[DllImport("libsurvive", CallingConvention = CallingConvention.Cdecl,
+				   EntryPoint = "survive_simple_object_predict_pose")]
+		public static extern bool survive_simple_object_predict_pose(SurviveSimpleObjectPtr aso, double time, IntPtr pose);
+
 		[DllImport("libsurvive", CallingConvention = CallingConvention.Cdecl,
 				   EntryPoint = "survive_simple_next_event")]
 		public static extern UInt32 survive_simple_next_event(SurviveSimpleObjectPtr aso, IntPtr evt);
@@ -1653,6 +1653,8 @@ struct_SurviveSensorActivations_s.__slots__ = [
     'timecode',
     'lengths',
     'hits',
+    'readings',
+    'lighthouses',
     'imu_init_cnt',
     'last_imu',
     'last_light',
@@ -1677,6 +1679,8 @@ struct_SurviveSensorActivations_s._fields_ = [
     ('timecode', ((survive_long_timecode * int(2)) * int(16)) * int(32)),
     ('lengths', ((survive_timecode * int(2)) * int(2)) * int(32)),
     ('hits', ((survive_long_timecode * int(2)) * int(16)) * int(32)),
+    ('readings', (c_uint32 * int(2)) * int(16)),
+    ('lighthouses', c_uint32),
     ('imu_init_cnt', c_size_t),
     ('last_imu', survive_long_timecode),
     ('last_light', survive_long_timecode),
@@ -3451,6 +3455,57 @@ if _libs["survive"].has("survive_simple_wait_for_event", "cdecl"):
     survive_simple_wait_for_event.argtypes = [POINTER(SurviveSimpleContext), POINTER(SurviveSimpleEvent)]
     survive_simple_wait_for_event.restype = enum_SurviveSimpleEventType
 
+class struct_SurviveSimpleSubscription(Structure):
+    pass
+
+SurviveSimpleSubscription = struct_SurviveSimpleSubscription# /home/justin/source/oss/libsurvive/include/libsurvive/survive_api.h: 186
+
+class struct_SurviveSimpleSubscriptionParams(Structure):
+    pass
+
+struct_SurviveSimpleSubscriptionParams.__slots__ = [
+    'capacity',
+    'event_types',
+    'object',
+]
+struct_SurviveSimpleSubscriptionParams._fields_ = [
+    ('capacity', c_size_t),
+    ('event_types', c_uint32),
+    ('object', POINTER(SurviveSimpleObject)),
+]
+
+SurviveSimpleSubscriptionParams = struct_SurviveSimpleSubscriptionParams# /home/justin/source/oss/libsurvive/include/libsurvive/survive_api.h: 197
+
+# /home/justin/source/oss/libsurvive/include/libsurvive/survive_api.h: 209
+if _libs["survive"].has("survive_simple_subscribe", "cdecl"):
+    survive_simple_subscribe = _libs["survive"].get("survive_simple_subscribe", "cdecl")
+    survive_simple_subscribe.argtypes = [POINTER(SurviveSimpleContext), POINTER(SurviveSimpleSubscriptionParams)]
+    survive_simple_subscribe.restype = POINTER(SurviveSimpleSubscription)
+
+# /home/justin/source/oss/libsurvive/include/libsurvive/survive_api.h: 214
+if _libs["survive"].has("survive_simple_unsubscribe", "cdecl"):
+    survive_simple_unsubscribe = _libs["survive"].get("survive_simple_unsubscribe", "cdecl")
+    survive_simple_unsubscribe.argtypes = [POINTER(SurviveSimpleSubscription)]
+    survive_simple_unsubscribe.restype = None
+
+# /home/justin/source/oss/libsurvive/include/libsurvive/survive_api.h: 220
+if _libs["survive"].has("survive_simple_subscription_next_event", "cdecl"):
+    survive_simple_subscription_next_event = _libs["survive"].get("survive_simple_subscription_next_event", "cdecl")
+    survive_simple_subscription_next_event.argtypes = [POINTER(SurviveSimpleSubscription), POINTER(SurviveSimpleEvent)]
+    survive_simple_subscription_next_event.restype = enum_SurviveSimpleEventType
+
+# /home/justin/source/oss/libsurvive/include/libsurvive/survive_api.h: 227
+if _libs["survive"].has("survive_simple_subscription_wait_for_event", "cdecl"):
+    survive_simple_subscription_wait_for_event = _libs["survive"].get("survive_simple_subscription_wait_for_event", "cdecl")
+    survive_simple_subscription_wait_for_event.argtypes = [POINTER(SurviveSimpleSubscription), POINTER(SurviveSimpleEvent), c_double]
+    survive_simple_subscription_wait_for_event.restype = enum_SurviveSimpleEventType
+
+# /home/justin/source/oss/libsurvive/include/libsurvive/survive_api.h: 233
+if _libs["survive"].has("survive_simple_subscription_dropped", "cdecl"):
+    survive_simple_subscription_dropped = _libs["survive"].get("survive_simple_subscription_dropped", "cdecl")
+    survive_simple_subscription_dropped.argtypes = [POINTER(SurviveSimpleSubscription)]
+    survive_simple_subscription_dropped.restype = c_uint32
+
 # /home/justin/source/oss/libsurvive/include/libsurvive/survive_api.h: 174
 if _libs["survive"].has("survive_simple_object_haptic", "cdecl"):
     survive_simple_object_haptic = _libs["survive"].get("survive_simple_object_haptic", "cdecl")
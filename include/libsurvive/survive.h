@@ -42,6 +42,13 @@ typedef struct SurviveSensorActivations_s {
 
 	survive_long_timecode hits[SENSORS_PER_OBJECT][NUM_GEN2_LIGHTHOUSES][2];
 
+	// Bit 'sensor' of readings[lh][axis] is set once that sensor has an accepted angle from lh on that axis, and bit
+	// 'lh' of lighthouses once any sensor does. Most of the table above is never written; scans over it should walk
+	// these masks rather than every sensor / lighthouse / axis. This only saves time: the dense tables stay as they
+	// are, since posers and bindings index them directly, and the masks add 132 bytes on top.
+	uint32_t readings[NUM_GEN2_LIGHTHOUSES][2];
+	uint32_t lighthouses;
+
 	size_t imu_init_cnt;
 	survive_long_timecode last_imu;
 	survive_long_timecode last_light;
@@ -188,6 +195,11 @@ struct SurviveObject {
 	survive_timecode last_sync_time[NUM_GEN2_LIGHTHOUSES];
 	survive_timecode sync_count[NUM_GEN2_LIGHTHOUSES];
 
+	// Gen2 angles held back for the sweep_angle_batch hook, usually until the next sync; see
+	// sweep_angle_batch_process_func
+	SurviveSweepAngle pending_angles[SURVIVE_SWEEP_ANGLE_BATCH_MAX];
+	size_t pending_angle_cnt;
+
 	FLT imu_freq;
 
 	// These are from the vive config files. They are named 'trackref_from_head' and 'trackref_from_imu'
@@ -239,6 +251,12 @@ struct SurviveObject {
 	// Plugins / posers / etc can add to this entry list via `survive_object_plugin_data`
 	SurvivePluginPair *PluginDataEntries;
 	size_t PluginDataEntries_cnt, PluginDataEntries_space;
+
+	// og_mutex_t; see survive_get_so_lock
+	void *pipeline_lock;
+	// Set when another object's ingest needs this object's activations cleared in sharded mode; the reset happens the
+	// next time this object's ingest lock is taken
+	uint32_t activations_reset_pending;
 };
 
 // These exports are mostly for language binding against
@@ -249,6 +267,13 @@ SURVIVE_EXPORT int8_t survive_object_charge(SurviveObject *so);
 SURVIVE_EXPORT bool survive_object_charging(SurviveObject *so);
 
 SURVIVE_EXPORT const SurvivePose *survive_object_pose(SurviveObject *so);
+/**
+ * Predicts the pose at 'runtime' (seconds, same clock as survive_run_time) from the latest tracker state. Takes no
+ * locks, so it is safe to call from a render thread at any rate.
+ *
+ * @return false if the object has no tracker or the tracker hasn't reported a pose yet
+ */
+SURVIVE_EXPORT bool survive_object_predict_pose(const SurviveObject *so, double runtime, SurvivePose *pose);
 
 SURVIVE_EXPORT int8_t survive_object_sensor_ct(SurviveObject *so);
 SURVIVE_EXPORT const FLT *survive_object_sensor_locations(SurviveObject *so);
@@ -466,6 +491,37 @@ SURVIVE_EXPORT void survive_close(SurviveContext *ctx);
 SURVIVE_EXPORT void survive_get_ctx_lock(SurviveContext *ctx);
 SURVIVE_EXPORT void survive_release_ctx_lock(SurviveContext *ctx);
 
+// When 'sharded-pipeline' is enabled, each object's pipeline state (activations, tracker, poser data) is guarded by
+// its own lock and shared lighthouse state (bsd, lighthouse trackers) by the lighthouse lock. Lock order is
+// ctx -> object -> lighthouse. When sharding is off these are no-ops and the context lock covers everything.
+SURVIVE_EXPORT bool survive_is_sharded(const SurviveContext *ctx);
+SURVIVE_EXPORT void survive_get_so_lock(SurviveObject *so);
+SURVIVE_EXPORT void survive_release_so_lock(SurviveObject *so);
+SURVIVE_EXPORT void survive_get_lh_lock(SurviveContext *ctx);
+SURVIVE_EXPORT void survive_release_lh_lock(SurviveContext *ctx);
+
+// The lock a driver holds while it hands one object's data to the hooks. In sharded mode this is just the object lock,
+// so objects are ingested in parallel; the lighthouse lock is taken inside only around reads and writes of lighthouse
+// state, and the kalman tracker updates against a copy of the lighthouses taken that way. With no object, or when
+// sharding is off, it is the context lock.
+//
+// Hooks therefore run under:
+//   - lightcap(s), light, light_pulse, angle, sync, sweep, sweep_angle(_batch), raw_imu, imu, imupose, pose, velocity,
+//     external_pose and external_velocity: the ingest lock for their object
+//   - button: the context lock, on the button thread
+//   - the rest (config, new_object, ootx_received, lighthouse poses, log, ...): the context lock, or whatever ingest
+//     lock is held when the ingest path above triggers them
+//   - posers: the poser lock
+// In sharded mode a hook which touches state shared between objects has to guard it with its own lock; taking the
+// context lock from inside the object lock would invert the lock order.
+SURVIVE_EXPORT void survive_get_ingest_lock(SurviveContext *ctx, SurviveObject *so);
+SURVIVE_EXPORT void survive_release_ingest_lock(SurviveContext *ctx, SurviveObject *so);
+
+// The lock a poser runs under; the object lock in sharded mode and the context lock otherwise. Posers which want to
+// run long computations unlocked should release / reacquire this.
+SURVIVE_EXPORT void survive_get_poser_lock(SurviveObject *so);
+SURVIVE_EXPORT void survive_release_poser_lock(SurviveObject *so);
+
 SURVIVE_EXPORT const char *survive_build_tag();
 
 SURVIVE_EXPORT SurviveObject *survive_get_so_by_name(SurviveContext *ctx, const char *name);
@@ -525,33 +581,48 @@ SURVIVE_EXPORT void survive_detach_config(SurviveContext *ctx, const char *tag,
 
 SURVIVE_EXPORT int8_t survive_get_bsd_idx(SurviveContext *ctx, survive_channel channel);
 
-#define SURVIVE_INVOKE_HOOK(hook, ctx, ...)                                                                            \
+/**
+ * Hook calls are counted, but only one in SURVIVE_HOOK_TIMING_SAMPLE of them is timed; the timing stats are scaled
+ * back up to estimate the rest. Define it as 1 to time every call, or as 0 to leave timing out altogether.
+ */
+#ifndef SURVIVE_HOOK_TIMING_SAMPLE
+#define SURVIVE_HOOK_TIMING_SAMPLE 16
+#endif
+
+#if SURVIVE_HOOK_TIMING_SAMPLE > 0
+#define SURVIVE_TIMED_HOOK_CALL(ctx, hook, call)                                                                       \
 	{                                                                                                                  \
-		if (ctx && ctx->hook##proc) {                                                                                         \
-			FLT start_time = OGRelativeTime();                                                                         \
-			ctx->hook##proc(ctx, __VA_ARGS__);                                                                         \
-			FLT this_time = OGRelativeTime() - start_time;                                                             \
-			if (this_time > ctx->hook##_max_call_time)                                                                 \
-				ctx->hook##_max_call_time = this_time;                                                                 \
+		bool hook_timed = (ctx)->hook##_call_cnt++ % SURVIVE_HOOK_TIMING_SAMPLE == 0;                                  \
+		FLT hook_start_time = hook_timed ? OGRelativeTime() : 0;                                                       \
+		call;                                                                                                          \
+		if (hook_timed) {                                                                                              \
+			FLT this_time = OGRelativeTime() - hook_start_time;                                                        \
+			if (this_time > (ctx)->hook##_max_call_time)                                                               \
+				(ctx)->hook##_max_call_time = this_time;                                                               \
 			if (this_time > .001)                                                                                      \
-				ctx->hook##_call_over_cnt++;                                                                           \
-			ctx->hook##_call_time += this_time;                                                                        \
-			ctx->hook##_call_cnt++;                                                                                    \
+				(ctx)->hook##_call_over_cnt += SURVIVE_HOOK_TIMING_SAMPLE;                                             \
+			(ctx)->hook##_call_time += this_time * SURVIVE_HOOK_TIMING_SAMPLE;                                         \
+		}                                                                                                              \
+	}
+#else
+#define SURVIVE_TIMED_HOOK_CALL(ctx, hook, call)                                                                       \
+	{                                                                                                                  \
+		(ctx)->hook##_call_cnt++;                                                                                      \
+		call;                                                                                                          \
+	}
+#endif
+
+#define SURVIVE_INVOKE_HOOK(hook, ctx, ...)                                                                            \
+	{                                                                                                                  \
+		if (ctx && ctx->hook##proc) {                                                                                  \
+			SURVIVE_TIMED_HOOK_CALL(ctx, hook, ctx->hook##proc(ctx, __VA_ARGS__));                                     \
 		}                                                                                                              \
 	}
 
 #define SURVIVE_INVOKE_HOOK_SO(hook, so, ...)                                                                          \
 	{                                                                                                                  \
 		if (so->ctx->hook##proc) {                                                                                     \
-			FLT start_time = OGRelativeTime();                                                                         \
-			so->ctx->hook##proc(so, ##__VA_ARGS__);                                                                    \
-			FLT this_time = OGRelativeTime() - start_time;                                                             \
-			if (this_time > so->ctx->hook##_max_call_time)                                                             \
-				so->ctx->hook##_max_call_time = this_time;                                                             \
-			if (this_time > .001)                                                                                      \
-				so->ctx->hook##_call_over_cnt++;                                                                       \
-			so->ctx->hook##_call_time += this_time;                                                                    \
-			so->ctx->hook##_call_cnt++;                                                                                \
+			SURVIVE_TIMED_HOOK_CALL(so->ctx, hook, so->ctx->hook##proc(so, ##__VA_ARGS__));                            \
 		}                                                                                                              \
 	}
 
@@ -616,6 +687,8 @@ SURVIVE_EXPORT void survive_default_disconnect_process(struct SurviveObject *so)
 SURVIVE_EXPORT int survive_default_printf_process(struct SurviveContext *ctx, const char *format, ...);
 SURVIVE_EXPORT void survive_default_log_process(struct SurviveContext *ctx, SurviveLogLevel ll, const char *fault);
 SURVIVE_EXPORT void survive_default_lightcap_process(SurviveObject *so, const LightcapElement *element);
+SURVIVE_EXPORT void survive_default_lightcaps_process(SurviveObject *so, const LightcapElement *les, size_t cnt,
+													 uint8_t *decisions);
 SURVIVE_EXPORT void survive_default_light_process(SurviveObject *so, int sensor_id, int acode, int timeinsweep,
 												  survive_timecode timecode, survive_timecode length, uint32_t lh);
 SURVIVE_EXPORT void survive_default_raw_imu_process(SurviveObject *so, int mode, const FLT *accelgyro,
@@ -634,6 +707,8 @@ SURVIVE_EXPORT void survive_default_sweep_process(SurviveObject *so, survive_cha
 												  survive_timecode timecode, bool flag);
 SURVIVE_EXPORT void survive_default_sweep_angle_process(SurviveObject *so, survive_channel channel, int sensor_id,
 														survive_timecode timecode, int8_t plane, FLT angle);
+SURVIVE_EXPORT void survive_default_sweep_angle_batch_process(SurviveObject *so, const SurviveSweepAngle *angles,
+															  size_t cnt);
 SURVIVE_EXPORT void survive_default_button_process(SurviveObject *so, enum SurviveInputEvent eventType,
 												   enum SurviveButton buttonId, const enum SurviveAxis *axisIds,
 												   const SurviveAxisVal_t *axisVals);
@@ -703,6 +778,10 @@ SURVIVE_EXPORT const SurvivePose *survive_get_lighthouse_position(const SurviveC
 // This is the disambiguator function, for taking light timing and figuring out place-in-sweep for a given photodiode.
 SURVIVE_EXPORT uint8_t survive_map_sensor_id(SurviveObject *so, uint8_t reported_id);
 SURVIVE_EXPORT bool handle_lightcap(SurviveObject *so, const LightcapElement *le);
+// Same as calling handle_lightcap on each element in turn, but hands them on to the disambiguator as one batch
+SURVIVE_EXPORT bool handle_lightcaps(SurviveObject *so, const LightcapElement *les, size_t cnt);
+// Hands the gen2 angles held back since the object's last sync to the sweep_angle_batch hook now
+SURVIVE_EXPORT void survive_flush_sweep_angles(SurviveObject *so);
 
 SURVIVE_EXPORT BaseStationCal *survive_basestation_cal(SurviveContext *ctx, int lh, int axis);
 SURVIVE_EXPORT const char *survive_colorize(const char *str);
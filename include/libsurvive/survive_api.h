@@ -120,6 +120,14 @@ SURVIVE_EXPORT const SurviveSimpleObject *survive_simple_get_next_updated(Surviv
  */
 SURVIVE_EXPORT FLT survive_simple_object_get_latest_pose(const SurviveSimpleObject *sao, SurvivePose *pose);
 
+/**
+ * Predicts the pose of a given object at 'time', on the survive_simple_run_time clock; e.g. when the next frame will
+ * be displayed. Unlike survive_simple_object_get_latest_pose this never blocks on the tracking threads. Objects
+ * without a tracker give their latest pose.
+ * @return false if there is no pose for the object yet
+ */
+SURVIVE_EXPORT bool survive_simple_object_predict_pose(const SurviveSimpleObject *sao, FLT time, SurvivePose *pose);
+
 SURVIVE_EXPORT void survive_simple_object_get_transform_to_imu(const SurviveSimpleObject *sao, SurvivePose *pose);
 
 /**
@@ -160,6 +168,9 @@ SURVIVE_EXPORT const char *survive_simple_json_config(const SurviveSimpleObject
 SURVIVE_EXPORT bool survive_simple_wait_for_update(SurviveSimpleContext *actx);
 /**
  * Gets the next system event if there is one. Can return an event with NONE type.
+ *
+ * Events other than pose updates wait in a queue of 64; when it is full, new events are dropped. Consumers which can
+ * fall behind, or more than one consumer, should use survive_simple_subscribe instead.
  */
 SURVIVE_EXPORT enum SurviveSimpleEventType survive_simple_next_event(SurviveSimpleContext *actx,
 																	 SurviveSimpleEvent *event);
@@ -171,6 +182,55 @@ SURVIVE_EXPORT enum SurviveSimpleEventType survive_simple_next_event(SurviveSimp
 SURVIVE_EXPORT enum SurviveSimpleEventType survive_simple_wait_for_event(SurviveSimpleContext *actx,
 																		 SurviveSimpleEvent *event);
 
+struct SurviveSimpleSubscription;
+typedef struct SurviveSimpleSubscription SurviveSimpleSubscription;
+
+#define SURVIVE_SIMPLE_EVENT_MASK(event_type) (1u << (event_type))
+
+typedef struct SurviveSimpleSubscriptionParams {
+	// Events held before new ones are dropped; rounded up to a power of two. 0 picks 64.
+	size_t capacity;
+	// OR of SURVIVE_SIMPLE_EVENT_MASK(type) for each type wanted; 0 for all of them
+	uint32_t event_types;
+	// Only events about this object, plus those like Shutdown which aren't about any; 0 for every object
+	const SurviveSimpleObject *object;
+} SurviveSimpleSubscriptionParams;
+
+/**
+ * Opens a queue of events for one consumer. Every subscription sees each event it asks for, independent of the others
+ * and of survive_simple_next_event, so separate threads can each drain their own at their own rate. Unlike
+ * survive_simple_next_event, pose updates are delivered as events, one for each pose the object reports.
+ *
+ * Reading from a subscription never takes a lock; only one thread should read from a given subscription. When a
+ * subscription is full, new events for it are dropped and counted; see survive_simple_subscription_dropped.
+ *
+ * @param params 0 for every event, with the default capacity
+ */
+SURVIVE_EXPORT SurviveSimpleSubscription *survive_simple_subscribe(SurviveSimpleContext *actx,
+																   const SurviveSimpleSubscriptionParams *params);
+/**
+ * Closes and frees the subscription. Subscriptions still open are freed by survive_simple_close.
+ */
+SURVIVE_EXPORT void survive_simple_unsubscribe(SurviveSimpleSubscription *sub);
+
+/**
+ * Gets the next event for the subscription if there is one; otherwise the type is None, or Shutdown once the
+ * background thread has stopped.
+ */
+SURVIVE_EXPORT enum SurviveSimpleEventType survive_simple_subscription_next_event(SurviveSimpleSubscription *sub,
+																				  SurviveSimpleEvent *event);
+/**
+ * Like survive_simple_subscription_next_event, but first waits up to timeout_s seconds for an event to arrive. A
+ * negative timeout waits until there is an event or the background thread stops.
+ */
+SURVIVE_EXPORT enum SurviveSimpleEventType
+survive_simple_subscription_wait_for_event(SurviveSimpleSubscription *sub, SurviveSimpleEvent *event, FLT timeout_s);
+
+/**
+ * @return The number of events dropped so far because the subscription was full
+ */
+SURVIVE_EXPORT uint32_t survive_simple_subscription_dropped(const SurviveSimpleSubscription *sub);
+
 SURVIVE_EXPORT int survive_simple_object_haptic(struct SurviveSimpleObject *sao, FLT frequency, FLT amplitude,
 												FLT time_s);
 SURVIVE_EXPORT enum SurviveSimpleObject_type survive_simple_object_get_type(const struct SurviveSimpleObject *sao);
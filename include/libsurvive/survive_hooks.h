@@ -19,6 +19,7 @@ SURVIVE_HOOK_PROCESS_DEF(ootx_received)
 
 // Gen 1 hooks
 SURVIVE_HOOK_PROCESS_DEF(lightcap)
+SURVIVE_HOOK_PROCESS_DEF(lightcaps)
 SURVIVE_HOOK_PROCESS_DEF(light)
 SURVIVE_HOOK_PROCESS_DEF(light_pulse)
 SURVIVE_HOOK_PROCESS_DEF(angle)
@@ -27,6 +28,7 @@ SURVIVE_HOOK_PROCESS_DEF(angle)
 SURVIVE_HOOK_PROCESS_DEF(sync)
 SURVIVE_HOOK_PROCESS_DEF(sweep)
 SURVIVE_HOOK_PROCESS_DEF(sweep_angle)
+SURVIVE_HOOK_PROCESS_DEF(sweep_angle_batch)
 
 SURVIVE_HOOK_PROCESS_DEF(raw_imu)
 SURVIVE_HOOK_PROCESS_DEF(imu)
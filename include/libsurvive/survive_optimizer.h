@@ -108,6 +108,8 @@ typedef struct survive_optimizer_settings {
 	FLT optimize_scale_threshold;
 	FLT current_pos_bias;
 	FLT current_rot_bias;
+	int threads;
+	bool sparse;
 } survive_optimizer_settings;
 
 struct mp_par_struct;
@@ -155,6 +157,10 @@ typedef struct survive_optimizer {
 
 	void *user;
 	void (*iteration_cb)(struct survive_optimizer *opt_ctx, int m, int n, FLT *p, FLT *deviates, FLT **derivs);
+
+	// Only set on the per thread copies used for threaded evaluation; error terms are stored per measurement index
+	// instead of being summed into stats so the totals can be added up in the same order as the serial path.
+	FLT *stats_terms;
 } survive_optimizer;
 
 #define SURVIVE_OPTIMIZER_SETUP_BUFFERS(ctx, alloc_fn, ...)                                                            \
@@ -252,6 +258,13 @@ SURVIVE_EXPORT void survive_optimizer_covariance_expand(survive_optimizer *optim
 SURVIVE_EXPORT void survive_optimizer_set_reproject_model(survive_optimizer *optimizer,
 														  const survive_reproject_model_t *reprojectModel);
 
+/**
+ * Evaluates the deviates and, if derivs is non-null, the jacobian of the problem at p. This is what mpfit calls each
+ * iteration; settings->threads > 1 spreads the measurement blocks over the context's optimizer thread pool. The output
+ * is bit identical regardless of thread count.
+ */
+SURVIVE_EXPORT void survive_optimizer_evaluate(survive_optimizer *optimizer, FLT *p, FLT *deviates, FLT **derivs);
+
 SURVIVE_EXPORT void survive_optimizer_serialize(const survive_optimizer *optimizer, const char *fn);
 
 SURVIVE_EXPORT survive_optimizer *survive_optimizer_load(const char *fn);
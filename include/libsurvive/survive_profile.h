@@ -0,0 +1,54 @@
+#pragma once
+
+#include "survive.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Per stage timing for the processing pipeline. Off by default; enable with '--profile-stages'. When enabled every
+ * timed call lands in a log scale histogram (8 buckets per octave, ~9% resolution) so percentiles can be read back
+ * without keeping every sample. Stage timings are inclusive; the reporting stage runs inside the kalman updates, and
+ * the poser stage inside the light processing when posers aren't threaded.
+ */
+typedef enum survive_profile_stage {
+	survive_profile_stage_disambiguation,	  // gen1 disambiguator and gen2 sweep plane determination
+	survive_profile_stage_sensor_activations, // SurviveSensorActivations bookkeeping
+	survive_profile_stage_poser,			  // Poser invocations, including threaded posers
+	survive_profile_stage_kalman_light,
+	survive_profile_stage_kalman_imu,
+	survive_profile_stage_report, // Kalman tracker pose / velocity reporting
+	survive_profile_stage_count
+} survive_profile_stage;
+
+typedef struct survive_profile_stage_stats {
+	uint64_t count;
+	double total_s, max_s;
+	double p50_s, p99_s;
+} survive_profile_stage_stats;
+
+SURVIVE_EXPORT const char *survive_profile_stage_name(survive_profile_stage stage);
+SURVIVE_EXPORT bool survive_profile_enabled(const SurviveContext *ctx);
+
+/**
+ * Returns a timestamp to pass to survive_profile_end, or 0 if profiling is off.
+ */
+SURVIVE_EXPORT double survive_profile_start(const SurviveContext *ctx);
+SURVIVE_EXPORT void survive_profile_end(SurviveContext *ctx, survive_profile_stage stage, double start);
+SURVIVE_EXPORT void survive_profile_record(SurviveContext *ctx, survive_profile_stage stage, double seconds);
+
+SURVIVE_EXPORT void survive_profile_get_stats(const SurviveContext *ctx, survive_profile_stage stage,
+											  survive_profile_stage_stats *stats);
+SURVIVE_EXPORT void survive_profile_reset(SurviveContext *ctx);
+
+#define SURVIVE_PROFILE_STAGE(ctx, stage, ...)                                                                         \
+	{                                                                                                                  \
+		double _profile_start = survive_profile_start(ctx);                                                            \
+		__VA_ARGS__;                                                                                                   \
+		survive_profile_end(ctx, survive_profile_stage_##stage, _profile_start);                                       \
+	}
+
+#ifdef __cplusplus
+};
+#endif
@@ -60,6 +60,14 @@ typedef FLT (*survive_reproject_axisangle_full_xy_fn_t)(const LinmathAxisAnglePo
 														const LinmathAxisAnglePose *world2lh,
 														const BaseStationCal *bcal);
 
+/**
+ * Batch reprojection of n points in the lighthouse frame against one calibration. Points are passed as separate x, y
+ * and z arrays, and everything which only depends on the calibration is worked out once per call rather than once per
+ * point. Either of out_x / out_y may be null to skip that axis. Results match reprojectXY to within rounding.
+ */
+typedef void (*survive_reproject_xy_batch_fn_t)(const BaseStationCal *bcal, size_t n, const FLT *x, const FLT *y,
+												const FLT *z, FLT *out_x, FLT *out_y);
+
 typedef struct survive_reproject_model_t {
 	survive_reproject_xy_fn_t reprojectXY;
 	survive_reproject_axis_fn_t reprojectAxisFn[2];
@@ -80,6 +88,8 @@ typedef struct survive_reproject_model_t {
 
 	survive_reproject_axis_jacob_sensor_pt_fn_t reprojectAxisJacobSensorPt[2];
 	survive_reproject_axisangle_axis_jacob_sensor_pt_fn_t reprojectAxisAngleAxisJacobSensorPt[2];
+
+	survive_reproject_xy_batch_fn_t reprojectXYBatch;
 } survive_reproject_model_t;
 
 SURVIVE_EXPORT const survive_reproject_model_t* survive_reproject_model(SurviveContext* ctx);
@@ -89,6 +99,22 @@ SURVIVE_EXPORT FLT survive_reproject_axis_x(const BaseStationCal *bcal, LinmathV
 SURVIVE_EXPORT FLT survive_reproject_axis_y(const BaseStationCal *bcal, LinmathVec3d const ptInLh);
 
 SURVIVE_EXPORT void survive_reproject_xy(const BaseStationCal *bcal, LinmathVec3d const ptInLh, SurviveAngleReading out);
+SURVIVE_EXPORT void survive_reproject_xy_batch(const BaseStationCal *bcal, size_t n, const FLT *x, const FLT *y,
+											   const FLT *z, FLT *out_x, FLT *out_y);
+
+/**
+ * Applies pose to n points given as separate x, y and z arrays; uses SSE2 / AVX2 when built for them. The output may
+ * alias the input.
+ */
+SURVIVE_EXPORT void survive_reproject_transform_points(const SurvivePose *pose, size_t n, const FLT *x, const FLT *y,
+													   const FLT *z, FLT *out_x, FLT *out_y, FLT *out_z);
+/**
+ * Batch version of survive_reproject_full for n object points; see survive_reproject_xy_batch_fn_t.
+ */
+SURVIVE_EXPORT void survive_reproject_full_xy_batch(const survive_reproject_model_t *model, const BaseStationCal *bcal,
+													const SurvivePose *world2lh, const SurvivePose *obj2world,
+													size_t n, const FLT *x, const FLT *y, const FLT *z, FLT *out_x,
+													FLT *out_y);
 SURVIVE_EXPORT void survive_reproject_from_pose(const SurviveContext *ctx, int lighthouse, const SurvivePose *world2lh,
 								 LinmathVec3d const ptInWorld, SurviveAngleReading out);
 
@@ -25,6 +25,8 @@ SURVIVE_EXPORT FLT survive_reproject_axis_y_gen2(const BaseStationCal *bcal, Lin
 
 SURVIVE_EXPORT void survive_reproject_xy_gen2(const BaseStationCal *bcal, LinmathVec3d const ptInLh,
 											  SurviveAngleReading out);
+SURVIVE_EXPORT void survive_reproject_xy_batch_gen2(const BaseStationCal *bcal, size_t n, const FLT *x, const FLT *y,
+													const FLT *z, FLT *out_x, FLT *out_y);
 SURVIVE_EXPORT void survive_reproject_from_pose_gen2(const SurviveContext *ctx, int lighthouse,
 													 const SurvivePose *world2lh, LinmathVec3d const ptInWorld,
 													 SurviveAngleReading out);
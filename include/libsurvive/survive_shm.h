@@ -0,0 +1,130 @@
+#pragma once
+
+/**
+ * Layout of the shared memory region a libsurvive process publishes tracking state into when run with
+ * '--shm-publish <name>', and a reader for it.
+ *
+ * The reader is part of libsurvive, but survive_shm_reader.c only needs the C runtime, so a process on the same host
+ * can also build it in and follow every tracked object without linking the tracking stack or claiming the devices;
+ * see tools/shm_reader. The region is mapped read only; readers never write to it and the publisher never waits on
+ * them.
+ *
+ * Each object has its own slot, guarded by a seqlock: the publisher makes 'seq' odd while it updates the slot and even
+ * again when it's done. survive_shm_read_object copies a slot and retries if 'seq' was odd or changed during the copy.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef SURVIVE_SHM_EXPORT
+#ifdef _WIN32
+#define SURVIVE_SHM_EXPORT __declspec(dllexport)
+#else
+#define SURVIVE_SHM_EXPORT __attribute__((visibility("default")))
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SURVIVE_SHM_MAGIC 0x4d485356u
+// Bumped whenever the layout below changes
+#define SURVIVE_SHM_VERSION 1
+#define SURVIVE_SHM_MAX_OBJECTS 32
+#define SURVIVE_SHM_AXIS_COUNT 16
+#define SURVIVE_SHM_DEFAULT_NAME "libsurvive"
+
+enum SurviveShmObjectFlags {
+	SURVIVE_SHM_OBJECT_HAS_POSE = 1,
+	SURVIVE_SHM_OBJECT_HAS_VELOCITY = 2,
+	// Only the position block of 'covariance' is filled in
+	SURVIVE_SHM_OBJECT_HAS_POSITION_COVARIANCE = 4,
+	// All of 'covariance' is filled in
+	SURVIVE_SHM_OBJECT_HAS_POSE_COVARIANCE = 8,
+};
+
+/**
+ * State of one object. Everything is stored as double regardless of how libsurvive was built.
+ */
+typedef struct SurviveShmObject {
+	uint32_t seq;
+	// SurviveShmObjectFlags
+	uint32_t flags;
+	char codename[16];
+	char serial_number[32];
+
+	// survive_run_time, in seconds, of the latest update to this slot
+	double runtime;
+	// Incremented on every update to this slot
+	uint64_t update_cnt;
+
+	uint64_t pose_timecode;
+	// Position xyz, then rotation quaternion wxyz
+	double pose[7];
+	uint64_t velocity_timecode;
+	// Linear velocity, then angular velocity as axis angle
+	double velocity[6];
+	// Row major covariance of the position and the axis angle rotation error, as of the latest pose
+	double covariance[36];
+
+	uint32_t buttonmask;
+	uint32_t touchmask;
+	double axis[SURVIVE_SHM_AXIS_COUNT];
+} SurviveShmObject;
+
+typedef struct SurviveShmHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t object_size;
+	uint32_t max_objects;
+	// Slots in use. Slots are handed out in order and never reused while the publisher runs
+	uint32_t object_cnt;
+	// Incremented every time a publisher opens the region, so readers can tell a restart from a quiet object
+	uint32_t generation;
+	// Non zero while the publisher is running
+	uint32_t alive;
+	SurviveShmObject objects[SURVIVE_SHM_MAX_OBJECTS];
+} SurviveShmHeader;
+
+/**
+ * Name of the OS object backing a region; shm_open wants a leading slash, Windows a session namespace.
+ */
+SURVIVE_SHM_EXPORT void survive_shm_os_name(char *out, size_t len, const char *name);
+
+typedef struct SurviveShmReader {
+	const SurviveShmHeader *header;
+#ifdef _WIN32
+	// HANDLE of the file mapping
+	void *mapping;
+#endif
+} SurviveShmReader;
+
+/**
+ * Maps the region published under name. Fails if no publisher has created it, or if it was written by a libsurvive
+ * with a different layout.
+ */
+SURVIVE_SHM_EXPORT bool survive_shm_reader_open(SurviveShmReader *reader, const char *name);
+SURVIVE_SHM_EXPORT void survive_shm_reader_close(SurviveShmReader *reader);
+
+SURVIVE_SHM_EXPORT uint32_t survive_shm_object_count(const SurviveShmReader *reader);
+
+/**
+ * Takes a consistent copy of slot idx.
+ *
+ * @return false if idx isn't in use
+ */
+SURVIVE_SHM_EXPORT bool survive_shm_read_object(const SurviveShmReader *reader, uint32_t idx, SurviveShmObject *out);
+
+/**
+ * @return The slot of the object with the given codename, or -1
+ */
+SURVIVE_SHM_EXPORT int survive_shm_find_object(const SurviveShmReader *reader, const char *codename);
+
+SURVIVE_SHM_EXPORT bool survive_shm_publisher_alive(const SurviveShmReader *reader);
+
+#ifdef __cplusplus
+};
+#endif
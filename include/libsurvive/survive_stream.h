@@ -0,0 +1,114 @@
+#pragma once
+
+/**
+ * Wire format of the binary stream served by the streamserver driver ('--streamserver').
+ *
+ * Every message, in either direction, is a SurviveStreamHeader followed by the payload for its type; 'size' covers
+ * both. All fields are little endian and naturally aligned, so on the platforms libsurvive runs on a message can be
+ * read straight into these structs. Clients should skip message types they don't know by their size.
+ *
+ * A new client gets every object, pose, velocity and button message. Sending a SurviveStreamSubscribe replaces that
+ * filter; the server answers every subscribe and every stats request with a SURVIVE_STREAM_STATS message.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SURVIVE_STREAM_DEFAULT_PORT 7755
+// Objects a server tracks; later objects aren't streamed
+#define SURVIVE_STREAM_MAX_OBJECTS 64
+
+enum SurviveStreamMessageType {
+	// Server to client
+	SURVIVE_STREAM_OBJECT = 1,
+	SURVIVE_STREAM_POSE = 2,
+	SURVIVE_STREAM_VELOCITY = 3,
+	SURVIVE_STREAM_BUTTON = 4,
+	SURVIVE_STREAM_STATS = 5,
+
+	// Client to server
+	SURVIVE_STREAM_SUBSCRIBE = 16,
+	SURVIVE_STREAM_STATS_REQUEST = 17,
+};
+
+#define SURVIVE_STREAM_MASK(type) (1u << (type))
+
+typedef struct SurviveStreamHeader {
+	uint16_t size;
+	// SurviveStreamMessageType
+	uint8_t type;
+	uint8_t reserved;
+	// Object index, as announced by a SURVIVE_STREAM_OBJECT message
+	uint32_t object;
+	// survive_run_time when the message was produced, in seconds
+	double time;
+	// Device timecode the data is for, if it has one
+	uint64_t timecode;
+} SurviveStreamHeader;
+
+/**
+ * Sent once per object, before any other message about it. Ignores the subscription's type mask.
+ */
+typedef struct SurviveStreamObject {
+	SurviveStreamHeader hdr;
+	char codename[16];
+	char serial_number[32];
+} SurviveStreamObject;
+
+typedef struct SurviveStreamPose {
+	SurviveStreamHeader hdr;
+	// Position xyz, then rotation quaternion wxyz
+	double pose[7];
+} SurviveStreamPose;
+
+typedef struct SurviveStreamVelocity {
+	SurviveStreamHeader hdr;
+	// Linear velocity, then angular velocity as axis angle
+	double velocity[6];
+} SurviveStreamVelocity;
+
+typedef struct SurviveStreamButton {
+	SurviveStreamHeader hdr;
+	// SurviveInputEvent and SurviveButton of the event
+	uint8_t event_type;
+	uint8_t button_id;
+	uint16_t reserved;
+	// Object's input state after the event
+	uint32_t buttonmask;
+	uint32_t touchmask;
+	uint32_t reserved2;
+	double axis[16];
+} SurviveStreamButton;
+
+/**
+ * Counters for one client's connection
+ */
+typedef struct SurviveStreamStats {
+	SurviveStreamHeader hdr;
+	uint64_t sent_messages;
+	uint64_t sent_bytes;
+	// Messages which didn't fit in the client's buffer because it didn't read fast enough
+	uint64_t dropped_messages;
+	// Messages skipped by the subscription's min_period
+	uint64_t decimated_messages;
+	uint32_t queued_bytes;
+	uint32_t max_queued_bytes;
+} SurviveStreamStats;
+
+typedef struct SurviveStreamSubscribe {
+	SurviveStreamHeader hdr;
+	// SURVIVE_STREAM_MASK of the message types wanted
+	uint32_t type_mask;
+	uint32_t reserved;
+	// Per object and type, messages closer than this to the last one sent are skipped; 0 sends everything
+	double min_period;
+	// Comma separated codenames to stream; empty streams every object
+	char objects[64];
+} SurviveStreamSubscribe;
+
+#ifdef __cplusplus
+};
+#endif
@@ -150,6 +150,7 @@ typedef struct survive_kalman_error_model_t {
 #define NUM_GEN2_LIGHTHOUSES 16
 
 #define INTBUFFSIZE 64
+// Sets of sensors are kept as uint32_t masks (see SurviveSensorActivations); this can't grow past 32 without those
 #define SENSORS_PER_OBJECT	32
 
 // These are used for the eventType of button_process_func
@@ -279,6 +280,25 @@ typedef void (*gen_detected_process_func)(SurviveObject *so, int gen);
  */
 typedef void (*lightcap_process_func)(SurviveObject *so, const LightcapElement *le);
 
+/**
+ * What the disambiguator did with each element handed to it through the lightcaps hook.
+ */
+typedef enum SurviveLightcapDecision {
+	SURVIVE_LIGHTCAP_DROPPED = 0, // Not used; e.g. while starting up, after losing track or from an invalid sensor
+	SURVIVE_LIGHTCAP_SEARCHING,	  // Fed to the search for where in the sweep cycle the lighthouses are
+	SURVIVE_LIGHTCAP_SYNC,		  // Matched the acode of the current sync window
+	SURVIVE_LIGHTCAP_SYNC_MISS,	  // Arrived in a sync window but didn't match its acode
+	SURVIVE_LIGHTCAP_SWEEP,		  // Kept as its sensor's hit for the current sweep, unless a longer one comes along
+	SURVIVE_LIGHTCAP_FORWARDED,	  // Handed to the lightcap hook one at a time; what became of it isn't known
+} SurviveLightcapDecision;
+
+/**
+ * Batched form of lightcap; 'les' are in time order for a single object, typically one USB or radio packet's worth.
+ * If 'decisions' isn't null, it gets a SurviveLightcapDecision per element.
+ */
+typedef void (*lightcaps_process_func)(SurviveObject *so, const LightcapElement *les, size_t cnt,
+									   uint8_t *decisions);
+
 /**
  * This is called on disambiguated data in a v1 system; so it contains the lighthouse index of the data as well as
  * the time in sweep of the event.
@@ -317,6 +337,30 @@ typedef void (*sweep_process_func)(SurviveObject *so, survive_channel channel, i
 typedef void (*sweep_angle_process_func)(SurviveObject *so, survive_channel channel, int sensor_id,
 										 survive_timecode timecode, int8_t plane, FLT angle);
 
+#define SURVIVE_SWEEP_ANGLE_BATCH_MAX 64
+
+/**
+ * One gen2 angle, as it would be passed to sweep_angle.
+ */
+typedef struct SurviveSweepAngle {
+	survive_timecode timecode;
+	// survive_run_time when the angle came in; a batch is handed on later than that
+	double run_time;
+	FLT angle;
+	survive_channel channel;
+	uint8_t sensor_id;
+	int8_t plane;
+} SurviveSweepAngle;
+
+/**
+ * The gen2 angles an object saw between two of its syncs, in the order they came in. This is invoked as the next sync
+ * reaches the default sync processing, or sooner: once the object's tracker would integrate the light it has saved
+ * (light-batch-size), once SURVIVE_SWEEP_ANGLE_BATCH_MAX angles are waiting, when the object loses sync, and when it
+ * is removed or the context closes. The default hands them to the sweep_angle hook one at a time if a non default one
+ * is installed.
+ */
+typedef void (*sweep_angle_batch_process_func)(SurviveObject *so, const SurviveSweepAngle *angles, size_t cnt);
+
 /**
  * Raw accelerometer data straight from the device; with no scaling or bias applied. accelgyro is a vector of length
  * 6 in [acc_x, acc_y, acc_z, gyro_x, gyro_y, gyro_z ]
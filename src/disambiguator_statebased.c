@@ -1,5 +1,6 @@
 //
 #include "survive_internal.h"
+#include "survive_profile.h"
 #include <assert.h>
 #include <math.h> /* for sqrt */
 #include <stdint.h>
@@ -123,17 +124,20 @@ const LighthouseStateParameters LS_Params[LS_END + 1] = {
 
 static inline int LSParam_acode(enum LighthouseState s) { return LS_Params[s].acode; }
 
-static int LSParam_offset_for_state(enum LighthouseState s) {
-	static int offsets[LS_END + 1] = {-1};
-	if (offsets[0] == -1) {
-		int offset = 0;
-		for (int i = 0; i < LS_END + 1; i++) {
-			offsets[i] = offset;
-			offset += LS_Params[i].window;
-		}
-	}
-	return offsets[s];
-}
+// Running sum of the windows in LS_Params; this gets looked up for every element so it's spelled out here
+#define LS_STEP (2 * PULSE_WINDOW + CAPTURE_WINDOW)
+// clang-format off
+static const int LS_Offsets[LS_END + 1] = {
+	0,
+	0 * LS_STEP, 0 * LS_STEP + PULSE_WINDOW, 0 * LS_STEP + 2 * PULSE_WINDOW,
+	1 * LS_STEP, 1 * LS_STEP + PULSE_WINDOW, 1 * LS_STEP + 2 * PULSE_WINDOW,
+	2 * LS_STEP, 2 * LS_STEP + PULSE_WINDOW, 2 * LS_STEP + 2 * PULSE_WINDOW,
+	3 * LS_STEP, 3 * LS_STEP + PULSE_WINDOW, 3 * LS_STEP + 2 * PULSE_WINDOW,
+	4 * LS_STEP
+};
+// clang-format on
+
+static inline int LSParam_offset_for_state(enum LighthouseState s) { return LS_Offsets[s]; }
 
 static enum LighthouseState LighthouseState_findByOffset(int offset, int *error) {
 	for (int i = 2; i < LS_END + 1; i++) {
@@ -192,6 +196,9 @@ typedef struct {
 
 		uint32_t confidence_resets;
 		uint32_t sync_time_error;
+
+		uint32_t batches;
+		uint32_t batched_elements;
 	} stats;
 
 	/**  This part of the structure is general use when we know our state */
@@ -208,6 +215,8 @@ typedef struct {
 
 #define SYNC_HISTORY_LEN 12
 	LightcapElement sync_history[SYNC_HISTORY_LEN];
+	// How far each sync_history entry is from each of the acode_timing lengths, as in LightcapFeatures
+	uint16_t sync_history_error[SYNC_HISTORY_LEN][4];
 	int sync_offset;
 
 	LightcapElement sweep_data[];
@@ -280,14 +289,34 @@ LightcapElement get_last_sync(Disambiguator_data_t *d) {
 	return lastSync;
 }
 
-enum LightcapClassification { LCC_SWEEP, LCC_SYNC };
-static enum LightcapClassification naive_classify(Disambiguator_data_t *d, const LightcapElement *le) {
-	bool clearlyNotSync = le->length < LOWER_SYNC_TIME || le->length > UPPER_SYNC_TIME;
+// Only acodes 0, 1, 4 and 5 are ever expected; the data bit is whatever the lighthouse is sending for OOTX
+#define ACODE_SLOT(acode) (((acode)&1) | (((acode) >> 1) & 2))
+static const int acode_timing[4][2] = {{ACODE_TIMING(0), ACODE_TIMING(0 | 2)},
+									   {ACODE_TIMING(1), ACODE_TIMING(1 | 2)},
+									   {ACODE_TIMING(4), ACODE_TIMING(4 | 2)},
+									   {ACODE_TIMING(5), ACODE_TIMING(5 | 2)}};
 
-	if (clearlyNotSync) {
-		return LCC_SWEEP;
-	} else {
-		return LCC_SYNC;
+/**
+ * Everything about an element that doesn't depend on the state machine. Worked out for a whole batch of elements in
+ * one branch free pass before any of them go through it.
+ */
+typedef struct {
+	uint16_t acode_error[4];
+	bool is_sync;
+} LightcapFeatures;
+
+static void classify_lightcaps(const LightcapElement *les, size_t cnt, LightcapFeatures *features) {
+	for (size_t i = 0; i < cnt; i++) {
+		int length = les[i].length;
+		bool clearlyNotSync = length < LOWER_SYNC_TIME || length > UPPER_SYNC_TIME;
+		features[i].is_sync = !clearlyNotSync;
+
+		// Calculate what it would be with and without data, and take the least of the two errors
+		for (int slot = 0; slot < 4; slot++) {
+			int time_error_d0 = abs(acode_timing[slot][0] - length);
+			int time_error_d1 = abs(acode_timing[slot][1] - length);
+			features[i].acode_error[slot] = time_error_d0 > time_error_d1 ? time_error_d1 : time_error_d0;
+		}
 	}
 }
 
@@ -307,6 +336,9 @@ static enum LighthouseState EndSweep(Disambiguator_data_t *d, const LightcapElem
 
 static void AddSyncHistory(Disambiguator_data_t *d, LightcapElement sync) {
 	if (sync.length) {
+		LightcapFeatures features;
+		classify_lightcaps(&sync, 1, &features);
+		memcpy(d->sync_history_error[d->sync_offset], features.acode_error, sizeof(features.acode_error));
 		d->sync_history[d->sync_offset++] = sync;
 		if (d->sync_offset >= SYNC_HISTORY_LEN)
 			d->sync_offset = 0;
@@ -327,15 +359,6 @@ static Disambiguator_data_t *get_best_latest_state(Global_Disambiguator_data_t *
 	return best_d;
 }
 
-static uint32_t calculate_error(int target_acode, const LightcapElement *le) {
-	// Calculate what it would be with and without data
-	uint32_t time_error_d0 = abs(ACODE_TIMING(target_acode) - le->length);
-	uint32_t time_error_d1 = abs(ACODE_TIMING(target_acode | DATA_BIT) - le->length);
-
-	// Take the least of the two erors
-	return (time_error_d0) > (time_error_d1) ? time_error_d1 : time_error_d0;
-}
-
 #define DEBUG_LOCK DEBUG_TB
 static uint32_t apply_mod_offset(uint32_t timestamp, uint32_t mod_offset, enum LighthouseState end_state) {
 	int mod_group = LSParam_offset_for_state(end_state);
@@ -356,6 +379,10 @@ static uint32_t apply_mod_offset(uint32_t timestamp, uint32_t mod_offset, enum L
 	return rtn;
 }
 
+/**
+ * Counts the sync history entries that line up with guess_mod. A lock needs every one of them to, so this stops at the
+ * first one that doesn't.
+ */
 static int find_inliers(Disambiguator_data_t *d, uint32_t guess_mod, bool test60hz) {
 	int inliers = 0;
 	SurviveContext *ctx = d->so->ctx;
@@ -370,7 +397,7 @@ static int find_inliers(Disambiguator_data_t *d, uint32_t guess_mod, bool test60
 
 		int best_acode = find_acode(le->length) & ~2;
 		int acode = LSParam_acode(this_state);
-		uint32_t error = calculate_error(acode, le);
+		uint32_t error = d->sync_history_error[i][ACODE_SLOT(acode)];
 
 		int last_idx = i == 0 ? (SYNC_HISTORY_LEN - 1) : i - 1;
 		int32_t time_diff = (le->timestamp - d->sync_history[last_idx].timestamp);
@@ -380,14 +407,15 @@ static int find_inliers(Disambiguator_data_t *d, uint32_t guess_mod, bool test60
 				   ACODE_TIMING(acode), ACODE_TIMING(acode | DATA_BIT), error, offset_error);
 
 		if (LS_Params[this_state].is_sweep)
-			continue;
+			break;
 
 		if (LS_Params[this_state].lh && test60hz)
-			continue;
+			break;
 
-		if (error < 500 && offset_error < 500) {
-			inliers++;
-		}
+		if (error >= 500 || offset_error >= 500)
+			break;
+
+		inliers++;
 	}
 	return inliers;
 }
@@ -395,6 +423,11 @@ static int find_inliers(Disambiguator_data_t *d, uint32_t guess_mod, bool test60
 static enum LighthouseState find_relative_offset(Disambiguator_data_t *d, uint32_t *mod, bool *single_60hz) {
 	SurviveContext *ctx = d->so->ctx;
 	Global_Disambiguator_data_t *g = d->so->ctx->disambiguator_data;
+
+	// The history fills from the front, and nothing can lock until all of it lines up
+	if (d->sync_history[SYNC_HISTORY_LEN - 1].length == 0)
+		return LS_UNKNOWN;
+
 	Disambiguator_data_t *best_d = get_best_latest_state(g);
 
 	int ri = (d->sync_offset + (SYNC_HISTORY_LEN - 1)) % SYNC_HISTORY_LEN;
@@ -469,7 +502,8 @@ static void ResetSync(Disambiguator_data_t *d) {
 	d->last_sync_timestamp = d->last_sync_length = d->last_sync_count = 0;
 }
 
-static enum LighthouseState AttemptFindState(Disambiguator_data_t *d, const LightcapElement *le) {
+static enum LighthouseState AttemptFindState(Disambiguator_data_t *d, const LightcapElement *le,
+											 const LightcapFeatures *features) {
 	/*
 	enum LighthouseState best_guess = get_best_latest_state(d->so->ctx->disambiguator_data);
 	if(best_guess != LS_UNKNOWN) {
@@ -480,9 +514,7 @@ static enum LighthouseState AttemptFindState(Disambiguator_data_t *d, const Ligh
 	}
 */
 
-	enum LightcapClassification classification = naive_classify(d, le);
-
-	if (classification == LCC_SYNC) {
+	if (features->is_sync) {
 		LightcapElement lastSync = get_last_sync(d);
 
 		// Handle the case that this is a new SYNC coming in
@@ -550,16 +582,16 @@ static enum LighthouseState SetState(Disambiguator_data_t *d, const LightcapElem
 	return new_state;
 }
 
-static void PropagateState(Disambiguator_data_t *d, const LightcapElement *le);
-static void RunACodeCapture(int target_acode, Disambiguator_data_t *d, const LightcapElement *le) {
+static SurviveLightcapDecision RunACodeCapture(int target_acode, Disambiguator_data_t *d, const LightcapElement *le,
+											  const LightcapFeatures *features) {
 	// Just ignore small signals; this has a measurable impact on signal quality
 	if (le->length < 400)
-		return;
+		return SURVIVE_LIGHTCAP_DROPPED;
 
 	// We know what state we are in, so we verify that state as opposed to
 	// trying to suss out the acode.
 
-	uint32_t error = calculate_error(target_acode, le);
+	uint32_t error = features->acode_error[ACODE_SLOT(target_acode)];
 	SurviveContext *ctx = d->so->ctx;
 	Global_Disambiguator_data_t *g = ctx->disambiguator_data;
 
@@ -583,7 +615,7 @@ static void RunACodeCapture(int target_acode, Disambiguator_data_t *d, const Lig
 		d->stats.sync_time_error++;
 		DEBUG_TB("Disambiguator missed %s; %d expected %d but got %d(%d) - %u %d", survive_colorize(d->so->codename),
 				 error, target_acode, le->length, d->confidence, d->mod_offset[0], le->timestamp);
-		return;
+		return SURVIVE_LIGHTCAP_SYNC_MISS;
 	}
 
 	if (d->confidence < 50) {
@@ -597,6 +629,7 @@ static void RunACodeCapture(int target_acode, Disambiguator_data_t *d, const Lig
 	// If its a real timestep, integrate it here and we can take the average later
 
 	RegisterSync(d, le);
+	return SURVIVE_LIGHTCAP_SYNC;
 }
 
 static void ProcessStateChange(Disambiguator_data_t *d, const LightcapElement *le, enum LighthouseState new_state) {
@@ -715,11 +748,12 @@ static inline uint32_t offset_from_state(Disambiguator_data_t *d, const Lightcap
 	return state_offset;
 }
 
-static void PropagateState(Disambiguator_data_t *d, const LightcapElement *le) {
+static SurviveLightcapDecision PropagateState(Disambiguator_data_t *d, const LightcapElement *le,
+											 const LightcapFeatures *features) {
 	struct SurviveContext *ctx = d->so->ctx;
 	if (le->sensor_id >= d->so->sensor_ct) {
 		SV_WARN("Invalid sensor %d detected hit", le->sensor_id);
-		return;
+		return SURVIVE_LIGHTCAP_DROPPED;
 	}
 
 	Global_Disambiguator_data_t *g = ctx->disambiguator_data;
@@ -743,7 +777,7 @@ static void PropagateState(Disambiguator_data_t *d, const LightcapElement *le) {
 
 	const LighthouseStateParameters *param = &LS_Params[d->state];
 	if (param->is_sweep == 0) {
-		RunACodeCapture(LSParam_acode(d->state), d, le);
+		return RunACodeCapture(LSParam_acode(d->state), d, le, features);
 	} else if (le->length > d->sweep_data[le->sensor_id].length &&
 			   le->length < 10000 /*anything above 10k seems to be bullshit?*/) {
 		// Note we only select the highest length one per sweep. Also, we bundle everything up and send it later all at
@@ -754,44 +788,46 @@ static void PropagateState(Disambiguator_data_t *d, const LightcapElement *le) {
 		}
 		assert(le->sensor_id < d->so->sensor_ct);
 		d->sweep_data[le->sensor_id] = *le;
+		return SURVIVE_LIGHTCAP_SWEEP;
 	}
+	return SURVIVE_LIGHTCAP_DROPPED;
 }
 
-void DisambiguatorStateBased(SurviveObject *so, const LightcapElement *le) {
+static void DisambiguatorStateBased_free(SurviveObject *so) {
 	SurviveContext *ctx = so->ctx;
-
-	// Signal to destroy self
-	if (le == 0) {
-		Disambiguator_data_t *d = so->disambiguator_data;
-		if (d) {
-			SV_VERBOSE(5, "StateBased Disambiguator statistics:");
-			SV_VERBOSE(5, "\tsync_time_error         %u", d->stats.sync_time_error);
-			SV_VERBOSE(5, "\tconfidence_resets       %u", d->stats.confidence_resets);
-			SV_VERBOSE(5, "\tdrop_sweeps             %u", d->stats.drop_sweeps);
-			SV_VERBOSE(5, "\tsweep_hit_count         %u", d->stats.sweep_hit_count);
-			for (int i = 0; i < 2; i++) {
-				SV_VERBOSE(5, "\tsync_count[%d]           %u", i, d->stats.sync_count[i]);
-				SV_VERBOSE(5, "\tdrop_syncs[%d]           %u", i, d->stats.drop_syncs[i]);
-			}
-		}
-		if (ctx->disambiguator_data) {
-			Global_Disambiguator_data_t_detach_config(ctx, ctx->disambiguator_data);
-			free(ctx->disambiguator_data);
-			ctx->disambiguator_data = 0;
+	Disambiguator_data_t *d = so->disambiguator_data;
+	if (d) {
+		SV_VERBOSE(5, "StateBased Disambiguator statistics:");
+		SV_VERBOSE(5, "\tsync_time_error         %u", d->stats.sync_time_error);
+		SV_VERBOSE(5, "\tconfidence_resets       %u", d->stats.confidence_resets);
+		SV_VERBOSE(5, "\tdrop_sweeps             %u", d->stats.drop_sweeps);
+		SV_VERBOSE(5, "\tsweep_hit_count         %u", d->stats.sweep_hit_count);
+		for (int i = 0; i < 2; i++) {
+			SV_VERBOSE(5, "\tsync_count[%d]           %u", i, d->stats.sync_count[i]);
+			SV_VERBOSE(5, "\tdrop_syncs[%d]           %u", i, d->stats.drop_syncs[i]);
 		}
-
-		free(so->disambiguator_data);
-		so->disambiguator_data = 0;
-		return;
+		SV_VERBOSE(5, "\tbatches                 %u", d->stats.batches);
+		SV_VERBOSE(5, "\tbatched_elements        %u", d->stats.batched_elements);
+	}
+	if (ctx->disambiguator_data) {
+		Global_Disambiguator_data_t_detach_config(ctx, ctx->disambiguator_data);
+		free(ctx->disambiguator_data);
+		ctx->disambiguator_data = 0;
 	}
 
+	free(so->disambiguator_data);
+	so->disambiguator_data = 0;
+}
+
+static Disambiguator_data_t *DisambiguatorStateBased_data(SurviveObject *so) {
+	SurviveContext *ctx = so->ctx;
 	if (ctx->state == SURVIVE_CLOSING) {
-		return;
+		return 0;
 	}
 
 	// Note, this happens if we don't have config yet -- just bail
 	if (so->sensor_ct == 0) {
-		return;
+		return 0;
 	}
 
 	if (so->ctx->disambiguator_data == NULL) {
@@ -807,19 +843,26 @@ void DisambiguatorStateBased(SurviveObject *so, const LightcapElement *le) {
 		so->disambiguator_data = d;
 	}
 
-	Disambiguator_data_t *d = so->disambiguator_data;
+	return so->disambiguator_data;
+}
+
+static SurviveLightcapDecision Disambiguate(Disambiguator_data_t *d, const LightcapElement *le,
+										   const LightcapFeatures *features) {
+	SurviveObject *so = d->so;
+	SurviveContext *ctx = so->ctx;
 
 	// It seems like the first few hundred lightcapelements are missing a ton of data; let it stabilize.
 	if (d->stabalize < 200) {
 		d->stabalize++;
-		return;
+		return SURVIVE_LIGHTCAP_DROPPED;
 	}
 
 	SV_VERBOSE(3000, "%s LE: %2u\t%4u\t%10u\t%2u\t%7u", so->codename, le->sensor_id, le->length, le->timestamp,
 			   d->state, offset_from_state(d, le));
 
+	SurviveLightcapDecision decision = SURVIVE_LIGHTCAP_SEARCHING;
 	if (d->state == LS_UNKNOWN) {
-		enum LighthouseState new_state = AttemptFindState(d, le);
+		enum LighthouseState new_state = AttemptFindState(d, le, features);
 		if (new_state != LS_UNKNOWN) {
 			d->confidence = 0;
 			d->failures = 0;
@@ -844,15 +887,79 @@ void DisambiguatorStateBased(SurviveObject *so, const LightcapElement *le) {
 				SetState(d, le, LS_UNKNOWN);
 				SV_WARN("Disambiguator got lost at %u (sync timeout %u); refinding state for %s", le->timestamp,
 						timediff, survive_colorize(d->so->codename));
-				return;
+				return SURVIVE_LIGHTCAP_DROPPED;
 			}
 
 			d->confidence = d->confidence - penalty;
 		}
-		PropagateState(d, le);
+		decision = PropagateState(d, le, features);
 	}
 
 	d->last_timestamp = le->timestamp;
+	return decision;
+}
+
+void DisambiguatorStateBased(SurviveObject *so, const LightcapElement *le) {
+	// Signal to destroy self
+	if (le == 0) {
+		DisambiguatorStateBased_free(so);
+		return;
+	}
+
+	Disambiguator_data_t *d = DisambiguatorStateBased_data(so);
+	if (d == 0) {
+		return;
+	}
+
+	SurviveContext *ctx = so->ctx;
+	LightcapFeatures features;
+	classify_lightcaps(le, 1, &features);
+
+	double profile_start = survive_profile_start(ctx);
+	Disambiguate(d, le, &features);
+	survive_profile_end(ctx, survive_profile_stage_disambiguation, profile_start);
 }
 
 REGISTER_LINKTIME(DisambiguatorStateBased)
+
+#define LIGHTCAPS_CHUNK 64
+
+/**
+ * Batched entry point for the lightcaps hook. Element for element it makes the same calls into the state machine as
+ * DisambiguatorStateBased, but classifies the whole batch up front and is only dispatched and profiled once.
+ */
+void LightcapsStateBased(SurviveObject *so, const LightcapElement *les, size_t cnt, uint8_t *decisions) {
+	SurviveContext *ctx = so->ctx;
+
+	// Something else was installed as the lightcap hook; it has to see every element
+	if (ctx->lightcapproc != DisambiguatorStateBased) {
+		survive_default_lightcaps_process(so, les, cnt, decisions);
+		return;
+	}
+
+	Disambiguator_data_t *d = DisambiguatorStateBased_data(so);
+	if (d == 0) {
+		if (decisions)
+			memset(decisions, SURVIVE_LIGHTCAP_DROPPED, cnt);
+		return;
+	}
+
+	d->stats.batches++;
+	d->stats.batched_elements += cnt;
+
+	double profile_start = survive_profile_start(ctx);
+	LightcapFeatures features[LIGHTCAPS_CHUNK];
+	for (size_t start = 0; start < cnt; start += LIGHTCAPS_CHUNK) {
+		size_t chunk = cnt - start < LIGHTCAPS_CHUNK ? cnt - start : LIGHTCAPS_CHUNK;
+		classify_lightcaps(les + start, chunk, features);
+
+		for (size_t i = 0; i < chunk; i++) {
+			SurviveLightcapDecision decision = Disambiguate(d, &les[start + i], &features[i]);
+			if (decisions)
+				decisions[start + i] = decision;
+		}
+	}
+	survive_profile_end(ctx, survive_profile_stage_disambiguation, profile_start);
+}
+
+REGISTER_LINKTIME(LightcapsStateBased)
@@ -76,7 +76,11 @@ static size_t add_scenes(struct global_scene_solver *gss, SurviveObject *so) {
 	bool useful = gss->desired_coverage < 0;
 	size_t lh_meas[NUM_GEN2_LIGHTHOUSES] = {0};
 	for (uint8_t lh = 0; lh < ctx->activeLighthouses; lh++) {
-		for (uint8_t sensor = 0; sensor < so->sensor_ct; sensor++) {
+		uint32_t sensors = activations->readings[lh][0] | activations->readings[lh][1];
+		for (uint8_t sensor = 0; sensors && sensor < so->sensor_ct; sensor++, sensors >>= 1) {
+			if (!(sensors & 1)) {
+				continue;
+			}
 			for (uint8_t axis = 0; axis < 2; axis++) {
 				bool isReadingValid =
 					SurviveSensorActivations_is_reading_valid(activations, sensor_time_window, sensor, lh, axis);
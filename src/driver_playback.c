@@ -4,12 +4,14 @@
 #include "os_generic.h"
 #include "survive.h"
 
-#include "survive_recording.h"
+#include "survive_binary_recording.h"
 #include "survive_internal.h"
+#include "survive_recording.h"
 
 #include "survive_default_devices.h"
 
 #include "survive_gz.h"
+#include "survive_gz_index.h"
 
 STATIC_CONFIG_ITEM(PLAYBACK_REPLAY_POSE, "playback-replay-pose", 'b', "Whether or not to output pose", 0)
 STATIC_CONFIG_ITEM(PLAYBACK_REPLAY_EXTERNAL_POSE, "playback-replay-external-pose", 'b',
@@ -20,6 +22,12 @@ STATIC_CONFIG_ITEM(PLAYBACK_FACTOR, "playback-factor", 'f',
 				   1.0f)
 STATIC_CONFIG_ITEM(PLAYBACK_START_TIME, "playback-start-time", 'f', "Start time of playback", -1.0f)
 STATIC_CONFIG_ITEM(PLAYBACK_TIME, "playback-time", 'f', "End time of playback", -1.0f)
+STATIC_CONFIG_ITEM(PLAYBACK_DETERMINISTIC, "playback-deterministic", 'b',
+				   "Play back as fast as possible from the polling thread so every run gives the same output. Not "
+				   "supported for usbmon (pcap) playback.",
+				   0)
+STATIC_CONFIG_ITEM(PLAYBACK_INDEX, "playback-index", 'b',
+				   "Seek to playback-start-time in gz recordings with a '<file>.idx' index, built on first use.", 1)
 
 STATIC_CONFIG_ITEM(PLAYBACK_RUN_TIME, "run-time", 'f', "How long to run for", -1.)
 
@@ -46,6 +54,16 @@ typedef struct SurvivePlaybackData {
     gzFile playback_file;
     int lineno;
 
+	// Replaces playback_file once a text recording has been seeked with its index
+	survive_gz_index_reader *indexed_file;
+
+	// Set instead of playback_file when playing back a binary recording
+	survive_binary_reader *binary_file;
+	survive_binary_record pending_record;
+	bool hasPendingRecord, hasSeeked;
+	char *text_record;
+	size_t text_record_size;
+
 	double time_start;
 	double next_time_s;
 	double time_now;
@@ -59,8 +77,16 @@ typedef struct SurvivePlaybackData {
 
 	uint32_t total_sleep_time;
 	bool *keepRunning;
+	bool deterministic;
+	bool useIndex;
+
+	// Device of the line being run, looked up once by playback_run_line so the parsers don't each do it again
+	SurviveObject *line_so;
 } SurvivePlaybackData;
 
+// Records replayed per poll in deterministic mode; any fixed number works, this just amortizes survive_poll
+#define PLAYBACK_DETERMINISTIC_BATCH 256
+
 static double survive_playback_run_time(const SurviveContext *ctx, void *_sp) {
 	const struct SurvivePlaybackData *sp = _sp;
 	return sp->time_now;
@@ -69,7 +95,9 @@ static double survive_playback_run_time(const SurviveContext *ctx, void *_sp) {
 
 static SurviveObject *find_or_warn(SurvivePlaybackData *driver, const char *dev) {
 	SurviveContext *ctx = driver->ctx;
-	SurviveObject *so = survive_get_so_by_name(driver->ctx, dev);
+	SurviveObject *so = driver->line_so && strcmp(driver->line_so->codename, dev) == 0
+							? driver->line_so
+							: survive_get_so_by_name(driver->ctx, dev);
 	if (!so) {
 		static bool display_once = false;
 		SurviveContext *ctx = driver->ctx;
@@ -394,17 +422,199 @@ static int parse_and_run_lightcode(const char *line, SurvivePlaybackData *driver
 
 
 
+static void playback_run_line(SurvivePlaybackData *driver, char *line) {
+	SurviveContext *ctx = driver->ctx;
+	char dev[32];
+	char op[32];
+	if (sscanf(line, "%31s %31s", dev, op) < 2) {
+		return;
+	}
+
+	const char *ignore_ops[] = {"OPTION", "EXTERNAL_TO_WORLD", "SPHERE", "LH_UP"};
+	for (int i = 0; i < SURVIVE_ARRAY_SIZE(ignore_ops); i++) {
+		if (strcmp(dev, ignore_ops[i]) == 0) {
+			return;
+		}
+	}
+
+	// CONFIG lines can tear down and recreate the device, so they can't hold its lock. Only this thread adds or
+	// removes playback devices, so 'so' stays valid once the lookup lets go of the context lock.
+	survive_get_ctx_lock(ctx);
+	SurviveObject *so = strcmp(op, "CONFIG") == 0 ? 0 : survive_get_so_by_name(ctx, dev);
+	survive_release_ctx_lock(ctx);
+
+	survive_get_ingest_lock(ctx, so);
+	driver->line_so = so;
+
+	switch (op[0]) {
+	case 'F':
+		if (strcmp(op, "FULL_STATE") == 0 || strcmp(op, "FULL_COVARIANCE") == 0) {
+		}
+		break;
+	case 'D':
+		break;
+	case 'W':
+		if (op[1] == 0)
+			parse_and_run_sweep(line, driver);
+		break;
+	case 'B':
+		if (op[1] == 0 && driver->hasSweepAngle == false)
+			parse_and_run_sweep_angle(line, driver);
+		break;
+	case 'Y':
+		if (op[1] == 0)
+			parse_and_run_sync(line, driver);
+		break;
+	case 'E':
+		if (strcmp(op, "EXTERNAL_POSE") == 0) {
+			parse_and_run_externalpose(line, driver);
+			break;
+		} else if (strcmp(op, "EXTERNAL_VELOCITY") == 0) {
+			parse_and_run_externalvelocity(line, driver);
+			break;
+		}
+	case 'C':
+		if (op[1] == 0) {
+			parse_and_run_rawlight(line, driver);
+		} else if (strcmp(op, "CONFIG") == 0) {
+			parse_and_run_config(line, driver);
+		}
+		break;
+	case 'L':
+		if (strcmp(op, "LH_POSE") == 0) {
+			parse_and_run_lhpose(line, driver);
+			break;
+		}
+	case 'R':
+		if (op[1] == 0 && driver->hasRawLight == false)
+			parse_and_run_lightcode(line, driver);
+		break;
+	case 'i':
+		if (op[1] == 0)
+			parse_and_run_imu(line, driver, true);
+		break;
+	case 'I':
+		if (op[1] == 0)
+			parse_and_run_imu(line, driver, false);
+		else if(strcmp(op, "IMU_SCALES") == 0) {
+			parse_and_set_imu_scales(line, driver);
+		}
+		break;
+	case 'P':
+		if (strcmp(op, "POSE") == 0 && driver->outputCalculatedPose)
+			parse_and_run_pose(line, driver);
+		break;
+	case 'A':
+	case 'V':
+		if (strcmp(op, "VELOCITY") == 0 && driver->outputCalculatedPose)
+			parse_and_run_velocity(line, driver);
+		break;
+	default:
+		SV_WARN("Playback doesn't understand '%.10s' op in '%.20s'", op, line);
+	}
+
+	driver->line_so = 0;
+	survive_release_ingest_lock(ctx, so);
+}
+
+static ssize_t playback_getdelim(SurvivePlaybackData *driver, char **line, size_t *n, int delimiter) {
+	if (driver->indexed_file)
+		return survive_gz_index_reader_getdelim(driver->indexed_file, line, n, delimiter);
+	return gzgetdelim(line, n, delimiter, driver->playback_file);
+}
+
+static bool playback_text_good(SurvivePlaybackData *driver) {
+	if (driver->indexed_file)
+		return !survive_gz_index_reader_eof(driver->indexed_file) &&
+			   !survive_gz_index_reader_error(driver->indexed_file);
+
+	gzFile f = driver->playback_file;
+	return f && !gzeof(f) && !gzerror_dropin(f);
+}
+
+static void playback_close_text(SurvivePlaybackData *driver) {
+	if (driver->playback_file)
+		gzclose(driver->playback_file);
+	driver->playback_file = 0;
+	survive_gz_index_reader_close(driver->indexed_file);
+	driver->indexed_file = 0;
+}
+
+/*
+ * Text recordings are only seekable through an index (see survive_gz_index.h); without one everything before the start
+ * time is read and skipped line by line as before. With one, playback resumes from the access point before the start
+ * time after replaying the config, LH_POSE, etc lines which came before it.
+ */
+static void playback_seek_text(SurvivePlaybackData *driver) {
+	SurviveContext *ctx = driver->ctx;
+	double build_start = OGRelativeTime();
+	survive_gz_index *index = survive_gz_index_open(driver->playback_dir);
+	if (index == 0) {
+		SV_VERBOSE(10, "Could not index %s; reading up to the start time instead", driver->playback_dir);
+		return;
+	}
+
+	size_t point = survive_gz_index_find_point(index, driver->playback_start_time);
+	uint64_t offset = survive_gz_index_point_offset(index, point);
+	survive_gz_index_reader *reader = offset ? survive_gz_index_reader_open(index, driver->playback_dir, point) : 0;
+	if (reader == 0) {
+		survive_gz_index_free(index);
+		return;
+	}
+
+	char *line = 0;
+	size_t line_size = 0;
+	for (size_t i = 0; i < survive_gz_index_state_line_count(index); i++) {
+		double time;
+		uint64_t line_offset;
+		const char *state = survive_gz_index_state_line(index, i, &time, &line_offset);
+		if (line_offset >= offset)
+			break;
+
+		// Same handling as playback_pump_msg gives the line
+		const char *rest = strchr(state, ' ');
+		if (rest == 0)
+			continue;
+		size_t len = strlen(++rest);
+		if (len + 1 > line_size) {
+			line_size = len + 1;
+			line = SV_REALLOC(line, line_size);
+		}
+		memcpy(line, rest, len + 1);
+		while (len && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+			line[--len] = 0;
+		}
+
+		driver->time_now = time;
+		playback_run_line(driver, line);
+	}
+	free(line);
+
+	SV_VERBOSE(10, "Seeked to %.6fs of %s in %.3fs", survive_gz_index_point_time(index, point), driver->playback_dir,
+			   OGRelativeTime() - build_start);
+	survive_gz_index_free(index);
+
+	gzclose(driver->playback_file);
+	driver->playback_file = 0;
+	driver->indexed_file = reader;
+}
+
 static int playback_pump_msg(struct SurviveContext *ctx, void *_driver) {
 	SurvivePlaybackData *driver = _driver;
-	gzFile f = driver->playback_file;
 
-	if (f && !gzeof(f) && !gzerror_dropin(f)) {
+	if (!driver->hasSeeked) {
+		driver->hasSeeked = true;
+		if (driver->useIndex && driver->playback_start_time > 0)
+			playback_seek_text(driver);
+	}
+
+	if (playback_text_good(driver)) {
 		driver->lineno++;
 		char *line = 0;
 
 		if (driver->next_time_s == 0) {
 			size_t n = 0;
-			ssize_t r = gzgetdelim(&line, &n, ' ', f);
+			ssize_t r = playback_getdelim(driver, &line, &n, ' ');
 			if (r <= 0) {
 				free(line);
 				return 0;
@@ -415,7 +625,7 @@ static int playback_pump_msg(struct SurviveContext *ctx, void *_driver) {
 				free(line);
 				line = 0;
 
-				ssize_t r = gzgetline(&line, &n, f);
+				ssize_t r = playback_getdelim(driver, &line, &n, '\n');
 				free(line);
 
 				return 0;
@@ -435,7 +645,7 @@ static int playback_pump_msg(struct SurviveContext *ctx, void *_driver) {
 		driver->next_time_s = 0;
 
 		size_t n = 0;
-		ssize_t r = gzgetline(&line, &n, f);
+		ssize_t r = playback_getdelim(driver, &line, &n, '\n');
 
 		if (r <= 0) {
 			free(line);
@@ -444,100 +654,163 @@ static int playback_pump_msg(struct SurviveContext *ctx, void *_driver) {
 		while (r && (line[r - 1] == '\n' || line[r - 1] == '\r')) {
 			line[--r] = 0;
 		}
-		char dev[32];
-		char op[32];
-		if (sscanf(line, "%31s %31s", dev, op) < 2) {
-			free(line);
-			return 0;
-		}
+		playback_run_line(driver, line);
+		free(line);
+	} else {
+		SV_VERBOSE(100, "EOF for playback received.");
+		playback_close_text(driver);
+		return -1;
+	}
 
-		const char *ignore_ops[] = {"OPTION", "EXTERNAL_TO_WORLD", "SPHERE", "LH_UP"};
-		for (int i = 0; i < SURVIVE_ARRAY_SIZE(ignore_ops); i++) {
-			if (strcmp(dev, ignore_ops[i]) == 0) {
-				free(line);
-				return 0;
-			}
+	return 0;
+}
+
+static void playback_run_record(SurvivePlaybackData *driver, const survive_binary_record *record) {
+	SurviveContext *ctx = driver->ctx;
+
+	if (record->hdr.type == SURVIVE_BINARY_RECORD_TEXT) {
+		size_t len = record->hdr.length;
+		if (len + 1 > driver->text_record_size) {
+			driver->text_record_size = len + 1;
+			driver->text_record = SV_REALLOC(driver->text_record, driver->text_record_size);
+		}
+		memcpy(driver->text_record, record->data, len);
+		while (len && (driver->text_record[len - 1] == '\n' || driver->text_record[len - 1] == '\r')) {
+			len--;
 		}
+		driver->text_record[len] = 0;
+		playback_run_line(driver, driver->text_record);
+		return;
+	}
 
-		survive_get_ctx_lock(ctx);
-		switch (op[0]) {
-		case 'F':
-			if (strcmp(op, "FULL_STATE") == 0 || strcmp(op, "FULL_COVARIANCE") == 0) {
-			}
-			break;
-		case 'D':
-			break;
-		case 'W':
-			if (op[1] == 0)
-				parse_and_run_sweep(line, driver);
-			break;
-		case 'B':
-			if (op[1] == 0 && driver->hasSweepAngle == false)
-				parse_and_run_sweep_angle(line, driver);
-			break;
-		case 'Y':
-			if (op[1] == 0)
-				parse_and_run_sync(line, driver);
-			break;
-		case 'E':
-			if (strcmp(op, "EXTERNAL_POSE") == 0) {
-				parse_and_run_externalpose(line, driver);
-				break;
-			} else if (strcmp(op, "EXTERNAL_VELOCITY") == 0) {
-				parse_and_run_externalvelocity(line, driver);
-				break;
-			}
-		case 'C':
-			if (op[1] == 0) {
-				parse_and_run_rawlight(line, driver);
-			} else if (strcmp(op, "CONFIG") == 0) {
-				parse_and_run_config(line, driver);
-			}
+	// Every typed record is sensor data
+	if (driver->time_now < driver->playback_start_time)
+		return;
+
+	char dev[sizeof(record->hdr.dev) + 1] = {0};
+	memcpy(dev, record->hdr.dev, sizeof(record->hdr.dev));
+
+	survive_get_ctx_lock(ctx);
+	SurviveObject *so = find_or_warn(driver, dev);
+	survive_release_ctx_lock(ctx);
+
+	if (so) {
+		survive_get_ingest_lock(ctx, so);
+
+		switch (record->hdr.type) {
+		case SURVIVE_BINARY_RECORD_SYNC: {
+			const survive_binary_sync *r = record->data;
+			SURVIVE_INVOKE_HOOK_SO(sync, so, r->channel, r->timecode, r->ootx, r->gen);
 			break;
-		case 'L':
-			if (strcmp(op, "LH_POSE") == 0) {
-				parse_and_run_lhpose(line, driver);
-				break;
-			}
-		case 'R':
-			if (op[1] == 0 && driver->hasRawLight == false)
-				parse_and_run_lightcode(line, driver);
+		}
+		case SURVIVE_BINARY_RECORD_SWEEP: {
+			const survive_binary_sweep *r = record->data;
+			driver->hasSweepAngle = true;
+			SURVIVE_INVOKE_HOOK_SO(sweep, so, r->channel, r->sensor_id, r->timecode, r->flag);
 			break;
-		case 'i':
-			if (op[1] == 0)
-				parse_and_run_imu(line, driver, true);
+		}
+		case SURVIVE_BINARY_RECORD_SWEEP_ANGLE: {
+			const survive_binary_sweep_angle *r = record->data;
+			if (driver->hasSweepAngle == false)
+				SURVIVE_INVOKE_HOOK_SO(sweep_angle, so, r->channel, r->sensor_id, r->timecode, r->plane, r->angle);
 			break;
-		case 'I':
-			if (op[1] == 0)
-				parse_and_run_imu(line, driver, false);
-			else if(strcmp(op, "IMU_SCALES") == 0) {
-                parse_and_set_imu_scales(line, driver);
+		}
+		case SURVIVE_BINARY_RECORD_IMU:
+		case SURVIVE_BINARY_RECORD_RAW_IMU: {
+			const survive_binary_imu *r = record->data;
+			FLT accelgyro[9];
+			for (int i = 0; i < 9; i++)
+				accelgyro[i] = r->accelgyromag[i];
+
+			if (record->hdr.type == SURVIVE_BINARY_RECORD_RAW_IMU) {
+				driver->hasRawIMU = true;
+				SURVIVE_INVOKE_HOOK_SO(raw_imu, so, r->mask, accelgyro, r->timecode, r->id);
+			} else if (!driver->hasRawIMU) {
+				SURVIVE_INVOKE_HOOK_SO(imu, so, r->mask, accelgyro, r->timecode, r->id);
 			}
 			break;
-		case 'P':
-			if (strcmp(op, "POSE") == 0 && driver->outputCalculatedPose)
-				parse_and_run_pose(line, driver);
+		}
+		case SURVIVE_BINARY_RECORD_LIGHTCAP: {
+			const survive_binary_lightcap *r = record->data;
+			LightcapElement le = {.sensor_id = r->sensor_id, .length = r->length, .timestamp = r->timestamp};
+			driver->hasRawLight = 1;
+			handle_lightcap(so, &le);
 			break;
-		case 'A':
-		case 'V':
-			if (strcmp(op, "VELOCITY") == 0 && driver->outputCalculatedPose)
-				parse_and_run_velocity(line, driver);
+		}
+		case SURVIVE_BINARY_RECORD_LIGHT: {
+			// acode -1 ('S' lines in the text format) was never played back
+			const survive_binary_light *r = record->data;
+			if (driver->hasRawLight == false && r->acode != -1)
+				SURVIVE_INVOKE_HOOK_SO(light, so, r->sensor_id, r->acode, r->timeinsweep, r->timecode, r->length, r->lh);
 			break;
+		}
 		default:
-			SV_WARN("Playback doesn't understand '%.10s' op in '%.20s'", op, line);
+			SV_WARN("Playback doesn't understand binary record type %d", record->hdr.type);
 		}
-		survive_release_ctx_lock(ctx);
 
-		free(line);
-	} else {
-		SV_VERBOSE(100, "EOF for playback received.");
-		if (f) {
-			gzclose(driver->playback_file);
+		survive_release_ingest_lock(ctx, so);
+	}
+}
+
+/*
+ * Starting part way into a binary recording skips straight to the block containing the start time; but any config,
+ * options, etc before that point still have to be replayed.
+ */
+static void playback_seek_binary(SurvivePlaybackData *driver) {
+	size_t start_block = survive_binary_reader_find_block(driver->binary_file, driver->playback_start_time);
+
+	survive_binary_record record;
+	for (size_t block = 0; block < start_block; block++) {
+		if (!survive_binary_reader_block_has_text(driver->binary_file, block))
+			continue;
+
+		survive_binary_reader_seek_block(driver->binary_file, block);
+		while (survive_binary_reader_next(driver->binary_file, &record) > 0 && record.block == block) {
+			if (record.hdr.type == SURVIVE_BINARY_RECORD_TEXT) {
+				driver->time_now = record.hdr.time;
+				playback_run_record(driver, &record);
+			}
 		}
-		driver->playback_file = 0;
+	}
+
+	survive_binary_reader_seek_block(driver->binary_file, start_block);
+}
+
+static int playback_pump_binary_msg(struct SurviveContext *ctx, void *_driver) {
+	SurvivePlaybackData *driver = _driver;
+
+	if (driver->binary_file == 0)
 		return -1;
+
+	if (!driver->hasSeeked) {
+		driver->hasSeeked = true;
+		if (driver->playback_start_time > 0)
+			playback_seek_binary(driver);
 	}
 
+	if (!driver->hasPendingRecord) {
+		int r = survive_binary_reader_next(driver->binary_file, &driver->pending_record);
+		if (r <= 0) {
+			if (r < 0)
+				SV_WARN("Playback file is corrupt after %.6fs", driver->time_now);
+			SV_VERBOSE(100, "EOF for playback received.");
+			survive_binary_reader_close(driver->binary_file);
+			driver->binary_file = 0;
+			return -1;
+		}
+		driver->hasPendingRecord = true;
+		driver->next_time_s = driver->pending_record.hdr.time;
+	}
+
+	if (driver->next_time_s * driver->playback_factor > (OGRelativeTime() + driver->time_start))
+		return 0;
+
+	driver->lineno++;
+	driver->time_now = driver->next_time_s;
+	driver->next_time_s = 0;
+	driver->hasPendingRecord = false;
+
+	playback_run_record(driver, &driver->pending_record);
 	return 0;
 }
 
@@ -554,7 +827,8 @@ static void *playback_thread(void *_driver) {
 			return 0;
 		}
 		if (next_time_s_scaled == 0 || next_time_s_scaled < time_now) {
-			int rtnVal = playback_pump_msg(driver->ctx, driver);
+			int rtnVal = driver->binary_file ? playback_pump_binary_msg(driver->ctx, driver)
+											 : playback_pump_msg(driver->ctx, driver);
 			SurviveContext *ctx = driver->ctx;
 			if (last_output_minute != output_minute) {
 				SV_VERBOSE(10, "Playback thread played back %6.2fs in %6.2fs real-time... (%6.2fx)", driver->time_now,
@@ -573,6 +847,31 @@ static void *playback_thread(void *_driver) {
 	return 0;
 }
 
+/*
+ * Deterministic playback doesn't have its own thread; the records are replayed from survive_poll so nothing else can
+ * interleave with them. Posers and the GSS already run inline at a playback factor of 0.
+ */
+static int playback_poll(struct SurviveContext *ctx, void *_driver) {
+	SurvivePlaybackData *driver = _driver;
+	int rtn = 0;
+
+	// The pump functions take the context lock per record, and poll is called with it held
+	survive_release_ctx_lock(ctx);
+	for (int i = 0; i < PLAYBACK_DETERMINISTIC_BATCH && rtn == 0; i++) {
+		if (driver->playback_time >= 0 && driver->time_now > driver->playback_time) {
+			rtn = -1;
+			break;
+		}
+
+		int r = driver->binary_file ? playback_pump_binary_msg(ctx, driver) : playback_pump_msg(ctx, driver);
+		if (r < 0)
+			rtn = -1;
+	}
+	survive_get_ctx_lock(ctx);
+
+	return rtn;
+}
+
 static int playback_close(struct SurviveContext *ctx, void *_driver) {
 	SurvivePlaybackData *driver = _driver;
 
@@ -581,9 +880,10 @@ static int playback_close(struct SurviveContext *ctx, void *_driver) {
 	survive_get_ctx_lock(ctx);
 	SV_VERBOSE(50, "Playback thread slept for %" PRIu32 "ms", driver->total_sleep_time);
 	SV_VERBOSE(10, "Playback thread played back %6.2fs in %6.2fs real-time", driver->time_now, OGRelativeTime());
-	if (driver->playback_file)
-		gzclose(driver->playback_file);
-	driver->playback_file = 0;
+	playback_close_text(driver);
+	survive_binary_reader_close(driver->binary_file);
+	driver->binary_file = 0;
+	free(driver->text_record);
 
 	survive_detach_config(ctx, PLAYBACK_START_TIME_TAG, &driver->playback_start_time);
 	survive_detach_config(ctx, "playback-factor", &driver->playback_factor);
@@ -594,6 +894,47 @@ static int playback_close(struct SurviveContext *ctx, void *_driver) {
 	return 0;
 }
 
+static void playback_add_driver(SurvivePlaybackData *sp) {
+	if (sp->deterministic) {
+		survive_add_driver(sp->ctx, sp, playback_poll, playback_close);
+	} else {
+		sp->keepRunning = survive_add_threaded_driver(sp->ctx, sp, "playback", playback_thread, playback_close);
+	}
+}
+
+static void playback_attach_config(SurvivePlaybackData *sp, const char *playback_file) {
+	SurviveContext *ctx = sp->ctx;
+	survive_install_run_time_fn(ctx, survive_playback_run_time, sp);
+	survive_attach_configf(ctx, "playback-factor", &sp->playback_factor);
+	survive_attach_configf(ctx, "playback-time", &sp->playback_time);
+	survive_attach_configf(ctx, PLAYBACK_START_TIME_TAG, &sp->playback_start_time);
+
+	SV_INFO("Using playback file '%s' with timefactor of %f until %f", playback_file, sp->playback_factor,
+			sp->playback_time);
+}
+
+static int playback_open_binary(SurvivePlaybackData *sp, const char *playback_file) {
+	SurviveContext *ctx = sp->ctx;
+	sp->binary_file = survive_binary_reader_open(playback_file);
+	if (sp->binary_file == 0) {
+		SV_ERROR(SURVIVE_ERROR_INVALID_CONFIG, "Could not open binary playback file %s", playback_file);
+		free(sp);
+		return -1;
+	}
+	playback_attach_config(sp, playback_file);
+
+	survive_binary_record record;
+	if (survive_binary_reader_next(sp->binary_file, &record) > 0) {
+		sp->time_start = record.hdr.time;
+	}
+	if (sp->time_start < sp->playback_start_time)
+		sp->time_start = sp->playback_start_time;
+	survive_binary_reader_seek_block(sp->binary_file, 0);
+
+	playback_add_driver(sp);
+	return 0;
+}
+
 int DriverRegPlayback(SurviveContext *ctx) {
 	const char *playback_file = survive_configs(ctx, "playback", SC_GET, 0);
 
@@ -618,19 +959,19 @@ int DriverRegPlayback(SurviveContext *ctx) {
 
 	sp->outputCalculatedPose = survive_configi(ctx, "playback-replay-pose", SC_GET, 0);
 	sp->outputExternalPose = survive_configi(ctx, PLAYBACK_REPLAY_EXTERNAL_POSE_TAG, SC_GET, 0);
+	sp->deterministic = survive_configi(ctx, PLAYBACK_DETERMINISTIC_TAG, SC_GET, 0);
+	sp->useIndex = survive_configi(ctx, PLAYBACK_INDEX_TAG, SC_GET, 1);
+
+	if (survive_binary_recording_file_is_binary(playback_file)) {
+		return playback_open_binary(sp, playback_file);
+	}
 
 	sp->playback_file = gzopen(playback_file, "r");
 	if (sp->playback_file == 0) {
 		SV_ERROR(SURVIVE_ERROR_INVALID_CONFIG, "Could not open playback events file %s", playback_file);
 		return -1;
 	}
-	survive_install_run_time_fn(ctx, survive_playback_run_time, sp);
-	survive_attach_configf(ctx, "playback-factor", &sp->playback_factor);
-	survive_attach_configf(ctx, "playback-time", &sp->playback_time);
-	survive_attach_configf(ctx, PLAYBACK_START_TIME_TAG, &sp->playback_start_time);
-
-	SV_INFO("Using playback file '%s' with timefactor of %f until %f", playback_file, sp->playback_factor,
-			sp->playback_time);
+	playback_attach_config(sp, playback_file);
 
 	FLT time = 0;
 	char *line = 0;
@@ -656,7 +997,7 @@ int DriverRegPlayback(SurviveContext *ctx) {
 	free(line);
 	gzseek(sp->playback_file, 0, SEEK_SET); // same as rewind(f);
 
-	sp->keepRunning = survive_add_threaded_driver(ctx, sp, "playback", playback_thread, playback_close);
+	playback_add_driver(sp);
 	return 0;
 }
 
@@ -19,29 +19,58 @@
 
 STATIC_CONFIG_ITEM(Simulator_DRIVER_ENABLE, "simulator", 'b', "Load a Simulator driver for testing.", 0)
 
-typedef struct SurviveDriverSimulatorLHState {
-	FLT last_eval_time;
+#define SIMULATOR_MAX_OBJECTS 100
 
+typedef struct SurviveDriverSimulatorLHState {
 	FLT period_s;
 	FLT start_time;
 } SurviveDriverSimulatorLHState;
 
+struct lh_event {
+	FLT time;
+	uint8_t lh;
+	int idx;
+};
+
+// Sync plus both sweeps of every sensor, for each lighthouse; the timestep is shorter than any rotor period so no
+// lighthouse produces more than that within one step.
+#define SIMULATOR_MAX_LH_EVENTS (NUM_GEN2_LIGHTHOUSES * (2 * SENSORS_PER_OBJECT + 1))
+
 typedef SurviveVelocity SurviveAcceleration;
+
+// Ground truth of one simulated object; each moves independently through the attractor field
+typedef struct SurviveSimulatedObject {
+	SurviveObject *so;
+
+	SurvivePose position;
+	SurviveVelocity velocity;
+	SurviveAcceleration accel;
+
+	// Shifts the attractors for this object so that objects don't all follow the same path
+	LinmathVec3d attractor_offset;
+
+	FLT time_next_imu;
+	FLT gyro_bias[3];
+
+	struct variance_measure pose_variance;
+} SurviveSimulatedObject;
+
 struct SurviveDriverSimulator {
 	int lh_version;
 	SurviveContext *ctx;
-	SurviveObject *so;
+
+	SurviveSimulatedObject *objs;
+	size_t obj_cnt;
 
 	SurviveDriverSimulatorLHState lhstates[NUM_GEN2_LIGHTHOUSES];
 	BaseStationData bsd[NUM_GEN2_LIGHTHOUSES];
 
-	SurvivePose position;
-	SurviveVelocity velocity;
-	SurviveAcceleration accel;
+	struct lh_event *events;
 
-	FLT time_last_imu;
+	FLT time_next_light;
 	FLT time_last_light;
 	FLT time_last_iterate;
+	FLT realtime_start;
 
 	FLT noise_scale;
 	FLT sensor_var;
@@ -53,14 +82,18 @@ struct SurviveDriverSimulator {
 	FLT current_timestamp;
 	int acode;
 
-	FLT gyro_bias[3];
 	FLT gyro_bias_scale;
 	FLT gyro_var;
 	FLT sensor_jitter;
 	FLT acc_var;
 	int show_gt_device_cfg;
 
-	struct variance_measure pose_variance;
+	uint64_t rng_state;
+	bool reported_attractors;
+
+	uint64_t imu_event_cnt;
+	uint64_t sync_event_cnt;
+	uint64_t sweep_event_cnt;
 
 	pose_process_func pose_fn;
 	lighthouse_pose_process_func lh_fn;
@@ -69,10 +102,15 @@ struct SurviveDriverSimulator {
 		FLT runtime;
 		FLT obj_radius;
 		FLT fcal_noise;
-		FLT time_factor;
+		FLT speed;
 		int obj_sensors;
 		int attractors;
+		int obj_cnt;
+		int seed;
 
+		int lh_cnt;
+		FLT lh_radius;
+		FLT lh_height;
 		FLT lh_duty_cycle;
 		int report_in_imu;
 	} settings;
@@ -83,6 +121,8 @@ typedef struct SurviveDriverSimulator SurviveDriverSimulator;
 STRUCT_CONFIG_SECTION(SurviveDriverSimulator)
     STRUCT_CONFIG_ITEM("simulator-attractors",  "Number on gravity attractors in simulation", 3, t->settings.attractors)
     STRUCT_CONFIG_ITEM("simulator-obj-sensors",  "Number on sensors on the simulated object", 20, t->settings.obj_sensors)
+    STRUCT_CONFIG_ITEM("simulator-objects",  "Number of simulated objects", 1, t->settings.obj_cnt)
+    STRUCT_CONFIG_ITEM("simulator-seed",  "Seed for the simulation's random numbers", 42, t->settings.seed)
     STRUCT_CONFIG_ITEM("simulator-fcal-noise",  "Noise to apply to BSD fcal parameters", 1e-3, t->settings.fcal_noise)
     STRUCT_CONFIG_ITEM("simulator-init-time", "Init time -- object wont move for this long", 2., t->init_time)
     STRUCT_CONFIG_ITEM("simulator-gyro-noise", "Variance of noise to apply to gyro", 1e-3, t->gyro_var)
@@ -94,41 +134,62 @@ STRUCT_CONFIG_SECTION(SurviveDriverSimulator)
     STRUCT_CONFIG_ITEM("simulator-sensor-noise", "Variance of noise to apply to light sensors", 1e-4, t->sensor_var)
     STRUCT_CONFIG_ITEM("simulator-obj-radius", "Radius of the simulated object", 0.05, t->settings.obj_radius)
     STRUCT_CONFIG_ITEM("simulator-time", "Seconds to run simulator for.", 0.0, t->settings.runtime)
+    STRUCT_CONFIG_ITEM("simulator-speed", "Simulated seconds per real second; 0 runs as fast as possible", 1., t->settings.speed)
     STRUCT_CONFIG_ITEM("simulator-sensor-droprate", "Chance to drop a sensor reading", .2, t->sensor_droprate)
     STRUCT_CONFIG_ITEM("simulator-noise-scale", "", 1., t->noise_scale)
     STRUCT_CONFIG_ITEM("simulator-lh-gen", "Lighthouse generation", 1, t->lh_version)
 
+    STRUCT_CONFIG_ITEM("simulator-lighthouses", "Number of lighthouses to place in a ring; 0 uses the builtin layout", 0, t->settings.lh_cnt)
+    STRUCT_CONFIG_ITEM("simulator-lh-radius", "Radius of the ring of simulated lighthouses", 3., t->settings.lh_radius)
+    STRUCT_CONFIG_ITEM("simulator-lh-height", "Height of the ring of simulated lighthouses", 2., t->settings.lh_height)
     STRUCT_CONFIG_ITEM("simulator-lh-duty-cycle", "Duty cycle of lighthouses", 1., t->settings.lh_duty_cycle)
     STRUCT_EXISTING_CONFIG_ITEM("report-in-imu",t->settings.report_in_imu)
 END_STRUCT_CONFIG_SECTION(SurviveDriverSimulator)
 // clang-format on
 
-static double timestamp_in_s() {
-	static double start_time_s = 0;
-	if (start_time_s == 0.)
-		start_time_s = OGGetAbsoluteTime();
-	return OGGetAbsoluteTime() - start_time_s;
+/*
+ * The simulation draws from its own generator rather than rand() so that a given seed replays the same run no matter
+ * what else in the process uses rand(). This is splitmix64.
+ */
+static uint64_t simulator_rand_u64(SurviveDriverSimulator *driver) {
+	uint64_t z = (driver->rng_state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+static FLT simulator_rand(SurviveDriverSimulator *driver, FLT min, FLT max) {
+	FLT r = (simulator_rand_u64(driver) >> 11) * (1. / 9007199254740992.);
+	return r * (max - min) + min;
+}
+static FLT simulator_normrand(SurviveDriverSimulator *driver, FLT mu, FLT sigma) {
+	FLT u1 = simulator_rand(driver, 1e-7, 1.);
+	FLT u2 = simulator_rand(driver, 0., 1.);
+	return sqrt(-2.0 * log(u1)) * cos(LINMATHPI * 2. * u2) * sigma + mu;
 }
 
-static FLT lighthouse_lasttime_of_angle(SurviveDriverSimulator *driver, int lh, FLT timestamp, FLT angle) {
+// Time since the last sync of the lighthouse; also before its start_time
+static FLT lighthouse_phase(SurviveDriverSimulator *driver, int lh, FLT timestamp) {
 	SurviveDriverSimulatorLHState *lhs = &driver->lhstates[lh];
-	return timestamp - fmod(timestamp - lhs->start_time, lhs->period_s) + angle / (2 * LINMATHPI) * lhs->period_s;
+	FLT phase = fmod(timestamp - lhs->start_time, lhs->period_s);
+	return phase < 0 ? phase + lhs->period_s : phase;
 }
 static FLT lighthouse_sync_time(SurviveDriverSimulator *driver, int lh, FLT timestamp) {
-	return lighthouse_lasttime_of_angle(driver, lh, timestamp, 0);
+	return timestamp - lighthouse_phase(driver, lh, timestamp);
 }
 FLT lighthouse_angle(SurviveDriverSimulator *driver, int lh, FLT timestamp) {
 	SurviveDriverSimulatorLHState *lhs = &driver->lhstates[lh];
 
-	FLT angle = fmod(timestamp - lhs->start_time, lhs->period_s) / lhs->period_s * 2. * LINMATHPI;
+	FLT angle = lighthouse_phase(driver, lh, timestamp) / lhs->period_s * 2. * LINMATHPI;
 	return angle;
 }
-static bool lighthouse_sensor_angle(SurviveDriverSimulator *driver, int lh, size_t idx, SurviveAngleReading ang) {
+static bool lighthouse_sensor_angle(SurviveDriverSimulator *driver, SurviveSimulatedObject *obj, int lh, size_t idx,
+									SurviveAngleReading ang) {
 	SurviveContext *ctx = driver->ctx;
+	SurviveObject *so = obj->so;
 	LinmathVec3d pt;
-	copy3d(pt, driver->so->sensor_locations + idx * 3);
+	copy3d(pt, so->sensor_locations + idx * 3);
 
-	SurvivePose imu2trackref = driver->so->imu2trackref;
+	SurvivePose imu2trackref = so->imu2trackref;
 	SurvivePose trackref2imu = InvertPoseRtn(&imu2trackref);
 
 	ApplyPoseToPoint(pt, &imu2trackref, pt);
@@ -144,7 +205,7 @@ static bool lighthouse_sensor_angle(SurviveDriverSimulator *driver, int lh, size
 
 	LinmathVec3d ptInWorld;
 	LinmathVec3d normalInWorld;
-	ApplyPoseToPoint(ptInWorld, &driver->position, pt);
+	ApplyPoseToPoint(ptInWorld, &obj->position, pt);
 	SurvivePose world2lh = InvertPoseRtn(&driver->bsd[lh].Pose);
 	LinmathPoint3d ptInLh;
 	ApplyPoseToPoint(ptInLh, &world2lh, ptInWorld);
@@ -154,13 +215,13 @@ static bool lighthouse_sensor_angle(SurviveDriverSimulator *driver, int lh, size
 		normalize3d(dirLh, ptInLh);
 		scale3d(dirLh, dirLh, -1);
 
-		quatrotatevector(normalInWorld, driver->position.Rot, driver->so->sensor_normals + idx * 3);
+		quatrotatevector(normalInWorld, obj->position.Rot, so->sensor_normals + idx * 3);
 
 		LinmathVec3d normalInLh;
 		quatrotatevector(normalInLh, world2lh.Rot, normalInWorld);
 
 		FLT facingness = dot3d(normalInLh, dirLh);
-		if (facingness > 0 && linmath_rand(0, 1.) > driver->sensor_droprate * driver->noise_scale) {
+		if (facingness > 0 && simulator_rand(driver, 0, 1.) > driver->sensor_droprate * driver->noise_scale) {
 			if (driver->lh_version == 0) {
 				survive_reproject_xy(driver->bsd[lh].fcal, ptInLh, ang);
 				for (int i = 0; i < 2; i++) {
@@ -174,7 +235,7 @@ static bool lighthouse_sensor_angle(SurviveDriverSimulator *driver, int lh, size
 			}
 
 			for (int i = 0; i < 2; i++) {
-				ang[i] += linmath_normrand(0, driver->sensor_var * driver->noise_scale);
+				ang[i] += simulator_normrand(driver, 0, driver->sensor_var * driver->noise_scale);
 			}
 			return true;
 		}
@@ -182,40 +243,42 @@ static bool lighthouse_sensor_angle(SurviveDriverSimulator *driver, int lh, size
 	return false;
 }
 
-struct lh_event {
-	FLT time;
-	uint8_t lh;
-	int idx;
-};
-
 static int event_compare(const void *p, const void *q) {
 	const struct lh_event *x = (const struct lh_event *)p;
 	const struct lh_event *y = (const struct lh_event *)q;
 
-	return x->time > y->time;
+	return (x->time > y->time) - (x->time < y->time);
 }
-static size_t run_lighthouse_v2(SurviveDriverSimulator *driver, int lh, FLT timestamp, struct lh_event *events) {
-	SurviveContext *ctx = driver->ctx;
+
+/*
+ * Events lighthouse 'lh' causes on the object in (from, to]. The sweep over a given angle is either in the current
+ * rotation or, if the step started before this rotation, in the previous one; checking both keeps the event rate exact
+ * whatever the phase of the step is.
+ */
+static size_t run_lighthouse_v2(SurviveDriverSimulator *driver, SurviveSimulatedObject *obj, int lh, FLT from, FLT to,
+								struct lh_event *events) {
 	SurviveDriverSimulatorLHState *lhs = &driver->lhstates[lh];
 
 	size_t evt_idx = 0;
 
-	FLT sync_time = lighthouse_sync_time(driver, lh, timestamp);
+	FLT sync_time = lighthouse_sync_time(driver, lh, to);
 
-	if (sync_time >= lhs->last_eval_time && sync_time <= timestamp) {
-		// fprintf(stderr, "Sync %d %f %f\n", lh, sync_time, timestamp);
+	if (sync_time > from) {
 		events[evt_idx].time = sync_time;
 		events[evt_idx].lh = lh;
 		events[evt_idx++].idx = -1;
 	}
 
-	for (size_t idx = 0; idx < driver->so->sensor_ct; idx++) {
+	for (size_t idx = 0; idx < obj->so->sensor_ct; idx++) {
 		SurviveAngleReading ang;
 
-		if (lighthouse_sensor_angle(driver, lh, idx, ang)) {
+		if (lighthouse_sensor_angle(driver, obj, lh, idx, ang)) {
 			for (int axis = 0; axis < 2; axis++) {
-				FLT angle_time = lighthouse_lasttime_of_angle(driver, lh, timestamp, ang[axis]);
-				if (angle_time >= lhs->last_eval_time && angle_time <= timestamp) {
+				FLT angle_time = sync_time + ang[axis] / (2 * LINMATHPI) * lhs->period_s;
+				if (angle_time > to) {
+					angle_time -= lhs->period_s;
+				}
+				if (angle_time > from && angle_time <= to) {
 					events[evt_idx].time = angle_time;
 					events[evt_idx].lh = lh;
 					events[evt_idx++].idx = idx;
@@ -224,8 +287,6 @@ static size_t run_lighthouse_v2(SurviveDriverSimulator *driver, int lh, FLT time
 		}
 	}
 
-	lhs->last_eval_time = timestamp;
-
 	return evt_idx;
 }
 static void run_lighthouse_v1(SurviveDriverSimulator *driver, int lh, FLT timestamp) {
@@ -234,74 +295,113 @@ static void run_lighthouse_v1(SurviveDriverSimulator *driver, int lh, FLT timest
 
 	if (lh >= ctx->activeLighthouses || driver->bsd[lh].PositionSet == false) {
 		driver->acode = (driver->acode + 1) % 4;
-	} else {
-		for (int idx = 0; idx < driver->so->sensor_ct; idx++) {
+		return;
+	}
+
+	for (size_t i = 0; i < driver->obj_cnt; i++) {
+		SurviveSimulatedObject *obj = &driver->objs[i];
+		SurviveObject *so = obj->so;
+
+		for (int idx = 0; idx < so->sensor_ct; idx++) {
 			SurviveAngleReading ang = {0};
-			if (lighthouse_sensor_angle(driver, lh, idx, ang)) {
+			if (lighthouse_sensor_angle(driver, obj, lh, idx, ang)) {
 				if (driver->lh_version == 0) {
 					int acode = (lh << 2) + (driver->acode & 1);
-					SURVIVE_INVOKE_HOOK_SO(angle, driver->so, idx, acode, timecode, .006, ang[driver->acode & 1], lh);
+					SURVIVE_INVOKE_HOOK_SO(angle, so, idx, acode, timecode, .006, ang[driver->acode & 1], lh);
 				} else {
-					SURVIVE_INVOKE_HOOK_SO(sweep_angle, driver->so, driver->bsd[lh].mode, idx, timecode,
-										   driver->acode & 1, ang[driver->acode & 1]);
+					SURVIVE_INVOKE_HOOK_SO(sweep_angle, so, driver->bsd[lh].mode, idx, timecode, driver->acode & 1,
+										   ang[driver->acode & 1]);
 				}
+				driver->sweep_event_cnt++;
 			}
 		}
 
 		if (driver->lh_version == 0) {
 			int acode = (lh << 2) + (driver->acode & 1);
-			SURVIVE_INVOKE_HOOK_SO(light, driver->so, -3, acode, 0, timecode, 100, lh);
-			driver->acode = (driver->acode + 1) % 4;
+			SURVIVE_INVOKE_HOOK_SO(light, so, -3, acode, 0, timecode, 100, lh);
 		} else {
-			SURVIVE_INVOKE_HOOK_SO(sync, driver->so, driver->bsd[lh].mode, timecode, false, false);
-			driver->acode = (driver->acode + 1) % 4;
+			SURVIVE_INVOKE_HOOK_SO(sync, so, driver->bsd[lh].mode, timecode, false, false);
 		}
+		driver->sync_event_cnt++;
 	}
+	driver->acode = (driver->acode + 1) % 4;
 }
 
-static bool run_imu(struct SurviveContext *ctx, SurviveDriverSimulator *driver, double timestamp,
-					double time_between_imu, survive_long_timecode timecode) {
-	bool update_gt = false;
-	if (timestamp > time_between_imu + driver->time_last_imu) {
-		update_gt = true;
+// Emits every IMU sample due by 'timestamp', at the object's own IMU rate
+static void run_imu(struct SurviveContext *ctx, SurviveDriverSimulator *driver, SurviveSimulatedObject *obj,
+					double timestamp) {
+	FLT time_between_imu = 1. / obj->so->imu_freq;
+
+	for (; obj->time_next_imu <= timestamp; obj->time_next_imu += time_between_imu) {
+		survive_long_timecode timecode = (survive_long_timecode)round(obj->time_next_imu * 48000000.);
+
 		// ( SurviveObject * so, int mask, FLT * accelgyro, survive_timecode timecode, int id );
 		FLT accelgyro[9] = {0, 0, 0,  // Acc
 							0, 0, 0,  // Gyro
 							0, 0, 0}; // Mag
 
-		add3d(accelgyro, accelgyro, driver->accel.Pos);
+		add3d(accelgyro, accelgyro, obj->accel.Pos);
 		scale3d(accelgyro, accelgyro, 1. / 9.80665);
 
 		SV_VERBOSE(200, "(Gt)Acc\t\t" Point3_format "\t%f", LINMATH_VEC3_EXPAND(accelgyro), norm3d(accelgyro));
 		accelgyro[2] += 1;
 
-		SurvivePose ip = InvertPoseRtn(&driver->position);
 		LinmathQuat q;
-		quatgetconjugate(q, driver->position.Rot);
+		quatgetconjugate(q, obj->position.Rot);
 		quatrotatevector(accelgyro, q, accelgyro);
-		quatrotatevector(accelgyro + 3, q, driver->velocity.AxisAngleRot);
-		add3d(accelgyro + 3, accelgyro + 3, driver->gyro_bias);
+		quatrotatevector(accelgyro + 3, q, obj->velocity.AxisAngleRot);
+		add3d(accelgyro + 3, accelgyro + 3, obj->gyro_bias);
 
 		for (int i = 0; i < 3; i++) {
-			accelgyro[i] += linmath_normrand(0, driver->acc_var * driver->noise_scale);
-			accelgyro[i + 3] += linmath_normrand(0, driver->gyro_var * driver->noise_scale);
+			accelgyro[i] += simulator_normrand(driver, 0, driver->acc_var * driver->noise_scale);
+			accelgyro[i + 3] += simulator_normrand(driver, 0, driver->gyro_var * driver->noise_scale);
 		}
 
-		SV_VERBOSE(200, "Ang: " Point3_format, LINMATH_VEC3_EXPAND(driver->velocity.AxisAngleRot));
-		SV_VERBOSE(200, "GT: " SurvivePose_format " %f", SURVIVE_POSE_EXPAND(driver->position),
-				   quatmagnitude(driver->position.Rot));
+		SV_VERBOSE(200, "Ang: " Point3_format, LINMATH_VEC3_EXPAND(obj->velocity.AxisAngleRot));
+		SV_VERBOSE(200, "GT: " SurvivePose_format " %f", SURVIVE_POSE_EXPAND(obj->position),
+				   quatmagnitude(obj->position.Rot));
 		if (driver->show_gt_device_cfg != 2) {
-			SURVIVE_INVOKE_HOOK_SO(imu, driver->so, 3, accelgyro, timecode, 0);
+			SURVIVE_INVOKE_HOOK_SO(imu, obj->so, 3, accelgyro, timecode, 0);
+			driver->imu_event_cnt++;
 		}
 
 		for (int i = 0; i < 3; i++) {
-			driver->gyro_bias[i] += linmath_normrand(0, driver->gyro_bias_scale * driver->noise_scale) * .001;
+			obj->gyro_bias[i] += simulator_normrand(driver, 0, driver->gyro_bias_scale * driver->noise_scale) * .001;
+		}
+	}
+}
+
+static void run_light_v2(SurviveDriverSimulator *driver, SurviveSimulatedObject *obj, FLT from, FLT to) {
+	SurviveContext *ctx = driver->ctx;
+	struct lh_event *events = driver->events;
+	size_t evt_idx = 0;
+	for (int i = 0; i < ctx->activeLighthouses; i++) {
+		evt_idx += run_lighthouse_v2(driver, obj, i, from, to, events + evt_idx);
+	}
+
+	qsort(events, evt_idx, sizeof *events, event_compare);
+
+	for (size_t i = 0; i < evt_idx; i++) {
+		// IMU samples from earlier in the step go out first, so the object's events stay in time order
+		run_imu(ctx, driver, obj, events[i].time);
+
+		survive_timecode timecode = (survive_timecode)round(events[i].time * 48000000.);
+		uint8_t lh = events[i].lh;
+		if (events[i].idx == -1) {
+			SURVIVE_INVOKE_HOOK_SO(sync, obj->so, driver->bsd[lh].mode, timecode, 0, 0);
+			driver->sync_event_cnt++;
+		} else {
+			SURVIVE_INVOKE_HOOK_SO(sweep, obj->so, driver->bsd[lh].mode, events[i].idx, timecode, 0);
+			driver->sweep_event_cnt++;
 		}
-		driver->time_last_imu = timestamp - 1e-10;
 	}
-	return update_gt;
 }
-bool run_light(const struct SurviveContext *ctx, SurviveDriverSimulator *driver, double timestamp,
+
+/*
+ * Emits the light due by 'timestamp' along with the IMU samples that come before each event; whatever IMU is left in
+ * the step follows in Simulator_poll.
+ */
+bool run_light(struct SurviveContext *ctx, SurviveDriverSimulator *driver, double timestamp,
 			   double time_between_pulses) {
 	bool update_gt = false;
 	if (driver->show_gt_device_cfg == 2) {
@@ -309,67 +409,62 @@ bool run_light(const struct SurviveContext *ctx, SurviveDriverSimulator *driver,
 	}
 
 	if (driver->lh_version == 0) {
-		if (timestamp > time_between_pulses + driver->time_last_light) {
+		for (; driver->time_next_light <= timestamp; driver->time_next_light += time_between_pulses) {
 			update_gt = true;
 			int lh = driver->acode >> 1;
 
-			run_lighthouse_v1(driver, lh, timestamp);
-			driver->time_last_light = timestamp;
+			for (size_t i = 0; i < driver->obj_cnt; i++) {
+				run_imu(ctx, driver, &driver->objs[i], driver->time_next_light);
+			}
+			run_lighthouse_v1(driver, lh, driver->time_next_light);
 		}
 	} else {
-		struct lh_event events[NUM_GEN2_LIGHTHOUSES * (SENSORS_PER_OBJECT + 1)];
-		size_t evt_idx = 0;
-		for (int i = 0; i < ctx->activeLighthouses; i++) {
-			evt_idx += run_lighthouse_v2(driver, i, timestamp, events + evt_idx);
-		}
-
-		qsort(events, evt_idx, sizeof *events, event_compare);
-
-		for (size_t i = 0; i < evt_idx; i++) {
-			survive_timecode timecode = (survive_timecode)round(events[i].time * 48000000.);
-			uint8_t lh = events[i].lh;
-			if (events[i].idx == -1) {
-				SURVIVE_INVOKE_HOOK_SO(sync, driver->so, driver->bsd[lh].mode, timecode, 0, 0);
-			} else {
-				SURVIVE_INVOKE_HOOK_SO(sweep, driver->so, driver->bsd[lh].mode, events[i].idx, timecode, 0);
-			}
+		for (size_t i = 0; i < driver->obj_cnt; i++) {
+			run_light_v2(driver, &driver->objs[i], driver->time_last_light, timestamp);
 		}
+		driver->time_last_light = timestamp;
 	}
 	return update_gt;
 }
-static void propagate_state(SurviveDriverSimulator *driver, double time_diff) {
+static void propagate_state(SurviveSimulatedObject *obj, double time_diff) {
 	SurviveVelocity velGain;
-	scale3d(velGain.Pos, driver->accel.Pos, time_diff);
-	scale3d(velGain.AxisAngleRot, driver->accel.AxisAngleRot, time_diff);
+	scale3d(velGain.Pos, obj->accel.Pos, time_diff);
+	scale3d(velGain.AxisAngleRot, obj->accel.AxisAngleRot, time_diff);
 
-	add3d(driver->velocity.Pos, driver->velocity.Pos, velGain.Pos);
-	add3d(driver->velocity.AxisAngleRot, velGain.AxisAngleRot, driver->velocity.AxisAngleRot);
+	add3d(obj->velocity.Pos, obj->velocity.Pos, velGain.Pos);
+	add3d(obj->velocity.AxisAngleRot, velGain.AxisAngleRot, obj->velocity.AxisAngleRot);
 
 	SurviveVelocity posGain;
-	scale3d(posGain.Pos, driver->velocity.Pos, time_diff);
-	add3d(driver->position.Pos, driver->position.Pos, posGain.Pos);
+	scale3d(posGain.Pos, obj->velocity.Pos, time_diff);
+	add3d(obj->position.Pos, obj->position.Pos, posGain.Pos);
 
-	survive_apply_ang_velocity(driver->position.Rot, driver->velocity.AxisAngleRot, time_diff, driver->position.Rot);
+	survive_apply_ang_velocity(obj->position.Rot, obj->velocity.AxisAngleRot, time_diff, obj->position.Rot);
 }
-static void update_gt_device(struct SurviveContext *ctx, const SurviveDriverSimulator *driver) {
+static void update_gt_device(struct SurviveContext *ctx, const SurviveDriverSimulator *driver,
+							 const SurviveSimulatedObject *obj) {
 	if (driver->show_gt_device_cfg == 0)
 		return;
 
-	SurvivePose head2world = driver->position;
+	SurvivePose head2world = obj->position;
 	if (!driver->settings.report_in_imu) {
-		ApplyPoseToPose(&head2world, &driver->position, &driver->so->head2imu);
+		ApplyPoseToPose(&head2world, &obj->position, &obj->so->head2imu);
+	}
+
+	// The first object keeps the name it had before there could be several
+	char name[32] = "Sim_GT";
+	if (obj != driver->objs) {
+		snprintf(name, sizeof(name), "Sim_GT_%s", obj->so->codename);
 	}
 
-	survive_default_external_pose_process(ctx, "Sim_GT", &head2world);
-	survive_default_external_velocity_process(ctx, "Sim_GT", &driver->velocity);
-	survive_recording_write_to_output(ctx->recptr, "%s FULL_STATE " Point16_format "\n", "Sim_GT",
-									  SURVIVE_POSE_EXPAND(head2world), SURVIVE_VELOCITY_EXPAND(driver->velocity),
-									  LINMATH_VEC3_EXPAND(&driver->accel.Pos[0]));
+	survive_default_external_pose_process(ctx, name, &head2world);
+	survive_default_external_velocity_process(ctx, name, &obj->velocity);
+	survive_recording_write_to_output(ctx->recptr, "%s FULL_STATE " Point16_format "\n", name,
+									  SURVIVE_POSE_EXPAND(head2world), SURVIVE_VELOCITY_EXPAND(obj->velocity),
+									  LINMATH_VEC3_EXPAND(&obj->accel.Pos[0]));
 }
-void apply_attractors(struct SurviveContext *ctx, SurviveDriverSimulator *driver) {
+void apply_attractors(struct SurviveContext *ctx, SurviveDriverSimulator *driver, SurviveSimulatedObject *obj) {
 	SurviveVelocity accel = {0};
 
-	FLT time_since_init = driver->current_timestamp - driver->init_time;
 	FLT s = 1.;
 
 	LinmathVec3d attractors[] = {{1, 1, 1}, {-1, 0, 1}, {0, -1, .5}};
@@ -379,102 +474,109 @@ void apply_attractors(struct SurviveContext *ctx, SurviveDriverSimulator *driver
 		attractor_cnt = sizeof(attractors) / sizeof(LinmathVec3d);
 	}
 
-	static bool reported = false;
-
 	for (int i = 0; i < attractor_cnt; i++) {
+		LinmathVec3d attractor;
+		add3d(attractor, attractors[i], obj->attractor_offset);
+
 		LinmathVec3d acc;
-		sub3d(acc, attractors[i], driver->position.Pos);
+		sub3d(acc, attractor, obj->position.Pos);
 		FLT r = norm3d(acc);
 		scale3d(acc, acc, s / r / r);
 		if (r < .1) {
 			scale3d(acc, acc, -1);
 		}
 		add3d(accel.Pos, accel.Pos, acc);
-		if (reported == false && ctx->recptr) {
+		if (driver->reported_attractors == false && ctx->recptr) {
 			survive_recording_write_to_output(ctx->recptr, "SPHERE attractor_%d %f %d " Point3_format "\n", i, .05,
 											  0x00FF00, LINMATH_VEC3_EXPAND(attractors[i]));
 		}
 	}
-	reported = true;
-
-	if (attractor_cnt == 0) {
-		// accel.Pos[0] = 1 * cos(timestamp);
-	}
-
-	for (int i = 0; i < 3; i++) {
-		// accel.AxisAngleRot[i] += (((rand() / (FLT)RAND_MAX) - .5) * 10);
-		// accel.AxisAngleRot[i] = cos(timestamp);
-	}
+	driver->reported_attractors = true;
 
-	memcpy(&driver->accel, &accel, sizeof(accel));
+	memcpy(&obj->accel, &accel, sizeof(accel));
 }
-static void apply_initial_position(SurviveDriverSimulator *driver) {
+static void apply_initial_position(SurviveDriverSimulator *driver, SurviveSimulatedObject *obj) {
 	FLT up[] = {0, 0, 1};
 	FLT ones[] = {1, -1, 1};
-	quatfrom2vectors(driver->position.Rot, up, ones);
-	for (int i = 0; i < 3; i++)
-		driver->position.Pos[i] = 0;
-}
+	quatfrom2vectors(obj->position.Rot, up, ones);
 
-static void apply_initial_velocity(SurviveDriverSimulator *sp) {
-	SurviveContext *ctx = sp->ctx;
+	// The first object starts where a lone simulated object always did; the rest are scattered around it
+	if (obj != driver->objs) {
+		for (int i = 0; i < 3; i++)
+			obj->attractor_offset[i] = simulator_rand(driver, -.5, .5);
+	}
+	copy3d(obj->position.Pos, obj->attractor_offset);
+}
 
+static void apply_initial_velocity(SurviveDriverSimulator *sp, SurviveSimulatedObject *obj) {
 	int attractor_cnt = sp->settings.attractors;
 	if (attractor_cnt >= 0) {
-		sp->velocity.AxisAngleRot[0] = sp->velocity.AxisAngleRot[1] = sp->velocity.AxisAngleRot[2] = 1.;
+		obj->velocity.AxisAngleRot[0] = obj->velocity.AxisAngleRot[1] = obj->velocity.AxisAngleRot[2] = 1.;
+		if (obj != sp->objs) {
+			for (int i = 0; i < 3; i++)
+				obj->velocity.AxisAngleRot[i] = simulator_rand(sp, -1, 1);
+		}
 	}
 
 	if (attractor_cnt == 1) {
 		for (int i = 0; i < 3; i++)
-			sp->velocity.Pos[i] = 2. * rand() / RAND_MAX - 1;
+			obj->velocity.Pos[i] = simulator_rand(sp, -1, 1);
 	}
 }
 
 static int Simulator_poll(struct SurviveContext *ctx, void *_driver) {
 	SurviveDriverSimulator *driver = _driver;
-	static FLT last_time = 0;
-	FLT realtime = timestamp_in_s();
-
-	FLT timefactor = driver->settings.time_factor;
 	FLT timestep = .01;
 
-	while (last_time != 0 && last_time + timefactor * timestep > realtime) {
-		survive_release_ctx_lock(ctx);
-		OGUSleep((timefactor * timestep + realtime - last_time) * 1e6);
-		survive_get_ctx_lock(ctx);
-		realtime = timestamp_in_s();
+	if (driver->realtime_start == 0) {
+		driver->realtime_start = OGGetAbsoluteTime();
+	}
+	FLT realtime = OGGetAbsoluteTime() - driver->realtime_start;
+
+	// Hold simulated time to 'speed' times real time; when the hooks can't keep up it just runs behind
+	FLT speed = driver->settings.speed;
+	if (speed > 0) {
+		FLT due = (driver->current_timestamp + timestep) / speed;
+		while (due > realtime) {
+			survive_release_ctx_lock(ctx);
+			OGUSleep((due - realtime) * 1e6);
+			survive_get_ctx_lock(ctx);
+			realtime = OGGetAbsoluteTime() - driver->realtime_start;
+		}
 	}
-	last_time = realtime;
 
 	bool wasIniting = driver->current_timestamp < driver->init_time;
 	FLT timestamp = (driver->current_timestamp += timestep);
-	FLT time_between_imu = 1. / driver->so->imu_freq;
 	FLT time_between_pulses = 0.00833333333;
-	FLT time_between_gt = time_between_imu;
 	bool isIniting = timestamp < driver->init_time || driver->init_time < 0;
 
-	bool update_gt = false;
+	for (size_t i = 0; i < driver->obj_cnt; i++) {
+		SurviveSimulatedObject *obj = &driver->objs[i];
 
-	FLT t = (timestamp - driver->timestart);
-
-	if (wasIniting == true && isIniting == false) {
-		apply_initial_velocity(driver);
-	}
+		if (wasIniting == true && isIniting == false) {
+			apply_initial_velocity(driver, obj);
+		}
 
-	if (isIniting == false) {
-		apply_attractors(ctx, driver);
-		for (int i = 0; i < 3; i++) {
-			driver->accel.AxisAngleRot[i] += linmath_rand(-1e-1, 1e-1);
+		if (isIniting == false) {
+			apply_attractors(ctx, driver, obj);
+			for (int i = 0; i < 3; i++) {
+				obj->accel.AxisAngleRot[i] += simulator_rand(driver, -1e-1, 1e-1);
+			}
 		}
 	}
 
-	survive_long_timecode timecode = (survive_long_timecode)round(timestamp * 48000000.);
-
-	update_gt |= run_imu(ctx, driver, timestamp, time_between_imu, timecode);
-	update_gt |= run_light(ctx, driver, timestamp, time_between_pulses);
+	bool imu_due[SIMULATOR_MAX_OBJECTS];
+	for (size_t i = 0; i < driver->obj_cnt; i++) {
+		imu_due[i] = driver->objs[i].time_next_imu <= timestamp;
+	}
 
-	if (update_gt) {
-		update_gt_device(ctx, driver);
+	bool update_gt = run_light(ctx, driver, timestamp, time_between_pulses);
+	for (size_t i = 0; i < driver->obj_cnt; i++) {
+		SurviveSimulatedObject *obj = &driver->objs[i];
+		run_imu(ctx, driver, obj, timestamp);
+		if (imu_due[i] || update_gt) {
+			update_gt_device(ctx, driver, obj);
+		}
 	}
 
 	if (driver->time_last_iterate == 0) {
@@ -483,10 +585,11 @@ static int Simulator_poll(struct SurviveContext *ctx, void *_driver) {
 		return 0;
 	}
 	FLT time_diff = timestamp - driver->time_last_iterate;
-	// SV_INFO("%.013f", time_diff);
 	driver->time_last_iterate = timestamp;
 
-	propagate_state(driver, time_diff);
+	for (size_t i = 0; i < driver->obj_cnt; i++) {
+		propagate_state(&driver->objs[i], time_diff);
+	}
 
 	FLT time = driver->settings.runtime;
 	if (timestamp - driver->timestart > time && time > 0) {
@@ -520,6 +623,38 @@ const BaseStationData simulated_bsd[5] = {
 	 .OOTXSet = 1},
 	{.PositionSet = 1, .BaseStationID = 1, .Pose = {.Pos = {0, 0, 6}, .Rot = {1, 0, 0, 0}}, .mode = 4, .OOTXSet = 1},
 };
+#define SIMULATED_BSD_CNT ((int)(sizeof(simulated_bsd) / sizeof(simulated_bsd[0])))
+
+/*
+ * Lighthouse 'lh' of 'lh_cnt'. Unless a lighthouse count was configured the builtin layout is used as far as it goes;
+ * otherwise they sit evenly spaced on a ring around the origin, each looking at it.
+ */
+static BaseStationData simulated_lighthouse(const SurviveDriverSimulator *driver, int lh, int lh_cnt) {
+	if (driver->settings.lh_cnt == 0 && lh < SIMULATED_BSD_CNT) {
+		return simulated_bsd[lh];
+	}
+
+	BaseStationData bsd = {.PositionSet = 1, .BaseStationID = lh, .mode = lh, .OOTXSet = 1};
+	FLT angle = 2. * LINMATHPI * lh / lh_cnt;
+	bsd.Pose.Pos[0] = driver->settings.lh_radius * cos(angle);
+	bsd.Pose.Pos[1] = driver->settings.lh_radius * sin(angle);
+	bsd.Pose.Pos[2] = driver->settings.lh_height;
+
+	// Lighthouses look down their -z axis
+	LinmathVec3d forward = {0, 0, -1}, to_origin;
+	scale3d(to_origin, bsd.Pose.Pos, -1);
+	quatfrom2vectors(bsd.Pose.Rot, forward, to_origin);
+	return bsd;
+}
+
+static SurviveSimulatedObject *simulated_object(SurviveDriverSimulator *driver, const SurviveObject *so) {
+	for (size_t i = 0; i < driver->obj_cnt; i++) {
+		if (driver->objs[i].so == so) {
+			return &driver->objs[i];
+		}
+	}
+	return 0;
+}
 
 static void simulation_lh_compare(SurviveContext *ctx, uint8_t lighthouse, const SurvivePose *lighthouse_pose) {
 	const SurviveDriverSimulator *driver = survive_get_driver(ctx, Simulator_poll);
@@ -538,26 +673,29 @@ static void simulation_compare(SurviveObject *so, survive_long_timecode timecode
 		return;
 	}
 	SurviveContext *ctx = so->ctx;
-	SurviveDriverSimulator *driver = so->driver;
+	SurviveSimulatedObject *obj = simulated_object(so->driver, so);
+	if (obj == 0) {
+		return;
+	}
 
-	SurvivePose p = InvertPoseRtn(&driver->position);
+	SurvivePose p = InvertPoseRtn(&obj->position);
 	ApplyPoseToPose(&p, &p, &so->OutPoseIMU);
 
 	FLT error[7] = {0};
 	FLT verror[6] = {0};
 	FLT aerror[3] = {0};
-	subnd(error, driver->position.Pos, so->OutPoseIMU.Pos, 3);
+	subnd(error, obj->position.Pos, so->OutPoseIMU.Pos, 3);
 
 	for (int i = 0; i < 4; i++)
-		error[i + 3] = driver->position.Rot[i] * (driver->position.Rot[0] > 0 ? 1 : -1) -
+		error[i + 3] = obj->position.Rot[i] * (obj->position.Rot[0] > 0 ? 1 : -1) -
 					   so->OutPoseIMU.Rot[i] * (so->OutPoseIMU.Rot[0] > 0 ? 1 : -1);
 
-	subnd(verror, driver->velocity.Pos, so->velocity.Pos, 6);
-	subnd(aerror, driver->accel.Pos, so->acceleration, 3);
-	variance_measure_add(&driver->pose_variance, error);
+	subnd(verror, obj->velocity.Pos, so->velocity.Pos, 6);
+	subnd(aerror, obj->accel.Pos, so->acceleration, 3);
+	variance_measure_add(&obj->pose_variance, error);
 
 	FLT var[7];
-	variance_measure_calc(&driver->pose_variance, var);
+	variance_measure_calc(&obj->pose_variance, var);
 	SV_VERBOSE(110, "\tSimulation pose error     " Point7_format, LINMATH_VEC7_EXPAND(var));
 	SV_VERBOSE(110, "\tSimulation velocity error " Point6_format, LINMATH_VEC6_EXPAND(verror));
 	SV_VERBOSE(110, "\tSimulation acc error      " Point3_format, LINMATH_VEC3_EXPAND(aerror));
@@ -567,10 +705,10 @@ static void simulation_compare(SurviveObject *so, survive_long_timecode timecode
 		SV_VERBOSE(200, "Simulation diff:\t%+f\t%+f\t" SurvivePose_format, norm3d(p.Pos), norm3d(p.Rot + 1),
 				   SURVIVE_POSE_EXPAND(p));
 
-		SV_VERBOSE(200, "Simulation position " SurvivePose_format "\t", SURVIVE_POSE_EXPAND(driver->position));
-		SV_VERBOSE(200, "Simulation velocity " SurviveVel_format "\t", SURVIVE_VELOCITY_EXPAND(driver->velocity));
-		SV_VERBOSE(200, "Simulation acceleration " Point3_format "\t", LINMATH_VEC3_EXPAND(driver->accel.Pos));
-		SV_VERBOSE(200, "Simulation bias         " Point3_format "\t", LINMATH_VEC3_EXPAND(driver->gyro_bias));
+		SV_VERBOSE(200, "Simulation position " SurvivePose_format "\t", SURVIVE_POSE_EXPAND(obj->position));
+		SV_VERBOSE(200, "Simulation velocity " SurviveVel_format "\t", SURVIVE_VELOCITY_EXPAND(obj->velocity));
+		SV_VERBOSE(200, "Simulation acceleration " Point3_format "\t", LINMATH_VEC3_EXPAND(obj->accel.Pos));
+		SV_VERBOSE(200, "Simulation bias         " Point3_format "\t", LINMATH_VEC3_EXPAND(obj->gyro_bias));
 
 		SV_VERBOSE(200, "Object     position " SurvivePose_format "\t", SURVIVE_POSE_EXPAND(so->OutPoseIMU));
 		SV_VERBOSE(200, "Object     velocity " SurviveVel_format "\t", SURVIVE_VELOCITY_EXPAND(so->velocity));
@@ -583,26 +721,39 @@ static void simulation_compare(SurviveObject *so, survive_long_timecode timecode
 static int simulator_close(struct SurviveContext *ctx, void *_driver) {
 	SurviveDriverSimulator *driver = _driver;
 
-	FLT var[7];
-	variance_measure_calc(&driver->pose_variance, var);
 	SV_VERBOSE(5, "Simulation info");
-	SV_VERBOSE(5, "\tError         " Point7_format, LINMATH_VEC7_EXPAND(var));
-	SV_VERBOSE(5, "\tTracker bias  " Point3_format, LINMATH_VEC3_EXPAND(driver->gyro_bias));
+	for (size_t i = 0; i < driver->obj_cnt; i++) {
+		SurviveSimulatedObject *obj = &driver->objs[i];
+		FLT var[7];
+		variance_measure_calc(&obj->pose_variance, var);
+		SV_VERBOSE(5, "\t%s Error         " Point7_format, obj->so->codename, LINMATH_VEC7_EXPAND(var));
+		SV_VERBOSE(5, "\t%s Tracker bias  " Point3_format, obj->so->codename, LINMATH_VEC3_EXPAND(obj->gyro_bias));
+	}
+
+	FLT simulated = driver->current_timestamp;
+	FLT realtime = driver->realtime_start > 0 ? OGGetAbsoluteTime() - driver->realtime_start : 0;
+	if (simulated > 0 && realtime > 0) {
+		SV_VERBOSE(5, "\tSimulated %f seconds in %f (%fx real time)", simulated, realtime, simulated / realtime);
+		SV_VERBOSE(5, "\tEvents/s      imu %f sync %f sweep %f", driver->imu_event_cnt / simulated,
+				   driver->sync_event_cnt / simulated, driver->sweep_event_cnt / simulated);
+	}
 
 	SurviveDriverSimulator_detach_config(ctx, driver);
+	free(driver->events);
+	free(driver->objs);
 	free(driver);
 	return 0;
 }
 
-cstring generate_simulated_object(FLT r, size_t sensor_ct) {
+static cstring generate_simulated_object(SurviveDriverSimulator *driver, FLT r, size_t sensor_ct) {
 	cstring cfg = {0};
 	cstring loc = {0}, nor_buf = {0};
 
 	char buffer[1024] = {0};
 
 	for (int i = 0; i < sensor_ct; i++) {
-		FLT azi = rand();
-		FLT pol = rand();
+		FLT azi = simulator_rand(driver, 0, 2 * LINMATHPI);
+		FLT pol = simulator_rand(driver, 0, LINMATHPI);
 		LinmathVec3d normals, locations;
 		normals[0] = locations[0] = r * cos(azi) * sin(pol);
 		normals[1] = locations[1] = r * sin(azi) * sin(pol);
@@ -659,6 +810,9 @@ cstring generate_simulated_object(FLT r, size_t sensor_ct) {
 SURVIVE_EXPORT SurviveObject *survive_create_simulation_device(SurviveContext *ctx, SurviveDriverSimulator *driver,
 															   const char *device_name) {
 	SurviveObject *device = survive_create_device(ctx, "SIM", driver, device_name, 0);
+	if (device == 0) {
+		return 0;
+	}
 	device->sensor_ct = driver->settings.obj_sensors;
 
 	device->head2imu.Rot[0] = 1;
@@ -667,7 +821,7 @@ SURVIVE_EXPORT SurviveObject *survive_create_simulation_device(SurviveContext *c
 
 	FLT r = driver->settings.obj_radius;
 
-	cstring cfg = generate_simulated_object(r, device->sensor_ct);
+	cstring cfg = generate_simulated_object(driver, r, device->sensor_ct);
 
 	SURVIVE_INVOKE_HOOK_SO(config, device, cfg.d, strlen(cfg.d));
 	device->object_type = SURVIVE_OBJECT_TYPE_CONTROLLER;
@@ -683,24 +837,41 @@ int DriverRegSimulator(SurviveContext *ctx) {
 	sp->ctx = ctx;
 	ctx->poll_min_time_ms = 0;
 
-	apply_initial_position(sp);
-
 	SV_INFO("Setting up Simulator driver.");
 
 	SurviveDriverSimulator_attach_config(ctx, sp);
-	sp->settings.time_factor = linmath_max(survive_configf(ctx, "time-factor", SC_GET, 1.), .00001);
+	sp->rng_state = (uint64_t)sp->settings.seed;
 
-	sp->pose_variance.size = 7;
-
-	for (int i = 0; i < 3; i++)
-		sp->gyro_bias[i] = linmath_normrand(0, sp->gyro_bias_scale * sp->noise_scale);
 	sp->scale_error = .97; // linmath_normrand(1, .05);
 	int use_lh2 = sp->lh_version == 2;
-	int max_lighthouses = use_lh2 ? 16 : 2;
-	// Create a new SurviveObject...
-	SurviveObject *device = survive_create_simulation_device(ctx, sp, "SM0");
+	int max_lighthouses = use_lh2 ? NUM_GEN2_LIGHTHOUSES : 2;
+
+	int obj_cnt = sp->settings.obj_cnt;
+	if (obj_cnt < 1 || obj_cnt > SIMULATOR_MAX_OBJECTS) {
+		SV_WARN("Simulator supports between 1 and %d objects; %d requested", SIMULATOR_MAX_OBJECTS, obj_cnt);
+		obj_cnt = obj_cnt < 1 ? 1 : SIMULATOR_MAX_OBJECTS;
+	}
+	sp->objs = SV_CALLOC_N(obj_cnt, sizeof(SurviveSimulatedObject));
+	sp->events = SV_CALLOC_N(SIMULATOR_MAX_LH_EVENTS, sizeof(struct lh_event));
 
-	srand(42);
+	// Create the SurviveObjects; SM0-SM9, then S10-S99
+	for (int i = 0; i < obj_cnt; i++) {
+		char codename[4];
+		snprintf(codename, sizeof(codename), i < 10 ? "SM%d" : "S%02d", i);
+
+		SurviveObject *device = survive_create_simulation_device(ctx, sp, codename);
+		if (device == 0) {
+			continue;
+		}
+		snprintf(device->serial_number, sizeof(device->serial_number), "SIM-%04d", i);
+
+		SurviveSimulatedObject *obj = &sp->objs[sp->obj_cnt++];
+		obj->so = device;
+		obj->pose_variance.size = 7;
+		apply_initial_position(sp, obj);
+		for (int j = 0; j < 3; j++)
+			obj->gyro_bias[j] = simulator_normrand(sp, 0, sp->gyro_bias_scale * sp->noise_scale);
+	}
 
 	FLT freq_per_channel[NUM_GEN2_LIGHTHOUSES] = {
 		50.0521, 50.1567, 50.3673, 50.5796, 50.6864, 50.9014, 51.0096, 51.1182,
@@ -713,12 +884,12 @@ int DriverRegSimulator(SurviveContext *ctx) {
 	for (int i = 0; i < ctx->activeLighthouses; i++) {
 		sp->bsd[i] = ctx->bsd[i];
 		if (!ctx->bsd[i].PositionSet) {
-			sp->bsd[i].Pose = simulated_bsd[i].Pose;
+			sp->bsd[i].Pose = simulated_lighthouse(sp, i, ctx->activeLighthouses).Pose;
 		}
 
 		ctx->bsd_map[ctx->bsd[i].mode] = i;
 
-		sp->lhstates[i].start_time = (rand() / (FLT)RAND_MAX);
+		sp->lhstates[i].start_time = simulator_rand(sp, 0, 1);
 
 		assert(ctx->bsd[i].mode < NUM_GEN2_LIGHTHOUSES);
 
@@ -734,23 +905,28 @@ int DriverRegSimulator(SurviveContext *ctx) {
 								.ogeemag = .25};
 
 	if (ctx->activeLighthouses == 0) {
-		int lh_count = sizeof(simulated_bsd) / sizeof(simulated_bsd[0]);
+		int lh_count = sp->settings.lh_cnt > 0 ? sp->settings.lh_cnt : SIMULATED_BSD_CNT;
 		if (!use_lh2)
 			lh_count = 2;
+		if (lh_count > max_lighthouses) {
+			SV_WARN("Simulator supports at most %d lighthouses of this generation; %d requested", max_lighthouses,
+					lh_count);
+			lh_count = max_lighthouses;
+		}
 
 		for (int i = 0; i < lh_count; i++) {
-			ctx->bsd[i] = simulated_bsd[i];
+			ctx->bsd[i] = simulated_lighthouse(sp, i, lh_count);
 
 			for (int axis = 0; axis < 2; axis++) {
 				for (int cal_idx = 0; cal_idx < sizeof(fcalNoise) / sizeof(FLT); cal_idx++) {
 					((FLT *)(&ctx->bsd[i].fcal[axis]))[cal_idx] =
-						linmath_rand(-((FLT *)&fcalNoise)[cal_idx], ((FLT *)&fcalNoise)[cal_idx]);
+						simulator_rand(sp, -((FLT *)&fcalNoise)[cal_idx], ((FLT *)&fcalNoise)[cal_idx]);
 				}
 			}
 			ctx->activeLighthouses++;
 
 			ctx->bsd_map[ctx->bsd[i].mode] = i;
-			sp->lhstates[i].start_time = (rand() / (FLT)RAND_MAX);
+			sp->lhstates[i].start_time = simulator_rand(sp, 0, 1);
 			sp->lhstates[i].period_s = 1. / freq_per_channel[ctx->bsd[i].mode];
 
 			sp->bsd[i] = ctx->bsd[i];
@@ -762,7 +938,7 @@ int DriverRegSimulator(SurviveContext *ctx) {
 		for (int axis = 0; axis < 2; axis++) {
 			for (int cal_idx = 0; cal_idx < sizeof(fcalNoise) / sizeof(FLT); cal_idx++) {
 				((FLT *)(&ctx->bsd[i].fcal[axis]))[cal_idx] +=
-					fcal_noise * linmath_rand(-((FLT *)&fcalNoise)[cal_idx], ((FLT *)&fcalNoise)[cal_idx]);
+					fcal_noise * simulator_rand(sp, -((FLT *)&fcalNoise)[cal_idx], ((FLT *)&fcalNoise)[cal_idx]);
 			}
 		}
 	}
@@ -770,17 +946,21 @@ int DriverRegSimulator(SurviveContext *ctx) {
 	// ctx->bsd[0].Pose = sp->bsd[0].Pose;
 	// ctx->bsd[0].PositionSet = 1;
 
-	sp->so = device;
-	survive_add_object(ctx, device);
 	sp->lh_version = use_lh2 ? 1 : 0;
 	ctx->lh_version = sp->lh_version;
 	ctx->lh_version_configed = ctx->lh_version;
 
-	if (use_lh2) {
-		survive_notify_gen2(device, "Simulator setup for lh2");
-	} else {
-		survive_notify_gen1(device, "Simulator setup for lh1");
+	for (size_t i = 0; i < sp->obj_cnt; i++) {
+		SurviveObject *device = sp->objs[i].so;
+		survive_add_object(ctx, device);
+
+		if (use_lh2) {
+			survive_notify_gen2(device, "Simulator setup for lh2");
+		} else {
+			survive_notify_gen1(device, "Simulator setup for lh1");
+		}
 	}
+	SV_INFO("Simulating %d objects with %d lighthouses", (int)sp->obj_cnt, ctx->activeLighthouses);
 
 	sp->pose_fn = survive_install_imupose_fn(ctx, simulation_compare);
 	sp->lh_fn = survive_install_lighthouse_pose_fn(ctx, simulation_lh_compare);
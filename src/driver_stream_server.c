@@ -0,0 +1,572 @@
+// Streams poses, velocities and button events to TCP clients in the binary format of survive_stream.h. Replaces the
+// old tools/data_server: there is one epoll loop instead of a blocking thread per stream, every client gets its own
+// buffer and filter, and a client which stalls only loses its own messages.
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "driver_stream_server.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <os_generic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <survive_stream.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "survive_config.h"
+
+STATIC_CONFIG_ITEM(STREAM_SERVER_ENABLE, "streamserver", 'b', "Serve poses to TCP clients; see survive_stream.h", 0)
+STATIC_CONFIG_ITEM(STREAM_SERVER_PORT, "stream-server-port", 'i', "Port the stream server listens on",
+				   SURVIVE_STREAM_DEFAULT_PORT)
+STATIC_CONFIG_ITEM(STREAM_SERVER_ADDRESS, "stream-server-address", 's',
+				   "Address the stream server listens on; 0.0.0.0 for every interface", "127.0.0.1")
+STATIC_CONFIG_ITEM(STREAM_SERVER_BUFFER, "stream-server-buffer", 'i', "Bytes buffered for each stream server client",
+				   256 * 1024)
+
+#define STREAM_SERVER_MAX_EVENTS 32
+
+struct stream_client {
+	int fd;
+	bool want_write;
+
+	// Byte ring; head and tail only ever grow, capacity is a power of two
+	uint8_t *buffer;
+	size_t capacity;
+	uint64_t head, tail;
+
+	// Partial message read from the client
+	uint8_t input[sizeof(SurviveStreamSubscribe)];
+	size_t input_len;
+
+	uint32_t type_mask;
+	double min_period;
+	char objects[sizeof(((SurviveStreamSubscribe *)0)->objects)];
+	uint64_t announced[(SURVIVE_STREAM_MAX_OBJECTS + 63) / 64];
+	double last_sent[SURVIVE_STREAM_MAX_OBJECTS][SURVIVE_STREAM_STATS];
+
+	SurviveStreamStats stats;
+};
+
+struct survive_stream_server {
+	SurviveContext *ctx;
+	int listen_fd, epoll_fd, wake_fd;
+	int port;
+	size_t buffer_size;
+
+	og_thread_t thread;
+	bool keep_running;
+
+	// Guards the clients and the object table; publishers take it briefly to queue, the loop thread to flush
+	og_mutex_t lock;
+	struct stream_client **clients;
+	size_t clients_cnt;
+
+	SurviveStreamObject objects[SURVIVE_STREAM_MAX_OBJECTS];
+	size_t objects_cnt;
+
+	pose_process_func prior_pose_fn;
+	velocity_process_func prior_velocity_fn;
+	button_process_func prior_button_fn;
+};
+
+static size_t ring_depth(const struct stream_client *client) { return client->head - client->tail; }
+
+static bool ring_push(struct stream_client *client, const void *msg, size_t len) {
+	if (client->capacity - ring_depth(client) < len) {
+		return false;
+	}
+
+	size_t start = client->head & (client->capacity - 1);
+	size_t first = len < client->capacity - start ? len : client->capacity - start;
+	memcpy(client->buffer + start, msg, first);
+	memcpy(client->buffer, (const uint8_t *)msg + first, len - first);
+	client->head += len;
+
+	size_t depth = ring_depth(client);
+	if (depth > client->stats.max_queued_bytes) {
+		client->stats.max_queued_bytes = depth;
+	}
+	return true;
+}
+
+static void set_want_write(survive_stream_server *server, struct stream_client *client, bool want_write) {
+	if (client->want_write == want_write) {
+		return;
+	}
+	client->want_write = want_write;
+	struct epoll_event ev = {.events = EPOLLIN | (want_write ? EPOLLOUT : 0), .data.ptr = client};
+	epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, client->fd, &ev);
+}
+
+// Sends as much of the client's ring as the socket takes; false if the connection failed
+static bool flush_client(survive_stream_server *server, struct stream_client *client) {
+	while (ring_depth(client) > 0) {
+		size_t start = client->tail & (client->capacity - 1);
+		size_t len = ring_depth(client);
+		if (len > client->capacity - start) {
+			len = client->capacity - start;
+		}
+
+		ssize_t sent = send(client->fd, client->buffer + start, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (sent < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				set_want_write(server, client, true);
+				return true;
+			}
+			return false;
+		}
+		client->tail += sent;
+		client->stats.sent_bytes += sent;
+	}
+
+	set_want_write(server, client, false);
+	return true;
+}
+
+static bool object_wanted(const struct stream_client *client, const char *codename) {
+	if (client->objects[0] == 0) {
+		return true;
+	}
+
+	size_t len = strlen(codename);
+	for (const char *s = client->objects; (s = strstr(s, codename)); s++) {
+		if ((s == client->objects || s[-1] == ',') && (s[len] == 0 || s[len] == ',')) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void queue_message(struct stream_client *client, const SurviveStreamHeader *msg) {
+	if (ring_push(client, msg, msg->size)) {
+		client->stats.sent_messages++;
+	} else {
+		client->stats.dropped_messages++;
+	}
+}
+
+static void queue_stats(struct stream_client *client, double time) {
+	client->stats.hdr = (SurviveStreamHeader){.size = sizeof(SurviveStreamStats), .type = SURVIVE_STREAM_STATS,
+											  .time = time};
+	client->stats.queued_bytes = ring_depth(client);
+	SurviveStreamStats stats = client->stats;
+	queue_message(client, &stats.hdr);
+}
+
+// Queues msg for every client that wants it, announcing the object first where needed. Called with the lock held.
+static void broadcast(survive_stream_server *server, SurviveStreamHeader *msg) {
+	const SurviveStreamObject *object = &server->objects[msg->object];
+	bool queued = false;
+
+	for (size_t i = 0; i < server->clients_cnt; i++) {
+		struct stream_client *client = server->clients[i];
+		if ((client->type_mask & SURVIVE_STREAM_MASK(msg->type)) == 0 ||
+			!object_wanted(client, object->codename)) {
+			continue;
+		}
+
+		double *last_sent = &client->last_sent[msg->object][msg->type];
+		if (client->min_period > 0 && *last_sent != 0 && msg->time - *last_sent < client->min_period) {
+			client->stats.decimated_messages++;
+			continue;
+		}
+
+		uint64_t bit = 1ull << (msg->object % 64);
+		if ((client->announced[msg->object / 64] & bit) == 0) {
+			// Without the announcement nothing else about the object can be read, so hold back until it fits
+			if (!ring_push(client, object, sizeof(*object))) {
+				client->stats.dropped_messages++;
+				continue;
+			}
+			client->stats.sent_messages++;
+			client->announced[msg->object / 64] |= bit;
+		}
+
+		*last_sent = msg->time;
+		queue_message(client, msg);
+		queued = true;
+	}
+
+	if (queued) {
+		uint64_t one = 1;
+		ssize_t ignored = write(server->wake_fd, &one, sizeof(one));
+		(void)ignored;
+	}
+}
+
+static double server_time(const survive_stream_server *server) {
+	return server->ctx->private_members ? survive_run_time(server->ctx) : 0;
+}
+
+// Index of so in the object table, adding it if it's new; -1 once the table is full. Called with the lock held.
+static int object_index(survive_stream_server *server, const SurviveObject *so) {
+	for (size_t i = 0; i < server->objects_cnt; i++) {
+		if (strncmp(server->objects[i].codename, so->codename, sizeof(server->objects[i].codename)) == 0) {
+			return i;
+		}
+	}
+	if (server->objects_cnt >= SURVIVE_STREAM_MAX_OBJECTS) {
+		return -1;
+	}
+
+	SurviveStreamObject *object = &server->objects[server->objects_cnt];
+	object->hdr = (SurviveStreamHeader){
+		.size = sizeof(SurviveStreamObject), .type = SURVIVE_STREAM_OBJECT, .object = server->objects_cnt};
+	strncpy(object->codename, so->codename, sizeof(object->codename) - 1);
+	strncpy(object->serial_number, so->serial_number, sizeof(object->serial_number) - 1);
+	return server->objects_cnt++;
+}
+
+// Locks the server and fills in the common header; returns false (unlocked) if the object can't be streamed
+static bool begin_message(survive_stream_server *server, SurviveObject *so, SurviveStreamHeader *hdr, uint8_t type,
+						  size_t size, survive_long_timecode timecode) {
+	double time = server_time(server);
+	OGLockMutex(server->lock);
+	int idx = object_index(server, so);
+	if (idx < 0 || server->clients_cnt == 0) {
+		OGUnlockMutex(server->lock);
+		return false;
+	}
+	*hdr = (SurviveStreamHeader){.size = size, .type = type, .object = idx, .time = time, .timecode = timecode};
+	return true;
+}
+
+void survive_stream_server_pose(survive_stream_server *server, SurviveObject *so, survive_long_timecode timecode,
+								const SurvivePose *pose) {
+	SurviveStreamPose msg;
+	if (!begin_message(server, so, &msg.hdr, SURVIVE_STREAM_POSE, sizeof(msg), timecode)) {
+		return;
+	}
+	for (int i = 0; i < 7; i++) {
+		msg.pose[i] = ((const FLT *)pose)[i];
+	}
+	broadcast(server, &msg.hdr);
+	OGUnlockMutex(server->lock);
+}
+
+void survive_stream_server_velocity(survive_stream_server *server, SurviveObject *so, survive_long_timecode timecode,
+									const SurviveVelocity *velocity) {
+	SurviveStreamVelocity msg;
+	if (!begin_message(server, so, &msg.hdr, SURVIVE_STREAM_VELOCITY, sizeof(msg), timecode)) {
+		return;
+	}
+	for (int i = 0; i < 6; i++) {
+		msg.velocity[i] = ((const FLT *)velocity)[i];
+	}
+	broadcast(server, &msg.hdr);
+	OGUnlockMutex(server->lock);
+}
+
+void survive_stream_server_button(survive_stream_server *server, SurviveObject *so, enum SurviveInputEvent eventType,
+								  enum SurviveButton buttonId) {
+	SurviveStreamButton msg = {0};
+	if (!begin_message(server, so, &msg.hdr, SURVIVE_STREAM_BUTTON, sizeof(msg), 0)) {
+		return;
+	}
+	msg.event_type = eventType;
+	msg.button_id = buttonId;
+	msg.buttonmask = so->buttonmask;
+	msg.touchmask = so->touchmask;
+	for (int i = 0; i < 16; i++) {
+		msg.axis[i] = so->axis[i];
+	}
+	broadcast(server, &msg.hdr);
+	OGUnlockMutex(server->lock);
+}
+
+static void close_client(survive_stream_server *server, struct stream_client *client) {
+	SurviveContext *ctx = server->ctx;
+	SV_VERBOSE(10,
+			   "Stream client %d closed; %" PRIu64 " messages (%" PRIu64 " bytes) sent, %" PRIu64 " dropped, %" PRIu64
+			   " decimated, peak buffer %u bytes",
+			   client->fd, client->stats.sent_messages, client->stats.sent_bytes, client->stats.dropped_messages,
+			   client->stats.decimated_messages, client->stats.max_queued_bytes);
+
+	for (size_t i = 0; i < server->clients_cnt; i++) {
+		if (server->clients[i] == client) {
+			server->clients[i] = server->clients[--server->clients_cnt];
+			break;
+		}
+	}
+	epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, client->fd, 0);
+	close(client->fd);
+	free(client->buffer);
+	free(client);
+}
+
+static void accept_clients(survive_stream_server *server) {
+	SurviveContext *ctx = server->ctx;
+	for (;;) {
+		int fd = accept4(server->listen_fd, 0, 0, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0) {
+			return;
+		}
+
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+		struct stream_client *client = SV_CALLOC(sizeof(struct stream_client));
+		client->fd = fd;
+		client->capacity = server->buffer_size;
+		client->buffer = SV_CALLOC(client->capacity);
+		client->type_mask = SURVIVE_STREAM_MASK(SURVIVE_STREAM_POSE) | SURVIVE_STREAM_MASK(SURVIVE_STREAM_VELOCITY) |
+							SURVIVE_STREAM_MASK(SURVIVE_STREAM_BUTTON);
+
+		struct epoll_event ev = {.events = EPOLLIN, .data.ptr = client};
+		epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+
+		server->clients = SV_REALLOC(server->clients, sizeof(struct stream_client *) * (server->clients_cnt + 1));
+		server->clients[server->clients_cnt++] = client;
+		SV_VERBOSE(10, "Stream client %d connected", fd);
+	}
+}
+
+static void handle_request(survive_stream_server *server, struct stream_client *client, const SurviveStreamHeader *hdr) {
+	switch (hdr->type) {
+	case SURVIVE_STREAM_SUBSCRIBE: {
+		if (hdr->size < sizeof(SurviveStreamSubscribe)) {
+			break;
+		}
+		const SurviveStreamSubscribe *sub = (const SurviveStreamSubscribe *)hdr;
+		client->type_mask = sub->type_mask;
+		client->min_period = sub->min_period;
+		memcpy(client->objects, sub->objects, sizeof(client->objects));
+		client->objects[sizeof(client->objects) - 1] = 0;
+		memset(client->last_sent, 0, sizeof(client->last_sent));
+		queue_stats(client, server_time(server));
+		break;
+	}
+	case SURVIVE_STREAM_STATS_REQUEST:
+		queue_stats(client, server_time(server));
+		break;
+	}
+}
+
+// False if the client hung up or sent garbage
+static bool read_client(survive_stream_server *server, struct stream_client *client) {
+	for (;;) {
+		ssize_t cnt = recv(client->fd, client->input + client->input_len, sizeof(client->input) - client->input_len,
+						   MSG_DONTWAIT);
+		if (cnt == 0) {
+			return false;
+		}
+		if (cnt < 0) {
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+		}
+		client->input_len += cnt;
+
+		while (client->input_len >= sizeof(SurviveStreamHeader)) {
+			SurviveStreamHeader hdr;
+			memcpy(&hdr, client->input, sizeof(hdr));
+			if (hdr.size < sizeof(SurviveStreamHeader) || hdr.size > sizeof(client->input)) {
+				return false;
+			}
+			if (client->input_len < hdr.size) {
+				break;
+			}
+
+			SurviveStreamSubscribe msg = {0};
+			memcpy(&msg, client->input, hdr.size);
+			handle_request(server, client, &msg.hdr);
+
+			client->input_len -= hdr.size;
+			memmove(client->input, client->input + hdr.size, client->input_len);
+		}
+	}
+}
+
+// Later events in the same epoll_wait batch may still point at a client that is about to be freed; turn them into
+// empty wakes
+static void forget_client_events(struct epoll_event *events, int from, int cnt, const struct stream_client *client,
+								 survive_stream_server *server) {
+	for (int i = from; i < cnt; i++) {
+		if (events[i].data.ptr == client) {
+			events[i].data.ptr = server;
+			events[i].events = 0;
+		}
+	}
+}
+
+static void *stream_server_thread(void *user) {
+	survive_stream_server *server = user;
+	struct epoll_event events[STREAM_SERVER_MAX_EVENTS];
+
+	while (server->keep_running) {
+		int cnt = epoll_wait(server->epoll_fd, events, STREAM_SERVER_MAX_EVENTS, 100);
+
+		OGLockMutex(server->lock);
+		for (int i = 0; i < cnt; i++) {
+			if (events[i].data.ptr == 0) {
+				accept_clients(server);
+			} else if (events[i].data.ptr == server) {
+				uint64_t wakes;
+				ssize_t ignored = read(server->wake_fd, &wakes, sizeof(wakes));
+				(void)ignored;
+
+				for (size_t j = 0; j < server->clients_cnt;) {
+					struct stream_client *client = server->clients[j];
+					if (client->want_write || flush_client(server, client)) {
+						j++;
+						continue;
+					}
+
+					// close_client moves the last client into slot j, so don't advance
+					forget_client_events(events, i + 1, cnt, client, server);
+					close_client(server, client);
+				}
+			} else {
+				struct stream_client *client = events[i].data.ptr;
+				bool ok = true;
+				if (events[i].events & EPOLLIN) {
+					ok = read_client(server, client);
+				}
+				if (ok && (events[i].events & EPOLLOUT || ring_depth(client))) {
+					ok = flush_client(server, client);
+				}
+				if (!ok || (events[i].events & (EPOLLERR | EPOLLHUP))) {
+					forget_client_events(events, i + 1, cnt, client, server);
+					close_client(server, client);
+				}
+			}
+		}
+		OGUnlockMutex(server->lock);
+	}
+	return 0;
+}
+
+survive_stream_server *survive_stream_server_create(SurviveContext *ctx, const char *address, int port,
+													size_t buffer_size) {
+	survive_stream_server *server = SV_CALLOC(sizeof(survive_stream_server));
+	server->ctx = ctx;
+	server->wake_fd = server->epoll_fd = -1;
+
+	// The ring masks offsets, so round up to a power of two
+	server->buffer_size = 1024;
+	while (server->buffer_size < buffer_size) {
+		server->buffer_size *= 2;
+	}
+
+	struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(port)};
+	if (inet_pton(AF_INET, address, &addr.sin_addr) != 1) {
+		SV_WARN("Stream server address '%s' isn't an IPv4 address", address);
+		free(server);
+		return 0;
+	}
+
+	server->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	int one = 1;
+	setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	socklen_t addr_len = sizeof(addr);
+	if (server->listen_fd < 0 || bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+		listen(server->listen_fd, 16) != 0 ||
+		getsockname(server->listen_fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+		SV_WARN("Stream server could not listen on %s:%d (%s)", address, port, strerror(errno));
+		if (server->listen_fd >= 0) {
+			close(server->listen_fd);
+		}
+		free(server);
+		return 0;
+	}
+	server->port = ntohs(addr.sin_port);
+
+	server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	server->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	struct epoll_event listen_ev = {.events = EPOLLIN, .data.ptr = 0};
+	struct epoll_event wake_ev = {.events = EPOLLIN, .data.ptr = server};
+	epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &listen_ev);
+	epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->wake_fd, &wake_ev);
+
+	server->lock = OGCreateMutex();
+	server->keep_running = true;
+	server->thread = OGCreateThread(stream_server_thread, "stream server", server);
+
+	SV_INFO("Streaming poses on %s:%d", address, server->port);
+	return server;
+}
+
+int survive_stream_server_port(const survive_stream_server *server) { return server->port; }
+
+void survive_stream_server_free(survive_stream_server *server) {
+	if (server == 0) {
+		return;
+	}
+
+	server->keep_running = false;
+	OGJoinThread(server->thread);
+
+	while (server->clients_cnt) {
+		close_client(server, server->clients[0]);
+	}
+	free(server->clients);
+	close(server->listen_fd);
+	close(server->wake_fd);
+	close(server->epoll_fd);
+	OGDeleteMutex(server->lock);
+	free(server);
+}
+
+static int stream_server_close(SurviveContext *ctx, void *driver);
+
+static survive_stream_server *get_server(SurviveContext *ctx) {
+	return (survive_stream_server *)survive_get_driver_by_closefn(ctx, stream_server_close);
+}
+
+static void stream_pose_fn(SurviveObject *so, survive_long_timecode timecode, const SurvivePose *pose) {
+	survive_stream_server *server = get_server(so->ctx);
+	server->prior_pose_fn(so, timecode, pose);
+	survive_stream_server_pose(server, so, timecode, pose);
+}
+
+static void stream_velocity_fn(SurviveObject *so, survive_long_timecode timecode, const SurviveVelocity *velocity) {
+	survive_stream_server *server = get_server(so->ctx);
+	server->prior_velocity_fn(so, timecode, velocity);
+	survive_stream_server_velocity(server, so, timecode, velocity);
+}
+
+static void stream_button_fn(SurviveObject *so, enum SurviveInputEvent eventType, enum SurviveButton buttonId,
+							 const enum SurviveAxis *axisIds, const SurviveAxisVal_t *axisVals) {
+	survive_stream_server *server = get_server(so->ctx);
+	server->prior_button_fn(so, eventType, buttonId, axisIds, axisVals);
+	survive_stream_server_button(server, so, eventType, buttonId);
+}
+
+static int stream_server_close(SurviveContext *ctx, void *driver) {
+	survive_stream_server *server = driver;
+	survive_install_pose_fn(ctx, server->prior_pose_fn);
+	survive_install_velocity_fn(ctx, server->prior_velocity_fn);
+	survive_install_button_fn(ctx, server->prior_button_fn);
+	survive_stream_server_free(server);
+	return 0;
+}
+
+int DriverRegStreamServer(SurviveContext *ctx) {
+	survive_stream_server *server =
+		survive_stream_server_create(ctx, survive_configs(ctx, STREAM_SERVER_ADDRESS_TAG, SC_GET, "127.0.0.1"),
+									 survive_configi(ctx, STREAM_SERVER_PORT_TAG, SC_GET, SURVIVE_STREAM_DEFAULT_PORT),
+									 survive_configi(ctx, STREAM_SERVER_BUFFER_TAG, SC_GET, 256 * 1024));
+	if (server == 0) {
+		return SURVIVE_DRIVER_ERROR;
+	}
+
+	server->prior_pose_fn = survive_install_pose_fn(ctx, stream_pose_fn);
+	server->prior_velocity_fn = survive_install_velocity_fn(ctx, stream_velocity_fn);
+	server->prior_button_fn = survive_install_button_fn(ctx, stream_button_fn);
+	survive_add_driver(ctx, server, 0, stream_server_close);
+	return SURVIVE_DRIVER_PASSIVE;
+}
+
+REGISTER_LINKTIME(DriverRegStreamServer)
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <survive.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * TCP server streaming object state in the format of survive_stream.h.
+ *
+ * One thread runs an epoll loop over the listening socket and every client. Publishing only copies the message into
+ * the ring buffer of each client whose subscription wants it and wakes the loop; a client which doesn't keep up has
+ * new messages dropped and counted rather than slowing the tracker down.
+ */
+typedef struct survive_stream_server survive_stream_server;
+
+/**
+ * Starts listening on address:port. Port 0 picks a free one; see survive_stream_server_port.
+ *
+ * @param buffer_size Bytes buffered per client
+ * @return 0 if the socket couldn't be set up
+ */
+SURVIVE_EXPORT survive_stream_server *survive_stream_server_create(SurviveContext *ctx, const char *address, int port,
+																   size_t buffer_size);
+SURVIVE_EXPORT int survive_stream_server_port(const survive_stream_server *server);
+SURVIVE_EXPORT void survive_stream_server_free(survive_stream_server *server);
+
+SURVIVE_EXPORT void survive_stream_server_pose(survive_stream_server *server, SurviveObject *so,
+											   survive_long_timecode timecode, const SurvivePose *pose);
+SURVIVE_EXPORT void survive_stream_server_velocity(survive_stream_server *server, SurviveObject *so,
+												   survive_long_timecode timecode, const SurviveVelocity *velocity);
+SURVIVE_EXPORT void survive_stream_server_button(survive_stream_server *server, SurviveObject *so,
+												 enum SurviveInputEvent eventType, enum SurviveButton buttonId);
+
+#ifdef __cplusplus
+};
+#endif
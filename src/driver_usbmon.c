@@ -813,6 +813,13 @@ static int DriverRegUSBMon_(SurviveContext *ctx, int driver_id) {
 	if (enable && driver_id != 0)
 		return -1;
 
+	// pcap playback always runs on its own thread, so it can't give the guarantee this flag asks for
+	if (usbmon_playback && *usbmon_playback && survive_configi(ctx, "playback-deterministic", SC_GET, 0)) {
+		SV_ERROR(SURVIVE_ERROR_INVALID_CONFIG, "'playback-deterministic' isn't supported for usbmon playback of '%s'",
+				 usbmon_playback);
+		return SURVIVE_DRIVER_ERROR;
+	}
+
 	SurviveDriverUSBMon *sp = SV_CALLOC(sizeof(SurviveDriverUSBMon));
 	sp->playback_factor = -1;
 	sp->ctx = ctx;
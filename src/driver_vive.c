@@ -20,6 +20,7 @@
 #include "survive_str.h"
 #include "driver_vive.h"
 #include "lfsr_lh2.h"
+#include "survive_watchman.h"
 //#define DEBUG_WATCHMAN 1
 
 struct SurviveViveData;
@@ -462,6 +463,15 @@ struct SurviveViveData {
 
 	FLT lastPairTime;
 	bool requestPairing;
+
+	// See USB_RX_QUEUE
+	bool rx_queue;
+	uint32_t rx_queue_size;
+	og_thread_t rx_decode_thread;
+	bool rx_decode_running;
+	// Guards udev and the interfaces' rx rings against the decode thread, which runs without the context lock in
+	// sharded mode. Taken after the context lock.
+	og_mutex_t rx_lock;
 #ifndef HIDAPI
 	libusb_hotplug_callback_handle callback_handle;
 #endif
@@ -667,9 +677,102 @@ void survive_data_on_setup_write(SurviveObject *so, uint8_t bmRequestType, uint8
 void survive_data_cb_locked(uint64_t time_received_us, SurviveUSBInterface *si);
 void survive_data_cb(uint64_t time_received_us, SurviveUSBInterface *si) {
 	SurviveContext *ctx = si->ctx;
-	survive_get_ctx_lock(ctx);
+	SurviveObject *so = si->assoc_obj;
+	survive_get_ingest_lock(ctx, so);
 	survive_data_cb_locked(time_received_us, si);
-	survive_release_ctx_lock(ctx);
+	survive_release_ingest_lock(ctx, so);
+}
+
+/**
+ * usb-rx-queue callback; runs on the receiving thread and only copies the packet into the interface's ring. Packets
+ * which don't fit are dropped and counted as overflows.
+ */
+static void survive_data_enqueue_cb(uint64_t time_received_us, SurviveUSBInterface *si) {
+	survive_usb_rx_packet *packet = survive_spsc_ring_reserve(&si->rx_ring);
+	if (packet == 0) {
+		return;
+	}
+
+	int length = si->actual_len < INTBUFFSIZE ? si->actual_len : INTBUFFSIZE;
+	packet->time_received_us = time_received_us;
+	packet->length = length;
+	memcpy(packet->data, si->buffer, length);
+	survive_spsc_ring_commit(&si->rx_ring);
+}
+
+/**
+ * Processes up to max_packets queued packets across every interface, oldest first. Must be called with rx_lock held
+ * in sharded mode, and the context lock otherwise; either keeps devices from being added or closed underneath it.
+ */
+static size_t survive_vive_drain_rx_queues(SurviveViveData *sv, size_t max_packets) {
+	SurviveContext *ctx = sv->ctx;
+	bool sharded = survive_is_sharded(ctx);
+	size_t cnt = 0;
+	for (; cnt < max_packets; cnt++) {
+		SurviveUSBInterface *next = 0;
+		survive_usb_rx_packet *next_packet = 0;
+		for (int i = 0; i < sv->udev_cnt; i++) {
+			for (int j = 0; j < sv->udev[i]->interface_cnt; j++) {
+				SurviveUSBInterface *iface = &sv->udev[i]->interfaces[j];
+				if (!survive_spsc_ring_is_init(&iface->rx_ring))
+					continue;
+
+				survive_usb_rx_packet *packet = survive_spsc_ring_peek(&iface->rx_ring);
+				if (packet && (next_packet == 0 || packet->time_received_us < next_packet->time_received_us)) {
+					next = iface;
+					next_packet = packet;
+				}
+			}
+		}
+
+		if (next == 0)
+			break;
+
+		// The receiving side still owns buffer / actual_len on the interface itself
+		SurviveUSBInterface view = *next;
+		view.buffer = next_packet->data;
+		view.actual_len = next_packet->length;
+
+		// Packets with no object are dropped by survive_data_cb_locked without touching anything, so they need no lock
+		SurviveObject *so = view.assoc_obj;
+		if (so) {
+			if (sharded) {
+				survive_get_ingest_lock(ctx, so);
+			}
+			survive_data_cb_locked(next_packet->time_received_us, &view);
+			if (sharded) {
+				survive_release_ingest_lock(ctx, so);
+			}
+		}
+
+		survive_spsc_ring_pop(&next->rx_ring);
+	}
+	return cnt;
+}
+
+static void *survive_vive_rx_decode_thread(void *_sv) {
+	SurviveViveData *sv = _sv;
+	SurviveContext *ctx = sv->ctx;
+	bool sharded = survive_is_sharded(ctx);
+	while (sv->rx_decode_running) {
+		// In sharded mode each packet only takes its own object's lock, so one busy object doesn't stall the rest
+		if (sharded) {
+			OGLockMutex(sv->rx_lock);
+		} else {
+			survive_get_ctx_lock(ctx);
+		}
+		size_t cnt = survive_vive_drain_rx_queues(sv, 256);
+		if (sharded) {
+			OGUnlockMutex(sv->rx_lock);
+		} else {
+			survive_release_ctx_lock(ctx);
+		}
+
+		if (cnt == 0) {
+			OGUSleep(250);
+		}
+	}
+	return 0;
 }
 
 // USB Subsystem
@@ -694,11 +797,21 @@ static int AttachInterface(SurviveViveData *sv, struct SurviveUSBInfo *usbObject
 	iface->hname = hname;
 	iface->cb = cb;
 
+	if (sv->rx_queue) {
+		survive_spsc_ring_init(&iface->rx_ring, sizeof(survive_usb_rx_packet), sv->rx_queue_size);
+		iface->cb = survive_data_enqueue_cb;
+	}
+
 #ifdef HIDAPI
 	iface->buffer = iface->swap_buffer[0];
 	iface->uh = usbObject->handle->interfaces[endpoint - usbObject->device_info->endpoints];
 	assert(iface->uh);
 
+	if (sv->rx_queue) {
+		iface->rx_thread = OGCreateThread(HAPIReceiveThread, "usb rx", iface);
+		return 0;
+	}
+
 #ifndef HID_NONBLOCKING
 	iface->servicethread = OGCreateThread(HAPIReceiver, iface);
 	OGUSleep(100000);
@@ -751,7 +864,16 @@ static const struct DeviceInfo *find_known_device(SurviveContext *ctx, uint16_t
 }
 
 static int survive_start_get_config(SurviveViveData *sv, struct SurviveUSBInfo *usbInfo, int iface);
+static int survive_vive_add_usb_device_locked(SurviveViveData *sv, survive_usb_device_t d);
 int survive_vive_add_usb_device(SurviveViveData *sv, survive_usb_device_t d) {
+	if (sv->rx_lock)
+		OGLockMutex(sv->rx_lock);
+	int rtn = survive_vive_add_usb_device_locked(sv, d);
+	if (sv->rx_lock)
+		OGUnlockMutex(sv->rx_lock);
+	return rtn;
+}
+static int survive_vive_add_usb_device_locked(SurviveViveData *sv, survive_usb_device_t d) {
 	SurviveContext *ctx = sv->ctx;
 	uint16_t idVendor;
 	uint16_t idProduct;
@@ -872,6 +994,10 @@ int survive_usb_init(SurviveViveData *sv) {
 
 STATIC_CONFIG_ITEM(PAIR_DEVICE, "pair-device", 'b', "Turn on pairing mode", 0)
 STATIC_CONFIG_ITEM(SECONDS_PER_HZ_OUTPUT, "usb-hz-output", 'i', "Seconds between outputing usb stats", -1)
+STATIC_CONFIG_ITEM(USB_RX_QUEUE, "usb-rx-queue", 'b',
+				   "Receive USB packets into lock free queues and decode them on a dedicated thread", 0)
+STATIC_CONFIG_ITEM(USB_RX_QUEUE_SIZE, "usb-rx-queue-size", 'i', "Packets buffered per USB interface for usb-rx-queue",
+				   1024)
 void survive_vive_usb_close(SurviveViveData *sv) {
 	survive_release_ctx_lock(sv->ctx);
 	survive_usb_close(sv);
@@ -904,9 +1030,20 @@ static inline bool survive_handle_close_request_flag(struct SurviveUSBInfo *usbI
 		if (usbInfo == sv->hmd_mainboard)
 			sv->hmd_mainboard = 0;
 
+#ifdef HIDAPI
+		survive_usb_stop_receive_threads(usbInfo);
+#endif
+		if (sv->rx_lock)
+			OGLockMutex(sv->rx_lock);
+		for (size_t j = 0; j < usbInfo->interface_cnt; j++) {
+			survive_spsc_ring_free(&usbInfo->interfaces[j].rx_ring);
+		}
+
 		sv->udev_cnt--;
 		sv->udev[idx] = sv->udev[sv->udev_cnt];
 		sv->udev[sv->udev_cnt] = 0;
+		if (sv->rx_lock)
+			OGUnlockMutex(sv->rx_lock);
 
 		if (usbInfo->ownsObject) {
 			survive_destroy_device(usbInfo->so);
@@ -1003,6 +1140,12 @@ int survive_vive_usb_poll(SurviveContext *ctx, void *v) {
 						iface->packet_count / time_diff, avg_cb_time, avg_cb_submit_latency, iface->max_cb_time / 1000.,
 						iface->max_submit_time / 1000., iface->cb_time_violation,
 						100. * iface->cb_time_violation / (FLT)(iface->packet_count + .0001));
+				if (survive_spsc_ring_is_init(&iface->rx_ring)) {
+					SV_INFO("Iface %3s %-32s rx queue depth %4u Max depth: %4u/%u Overflows: %u",
+							survive_colorize(codename), survive_colorize(iface->hname),
+							survive_spsc_ring_depth(&iface->rx_ring), iface->rx_ring.max_depth,
+							iface->rx_ring.capacity, iface->rx_ring.overflow_cnt);
+				}
 				iface->max_cb_time = iface->max_submit_time = iface->sum_cb_time = iface->sum_submit_cb_time = 0;
 				iface->cb_time_violation = 0;
 				iface->packet_count = 0;
@@ -1034,6 +1177,13 @@ int survive_vive_usb_poll(SurviveContext *ctx, void *v) {
 	}
 
 #ifdef HIDAPI
+	if (sv->rx_queue) {
+		// Receive threads and the decode thread do all the work; just give them a window to take the lock
+		survive_release_ctx_lock(ctx);
+		OGUSleep(1000);
+		survive_get_ctx_lock(ctx);
+		return 0;
+	}
 #ifdef HID_NONBLOCKING
 	survive_release_ctx_lock(ctx);
 	for (int i = 0; i < sv->udev_cnt; i++) {
@@ -1063,22 +1213,6 @@ int survive_vive_usb_poll(SurviveContext *ctx, void *v) {
 	return 0;
 }
 
-static inline survive_timecode fix_time24(SurviveContext *ctx, survive_timecode time24, survive_timecode refTime) {
-	survive_timecode upper_ref = refTime & 0xFF000000u;
-	survive_timecode lower_ref = refTime & 0x00FFFFFFu;
-
-	if (lower_ref > time24 && lower_ref - time24 > (1 << 23u)) {
-		upper_ref += 0x01000000;
-	} else if (lower_ref < time24 && time24 - lower_ref > (1 << 23u) && upper_ref > 0) {
-		upper_ref -= 0x01000000;
-	}
-
-	//	SV_VERBOSE(250, "fix_time24 time24: %x refTime: %x upper_ref: %x (%x) rtn: %x", time24, refTime, upper_ref,
-	//refTime & 0xFF000000u, upper_ref | time24);
-
-	return upper_ref | time24;
-}
-
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -1493,25 +1627,20 @@ static void registerButtonEvent(SurviveObject *so, buttonEvent *event, enum Butt
 #define DEBUG_WATCHMAN_ERRORS
 #endif
 
-#define AS_SHORT(a, b) ((uint16_t)(((uint16_t)a) << 8) | (0x00ff & b))
-#define POP_BYTE(ptr) ((uint8_t) * ((ptr)++))
-#define POP_SHORT(ptr) (((((struct unaligned_u16_t *)(((ptr) += 2) - 2))))->v)
-
 #define HAS_FLAG(flags, flag) ((flags & (flag)) == (flag))
 
-char hexstr[512];
-static char *packetToHex(const uint8_t *packet, const uint8_t *packetEnd) {
+#define HEX_BUFFER_SIZE (3 * 256 + 1)
+static char *packetToHex(char *hexstr, const uint8_t *packet, const uint8_t *packetEnd) {
 	int count = packetEnd - packet;
 	int i;
-	for (i = 0; i < count; i++)
-		sprintf(&hexstr[i * 3], "%02x ", packet[i]);
+	for (i = 0; i < count && i < 256; i++)
+		snprintf(&hexstr[i * 3], 4, "%02x ", packet[i]);
 	hexstr[i * 3] = 0;
 
 	return hexstr;
 }
 
-char bin[9] = {0};
-static char *byteToBin(uint8_t b) {
+static char *byteToBin(char *bin, uint8_t b) {
 	for (int i = 0; i < 8; i++) {
 		bin[i] = ((b >> (7 - i)) & 1) ? '1' : '0';
 	}
@@ -1519,330 +1648,9 @@ static char *byteToBin(uint8_t b) {
 	return bin;
 }
 
-struct sensorData {
-	uint8_t sensorId;
-	uint8_t edgeCount;
-};
-
-static int32_t read_light_data(SurviveObject *w, uint16_t time, uint8_t **readPtr, uint8_t *payloadEndPtr,
-							   LightcapElement *output, int output_cnt) {
-	uint8_t *payloadPtr = *readPtr;
-	SurviveContext *ctx = w->ctx;
-	uint32_t reference_time = w->activations.last_imu;
-
-	bool isGen2 = 0; // w->ctx->lh_version == 1;
-	(void)isGen2;
-
-	if (payloadEndPtr - payloadPtr <= 3) {
-		return 0;
-	}
-
-	// DEBUG
-	if ((*payloadPtr & 0xE0) == 0xE0) {
-		SV_WARN("Light contains probable non-light data : 0x%02hX [Time:%04hX] [Payload: %s]", *payloadPtr, time,
-				packetToHex(payloadPtr, payloadEndPtr));
-	}
-
-	/*
-	 * ---=== LIGHT DATA STRUCTURE ===---
-	 *
-	 * | SensorData  | Time Deltas          | End Timestamp |
-	 * ╔═════════════╦══════════════════════╦═══════════════╗
-	 * ║ SS SS .. SS ║ DD DD DD DD DD .. DD ║ TT TT TT      ║
-	 * ╚═════════════╩══════════════════════╩═══════════════╝
-	 *
-	 * Three parts to the packet, the sensor data which contains which sensors were triggered, and the times
-	 * deltas between rising and falling of the sensor event. There are always two rising/falling events per
-	 * sensor though the ordering is not simple as new sensor events may start before others are finished.
-	 *
-	 * The meaning and associated led with each 'event' is determined by the edge count as encoded within the
-	 * sensor data (see below)
-	 *
-	 * The time deltas use variable length encoding, so we can't determine how many sensors are in the packet
-	 * just from the packet length. However, we do know that there are always two times per sensor (rise and
-	 * fall), so there are (2*Sensor)-1 deltas in the packet (-1 because the end time is 'known' yielding two
-	 * times). Therefore, the general read process is thus:
-	 *
-	 *  1) Read off timestamp
-	 *  2) Read the first byte from the start of the packet
-	 *  3) Read one time delta from the end of the packet (We get two times from this since we know the 'end' time)
-	 *  4) Repeatedly:
-	 *     a) Read one byte from the start of the packet (Led/Flag)
-	 *     b) Read two time deltas from the end of the packet (not including timestamp) [See encoding below]
-	 *     c) Stop once we've read all data in the packet
-	 *
-	 *
-	 * TT TT TT
-	 * ~~~~~~~~
-	 *  Timestamp of the last event [Little Endian]
-	 *
-	 * eg:
-	 *  f6 b4 5b = 6010102
-	 *
-	 * DD
-	 * ~~
-	 *  Time deltas between events stored as variable length sequences. The lower 7 bits of each byte are
-	 *  summed until a byte with the 8th bit set is encountered. [Little endian]
-	 *
-	 *   8 76543210
-	 *  ╔═╦════════╗
-	 *  ║S│Value   ║
-	 *  ╚═╩════════╝
-	 *    ╲  ╲_________ 7 Bits of time delta
-	 *     ╲___________ Stop bit (1 = Value complete, 0 = Continue reading)
-	 *
-	 *  eg:
-	 *      0 = 80       [(80 & 7F)                  = 0]
-	 *    127 = FF       [(FF & 7F)                  = 127]
-	 *    128 = 80 01    [(80 & 7F) + ((01 & 7F)<<7) = 128]
-	 *    255 = FF 01    [(FF & 7F) + ((01 & 7F)<<7) = 255]
-	 *    256 = 80 02    [(80 & 7F) + ((02 & 7F)<<7) = 256]
-	 *  16383 = FF 7F    [(FF & 7F) + ((7F & 7F)<<7) = 16383]
-	 *  16384 = 80 80 01 [(80 & 7F) + ((80 & 7F)<<7) + ((01 & 7F)<<14) = 16384]
-	 *
-	 *
-	 *
-	 * SS
-	 * ~~
-	 *  Packed data about which sensor was detected and how many time deltas it's associated event straddles.
-	 *  1 Byte per sensor
-	 *
-	 *   876543 210
-	 *  ╔══════╦═══╗
-	 *  ║Sensor│EC ║
-	 *  ╚══════╩═══╝
-	 *    ╲      ╲____ Edge count
-	 *     ╲__________ Sensor ID of the event
-	 *
-	 *  eg:
-	 *    2B = Sensor 5, 3 edges [2B>>3 = 5, 2B & 03 = 3]
-	 *
-	 *
-	 * Example full packet
-	 * ===================
-	 *
-	 *   ┌──────┬───────┐
-	 *   │Sensor│ Edges │
-	 *   ├──────┼───────┤
-	 *   │   5  │   3   │
-	 *   │  10  │   1   │
-	 *   │   9  │   2   │
-	 *   │   5  │   0   │
-	 *   │  12  │   0   │
-	 *   └──────┴───────┘                           End Time : 6010102
-	 *              ╲                               ╱
-	 *               ╲                             ╱
-	 *            ╔════════════════╦═┄┄┄┄┄┄┄┄┄┄┄═╦══════════╗
-	 *            ║ 2b 51 4a 28 60 ║ Time Deltas ║ f6 b4 5b ║
-	 *            ╚════════════════╩═┄┄┄┄┄┄┄┄┄┄┄═╩══════════╝
-	 *                             ╱              ╲
-	 *     _______________________╱                ╲_______________________
-	 *    ╱                                                                ╲
-	 *   ╱                                                                  ╲
-	 *  ╔═══════╤═══════╤═══════╤══════════╤═══════╤════╤════╤═══════╤═══════╗
-	 *  ║ c7 2e │ e6 66 │ 84 1f │ fb 31 0b │ d9 01 │ da │ ca │ db 02 │ e4 02 ║
-	 *  ╠═══════╪═══════╪═══════╪══════════╪═══════╪════╪════╪═══════╪═══════╣
-	 *  ║ 5959  | 13158 | 3972  | 186619   | 217   | 90 | 74 | 347   |356    ║
-	 *  ╚═══════╧═══════╧═══════╧══════════╧═══════╧════╧════╧═══════╧═══════╝
-	 *  │       │       │       │          │       │    │    │       │       │
-	 *  ┕━━━━━━«E       │       │          │       │    │    │       │       │ -> Led 12 : 5799310 -> 5805269
-	 *                  ┕━━━━━━«D          │       │    │    │       │       │ -> Led 5  : 5818427 -> 5822399
-	 *                                     ┕━━━━━━━2━━━━2━━━«C       │       │ -> Led 9  : 6009018 -> 6009399
-	 *                                             │    │    ┊       │       │
-	 *                                             ┕━━━━3━━━━3━━━━━━━3━━━━━━«A -> Led 5  : 6009235 -> 6010102
-	 *                                                  |    ┊       |
-	 *                                                  ┕━━━━1━━━━━━«B         -> Led 10 : 6009325 -> 6009746
-	 * Read order :
-	 *  A : Ends at 'A' - Skip 3 edges to find start
-	 *  B : Ends at 'B' - Skip 1 edge to find start
-	 *  C : Ends at 'C' - Skip 2 edges to find start
-	 *  D : Ends at 'D' (Since the 'end' edges from ABC have already been 'used'), ends at next edge
-	 *  E : Ends at 'E' - Ends at next edge
-	 */
-
-	// Step 1 - Extract deltas between events the corresponding sensors
-	size_t timeIndex = 0;
-	uint32_t times[16] = {0};
-	size_t maxTimeIndex = sizeof(times) / sizeof(times[0]);
-	size_t maxEvents = maxTimeIndex >> 1;
-	uint8_t *reportOrder = alloca(sizeof(uint8_t*) * maxTimeIndex);
-
-	struct sensorData* sensors = alloca(sizeof(struct sensorData) * maxEvents);
-
-	uint8_t *idsPtr = payloadPtr;
-	uint8_t *eventPtr = payloadEndPtr;
-
-	// Last three bytes of light data are the LSB of the time of the last event
-	eventPtr -= 4;
-	uint32_t lastEventTime =
-		((uint32_t)(time >> 8) << 24) | (eventPtr[3] << 16) | (eventPtr[2] << 8) | (eventPtr[1] << 0);
-
-	// The general issue is that the 'time1' field isn't super in sync with the last 3 bytes we use for timing
-	// light events -- it can tip a smidge before those bytes see it or sometimes after. This can cause
-	// wild 1<<24 tick differences which break everything.
-	//
-	// We base it off IMU as a reference because light events can get blocked and it's not out of the ordinary
-	// to not see them for a second or two. (1 << 23) on a 48mhz clock is ~150ms; and the IMU is consistently
-	// much faster than that.
-	if (lastEventTime > reference_time && lastEventTime - reference_time > (1 << 23)) {
-		lastEventTime -= (1 << 24);
-	} else if (reference_time > lastEventTime && reference_time - lastEventTime > (1 << 23)) {
-		lastEventTime += (1 << 24);
-	}
-
-	times[0] = lastEventTime;
-	SV_VERBOSE(750, "Packet Start Time: %u (0x%x) (ref: %u) Payload: %s", lastEventTime, lastEventTime, reference_time,
-			   packetToHex(payloadPtr, payloadEndPtr));
-
-	while (idsPtr + (timeIndex >> 1u) < eventPtr) {
-		// Obtain the timing to the previous event
-		// Variable length encoding [if bit 8 is 0, continue into next byte]
-		uint32_t timeDelta = 0;
-		uint8_t *eventPtrStart = eventPtr;
-		while (true) {
-			timeDelta <<= 7;
-			timeDelta |= (*eventPtr & 0x7F);
-			if (((*(eventPtr--)) & 0x80) == 0x80)
-				break;
-
-			if (idsPtr + (timeIndex >> 1u) > eventPtr) {
-				eventPtr = eventPtrStart;
-				goto exit_while;
-			}
-		}
-		lastEventTime -= timeDelta;
-		if (timeIndex >= 16) {
-			return -8;
-		}
-		// Store the event time
-		times[++timeIndex] = lastEventTime;
-		SV_VERBOSE(750, "Time: [%zd] %u (%u) %s", timeIndex, lastEventTime, timeDelta,
-				   packetToHex(eventPtr + 1, eventPtrStart + 1));
-	}
-
-exit_while:
-	if (timeIndex % 2 == 0 && timeIndex > 0) {
-		timeIndex--;
-		do {
-			eventPtr++;
-		} while ((*eventPtr & 0x80) == 0);
-	}
-	assert(timeIndex % 2 == 1);
-
-	size_t sensor_byte_cnt = eventPtr - idsPtr + 1;
-	if (sensor_byte_cnt > ((timeIndex >> 1) + 1)) {
-		isGen2 = true;
-		//	    SV_VERBOSE(100, "Likely gen2 data; %x %d %d %d", *idsPtr, sensor_byte_cnt, (timeIndex >> 1), idsPtr -
-		//(eventPtr - (timeIndex >> 1)));
-		idsPtr = eventPtr - (timeIndex >> 1);
-	}
-
-	// There are two time deltas per 'event'
-	for (int i = 0; i < (timeIndex >> 1) + 1; i++) {
-		sensors[i].sensorId = ((*idsPtr) >> 3) & 0x1F;
-		sensors[i].edgeCount = (*idsPtr) & 0x7;
-		SV_VERBOSE(750, "Sensor: %2d Edge: %d (%02x)", sensors[i].sensorId, sensors[i].edgeCount, (*idsPtr));
-		idsPtr++;
-	}
-
-	// Step 2 - Convert events to pulses
-	LightcapElement* les = alloca(sizeof(LightcapElement) * maxEvents);
-	size_t eventCount = (timeIndex + 1) >> 1; // timeIndex>>1 = There are always twice as many time events as sensors
-
-	memset(les, 0, maxEvents * sizeof(LightcapElement));
-	memset(reportOrder, 0, maxTimeIndex * sizeof(uint8_t));
-	timeIndex = -1;
-
-	for (int i = 0; i < eventCount; i++) {
-		// Get the end time (Increment and find the next 'unused' time)
-		while (times[++timeIndex] == 0)
-			if (timeIndex + 1 >= maxTimeIndex) {
-				return -2;
-			}
-		if (timeIndex >= maxTimeIndex) {
-			return -3;
-		}
-
-		// Get the start time
-		size_t startTimeIndex = timeIndex + (sensors[i].edgeCount + 1);
-		if (startTimeIndex >= maxTimeIndex) {
-			return -4;
-		}
-
-		// Store the start index so we can return in ascending time order
-		if (reportOrder[startTimeIndex] != 0) {
-			return -5;
-		}
-		reportOrder[startTimeIndex] = i + 1;
-		LightcapElement *le = &les[i];
-
-		// Fill in the LightcapElement data
-		assert(le->sensor_id == 0);
-
-		le->sensor_id = sensors[i].sensorId;
-		le->timestamp = times[startTimeIndex];
-		le->length = times[timeIndex] - times[startTimeIndex];
-
-		// Flag the start time as 'used'
-		times[startTimeIndex] = 0;
-
-		// SV_INFO("Light Event : [%i|%i] %li -> %li (%li) [%i-%i]", les[i].sensor_id, sensors[i].edgeCount,
-		// les[i].timestamp, les[i].timestamp + les[i].length, les[i].length, startTimeIndex, timeIndex);
-	}
-
-	// Output the events in ascending time order
-	uint8_t orderedIndex;
-	for (int i = 0; (i < maxTimeIndex) && output_cnt > 0; i++) {
-		if ((orderedIndex = reportOrder[i]) != 0) {
-			LightcapElement *ol = &les[orderedIndex - 1];
-
-			if (!(ol->length != 0 || ol->timestamp != 0)) {
-				return -6;
-			}
-
-			*(output++) = *ol;
-			output_cnt--;
-			SV_VERBOSE(750, "Light Event [Ordered]: %i [%2i] %u -> %u (%4hu)", i, ol->sensor_id, ol->timestamp,
-					   ol->timestamp + ol->length, ol->length);
-		}
-	}
-
-	return eventCount;
-}
-
-static bool read_imu_data(SurviveObject *w, uint64_t time_in_us, uint16_t time, uint8_t **readPtr,
-						  const uint8_t *payloadEndPtr) {
-	uint8_t *payloadPtr = *readPtr;
-
-	SurviveContext *ctx = w->ctx;
-	if (payloadEndPtr - payloadPtr < 7) {
-		return false;
-	}
-
-	// First byte is higher res time, followed by 6 shorts
-	uint8_t timeLSB = POP_BYTE(payloadPtr);
-	int16_t aX = POP_SHORT(payloadPtr);
-	int16_t aY = POP_SHORT(payloadPtr);
-	int16_t aZ = POP_SHORT(payloadPtr);
-	int16_t rX = POP_SHORT(payloadPtr);
-	int16_t rY = POP_SHORT(payloadPtr);
-	int16_t rZ = POP_SHORT(payloadPtr);
-
-	FLT agm[9] = {aX, aY, aZ, rX, rY, rZ};
-
-	SV_VERBOSE(750, "%s IMU: %d " Point3_format " " Point3_format " From: %s", w->codename, timeLSB,
-			   LINMATH_VEC3_EXPAND(agm), LINMATH_VEC3_EXPAND(agm + 3), packetToHex(*readPtr, payloadPtr));
-	SURVIVE_INVOKE_HOOK_SO(raw_imu, w, 3, agm, ((uint32_t)time << 16) | (timeLSB << 8), 0);
-
-	SurviveSensorActivations_register_runtime(&w->activations, w->activations.last_imu, time_in_us);
-
-	*readPtr = payloadPtr;
-
-	return true;
-}
-#define UPDATE_PTR_AND_RETURN                                                                                          \
-	*readPtr = payloadPtr;                                                                                             \
-	return true;
+// Hex / binary strings for log lines, in a buffer that lives until the end of the enclosing statement
+#define PACKET_HEX(packet, packetEnd) packetToHex((char[HEX_BUFFER_SIZE]){0}, (packet), (packetEnd))
+#define BYTE_BIN(b) byteToBin((char[9]){0}, (b))
 
 static void handle_battery(SurviveObject *w, uint8_t batStatus) {
 	// int8_t percent = (int8_t)((((FLT)(batStatus & 0x7f)) / 0x7f) * 100);
@@ -1856,449 +1664,209 @@ static void handle_battery(SurviveObject *w, uint8_t batStatus) {
 	}
 }
 
-static bool read_event(SurviveObject *w, uint64_t time_in_us, uint16_t time, uint8_t **readPtr,
-					   uint8_t *payloadEndPtr) {
-	uint8_t *payloadPtr = *readPtr;
-	SurviveContext *ctx = w->ctx;
-
-	// If we're looking at light data, return
-	if (!HAS_FLAG(*payloadPtr, 0xE0))
-		return true;
+static void handle_watchman_input(SurviveObject *w, const survive_watchman_event *event) {
+	buttonEvent bEvent = {0};
+	uint8_t fields = event->input.fields;
 
-	// This is some kind of heartbeat
-	if (*payloadPtr == 0xE2) {
-		*readPtr = payloadEndPtr;
-		return true;
+	if (fields & SURVIVE_WATCHMAN_INPUT_BUTTONS) {
+		bEvent.pressedButtonsValid = 1;
+		bEvent.pressedButtons = event->input.buttons;
 	}
 
-	/*
-	 * Event Flags
-	 * ===========
-	 *
-	 * If input (button, touch, motion) data is present in packet:
-	 *   ┄╦═╤═╤═╦═╤═╤═╤═╤═╦┄
-	 *    ║1│1│1│1│I│-│-│-║
-	 *   ┄╩═╧═╧═╩═╧═╧═╧═╧═╩┄
-	 *
-	 * If battery data is present in a packet:
-	 *   ┄╦═╤═╤═╦═╤═╤═╤═╤═╦═══════════════╦┄
-	 *    ║1│1│1│0│?│?│?│1║ Battery       ║
-	 *   ┄╩═╧═╧═╩═╧═╧═╧═╧═╩═══════════════╩┄
-	 *    ▲                               │
-	 *    ╰───────────────────────────────╯
-	 *
-	 * If battery data is not present in packet (EG IMU only packets):
-	 *   ┄╦═╤═╤═╦═╤═╤═╤═╤═╦┄
-	 *    ║1│1│1│0│I│?│?│0║
-	 *   ┄╩═╧═╧═╩═╧═╧═╧═╧═╩┄
-	 *
-	 * I: IMU Data      1 = IMU Data present after event (13 Bytes)
-	 *                  0 = No IMU Data present after event
-	 */
-
-	const uint8_t flags = POP_BYTE(payloadPtr);
-
-	bool flagInput = HAS_FLAG(flags, 0x10);
-	bool flagIMU = HAS_FLAG(flags, 0x08);
-	if (flagInput) {
-		/*
-		 * Flags for input events are as follows:
-		 *
-		 * ┄╦═╤═╤═╦═╤═╤═╤═╤═╦┄
-		 *  │1│1│1│1│-│t│m│b│
-		 * ┄╩═╧═╧═╩═╧═╧═╧═╧═╩┄
-		 *
-		 * t: Trigger    1 = Trigger data present in event [1 Byte]  ╮
-		 * m: Motion     1 = Motion data present in event [4 Byte]   ├ If all 0, this is a gen 2 event [See below]
-		 * b: Button     1 = Button data present in event [1 Byte]   ╯
-		 *
-		 * Order of data in payload is as follows:
-		 * ┄╦═══════════════╦═══════════════╦═══════════════╦═══════════════╦
-		 *  ║ [Button/b]    ║ [Trigger/t]   ║ [Motion/t]    ║ [IMU Data/I]  ║
-		 * ┄╩═══════════════╩═══════════════╩═══════════════╩═══════════════╩
-		 */
-
-		bool firstGen = ((flags & 0x7) != 0);
-
-		buttonEvent bEvent = {0};
-		if (firstGen) {
-			bool flagTrigger = HAS_FLAG(flags, 0x4);
-			bool flagMotion = HAS_FLAG(flags, 0x2);
-			bool flagButton = HAS_FLAG(flags, 0x1);
-
-			if (flagButton) {
-				bEvent.pressedButtonsValid = 1;
-				bEvent.pressedButtons = POP_BYTE(payloadPtr);
-			}
-
-			if (flagTrigger) {
-				bEvent.triggerHighResValid = 1;
-				bEvent.triggerHighRes = POP_BYTE(payloadPtr) / 255.;
-			}
-
-			if (flagMotion) {
-				bEvent.touchpadHorizontalValid = 1;
-				bEvent.touchpadVerticalValid = 1;
-
-				bEvent.touchpadHorizontal = (int16_t)POP_SHORT(payloadPtr) / 32768.;
-				bEvent.touchpadVertical = (int16_t)POP_SHORT(payloadPtr) / 32768.;
-			}
-
-		} else {
-			// Second gen event (Eg Knuckles proximity)
-			uint8_t genTwoType =
-				POP_BYTE(payloadPtr); // May be flags, but currently only observed to be 'a1' when knuckles
-
-			if (genTwoType == 0xA1) {
-				// Knucles
-				/*SV_INFO("GRIP 0x%02hX [Time:%04hX] [Payload: %s] <<ABORT FURTHER READ>>",
-				 *(payloadPtr-1), time, packetToHex(payloadPtr, payloadEndPtr));*/
-
-				// Resistive contact sensors in buttons?
-				uint8_t touchFlags = POP_BYTE(payloadPtr);
-				// 0x01 = Trigger
-				// 0x08 = Menu
-				// 0x10 = Button A
-				// 0x20 = Button B
-				// 0x40 = Thumbstick
-
-				bEvent.touchedButtonsValid = 1;
-				bEvent.touchedButtons = (touchFlags & ~0x40u);
-				bEvent.touchedButtons |= ((touchFlags & 0x40u) >> 4);
-				bEvent.proximityValid = 1;
-
-				// Non-touching proximity to fingers
-				bEvent.proximity[0] = POP_BYTE(payloadPtr) / 255.; // Middle finger
-				bEvent.proximity[1] = POP_BYTE(payloadPtr) / 255.; // Ring finger
-				bEvent.proximity[2] = POP_BYTE(payloadPtr) / 255.; // Pinky finger
-				bEvent.proximity[3] = POP_BYTE(payloadPtr) / 255.; // Index finger (trigger)
-
-				// Contact force (Squeeze strength)
-				bEvent.proximity[4] = POP_BYTE(payloadPtr) / 255.;
-				bEvent.proximity[5] = POP_BYTE(payloadPtr) / 255.;
-			} else {
-				SV_WARN("Unknown gen two event %s 0x%02hX 0b%s [Time:%04hX] [Payload: %s] <<ABORT FURTHER READ>>",
-						w->codename, *(payloadPtr - 1), byteToBin(*(payloadPtr - 1)), time,
-						packetToHex(payloadPtr, payloadEndPtr));
-				// Since we don't know how much data this should consume, proceeding to IMU/Light decode is likely
-				// to choke.
-				return false;
-			}
-		}
-		registerButtonEvent(w, &bEvent, BUTTON_EVENT_SOURCE_RF);
-	} else {
-		/*
-		 * Flags for non-input (status) events are as follows:
-		 *
-		 * ┄╦═╤═╤═╦═╤═╤═╤═╤═╦┄
-		 *  │1│1│1│0│-│?│?│b│
-		 * ┄╩═╧═╧═╩═╧═╧═╧═╧═╩┄
-		 *
-		 * b: Battery     1 = Battery data present in event [1 Byte] possibly followed by an another event or light data
-		 */
-
-		bool flagBatteryStatus = HAS_FLAG(flags, 0x1);
-		bool flagUnknown = ((flags & 0x6) != 0);
+	if (fields & SURVIVE_WATCHMAN_INPUT_TRIGGER) {
+		bEvent.triggerHighResValid = 1;
+		bEvent.triggerHighRes = event->input.trigger / 255.;
+	}
 
-		// flagUnknown = true;
+	if (fields & SURVIVE_WATCHMAN_INPUT_TOUCHPAD) {
+		bEvent.touchpadHorizontalValid = 1;
+		bEvent.touchpadVerticalValid = 1;
+		bEvent.touchpadHorizontal = event->input.touchpad[0] / 32768.;
+		bEvent.touchpadVertical = event->input.touchpad[1] / 32768.;
+	}
 
-		if (flagUnknown) {
-			SV_WARN("Unknown status event 0x%02hX [Time:%04hX] [Payload: %s] <<ABORT FURTHER READ>>", *(payloadPtr - 1),
-					time, packetToHex(payloadPtr, payloadEndPtr));
-			// Since we don't know how much data this should consume, proceeding to IMU/Light decode is likely
-			// to choke.
-			*readPtr = payloadPtr;
-			return false;
-		}
+	if (fields & SURVIVE_WATCHMAN_INPUT_PROXIMITY) {
+		uint8_t touchFlags = event->input.touched;
+		// 0x01 = Trigger
+		// 0x08 = Menu
+		// 0x10 = Button A
+		// 0x20 = Button B
+		// 0x40 = Thumbstick
+		bEvent.touchedButtonsValid = 1;
+		bEvent.touchedButtons = (touchFlags & ~0x40u);
+		bEvent.touchedButtons |= ((touchFlags & 0x40u) >> 4);
 
-		if (flagBatteryStatus) {
-			// Battery Status
-			// Happens On USB plugged in. Switch to wired mode?
-			uint8_t batStatus = POP_BYTE(payloadPtr);
-			handle_battery(w, batStatus);
-#ifdef KNUCKLES_INFO
-			SV_INFO("KAS: @%04hX | Status  [Battery: % 3i%%] [%s]", time, percent,
-					(charging ? "CHARGING" : "ON BATTERY"));
-#endif
-			// Maybe read another event, IMU data or Light Data
-			bool rtn = read_event(w, time_in_us, time, &payloadPtr, payloadEndPtr);
-			*readPtr = payloadPtr;
-			return rtn;
+		// Middle, ring, pinky and index finger proximity, then squeeze strength and trackpad force
+		bEvent.proximityValid = 1;
+		for (int i = 0; i < 6; i++) {
+			bEvent.proximity[i] = event->input.proximity[i] / 255.;
 		}
 	}
 
-	// Read off any IMU data present
-	if (flagIMU)
-		read_imu_data(w, time_in_us, time, &payloadPtr, payloadEndPtr);
-
-	UPDATE_PTR_AND_RETURN
+	registerButtonEvent(w, &bEvent, BUTTON_EVENT_SOURCE_RF);
 }
 
-static inline void parse_and_process_lightcap(SurviveObject *w, uint16_t time, uint8_t *payloadPtr,
-											  uint8_t *payloadEndPtr) {
-	LightcapElement les[10] = {0};
-	uint8_t *payloadPtrStart = payloadPtr;
-	int32_t cnt = read_light_data(w, time, &payloadPtr, payloadEndPtr, les, 10);
+/**
+ * Hands a decoded packet's events to the hooks. All of its gen1 light goes to the disambiguator in one call.
+ */
+static void dispatch_watchman_events(SurviveObject *w, uint64_t time_in_us, const survive_watchman_packet *packet,
+									 bool skip_light) {
 	SurviveContext *ctx = w->ctx;
-#ifndef NDEBUG
-	for (int i = (int)cnt - 1; i >= 0; i--) {
-		uint8_t sensor = survive_map_sensor_id(w, les[i].sensor_id);
-		if (sensor == 255) {
-			cnt = -255;
+	LightcapElement les[SURVIVE_WATCHMAN_MAX_EVENTS];
+	size_t les_cnt = 0;
+
+	for (size_t i = 0; i < packet->event_cnt; i++) {
+		const survive_watchman_event *event = &packet->events[i];
+		switch (event->type) {
+		case SURVIVE_WATCHMAN_EVENT_IMU: {
+			FLT agm[9] = {event->imu.accel[0], event->imu.accel[1], event->imu.accel[2],
+						  event->imu.gyro[0],  event->imu.gyro[1],  event->imu.gyro[2]};
+			SV_VERBOSE(750, "%s IMU: %u " Point3_format " " Point3_format, w->codename, event->imu.timecode,
+					   LINMATH_VEC3_EXPAND(agm), LINMATH_VEC3_EXPAND(agm + 3));
+			SURVIVE_INVOKE_HOOK_SO(raw_imu, w, 3, agm, event->imu.timecode, 0);
+			SurviveSensorActivations_register_runtime(&w->activations, w->activations.last_imu, time_in_us);
+			break;
+		}
+		case SURVIVE_WATCHMAN_EVENT_INPUT:
+			handle_watchman_input(w, event);
+			break;
+		case SURVIVE_WATCHMAN_EVENT_BATTERY:
+			handle_battery(w, event->battery);
+			break;
+		case SURVIVE_WATCHMAN_EVENT_LIGHTCAP:
+			if (!skip_light)
+				les[les_cnt++] = event->lightcap;
+			break;
+		case SURVIVE_WATCHMAN_EVENT_SYNC:
+			if (skip_light)
+				break;
+			SV_VERBOSE(750, "Sync %s %02d %d %8u", w->codename, event->sync.channel, event->sync.ootx,
+					   event->sync.timecode);
+			SURVIVE_INVOKE_HOOK_SO(sync, w, event->sync.channel, event->sync.timecode, event->sync.ootx,
+								   event->sync.gen);
+			break;
+		case SURVIVE_WATCHMAN_EVENT_SWEEP:
+			if (skip_light)
+				break;
+			SV_VERBOSE(750, "Sweep %s %02d.%02d %8u", w->codename, event->sweep.channel, event->sweep.sensor,
+					   event->sweep.timecode);
+			SURVIVE_INVOKE_HOOK_SO(sweep, w, event->sweep.channel, survive_map_sensor_id(w, event->sweep.sensor),
+								   event->sweep.timecode, event->sweep.half_clock);
 			break;
 		}
 	}
-#endif
 
-	if (cnt < 0) {
-		SV_WARN("Read light data error %d   [Time:%04hX] [Payload: %s]", (int)cnt, time,
-				packetToHex(payloadPtr, payloadEndPtr));
-		SV_WARN("Full payload: %s", packetToHex(payloadPtrStart, payloadEndPtr));
-	} else {
+	if (les_cnt == 0) {
+		return;
+	}
 
 #ifdef VERIFY_LIGHTCAP
-		LightcapElement les_old[10] = {0};
-		int les_old_cnt = parse_watchman_lightcap(w->ctx, w->codename, time >> 8, w->activations.last_imu, payloadPtr,
-												  payloadEndPtr - payloadPtr, les, 10);
-
-		assert(cnt == les_old_cnt);
+	LightcapElement les_old[10] = {0};
+	int les_old_cnt =
+		parse_watchman_lightcap(ctx, w->codename, packet->time >> 8, w->activations.last_imu, (uint8_t *)packet->light,
+								packet->payload_end - packet->light, les_old, 10);
+	assert(les_cnt == les_old_cnt);
+	for (size_t i = 0; i < les_cnt; i++) {
+		const LightcapElement *le_old = &les_old[les_cnt - 1 - i];
+		assert(les[i].sensor_id == le_old->sensor_id && les[i].length == le_old->length &&
+			   les[i].timestamp == le_old->timestamp);
+	}
 #endif
-		for (int i = (int)cnt - 1; i >= 0; i--) {
 #ifdef DEBUG_WATCHMAN
-			printf("%d: %u [%u]\n", les[i].sensor_id, les[i].length, les[i].timestamp);
-#endif
-#ifdef VERIFY_LIGHTCAP
-			assert(memcmp(&les[i], &les_old[i], sizeof(LightcapElement)) == 0);
+	for (size_t i = 0; i < les_cnt; i++) {
+		printf("%d: %u [%u]\n", les[i].sensor_id, les[i].length, les[i].timestamp);
+	}
 #endif
-			handle_lightcap(w, &les[i]);
-		}
+
+	if (!handle_lightcaps(w, les, les_cnt)) {
+		SV_WARN("%s light data has unknown sensors [Time:%04hX] [Payload: %s]", w->codename, packet->time,
+				PACKET_HEX(packet->light, packet->payload_end));
 	}
 }
 
-static int parse_and_process_raw1_lightcap(SurviveObject *obj, uint16_t time, uint8_t *packet, uint8_t length) {
-	bool has_errors = false;
-	uint8_t idx = 0;
-	uint8_t channel = 255;
-	SurviveContext *ctx = obj->ctx;
-	bool dump_binary = false;
-
-	while (idx < length) {
-		uint8_t data = packet[idx];
-
-		if (data & 0x1u) {
-			// Since they flag for this; I assume multiples can appear in a single packet. Need to plug in
-			// second LH to find out...
-
-			if ((data & 0x0Au) != 0) {
-				static int unknown_count = 0;
-				if(unknown_count++ < 10) {
-					// Currently I've only ever seen 0x1 if the 1 bit is set; I doubt they left 3 bits on the table
-					// though....
-					SV_WARN("Not entirely sure what this data is; errors may occur (%d, 0x%02x)\n", idx, data);
-					dump_binary = true;
-				}
-				// has_errors = true;
-				goto exit_loop;
-			}
-
-			// encodes like so: 0bcccc ?F?C
-			bool hasConflict = data & 0x04u;
-			if (hasConflict) {
-				uint8_t conflicted_channel = data >> 4u;
-				SV_WARN("Two or more lighthouses are on channel %d; tracking is most likely going to fail.",
-						conflicted_channel);
-			}
-			channel = data >> 4u;
-			SV_VERBOSE(750, "%s Channel %d (0x%02x)", obj->codename, channel, data);
-			idx++;
-		} else {
-			uint32_t timecode = 0;
-			memcpy(&timecode, packet + idx, sizeof(uint32_t));
-
-			uint32_t reference_time = (obj->activations.last_imu);
-
-			bool sync = timecode & 0x2u;
-			if (!sync) {
-				//                          O                               SC
-				//                         GO                               YH
-				//                         ET                               NA
-				//                    [??] NX[    24 bit time @ 48mhz      ]CN
-				// encodes like so: 0bXXXX ABTTT TTTT TTTT TTTT TTTT TTTT TTSC
-				bool ootx = (timecode >> 26u) & 1u;
-				bool g = (timecode >> 27u) & 1u;
-				uint32_t time24 = (timecode >> 2u) & 0xFFFFFFu;
-				timecode = fix_time24(ctx, time24, reference_time);
-				uint8_t unused = timecode >> 28;
-				if (unused && dump_binary) {
-					SV_WARN("Not sure what this is: %x", unused);
-				}
-				SV_VERBOSE(750, "Sync %s %02d %d %8u", obj->codename, channel, ootx, timecode);
-				if (channel == 255) {
-					SV_WARN("No channel specified for sync");
-					dump_binary = true;
-					// has_errors = true;
-				} else {
-					SURVIVE_INVOKE_HOOK_SO(sync, obj, channel, timecode, ootx, g);
-				}
-			} else {
-				//                                                         SC
-				//                                                         YH
-				//                                                         NA
-				//                    [SNSR][    25 bit time @ 96mhz      ]CN
-				// encodes like so: 0bSSSS STTT TTTT TTTT TTTT TTTT TTTT TFSC
-
-				// Since nothing in libsurvive thinks anything is 96mhz; pass in a flag
-				bool half_clock_flag = timecode & 0x4u;
-				uint8_t sensor = (timecode >> 27u);
-				timecode = fix_time24(ctx, (timecode >> 3u) & 0xFFFFFFu, reference_time);
-				SV_VERBOSE(750, "Sweep %s %02d.%02d %8u", obj->codename, channel, sensor, timecode);
-				if (channel == 255) {
-					SV_WARN("No channel specified for sweep");
-					dump_binary = true;
-					// has_errors = true;
-				} else {
-					SURVIVE_INVOKE_HOOK_SO(sweep, obj, channel, survive_map_sensor_id(obj, sensor), timecode,
-										   half_clock_flag);
-				}
-			}
-
-			if (channel == 255) {
-				dump_binary = true;
-				has_errors = true;
-				goto exit_loop;
-			}
-			idx += 4;
-		}
+static void dump_raw1_light(SurviveContext *ctx, const survive_watchman_packet *packet) {
+	for (const uint8_t *p = packet->light; p < packet->payload_end; p++) {
+		if ((p - packet->light + 2) % 4 == 0)
+			SURVIVE_INVOKE_HOOK(printf, ctx, "  ");
+		SURVIVE_INVOKE_HOOK(printf, ctx, "%02x ", *p);
 	}
 
-exit_loop:
+	SURVIVE_INVOKE_HOOK(printf, ctx, "\n");
+}
 
-	if (dump_binary) {
-		for (int i = 0; i < length; i++) {
-			if ((i + 2) % 4 == 0)
-				SURVIVE_INVOKE_HOOK(printf, ctx, "  ");
-			SURVIVE_INVOKE_HOOK(printf, ctx, "%02x ", packet[i]);
-		}
+static void report_watchman_notes(SurviveObject *w, const survive_watchman_packet *packet) {
+	SurviveContext *ctx = w->ctx;
 
-		SURVIVE_INVOKE_HOOK(printf, ctx, "\n");
+	if (packet->notes & SURVIVE_WATCHMAN_NOTE_HEARTBEAT) {
+		SV_VERBOSE(500, "Heartbeat(?) packet %s: '%s'", w->codename,
+				   PACKET_HEX(packet->payload, packet->payload_end));
 	}
-
-	return has_errors ? -1 : idx;
-}
-
-#define VERIFY_LENGTH_OR_FAIL(payloadPtr, len)                                                                         \
-	if (payloadEndPtr - payloadPtr < (len)) {                                                                          \
-		SV_WARN("%s handle_input needed %d bytes but had %u", w->codename, (len),                                      \
-				(uint32_t)(payloadEndPtr - payloadPtr));                                                               \
-		goto exit_failure;                                                                                             \
+	if (packet->notes & SURVIVE_WATCHMAN_NOTE_NON_LIGHT_DATA) {
+		SV_WARN("Light contains probable non-light data : 0x%02hX [Time:%04hX] [Payload: %s]", *packet->light,
+				packet->time, PACKET_HEX(packet->light, packet->payload_end));
 	}
-
-static bool handle_input(SurviveObject *w, uint8_t flags, uint8_t **payloadPtr, uint8_t *payloadEndPtr) {
-	/*
-	 * Flags for input events are as follows:
-	 *
-	 * ┄╦═╤═╤═╦═╤═╤═╤═╤═╦┄
-	 *  │1│1│1│1│-│t│m│b│
-	 * ┄╩═╧═╧═╩═╧═╧═╧═╧═╩┄
-	 *
-	 * t: Trigger    1 = Trigger data present in event [1 Byte]  ╮
-	 * m: Motion     1 = Motion data present in event [4 Byte]   ├ If all 0, this is a gen 2 event [See below]
-	 * b: Button     1 = Button data present in event [1 Byte]   ╯
-	 *
-	 * Order of data in payload is as follows:
-	 * ┄╦═══════════════╦═══════════════╦═══════════════╦═══════════════╦
-	 *  ║ [Button/b]    ║ [Trigger/t]   ║ [Motion/t]    ║ [IMU Data/I]  ║
-	 * ┄╩═══════════════╩═══════════════╩═══════════════╩═══════════════╩
-	 */
-	struct SurviveContext *ctx = w->ctx;
-	bool firstGen = ((flags & 0x7) != 0);
-	buttonEvent bEvent = { 0 };
-	uint8_t *payloadStart = *payloadPtr;
-
-	if (firstGen) {
-		bool flagUnknown = HAS_FLAG(flags, 0x8);
-		bool flagTrigger = HAS_FLAG(flags, 0x4);
-		bool flagMotion = HAS_FLAG(flags, 0x2);
-		bool flagButton = HAS_FLAG(flags, 0x1);
-
-		if (flagButton) {
-			bEvent.pressedButtonsValid = 1;
-			VERIFY_LENGTH_OR_FAIL(*payloadPtr, 1);
-			bEvent.pressedButtons = POP_BYTE(*payloadPtr);
-		}
-
-		if (flagTrigger) {
-			bEvent.triggerHighResValid = 1;
-			VERIFY_LENGTH_OR_FAIL(*payloadPtr, 1);
-			bEvent.triggerHighRes = POP_BYTE(*payloadPtr) / 255.;
-		}
-
-		if (flagMotion) {
-			bEvent.touchpadHorizontalValid = 1;
-			bEvent.touchpadVerticalValid = 1;
-
-			VERIFY_LENGTH_OR_FAIL(*payloadPtr, 4);
-			bEvent.touchpadHorizontal = (int16_t)POP_SHORT(*payloadPtr) / 32768.;
-			bEvent.touchpadVertical = (int16_t)POP_SHORT(*payloadPtr) / 32768.;
-		}
-
-		if (flagUnknown) {
-			SV_VERBOSE(150, "Unknown flag in handle_inut");
-		}
-		SV_VERBOSE(150, "handle_input flags %d %d %d", flagButton, flagTrigger, flagMotion);
-	} else {
-		// Second gen event (Eg Knuckles proximity)
-		uint8_t genTwoType =
-			POP_BYTE(*payloadPtr); // May be flags, but currently only observed to be 'a1' when knuckles
-
-		if (genTwoType == 0xA1) {
-			// Knuckles
-
-			// Resistive contact sensors in buttons?
-			VERIFY_LENGTH_OR_FAIL(*payloadPtr, 7);
-			uint8_t touchFlags = POP_BYTE(*payloadPtr);
-			// 0x01 = Trigger
-			// 0x08 = Menu
-			// 0x10 = Button A
-			// 0x20 = Button B
-			// 0x40 = Thumbstick
-
-			bEvent.touchedButtonsValid = 1;
-			bEvent.touchedButtons = (touchFlags & ~0x40u);
-			bEvent.touchedButtons |= ((touchFlags & 0x40u) >> 4);
-
-			bEvent.proximityValid = 1;
-
-			// Non-touching proximity to fingers
-			bEvent.proximity[0] = POP_BYTE(*payloadPtr) / 255.; // Middle finger
-			bEvent.proximity[1] = POP_BYTE(*payloadPtr) / 255.; // Ring finger
-			bEvent.proximity[2] = POP_BYTE(*payloadPtr) / 255.; // Pinky finger
-			bEvent.proximity[3] = POP_BYTE(*payloadPtr) / 255.; // Index finger (trigger)
-
-			// Contact force (Squeeze strength)
-			bEvent.proximity[4] = POP_BYTE(*payloadPtr) / 255.;
-			// Trackpad force
-			bEvent.proximity[5] = POP_BYTE(*payloadPtr) / 255.;
-		} else {
-			SV_WARN("Unknown gen two event 0x%02hX 0b%s [Payload: %s] <<ABORT FURTHER READ>>", *(*payloadPtr - 1),
-					byteToBin(*(*payloadPtr - 1)), packetToHex(*payloadPtr, payloadEndPtr));
-			// Since we don't know how much data this should consume, proceeding to IMU/Light decode is likely
-			// to choke.
-			return false;
+	if (packet->notes & SURVIVE_WATCHMAN_NOTE_CHANNEL_CONFLICT) {
+		SV_WARN("Two or more lighthouses are on channel %d; tracking is most likely going to fail.",
+				packet->conflicted_channel);
+	}
+	if (packet->notes & SURVIVE_WATCHMAN_NOTE_UNKNOWN_RAW1) {
+		static int unknown_count = 0;
+		if (unknown_count++ < 10) {
+			// Currently I've only ever seen 0x1 if the 1 bit is set; I doubt they left 3 bits on the table
+			// though....
+			SV_WARN("Not entirely sure what this data is; errors may occur (%d, 0x%02x)\n",
+					(int)(packet->read_end - packet->light), *packet->read_end);
+			dump_raw1_light(ctx, packet);
 		}
 	}
+}
 
-	registerButtonEvent(w, &bEvent, BUTTON_EVENT_SOURCE_RF);
-	return true;
+/**
+ * Logs why a packet failed to decode; returns whether the packet is worth dumping in full.
+ */
+static bool report_watchman_error(SurviveObject *w, const survive_watchman_packet *packet) {
+	SurviveContext *ctx = w->ctx;
+	const uint8_t *end = packet->payload_end;
 
-exit_failure:
+	switch (packet->status) {
+	case SURVIVE_WATCHMAN_ERROR_SIZE:
+		SV_WARN("%s watchman packet is larger than its report [Time:%04hX]", w->codename, packet->time);
+		return false;
+	case SURVIVE_WATCHMAN_ERROR_TRUNCATED:
+		SV_WARN("%s watchman packet ended partway through an event; %u bytes were left", w->codename,
+				(uint32_t)(end - packet->read_end));
+		return true;
+	case SURVIVE_WATCHMAN_ERROR_UNKNOWN_INPUT:
+		SV_WARN("Unknown gen two event %s 0x%02hX 0b%s [Time:%04hX] [Payload: %s] <<ABORT FURTHER READ>>",
+				w->codename, packet->error_byte, BYTE_BIN(packet->error_byte), packet->time,
+				PACKET_HEX(packet->read_end, end));
+		return true;
+	case SURVIVE_WATCHMAN_ERROR_UNKNOWN_STATUS:
+		SV_WARN("Unknown status event 0x%02hX [Time:%04hX] [Payload: %s] <<ABORT FURTHER READ>>", packet->error_byte,
+				packet->time, PACKET_HEX(packet->read_end, end));
+		return true;
+	case SURVIVE_WATCHMAN_ERROR_UNKNOWN_METADATA:
+		SV_VERBOSE(100, "%.7f %s Unknown metadata marker in v2 (%02x %02x) bytes dropping rest of data %s",
+				   survive_run_time(ctx), w->codename, packet->flags, packet->error_byte,
+				   PACKET_HEX(packet->payload, end));
+		return false;
+	case SURVIVE_WATCHMAN_ERROR_TOO_MANY_EVENTS:
+		SV_WARN("%s watchman packet holds more than %d events", w->codename, SURVIVE_WATCHMAN_MAX_EVENTS);
+		return true;
+	case SURVIVE_WATCHMAN_ERROR_LIGHT:
+		SV_WARN("Read light data error %d   [Time:%04hX] [Payload: %s]", packet->light_error, packet->time,
+				PACKET_HEX(packet->light, end));
+		return false;
+	case SURVIVE_WATCHMAN_ERROR_NO_CHANNEL:
+		SV_WARN("No channel specified for sync / sweep");
+		dump_raw1_light(ctx, packet);
+		return true;
+	}
 	return false;
 }
 
-static void handle_watchman_v2(SurviveObject *w, uint64_t time_in_us, uint16_t time, uint8_t *payloadPtr,
-							   uint8_t *payloadEndPtr) {
+static void handle_watchman_v2(SurviveObject *w, uint64_t time_in_us, const uint8_t *readdata) {
 	struct SurviveContext *ctx = w->ctx;
-	const uint8_t *originPayloadPtr = payloadPtr;
 	struct SurviveUSBInfo *driverInfo = w->driver;
 	if (driverInfo->nextCfgSubmitTime >= 0) {
 		return;
@@ -2309,15 +1877,6 @@ static void handle_watchman_v2(SurviveObject *w, uint64_t time_in_us, uint16_t t
 		return;
 	}
 
-	uint8_t flags = POP_BYTE(payloadPtr);
-	bool has_errors = false;
-
-	// Some kind of startup heartbeat?
-	if (flags == 0xe2) {
-		SV_VERBOSE(500, "Heartbeat(?) packet %s: '%s'", w->codename, packetToHex(payloadPtr, payloadEndPtr));
-		return;
-	}
-
 	// Info: Watchman v2(KN1): '34 f2 3f 9f a2 c9             | 61 06 8c 0a 44 '
 	// Info: Watchman v2(KN1): '34 f2 7a 9e fe c8             | 61 b4 6e 27 02 7e 95 7c 7c d6 b3 7c 5c a6 da 7c bc '
 	// Info: Watchman v2(KN1): '38 f0 a1 00 2a 00 00 1c 00 01 | 61 32 9d 62 15 2e d8 62 0d 62 26 63 45 '
@@ -2352,62 +1911,19 @@ static void handle_watchman_v2(SurviveObject *w, uint64_t time_in_us, uint16_t t
 	// Info: Watchman v2(KN1): '80 a5 4c fb 8f f1 f2 f9 d3 ff 2c 00 df ff '
 	// Info: Watchman v2(KN1): 'c0 92 52 fb 7d f1 ea f9 ce ff 2f 00 dc ff 20 01 '
 
-	// bool has_errors = !read_event(w, time, &payloadPtr, payloadEndPtr);
-
-	bool flagUnknown01 = HAS_FLAG(flags, 0x01);
-	bool flagUnknown02 = HAS_FLAG(flags, 0x02);
-	// Haptic on the trackpad thing on the knuckles?
-	bool flagUnknown04 = HAS_FLAG(flags, 0x04);
-	bool flagUnknown08 = HAS_FLAG(flags, 0x08);
+	survive_watchman_decode_params params = {
+		.v2 = true, .raw1 = driverInfo->lightcapMode == LightcapMode_raw1, .reference_time = w->activations.last_imu};
+	survive_watchman_packet packet;
+	bool has_errors = !survive_watchman_decode(&params, readdata, SURVIVE_WATCHMAN_PACKET_SIZE, &packet);
 
+	uint8_t flags = packet.flags;
 	bool flagLightcap = HAS_FLAG(flags, 0x10);
-	bool flagInput = HAS_FLAG(flags, 0x20);
-	bool flagMetaData = HAS_FLAG(flags, 0x40);
-	bool flagIMU = HAS_FLAG(flags, 0x80);
-
 	if (HAS_FLAG(flags, ~0xD1)) {
 		SV_VERBOSE(100, "%s Unknown flag %02x", w->codename, flags);
 	}
-
-	if (flagIMU)
-		read_imu_data(w, time_in_us, time, &payloadPtr, payloadEndPtr);
-
-	// These things happen every 10 seconds
-	if (flagMetaData) {
-		uint8_t marker_byte = POP_BYTE(payloadPtr);
-
-		switch (marker_byte) {
-		case 0x80: {
-			uint8_t battery_byte = POP_BYTE(payloadPtr);
-			handle_battery(w, battery_byte);
-			break;
-		}
-		case 0x20: {
-			// Mode?
-			uint8_t unknown_byte = POP_BYTE(payloadPtr);
-			break;
-		}
-		case 0x30: {
-			// Only have seen zeros here
-			uint8_t unknown_byte1 = POP_BYTE(payloadPtr);
-			uint8_t unknown_byte2 = POP_BYTE(payloadPtr);
-			break;
-		}
-		default:
-			SV_VERBOSE(100, "%.7f %s Unknown metadata marker in v2 (%02x %02x) bytes dropping rest of data %s",
-					   survive_run_time(ctx), w->codename, flags, marker_byte,
-					   packetToHex(originPayloadPtr, payloadEndPtr));
-			return;
-		}
-	} else {
+	if (!HAS_FLAG(flags, 0x40)) {
 		SV_VERBOSE(700, "%.7f %s ref flag 0x40(0x%x) bytes rest of data %s", survive_run_time(ctx), w->codename, flags,
-				   packetToHex(originPayloadPtr, payloadEndPtr));
-	}
-
-	if (flagInput) {
-		VERIFY_LENGTH_OR_FAIL(payloadPtr, 1);
-		uint8_t input_flags = POP_BYTE(payloadPtr);
-		has_errors = !handle_input(w, input_flags, &payloadPtr, payloadEndPtr);
+				   PACKET_HEX(packet.payload, packet.payload_end));
 	}
 
 	if (driverInfo->packetsSeenWaitingForV2 > 200) {
@@ -2415,44 +1931,42 @@ static void handle_watchman_v2(SurviveObject *w, uint64_t time_in_us, uint16_t t
 		driverInfo->timeWithoutFlag = 0;
 	}
 
+	// Right after a mode switch, light data is still in the old mode
+	bool discard_light = false;
 	if (driverInfo->timeWithoutFlag > 0 && driverInfo->timeWithoutFlag < 20) {
 		driverInfo->packetsSeenWaitingForV2++;
 		if (flagLightcap) {
 			driverInfo->timeWithoutFlag = 1;
-			flagLightcap = false;
+			discard_light = true;
 
 			SV_VERBOSE(200, "Discard %s %lu: '%s'", w->codename, driverInfo->timeWithoutFlag,
-					   packetToHex(payloadPtr, payloadEndPtr));
+					   PACKET_HEX(packet.light ? packet.light : packet.read_end, packet.payload_end));
 		} else {
 			driverInfo->timeWithoutFlag++;
 		}
 	}
 
-	if (flagLightcap && !has_errors) {
-		if (driverInfo->lightcapMode == LightcapMode_raw0) {
-			parse_and_process_lightcap(w, time, payloadPtr, payloadEndPtr);
-		} else {
-			int read = parse_and_process_raw1_lightcap(w, time, payloadPtr, payloadEndPtr - payloadPtr);
-			if (read == -1)
-				has_errors = true;
-			else
-				payloadPtr += read;
-		}
+	// Whatever went wrong in discarded light data doesn't matter
+	if (discard_light && packet.light) {
+		has_errors = false;
+	} else {
+		report_watchman_notes(w, &packet);
 	}
 
-	if (driverInfo->timeWithoutFlag == 20) {
-		if (payloadPtr != payloadEndPtr) {
-			has_errors = true;
-			SV_WARN("Did not read full input packet; %ld bytes remain", payloadEndPtr - payloadPtr);
+	dispatch_watchman_events(w, time_in_us, &packet, discard_light);
+
+	bool dump = has_errors && report_watchman_error(w, &packet);
+
+	if (!has_errors && driverInfo->timeWithoutFlag == 20) {
+		if (packet.read_end != packet.payload_end) {
+			dump = true;
+			SV_WARN("Did not read full input packet; %ld bytes remain", (long)(packet.payload_end - packet.read_end));
 		}
 	}
 
-	if (!has_errors) {
-		return;
+	if (dump) {
+		survive_dump_buffer(ctx, packet.payload, packet.payload_end - packet.payload);
 	}
-
-exit_failure:
-	survive_dump_buffer(ctx, originPayloadPtr, payloadEndPtr - originPayloadPtr);
 }
 
 static bool use_watchman_v2(SurviveObject *w) {
@@ -2509,38 +2023,19 @@ void survive_handle_watchman(SurviveObject *w, uint64_t time_in_us, uint8_t *rea
 	 *   bits 7&8 cannot both be 1, results in the range 00000XXX to 10111XXX yielding a maximum of 24 light
 	 *   elements per device (In the current format).
 	 *
-	 * Packet Decode Process:
-	 *   1) Read off Time (MSB and LSB) and Payload Size
-	 *   2) If bits 6-8 of the byte 4 are set:
-	 *       a) Read the input/status event
-	 *       b) Compute the remaining bytes after the input/status event has been read (The size of the input/status
-	 *          event is not explicitly provided, so must be implied by the event type.
-	 *   3) Read an interpret any remaining bytes as light data
-	 *
-	 *   Watchman V2:
-	 *
-	 *   Watchman protocol V2 has the same time / size breakdown as V1 but is followed with a flags byte:
-	 *   0bIMPL xxxx
-	 *     ||||
-	 *     ||||- Has Light data
-	 *     |||- Has Input
-	 *     ||- Has Metadata
-	 *     |- Has IMU data
+	 * Watchman V2 has a flags byte up front instead; see survive_watchman.c.
 	 *
+	 * survive_watchman_decode does the parsing without touching the object; the events it finds are dispatched
+	 * afterwards.
 	 */
-
-	uint16_t time = AS_SHORT(readdata[0], readdata[2]);
-	uint8_t payloadSize = readdata[1] - 1;
-	uint8_t *payloadPtr = &readdata[3];
-	uint8_t *payloadEndPtr = payloadPtr + payloadSize;
-
 	if (use_watchman_v2(w)) {
-		SV_VERBOSE(750, "Watchman v2(%s): '%s'", w->codename, packetToHex(readdata, payloadEndPtr));
-		handle_watchman_v2(w, time_in_us, time, payloadPtr, payloadEndPtr);
+		SV_VERBOSE(750, "Watchman v2(%s): '%s'", w->codename,
+				   PACKET_HEX(readdata, readdata + SURVIVE_WATCHMAN_PACKET_SIZE));
+		handle_watchman_v2(w, time_in_us, readdata);
 		return;
 	}
 
-	SV_VERBOSE(750, "Watchman v1(%s): %s", w->codename, packetToHex(payloadPtr, payloadEndPtr));
+	SV_VERBOSE(750, "Watchman v1(%s): %s", w->codename, PACKET_HEX(readdata, readdata + SURVIVE_WATCHMAN_PACKET_SIZE));
 	/*
 	if (w->ctx->lh_version == -1) {
 		attempt_lh_detection(w, payloadPtr, payloadEndPtr);
@@ -2551,39 +2046,17 @@ void survive_handle_watchman(SurviveObject *w, uint64_t time_in_us, uint8_t *rea
 		return;
 	}
 
-	// Read any non-light events that may be in the packet
-	if (!read_event(w, time_in_us, time, &payloadPtr, payloadEndPtr)) {
-		SV_WARN("Read event failed; full payload: %s", packetToHex(&readdata[3], payloadEndPtr));
-		return;
-	}
-
-	// Any remaining data after events (if any) have been read off is light data
-	if (payloadPtr < payloadEndPtr) {
-		LightcapElement les[10] = {0};
-		int32_t cnt = read_light_data(w, time, &payloadPtr, payloadEndPtr, les, 10);
-
-		if (cnt < 0) {
-			SV_WARN("Read light data error %d   [Time:%04hX] [Payload: %s]", (int)cnt, time,
-					packetToHex(payloadPtr, payloadEndPtr));
+	survive_watchman_decode_params params = {.reference_time = w->activations.last_imu};
+	survive_watchman_packet packet;
+	bool ok = survive_watchman_decode(&params, readdata, SURVIVE_WATCHMAN_PACKET_SIZE, &packet);
 
-		} else {
-
-#ifdef VERIFY_LIGHTCAP
-			LightcapElement les_old[10] = {0};
-			int les_old_cnt = parse_watchman_lightcap(w->ctx, w->codename, time >> 8, w->activations.last_imu,
-													  payloadPtr, payloadEndPtr - payloadPtr, les, 10);
+	report_watchman_notes(w, &packet);
+	dispatch_watchman_events(w, time_in_us, &packet, false);
 
-			assert(cnt == les_old_cnt);
-#endif
-			for (int i = (int)cnt - 1; i >= 0; i--) {
-#ifdef DEBUG_WATCHMAN
-				printf("%d: %u [%u]\n", les[i].sensor_id, les[i].length, les[i].timestamp);
-#endif
-#ifdef VERIFY_LIGHTCAP
-				assert(memcmp(&les[i], &les_old[i], sizeof(LightcapElement)) == 0);
-#endif
-				handle_lightcap(w, &les[i]);
-			}
+	if (!ok) {
+		report_watchman_error(w, &packet);
+		if (packet.light == 0) {
+			SV_WARN("Read event failed; full payload: %s", PACKET_HEX(packet.payload, packet.payload_end));
 		}
 	}
 }
@@ -3002,8 +2475,9 @@ void survive_data_cb_locked(uint64_t time_received_us, SurviveUSBInterface *si)
 
 		bool dump_binary = false;
 		if (id == VIVE_REPORT_USB_LIGHTCAP_REPORT_V1) { // LHv1
-			int i;
-			for (i = 0; i < 9 && readdata < enddata; i++) {
+			LightcapElement les[9];
+			size_t cnt = 0;
+			for (int i = 0; i < 9 && readdata < enddata; i++) {
 				assert((enddata - readdata) >= 7);
 				LightcapElement le;
 				le.sensor_id = POP1;
@@ -3014,17 +2488,17 @@ void survive_data_cb_locked(uint64_t time_received_us, SurviveUSBInterface *si)
 				SV_VERBOSE(300, "%s %s %7.6f %7.6f %2u %2u %5u %08x %4d", survive_colorize(obj->codename),
 						   survive_colorize("LIGHTCAP"), survive_run_time(ctx), le.timestamp / 48000000., id,
 						   le.sensor_id, le.length, le.timestamp, (int)(si->buffer + size - readdata));
+				les[cnt++] = le;
+			}
 
-				if (obj->ctx->lh_version != 1) {
-					bool success = handle_lightcap(obj, &le);
-					if (!success)
-						dump_binary = 1;
-				}
+			if (obj->ctx->lh_version != 1) {
+				dump_binary = !handle_lightcaps(obj, les, cnt);
+			}
 
-				if (dump_binary) {
-					SV_VERBOSE(100, "%s sensor: %2d         time: %3.5f length: %4d end_time: %8u", obj->codename,
-							   le.sensor_id, le.timestamp / 48000000., le.length, le.length + le.timestamp);
-				}
+			for (size_t i = 0; dump_binary && i < cnt; i++) {
+				SV_VERBOSE(100, "%s sensor: %2d         time: %3.5f length: %4d end_time: %8u", obj->codename,
+						   les[i].sensor_id, les[i].timestamp / 48000000., les[i].length,
+						   les[i].length + les[i].timestamp);
 			}
 		} else if (id == VIVE_REPORT_USB_LIGHTCAP_REPORT_V2) { // LHv2
 			if (obj->ctx->lh_version == 0) {
@@ -3251,6 +2725,13 @@ void survive_data_cb_locked(uint64_t time_received_us, SurviveUSBInterface *si)
 
 int survive_vive_close(SurviveContext *ctx, void *driver) {
 	SurviveViveData *sv = driver;
+	if (sv->rx_decode_thread) {
+		sv->rx_decode_running = false;
+		survive_release_ctx_lock(ctx);
+		OGJoinThread(sv->rx_decode_thread);
+		survive_get_ctx_lock(ctx);
+		sv->rx_decode_thread = 0;
+	}
 #ifndef HIDAPI
 	libusb_hotplug_deregister_callback(sv->usbctx, sv->callback_handle);
 #endif
@@ -3271,6 +2752,8 @@ int survive_vive_close(SurviveContext *ctx, void *driver) {
 		}
 	}
 	survive_vive_usb_close(sv);
+	if (sv->rx_lock)
+		OGDeleteMutex(sv->rx_lock);
 	free(sv);
 	return 0;
 }
@@ -3286,6 +2769,12 @@ int DriverRegHTCVive(SurviveContext *ctx) {
 	}
 	sv->ctx = ctx;
 
+	sv->rx_queue = survive_configi(ctx, USB_RX_QUEUE_TAG, SC_GET, 0);
+	int rx_queue_size = survive_configi(ctx, USB_RX_QUEUE_SIZE_TAG, SC_GET, 1024);
+	sv->rx_queue_size = rx_queue_size > 0 ? rx_queue_size : 1024;
+	if (sv->rx_queue)
+		sv->rx_lock = OGCreateMutex();
+
 	// USB must happen last.
 	if (survive_usb_init(sv)) {
 		// TODO: Cleanup any libUSB stuff sitting around.
@@ -3308,6 +2797,11 @@ int DriverRegHTCVive(SurviveContext *ctx) {
 
 	if (sv->udev_cnt || hasHotplug) {
 		survive_add_driver(ctx, sv, survive_vive_usb_poll, survive_vive_close);
+		if (sv->rx_queue) {
+			SV_INFO("Decoding USB packets on a dedicated thread; %u packets buffered per interface", sv->rx_queue_size);
+			sv->rx_decode_running = true;
+			sv->rx_decode_thread = OGCreateThread(survive_vive_rx_decode_thread, "usb decode", sv);
+		}
 	} else {
 		SV_INFO("No USB devices detected");
 		goto fail_gracefully;
@@ -3332,6 +2826,8 @@ int DriverRegHTCVive(SurviveContext *ctx) {
 	return 0;
 fail_gracefully:
 	survive_vive_usb_close(sv);
+	if (sv->rx_lock)
+		OGDeleteMutex(sv->rx_lock);
 	free(sv);
 	return -1;
 }
@@ -18,6 +18,7 @@
 #endif
 
 #include "os_generic.h"
+#include "survive_spsc_ring.h"
 
 #define MAX_USB_DEVS 32
 
@@ -77,6 +78,13 @@ void survive_usb_handle_close(libsurvive_usb_handle *handle);
 
 struct SurviveUSBInfo;
 
+// Slot type of the per interface receive rings used with 'usb-rx-queue'
+typedef struct survive_usb_rx_packet {
+	uint64_t time_received_us;
+	int32_t length;
+	uint8_t data[INTBUFFSIZE];
+} survive_usb_rx_packet;
+
 typedef struct SurviveUSBInterface {
 	struct SurviveViveData *sv;
 	SurviveContext *ctx;
@@ -108,6 +116,12 @@ typedef struct SurviveUSBInterface {
 	uint64_t last_submit_time, sum_submit_cb_time, sum_cb_time;
 	uint32_t max_submit_time, max_cb_time, cb_time_violation;
 	bool shutdown;
+
+	// With 'usb-rx-queue', the receiving side only copies packets into this ring; the decode thread drains it.
+	survive_spsc_ring rx_ring;
+#ifdef HIDAPI
+	og_thread_t rx_thread;
+#endif
 } SurviveUSBInterface;
 
 SURVIVE_EXPORT void survive_dump_buffer(SurviveContext *ctx, const uint8_t *data, size_t length);
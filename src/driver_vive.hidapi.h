@@ -97,6 +97,35 @@ static void *HAPIReceiver(void *v) {
 	return 0;
 }
 
+// Blocking receive loop used with 'usb-rx-queue'; one thread per interface, which never takes the context lock.
+static void *HAPIReceiveThread(void *v) {
+	SurviveUSBInterface *iface = v;
+	USB_INTERFACE_HANDLE *hp = &iface->uh;
+
+	while (!iface->shutdown) {
+		iface->actual_len = hid_read_timeout(*hp, iface->buffer, sizeof(iface->swap_buffer[0]), 100);
+		if (iface->actual_len > 0) {
+			iface->packet_count++;
+			iface->cb(OGGetAbsoluteTimeUS(), iface);
+		} else if (iface->actual_len < 0) {
+			iface->usbInfo->request_close = true;
+			break;
+		}
+	}
+	return 0;
+}
+
+static inline void survive_usb_stop_receive_threads(struct SurviveUSBInfo *usbInfo) {
+	for (size_t i = 0; i < usbInfo->interface_cnt; i++) {
+		SurviveUSBInterface *iface = &usbInfo->interfaces[i];
+		iface->shutdown = true;
+		if (iface->rx_thread) {
+			OGJoinThread(iface->rx_thread);
+			iface->rx_thread = 0;
+		}
+	}
+}
+
 typedef struct hid_device_info *survive_usb_device_t;
 typedef struct hid_device_info *survive_usb_devices_t;
 
@@ -184,6 +213,7 @@ static survive_usb_device_t get_next_device(survive_usb_device_enumerator* d, su
 static bool setup_hotplug(SurviveViveData *sv) { return true; }
 
 static inline void survive_close_usb_device(struct SurviveUSBInfo *usbInfo) {
+	survive_usb_stop_receive_threads(usbInfo);
 	for (int j = 0; j < 8; j++) {
 		hid_close(usbInfo->handle->interfaces[j]);
 	}
@@ -1,4 +1,7 @@
 #include "lfsr_lh2.h"
+#include "force_O3.h"
+#include <stdlib.h>
+#include <string.h>
 #ifndef _MSC_VER
 #include "alloca.h"
 #define clz(x) __builtin_clz(x)
@@ -15,13 +18,35 @@ uint32_t inline clz(uint32_t value) {
 	}
 }
 #endif
-#include "stdio.h"
-#include "string.h"
 #if !defined(__FreeBSD__) && !defined(__APPLE__)
 #include <malloc.h>
 #endif
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#define LH2_LOAD_ACQUIRE(p) (_ReadWriteBarrier(), *(void *volatile *)(p))
+#define LH2_PUBLISH(p, v) (_InterlockedCompareExchangePointer((void *volatile *)(p), (v), 0) == 0)
+#else
+#define LH2_LOAD_ACQUIRE(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+static inline bool LH2_PUBLISH(void **p, void *v) {
+	void *expected = 0;
+	return __atomic_compare_exchange_n(p, &expected, v, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+#endif
 
-lfsr_poly_t poly_pairs[32] = {
+#define LH2_ORDER 17
+#define LH2_STATE_MASK 0x1ffffu
+#define LH2_POLY_CNT 32
+// Positions of the known run of 17 bits that are looked for, counting down from the top of the window
+#define LH2_OFFSET_CNT 15
+// Every LH2_GIANT_STEP'th state of a sequence is indexed; a state's position is found by stepping to the next of those
+#define LH2_GIANT_STEP 64
+#define LH2_GIANT_CNT ((LH2_STATE_MASK + LH2_GIANT_STEP - 1) / LH2_GIANT_STEP)
+#define LH2_STATE_WORDS ((LH2_STATE_MASK + 1) / 64)
+
+static const lfsr_poly_t poly_pairs[LH2_POLY_CNT] = {
 	// x^17 + x^13 + x^12 + x^10 + x^7 + x^4 + x^2 + x^1 + 1
 	//   0123456789ABCDEF01
 	// 0b11101001001011000
@@ -62,73 +87,280 @@ lfsr_poly_t poly_pairs[32] = {
 	0x0001CB8D,
 };
 
-struct lfsr_lookup_t *poly_pair_lookups[32] = {0};
-static void init_lookups() {
-	if (poly_pair_lookups[0] == 0) {
-		for (int i = 0; i < 32; i++)
-			poly_pair_lookups[i] = lfsr_lookup_ctor(poly_pairs[i]);
-	}
+/*
+ * An LFSR step is linear over GF(2), so any fixed number of steps is a 17x17 bit matrix; those are stored as their
+ * columns, one uint32_t each.
+ */
+typedef struct lh2_poly_tables {
+	// State to the 32 bit window it starts
+	uint32_t window[LH2_ORDER];
+	// A^(2^k) and A^-(2^k), A being one step
+	uint32_t forward[LH2_ORDER][LH2_ORDER];
+	uint32_t backward[LH2_ORDER][LH2_ORDER];
+	// Known run of 17 bits, 'offset' below the top of the window, to the whole window
+	uint32_t from_run[LH2_OFFSET_CNT][LH2_ORDER];
+
+	// Which states are giant steps, how many giant step states come before each word of that bitmap, and which giant
+	// step each of them is in state order
+	uint64_t giant_bits[LH2_STATE_WORDS];
+	uint16_t giant_rank[LH2_STATE_WORDS];
+	uint16_t giant_of_rank[LH2_GIANT_CNT];
+	uint32_t period;
+} lh2_poly_tables;
+
+typedef struct lh2_tables {
+	// from_run of every polynomial, bitsliced: bit i of candidates[offset][k][b] is bit b of
+	// polys[i].from_run[offset][k]
+	uint32_t candidates[LH2_OFFSET_CNT][LH2_ORDER][32];
+	lh2_poly_tables polys[LH2_POLY_CNT];
+} lh2_tables;
+
+static inline uint32_t lh2_parity(uint32_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_parity(v);
+#else
+	v ^= v >> 16;
+	v ^= v >> 8;
+	v ^= v >> 4;
+	return (0x6996u >> (v & 0xfu)) & 1u;
+#endif
 }
 
-static uint32_t find_possible_polys(uint32_t sample, uint32_t mask, uint32_t *timings, uint32_t *reconstructed_sample) {
-	uint8_t offset = 255;
-	for (uint8_t i = 0; i < 15; i++) {
-		if (((mask >> (15 - i)) & 0x1ffff) == 0x1ffff) {
-			offset = i;
-			break;
+static inline uint32_t lh2_popcount(uint32_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcount(v);
+#else
+	v = v - ((v >> 1) & 0x55555555u);
+	v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+	return (((v + (v >> 4)) & 0x0f0f0f0fu) * 0x01010101u) >> 24;
+#endif
+}
+
+static inline uint32_t lh2_popcount64(uint64_t v) {
+	return lh2_popcount((uint32_t)v) + lh2_popcount((uint32_t)(v >> 32));
+}
+
+static inline uint32_t lh2_step(uint32_t state, lfsr_poly_t poly) {
+	return ((state << 1u) | lh2_parity(state & poly)) & LH2_STATE_MASK;
+}
+
+// The bit shifted out is the top tap, so it's whatever makes the feedback come out to the bit shifted in
+static inline uint32_t lh2_step_back(uint32_t state, lfsr_poly_t poly) {
+	uint32_t prev = state >> 1u;
+	return prev | (((state & 1u) ^ lh2_parity(prev & poly)) << (LH2_ORDER - 1));
+}
+
+static inline uint32_t gf2_apply(const uint32_t *cols, uint32_t v) {
+	uint32_t rtn = 0;
+	for (int c = 0; c < LH2_ORDER; c++)
+		rtn ^= cols[c] & (0u - ((v >> c) & 1u));
+	return rtn;
+}
+
+static void gf2_square(uint32_t *out, const uint32_t *cols) {
+	for (int c = 0; c < LH2_ORDER; c++)
+		out[c] = gf2_apply(cols, cols[c]);
+}
+
+static void lh2_poly_tables_build(lh2_poly_tables *t, lfsr_poly_t poly) {
+	for (int c = 0; c < LH2_ORDER; c++) {
+		uint32_t window = 1u << c;
+		for (int i = 0; i < 32 - LH2_ORDER; i++)
+			window = (window << 1u) | lh2_parity(window & poly);
+		t->window[c] = window;
+
+		t->forward[0][c] = lh2_step(1u << c, poly);
+		t->backward[0][c] = lh2_step_back(1u << c, poly);
+	}
+
+	for (int c = 0; c < LH2_ORDER; c++) {
+		uint32_t state = 1u << c;
+		for (int offset = 0; offset < LH2_OFFSET_CNT; offset++) {
+			t->from_run[offset][c] = gf2_apply(t->window, state);
+			state = lh2_step_back(state, poly);
 		}
 	}
 
-	uint32_t rtn = 0xFFFFFFFF;
-	if (offset == 255) {
-		return rtn;
+	for (int k = 1; k < LH2_ORDER; k++) {
+		gf2_square(t->forward[k], t->forward[k - 1]);
+		gf2_square(t->backward[k], t->backward[k - 1]);
 	}
 
-	for (int i = 0; i < 32; i++) {
-		uint32_t state = (sample >> (15u - offset));
+	// Positions count from state 1
+	uint32_t giant_states[LH2_GIANT_CNT + 1];
+	uint32_t state = 1, idx = 0;
+	do {
+		if (idx % LH2_GIANT_STEP == 0) {
+			t->giant_bits[state / 64] |= 1ull << (state % 64);
+			giant_states[idx / LH2_GIANT_STEP] = state;
+		}
+		state = lh2_step(state, poly);
+		idx++;
+	} while (state != 1 && idx <= LH2_STATE_MASK);
+	t->period = idx;
 
-		uint32_t start_state = lsfr_iterate_rev(state, poly_pairs[i], offset);
-		uint32_t final_state = lsfr_iterate(start_state, poly_pairs[i], 15);
+	uint32_t cnt = 0;
+	for (int w = 0; w < LH2_STATE_WORDS; w++) {
+		t->giant_rank[w] = cnt;
+		cnt += lh2_popcount64(t->giant_bits[w]);
+	}
+	for (uint32_t g = 0; g * LH2_GIANT_STEP < t->period; g++) {
+		uint32_t s = giant_states[g];
+		uint32_t rank = t->giant_rank[s / 64] + lh2_popcount64(t->giant_bits[s / 64] & ((1ull << (s % 64)) - 1));
+		t->giant_of_rank[rank] = g;
+	}
+}
 
-		uint32_t error_bits = (final_state ^ sample) & mask;
-		uint32_t error = popcnt(error_bits);
+static lh2_tables *lh2_tables_build() {
+	lh2_tables *tables = SV_CALLOC(sizeof(lh2_tables));
+	for (int i = 0; i < LH2_POLY_CNT; i++) {
+		lh2_poly_tables *t = &tables->polys[i];
+		lh2_poly_tables_build(t, poly_pairs[i]);
 
-		if (error > 0) {
-			if (((i / 2) == 6) || ((i / 2) == 15))
-				fprintf(stderr, "Error for %d was %d %x %x %x\n", i, error, final_state & mask, sample & mask, mask);
-			rtn ^= (1 << i);
-		} else {
-			timings[i] = lfsr_lookup_query(poly_pair_lookups[i], state) - offset;
-			reconstructed_sample[i] = final_state;
-			fprintf(stderr, "Timing for %d was %u\n", i, timings[i]);
+		for (int offset = 0; offset < LH2_OFFSET_CNT; offset++)
+			for (int k = 0; k < LH2_ORDER; k++)
+				for (int b = 0; b < 32; b++)
+					tables->candidates[offset][k][b] |= ((t->from_run[offset][k] >> b) & 1u) << i;
+	}
+	return tables;
+}
+
+// Built on first use and shared by every context for the life of the process
+static lh2_tables *lh2_tables_instance;
+static const lh2_tables *lh2_get_tables() {
+	lh2_tables *tables = LH2_LOAD_ACQUIRE(&lh2_tables_instance);
+	if (tables) {
+		return tables;
+	}
+
+	tables = lh2_tables_build();
+	if (!LH2_PUBLISH((void **)&lh2_tables_instance, tables)) {
+		free(tables);
+		tables = LH2_LOAD_ACQUIRE(&lh2_tables_instance);
+	}
+	return tables;
+}
+
+// Position of a state in the polynomial's sequence
+static uint32_t lh2_position(const lh2_poly_tables *t, lfsr_poly_t poly, uint32_t state) {
+	state &= LH2_STATE_MASK;
+	if (state == 0) {
+		return 0;
+	}
+
+	for (uint32_t j = 0; j < LH2_GIANT_STEP; j++) {
+		uint64_t word = t->giant_bits[state / 64];
+		if ((word >> (state % 64)) & 1u) {
+			uint32_t rank = t->giant_rank[state / 64] + lh2_popcount64(word & ((1ull << (state % 64)) - 1));
+			return (t->giant_of_rank[rank] * LH2_GIANT_STEP + t->period - j) % t->period;
 		}
+		state = lh2_step(state, poly);
 	}
+	return 0;
+}
 
-	return rtn;
+// The window 'n' bits after (or before, for negative n) the given one
+static uint32_t lh2_jump_window(const lh2_poly_tables *t, uint32_t window, int32_t n) {
+	const uint32_t(*powers)[LH2_ORDER] = n < 0 ? t->backward : t->forward;
+	uint32_t steps = (uint32_t)(n < 0 ? -n : n) % t->period;
+	uint32_t state = (window >> (32 - LH2_ORDER)) & LH2_STATE_MASK;
+	for (int k = 0; steps; k++, steps >>= 1u) {
+		if (steps & 1u)
+			state = gf2_apply(powers[k], state);
+	}
+	return gf2_apply(t->window, state);
 }
 
+/*
+ * Tests the sample against all 32 polynomials at once. Each polynomial's prediction of the window from the known run
+ * is a sum of from_run columns; bitsliced, that is 17 masked XORs of 32 words, after which bit i of predicted[b] is
+ * polynomial i's bit b.
+ */
+static uint32_t lh2_possible_polys(const lh2_tables *tables, uint32_t sample, uint32_t mask, int *offset,
+								   uint32_t *run) {
+	*offset = -1;
+	for (int i = 0; i < LH2_OFFSET_CNT; i++) {
+		if (((mask >> (15 - i)) & LH2_STATE_MASK) == LH2_STATE_MASK) {
+			*offset = i;
+			break;
+		}
+	}
+	if (*offset < 0) {
+		return 0xFFFFFFFF;
+	}
+	*run = (sample >> (15 - *offset)) & LH2_STATE_MASK;
+
+	const uint32_t(*candidates)[32] = tables->candidates[*offset];
+	uint32_t predicted[32];
+#if defined(__AVX2__)
+	__m256i acc[4] = {_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+	for (int k = 0; k < LH2_ORDER; k++) {
+		__m256i sel = _mm256_set1_epi32(-(int32_t)((*run >> k) & 1u));
+		for (int q = 0; q < 4; q++)
+			acc[q] = _mm256_xor_si256(
+				acc[q], _mm256_and_si256(sel, _mm256_loadu_si256((const __m256i *)(candidates[k] + 8 * q))));
+	}
+	for (int q = 0; q < 4; q++)
+		_mm256_storeu_si256((__m256i *)(predicted + 8 * q), acc[q]);
+#elif defined(__SSE2__)
+	__m128i acc[8];
+	for (int q = 0; q < 8; q++)
+		acc[q] = _mm_setzero_si128();
+	for (int k = 0; k < LH2_ORDER; k++) {
+		__m128i sel = _mm_set1_epi32(-(int32_t)((*run >> k) & 1u));
+		for (int q = 0; q < 8; q++)
+			acc[q] =
+				_mm_xor_si128(acc[q], _mm_and_si128(sel, _mm_loadu_si128((const __m128i *)(candidates[k] + 4 * q))));
+	}
+	for (int q = 0; q < 8; q++)
+		_mm_storeu_si128((__m128i *)(predicted + 4 * q), acc[q]);
+#else
+	memset(predicted, 0, sizeof(predicted));
+	for (int k = 0; k < LH2_ORDER; k++) {
+		uint32_t sel = 0u - ((*run >> k) & 1u);
+		for (int b = 0; b < 32; b++)
+			predicted[b] ^= candidates[k][b] & sel;
+	}
+#endif
+
+	uint32_t mismatched = 0;
+	for (int b = 0; b < 32; b++) {
+		uint32_t want = 0u - ((sample >> b) & 1u);
+		mismatched |= (predicted[b] ^ want) & (0u - ((mask >> b) & 1u));
+	}
+	return ~mismatched;
+}
+
+uint32_t survive_lh2_possible_polys(uint32_t sample, uint32_t mask) {
+	int offset;
+	uint32_t run;
+	return lh2_possible_polys(lh2_get_tables(), sample, mask, &offset, &run);
+}
+
+lfsr_poly_t survive_lh2_poly(int idx) { return poly_pairs[idx]; }
+
 survive_channel survive_decipher_channel(const uint32_t *sample, const uint32_t *mask, const uint32_t *times,
 										 uint32_t *output, size_t count) {
-	init_lookups();
+	const lh2_tables *tables = lh2_get_tables();
 	uint32_t possible_polys = 0xFFFFFFFF;
-	uint32_t *timings = alloca(32 * sizeof(uint32_t) * count);
 	uint32_t *recon_samples = alloca(32 * sizeof(uint32_t) * count);
 	size_t known_solves[32] = {0};
 
-	memset(timings, 0, 32 * sizeof(uint32_t) * count);
 	memset(recon_samples, 0, 32 * sizeof(uint32_t) * count);
 
 	for (int i = 0; i < count; i++) {
-		uint32_t new_polys = find_possible_polys(sample[i], mask[i], timings + 32 * i, recon_samples + 32 * i);
+		int offset;
+		uint32_t run = 0;
+		uint32_t new_polys = lh2_possible_polys(tables, sample[i], mask[i], &offset, &run);
 		possible_polys &= new_polys;
 
-		uint8_t idx = 0;
-		while (new_polys) {
-			if (new_polys & 1 && recon_samples[idx + i * 32] != 0) {
-				known_solves[idx] = i + 1;
-			}
-			idx++;
-			new_polys = new_polys >> 1;
+		if (offset < 0 || run == 0)
+			continue;
+
+		for (uint32_t polys = new_polys; polys; polys &= polys - 1) {
+			uint32_t j = 31 - clz(polys & (0u - polys));
+			recon_samples[32 * i + j] = gf2_apply(tables->polys[j].from_run[offset], run);
+			known_solves[j] = i + 1;
 		}
 	}
 
@@ -137,9 +369,8 @@ survive_channel survive_decipher_channel(const uint32_t *sample, const uint32_t
 		return channel;
 
 	for (int i = 0; i < count; i++) {
-		for (int j = 0; j < 32; j++) {
-			if ((possible_polys & (1 << j)) == 0)
-				continue;
+		for (uint32_t polys = possible_polys; polys; polys &= polys - 1) {
+			uint32_t j = 31 - clz(polys & (0u - polys));
 			if (recon_samples[32 * i + j] != 0)
 				continue;
 			size_t gi = known_solves[j];
@@ -147,45 +378,35 @@ survive_channel survive_decipher_channel(const uint32_t *sample, const uint32_t
 				continue;
 			gi--;
 
-			survive_timecode it = times[i];
-			survive_timecode igt = times[gi];
-			int32_t diff = it - igt;
-
+			int32_t diff = (int32_t)(times[i] - times[gi]);
 			for (int o = -2; o <= 2; o++) {
 				int32_t o_diff = diff + o * 8;
-				uint32_t predicted_sample =
-					o_diff > 0 ? lsfr_iterate(recon_samples[32 * gi + j], poly_pairs[j], (o_diff + 4) / 8)
-							   : lsfr_iterate_rev(recon_samples[32 * gi + j], poly_pairs[j], (-o_diff + 4) / 8);
-
-				uint32_t error_bits = (predicted_sample ^ sample[i]) & mask[i];
-				uint32_t error = popcnt(error_bits);
+				int32_t n = o_diff >= 0 ? (o_diff + 4) / 8 : -((-o_diff + 4) / 8);
+				uint32_t predicted_sample = lh2_jump_window(&tables->polys[j], recon_samples[32 * gi + j], n);
 
+				uint32_t error = lh2_popcount((predicted_sample ^ sample[i]) & mask[i]);
 				if (error <= 1) {
 					recon_samples[32 * i + j] = predicted_sample;
-					timings[32 * i + j] = timings[32 * gi + j] + (o_diff + 4) / 8;
-
 					if (error == 0)
 						break;
-				} else {
-					fprintf(stderr, "Err %d for %d (%d) %08x vs %08x %08x %08x\n", error, o, j, predicted_sample,
-							sample[i], mask[i], error_bits);
 				}
 			}
 
 			if (recon_samples[32 * i + j] == 0) {
 				possible_polys ^= (1u << j);
-				fprintf(stderr, "Eliminated %d\n", j);
 			}
 		}
 	}
 
-	if (popcnt(possible_polys) == 1) {
+	if (lh2_popcount(possible_polys) == 1) {
 		channel = 31 - clz(possible_polys);
 	}
 
 	if (channel != 255) {
+		const lh2_poly_tables *t = &tables->polys[channel];
 		for (int i = 0; i < count; i++) {
-			output[i] = (timings + (32 * i))[channel];
+			uint32_t window = recon_samples[32 * i + channel];
+			output[i] = window ? lh2_position(t, poly_pairs[channel], window >> (32 - LH2_ORDER)) : 0;
 		}
 	}
 
@@ -1,5 +1,23 @@
+#pragma once
 #include "lfsr.h"
 #include "survive.h"
 
+/**
+ * Works out which of the 32 gen2 polynomials (two per channel) produced a set of raw light samples, and when.
+ *
+ * Each sample is a 32 bit window of the lighthouse's LFSR bitstream with 'mask' marking the bits that were read; times
+ * are in 48MHz ticks, i.e. 8 ticks per bit. Samples with a run of 17 known bits are matched directly, the rest by
+ * stepping a matched sample forward or back by the time between them.
+ *
+ * @param output For each sample, the position of its window in the polynomial's sequence, in bits
+ * @return The polynomial index, or 255 if the samples didn't single one out
+ */
 SURVIVE_EXPORT survive_channel survive_decipher_channel(const uint32_t *sample, const uint32_t *mask,
-														const uint32_t *times, uint32_t *output, size_t count);
\ No newline at end of file
+														const uint32_t *times, uint32_t *output, size_t count);
+
+/**
+ * Bitmask of the polynomials a single sample is consistent with; all ones if it has no run of 17 known bits.
+ */
+SURVIVE_EXPORT uint32_t survive_lh2_possible_polys(uint32_t sample, uint32_t mask);
+
+SURVIVE_EXPORT lfsr_poly_t survive_lh2_poly(int idx);
@@ -2,6 +2,7 @@
 #include "math.h"
 #include "survive_kalman_lighthouses.h"
 #include "survive_kalman_tracker.h"
+#include "survive_profile.h"
 #include <assert.h>
 #include <linmath.h>
 #include <stdint.h>
@@ -222,7 +223,9 @@ void PoserData_lighthouse_pose_func(PoserData *poser_data, SurviveObject *so, ui
 		for (int i = 0; i < 7; i++)
 			assert(!isnan(((FLT *)&lighthouse2world)[i]));
 
+		survive_get_lh_lock(ctx);
 		survive_kalman_lighthouse_integrate_observation(so->ctx->bsd[lighthouse].tracker, lighthouse_pose, R);
+		survive_release_lh_lock(ctx);
 	}
 }
 
@@ -387,16 +390,19 @@ void PoserData_lighthouse_poses_func(PoserData *poser_data, SurviveObject *so, S
 }
 
 FLT survive_lighthouse_adjust_confidence(SurviveContext *ctx, uint8_t bsd_idx, FLT v) {
+	survive_get_lh_lock(ctx);
 	ctx->bsd[bsd_idx].confidence += v;
 
 	if (ctx->bsd[bsd_idx].confidence < 0) {
 		ctx->bsd[bsd_idx].PositionSet = 0;
 		SV_WARN("Position for LH%d seems bad; queuing for recal", bsd_idx);
 	} else if (ctx->bsd[bsd_idx].confidence > 1.) {
-		return ctx->bsd[bsd_idx].confidence = 1;
+		ctx->bsd[bsd_idx].confidence = 1;
 	}
 
-	return ctx->bsd[bsd_idx].confidence;
+	FLT rtn = ctx->bsd[bsd_idx].confidence;
+	survive_release_lh_lock(ctx);
+	return rtn;
 }
 
 SURVIVE_EXPORT FLT survive_adjust_confidence(SurviveObject *so, FLT delta) {
@@ -407,8 +413,12 @@ SURVIVE_EXPORT FLT survive_adjust_confidence(SurviveObject *so, FLT delta) {
 }
 
 void survive_poser_invoke(SurviveObject *so, PoserData *poserData, size_t poserDataSize) {
-	if (so->ctx->PoserFn) {
-		so->ctx->PoserFn(so, poserData);
+	SurviveContext *ctx = so->ctx;
+	if (ctx->PoserFn == survive_threaded_poser_fn) {
+		// Threaded posers time the inner poser themselves; timing here would only count the hand off
+		ctx->PoserFn(so, poserData);
+	} else if (ctx->PoserFn) {
+		SURVIVE_PROFILE_STAGE(ctx, poser, ctx->PoserFn(so, poserData));
 	}
 }
 
@@ -437,9 +447,9 @@ void *survive_threaded_poser_thread_fn(void *_poser) {
 			self->has_new_data = false;
 			OGUnlockMutex(self->data_available_lock);
 
-			survive_get_ctx_lock(self->so->ctx);
-			self->innerPoser(so, &self->PoserData.pd);
-			survive_release_ctx_lock(self->so->ctx);
+			survive_get_poser_lock(so);
+			SURVIVE_PROFILE_STAGE(so->ctx, poser, self->innerPoser(so, &self->PoserData.pd));
+			survive_release_poser_lock(so);
 			self->run_count++;
 
 			OGLockMutex(self->data_available_lock);
@@ -501,7 +511,7 @@ int survive_threaded_poser_fn(SurviveObject *so, PoserData *pd) {
 	}
 	default: {
 		if (self->innerPoser) {
-			self->innerPoser(so, pd);
+			SURVIVE_PROFILE_STAGE(so->ctx, poser, self->innerPoser(so, pd));
 		}
 	}
 	}
@@ -161,7 +161,7 @@ static size_t construct_input_from_scene(const MPFITData *d, survive_long_timeco
 	}
 
 	for (uint8_t lh = 0; lh < ctx->activeLighthouses; lh++) {
-		if (d->disable_lighthouse == lh) {
+		if (d->disable_lighthouse == lh || !(scene->lighthouses & (1u << lh))) {
 			continue;
 		}
 
@@ -178,7 +178,11 @@ static size_t construct_input_from_scene(const MPFITData *d, survive_long_timeco
 		size_t required_meas_for_lh = 0;
 
 		size_t meas_for_lh = 0;
-		for (uint8_t sensor = 0; sensor < so->sensor_ct; sensor++) {
+		uint32_t sensors = scene->readings[lh][0] | scene->readings[lh][1];
+		for (uint8_t sensor = 0; sensors && sensor < so->sensor_ct; sensor++, sensors >>= 1) {
+			if (!(sensors & 1)) {
+				continue;
+			}
 			for (uint8_t axis = 0; axis < 2; axis++) {
 				survive_long_timecode last_reading =
 					SurviveSensorActivations_time_since_last_reading(scene, sensor, lh, axis);
@@ -698,7 +702,10 @@ static FLT run_mpfit_find_3d_structure(MPFITData *d, PoserDataLight *pdl, Surviv
 
 	struct async_optimizer_user user_data = {.d = d, .pdl = *pdl};
 
+	// Lighthouse poses are copied into the optimizer here; other objects' posers may be updating them
+	survive_get_lh_lock(ctx);
 	int setup_results = setup_optimizer(&user_data, &mpfitctx, scene);
+	survive_release_lh_lock(ctx);
 	if (setup_results < 0) {
 		return setup_results;
 	}
@@ -706,10 +713,10 @@ static FLT run_mpfit_find_3d_structure(MPFITData *d, PoserDataLight *pdl, Surviv
 	mp_result result = {0};
 
 	int nfree = survive_optimizer_get_free_parameters_count(&mpfitctx);
-	survive_release_ctx_lock(ctx);
+	survive_release_poser_lock(so);
 	int res = survive_optimizer_run(&mpfitctx, &result, R);
 //	cn_print_mat(R);
-	survive_get_ctx_lock(ctx);
+	survive_get_poser_lock(so);
 
 	return handle_optimizer_results(&mpfitctx, res, &result, &user_data, R, out);
 }
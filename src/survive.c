@@ -17,6 +17,8 @@
 #include "survive_default_devices.h"
 #include "survive_kalman_lighthouses.h"
 #include "survive_recording.h"
+#include "survive_seqlock.h"
+#include "survive_shm_publisher.h"
 
 #include <stdarg.h>
 
@@ -43,7 +45,10 @@ STATIC_CONFIG_ITEM(LIGHTHOUSE_GEN, "lighthouse-gen", 'i',
 				   "Which lighthouse gen to use -- 1 for LH1, 2 for LH2, 0 (default) for auto-detect", 0)
 STATIC_CONFIG_ITEM(OUTPUT_CALLBACK_STATS, "output-callback-stats", 'f',
 				   "Print cb stats every given number of seconds. 0 disables this output.", 0.);
+STATIC_CONFIG_ITEM(PROFILE_STAGES, "profile-stages", 'b', "Record timing histograms for each pipeline stage.", 0)
 STATIC_CONFIG_ITEM(THREADED_POSERS, "threaded-posers", 'b', "Whether or not to run each poser in their own thread.", 1)
+STATIC_CONFIG_ITEM(SHARDED_PIPELINE, "sharded-pipeline", 'b',
+				   "Guard each object with its own lock so threaded posers don't hold the context lock.", 0)
 
 STATIC_CONFIG_ITEM(LH_0_DISABLE, "lighthouse-0-disable", 'b', "Disable lh at idx 0", 0)
 STATIC_CONFIG_ITEM(LH_1_DISABLE, "lighthouse-1-disable", 'b', "Disable lh at idx 1", 0)
@@ -227,12 +232,18 @@ SURVIVE_EXPORT int8_t survive_get_bsd_idx(SurviveContext *ctx, survive_channel c
 		return -1;
 	}
 
+	// A channel is only ever assigned once, so only the first sighting needs the lighthouse lock; checking again under
+	// it covers another object adding the same lighthouse in the meantime
 	if (ctx->lh_version == 0) {
 		if (ctx->bsd[channel].mode == 0xFF) {
-			ctx->bsd[channel] = (BaseStationData){.tracker = ctx->bsd[channel].tracker};
-			ctx->bsd[channel].mode = channel;
-			ctx->activeLighthouses++;
-			SV_INFO("Adding lighthouse ch %d (cnt: %d)", channel, ctx->activeLighthouses);
+			survive_get_lh_lock(ctx);
+			if (ctx->bsd[channel].mode == 0xFF) {
+				ctx->bsd[channel] = (BaseStationData){.tracker = ctx->bsd[channel].tracker};
+				ctx->bsd[channel].mode = channel;
+				ctx->activeLighthouses++;
+				SV_INFO("Adding lighthouse ch %d (cnt: %d)", channel, ctx->activeLighthouses);
+			}
+			survive_release_lh_lock(ctx);
 		}
 		return channel;
 	}
@@ -241,19 +252,22 @@ SURVIVE_EXPORT int8_t survive_get_bsd_idx(SurviveContext *ctx, survive_channel c
 	if (i != -1)
 		return i;
 
-	for (i = 0; i < NUM_GEN2_LIGHTHOUSES; i++) {
-		if (ctx->bsd[i].mode == 0xFF) {
-			ctx->bsd[i] = (BaseStationData){.tracker = ctx->bsd[i].tracker};
-			ctx->bsd[i].mode = channel;
-			if (ctx->activeLighthouses < i + 1) {
-				ctx->activeLighthouses = i + 1;
+	survive_get_lh_lock(ctx);
+	i = ctx->bsd_map[channel];
+	for (int8_t j = 0; i == -1 && j < NUM_GEN2_LIGHTHOUSES; j++) {
+		if (ctx->bsd[j].mode == 0xFF) {
+			ctx->bsd[j] = (BaseStationData){.tracker = ctx->bsd[j].tracker};
+			ctx->bsd[j].mode = channel;
+			if (ctx->activeLighthouses < j + 1) {
+				ctx->activeLighthouses = j + 1;
 			}
-			SV_INFO("Adding lighthouse ch %d (idx: %d, cnt: %d)", channel, i, ctx->activeLighthouses);
-			return ctx->bsd_map[channel] = i;
+			SV_INFO("Adding lighthouse ch %d (idx: %d, cnt: %d)", channel, j, ctx->activeLighthouses);
+			i = ctx->bsd_map[channel] = j;
 		}
 	}
+	survive_release_lh_lock(ctx);
 
-	return -1;
+	return i;
 }
 
 void survive_get_ctx_lock(SurviveContext *ctx) {
@@ -269,6 +283,59 @@ void survive_release_ctx_lock(SurviveContext *ctx) {
 	// SV_VERBOSE(100, "Signaled on %lx", pthread_self());
 }
 
+bool survive_is_sharded(const SurviveContext *ctx) {
+	struct SurviveContext_private *pctx = ctx->private_members;
+	return pctx && pctx->sharded_pipeline;
+}
+void survive_get_so_lock(SurviveObject *so) {
+	if (survive_is_sharded(so->ctx))
+		OGLockMutex(so->pipeline_lock);
+}
+void survive_release_so_lock(SurviveObject *so) {
+	if (survive_is_sharded(so->ctx))
+		OGUnlockMutex(so->pipeline_lock);
+}
+void survive_get_lh_lock(SurviveContext *ctx) {
+	struct SurviveContext_private *pctx = ctx->private_members;
+	if (survive_is_sharded(ctx))
+		OGLockMutex(pctx->lh_lock);
+}
+void survive_release_lh_lock(SurviveContext *ctx) {
+	struct SurviveContext_private *pctx = ctx->private_members;
+	if (survive_is_sharded(ctx))
+		OGUnlockMutex(pctx->lh_lock);
+}
+void survive_get_ingest_lock(SurviveContext *ctx, SurviveObject *so) {
+	if (so && survive_is_sharded(ctx)) {
+		OGLockMutex(so->pipeline_lock);
+		if (SURVIVE_SEQ_LOAD_ACQUIRE(&so->activations_reset_pending)) {
+			SURVIVE_SEQ_STORE_RELEASE(&so->activations_reset_pending, 0);
+			SurviveSensorActivations_reset(&so->activations);
+		}
+	} else {
+		survive_get_ctx_lock(ctx);
+	}
+}
+void survive_release_ingest_lock(SurviveContext *ctx, SurviveObject *so) {
+	if (so && survive_is_sharded(ctx)) {
+		OGUnlockMutex(so->pipeline_lock);
+	} else {
+		survive_release_ctx_lock(ctx);
+	}
+}
+void survive_get_poser_lock(SurviveObject *so) {
+	if (survive_is_sharded(so->ctx))
+		OGLockMutex(so->pipeline_lock);
+	else
+		survive_get_ctx_lock(so->ctx);
+}
+void survive_release_poser_lock(SurviveObject *so) {
+	if (survive_is_sharded(so->ctx))
+		OGUnlockMutex(so->pipeline_lock);
+	else
+		survive_release_ctx_lock(so->ctx);
+}
+
 static inline bool find_correct_config_file(struct SurviveContext *ctx, const char **config_prefix_fields) {
 	for (const char **name = config_prefix_fields; *name; name++) {
 		if (survive_config_is_set(ctx, *name)) {
@@ -356,6 +423,8 @@ SurviveContext *survive_init_internal(int argc, char *const *argv, void *userDat
 	pctx->external2world.Rot[0] = 1;
 
 	pctx->poll_sema = OGCreateSema();
+	pctx->lh_lock = OGCreateMutex();
+	pctx->optimizer_pool_lock = OGCreateMutex();
 
 	for (int i = 0; i < NUM_GEN2_LIGHTHOUSES; i++) {
 		ctx->bsd[i].mode = -1;
@@ -501,6 +570,12 @@ SurviveContext *survive_init_internal(int argc, char *const *argv, void *userDat
 	ctx->activeLighthouses = 0;
 
 	pctx->callbackStatsTimeBetween = survive_configf(ctx, "output-callback-stats", SC_GET, 0.0);
+	if (survive_configi(ctx, PROFILE_STAGES_TAG, SC_GET, 0))
+		pctx->profile = survive_profile_create();
+
+	// Everything which would otherwise get its own thread during playback keys off of a playback factor of 0
+	if (survive_configi(ctx, "playback-deterministic", SC_GET, 0))
+		survive_configf(ctx, "playback-factor", SC_OVERRIDE | SC_SET, 0);
 
 	for (int i = 0; i < NUM_GEN2_LIGHTHOUSES; i++) {
 		if (config_read_lighthouse(ctx->lh_config, &(ctx->bsd[i]), i)) {
@@ -642,7 +717,17 @@ static void warn_missing_drivers(SurviveContext *ctx, const char* name) {
 int survive_startup(SurviveContext *ctx) {
 	ctx->state = SURVIVE_RUNNING;
 
+	// This has to be decided before any driver threads start pushing data in
+	FLT playback_factor = survive_configf(ctx, "playback-factor", SC_GET, 1.);
+	bool use_async_posers = survive_configi(ctx, THREADED_POSERS_TAG, SC_GET, 0) && playback_factor != 0.0;
+	struct SurviveContext_private *pctx = ctx->private_members;
+	pctx->sharded_pipeline = use_async_posers && survive_configi(ctx, SHARDED_PIPELINE_TAG, SC_GET, 0);
+	if (pctx->sharded_pipeline) {
+		SV_VERBOSE(10, "Using sharded object pipelines");
+	}
+
 	survive_install_recording(ctx);
+	survive_install_shm_publisher(ctx);
 
 	// initialize the button queue
 	memset(&(ctx->buttonQueue), 0, sizeof(ctx->buttonQueue));
@@ -654,6 +739,13 @@ int survive_startup(SurviveContext *ctx) {
 	PoserCB PreferredPoserCB = (PoserCB)GetDriverByConfig(ctx, "Poser", "poser", "MPFIT");
 	ctx->lightcapproc = GetDriverByConfig(ctx, "Disambiguator", "disambiguator", "StateBased");
 
+	// Disambiguators that can take a packet's worth of elements at once register that as "Lightcaps<name>"
+	lightcaps_process_func lightcapsproc = (lightcaps_process_func)GetDriverWithPrefix(
+		"Lightcaps", survive_configs(ctx, "disambiguator", SC_GET, "StateBased"));
+	if (lightcapsproc && ctx->lightcapsproc == survive_default_lightcaps_process) {
+		survive_install_lightcaps_fn(ctx, lightcapsproc);
+	}
+
 	const char *DriverName;
 
 	warn_missing_drivers(ctx, "openvr");
@@ -707,8 +799,6 @@ int survive_startup(SurviveContext *ctx) {
 	buffer[strlen(buffer) - 2] = 0;
 	SV_INFO("%s", buffer);
 
-	FLT playback_factor = survive_configf(ctx, "playback-factor", SC_GET, 1.);
-	bool use_async_posers = survive_configi(ctx, THREADED_POSERS_TAG, SC_GET, 0) && playback_factor != 0.0;
 	if (use_async_posers) {
 		for (int i = 0; i < ctx->objs_ct; i++) {
 			*survive_object_plugin_data(ctx->objs[i], survive_threaded_poser_fn) =
@@ -830,12 +920,30 @@ int survive_add_object(SurviveContext *ctx, SurviveObject *obj) {
 	ctx->objs[oldct] = obj;
 	ctx->objs_ct = oldct + 1;
 
+	// Lookups by name find the first object with it, as the scan over objs did
+	struct SurviveContext_private *pctx = ctx->private_members;
+	if (survive_name_index_get(&pctx->objects_by_name, obj->codename) == 0) {
+		survive_name_index_put(&pctx->objects_by_name, obj->codename, obj);
+	}
+
 	SURVIVE_INVOKE_HOOK_SO(new_object, obj);
 
 	return 0;
 }
 
-void survive_remove_object(SurviveContext *ctx, SurviveObject *obj) {
+// Points name at the first object in objs which has it, as a scan over objs would find
+static void reindex_name(SurviveContext *ctx, const char *name) {
+	struct SurviveContext_private *pctx = ctx->private_members;
+	survive_name_index_remove(&pctx->objects_by_name, name);
+	for (int i = 0; i < ctx->objs_ct; i++) {
+		if (strcmp(ctx->objs[i]->codename, name) == 0) {
+			survive_name_index_put(&pctx->objects_by_name, ctx->objs[i]->codename, ctx->objs[i]);
+			return;
+		}
+	}
+}
+
+bool survive_unlink_object(SurviveContext *ctx, SurviveObject *obj) {
 	int obj_idx = 0;
 	for (obj_idx = 0; obj_idx < ctx->objs_ct; obj_idx++) {
 		if (ctx->objs[obj_idx] == obj)
@@ -843,8 +951,7 @@ void survive_remove_object(SurviveContext *ctx, SurviveObject *obj) {
 	}
 
 	if (obj_idx == ctx->objs_ct) {
-		SV_INFO("Warning: Tried to remove un-added object %p(%s)", (void *)obj, obj->codename);
-		return;
+		return false;
 	}
 
 	// Swap the last item into this items slot; this assumes order doesn't matter in this list
@@ -858,6 +965,19 @@ void survive_remove_object(SurviveContext *ctx, SurviveObject *obj) {
 	// past the end of the list
 	ctx->objs[ctx->objs_ct] = 0;
 
+	reindex_name(ctx, obj->codename);
+	if (obj_idx < ctx->objs_ct) {
+		reindex_name(ctx, ctx->objs[obj_idx]->codename);
+	}
+	return true;
+}
+
+void survive_remove_object(SurviveContext *ctx, SurviveObject *obj) {
+	if (!survive_unlink_object(ctx, obj)) {
+		SV_INFO("Warning: Tried to remove un-added object %p(%s)", (void *)obj, obj->codename);
+		return;
+	}
+
 	SV_INFO("Removing tracked object %s from %s", obj->codename, obj->drivername);
 	free(obj);
 }
@@ -893,22 +1013,27 @@ SURVIVE_EXPORT const SurvivePose *survive_get_lighthouse_true_position(const Sur
 SURVIVE_EXPORT const SurvivePose *survive_get_lighthouse_position(const SurviveContext *ctx, int bsd_idx) {
 	assert(bsd_idx >= 0);
 	if (ctx->bsd[bsd_idx].true_pos_time != 0) {
+		// In sharded mode several objects may get here at once; only one of them moves the pose along
 		SurviveContext *mctx = (SurviveContext *)ctx;
-		FLT t_diff = ctx->bsd[bsd_idx].true_pos_time - ctx->bsd[bsd_idx].old_pos_time;
-		FLT t = (survive_run_time(ctx) - ctx->bsd[bsd_idx].old_pos_time) / t_diff;
-		if (t > 1)
-			t = 1;
-		assert(t >= 0);
-		if (t >= 0) {
-			PoseSlerp(&mctx->bsd[bsd_idx].Pose, &ctx->bsd[bsd_idx].old_pos, &ctx->bsd[bsd_idx].true_pos, t);
-		}
-		if (t == 1) {
-			mctx->bsd[bsd_idx].true_pos_time = 0;
-			mctx->bsd[bsd_idx].old_pos_time = NAN;
+		survive_get_lh_lock(mctx);
+		if (ctx->bsd[bsd_idx].true_pos_time != 0) {
+			FLT t_diff = ctx->bsd[bsd_idx].true_pos_time - ctx->bsd[bsd_idx].old_pos_time;
+			FLT t = (survive_run_time(ctx) - ctx->bsd[bsd_idx].old_pos_time) / t_diff;
+			if (t > 1)
+				t = 1;
+			assert(t >= 0);
+			if (t >= 0) {
+				PoseSlerp(&mctx->bsd[bsd_idx].Pose, &ctx->bsd[bsd_idx].old_pos, &ctx->bsd[bsd_idx].true_pos, t);
+			}
+			if (t == 1) {
+				mctx->bsd[bsd_idx].true_pos_time = 0;
+				mctx->bsd[bsd_idx].old_pos_time = NAN;
+			}
+			SurvivePose p = ctx->bsd[bsd_idx].Pose;
+			p.Pos[2] -= ctx->floor_offset;
+			survive_recording_lighthouse_process(mctx, bsd_idx, &p);
 		}
-		SurvivePose p = ctx->bsd[bsd_idx].Pose;
-		p.Pos[2] -= ctx->floor_offset;
-		survive_recording_lighthouse_process(mctx, bsd_idx, &p);
+		survive_release_lh_lock(mctx);
 	}
 	return &ctx->bsd[bsd_idx].Pose;
 }
@@ -985,7 +1110,11 @@ int survive_haptic(SurviveObject *so, FLT freq, FLT amp, FLT duration) {
 }
 
 void survive_output_callback_stats(SurviveContext *ctx) {
-	SV_VERBOSE(10, "Callback statistics:");
+#if SURVIVE_HOOK_TIMING_SAMPLE > 0
+	SV_VERBOSE(10, "Callback statistics (timing sampled from 1 in %d calls):", SURVIVE_HOOK_TIMING_SAMPLE);
+#else
+	SV_VERBOSE(10, "Callback statistics (timing compiled out):");
+#endif
 #define SURVIVE_HOOK_PROCESS_DEF(hook)                                                                                 \
 	SV_VERBOSE(10, "\t%-20s cnt: %7d avg time: %.7fms max time: %.7fms cnt over 1ms: %5d(%.7f%%)", #hook,               \
 			   ctx->hook##_call_cnt, 1000. * ctx->hook##_call_time / (1e-5 + ctx->hook##_call_cnt),                    \
@@ -1027,6 +1156,8 @@ void survive_close(SurviveContext *ctx) {
 	}
 
 	for (int i = 0; i < ctx->objs_ct; i++) {
+		survive_flush_sweep_angles(ctx->objs[i]);
+
 		PoserData pd;
 		pd.pt = POSERDATA_DISASSOCIATE;
 		if (ctx->PoserFn) {
@@ -1051,7 +1182,9 @@ void survive_close(SurviveContext *ctx) {
 	}
 
 	survive_output_callback_stats(ctx);
+	survive_profile_output_stats(ctx);
 
+	survive_destroy_shm_publisher(ctx);
 	survive_destroy_recording(ctx);
 
 	SurviveContext_detach_config(ctx, ctx);
@@ -1068,8 +1201,14 @@ void survive_close(SurviveContext *ctx) {
 		destroy_config_group(ctx->lh_config + lh);
 	}
 
+	survive_optimizer_free_thread_pool(ctx);
+
 	struct SurviveContext_private *pctx = ctx->private_members;
 	OGDeleteSema(pctx->poll_sema);
+	OGDeleteMutex(pctx->lh_lock);
+	OGDeleteMutex(pctx->optimizer_pool_lock);
+	survive_profile_free(pctx->profile);
+	survive_name_index_free(&pctx->objects_by_name);
 	free(pctx);
 
 	free(ctx->objs);
@@ -1135,12 +1274,8 @@ int survive_poll(struct SurviveContext *ctx) {
 }
 
 struct SurviveObject *survive_get_so_by_name(struct SurviveContext *ctx, const char *name) {
-	int i;
-	for (i = 0; i < ctx->objs_ct; i++) {
-		if (strcmp(ctx->objs[i]->codename, name) == 0)
-			return ctx->objs[i];
-	}
-	return 0;
+	struct SurviveContext_private *pctx = ctx->private_members;
+	return survive_name_index_get(&pctx->objects_by_name, name);
 }
 
 #ifdef NOZLIB
@@ -1224,6 +1359,9 @@ SURVIVE_EXPORT SurvivePluginData *survive_object_plugin_data(SurviveObject *so,
 }
 
 const SurvivePose *survive_object_pose(SurviveObject *so) { return &so->OutPose; }
+bool survive_object_predict_pose(const SurviveObject *so, double runtime, SurvivePose *pose) {
+	return so->tracker && survive_kalman_tracker_predict_published(so->tracker, runtime, pose);
+}
 
 int8_t survive_object_sensor_ct(SurviveObject *so) { return so->sensor_ct; }
 const FLT *survive_object_sensor_locations(SurviveObject *so) { return so->sensor_locations; }
@@ -9,6 +9,8 @@
 #include "stdio.h"
 #include "string.h"
 #include "survive.h"
+#include "survive_name_index.h"
+#include "survive_spsc_ring.h"
 
 struct SurviveExternalObject {
 	SurvivePose pose;
@@ -40,9 +42,20 @@ struct SurviveSimpleObject {
 struct SurviveSimpleObjectList {
 	size_t cnt;
 	SurviveSimpleObject *head, *tail;
+
+	// First object in the list with each name
+	survive_name_index by_name;
 };
 
-#define MAX_EVENT_SIZE 64
+struct SurviveSimpleSubscription {
+	SurviveSimpleContext *actx;
+	SurviveSimpleSubscriptionParams params;
+
+	// Of SurviveSimpleEvent; filled under poll_mutex, drained by the subscriber without it
+	survive_spsc_ring queue;
+};
+
+#define DEFAULT_SUBSCRIPTION_CAPACITY 64
 struct SurviveSimpleContext {
 	SurviveContext *ctx;
 	SurviveSimpleLogFn log_fn;
@@ -53,9 +66,12 @@ struct SurviveSimpleContext {
 	og_mutex_t poll_mutex;
 	og_cv_t update_cv;
 
-	size_t events_cnt;
-	size_t event_next_write;
-	struct SurviveSimpleEvent events[MAX_EVENT_SIZE];
+	// Guarded by poll_mutex
+	SurviveSimpleSubscription **subscriptions;
+	size_t subscriptions_cnt;
+
+	// Backs survive_simple_next_event; pose updates are left out since that call makes them from has_update
+	SurviveSimpleSubscription *default_subscription;
 
 	struct SurviveSimpleObjectList objects;
 };
@@ -77,30 +93,59 @@ static void unlock_and_notify_change(SurviveSimpleContext *actx) {
 	OGUnlockMutex(actx->poll_mutex);
 }
 
-static void insert_into_event_buffer(SurviveSimpleContext *actx, const SurviveSimpleEvent *event) {
-	bool buffer_full = actx->events_cnt == MAX_EVENT_SIZE;
+static bool subscription_wants(const SurviveSimpleSubscription *sub, enum SurviveSimpleEventType event_type,
+							   const SurviveSimpleObject *object) {
+	if (sub->params.event_types && (sub->params.event_types & SURVIVE_SIMPLE_EVENT_MASK(event_type)) == 0)
+		return false;
+	return sub->params.object == 0 || object == 0 || sub->params.object == object;
+}
+
+static bool any_subscription_wants(const SurviveSimpleContext *actx, enum SurviveSimpleEventType event_type,
+								   const SurviveSimpleObject *object) {
+	for (size_t i = 0; i < actx->subscriptions_cnt; i++) {
+		if (subscription_wants(actx->subscriptions[i], event_type, object))
+			return true;
+	}
+	return false;
+}
+
+// Called with poll_mutex held
+static void publish_event(SurviveSimpleContext *actx, const SurviveSimpleEvent *event) {
+	// Only events about an object carry one; the rest, e.g. Shutdown, pass any object filter
+	const struct SurviveSimpleObjectEvent *object_event = survive_simple_get_object_event(event);
+	const SurviveSimpleObject *object = object_event ? object_event->object : 0;
+	for (size_t i = 0; i < actx->subscriptions_cnt; i++) {
+		SurviveSimpleSubscription *sub = actx->subscriptions[i];
+		if (!subscription_wants(sub, event->event_type, object))
+			continue;
+
+		SurviveSimpleEvent *slot = survive_spsc_ring_reserve(&sub->queue);
+		if (slot == 0) {
+			if (sub->queue.overflow_cnt == 1) {
+				SurviveContext *ctx = actx->ctx;
+				SV_WARN("Simple API event subscription is full; dropping events until it is read");
+			}
+			continue;
+		}
+		*slot = *event;
+		survive_spsc_ring_commit(&sub->queue);
+	}
+}
 
-	actx->events[actx->event_next_write] = *event;
-	actx->event_next_write = (actx->event_next_write + 1) % MAX_EVENT_SIZE;
-	if (!buffer_full)
-		actx->events_cnt++;
+static void insert_into_event_buffer(SurviveSimpleContext *actx, const SurviveSimpleEvent *event) {
+	publish_event(actx, event);
 	unlock_and_notify_change(actx);
 }
 
-static bool pop_from_event_buffer(SurviveSimpleContext *actx, SurviveSimpleEvent *event) {
-	if (actx->events_cnt == 0)
-		return false;
-
-	size_t read_idx = (MAX_EVENT_SIZE + actx->event_next_write - actx->events_cnt) % MAX_EVENT_SIZE;
-	*event = actx->events[read_idx];
-
-	// Mark read events as invalid and assert if they are about to be passed on. This means there is a logic bug in the
-	// circular buffer
-	assert(event->event_type != -1);
-	actx->events[read_idx].event_type = -1;
+// Called with poll_mutex held, after the object's pose has been updated
+static void publish_pose_event(SurviveSimpleContext *actx, const SurviveSimpleObject *sao) {
+	if (!any_subscription_wants(actx, SurviveSimpleEventType_PoseUpdateEvent, sao))
+		return;
 
-	actx->events_cnt--;
-	return true;
+	SurviveSimpleEvent event = {.event_type = SurviveSimpleEventType_PoseUpdateEvent, .d = {.pose_event = {.object = sao}}};
+	event.d.pose_event.time = survive_simple_object_get_latest_pose(sao, &event.d.pose_event.pose);
+	survive_simple_object_get_latest_velocity(sao, &event.d.pose_event.velocity);
+	publish_event(actx, &event);
 }
 
 static void SurviveSimpleObjectList_add(struct SurviveSimpleObjectList *list, SurviveSimpleObject *so) {
@@ -113,19 +158,26 @@ static void SurviveSimpleObjectList_add(struct SurviveSimpleObjectList *list, Su
 	}
 
 	list->tail = so;
+
+	if (survive_name_index_get(&list->by_name, so->name) == 0) {
+		survive_name_index_put(&list->by_name, so->name, so);
+	}
 }
 
 static SurviveSimpleObject *find_or_create_external(SurviveSimpleContext *actx, const char *name) {
-	for (struct SurviveSimpleObject *so = actx->objects.head; so; so = so->next) {
-		if (strncmp(name, so->name, 32) == 0) {
-			return so;
-		}
+	// Names are stored truncated, so look them up that way too
+	char key[sizeof(((SurviveSimpleObject *)0)->name)] = {0};
+	strncpy(key, name, sizeof(key) - 1);
+
+	SurviveSimpleObject *so = survive_name_index_get(&actx->objects.by_name, key);
+	if (so) {
+		return so;
 	}
 
-	SurviveSimpleObject *so = SV_CALLOC(sizeof(struct SurviveSimpleObject));
+	so = SV_CALLOC(sizeof(struct SurviveSimpleObject));
 	so->type = SurviveSimpleObject_EXTERNAL;
 	so->actx = actx;
-	strncpy(so->name, name, sizeof(so->name) - 1);
+	strcpy(so->name, key);
 	SurviveSimpleObjectList_add(&actx->objects, so);
 
 	return so;
@@ -150,6 +202,7 @@ static void external_pose_fn(SurviveContext *ctx, const char *name, const Surviv
 	SurviveSimpleObject *so = find_or_create_external(actx, name);
 	so->has_update = true;
 	so->data.seo.pose = *pose;
+	publish_pose_event(actx, so);
 	unlock_and_notify_change(actx);
 }
 static void pose_fn(SurviveObject *so, survive_long_timecode timecode, const SurvivePose *pose) {
@@ -159,6 +212,7 @@ static void pose_fn(SurviveObject *so, survive_long_timecode timecode, const Sur
 
 	struct SurviveSimpleObject *sao = so->user_ptr;
 	sao->has_update = true;
+	publish_pose_event(actx, sao);
 	unlock_and_notify_change(actx);
 }
 
@@ -173,9 +227,9 @@ static inline SurviveSimpleObject *create_lighthouse(SurviveSimpleContext *actx,
 	ctx->bsd[i].user_ptr = obj;
 	snprintf(obj->name, 32, "LH%" PRIdPTR, i);
 	snprintf(obj->data.lh.serial_number, 16, "LHB-%X", (unsigned)ctx->bsd[i].BaseStationID);
+	OGLockMutex(actx->poll_mutex);
 	SurviveSimpleObjectList_add(&actx->objects, obj);
 
-	OGLockMutex(actx->poll_mutex);
 	SurviveSimpleEvent event = {.event_type = SurviveSimpleEventType_DeviceAdded,
 								.d = {.object_event = {
 										  .time = survive_simple_run_time_since_epoch(actx),
@@ -195,6 +249,7 @@ static void lh_fn(SurviveContext *ctx, uint8_t lighthouse, const SurvivePose *li
 	if (sao == 0)
 		sao = create_lighthouse(actx, lighthouse);
 	sao->has_update = true;
+	publish_pose_event(actx, sao);
 
 	unlock_and_notify_change(actx);
 }
@@ -270,9 +325,9 @@ static void new_object_fn(SurviveObject *so) {
 	obj->data.so->user_ptr = (void *)obj;
 	strncpy(obj->name, obj->data.so->codename, sizeof(obj->name));
 
+	OGLockMutex(actx->poll_mutex);
 	SurviveSimpleObjectList_add(&actx->objects, obj);
 
-	OGLockMutex(actx->poll_mutex);
 	survive_default_new_object_process(so);
 	SurviveSimpleEvent event = {.event_type = SurviveSimpleEventType_DeviceAdded,
 								.d = {.object_event = {
@@ -304,6 +359,11 @@ SURVIVE_EXPORT SurviveSimpleContext *survive_simple_init_with_logger(int argc, c
 	actx->poll_mutex = OGCreateMutex();
 	actx->update_cv = OGCreateConditionVariable();
 
+	SurviveSimpleSubscriptionParams default_params = {
+		.capacity = DEFAULT_SUBSCRIPTION_CAPACITY,
+		.event_types = ~SURVIVE_SIMPLE_EVENT_MASK(SurviveSimpleEventType_PoseUpdateEvent)};
+	actx->default_subscription = survive_simple_subscribe(actx, &default_params);
+
 	survive_startup(ctx);
 
 	intptr_t i = 0;
@@ -343,6 +403,12 @@ void survive_simple_close(SurviveSimpleContext *actx) {
 		n = n->next;
 		free(freeMe);
 	}
+	survive_name_index_free(&actx->objects.by_name);
+
+	while (actx->subscriptions_cnt) {
+		survive_simple_unsubscribe(actx->subscriptions[0]);
+	}
+	free(actx->subscriptions);
 
 	OGDeleteMutex(actx->poll_mutex);
 	OGJoinThread(actx->thread);
@@ -372,12 +438,10 @@ const SurviveSimpleObject *survive_simple_get_next_object(SurviveSimpleContext *
 }
 
 SurviveSimpleObject *survive_simple_get_object(SurviveSimpleContext *actx, const char *name) {
-	for (struct SurviveSimpleObject *n = actx->objects.head; n; n = n->next) {
-		if (strcmp(name, n->name) == 0) {
-			return n;
-		}
-	}
-	return 0;
+	OGLockMutex(actx->poll_mutex);
+	SurviveSimpleObject *so = survive_name_index_get(&actx->objects.by_name, name);
+	OGUnlockMutex(actx->poll_mutex);
+	return so;
 }
 
 const SurviveSimpleObject *survive_simple_get_first_object(SurviveSimpleContext *actx) { return actx->objects.head; }
@@ -466,6 +530,34 @@ FLT survive_simple_object_get_latest_pose(const SurviveSimpleObject *sao, Surviv
 	return timecode;
 }
 
+bool survive_simple_object_predict_pose(const SurviveSimpleObject *sao, FLT time, SurvivePose *pose) {
+	switch (sao->type) {
+	case SurviveSimpleObject_HMD:
+	case SurviveSimpleObject_OBJECT: {
+		SurvivePose predicted;
+		if (survive_object_predict_pose(sao->data.so, time, &predicted)) {
+			if (pose) {
+				*pose = predicted;
+			}
+			return true;
+		}
+		break;
+	}
+	default:
+		break;
+	}
+
+	SurvivePose latest = {0};
+	survive_simple_object_get_latest_pose(sao, &latest);
+	if (quatiszero(latest.Rot)) {
+		return false;
+	}
+	if (pose) {
+		*pose = latest;
+	}
+	return true;
+}
+
 SURVIVE_EXPORT bool survive_simple_object_charging(const SurviveSimpleObject *sao) {
 	switch (sao->type) {
 	case SurviveSimpleObject_LIGHTHOUSE: {
@@ -580,8 +672,13 @@ enum SurviveSimpleEventType survive_simple_wait_for_event(SurviveSimpleContext *
 enum SurviveSimpleEventType survive_simple_next_event(SurviveSimpleContext *actx, SurviveSimpleEvent *event) {
 	event->event_type = SurviveSimpleEventType_None;
 
+	// Any thread may call this, so unlike a subscription's own reader it has to hold the lock
 	OGLockMutex(actx->poll_mutex);
-	pop_from_event_buffer(actx, event);
+	const SurviveSimpleEvent *next = survive_spsc_ring_peek(&actx->default_subscription->queue);
+	if (next) {
+		*event = *next;
+		survive_spsc_ring_pop(&actx->default_subscription->queue);
+	}
 	OGUnlockMutex(actx->poll_mutex);
 
 	if (event->event_type == SurviveSimpleEventType_None) {
@@ -660,3 +757,80 @@ FLT survive_simple_run_time(const struct SurviveSimpleContext *actx) {
 		return 0;
 	return survive_run_time(actx->ctx);
 }
+
+SurviveSimpleSubscription *survive_simple_subscribe(SurviveSimpleContext *actx,
+													const SurviveSimpleSubscriptionParams *params) {
+	SurviveSimpleSubscription *sub = SV_CALLOC(sizeof(SurviveSimpleSubscription));
+	sub->actx = actx;
+	if (params)
+		sub->params = *params;
+	if (sub->params.capacity == 0)
+		sub->params.capacity = DEFAULT_SUBSCRIPTION_CAPACITY;
+	survive_spsc_ring_init(&sub->queue, sizeof(SurviveSimpleEvent), sub->params.capacity);
+
+	OGLockMutex(actx->poll_mutex);
+	actx->subscriptions =
+		SV_REALLOC(actx->subscriptions, sizeof(SurviveSimpleSubscription *) * (actx->subscriptions_cnt + 1));
+	actx->subscriptions[actx->subscriptions_cnt++] = sub;
+	OGUnlockMutex(actx->poll_mutex);
+	return sub;
+}
+
+void survive_simple_unsubscribe(SurviveSimpleSubscription *sub) {
+	if (sub == 0)
+		return;
+
+	SurviveSimpleContext *actx = sub->actx;
+	OGLockMutex(actx->poll_mutex);
+	for (size_t i = 0; i < actx->subscriptions_cnt; i++) {
+		if (actx->subscriptions[i] == sub) {
+			actx->subscriptions[i] = actx->subscriptions[--actx->subscriptions_cnt];
+			break;
+		}
+	}
+	if (actx->default_subscription == sub)
+		actx->default_subscription = 0;
+	OGUnlockMutex(actx->poll_mutex);
+
+	survive_spsc_ring_free(&sub->queue);
+	free(sub);
+}
+
+enum SurviveSimpleEventType survive_simple_subscription_next_event(SurviveSimpleSubscription *sub,
+																   SurviveSimpleEvent *event) {
+	const SurviveSimpleEvent *next = survive_spsc_ring_peek(&sub->queue);
+	if (next == 0) {
+		event->event_type = survive_simple_is_running(sub->actx) ? SurviveSimpleEventType_None
+																 : SurviveSimpleEventType_Shutdown;
+		return event->event_type;
+	}
+
+	*event = *next;
+	survive_spsc_ring_pop(&sub->queue);
+	return event->event_type;
+}
+
+enum SurviveSimpleEventType survive_simple_subscription_wait_for_event(SurviveSimpleSubscription *sub,
+																	   SurviveSimpleEvent *event, FLT timeout_s) {
+	SurviveSimpleContext *actx = sub->actx;
+	double deadline = OGGetAbsoluteTime() + timeout_s;
+
+	OGLockMutex(actx->poll_mutex);
+	while (survive_spsc_ring_depth(&sub->queue) == 0 && survive_simple_is_running(actx)) {
+		// Wake up at least every 100ms; nothing signals when the background thread stops
+		int wait_ms = 100;
+		if (timeout_s >= 0) {
+			double remaining = deadline - OGGetAbsoluteTime();
+			if (remaining <= 0)
+				break;
+			if (remaining * 1000. < wait_ms)
+				wait_ms = (int)(remaining * 1000.) + 1;
+		}
+		OGWaitCondTimeout(actx->update_cv, actx->poll_mutex, wait_ms);
+	}
+	OGUnlockMutex(actx->poll_mutex);
+
+	return survive_simple_subscription_next_event(sub, event);
+}
+
+uint32_t survive_simple_subscription_dropped(const SurviveSimpleSubscription *sub) { return sub->queue.overflow_cnt; }
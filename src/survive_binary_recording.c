@@ -0,0 +1,604 @@
+#include "survive_binary_recording.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "survive_file_offset.h"
+#include "survive_recording.h"
+
+#ifndef NOZLIB
+#include <zlib.h>
+#endif
+
+// Uncompressed size a block is allowed to grow to before it is flushed. Records bigger than this get a block to
+// themselves.
+#define SVBR_BLOCK_SIZE (64 * 1024)
+
+#define SVBR_FILE_MAGIC "SVBR"
+#define SVBR_BLOCK_MAGIC "SVBK"
+#define SVBR_INDEX_MAGIC "SVIX"
+#define SVBR_FOOTER_MAGIC "SVBF"
+#define SVBR_BYTE_ORDER_MARK 0x01020304u
+
+#define SVBR_COMPRESSION_NONE 0
+#define SVBR_COMPRESSION_ZLIB 1
+
+#define SVBR_BLOCK_FLAG_HAS_TEXT 1
+
+typedef struct svbr_file_header {
+	char magic[4];
+	uint16_t version;
+	uint16_t header_size;
+	uint32_t byte_order_mark;
+	uint32_t reserved;
+} svbr_file_header;
+
+typedef struct svbr_block_header {
+	char magic[4];
+	uint8_t compression;
+	uint8_t flags;
+	uint16_t reserved;
+	uint32_t raw_length;
+	uint32_t stored_length;
+	uint32_t record_cnt;
+	uint32_t reserved2;
+	double first_time;
+} svbr_block_header;
+
+typedef struct svbr_index_entry {
+	double first_time;
+	uint64_t offset;
+	uint32_t record_cnt;
+	uint8_t flags;
+	uint8_t reserved[3];
+} svbr_index_entry;
+
+typedef struct svbr_footer {
+	uint64_t index_offset;
+	char magic[4];
+	uint32_t reserved;
+} svbr_footer;
+
+// Records are 8 byte aligned within a block so typed payloads can be read in place
+static inline size_t record_stride(uint32_t length) {
+	return sizeof(survive_binary_record_header) + ((length + 7u) & ~(size_t)7u);
+}
+
+static bool grow(uint8_t **buffer, size_t *size, size_t needed) {
+	if (*size >= needed)
+		return true;
+	size_t new_size = *size ? *size : SVBR_BLOCK_SIZE;
+	while (new_size < needed)
+		new_size *= 2;
+	*buffer = SV_REALLOC(*buffer, new_size);
+	*size = new_size;
+	return *buffer != 0;
+}
+
+struct survive_binary_writer {
+	FILE *f;
+	int compression_level;
+	uint64_t offset;
+
+	uint8_t *block;
+	size_t block_length, block_size;
+	uint32_t record_cnt;
+	uint8_t block_flags;
+	double first_time;
+
+	uint8_t *compressed;
+	size_t compressed_size;
+
+	svbr_index_entry *index;
+	size_t index_cnt, index_size;
+};
+
+survive_binary_writer *survive_binary_writer_open(const char *filename, int compression_level) {
+	FILE *f = fopen(filename, "wb");
+	if (f == 0)
+		return 0;
+
+	svbr_file_header header = {.version = SURVIVE_BINARY_RECORDING_VERSION,
+							   .header_size = sizeof(svbr_file_header),
+							   .byte_order_mark = SVBR_BYTE_ORDER_MARK};
+	memcpy(header.magic, SVBR_FILE_MAGIC, 4);
+	if (fwrite(&header, sizeof(header), 1, f) != 1) {
+		fclose(f);
+		return 0;
+	}
+
+	survive_binary_writer *writer = SV_CALLOC(sizeof(survive_binary_writer));
+	writer->f = f;
+	writer->compression_level = compression_level;
+	writer->offset = sizeof(header);
+	return writer;
+}
+
+int survive_binary_writer_flush(survive_binary_writer *writer) {
+	if (writer->record_cnt == 0)
+		return 0;
+
+	svbr_block_header header = {.compression = SVBR_COMPRESSION_NONE,
+								.flags = writer->block_flags,
+								.raw_length = (uint32_t)writer->block_length,
+								.stored_length = (uint32_t)writer->block_length,
+								.record_cnt = writer->record_cnt,
+								.first_time = writer->first_time};
+	memcpy(header.magic, SVBR_BLOCK_MAGIC, 4);
+	const uint8_t *payload = writer->block;
+
+#ifndef NOZLIB
+	if (writer->compression_level > 0) {
+		uLongf compressed_length = compressBound(writer->block_length);
+		grow(&writer->compressed, &writer->compressed_size, compressed_length);
+		if (compress2(writer->compressed, &compressed_length, writer->block, writer->block_length,
+					  writer->compression_level) == Z_OK &&
+			compressed_length < writer->block_length) {
+			header.compression = SVBR_COMPRESSION_ZLIB;
+			header.stored_length = (uint32_t)compressed_length;
+			payload = writer->compressed;
+		}
+	}
+#endif
+
+	if (writer->index_cnt == writer->index_size) {
+		writer->index_size = writer->index_size ? writer->index_size * 2 : 64;
+		writer->index = SV_REALLOC(writer->index, writer->index_size * sizeof(svbr_index_entry));
+	}
+	writer->index[writer->index_cnt++] = (svbr_index_entry){.first_time = writer->first_time,
+															.offset = writer->offset,
+															.record_cnt = writer->record_cnt,
+															.flags = writer->block_flags};
+
+	if (fwrite(&header, sizeof(header), 1, writer->f) != 1 ||
+		fwrite(payload, 1, header.stored_length, writer->f) != header.stored_length) {
+		return -1;
+	}
+	// Flush whole blocks so a crashed recording can still be recovered by scanning the block headers
+	fflush(writer->f);
+
+	writer->offset += sizeof(header) + header.stored_length;
+	writer->block_length = 0;
+	writer->record_cnt = 0;
+	writer->block_flags = 0;
+	return 0;
+}
+
+int survive_binary_writer_write(survive_binary_writer *writer, double time, uint8_t type, const char *dev,
+								const void *data, uint32_t length) {
+	if (writer == 0)
+		return -1;
+
+	size_t stride = record_stride(length);
+	if (writer->block_length > 0 && writer->block_length + stride > SVBR_BLOCK_SIZE) {
+		if (survive_binary_writer_flush(writer) != 0)
+			return -1;
+	}
+	if (!grow(&writer->block, &writer->block_size, writer->block_length + stride))
+		return -1;
+
+	if (writer->record_cnt == 0)
+		writer->first_time = time;
+
+	survive_binary_record_header header = {.time = time, .length = length, .type = type};
+	if (dev)
+		strncpy(header.dev, dev, sizeof(header.dev));
+
+	uint8_t *p = writer->block + writer->block_length;
+	memcpy(p, &header, sizeof(header));
+	memcpy(p + sizeof(header), data, length);
+	memset(p + sizeof(header) + length, 0, stride - sizeof(header) - length);
+
+	writer->block_length += stride;
+	writer->record_cnt++;
+	if (type == SURVIVE_BINARY_RECORD_TEXT)
+		writer->block_flags |= SVBR_BLOCK_FLAG_HAS_TEXT;
+	return 0;
+}
+
+int survive_binary_writer_write_text(survive_binary_writer *writer, double time, const char *text, uint32_t length) {
+	return survive_binary_writer_write(writer, time, SURVIVE_BINARY_RECORD_TEXT, 0, text, length);
+}
+
+int survive_binary_writer_close(survive_binary_writer *writer) {
+	if (writer == 0)
+		return 0;
+
+	int rtn = survive_binary_writer_flush(writer);
+
+	uint32_t index_cnt = (uint32_t)writer->index_cnt;
+	svbr_footer footer = {.index_offset = writer->offset};
+	memcpy(footer.magic, SVBR_FOOTER_MAGIC, 4);
+	if (rtn != 0 || fwrite(SVBR_INDEX_MAGIC, 1, 4, writer->f) != 4 ||
+		fwrite(&index_cnt, sizeof(index_cnt), 1, writer->f) != 1 ||
+		fwrite(writer->index, sizeof(svbr_index_entry), index_cnt, writer->f) != index_cnt ||
+		fwrite(&footer, sizeof(footer), 1, writer->f) != 1) {
+		rtn = -1;
+	}
+
+	if (fclose(writer->f) != 0)
+		rtn = -1;
+	free(writer->block);
+	free(writer->compressed);
+	free(writer->index);
+	free(writer);
+	return rtn;
+}
+
+struct survive_binary_reader {
+	FILE *f;
+
+	svbr_index_entry *index;
+	size_t index_cnt;
+
+	uint8_t *block;
+	size_t block_size, block_length, position;
+	size_t current_block, next_block;
+
+	uint8_t *stored;
+	size_t stored_size;
+};
+
+static bool read_header(FILE *f) {
+	svbr_file_header header = {0};
+	if (fread(&header, sizeof(header), 1, f) != 1)
+		return false;
+	return memcmp(header.magic, SVBR_FILE_MAGIC, 4) == 0 && header.byte_order_mark == SVBR_BYTE_ORDER_MARK &&
+		   header.version <= SURVIVE_BINARY_RECORDING_VERSION && header.header_size == sizeof(header);
+}
+
+static bool read_index(survive_binary_reader *reader) {
+	FILE *f = reader->f;
+	svbr_footer footer = {0};
+	if (survive_fseek64(f, -(int64_t)sizeof(footer), SEEK_END) != 0)
+		return false;
+	int64_t file_length = survive_ftell64(f) + (int64_t)sizeof(footer);
+	if (fread(&footer, sizeof(footer), 1, f) != 1 || memcmp(footer.magic, SVBR_FOOTER_MAGIC, 4) != 0 ||
+		footer.index_offset > (uint64_t)file_length)
+		return false;
+
+	char magic[4];
+	uint32_t cnt = 0;
+	if (survive_fseek64(f, (int64_t)footer.index_offset, SEEK_SET) != 0 || fread(magic, 1, 4, f) != 4 ||
+		memcmp(magic, SVBR_INDEX_MAGIC, 4) != 0 || fread(&cnt, sizeof(cnt), 1, f) != 1)
+		return false;
+
+	// A corrupt count must not size the allocation; it can't claim more entries than the file has room for
+	if (cnt > (file_length - footer.index_offset) / sizeof(svbr_index_entry))
+		return false;
+
+	reader->index = SV_CALLOC_N(cnt + 1, sizeof(svbr_index_entry));
+	if (fread(reader->index, sizeof(svbr_index_entry), cnt, f) != cnt) {
+		free(reader->index);
+		reader->index = 0;
+		return false;
+	}
+	reader->index_cnt = cnt;
+	return true;
+}
+
+// Recordings which weren't closed have no index; walk the block headers and keep every complete block.
+static void rebuild_index(survive_binary_reader *reader) {
+	FILE *f = reader->f;
+	survive_fseek64(f, 0, SEEK_END);
+	uint64_t file_length = survive_ftell64(f);
+
+	size_t index_size = 0;
+	uint64_t offset = sizeof(svbr_file_header);
+	svbr_block_header header;
+	while (survive_fseek64(f, offset, SEEK_SET) == 0 && fread(&header, sizeof(header), 1, f) == 1 &&
+		   memcmp(header.magic, SVBR_BLOCK_MAGIC, 4) == 0 &&
+		   offset + sizeof(header) + header.stored_length <= file_length) {
+		if (reader->index_cnt == index_size) {
+			index_size = index_size ? index_size * 2 : 64;
+			reader->index = SV_REALLOC(reader->index, index_size * sizeof(svbr_index_entry));
+		}
+		reader->index[reader->index_cnt++] = (svbr_index_entry){.first_time = header.first_time,
+																.offset = offset,
+																.record_cnt = header.record_cnt,
+																.flags = header.flags};
+		offset += sizeof(header) + header.stored_length;
+	}
+}
+
+survive_binary_reader *survive_binary_reader_open(const char *filename) {
+	FILE *f = fopen(filename, "rb");
+	if (f == 0)
+		return 0;
+
+	if (!read_header(f)) {
+		fclose(f);
+		return 0;
+	}
+
+	survive_binary_reader *reader = SV_CALLOC(sizeof(survive_binary_reader));
+	reader->f = f;
+	if (!read_index(reader)) {
+		rebuild_index(reader);
+	}
+	return reader;
+}
+
+bool survive_binary_recording_file_is_binary(const char *filename) {
+	FILE *f = fopen(filename, "rb");
+	if (f == 0)
+		return false;
+	bool rtn = read_header(f);
+	fclose(f);
+	return rtn;
+}
+
+static int load_block(survive_binary_reader *reader, size_t block) {
+	svbr_block_header header;
+	if (survive_fseek64(reader->f, reader->index[block].offset, SEEK_SET) != 0 ||
+		fread(&header, sizeof(header), 1, reader->f) != 1 || memcmp(header.magic, SVBR_BLOCK_MAGIC, 4) != 0) {
+		return -1;
+	}
+
+	if (!grow(&reader->block, &reader->block_size, header.raw_length))
+		return -1;
+
+	if (header.compression == SVBR_COMPRESSION_NONE) {
+		if (header.stored_length != header.raw_length ||
+			fread(reader->block, 1, header.raw_length, reader->f) != header.raw_length)
+			return -1;
+	} else {
+#ifdef NOZLIB
+		return -1;
+#else
+		if (header.compression != SVBR_COMPRESSION_ZLIB ||
+			!grow(&reader->stored, &reader->stored_size, header.stored_length) ||
+			fread(reader->stored, 1, header.stored_length, reader->f) != header.stored_length)
+			return -1;
+
+		uLongf raw_length = header.raw_length;
+		if (uncompress(reader->block, &raw_length, reader->stored, header.stored_length) != Z_OK ||
+			raw_length != header.raw_length)
+			return -1;
+#endif
+	}
+
+	reader->current_block = block;
+	reader->next_block = block + 1;
+	reader->block_length = header.raw_length;
+	reader->position = 0;
+	return 0;
+}
+
+int survive_binary_reader_next(survive_binary_reader *reader, survive_binary_record *record) {
+	while (reader->position >= reader->block_length) {
+		if (reader->next_block >= reader->index_cnt)
+			return 0;
+		if (load_block(reader, reader->next_block) != 0)
+			return -1;
+	}
+
+	if (reader->position + sizeof(survive_binary_record_header) > reader->block_length)
+		return -1;
+
+	memcpy(&record->hdr, reader->block + reader->position, sizeof(survive_binary_record_header));
+	size_t stride = record_stride(record->hdr.length);
+	if (reader->position + stride > reader->block_length)
+		return -1;
+
+	record->data = reader->block + reader->position + sizeof(survive_binary_record_header);
+	record->block = reader->current_block;
+	reader->position += stride;
+	return 1;
+}
+
+size_t survive_binary_reader_block_count(const survive_binary_reader *reader) { return reader->index_cnt; }
+
+bool survive_binary_reader_block_has_text(const survive_binary_reader *reader, size_t block) {
+	return block < reader->index_cnt && (reader->index[block].flags & SVBR_BLOCK_FLAG_HAS_TEXT);
+}
+
+size_t survive_binary_reader_find_block(const survive_binary_reader *reader, double time) {
+	size_t lo = 0, hi = reader->index_cnt;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (reader->index[mid].first_time <= time)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo > 0 ? lo - 1 : 0;
+}
+
+int survive_binary_reader_seek_block(survive_binary_reader *reader, size_t block) {
+	if (block > reader->index_cnt)
+		return -1;
+	reader->next_block = block;
+	reader->block_length = reader->position = 0;
+	return 0;
+}
+
+void survive_binary_reader_close(survive_binary_reader *reader) {
+	if (reader == 0)
+		return;
+	fclose(reader->f);
+	free(reader->index);
+	free(reader->block);
+	free(reader->stored);
+	free(reader);
+}
+
+static bool light_axis(int acode, const char **LH_ID, const char **LH_Axis) {
+	if (acode < 0 || acode > 7)
+		return false;
+	*LH_ID = acode < 4 ? "L" : "R";
+	*LH_Axis = (acode & 1) ? "Y" : "X";
+	return true;
+}
+
+static int parse_typed(const char *line, const char *op, survive_binary_record_header *hdr, void *data) {
+	char dev[32];
+	if (strcmp(op, "Y") == 0) {
+		survive_channel channel;
+		survive_timecode timecode;
+		uint8_t ootx, gen;
+		if (sscanf(line, SYNC_SCANF, SYNC_SCANF_ARGS) != 5)
+			return -1;
+		*(survive_binary_sync *)data = (survive_binary_sync){
+			.timecode = timecode, .channel = channel, .ootx = ootx, .gen = gen};
+		hdr->type = SURVIVE_BINARY_RECORD_SYNC;
+		return sizeof(survive_binary_sync);
+	}
+	if (strcmp(op, "W") == 0) {
+		survive_channel channel;
+		int sensor_id;
+		survive_timecode timecode;
+		uint8_t flag;
+		if (sscanf(line, SWEEP_SCANF, SWEEP_SCANF_ARGS) != 5)
+			return -1;
+		*(survive_binary_sweep *)data =
+			(survive_binary_sweep){.timecode = timecode, .sensor_id = sensor_id, .channel = channel, .flag = flag};
+		hdr->type = SURVIVE_BINARY_RECORD_SWEEP;
+		return sizeof(survive_binary_sweep);
+	}
+	if (strcmp(op, "B") == 0) {
+		survive_channel channel;
+		int sensor_id;
+		survive_timecode timecode;
+		int8_t plane;
+		FLT angle;
+		if (sscanf(line, SWEEP_ANGLE_SCANF, SWEEP_ANGLE_SCANF_ARGS) != 6)
+			return -1;
+		*(survive_binary_sweep_angle *)data = (survive_binary_sweep_angle){
+			.angle = angle, .timecode = timecode, .sensor_id = sensor_id, .channel = channel, .plane = plane};
+		hdr->type = SURVIVE_BINARY_RECORD_SWEEP_ANGLE;
+		return sizeof(survive_binary_sweep_angle);
+	}
+	if (strcmp(op, "I") == 0 || strcmp(op, "i") == 0) {
+		survive_binary_imu *imu = data;
+		char i_char;
+		int mask, id;
+		uint32_t timecode;
+		FLT ag[9];
+		// Older recordings without magnetometer data stay as text; playback knows how to read them
+		if (sscanf(line,
+				   "%31s %c %d %u " FLT_sformat " " FLT_sformat " " FLT_sformat " " FLT_sformat " " FLT_sformat
+				   " " FLT_sformat " " FLT_sformat " " FLT_sformat " " FLT_sformat "%d",
+				   dev, &i_char, &mask, &timecode, &ag[0], &ag[1], &ag[2], &ag[3], &ag[4], &ag[5], &ag[6], &ag[7],
+				   &ag[8], &id) != 14)
+			return -1;
+		*imu = (survive_binary_imu){.timecode = timecode, .mask = mask, .id = id};
+		for (int i = 0; i < 9; i++)
+			imu->accelgyromag[i] = ag[i];
+		hdr->type = op[0] == 'I' ? SURVIVE_BINARY_RECORD_IMU : SURVIVE_BINARY_RECORD_RAW_IMU;
+		return sizeof(survive_binary_imu);
+	}
+	if (strcmp(op, "C") == 0) {
+		int sensor_id;
+		uint32_t timestamp, length;
+		if (sscanf(line, "%31s C %d %u %u", dev, &sensor_id, &timestamp, &length) != 4 || sensor_id < 0 ||
+			sensor_id > 255 || length > UINT16_MAX)
+			return -1;
+		*(survive_binary_lightcap *)data = (survive_binary_lightcap){
+			.timestamp = timestamp, .length = (uint16_t)length, .sensor_id = (uint8_t)sensor_id};
+		hdr->type = SURVIVE_BINARY_RECORD_LIGHTCAP;
+		return sizeof(survive_binary_lightcap);
+	}
+	if (strcmp(op, "S") == 0 || strcmp(op, "L") == 0 || strcmp(op, "R") == 0) {
+		survive_binary_light light = {0};
+		if (op[0] == 'S') {
+			if (sscanf(line, "%31s S %d %d %d %u %u %u", dev, &light.sensor_id, &light.acode, &light.timeinsweep,
+					   &light.timecode, &light.length, &light.lh) != 7 ||
+				light.acode != -1)
+				return -1;
+		} else {
+			char lhn[8], axn[8];
+			const char *LH_ID, *LH_Axis;
+			if (sscanf(line, "%31s %7s %7s %d %d %d %u %u %u", dev, lhn, axn, &light.sensor_id, &light.acode,
+					   &light.timeinsweep, &light.timecode, &light.length, &light.lh) != 9 ||
+				!light_axis(light.acode, &LH_ID, &LH_Axis) || strcmp(LH_ID, lhn) != 0 || strcmp(LH_Axis, axn) != 0)
+				return -1;
+		}
+		*(survive_binary_light *)data = light;
+		hdr->type = SURVIVE_BINARY_RECORD_LIGHT;
+		return sizeof(survive_binary_light);
+	}
+	return -1;
+}
+
+int survive_binary_record_parse(const char *line, survive_binary_record_header *hdr, void *data, size_t data_len) {
+	char dev[32], op[32];
+	hdr->type = SURVIVE_BINARY_RECORD_TEXT;
+	memset(hdr->dev, 0, sizeof(hdr->dev));
+
+	if (sscanf(line, "%31s %31s", dev, op) == 2 && strlen(dev) <= sizeof(hdr->dev) &&
+		data_len >= SURVIVE_BINARY_RECORD_MAX_TYPED_SIZE) {
+		int length = parse_typed(line, op, hdr, data);
+		if (length >= 0) {
+			memcpy(hdr->dev, dev, strlen(dev));
+			hdr->length = length;
+			return length;
+		}
+	}
+
+	size_t length = strlen(line);
+	if (length > data_len)
+		return -1;
+	memcpy(data, line, length);
+	hdr->type = SURVIVE_BINARY_RECORD_TEXT;
+	hdr->length = (uint32_t)length;
+	return (int)length;
+}
+
+int survive_binary_record_format(const survive_binary_record *record, char *buffer, size_t len) {
+	char dev[sizeof(record->hdr.dev) + 1] = {0};
+	memcpy(dev, record->hdr.dev, sizeof(record->hdr.dev));
+
+	switch (record->hdr.type) {
+	case SURVIVE_BINARY_RECORD_TEXT:
+		return snprintf(buffer, len, "%.*s", (int)record->hdr.length, (const char *)record->data);
+	case SURVIVE_BINARY_RECORD_SYNC: {
+		const survive_binary_sync *r = record->data;
+		survive_channel channel = r->channel;
+		survive_timecode timecode = r->timecode;
+		uint8_t ootx = r->ootx, gen = r->gen;
+		return snprintf(buffer, len, SYNC_PRINTF, SYNC_PRINTF_ARGS);
+	}
+	case SURVIVE_BINARY_RECORD_SWEEP: {
+		const survive_binary_sweep *r = record->data;
+		survive_channel channel = r->channel;
+		int sensor_id = r->sensor_id;
+		survive_timecode timecode = r->timecode;
+		uint8_t flag = r->flag;
+		return snprintf(buffer, len, SWEEP_PRINTF, SWEEP_PRINTF_ARGS);
+	}
+	case SURVIVE_BINARY_RECORD_SWEEP_ANGLE: {
+		const survive_binary_sweep_angle *r = record->data;
+		survive_channel channel = r->channel;
+		int sensor_id = r->sensor_id;
+		survive_timecode timecode = r->timecode;
+		int8_t plane = r->plane;
+		FLT angle = r->angle;
+		return snprintf(buffer, len, SWEEP_ANGLE_PRINTF, SWEEP_ANGLE_PRINTF_ARGS);
+	}
+	case SURVIVE_BINARY_RECORD_IMU:
+	case SURVIVE_BINARY_RECORD_RAW_IMU: {
+		const survive_binary_imu *r = record->data;
+		const double *ag = r->accelgyromag;
+		return snprintf(buffer, len, IMU_PRINTF, dev, record->hdr.type == SURVIVE_BINARY_RECORD_IMU ? 'I' : 'i',
+						r->mask, r->timecode, ag[0], ag[1], ag[2], ag[3], ag[4], ag[5], ag[6], ag[7], ag[8], r->id);
+	}
+	case SURVIVE_BINARY_RECORD_LIGHTCAP: {
+		const survive_binary_lightcap *r = record->data;
+		return snprintf(buffer, len, LIGHTCAP_PRINTF, dev, r->sensor_id, r->timestamp, r->length);
+	}
+	case SURVIVE_BINARY_RECORD_LIGHT: {
+		const survive_binary_light *r = record->data;
+		const char *LH_ID, *LH_Axis;
+		if (!light_axis(r->acode, &LH_ID, &LH_Axis)) {
+			return snprintf(buffer, len, LIGHT_SYNC_PRINTF, dev, r->sensor_id, r->acode, r->timeinsweep, r->timecode,
+							r->length, r->lh);
+		}
+		return snprintf(buffer, len, LIGHT_PRINTF, dev, LH_ID, LH_Axis, r->sensor_id, r->acode, r->timeinsweep,
+						r->timecode, r->length, r->lh);
+	}
+	}
+	return -1;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "survive.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Binary recording format; an alternative to the line based text .rec(.gz) format which is much cheaper to write and
+ * to play back.
+ *
+ * file   := file_header block* index footer
+ * block  := block_header payload     -- payload is a (optionally zlib compressed) run of records
+ * record := record_header data[length]
+ * index  := index_header index_entry* -- one entry per block, sorted by time, for O(log n) seeking
+ * footer := index offset + magic     -- the last 16 bytes of the file
+ *
+ * Hot data (light, sync, imu) is stored as fixed size typed records; everything else is stored as a TEXT record which
+ * holds the line exactly as the text format would have written it, minus the timestamp. All values are stored in the
+ * writer's byte order; the file header carries a byte order mark so readers can reject foreign files.
+ *
+ * If a recording was not closed cleanly the index and footer will be missing; readers rebuild the index by walking
+ * the block headers in that case.
+ */
+
+#define SURVIVE_BINARY_RECORDING_VERSION 1
+#define SURVIVE_BINARY_RECORDING_EXTENSION ".svbr"
+
+enum survive_binary_record_type {
+	SURVIVE_BINARY_RECORD_TEXT = 0,
+	SURVIVE_BINARY_RECORD_SYNC,
+	SURVIVE_BINARY_RECORD_SWEEP,
+	SURVIVE_BINARY_RECORD_SWEEP_ANGLE,
+	SURVIVE_BINARY_RECORD_IMU,
+	SURVIVE_BINARY_RECORD_RAW_IMU,
+	SURVIVE_BINARY_RECORD_LIGHTCAP,
+	SURVIVE_BINARY_RECORD_LIGHT,
+	SURVIVE_BINARY_RECORD_TYPE_CNT
+};
+
+typedef struct survive_binary_record_header {
+	double time;
+	uint32_t length; // Bytes of data following the header
+	uint8_t type;
+	char dev[3]; // Codename; not null terminated
+} survive_binary_record_header;
+
+typedef struct survive_binary_sync {
+	uint32_t timecode;
+	uint8_t channel, ootx, gen, reserved;
+} survive_binary_sync;
+
+typedef struct survive_binary_sweep {
+	uint32_t timecode;
+	int32_t sensor_id;
+	uint8_t channel, flag, reserved[2];
+} survive_binary_sweep;
+
+typedef struct survive_binary_sweep_angle {
+	double angle;
+	uint32_t timecode;
+	int32_t sensor_id;
+	uint8_t channel;
+	int8_t plane;
+	uint8_t reserved[6];
+} survive_binary_sweep_angle;
+
+typedef struct survive_binary_imu {
+	double accelgyromag[9];
+	uint32_t timecode;
+	int32_t mask, id;
+	uint32_t reserved;
+} survive_binary_imu;
+
+typedef struct survive_binary_lightcap {
+	uint32_t timestamp;
+	uint16_t length;
+	uint8_t sensor_id, reserved;
+} survive_binary_lightcap;
+
+typedef struct survive_binary_light {
+	uint32_t timecode, length, lh;
+	int32_t sensor_id, acode, timeinsweep;
+} survive_binary_light;
+
+typedef struct survive_binary_record {
+	survive_binary_record_header hdr;
+	const void *data; // Points into the reader's block buffer; valid until the next read or seek
+	size_t block;
+} survive_binary_record;
+
+typedef struct survive_binary_writer survive_binary_writer;
+typedef struct survive_binary_reader survive_binary_reader;
+
+/**
+ * Writers are not thread safe; callers serialize access.
+ *
+ * @param compression_level zlib level 0-9; 0 stores blocks uncompressed.
+ */
+SURVIVE_EXPORT survive_binary_writer *survive_binary_writer_open(const char *filename, int compression_level);
+SURVIVE_EXPORT int survive_binary_writer_write(survive_binary_writer *writer, double time, uint8_t type,
+											   const char *dev, const void *data, uint32_t length);
+SURVIVE_EXPORT int survive_binary_writer_write_text(survive_binary_writer *writer, double time, const char *text,
+													uint32_t length);
+SURVIVE_EXPORT int survive_binary_writer_flush(survive_binary_writer *writer);
+// Flushes the last block, writes out the index and footer and frees the writer
+SURVIVE_EXPORT int survive_binary_writer_close(survive_binary_writer *writer);
+
+/**
+ * @return 0 if the file couldn't be opened or isn't a binary recording
+ */
+SURVIVE_EXPORT survive_binary_reader *survive_binary_reader_open(const char *filename);
+SURVIVE_EXPORT bool survive_binary_recording_file_is_binary(const char *filename);
+/**
+ * @return 1 if a record was read, 0 at the end of the file and < 0 on error
+ */
+SURVIVE_EXPORT int survive_binary_reader_next(survive_binary_reader *reader, survive_binary_record *record);
+SURVIVE_EXPORT size_t survive_binary_reader_block_count(const survive_binary_reader *reader);
+// Whether or not the block contains any TEXT records; ie config, options, etc.
+SURVIVE_EXPORT bool survive_binary_reader_block_has_text(const survive_binary_reader *reader, size_t block);
+// Index of the last block which starts at or before time; binary searches the index.
+SURVIVE_EXPORT size_t survive_binary_reader_find_block(const survive_binary_reader *reader, double time);
+SURVIVE_EXPORT int survive_binary_reader_seek_block(survive_binary_reader *reader, size_t block);
+SURVIVE_EXPORT void survive_binary_reader_close(survive_binary_reader *reader);
+
+/**
+ * Conversion to and from the text format. Parsing turns the hot ops into typed records and everything else into a TEXT
+ * record; 'data' must be at least SURVIVE_BINARY_RECORD_MAX_TYPED_SIZE bytes or the length of the line.
+ *
+ * @param line a text line without its leading timestamp
+ * @return the length of the record data, or < 0 on error
+ */
+#define SURVIVE_BINARY_RECORD_MAX_TYPED_SIZE sizeof(survive_binary_imu)
+SURVIVE_EXPORT int survive_binary_record_parse(const char *line, survive_binary_record_header *hdr, void *data,
+											   size_t data_len);
+/**
+ * @return number of characters written, as snprintf
+ */
+SURVIVE_EXPORT int survive_binary_record_format(const survive_binary_record *record, char *buffer, size_t len);
+
+#ifdef __cplusplus
+};
+#endif
@@ -1,6 +1,7 @@
 #include "survive_default_devices.h"
 #include "assert.h"
 #include "json_helpers.h"
+#include "os_generic.h"
 #include "survive_internal.h"
 #include "survive_kalman_tracker.h"
 #include <jsmn.h>
@@ -9,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <survive.h>
+#include "survive_private.h"
 
 #define HMD_IMU_HZ 1000.0f
 #define VIVE_DEFAULT_IMU_HZ 250.0f
@@ -61,6 +63,7 @@ SurviveObject *survive_create_device(SurviveContext *ctx, const char *driver_nam
 	}
 
 	SurviveSensorActivations_ctor(device, &device->activations);
+	device->pipeline_lock = OGCreateMutex();
 
 	FLT playback_factor = survive_configf(ctx, "playback-factor", SC_GET, 1.);
 	bool use_async_posers = survive_configi(ctx, "threaded-posers", SC_GET, 1) && playback_factor != 0;
@@ -658,15 +661,10 @@ int survive_load_htc_config_format_from_file(SurviveObject *so, const char *file
 
 void survive_destroy_device(SurviveObject *so) {
 	SurviveContext *ctx = so->ctx;
+	survive_flush_sweep_angles(so);
 	SURVIVE_INVOKE_HOOK_SO(disconnect, so);
 
-	size_t idx = 0;
-	if (ctx->objs) {
-		for (idx = 0; idx < ctx->objs_ct && ctx->objs[idx] != so; idx++)
-			;
-		ctx->objs[idx] = ctx->objs[ctx->objs_ct - 1];
-		ctx->objs_ct--;
-	}
+	survive_unlink_object(ctx, so);
 
 	PoserData pd;
 	pd.pt = POSERDATA_DISASSOCIATE;
@@ -698,6 +696,7 @@ void survive_destroy_device(SurviveObject *so) {
 
 	survive_kalman_tracker_free(so->tracker);
 	SurviveSensorActivations_dtor(so);
+	OGDeleteMutex(so->pipeline_lock);
 	free(so->tracker);
 	free(so->sensor_locations);
 	free(so->sensor_normals);
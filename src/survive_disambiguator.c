@@ -94,3 +94,38 @@ bool handle_lightcap(SurviveObject *so, const LightcapElement *_le) {
 
 	return true;
 }
+
+bool handle_lightcaps(SurviveObject *so, const LightcapElement *les, size_t cnt) {
+	bool rtn = true;
+	LightcapElement mapped[32];
+	size_t mapped_cnt = 0;
+
+	for (size_t i = 0; i < cnt; i++) {
+		// Until we know which generation this is, each element has to go through detection on its own
+		if (so->ctx->lh_version == -1) {
+			rtn &= handle_lightcap(so, &les[i]);
+			continue;
+		}
+
+		assert(les[i].length > 0);
+		LightcapElement le = les[i];
+		survive_recording_lightcap(so, &le);
+
+		le.sensor_id = survive_map_sensor_id(so, le.sensor_id);
+		if (le.sensor_id == (uint8_t)-1) {
+			rtn = false;
+			continue;
+		}
+
+		mapped[mapped_cnt++] = le;
+		if (mapped_cnt == SURVIVE_ARRAY_SIZE(mapped)) {
+			SURVIVE_INVOKE_HOOK_SO(lightcaps, so, mapped, mapped_cnt, 0);
+			mapped_cnt = 0;
+		}
+	}
+
+	if (mapped_cnt > 0) {
+		SURVIVE_INVOKE_HOOK_SO(lightcaps, so, mapped, mapped_cnt, 0);
+	}
+	return rtn;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+/**
+ * fseek and ftell take a long, which is 32 bits on Windows and 32-bit builds; recordings and their indexes can be
+ * bigger than that.
+ */
+
+static inline int survive_fseek64(FILE *f, int64_t offset, int whence) {
+#ifdef _WIN32
+	return _fseeki64(f, (__int64)offset, whence);
+#else
+	return fseeko(f, (off_t)offset, whence);
+#endif
+}
+
+static inline int64_t survive_ftell64(FILE *f) {
+#ifdef _WIN32
+	return _ftelli64(f);
+#else
+	return ftello(f);
+#endif
+}
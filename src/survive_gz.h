@@ -10,6 +10,7 @@
 #define gzeof feof
 #define gzseek fseek
 #define gzgetc fgetc
+#define gzgets(file, buf, len) fgets(buf, len, file)
 #else
 #include <zlib.h>
 static inline int gzerror_dropin(gzFile f) {
@@ -0,0 +1,715 @@
+#include "survive_gz_index.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "survive_file_offset.h"
+
+#ifndef NOZLIB
+#include <zlib.h>
+
+#define GZ_INDEX_CHUNK (16 * 1024)
+// Largest distance a deflate back reference can reach
+#define GZ_INDEX_WINDOW (32 * 1024)
+
+#define GZ_INDEX_FILE_MAGIC "SVGI"
+#define GZ_INDEX_FILE_VERSION 2
+#define GZ_INDEX_BYTE_ORDER_MARK 0x01020304u
+
+typedef struct gz_index_point {
+	uint64_t in;  // Compressed offset of the first complete byte of the block
+	uint64_t out; // Uncompressed offset of the block
+	uint64_t line_out;
+	double line_time;
+	int32_t bits; // Bits of the byte before 'in' which belong to the block
+	uint32_t window_len;
+	uint8_t *window; // Preceding output, zlib compressed
+} gz_index_point;
+
+typedef struct gz_index_state_line {
+	double time;
+	uint64_t offset;
+	uint32_t length;
+	char *line;
+} gz_index_state_line;
+
+struct survive_gz_index {
+	uint64_t file_size;
+	int64_t file_mtime;
+	uint64_t span;
+
+	gz_index_point *points;
+	size_t point_cnt, point_size;
+
+	gz_index_state_line *state_lines;
+	size_t state_line_cnt, state_line_size;
+};
+
+typedef struct gz_index_file_header {
+	char magic[4];
+	uint16_t version;
+	uint16_t header_size;
+	uint32_t byte_order_mark;
+	uint32_t reserved;
+	uint64_t file_size;
+	int64_t file_mtime;
+	uint64_t span;
+	uint64_t point_cnt;
+	uint64_t state_line_cnt;
+} gz_index_file_header;
+
+typedef struct gz_index_file_point {
+	uint64_t in, out, line_out;
+	double line_time;
+	int32_t bits;
+	uint32_t window_len;
+} gz_index_file_point;
+
+typedef struct gz_index_file_state_line {
+	double time;
+	uint64_t offset;
+	uint32_t length;
+	uint32_t reserved;
+} gz_index_file_state_line;
+
+struct survive_gz_index_reader {
+	FILE *f;
+	z_stream strm;
+	bool finished, error;
+
+	size_t output_pos, output_len;
+	uint8_t input[GZ_INDEX_CHUNK];
+	uint8_t output[GZ_INDEX_CHUNK];
+	uint8_t window[GZ_INDEX_WINDOW];
+};
+
+static bool file_identity(const char *filename, uint64_t *size, int64_t *mtime) {
+#ifdef _WIN32
+	struct _stat64 st;
+	if (_stat64(filename, &st) != 0)
+		return false;
+#else
+	struct stat st;
+	if (stat(filename, &st) != 0)
+		return false;
+#endif
+	*size = (uint64_t)st.st_size;
+	*mtime = (int64_t)st.st_mtime;
+	return true;
+}
+
+/*
+ * Lines which don't carry data and have to be replayed when starting part way into a recording; see playback_run_line
+ * in driver_playback.c. 'rest' is the line without its timestamp.
+ */
+static bool is_state_line(const char *rest, size_t len) {
+	char dev[32] = {0}, op[32] = {0};
+	char buffer[96];
+	size_t copy = len < sizeof(buffer) - 1 ? len : sizeof(buffer) - 1;
+	memcpy(buffer, rest, copy);
+	buffer[copy] = 0;
+	if (sscanf(buffer, "%31s %31s", dev, op) < 1)
+		return false;
+
+	const char *dev_ops[] = {"OPTION", "EXTERNAL_TO_WORLD", "SPHERE", "LH_UP"};
+	for (int i = 0; i < SURVIVE_ARRAY_SIZE(dev_ops); i++) {
+		if (strcmp(dev, dev_ops[i]) == 0)
+			return true;
+	}
+
+	const char *ops[] = {"CONFIG", "LH_POSE", "IMU_SCALES"};
+	for (int i = 0; i < SURVIVE_ARRAY_SIZE(ops); i++) {
+		if (strcmp(op, ops[i]) == 0)
+			return true;
+	}
+	return false;
+}
+
+// Splits the timestamp off of a line; returns the rest of the line or 0 if there is no timestamp
+static const char *parse_line_time(const char *line, double *time) {
+	char *rest = 0;
+	*time = strtod(line, &rest);
+	if (rest == line || *rest != ' ')
+		return 0;
+	return rest + 1;
+}
+
+static void add_state_line(survive_gz_index *index, const char *line, size_t len, double time, uint64_t offset) {
+	if (index->state_line_cnt == index->state_line_size) {
+		index->state_line_size = index->state_line_size ? index->state_line_size * 2 : 16;
+		index->state_lines = SV_REALLOC(index->state_lines, index->state_line_size * sizeof(gz_index_state_line));
+	}
+	gz_index_state_line *state = &index->state_lines[index->state_line_cnt++];
+	state->time = time;
+	state->offset = offset;
+	state->length = (uint32_t)len;
+	state->line = SV_MALLOC(len + 1);
+	memcpy(state->line, line, len);
+	state->line[len] = 0;
+}
+
+static bool add_point(survive_gz_index *index, const z_stream *strm, uint64_t in, uint64_t out, const uint8_t *window) {
+	if (index->point_cnt == index->point_size) {
+		index->point_size = index->point_size ? index->point_size * 2 : 16;
+		index->points = SV_REALLOC(index->points, index->point_size * sizeof(gz_index_point));
+	}
+
+	// The window is the inflate output buffer, used circularly; unwrap it and keep only what precedes the point
+	uint8_t linear[GZ_INDEX_WINDOW];
+	size_t left = strm->avail_out;
+	if (left)
+		memcpy(linear, window + GZ_INDEX_WINDOW - left, left);
+	if (left < GZ_INDEX_WINDOW)
+		memcpy(linear + left, window, GZ_INDEX_WINDOW - left);
+	size_t valid = out < GZ_INDEX_WINDOW ? (size_t)out : GZ_INDEX_WINDOW;
+
+	uLongf compressed_len = compressBound(valid);
+	uint8_t *compressed = SV_MALLOC(compressed_len);
+	if (compress2(compressed, &compressed_len, linear + GZ_INDEX_WINDOW - valid, valid, 6) != Z_OK) {
+		free(compressed);
+		return false;
+	}
+
+	gz_index_point *point = &index->points[index->point_cnt++];
+	*point = (gz_index_point){.in = in,
+							  .out = out,
+							  .bits = strm->data_type & 7,
+							  .window_len = (uint32_t)compressed_len,
+							  .window = compressed};
+	return true;
+}
+
+typedef struct gz_index_builder {
+	survive_gz_index *index;
+	size_t pending_point; // First point which doesn't have its line yet
+	char *line;
+	size_t line_len, line_size;
+	uint64_t line_start;
+} gz_index_builder;
+
+static void builder_finish_line(gz_index_builder *builder) {
+	survive_gz_index *index = builder->index;
+	double time;
+	const char *rest = parse_line_time(builder->line, &time);
+	if (rest) {
+		for (; builder->pending_point < index->point_cnt &&
+			   index->points[builder->pending_point].out <= builder->line_start;
+			 builder->pending_point++) {
+			// The point at the start of the stream keeps whatever comes before the first timed line too
+			gz_index_point *point = &index->points[builder->pending_point];
+			point->line_out = point->out == 0 ? 0 : builder->line_start;
+			point->line_time = time;
+		}
+
+		if (is_state_line(rest, builder->line_len - (rest - builder->line))) {
+			add_state_line(index, builder->line, builder->line_len, time, builder->line_start);
+		}
+	}
+
+	builder->line_start += builder->line_len;
+	builder->line_len = 0;
+}
+
+static void builder_append(gz_index_builder *builder, const uint8_t *data, size_t len) {
+	while (len) {
+		const uint8_t *end = memchr(data, '\n', len);
+		size_t take = end ? (size_t)(end - data) + 1 : len;
+		if (builder->line_len + take + 1 > builder->line_size) {
+			while (builder->line_len + take + 1 > builder->line_size)
+				builder->line_size = builder->line_size ? builder->line_size * 2 : 1024;
+			builder->line = SV_REALLOC(builder->line, builder->line_size);
+		}
+		memcpy(builder->line + builder->line_len, data, take);
+		builder->line_len += take;
+		builder->line[builder->line_len] = 0;
+		if (end)
+			builder_finish_line(builder);
+
+		data += take;
+		len -= take;
+	}
+}
+
+/*
+ * This follows zran.c from the zlib distribution: inflate one deflate block at a time and, at block boundaries at least
+ * 'span' bytes apart, save enough state to resume from there.
+ */
+SURVIVE_EXPORT survive_gz_index *survive_gz_index_build(const char *filename, uint64_t span) {
+	survive_gz_index *index = SV_CALLOC(sizeof(survive_gz_index));
+	index->span = span;
+	if (!file_identity(filename, &index->file_size, &index->file_mtime)) {
+		free(index);
+		return 0;
+	}
+
+	FILE *f = fopen(filename, "rb");
+	if (f == 0) {
+		free(index);
+		return 0;
+	}
+
+	z_stream strm = {0};
+	// 47 -- 15 bits of window, with automatic zlib / gzip header detection
+	if (inflateInit2(&strm, 47) != Z_OK) {
+		fclose(f);
+		free(index);
+		return 0;
+	}
+
+	gz_index_builder builder = {.index = index};
+	uint8_t *input = SV_MALLOC(GZ_INDEX_CHUNK);
+	uint8_t *window = SV_MALLOC(GZ_INDEX_WINDOW);
+	uint64_t totin = 0, totout = 0, last = 0;
+	bool ok = true;
+	int ret = Z_OK;
+
+	do {
+		strm.avail_in = (uInt)fread(input, 1, GZ_INDEX_CHUNK, f);
+		strm.next_in = input;
+		if (ferror(f) || (totin == 0 && strm.avail_in == 0)) {
+			ok = false;
+			break;
+		}
+		// A truncated recording; index what is there
+		if (strm.avail_in == 0)
+			break;
+
+		do {
+			if (strm.avail_out == 0) {
+				strm.avail_out = GZ_INDEX_WINDOW;
+				strm.next_out = window;
+			}
+
+			uint8_t *out_start = strm.next_out;
+			totin += strm.avail_in;
+			totout += strm.avail_out;
+			ret = inflate(&strm, Z_BLOCK);
+			totin -= strm.avail_in;
+			totout -= strm.avail_out;
+
+			builder_append(&builder, out_start, strm.next_out - out_start);
+
+			if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR) {
+				ok = false;
+				break;
+			}
+			if (ret == Z_STREAM_END)
+				break;
+
+			// End of the header, or of a block which isn't the last one. inflate stops right after the header too, so
+			// the first point is always the start of the stream.
+			if ((strm.data_type & 128) && !(strm.data_type & 64) && (totout == 0 || totout - last > span)) {
+				if (!add_point(index, &strm, totin, totout, window)) {
+					ok = false;
+					break;
+				}
+				last = totout;
+			}
+		} while (strm.avail_in != 0);
+	} while (ok && ret != Z_STREAM_END);
+
+	// Concatenated gzip members would need the reader to skip trailers and headers; those aren't supported
+	if (ok && ret == Z_STREAM_END && (strm.avail_in != 0 || fgetc(f) != EOF))
+		ok = false;
+
+	if (ok && builder.line_len)
+		builder_finish_line(&builder);
+	// Points past the last line are of no use
+	index->point_cnt = builder.pending_point;
+	// Every time before the first point's has to be readable from the first point
+	if (index->point_cnt && index->points[0].line_out != 0)
+		ok = false;
+
+	inflateEnd(&strm);
+	fclose(f);
+	free(input);
+	free(window);
+	free(builder.line);
+
+	if (!ok || index->point_cnt == 0) {
+		survive_gz_index_free(index);
+		return 0;
+	}
+	return index;
+}
+
+SURVIVE_EXPORT int survive_gz_index_save(const survive_gz_index *index, const char *index_filename) {
+	FILE *f = fopen(index_filename, "wb");
+	if (f == 0)
+		return -1;
+
+	gz_index_file_header header = {.version = GZ_INDEX_FILE_VERSION,
+								   .header_size = sizeof(gz_index_file_header),
+								   .byte_order_mark = GZ_INDEX_BYTE_ORDER_MARK,
+								   .file_size = index->file_size,
+								   .file_mtime = index->file_mtime,
+								   .span = index->span,
+								   .point_cnt = index->point_cnt,
+								   .state_line_cnt = index->state_line_cnt};
+	memcpy(header.magic, GZ_INDEX_FILE_MAGIC, sizeof(header.magic));
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+
+	for (size_t i = 0; ok && i < index->point_cnt; i++) {
+		const gz_index_point *point = &index->points[i];
+		gz_index_file_point p = {.in = point->in,
+								 .out = point->out,
+								 .line_out = point->line_out,
+								 .line_time = point->line_time,
+								 .bits = point->bits,
+								 .window_len = point->window_len};
+		ok = fwrite(&p, sizeof(p), 1, f) == 1 && fwrite(point->window, 1, point->window_len, f) == point->window_len;
+	}
+
+	for (size_t i = 0; ok && i < index->state_line_cnt; i++) {
+		const gz_index_state_line *state = &index->state_lines[i];
+		gz_index_file_state_line s = {.time = state->time, .offset = state->offset, .length = state->length};
+		ok = fwrite(&s, sizeof(s), 1, f) == 1 && fwrite(state->line, 1, state->length, f) == state->length;
+	}
+
+	ok = fclose(f) == 0 && ok;
+	if (!ok) {
+		remove(index_filename);
+		return -1;
+	}
+	return 0;
+}
+
+SURVIVE_EXPORT survive_gz_index *survive_gz_index_load(const char *filename, const char *index_filename) {
+	uint64_t file_size;
+	int64_t file_mtime;
+	if (!file_identity(filename, &file_size, &file_mtime))
+		return 0;
+
+	FILE *f = fopen(index_filename, "rb");
+	if (f == 0)
+		return 0;
+
+	gz_index_file_header header;
+	if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, GZ_INDEX_FILE_MAGIC, 4) != 0 ||
+		header.version != GZ_INDEX_FILE_VERSION || header.header_size != sizeof(header) ||
+		header.byte_order_mark != GZ_INDEX_BYTE_ORDER_MARK || header.file_size != file_size ||
+		header.file_mtime != file_mtime || header.point_cnt == 0) {
+		fclose(f);
+		return 0;
+	}
+
+	survive_gz_index *index = SV_CALLOC(sizeof(survive_gz_index));
+	index->file_size = header.file_size;
+	index->file_mtime = header.file_mtime;
+	index->span = header.span;
+	index->point_size = header.point_cnt;
+	index->points = SV_CALLOC_N(index->point_size, sizeof(gz_index_point));
+
+	bool ok = true;
+	for (size_t i = 0; ok && i < header.point_cnt; i++) {
+		gz_index_file_point p;
+		ok = fread(&p, sizeof(p), 1, f) == 1 && p.window_len <= compressBound(GZ_INDEX_WINDOW);
+		if (!ok)
+			break;
+
+		gz_index_point *point = &index->points[index->point_cnt++];
+		*point = (gz_index_point){.in = p.in,
+								  .out = p.out,
+								  .line_out = p.line_out,
+								  .line_time = p.line_time,
+								  .bits = p.bits,
+								  .window_len = p.window_len,
+								  .window = SV_MALLOC(p.window_len + 1)};
+		ok = fread(point->window, 1, p.window_len, f) == p.window_len;
+	}
+
+	for (size_t i = 0; ok && i < header.state_line_cnt; i++) {
+		gz_index_file_state_line s;
+		ok = fread(&s, sizeof(s), 1, f) == 1 && s.length < (1u << 30);
+		if (!ok)
+			break;
+
+		char *line = SV_MALLOC(s.length + 1);
+		ok = fread(line, 1, s.length, f) == s.length;
+		if (ok)
+			add_state_line(index, line, s.length, s.time, s.offset);
+		free(line);
+	}
+
+	fclose(f);
+	if (!ok) {
+		survive_gz_index_free(index);
+		return 0;
+	}
+	return index;
+}
+
+SURVIVE_EXPORT survive_gz_index *survive_gz_index_open(const char *filename) {
+	size_t len = strlen(filename) + strlen(SURVIVE_GZ_INDEX_EXTENSION) + 1;
+	char *index_filename = SV_MALLOC(len);
+	snprintf(index_filename, len, "%s" SURVIVE_GZ_INDEX_EXTENSION, filename);
+
+	survive_gz_index *index = survive_gz_index_load(filename, index_filename);
+	if (index == 0) {
+		index = survive_gz_index_build(filename, SURVIVE_GZ_INDEX_SPAN);
+		// Recordings in read only directories are still seekable, they just pay for the build every time
+		if (index)
+			survive_gz_index_save(index, index_filename);
+	}
+
+	free(index_filename);
+	return index;
+}
+
+SURVIVE_EXPORT void survive_gz_index_free(survive_gz_index *index) {
+	if (index == 0)
+		return;
+	for (size_t i = 0; i < index->point_cnt; i++)
+		free(index->points[i].window);
+	for (size_t i = 0; i < index->state_line_cnt; i++)
+		free(index->state_lines[i].line);
+	free(index->points);
+	free(index->state_lines);
+	free(index);
+}
+
+SURVIVE_EXPORT size_t survive_gz_index_point_count(const survive_gz_index *index) { return index->point_cnt; }
+
+SURVIVE_EXPORT size_t survive_gz_index_find_point(const survive_gz_index *index, double time) {
+	size_t lo = 0, hi = index->point_cnt;
+	while (hi - lo > 1) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (index->points[mid].line_time <= time)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+SURVIVE_EXPORT double survive_gz_index_point_time(const survive_gz_index *index, size_t point) {
+	return point < index->point_cnt ? index->points[point].line_time : 0;
+}
+
+SURVIVE_EXPORT uint64_t survive_gz_index_point_offset(const survive_gz_index *index, size_t point) {
+	return point < index->point_cnt ? index->points[point].line_out : 0;
+}
+
+SURVIVE_EXPORT size_t survive_gz_index_state_line_count(const survive_gz_index *index) {
+	return index->state_line_cnt;
+}
+
+SURVIVE_EXPORT const char *survive_gz_index_state_line(const survive_gz_index *index, size_t i, double *time,
+													   uint64_t *offset) {
+	if (i >= index->state_line_cnt)
+		return 0;
+	if (time)
+		*time = index->state_lines[i].time;
+	if (offset)
+		*offset = index->state_lines[i].offset;
+	return index->state_lines[i].line;
+}
+
+static bool reader_fill(survive_gz_index_reader *reader) {
+	z_stream *strm = &reader->strm;
+	reader->output_pos = 0;
+	strm->next_out = reader->output;
+	strm->avail_out = sizeof(reader->output);
+
+	while (!reader->finished && strm->avail_out == sizeof(reader->output)) {
+		if (strm->avail_in == 0) {
+			strm->avail_in = (uInt)fread(reader->input, 1, sizeof(reader->input), reader->f);
+			strm->next_in = reader->input;
+			if (strm->avail_in == 0) {
+				reader->error = ferror(reader->f) != 0;
+				reader->finished = true;
+				break;
+			}
+		}
+
+		int ret = inflate(strm, Z_NO_FLUSH);
+		if (ret == Z_STREAM_END) {
+			reader->finished = true;
+		} else if (ret != Z_OK) {
+			reader->error = reader->finished = true;
+		}
+	}
+
+	reader->output_len = sizeof(reader->output) - strm->avail_out;
+	return reader->output_len > 0;
+}
+
+SURVIVE_EXPORT survive_gz_index_reader *survive_gz_index_reader_open(const survive_gz_index *index,
+																	 const char *filename, size_t point_idx) {
+	if (point_idx >= index->point_cnt)
+		return 0;
+	const gz_index_point *point = &index->points[point_idx];
+
+	survive_gz_index_reader *reader = SV_CALLOC(sizeof(survive_gz_index_reader));
+	reader->f = fopen(filename, "rb");
+	if (reader->f == 0) {
+		free(reader);
+		return 0;
+	}
+
+	// Raw deflate from here on; the access point is in the middle of the stream
+	if (inflateInit2(&reader->strm, -15) != Z_OK) {
+		fclose(reader->f);
+		free(reader);
+		return 0;
+	}
+
+	bool ok = survive_fseek64(reader->f, point->in - (point->bits ? 1 : 0), SEEK_SET) == 0;
+	if (ok && point->bits) {
+		int c = fgetc(reader->f);
+		ok = c != EOF && inflatePrime(&reader->strm, point->bits, c >> (8 - point->bits)) == Z_OK;
+	}
+
+	uLongf window_len = sizeof(reader->window);
+	ok = ok && uncompress(reader->window, &window_len, point->window, point->window_len) == Z_OK;
+	if (ok && window_len)
+		ok = inflateSetDictionary(&reader->strm, reader->window, (uInt)window_len) == Z_OK;
+
+	// Skip the tail of whichever line straddles the block boundary
+	for (uint64_t skip = point->line_out - point->out; ok && skip;) {
+		if (reader->output_pos == reader->output_len && !reader_fill(reader)) {
+			ok = false;
+			break;
+		}
+		size_t avail = reader->output_len - reader->output_pos;
+		size_t take = skip < avail ? (size_t)skip : avail;
+		reader->output_pos += take;
+		skip -= take;
+	}
+
+	if (!ok) {
+		survive_gz_index_reader_close(reader);
+		return 0;
+	}
+	return reader;
+}
+
+SURVIVE_EXPORT int survive_gz_index_reader_getdelim(survive_gz_index_reader *reader, char **line, size_t *n,
+													int delimiter) {
+	size_t len = 0;
+	for (;;) {
+		if (reader->output_pos == reader->output_len && !reader_fill(reader))
+			break;
+
+		const uint8_t *start = reader->output + reader->output_pos;
+		size_t avail = reader->output_len - reader->output_pos;
+		const uint8_t *end = memchr(start, delimiter, avail);
+		size_t take = end ? (size_t)(end - start) + 1 : avail;
+
+		if (*line == 0 || len + take + 1 > *n) {
+			size_t size = *line && *n ? *n : 128;
+			while (size < len + take + 1)
+				size *= 2;
+			*line = SV_REALLOC(*line, size);
+			*n = size;
+		}
+		memcpy(*line + len, start, take);
+		len += take;
+		reader->output_pos += take;
+		if (end)
+			break;
+	}
+
+	if (len == 0)
+		return -1;
+	(*line)[len] = 0;
+	return (int)len;
+}
+
+SURVIVE_EXPORT bool survive_gz_index_reader_eof(const survive_gz_index_reader *reader) {
+	return reader->finished && reader->output_pos == reader->output_len;
+}
+
+SURVIVE_EXPORT bool survive_gz_index_reader_error(const survive_gz_index_reader *reader) { return reader->error; }
+
+SURVIVE_EXPORT void survive_gz_index_reader_close(survive_gz_index_reader *reader) {
+	if (reader == 0)
+		return;
+	inflateEnd(&reader->strm);
+	fclose(reader->f);
+	free(reader);
+}
+
+SURVIVE_EXPORT int survive_gz_index_extract(const survive_gz_index *index, const char *filename, const char *output,
+											double start, double end) {
+	size_t point = survive_gz_index_find_point(index, start);
+	survive_gz_index_reader *reader = survive_gz_index_reader_open(index, filename, point);
+	if (reader == 0)
+		return -1;
+
+	size_t output_len = strlen(output);
+	bool compress = output_len > 3 && strcmp(output + output_len - 3, ".gz") == 0;
+	gzFile out = gzopen(output, compress ? "w6" : "wT");
+	if (out == 0) {
+		survive_gz_index_reader_close(reader);
+		return -1;
+	}
+
+	int written = 0;
+	bool ok = true;
+	uint64_t line_out = index->points[point].line_out;
+	for (size_t i = 0; ok && i < index->state_line_cnt && index->state_lines[i].offset < line_out; i++) {
+		const gz_index_state_line *state = &index->state_lines[i];
+		ok = gzwrite(out, state->line, state->length) == (int)state->length;
+		written++;
+	}
+
+	char *line = 0;
+	size_t n = 0;
+	int len;
+	while (ok && (len = survive_gz_index_reader_getdelim(reader, &line, &n, '\n')) > 0) {
+		double time;
+		const char *rest = parse_line_time(line, &time);
+		if (rest == 0)
+			continue;
+		if (time > end)
+			break;
+		if (time < start && !is_state_line(rest, len - (rest - line)))
+			continue;
+
+		ok = gzwrite(out, line, len) == len;
+		written++;
+	}
+	ok = ok && !survive_gz_index_reader_error(reader);
+
+	free(line);
+	survive_gz_index_reader_close(reader);
+	ok = gzclose(out) == Z_OK && ok;
+	return ok ? written : -1;
+}
+
+#else
+
+SURVIVE_EXPORT survive_gz_index *survive_gz_index_build(const char *filename, uint64_t span) { return 0; }
+SURVIVE_EXPORT int survive_gz_index_save(const survive_gz_index *index, const char *index_filename) { return -1; }
+SURVIVE_EXPORT survive_gz_index *survive_gz_index_load(const char *filename, const char *index_filename) { return 0; }
+SURVIVE_EXPORT survive_gz_index *survive_gz_index_open(const char *filename) { return 0; }
+SURVIVE_EXPORT void survive_gz_index_free(survive_gz_index *index) {}
+SURVIVE_EXPORT size_t survive_gz_index_point_count(const survive_gz_index *index) { return 0; }
+SURVIVE_EXPORT size_t survive_gz_index_find_point(const survive_gz_index *index, double time) { return 0; }
+SURVIVE_EXPORT double survive_gz_index_point_time(const survive_gz_index *index, size_t point) { return 0; }
+SURVIVE_EXPORT uint64_t survive_gz_index_point_offset(const survive_gz_index *index, size_t point) { return 0; }
+SURVIVE_EXPORT size_t survive_gz_index_state_line_count(const survive_gz_index *index) { return 0; }
+SURVIVE_EXPORT const char *survive_gz_index_state_line(const survive_gz_index *index, size_t i, double *time,
+													   uint64_t *offset) {
+	return 0;
+}
+SURVIVE_EXPORT survive_gz_index_reader *survive_gz_index_reader_open(const survive_gz_index *index,
+																	 const char *filename, size_t point) {
+	return 0;
+}
+SURVIVE_EXPORT int survive_gz_index_reader_getdelim(survive_gz_index_reader *reader, char **line, size_t *n,
+													int delimiter) {
+	return -1;
+}
+SURVIVE_EXPORT bool survive_gz_index_reader_eof(const survive_gz_index_reader *reader) { return true; }
+SURVIVE_EXPORT bool survive_gz_index_reader_error(const survive_gz_index_reader *reader) { return true; }
+SURVIVE_EXPORT void survive_gz_index_reader_close(survive_gz_index_reader *reader) {}
+SURVIVE_EXPORT int survive_gz_index_extract(const survive_gz_index *index, const char *filename, const char *output,
+											double start, double end) {
+	return -1;
+}
+
+#endif
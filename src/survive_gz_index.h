@@ -0,0 +1,92 @@
+#pragma once
+
+#include "survive.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Random access into gzip compressed text recordings (.rec.gz).
+ *
+ * Gzip streams can only be decompressed from the start, so playing back from part way into a long recording used to
+ * mean inflating and discarding everything before it. An index is a list of access points, one at a deflate block
+ * boundary every 'span' bytes of output, each holding the compressed offset, the bit offset into that byte and the
+ * 32KB of output preceding it; which is all zlib needs to resume decompression there. Each access point also records
+ * the offset and timestamp of the first line starting after it.
+ *
+ * Lines which set up state rather than carry data -- CONFIG, LH_POSE, IMU_SCALES, OPTION, etc -- are kept in the
+ * index too, so a reader starting at an access point can replay them first.
+ *
+ * Indexes are stored next to the recording as '<recording>.idx' and are tied to the recording's size and modification
+ * time. Only single member gzip files (which is what the recorder writes) can be indexed.
+ */
+
+#define SURVIVE_GZ_INDEX_EXTENSION ".idx"
+// Default spacing between access points, in uncompressed bytes
+#define SURVIVE_GZ_INDEX_SPAN (4 * 1024 * 1024)
+
+typedef struct survive_gz_index survive_gz_index;
+typedef struct survive_gz_index_reader survive_gz_index_reader;
+
+/**
+ * Decompresses the whole recording once to build its index.
+ *
+ * @return 0 if the file can't be read or isn't a single member gzip file
+ */
+SURVIVE_EXPORT survive_gz_index *survive_gz_index_build(const char *filename, uint64_t span);
+SURVIVE_EXPORT int survive_gz_index_save(const survive_gz_index *index, const char *index_filename);
+/**
+ * @return 0 if the index doesn't exist, is corrupt or is out of date with respect to 'filename'
+ */
+SURVIVE_EXPORT survive_gz_index *survive_gz_index_load(const char *filename, const char *index_filename);
+/**
+ * Loads '<filename>.idx'; failing that builds the index and tries to save it there.
+ */
+SURVIVE_EXPORT survive_gz_index *survive_gz_index_open(const char *filename);
+SURVIVE_EXPORT void survive_gz_index_free(survive_gz_index *index);
+
+SURVIVE_EXPORT size_t survive_gz_index_point_count(const survive_gz_index *index);
+// Index of the last access point whose first line is at or before time. Point 0 is always the start of the stream, so
+// earlier times get that.
+SURVIVE_EXPORT size_t survive_gz_index_find_point(const survive_gz_index *index, double time);
+// Time and uncompressed offset of the first line after the given access point
+SURVIVE_EXPORT double survive_gz_index_point_time(const survive_gz_index *index, size_t point);
+SURVIVE_EXPORT uint64_t survive_gz_index_point_offset(const survive_gz_index *index, size_t point);
+
+SURVIVE_EXPORT size_t survive_gz_index_state_line_count(const survive_gz_index *index);
+/**
+ * @return the full line, timestamp and line ending included; owned by the index
+ */
+SURVIVE_EXPORT const char *survive_gz_index_state_line(const survive_gz_index *index, size_t i, double *time,
+													   uint64_t *offset);
+
+/**
+ * Opens 'filename' positioned at the first line after the given access point.
+ */
+SURVIVE_EXPORT survive_gz_index_reader *survive_gz_index_reader_open(const survive_gz_index *index,
+																	 const char *filename, size_t point);
+/**
+ * Same contract as getdelim; the delimiter is included in the result.
+ *
+ * @return the number of characters read, or -1 at the end of the stream or on error
+ */
+SURVIVE_EXPORT int survive_gz_index_reader_getdelim(survive_gz_index_reader *reader, char **line, size_t *n,
+													int delimiter);
+SURVIVE_EXPORT bool survive_gz_index_reader_eof(const survive_gz_index_reader *reader);
+SURVIVE_EXPORT bool survive_gz_index_reader_error(const survive_gz_index_reader *reader);
+SURVIVE_EXPORT void survive_gz_index_reader_close(survive_gz_index_reader *reader);
+
+/**
+ * Writes the lines of 'filename' between start and end (inclusive, in seconds) to a new recording, preceded by every
+ * state line from before start. Only the part of the file from the access point before start is decompressed.
+ *
+ * @return the number of lines written, or < 0 on error
+ */
+SURVIVE_EXPORT int survive_gz_index_extract(const survive_gz_index *index, const char *filename, const char *output,
+											double start, double end);
+
+#ifdef __cplusplus
+};
+#endif
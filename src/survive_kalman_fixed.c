@@ -0,0 +1,308 @@
+#include "survive_kalman_fixed.h"
+#include "force_O3.h"
+
+#include <math.h>
+#include <string.h>
+
+// SurviveKalmanModel without the IMU bias; the largest state the tracker's main model has
+#define FIXED_MAX_STATE 16
+#define FIXED_MAX_MEAS SURVIVE_KALMAN_FIXED_MAX_MEAS
+
+#ifdef _MSC_VER
+#define FIXED_INLINE static __forceinline
+#else
+#define FIXED_INLINE static inline __attribute__((always_inline))
+#endif
+
+// The bodies below take the state size as an argument, but are only ever called through the wrappers at the bottom
+// with a literal; so after inlining every loop over the state has a constant trip count.
+
+/*
+ * Lower Cholesky factor L of the symmetric n x n P, with the upper triangle zeroed. Columns with no variance left are
+ * zeroed rather than failing, so it also works on singular PSD matrices like the process noise. When P has picked up a
+ * negative pivot, a diagonal jitter is added until it factors and the return is false.
+ */
+FIXED_INLINE bool cholesky_repair(const size_t n, const FLT *P, FLT *L) {
+	FLT scale = 0;
+	for (size_t i = 0; i < n; i++) {
+		scale += FLT_FABS(P[i * n + i]);
+	}
+	const FLT tiny = 1e-12 * (scale / n + 1e-30);
+
+	FLT jitter = 0;
+	for (int attempt = 0; attempt < 16; attempt++) {
+		bool ok = true;
+		for (size_t j = 0; j < n && ok; j++) {
+			FLT d = P[j * n + j] + jitter;
+			for (size_t k = 0; k < j; k++) {
+				d -= L[j * n + k] * L[j * n + k];
+			}
+			for (size_t k = j + 1; k < n; k++) {
+				L[j * n + k] = 0;
+			}
+
+			if (d < -tiny) {
+				ok = false;
+				break;
+			}
+			if (d <= tiny) {
+				for (size_t i = j; i < n; i++) {
+					L[i * n + j] = 0;
+				}
+				continue;
+			}
+
+			d = FLT_SQRT(d);
+			L[j * n + j] = d;
+			for (size_t i = j + 1; i < n; i++) {
+				FLT v = P[i * n + j];
+				for (size_t k = 0; k < j; k++) {
+					v -= L[i * n + k] * L[j * n + k];
+				}
+				L[i * n + j] = v / d;
+			}
+		}
+		if (ok) {
+			return jitter == 0;
+		}
+		jitter = jitter == 0 ? tiny * 1e3 : jitter * 10;
+	}
+
+	// Nothing left to salvage; keep only the diagonal
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = 0; j < n; j++) {
+			L[i * n + j] = i == j ? FLT_SQRT(FLT_FABS(P[i * n + i])) : 0;
+		}
+	}
+	return false;
+}
+
+// P = L * L^T; symmetric and PSD by construction
+FIXED_INLINE void outer_square(const size_t n, const FLT *L, FLT *P) {
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = i; j < n; j++) {
+			FLT v = 0;
+			for (size_t k = 0; k < n; k++) {
+				v += L[i * n + k] * L[j * n + k];
+			}
+			P[i * n + j] = P[j * n + i] = v;
+		}
+	}
+}
+
+FIXED_INLINE bool sqrt_predict_covariance(const size_t n, FLT *P, const FLT *F, const FLT *Q) {
+	FLT L[FIXED_MAX_STATE * FIXED_MAX_STATE], Lq[FIXED_MAX_STATE * FIXED_MAX_STATE];
+	bool clean = cholesky_repair(n, P, L);
+	if (Q) {
+		cholesky_repair(n, Q, Lq);
+	} else {
+		memset(Lq, 0, n * n * sizeof(FLT));
+	}
+
+	// A^T = [F * L, Lq]^T is 2n x n; Householder QR of it gives R with R^T * R = F * P * F^T + Q
+	FLT At[2 * FIXED_MAX_STATE * FIXED_MAX_STATE];
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = 0; j < n; j++) {
+			// L is lower triangular, so only k >= j contributes
+			FLT v = 0;
+			for (size_t k = j; k < n; k++) {
+				v += F[i * n + k] * L[k * n + j];
+			}
+			At[j * n + i] = v;
+			At[(n + j) * n + i] = Lq[i * n + j];
+		}
+	}
+
+	for (size_t c = 0; c < n; c++) {
+		FLT norm = 0;
+		for (size_t r = c; r < 2 * n; r++) {
+			norm += At[r * n + c] * At[r * n + c];
+		}
+		norm = FLT_SQRT(norm);
+		if (norm == 0) {
+			continue;
+		}
+
+		FLT alpha = At[c * n + c] > 0 ? -norm : norm;
+		FLT v0 = At[c * n + c] - alpha;
+		FLT vnorm2 = v0 * v0 + norm * norm - At[c * n + c] * At[c * n + c];
+		if (vnorm2 == 0) {
+			continue;
+		}
+
+		At[c * n + c] = v0;
+		for (size_t j = c + 1; j < n; j++) {
+			FLT d = 0;
+			for (size_t r = c; r < 2 * n; r++) {
+				d += At[r * n + c] * At[r * n + j];
+			}
+			d *= 2 / vnorm2;
+			for (size_t r = c; r < 2 * n; r++) {
+				At[r * n + j] -= d * At[r * n + c];
+			}
+		}
+		At[c * n + c] = alpha;
+	}
+
+	// The upper n x n of At is now R; P = R^T * R
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = 0; j < n; j++) {
+			L[i * n + j] = j <= i ? At[j * n + i] : 0;
+		}
+	}
+	outer_square(n, L, P);
+	return clean;
+}
+
+/*
+ * Iterated EKF update in Potter's square root form: the measurements, whose noise is uncorrelated, are folded in one at
+ * a time against a factor of P. It never forms or factors S, and P is rebuilt from the factor at the end.
+ */
+FIXED_INLINE FLT sqrt_update(const size_t n, FLT *x, FLT *P, survive_kalman_fixed_meas_fn fn, void *user,
+							 const CnMat *Z, const FLT *R_diag, int max_iterations, FLT max_error, bool *clean) {
+	const size_t m = Z->rows;
+	if (m == 0 || m > FIXED_MAX_MEAS) {
+		return -1;
+	}
+
+	FLT x0[FIXED_MAX_STATE], xi[FIXED_MAX_STATE];
+	memcpy(x0, x, n * sizeof(FLT));
+
+	FLT L0[FIXED_MAX_STATE * FIXED_MAX_STATE], L[FIXED_MAX_STATE * FIXED_MAX_STATE];
+	*clean = cholesky_repair(n, P, L0);
+
+	FLT H[FIXED_MAX_MEAS * FIXED_MAX_STATE], y[FIXED_MAX_MEAS];
+	CnMat x_mat = cnMat(n, 1, x);
+	CnMat y_mat = cnMat(m, 1, y);
+	CnMat H_mat = cnMat(m, n, H);
+
+	if (max_iterations < 1) {
+		max_iterations = 1;
+	}
+
+	FLT err = 0;
+	for (int iteration = 0; iteration < max_iterations; iteration++) {
+		if (!fn(user, Z, &x_mat, &y_mat, &H_mat)) {
+			memcpy(x, x0, n * sizeof(FLT));
+			return -1;
+		}
+
+		err = 0;
+		for (size_t k = 0; k < m; k++) {
+			err += y[k] * y[k];
+		}
+		err /= m;
+		if (iteration == 0 && max_error > 0 && err > max_error) {
+			return -1;
+		}
+
+		// Linearization point; x walks from the prior as each measurement is folded in
+		memcpy(xi, x, n * sizeof(FLT));
+		memcpy(x, x0, n * sizeof(FLT));
+		memcpy(L, L0, n * n * sizeof(FLT));
+
+		for (size_t k = 0; k < m; k++) {
+			const FLT *h = &H[k * n];
+
+			FLT e = y[k], phi[FIXED_MAX_STATE], s = R_diag[k];
+			for (size_t j = 0; j < n; j++) {
+				e -= h[j] * (x[j] - xi[j]);
+			}
+			for (size_t j = 0; j < n; j++) {
+				FLT v = 0;
+				for (size_t i = 0; i < n; i++) {
+					v += L[i * n + j] * h[i];
+				}
+				phi[j] = v;
+				s += v * v;
+			}
+			if (!(s > 0)) {
+				continue;
+			}
+
+			FLT K[FIXED_MAX_STATE];
+			FLT gamma = 1. / (1. + FLT_SQRT(R_diag[k] / s));
+			for (size_t i = 0; i < n; i++) {
+				FLT v = 0;
+				for (size_t j = 0; j < n; j++) {
+					v += L[i * n + j] * phi[j];
+				}
+				K[i] = v / s;
+				x[i] += K[i] * e;
+			}
+			for (size_t i = 0; i < n; i++) {
+				for (size_t j = 0; j < n; j++) {
+					L[i * n + j] -= gamma * K[i] * phi[j];
+				}
+			}
+		}
+
+		FLT step = 0;
+		for (size_t j = 0; j < n; j++) {
+			step += (x[j] - xi[j]) * (x[j] - xi[j]);
+		}
+		if (step < 1e-16) {
+			break;
+		}
+	}
+
+	outer_square(n, L, P);
+	return err;
+}
+
+#define FIXED_INSTANCE(N)                                                                                              \
+	static bool sqrt_predict_covariance_##N(FLT *P, const FLT *F, const FLT *Q) {                                      \
+		return sqrt_predict_covariance(N, P, F, Q);                                                                    \
+	}                                                                                                                  \
+	static FLT sqrt_update_##N(FLT *x, FLT *P, survive_kalman_fixed_meas_fn fn, void *user, const CnMat *Z,         \
+							   const FLT *R_diag, int max_iterations, FLT max_error, bool *clean) {                   \
+		return sqrt_update(N, x, P, fn, user, Z, R_diag, max_iterations, max_error, clean);                            \
+	}
+
+// kalman-minimize-state-space strips acceleration, then angular velocity, then velocity off of the full 16
+FIXED_INSTANCE(16)
+FIXED_INSTANCE(13)
+FIXED_INSTANCE(10)
+FIXED_INSTANCE(7)
+
+bool survive_kalman_fixed_supported(size_t state_cnt) {
+	return state_cnt == 16 || state_cnt == 13 || state_cnt == 10 || state_cnt == 7;
+}
+
+bool survive_kalman_fixed_sqrt_predict_covariance(size_t state_cnt, FLT *P, const FLT *F, const FLT *Q) {
+	switch (state_cnt) {
+	case 16:
+		return sqrt_predict_covariance_16(P, F, Q);
+	case 13:
+		return sqrt_predict_covariance_13(P, F, Q);
+	case 10:
+		return sqrt_predict_covariance_10(P, F, Q);
+	case 7:
+		return sqrt_predict_covariance_7(P, F, Q);
+	default:
+		return false;
+	}
+}
+
+FLT survive_kalman_fixed_sqrt_update(size_t state_cnt, FLT *x, FLT *P, survive_kalman_fixed_meas_fn fn, void *user,
+									 const struct CnMat *Z, const FLT *R_diag, int max_iterations, FLT max_error,
+									 bool *clean) {
+	bool unused;
+	if (clean == 0) {
+		clean = &unused;
+	}
+	*clean = true;
+
+	switch (state_cnt) {
+	case 16:
+		return sqrt_update_16(x, P, fn, user, Z, R_diag, max_iterations, max_error, clean);
+	case 13:
+		return sqrt_update_13(x, P, fn, user, Z, R_diag, max_iterations, max_error, clean);
+	case 10:
+		return sqrt_update_10(x, P, fn, user, Z, R_diag, max_iterations, max_error, clean);
+	case 7:
+		return sqrt_update_7(x, P, fn, user, Z, R_diag, max_iterations, max_error, clean);
+	default:
+		return -1;
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "survive.h"
+#include <cnmatrix/cn_matrix.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Square root form of the Kalman time and measurement updates, specialized for the state sizes the object tracker's
+ * plain (not error state) model has: SurviveKalmanModel minus whatever kalman-minimize-state-space strips off. A light
+ * batch is never more than 32 measurements.
+ *
+ * The kernels are instantiated per state size so every loop bound is a constant, and keep all scratch space in fixed
+ * size stack arrays. The time update propagates a Cholesky factor of P through a QR factorization, and the measurement
+ * update folds the (uncorrelated) measurements in one at a time with Potter's method. P is factored on the way in and
+ * rebuilt as L * L^T on the way out; a P that arrives indefinite is repaired with a small diagonal jitter.
+ *
+ * The tracker runs its light updates through these when kalman-square-root is set; see survive_kalman_tracker_init.
+ */
+
+#define SURVIVE_KALMAN_FIXED_MAX_MEAS 32
+
+// Same contract as a cnkalman measurement model; H may be 0 when only y is needed
+typedef bool (*survive_kalman_fixed_meas_fn)(void *user, const struct CnMat *Z, const struct CnMat *x_t,
+											 struct CnMat *y, struct CnMat *H_k);
+
+SURVIVE_EXPORT bool survive_kalman_fixed_supported(size_t state_cnt);
+
+/**
+ * P = F * P * F^T + Q, with P, F and Q row major state_cnt x state_cnt and P symmetric
+ *
+ * @return false if P wasn't positive semi-definite coming in and had to be repaired
+ */
+SURVIVE_EXPORT bool survive_kalman_fixed_sqrt_predict_covariance(size_t state_cnt, FLT *P, const FLT *F, const FLT *Q);
+
+/**
+ * (Iterated) EKF update of x and P against measurements Z with diagonal covariance R.
+ *
+ * Each iteration relinearizes around the latest estimate; it stops after max_iterations (at least one) or once the
+ * step is negligible. When max_error > 0 and the mean squared innovation before the update is larger, the update is
+ * skipped. clean, if given, is set to false when P had to be repaired.
+ *
+ * @return the mean squared innovation at the final linearization point, or < 0 if nothing was applied
+ */
+SURVIVE_EXPORT FLT survive_kalman_fixed_sqrt_update(size_t state_cnt, FLT *x, FLT *P, survive_kalman_fixed_meas_fn fn,
+													void *user, const struct CnMat *Z, const FLT *R_diag,
+													int max_iterations, FLT max_error, bool *clean);
+
+#ifdef __cplusplus
+};
+#endif
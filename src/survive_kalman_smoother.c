@@ -0,0 +1,219 @@
+#include "survive_kalman_smoother.h"
+
+#include <math.h>
+#include <string.h>
+
+void survive_kalman_smoother_init(SurviveKalmanSmoother *smoother, const SurviveKalmanSmootherModel *model, FLT lag,
+								  size_t max_nodes, survive_kalman_smoother_emit_fn emit, void *emit_user) {
+	memset(smoother, 0, sizeof(*smoother));
+	smoother->model = *model;
+	smoother->lag = lag;
+	smoother->max_nodes = max_nodes < 2 ? 2 : max_nodes;
+	smoother->emit = emit;
+	smoother->emit_user = emit_user;
+
+	size_t n = model->state_cnt, e = model->error_cnt, cnt = smoother->max_nodes;
+	smoother->t = SV_CALLOC_N(cnt, sizeof(FLT));
+	smoother->runtime = SV_CALLOC_N(cnt, sizeof(FLT));
+	smoother->timecode = SV_CALLOC_N(cnt, sizeof(survive_long_timecode));
+	smoother->x = SV_CALLOC_N(cnt * n, sizeof(FLT));
+	smoother->P = SV_CALLOC_N(cnt * e * e, sizeof(FLT));
+	smoother->smoothed = SV_CALLOC_N(cnt * n, sizeof(FLT));
+	// F, Q / predicted P, F * P, and the gain; then the predicted state and two error vectors
+	smoother->scratch = SV_CALLOC_N(4 * e * e + n + 2 * e, sizeof(FLT));
+}
+
+void survive_kalman_smoother_free(SurviveKalmanSmoother *smoother) {
+	free(smoother->t);
+	free(smoother->runtime);
+	free(smoother->timecode);
+	free(smoother->x);
+	free(smoother->P);
+	free(smoother->smoothed);
+	free(smoother->scratch);
+	memset(smoother, 0, sizeof(*smoother));
+}
+
+// Solves S * X = B for the symmetric positive definite e x e S, with B e x cols; S is overwritten by its Cholesky factor
+static bool spd_solve(size_t e, FLT *S, FLT *B, size_t cols) {
+	for (size_t j = 0; j < e; j++) {
+		FLT d = S[j * e + j];
+		for (size_t k = 0; k < j; k++) {
+			d -= S[j * e + k] * S[j * e + k];
+		}
+		if (!(d > 0)) {
+			return false;
+		}
+		d = FLT_SQRT(d);
+		S[j * e + j] = d;
+		for (size_t i = j + 1; i < e; i++) {
+			FLT v = S[i * e + j];
+			for (size_t k = 0; k < j; k++) {
+				v -= S[i * e + k] * S[j * e + k];
+			}
+			S[i * e + j] = v / d;
+		}
+	}
+
+	for (size_t c = 0; c < cols; c++) {
+		for (size_t i = 0; i < e; i++) {
+			FLT v = B[i * cols + c];
+			for (size_t k = 0; k < i; k++) {
+				v -= S[i * e + k] * B[k * cols + c];
+			}
+			B[i * cols + c] = v / S[i * e + i];
+		}
+		for (size_t i = e; i-- > 0;) {
+			FLT v = B[i * cols + c];
+			for (size_t k = i + 1; k < e; k++) {
+				v -= S[k * e + i] * B[k * cols + c];
+			}
+			B[i * cols + c] = v / S[i * e + i];
+		}
+	}
+	return true;
+}
+
+/*
+ * One RTS step: smoothed_k = x_k + G * (smoothed_k+1 - f(x_k)), with G = P_k * F^T * (F * P_k * F^T + Q)^-1.
+ */
+static void smooth_step(SurviveKalmanSmoother *smoother, size_t k) {
+	const SurviveKalmanSmootherModel *model = &smoother->model;
+	size_t n = model->state_cnt, e = model->error_cnt;
+
+	FLT *F = smoother->scratch, *S = F + e * e, *FP = S + e * e, *Gt = FP + e * e;
+	FLT *xp = Gt + e * e, *dx = xp + n, *corr = dx + e;
+
+	const FLT *x = smoother->x + k * n, *P = smoother->P + k * e * e;
+	FLT dt = smoother->t[k + 1] - smoother->t[k];
+
+	model->predict(model->user, dt, x, xp, F);
+	model->process_noise(model->user, dt, x, S);
+
+	for (size_t i = 0; i < e; i++) {
+		for (size_t j = 0; j < e; j++) {
+			FLT v = 0;
+			for (size_t l = 0; l < e; l++) {
+				v += F[i * e + l] * P[l * e + j];
+			}
+			FP[i * e + j] = v;
+		}
+	}
+	for (size_t i = 0; i < e; i++) {
+		for (size_t j = i; j < e; j++) {
+			FLT v = S[i * e + j];
+			for (size_t l = 0; l < e; l++) {
+				v += FP[i * e + l] * F[j * e + l];
+			}
+			S[i * e + j] = S[j * e + i] = v;
+		}
+	}
+
+	// G^T = S^-1 * F * P, since P and S are symmetric
+	memcpy(Gt, FP, e * e * sizeof(FLT));
+	FLT *smoothed = smoother->smoothed + k * n;
+	if (!spd_solve(e, S, Gt, e)) {
+		smoother->stats.singular++;
+		memcpy(smoothed, x, n * sizeof(FLT));
+		return;
+	}
+
+	const FLT *next = smoother->smoothed + (k + 1) * n;
+	if (model->difference) {
+		model->difference(model->user, next, xp, dx);
+	} else {
+		for (size_t i = 0; i < e; i++) {
+			dx[i] = next[i] - xp[i];
+		}
+	}
+
+	for (size_t i = 0; i < e; i++) {
+		FLT v = 0;
+		for (size_t j = 0; j < e; j++) {
+			v += Gt[j * e + i] * dx[j];
+		}
+		corr[i] = v;
+	}
+
+	if (model->add) {
+		model->add(model->user, x, corr, smoothed);
+	} else {
+		for (size_t i = 0; i < n; i++) {
+			smoothed[i] = x[i] + (i < e ? corr[i] : 0);
+		}
+	}
+}
+
+static void backward_pass(SurviveKalmanSmoother *smoother) {
+	size_t n = smoother->model.state_cnt, cnt = smoother->nodes_cnt;
+	if (cnt == 0) {
+		return;
+	}
+
+	memcpy(smoother->smoothed + (cnt - 1) * n, smoother->x + (cnt - 1) * n, n * sizeof(FLT));
+	for (size_t k = cnt - 1; k-- > 0;) {
+		smooth_step(smoother, k);
+	}
+	smoother->stats.passes++;
+}
+
+static void emit_nodes(SurviveKalmanSmoother *smoother, size_t emit_cnt) {
+	size_t n = smoother->model.state_cnt, e = smoother->model.error_cnt;
+	for (size_t k = 0; k < emit_cnt; k++) {
+		SurviveKalmanSmootherNode node = {.t = smoother->t[k],
+										  .runtime = smoother->runtime[k],
+										  .timecode = smoother->timecode[k],
+										  .x = smoother->x + k * n,
+										  .P = smoother->P + k * e * e};
+		if (smoother->emit) {
+			smoother->emit(smoother->emit_user, &node, smoother->smoothed + k * n);
+		}
+	}
+	smoother->stats.emitted += emit_cnt;
+
+	size_t keep = smoother->nodes_cnt - emit_cnt;
+	memmove(smoother->t, smoother->t + emit_cnt, keep * sizeof(FLT));
+	memmove(smoother->runtime, smoother->runtime + emit_cnt, keep * sizeof(FLT));
+	memmove(smoother->timecode, smoother->timecode + emit_cnt, keep * sizeof(survive_long_timecode));
+	memmove(smoother->x, smoother->x + emit_cnt * n, keep * n * sizeof(FLT));
+	memmove(smoother->P, smoother->P + emit_cnt * e * e, keep * e * e * sizeof(FLT));
+	smoother->nodes_cnt = keep;
+}
+
+void survive_kalman_smoother_push(SurviveKalmanSmoother *smoother, FLT t, FLT runtime, survive_long_timecode timecode,
+								  const FLT *x, const FLT *P) {
+	while (smoother->nodes_cnt > 0 && smoother->t[smoother->nodes_cnt - 1] >= t) {
+		smoother->nodes_cnt--;
+		smoother->stats.truncated++;
+	}
+
+	if (smoother->nodes_cnt == smoother->max_nodes) {
+		// Out of room before the lag was covered; smooth with what there is and make space
+		backward_pass(smoother);
+		emit_nodes(smoother, smoother->nodes_cnt / 2);
+	}
+
+	size_t n = smoother->model.state_cnt, e = smoother->model.error_cnt, k = smoother->nodes_cnt++;
+	smoother->t[k] = t;
+	smoother->runtime[k] = runtime;
+	smoother->timecode[k] = timecode;
+	memcpy(smoother->x + k * n, x, n * sizeof(FLT));
+	memcpy(smoother->P + k * e * e, P, e * e * sizeof(FLT));
+	smoother->stats.pushed++;
+
+	if (t - smoother->t[0] <= 2 * smoother->lag) {
+		return;
+	}
+
+	backward_pass(smoother);
+	size_t emit_cnt = 0;
+	while (emit_cnt < smoother->nodes_cnt && smoother->t[emit_cnt] <= t - smoother->lag) {
+		emit_cnt++;
+	}
+	emit_nodes(smoother, emit_cnt);
+}
+
+void survive_kalman_smoother_flush(SurviveKalmanSmoother *smoother) {
+	backward_pass(smoother);
+	emit_nodes(smoother, smoother->nodes_cnt);
+}
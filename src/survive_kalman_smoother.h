@@ -0,0 +1,93 @@
+#pragma once
+
+#include "survive.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Fixed-lag Rauch-Tung-Striebel smoother over the posteriors a causal Kalman filter produces.
+ *
+ * The filter pushes its state and covariance after every measurement update. Once the nodes held span more than twice
+ * the lag, one backward pass runs over all of them, and every node at least 'lag' older than the newest is handed to
+ * the emit callback with its smoothed state and dropped. Each emitted node has seen at least 'lag' seconds of future
+ * measurements, the backward pass costs a constant amount per node on average, and memory is bounded by max_nodes
+ * however long the session is. If max_nodes is hit before the span is, the pass runs early with whatever lag there is.
+ *
+ * Only the mean is smoothed; the RTS gain only depends on the filtered covariances, so the smoothed covariance is
+ * never formed.
+ */
+
+typedef struct SurviveKalmanSmootherModel {
+	// Size of the state vector, and of the (error state) covariance. For plain models they are the same.
+	size_t state_cnt, error_cnt;
+	void *user;
+
+	// x1 = f(x0, dt), and F its jacobian with respect to the error state
+	void (*predict)(void *user, FLT dt, const FLT *x0, FLT *x1, FLT *F);
+	// Process noise over dt, error_cnt x error_cnt
+	void (*process_noise)(void *user, FLT dt, const FLT *x, FLT *Q);
+	// E = x1 - x0 in the error space; 0 for plain subtraction
+	void (*difference)(void *user, const FLT *x1, const FLT *x0, FLT *E);
+	// x1 = x0 + E; 0 for plain addition
+	void (*add)(void *user, const FLT *x0, const FLT *E, FLT *x1);
+} SurviveKalmanSmootherModel;
+
+typedef struct SurviveKalmanSmootherNode {
+	FLT t;
+	FLT runtime;
+	survive_long_timecode timecode;
+	// Filtered state and covariance, as pushed
+	const FLT *x, *P;
+} SurviveKalmanSmootherNode;
+
+typedef void (*survive_kalman_smoother_emit_fn)(void *user, const SurviveKalmanSmootherNode *node,
+												 const FLT *smoothed);
+
+typedef struct SurviveKalmanSmoother {
+	SurviveKalmanSmootherModel model;
+	FLT lag;
+	size_t max_nodes;
+
+	survive_kalman_smoother_emit_fn emit;
+	void *emit_user;
+
+	size_t nodes_cnt;
+	FLT *t, *runtime;
+	survive_long_timecode *timecode;
+	FLT *x, *P, *smoothed;
+
+	// Scratch space for the backward pass
+	FLT *scratch;
+
+	struct {
+		size_t pushed, emitted, passes;
+		// Nodes thrown away because a node at or before their time was pushed; ie the filter rolled back
+		size_t truncated;
+		// Steps where the predicted covariance didn't factor, and the filtered state was passed through
+		size_t singular;
+	} stats;
+} SurviveKalmanSmoother;
+
+SURVIVE_EXPORT void survive_kalman_smoother_init(SurviveKalmanSmoother *smoother, const SurviveKalmanSmootherModel *model,
+												 FLT lag, size_t max_nodes, survive_kalman_smoother_emit_fn emit,
+												 void *emit_user);
+SURVIVE_EXPORT void survive_kalman_smoother_free(SurviveKalmanSmoother *smoother);
+
+/**
+ * Adds the filter's posterior at time t. Nodes at or after t are dropped first, so a filter that rolls back and
+ * replays can just push again. Nodes which have already been emitted can't be taken back though; the lag has to be
+ * longer than any roll back.
+ */
+SURVIVE_EXPORT void survive_kalman_smoother_push(SurviveKalmanSmoother *smoother, FLT t, FLT runtime,
+												 survive_long_timecode timecode, const FLT *x, const FLT *P);
+
+/**
+ * Smooths and emits every node held. Call at the end of the data, or before the filter is reset.
+ */
+SURVIVE_EXPORT void survive_kalman_smoother_flush(SurviveKalmanSmoother *smoother);
+
+#ifdef __cplusplus
+};
+#endif
@@ -4,6 +4,7 @@
 #include "linmath.h"
 #include "math.h"
 #include "survive_internal.h"
+#include "survive_profile.h"
 
 #include <cnkalman/kalman.h>
 
@@ -19,11 +20,22 @@
 #include "generated/lighthouse_model.gen.h"
 
 #include "generated/survive_reproject.aux.generated.h"
+#include "survive_kalman_fixed.h"
 #include "survive_kalman_lighthouses.h"
+#include "survive_kalman_smoother.h"
+#include "survive_private.h"
 #include "survive_recording.h"
+#include "survive_seqlock.h"
 
 #define SURVIVE_MODEL_MAX_STATE_CNT (sizeof(SurviveKalmanModel) / sizeof(FLT))
 
+static void reorder_submit(SurviveKalmanTracker *tracker, const SurviveKalmanTrackerEvent *ev);
+
+// Measurements being replayed after a late one were already recorded the first time through
+static inline struct SurviveRecordingData *tracker_recptr(const SurviveKalmanTracker *tracker) {
+	return tracker->reorder.replaying ? 0 : tracker->so->ctx->recptr;
+}
+
 // clang-format off
 STRUCT_CONFIG_SECTION(SurviveKalmanTracker)
 	STRUCT_CONFIG_ITEM("light-error-threshold",  "Error limit to invalidate position",
@@ -91,6 +103,24 @@ STRUCT_CONFIG_SECTION(SurviveKalmanTracker)
 	STRUCT_CONFIG_ITEM("imu-gyro-variance", "Variance of gyroscope", 0.0000304617, t->gyro_var)
 
 	STRUCT_CONFIG_ITEM("light-batch-size", "", 32, t->light_batchsize)
+	STRUCT_CONFIG_ITEM("kalman-square-root",
+					   "Run light updates (only) through square root kernels that refactor P on each call. Other "
+					   "updates and the stored P are unchanged. Needs kalman-use-error-space=0 and "
+					   "kalman-noise-model=0",
+					   0, t->square_root)
+
+	STRUCT_CONFIG_ITEM("kalman-smoother-lag",
+					   "Seconds of future data each smoothed pose sees. Smoothed poses go to smoothed-record. 0 "
+					   "disables the smoother",
+					   0., t->smoother_lag)
+	STRUCT_CONFIG_ITEM("kalman-smoother-max-nodes", "Most filter states the smoother holds at once", 4096,
+					   t->smoother_max_nodes)
+
+	STRUCT_CONFIG_ITEM("kalman-reorder-window",
+					   "How late in s a measurement can be and still be fused at its own time. 0 disables reordering", 0.,
+					   t->reorder.window)
+	STRUCT_CONFIG_ITEM("kalman-reorder-snapshot-interval", "Time in s between filter snapshots kept for reordering",
+					   .005, t->reorder.snapshot_interval)
 END_STRUCT_CONFIG_SECTION(SurviveKalmanTracker)
 
 // clang-format off
@@ -193,6 +223,11 @@ static void normalize_model(SurviveKalmanTracker *pTracker) {
 
 struct map_light_data_ctx {
 	SurviveKalmanTracker *tracker;
+
+	// The lighthouses as they were when the batch was taken, for the ones the batch was seen by; see
+	// snapshot_lighthouses
+	SurvivePose world2lh[NUM_GEN2_LIGHTHOUSES];
+	BaseStationCal fcal[NUM_GEN2_LIGHTHOUSES][2];
 };
 
 typedef void (*SurviveJointKalmanModel_LightMeas_jac_x0_with_hx)(CnMat* Hx, CnMat* hx, const FLT dt, const SurviveJointKalmanModel * _x0, const FLT* sensor_pt, const BaseStationCal* bsc0);
@@ -282,10 +317,66 @@ static bool map_joint_light_data(void *user, const struct CnMat *Z, const struct
 	if (H_k && !cn_is_finite(H_k))
 		return false;
 
-	survive_recording_write_matrix(tracker->so->ctx->recptr, tracker->so, 100, "light-y", y);
+	survive_recording_write_matrix(tracker_recptr(tracker), tracker->so, 100, "light-y", y);
 
 	return true;
 }
+// Light measurements reprojected per batch call when map_light_data doesn't need a jacobian
+#define MAP_LIGHT_BATCH 64
+
+/**
+ * With dt fixed at 0 and a zero error state, the generated LightMeas functions are a plain reprojection of the sensor
+ * through the (unnormalized) state pose. When only h(x) is needed, savedLight -- which is sorted by lighthouse -- goes
+ * through the model's batch function one lighthouse and axis at a time instead.
+ */
+static void map_light_data_batch_hx(const struct map_light_data_ctx *cbctx, const SurvivePose *obj2world, size_t n,
+									FLT *h_x) {
+	const SurviveKalmanTracker *tracker = cbctx->tracker;
+	SurviveObject *so = tracker->so;
+	struct SurviveContext *ctx = so->ctx;
+	const survive_reproject_model_t *mdl = survive_reproject_model(ctx);
+	SurvivePose imu2trackref = so->imu2trackref;
+
+	FLT x[MAP_LIGHT_BATCH], y[MAP_LIGHT_BATCH], z[MAP_LIGHT_BATCH], out[MAP_LIGHT_BATCH];
+	size_t idx[MAP_LIGHT_BATCH];
+	for (size_t start = 0; start < n;) {
+		const LightInfo *first = &tracker->savedLight[tracker->savedLight_idx + start];
+		size_t run = 0;
+		while (start + run < n && run < MAP_LIGHT_BATCH && first[run].lh == first->lh)
+			run++;
+
+		const SurvivePose *world2lh = &cbctx->world2lh[first->lh];
+
+		for (int axis = 0; axis < 2; axis++) {
+			size_t cnt = 0;
+			for (size_t i = 0; i < run; i++) {
+				const LightInfo *info = &first[i];
+				if (info->axis != axis)
+					continue;
+
+				LinmathPoint3d ptInObj;
+				gen_scale_sensor_pt(ptInObj, &so->sensor_locations[info->sensor_idx * 3], &imu2trackref,
+									so->sensor_scale);
+				x[cnt] = ptInObj[0];
+				y[cnt] = ptInObj[1];
+				z[cnt] = ptInObj[2];
+				idx[cnt++] = start + i;
+			}
+			if (cnt == 0)
+				continue;
+
+			// Two separate transforms, same as the generated code, rather than one composed pose
+			survive_reproject_transform_points(obj2world, cnt, x, y, z, x, y, z);
+			survive_reproject_transform_points(world2lh, cnt, x, y, z, x, y, z);
+			mdl->reprojectXYBatch(cbctx->fcal[first->lh], cnt, x, y, z, axis == 0 ? out : 0, axis == 1 ? out : 0);
+			for (size_t i = 0; i < cnt; i++)
+				h_x[idx[i]] = out[i];
+		}
+
+		start += run;
+	}
+}
+
 /**
  * This function reuses the reproject functions to estimate what it thinks the lightcap angle should be based on x_t,
  * and uses that measurement to compare from the actual observed angle. These functions have jacobian functions that
@@ -311,13 +402,29 @@ static bool map_light_data(void *user, const struct CnMat *Z, const struct CnMat
 
 	CN_CREATE_STACK_VEC(h_x, 1);
 	FLT *Y = cn_as_vector(y);
+	if (H_k == 0 && y && mdl->reprojectXYBatch) {
+		map_light_data_batch_hx(cbctx, &s.Pose, Z->rows, Y);
+		for (int i = 0; i < Z->rows; i++) {
+			const LightInfo *info = &tracker->savedLight[tracker->savedLight_idx + i];
+			FLT h = Y[i];
+			Y[i] = cn_as_const_vector(Z)[i] - h;
+			if (tracker->lightcap_max_error > 0) {
+				Y[i] = linmath_enforce_range(Y[i], -tracker->lightcap_max_error, tracker->lightcap_max_error);
+			}
+			SV_DATA_LOG("h_light[%d][%d][%d]", &h, 1, info->lh, info->axis, info->sensor_idx);
+			SV_DATA_LOG("Y_light[%d][%d][%d]", Y, 1, info->lh, info->axis, info->sensor_idx);
+			SV_DATA_LOG("Z_light[%d][%d][%d]", &info->value, 1, info->lh, info->axis, info->sensor_idx);
+		}
+
+		survive_recording_write_matrix(tracker_recptr(tracker), tracker->so, 100, "light-y", y);
+		return true;
+	}
+
 	for (int i = 0; i < Z->rows; i++) {
 		const LightInfo *info = &tracker->savedLight[tracker->savedLight_idx + i];
 		int axis = info->axis;
 
-		assert(ctx->bsd[info->lh].PositionSet);
-
-		const SurvivePose world2lh = InvertPoseRtn(survive_get_lighthouse_position(ctx, info->lh));
+		const SurvivePose *world2lh = &cbctx->world2lh[info->lh];
 
 		const FLT *pt = &so->sensor_locations[info->sensor_idx * 3];
         SurvivePose imu2trackref = so->imu2trackref;
@@ -333,13 +440,13 @@ static bool map_light_data(void *user, const struct CnMat *Z, const struct CnMat
 		if(cbctx->tracker->lightcap_model.error_state_model && cbctx->tracker->use_error_state) {
 			assert(H_k == 0 || cbctx->tracker->model.error_state_size == H_k->cols);
 			SurviveKalmanErrorModel_LightMeas_jac_x0_with_hx_fns[ctx->lh_version][info->axis](H_k ? &H_k_row : 0,
-																							  y ? &h_x : 0, t, &s, &zero_error_model, ptInObj, &world2lh,
-																							  survive_basestation_cal(ctx, info->lh, axis));
+																							  y ? &h_x : 0, t, &s, &zero_error_model, ptInObj, world2lh,
+																							  &cbctx->fcal[info->lh][axis]);
 		} else {
 			assert(H_k == 0 || cbctx->tracker->model.state_cnt == H_k->cols);
 			SurviveKalmanModel_LightMeas_jac_x0_with_hx_fns[ctx->lh_version][info->axis](H_k ? &H_k_row : 0,
-																						 y ? &h_x : 0, t, &s, ptInObj, &world2lh,
-																						 survive_basestation_cal(ctx, info->lh, axis));
+																						 y ? &h_x : 0, t, &s, ptInObj, world2lh,
+																						 &cbctx->fcal[info->lh][axis]);
 		}
 		if(y) {
 			Y[i] = cn_as_const_vector(Z)[i] - h_x.data[0];
@@ -355,7 +462,7 @@ static bool map_light_data(void *user, const struct CnMat *Z, const struct CnMat
 	if (H_k && !cn_is_finite(H_k))
 		return false;
 
-	survive_recording_write_matrix(tracker->so->ctx->recptr, tracker->so, 100, "light-y", y);
+	survive_recording_write_matrix(tracker_recptr(tracker), tracker->so, 100, "light-y", y);
 
 	return true;
 }
@@ -369,7 +476,99 @@ int sort_by_lh_axis_sensor(const void * _info1, const void * _info2) {
 }
 
 
-void survive_kalman_tracker_integrate_saved_light(SurviveKalmanTracker *tracker, PoserData *pd) {
+/*
+ * The time and measurement update cnkalman_meas_model_predict_update does for lightcap_model, in the square root form
+ * of the fixed size kernels in survive_kalman_fixed.h. Only used for plain (not error state) models; see
+ * survive_kalman_tracker_init.
+ *
+ * The factor of P only lives for the duration of a call; the tracker keeps P itself, and every other update changes it
+ * through cnkalman. So this only keeps the light updates from pushing P indefinite, it isn't a square root filter.
+ */
+static FLT sqrt_lightcap_update(SurviveKalmanTracker *tracker, FLT time, struct map_light_data_ctx *cbctx,
+								const CnMat *Z, const FLT *R) {
+	cnkalman_state_t *k = &tracker->model;
+	size_t n = k->state_cnt;
+
+	FLT dt = time - k->t;
+	if (dt > 0) {
+		FLT F[SURVIVE_MODEL_MAX_STATE_CNT * SURVIVE_MODEL_MAX_STATE_CNT];
+		FLT Q[SURVIVE_MODEL_MAX_STATE_CNT * SURVIVE_MODEL_MAX_STATE_CNT];
+		FLT x1[SURVIVE_MODEL_MAX_STATE_CNT];
+		CnMat F_mat = cnMat(n, n, F), Q_mat = cnMat(n, n, Q), x1_mat = cnMat(n, 1, x1);
+
+		survive_kalman_tracker_predict_jac(dt, k, &k->state, &x1_mat, &F_mat);
+		survive_kalman_tracker_process_noise(&tracker->params, false, dt, &k->state, &Q_mat);
+		for (size_t i = 0; i < (size_t)k->state_variance_per_second.rows && i < n; i++) {
+			Q[i * n + i] += cn_as_const_vector(&k->state_variance_per_second)[i] * dt;
+		}
+
+		memcpy(cn_as_vector(&k->state), x1, n * sizeof(FLT));
+		if (!survive_kalman_fixed_sqrt_predict_covariance(n, k->P.data, F, Q)) {
+			tracker->stability.covariance_repairs++;
+		}
+		k->t = time;
+	}
+
+	bool clean = true;
+	FLT err = survive_kalman_fixed_sqrt_update(n, cn_as_vector(&k->state), k->P.data, map_light_data, cbctx, Z, R,
+											   tracker->lightcap_model.term_criteria.max_iterations,
+											   tracker->lightcap_model.term_criteria.max_error, &clean);
+	if (!clean) {
+		tracker->stability.covariance_repairs++;
+	}
+	return err;
+}
+
+// Called with the lighthouse lock held
+static void copy_lighthouse(SurviveContext *ctx, struct map_light_data_ctx *cbctx, int lh) {
+	cbctx->world2lh[lh] = InvertPoseRtn(survive_get_lighthouse_position(ctx, lh));
+	for (int axis = 0; axis < 2; axis++) {
+		cbctx->fcal[lh][axis] = *survive_basestation_cal(ctx, lh, axis);
+	}
+}
+
+// Drops saved light from lighthouses without a position, and copies what the update needs from the others into
+// cbctx. The lighthouses are shared between objects, so this is done under the lighthouse lock; the update itself
+// then runs on the copies without it.
+static void snapshot_lighthouses(SurviveKalmanTracker *tracker, struct map_light_data_ctx *cbctx) {
+	SurviveContext *ctx = tracker->so->ctx;
+	uint32_t copied = 0;
+
+	survive_get_lh_lock(ctx);
+	for (int i = 0; i < tracker->savedLight_idx; i++) {
+		int lh = tracker->savedLight[i].lh;
+		if (!ctx->bsd[lh].PositionSet) {
+			tracker->savedLight[i] = tracker->savedLight[tracker->savedLight_idx - 1];
+			tracker->savedLight_idx--;
+			i--;
+			continue;
+		}
+		if (copied & (1u << lh)) {
+			continue;
+		}
+		copied |= 1u << lh;
+		copy_lighthouse(ctx, cbctx, lh);
+	}
+	survive_release_lh_lock(ctx);
+}
+
+bool survive_kalman_tracker_light_measurement_model(SurviveKalmanTracker *tracker, const struct CnMat *Z,
+													const struct CnMat *x_t, struct CnMat *y, struct CnMat *H_k) {
+	SurviveContext *ctx = tracker->so->ctx;
+	struct map_light_data_ctx cbctx = {
+		.tracker = tracker,
+	};
+
+	survive_get_lh_lock(ctx);
+	for (int i = 0; i < Z->rows; i++) {
+		copy_lighthouse(ctx, &cbctx, tracker->savedLight[tracker->savedLight_idx + i].lh);
+	}
+	survive_release_lh_lock(ctx);
+
+	return map_light_data(&cbctx, Z, x_t, y, H_k);
+}
+
+static void integrate_saved_light(SurviveKalmanTracker *tracker, PoserData *pd) {
 	SurviveContext *ctx = tracker->so->ctx;
 	FLT time = pd->timecode / (FLT)tracker->so->timebase_hz;
 	if (tracker->use_raw_obs) {
@@ -388,13 +587,10 @@ void survive_kalman_tracker_integrate_saved_light(SurviveKalmanTracker *tracker,
 	}
 
 	if (tracker->light_var >= 0) {
-		for (int i = 0; i < tracker->savedLight_idx; i++) {
-			if (!ctx->bsd[tracker->savedLight[i].lh].PositionSet) {
-				tracker->savedLight[i] = tracker->savedLight[tracker->savedLight_idx - 1];
-				tracker->savedLight_idx--;
-				i--;
-			}
-		}
+		struct map_light_data_ctx cbctx = {
+			.tracker = tracker,
+		};
+		snapshot_lighthouses(tracker, &cbctx);
 
         if (tracker->savedLight_idx == 0) {
             return;
@@ -439,10 +635,6 @@ void survive_kalman_tracker_integrate_saved_light(SurviveKalmanTracker *tracker,
 				cnMatrixSet(&Z, i - tracker->savedLight_idx, 0, tracker->savedLight[i].value);
 			}
 
-			struct map_light_data_ctx cbctx = {
-				.tracker = tracker,
-			};
-
 			SurviveObject *so = tracker->so;
 			FLT light_var = tracker->light_var;
 
@@ -456,18 +648,36 @@ void survive_kalman_tracker_integrate_saved_light(SurviveKalmanTracker *tracker,
 			if(time < tracker->model.t)
 				time = tracker->model.t;
 
-			FLT obj_trace = cn_trace(&tracker->model.P);
-			FLT lh_trace = cn_trace(&ctx->bsd[lh].tracker->model.P);
-			FLT ratio = lh_trace / obj_trace;
-
 			tracker->last_light_time = time;
 
-			if(useJointModel && tracker->joint_lightcap_ratio < ratio) {
-				tracker->joint_model.ks[0] = &ctx->bsd[lh].tracker->model;
-				tracker->joint_model.ks[1] = &ctx->bsd[lh].tracker->bsd_model;
-				rtn += cnkalman_meas_model_predict_update(time, &tracker->joint_model, &cbctx, &Z, &R);
-				tracker->stats.joint_model_sensor_cnt_sum += cnt;
-				survive_kalman_lighthouse_report(ctx->bsd[lh].tracker);
+			// The joint model also updates the lighthouse's filter, so it is the one light update which runs under the
+			// lighthouse lock
+			bool joint = false;
+			if (useJointModel) {
+				survive_get_lh_lock(ctx);
+				FLT ratio = cn_trace(&ctx->bsd[lh].tracker->model.P) / cn_trace(&tracker->model.P);
+				joint = tracker->joint_lightcap_ratio < ratio;
+				if (joint) {
+					tracker->joint_model.ks[0] = &ctx->bsd[lh].tracker->model;
+					tracker->joint_model.ks[1] = &ctx->bsd[lh].tracker->bsd_model;
+					rtn += cnkalman_meas_model_predict_update(time, &tracker->joint_model, &cbctx, &Z, &R);
+					tracker->stats.joint_model_sensor_cnt_sum += cnt;
+					survive_kalman_lighthouse_report(ctx->bsd[lh].tracker);
+				}
+				survive_release_lh_lock(ctx);
+				if (joint) {
+					continue;
+				}
+			}
+
+			if (tracker->square_root) {
+				FLT err = sqrt_lightcap_update(tracker, time, &cbctx, &Z, light_vars);
+				if (err < 0) {
+					tracker->stats.lightcap_model_dropped++;
+				} else {
+					rtn += err;
+					tracker->stats.lightcap_model_sensor_cnt_sum += cnt;
+				}
 			} else {
 				rtn += cnkalman_meas_model_predict_update(time, &tracker->lightcap_model, &cbctx, &Z, &R);
 				tracker->stats.lightcap_model_sensor_cnt_sum += cnt;
@@ -485,8 +695,37 @@ void survive_kalman_tracker_integrate_saved_light(SurviveKalmanTracker *tracker,
 		SV_DATA_LOG("res_error_light_avg", &tracker->light_residuals_all, 1);
 		tracker->stats.lightcap_count++;
 
-		survive_kalman_tracker_report_state(pd, tracker);
+		SURVIVE_PROFILE_STAGE(tracker->so->ctx, report, survive_kalman_tracker_report_state(pd, tracker));
+	}
+}
+
+void survive_kalman_tracker_integrate_saved_light(SurviveKalmanTracker *tracker, PoserData *pd) {
+	if (tracker->savedLight_idx == 0) {
+		return;
+	}
+
+	SurviveKalmanTrackerEvent ev = {.time = pd->timecode / (FLT)tracker->so->timebase_hz,
+									.type = SurviveKalmanTrackerEvent_light};
+	ev.light.hdr = *pd;
+	ev.light.cnt = tracker->savedLight_idx;
+	memcpy(ev.light.meas, tracker->savedLight, tracker->savedLight_idx * sizeof(tracker->savedLight[0]));
+	tracker->savedLight_idx = 0;
+	reorder_submit(tracker, &ev);
+}
+
+static inline uint32_t light_batch_trigger(const SurviveKalmanTracker *tracker) {
+	if (tracker->light_batchsize >= 0) {
+		return tracker->light_batchsize;
+	}
+	return sizeof(tracker->savedLight) / sizeof(tracker->savedLight[0]);
+}
+
+size_t survive_kalman_tracker_light_until_batch(const SurviveKalmanTracker *tracker) {
+	if (tracker == 0) {
+		return SIZE_MAX;
 	}
+	uint32_t trigger = light_batch_trigger(tracker);
+	return tracker->savedLight_idx < trigger ? trigger - tracker->savedLight_idx : 0;
 }
 
 void survive_kalman_tracker_integrate_light(SurviveKalmanTracker *tracker, PoserDataLight *data) {
@@ -502,15 +741,9 @@ void survive_kalman_tracker_integrate_light(SurviveKalmanTracker *tracker, Poser
 		info->axis = PoserDataLight_axis(data);
 		info->sensor_idx = data->sensor_id;
 		info->timecode = data->hdr.timecode;
-
-		integrate_variance_tracker(tracker, &tracker->light_variance[info->lh][info->sensor_idx][info->axis], &info->value, 1);
 	}
 
-	int batchtrigger = sizeof(tracker->savedLight) / sizeof(tracker->savedLight[0]);
-	if (tracker->light_batchsize >= 0) {
-		batchtrigger = tracker->light_batchsize;
-	}
-	if (tracker->savedLight_idx >= batchtrigger) {
+	if (tracker->savedLight_idx >= light_batch_trigger(tracker)) {
 		survive_kalman_tracker_integrate_saved_light(tracker, &data->hdr);
 		tracker->savedLight_idx = 0;
 	}
@@ -565,7 +798,7 @@ bool survive_kalman_tracker_imu_measurement_model(void *user, const struct CnMat
 		SurviveKalmanTracker * tracker = fn_ctx->tracker;
 		SurviveObject * so = fn_ctx->tracker->so;
 		SurviveContext *ctx = so->ctx;
-		survive_recording_write_matrix(tracker->so->ctx->recptr, tracker->so, 100, "imu-y", y);
+		survive_recording_write_matrix(tracker_recptr(tracker), tracker->so, 100, "imu-y", y);
 		SV_VERBOSE(600, "X     " Point7_format, LINMATH_VEC7_EXPAND(cn_as_const_vector(x_t)))
 		SV_VERBOSE(600, "Z     " Point6_format, LINMATH_VEC6_EXPAND(cn_as_const_vector(Z)))
 
@@ -684,7 +917,7 @@ static bool map_obs_data(void *user, const struct CnMat *Z, const struct CnMat *
 	SurviveKalmanTracker *tracker = (SurviveKalmanTracker *)user;
 	if(y) {
 		subnd(cn_as_vector(y), cn_as_const_vector(Z), cn_as_const_vector(x_t), 7);
-		survive_recording_write_matrix(tracker->so->ctx->recptr, tracker->so, 100, "obs-y", y);
+		survive_recording_write_matrix(tracker_recptr(tracker), tracker->so, 100, "obs-y", y);
 	}
 	if(H_k) {
 		bool errorState = tracker->use_error_state && tracker->obs_model.error_state_model;
@@ -764,7 +997,7 @@ static FLT integrate_pose(SurviveKalmanTracker *tracker, FLT time, const Survive
 	return rtn;
 }
 
-void survive_kalman_tracker_integrate_imu(SurviveKalmanTracker *tracker, PoserDataIMU *data) {
+static void integrate_imu(SurviveKalmanTracker *tracker, PoserDataIMU *data) {
 	SurviveContext *ctx = tracker->so->ctx;
 	SurviveObject *so = tracker->so;
 
@@ -910,7 +1143,14 @@ void survive_kalman_tracker_integrate_imu(SurviveKalmanTracker *tracker, PoserDa
 				   LINMATH_VEC26_EXPAND(cn_as_const_vector(&tracker->model.state)));
 	}
 
-	survive_kalman_tracker_report_state(&data->hdr, tracker);
+	SURVIVE_PROFILE_STAGE(tracker->so->ctx, report, survive_kalman_tracker_report_state(&data->hdr, tracker));
+}
+
+void survive_kalman_tracker_integrate_imu(SurviveKalmanTracker *tracker, PoserDataIMU *data) {
+	SurviveKalmanTrackerEvent ev = {.time = data->hdr.timecode / (FLT)tracker->so->timebase_hz,
+									.type = SurviveKalmanTrackerEvent_imu};
+	ev.imu = *data;
+	reorder_submit(tracker, &ev);
 }
 
 void survive_kalman_tracker_predict(const SurviveKalmanTracker *tracker, FLT t, SurvivePose *out) {
@@ -928,6 +1168,75 @@ void survive_kalman_tracker_predict(const SurviveKalmanTracker *tracker, FLT t,
 	SV_VERBOSE(300, "Predict pose %f %f " SurvivePose_format, t, t - tracker->model.t, SURVIVE_POSE_EXPAND(*out))
 }
 
+bool survive_kalman_tracker_predict_published(const SurviveKalmanTracker *tracker, FLT runtime,
+											  SurvivePose *head2world) {
+	const struct SurviveKalmanTrackerPublished *published = &tracker->published;
+	uint32_t seq;
+	SurviveKalmanModel state;
+	FLT t, runtime_offset, floor_offset;
+	SurvivePose head2imu;
+	bool report_in_imu;
+
+	do {
+		seq = SURVIVE_SEQ_LOAD_ACQUIRE(&published->seq);
+		if (seq & 1) {
+			continue;
+		}
+		t = published->data.t;
+		runtime_offset = published->data.runtime_offset;
+		state = published->data.state;
+		head2imu = published->data.head2imu;
+		floor_offset = published->data.floor_offset;
+		report_in_imu = published->data.report_in_imu;
+		SURVIVE_SEQ_FENCE_ACQUIRE();
+	} while ((seq & 1) || seq != SURVIVE_SEQ_LOAD_ACQUIRE(&published->seq));
+
+	if (t == 0) {
+		return false;
+	}
+
+	// Same extrapolation as survive_kalman_tracker_predict, minus the cnkalman plumbing
+	SurviveKalmanModel predicted = {0};
+	SurviveKalmanModelPredict(&predicted, runtime - runtime_offset - t, &state);
+	quatnormalize(predicted.Pose.Rot, predicted.Pose.Rot);
+
+	if (report_in_imu) {
+		*head2world = predicted.Pose;
+	} else {
+		ApplyPoseToPose(head2world, &predicted.Pose, &head2imu);
+	}
+	head2world->Pos[2] -= floor_offset;
+	return true;
+}
+
+void survive_kalman_tracker_publish_state(SurviveKalmanTracker *tracker, survive_long_timecode timecode) {
+	SurviveObject *so = tracker->so;
+	struct SurviveKalmanTrackerPublished *published = &tracker->published;
+
+	SurviveKalmanModel state = copy_model((const FLT *)&tracker->state, tracker->model.state_cnt);
+	if (tracker->params.process_weight_acc == 0) {
+		scale3d(state.Acc, state.Acc, 0);
+	}
+	if (tracker->params.process_weight_vel == 0) {
+		scalend(state.Velocity.Pos, state.Velocity.Pos, 0, 6);
+	}
+	quatnormalize(state.Pose.Rot, state.Pose.Rot);
+
+	FLT t = timecode / (FLT)so->timebase_hz;
+	FLT runtime = SurviveSensorActivations_runtime(&so->activations, timecode) * 1e-6;
+
+	uint32_t seq = published->seq;
+	SURVIVE_SEQ_STORE_RELEASE(&published->seq, seq + 1);
+	SURVIVE_SEQ_FENCE_RELEASE();
+	published->data.t = tracker->model.t;
+	published->data.runtime_offset = runtime - t;
+	published->data.state = state;
+	published->data.head2imu = so->head2imu;
+	published->data.floor_offset = so->ctx ? so->ctx->floor_offset : 0;
+	published->data.report_in_imu = tracker->report_in_imu;
+	SURVIVE_SEQ_STORE_RELEASE(&published->seq, seq + 2);
+}
+
 static void survive_kalman_tracker_process_noise_bounce(void *user, FLT t, const CnMat *x, struct CnMat *q_out) {
 	struct SurviveKalmanTracker_Params *params = (struct SurviveKalmanTracker_Params *)user;
 	survive_kalman_tracker_process_noise(params, false, t, x, q_out);
@@ -1157,8 +1466,6 @@ void survive_kalman_tracker_integrate_observation(PoserData *pd, SurviveKalmanTr
 	SurviveObject *so = tracker->so;
     SurviveContext *ctx = so->ctx;
 
-	integrate_variance_tracker(tracker, &tracker->pose_variance, (FLT*)pose->Pos, 7);
-
     if (tracker->show_raw_obs) {
         static int report_in_imu = -1;
         if (report_in_imu == -1) {
@@ -1175,12 +1482,33 @@ void survive_kalman_tracker_integrate_observation(PoserData *pd, SurviveKalmanTr
 	}
 
 	if (tracker->use_raw_obs) {
+		integrate_variance_tracker(tracker, &tracker->pose_variance, (FLT *)pose->Pos, 7);
 		SURVIVE_INVOKE_HOOK_SO(imupose, so, pd->timecode, pose);
 		return;
 	}
 
+	SurviveKalmanTrackerEvent ev = {.time = pd->timecode / (FLT)tracker->so->timebase_hz,
+									.type = SurviveKalmanTrackerEvent_obs};
+	ev.obs.hdr = *pd;
+	ev.obs.pose = *pose;
+	if (Ri) {
+		assert(Ri->rows * Ri->cols <= 7 * 7);
+		ev.obs.R_rows = Ri->rows;
+		ev.obs.R_cols = Ri->cols;
+		CnMat R = cnMat(Ri->rows, Ri->cols, ev.obs.R);
+		cnCopy(Ri, &R, 0);
+	}
+	reorder_submit(tracker, &ev);
+}
+
+static void integrate_observation(PoserData *pd, SurviveKalmanTracker *tracker, const SurvivePose *pose,
+								  const struct CnMat *Ri) {
+	SurviveObject *so = tracker->so;
+	SurviveContext *ctx = so->ctx;
 	survive_long_timecode timecode = pd->timecode;
 
+	integrate_variance_tracker(tracker, &tracker->pose_variance, (FLT *)pose->Pos, 7);
+
 	FLT time = timecode / (FLT)tracker->so->timebase_hz;
 	if (tracker->model.t == 0) {
 		tracker->model.t = time;
@@ -1222,7 +1550,8 @@ void survive_kalman_tracker_integrate_observation(PoserData *pd, SurviveKalmanTr
         for(int i =0;i < 7;i++)
             cnMatrixSet(&R, i, i, cnMatrixGet(&R, i, i) + augR[i]);
 
-        if(tracker->report_covariance_cnt > 0 && Ri && Ri->rows == Ri->cols && (tracker->stats.obs_count % tracker->report_covariance_cnt) == 0) {
+        if (tracker->report_covariance_cnt > 0 && !tracker->reorder.replaying && Ri && Ri->rows == Ri->cols &&
+            (tracker->stats.obs_count % tracker->report_covariance_cnt) == 0) {
             survive_recording_write_to_output(ctx->recptr, "%s' FULL_COVARIANCE ", so->codename);
             for (int i = 0; i < R.cols * R.cols; i++) {
                 survive_recording_write_to_output_nopreamble(ctx->recptr, "%f ", R.data[i]);
@@ -1242,14 +1571,400 @@ void survive_kalman_tracker_integrate_observation(PoserData *pd, SurviveKalmanTr
 		SurviveObject *so = tracker->so;
 		SV_DATA_LOG("res_err_obs", &obs_error, 1);
 
-		survive_kalman_tracker_report_state(pd, tracker);
+		SURVIVE_PROFILE_STAGE(tracker->so->ctx, report, survive_kalman_tracker_report_state(pd, tracker));
+	}
+}
+
+struct SurviveKalmanTrackerSnapshot {
+	// Time of the newest measurement fused before the snapshot, and the index of the first event after it
+	FLT time;
+	size_t event_idx;
+
+	SurviveKalmanModel state;
+	FLT model_t, imu_bias_t;
+	// model.P followed by imu_bias_model.P
+	FLT *P;
+
+	uint8_t stats[sizeof(((SurviveKalmanTracker *)0)->stats)];
+	FLT last_light_time, first_imu_time, last_imu_time;
+	FLT imu_residuals, light_residuals_all;
+	FLT Obs_R[7 * 7];
+	FLT IMU_R[6 * 6];
+	struct variance_tracker imu_variance, pose_variance;
+
+	// light_variance is far too big to copy every snapshot, so each snapshot instead keeps what the entries changed
+	// after it used to be, oldest first
+	struct light_variance_undo *light_undo;
+	size_t light_undo_cnt, light_undo_capacity;
+};
+
+// Light variance is one dimensional, so only the first element of each array is ever set
+struct light_variance_undo {
+	uint8_t lh, sensor_idx, axis;
+	size_t counts, size, n;
+	FLT variance, sum, sumSq;
+};
+
+static void integrate_light_variance(SurviveKalmanTracker *tracker, const LightInfo *meas, size_t cnt) {
+	struct SurviveKalmanTrackerReorder *r = &tracker->reorder;
+	struct SurviveKalmanTrackerSnapshot *snapshot = r->snapshots_cnt ? &r->snapshots[r->snapshots_cnt - 1] : 0;
+	for (size_t i = 0; i < cnt; i++) {
+		struct variance_tracker *v = &tracker->light_variance[meas[i].lh][meas[i].sensor_idx][meas[i].axis];
+		if (snapshot) {
+			if (snapshot->light_undo_cnt == snapshot->light_undo_capacity) {
+				snapshot->light_undo_capacity = snapshot->light_undo_capacity ? snapshot->light_undo_capacity * 2 : 64;
+				snapshot->light_undo =
+					SV_REALLOC(snapshot->light_undo, snapshot->light_undo_capacity * sizeof(snapshot->light_undo[0]));
+			}
+			snapshot->light_undo[snapshot->light_undo_cnt++] = (struct light_variance_undo){
+				.lh = meas[i].lh,
+				.sensor_idx = meas[i].sensor_idx,
+				.axis = meas[i].axis,
+				.counts = v->counts,
+				.size = v->variance.size,
+				.n = v->variance.n,
+				.variance = v->variances[0],
+				.sum = v->variance.sum[0],
+				.sumSq = v->variance.sumSq[0],
+			};
+		}
+		integrate_variance_tracker(tracker, v, &meas[i].value, 1);
+	}
+}
+
+static void undo_light_variance(SurviveKalmanTracker *tracker, struct SurviveKalmanTrackerSnapshot *snapshot) {
+	for (size_t i = snapshot->light_undo_cnt; i-- > 0;) {
+		const struct light_variance_undo *undo = &snapshot->light_undo[i];
+		struct variance_tracker *v = &tracker->light_variance[undo->lh][undo->sensor_idx][undo->axis];
+		v->counts = undo->counts;
+		v->variance.size = undo->size;
+		v->variance.n = undo->n;
+		v->variances[0] = undo->variance;
+		v->variance.sum[0] = undo->sum;
+		v->variance.sumSq[0] = undo->sumSq;
+	}
+	snapshot->light_undo_cnt = 0;
+}
+
+static size_t kalman_P_size(const cnkalman_state_t *k) { return (size_t)k->P.rows * k->P.cols; }
+
+static PoserData *event_hdr(SurviveKalmanTrackerEvent *ev) {
+	switch (ev->type) {
+	case SurviveKalmanTrackerEvent_imu:
+		return &ev->imu.hdr;
+	case SurviveKalmanTrackerEvent_light:
+		return &ev->light.hdr;
+	case SurviveKalmanTrackerEvent_obs:
+	default:
+		return &ev->obs.hdr;
+	}
+}
+
+static void apply_event(SurviveKalmanTracker *tracker, SurviveKalmanTrackerEvent *ev) {
+	switch (ev->type) {
+	case SurviveKalmanTrackerEvent_imu:
+		integrate_imu(tracker, &ev->imu);
+		break;
+	case SurviveKalmanTrackerEvent_light:
+		integrate_light_variance(tracker, ev->light.meas, ev->light.cnt);
+		memcpy(tracker->savedLight, ev->light.meas, ev->light.cnt * sizeof(tracker->savedLight[0]));
+		tracker->savedLight_idx = ev->light.cnt;
+		integrate_saved_light(tracker, &ev->light.hdr);
+		tracker->savedLight_idx = 0;
+		break;
+	case SurviveKalmanTrackerEvent_obs: {
+		CnMat R = cnMat(ev->obs.R_rows, ev->obs.R_cols, ev->obs.R);
+		integrate_observation(&ev->obs.hdr, tracker, &ev->obs.pose, ev->obs.R_rows ? &R : 0);
+		break;
+	}
+	}
+}
+
+static void reorder_take_snapshot(SurviveKalmanTracker *tracker, size_t event_idx) {
+	struct SurviveKalmanTrackerReorder *r = &tracker->reorder;
+	if (r->snapshots_cnt == r->snapshots_capacity) {
+		size_t capacity = r->snapshots_capacity ? r->snapshots_capacity * 2 : 8;
+		r->snapshots = SV_REALLOC(r->snapshots, capacity * sizeof(r->snapshots[0]));
+		memset(r->snapshots + r->snapshots_capacity, 0, (capacity - r->snapshots_capacity) * sizeof(r->snapshots[0]));
+		r->snapshots_capacity = capacity;
+	}
+
+	size_t P_size = kalman_P_size(&tracker->model), imu_P_size = kalman_P_size(&tracker->imu_bias_model);
+	struct SurviveKalmanTrackerSnapshot *snapshot = &r->snapshots[r->snapshots_cnt++];
+	if (snapshot->P == 0) {
+		snapshot->P = SV_CALLOC((P_size + imu_P_size) * sizeof(FLT));
+	}
+
+	snapshot->time = r->latest_time;
+	snapshot->event_idx = event_idx;
+	snapshot->state = tracker->state;
+	snapshot->model_t = tracker->model.t;
+	snapshot->imu_bias_t = tracker->imu_bias_model.t;
+	memcpy(snapshot->P, tracker->model.P.data, P_size * sizeof(FLT));
+	if (imu_P_size) {
+		memcpy(snapshot->P + P_size, tracker->imu_bias_model.P.data, imu_P_size * sizeof(FLT));
+	}
+	memcpy(snapshot->stats, &tracker->stats, sizeof(tracker->stats));
+	snapshot->last_light_time = tracker->last_light_time;
+	snapshot->first_imu_time = tracker->first_imu_time;
+	snapshot->last_imu_time = tracker->last_imu_time;
+	snapshot->imu_residuals = tracker->imu_residuals;
+	snapshot->light_residuals_all = tracker->light_residuals_all;
+	memcpy(snapshot->Obs_R, tracker->Obs_R, sizeof(tracker->Obs_R));
+	memcpy(snapshot->IMU_R, tracker->IMU_R, sizeof(tracker->IMU_R));
+	snapshot->imu_variance = tracker->imu_variance;
+	snapshot->pose_variance = tracker->pose_variance;
+	snapshot->light_undo_cnt = 0;
+}
+
+static void reorder_restore_snapshot(SurviveKalmanTracker *tracker,
+									 const struct SurviveKalmanTrackerSnapshot *snapshot) {
+	size_t P_size = kalman_P_size(&tracker->model), imu_P_size = kalman_P_size(&tracker->imu_bias_model);
+
+	tracker->reorder.latest_time = snapshot->time;
+	tracker->state = snapshot->state;
+	tracker->model.t = snapshot->model_t;
+	tracker->imu_bias_model.t = snapshot->imu_bias_t;
+	memcpy(tracker->model.P.data, snapshot->P, P_size * sizeof(FLT));
+	if (imu_P_size) {
+		memcpy(tracker->imu_bias_model.P.data, snapshot->P + P_size, imu_P_size * sizeof(FLT));
+	}
+	memcpy(&tracker->stats, snapshot->stats, sizeof(tracker->stats));
+	tracker->last_light_time = snapshot->last_light_time;
+	tracker->first_imu_time = snapshot->first_imu_time;
+	tracker->last_imu_time = snapshot->last_imu_time;
+	tracker->imu_residuals = snapshot->imu_residuals;
+	tracker->light_residuals_all = snapshot->light_residuals_all;
+	memcpy(tracker->Obs_R, snapshot->Obs_R, sizeof(tracker->Obs_R));
+	memcpy(tracker->IMU_R, snapshot->IMU_R, sizeof(tracker->IMU_R));
+	tracker->imu_variance = snapshot->imu_variance;
+	tracker->pose_variance = snapshot->pose_variance;
+}
+
+static SurviveKalmanTrackerEvent *reorder_insert_event(struct SurviveKalmanTrackerReorder *r, size_t idx) {
+	if (r->events_cnt == r->events_capacity) {
+		r->events_capacity = r->events_capacity ? r->events_capacity * 2 : 64;
+		r->events = SV_REALLOC(r->events, r->events_capacity * sizeof(r->events[0]));
+	}
+	memmove(r->events + idx + 1, r->events + idx, (r->events_cnt - idx) * sizeof(r->events[0]));
+	r->events_cnt++;
+	return &r->events[idx];
+}
+
+// Keeps one snapshot from before the window, and the events from there on
+static void reorder_prune(struct SurviveKalmanTrackerReorder *r) {
+	FLT horizon = r->latest_time - r->window;
+	while (r->snapshots_cnt > 1 && r->snapshots[1].time <= horizon) {
+		// Rotate the oldest to the back so its P buffer gets reused
+		struct SurviveKalmanTrackerSnapshot oldest = r->snapshots[0];
+		memmove(r->snapshots, r->snapshots + 1, (r->snapshots_cnt - 1) * sizeof(r->snapshots[0]));
+		r->snapshots[--r->snapshots_cnt] = oldest;
+	}
+
+	if (r->snapshots_cnt == 0 || r->snapshots[0].event_idx == 0) {
+		return;
+	}
+
+	size_t drop = r->snapshots[0].event_idx;
+	memmove(r->events, r->events + drop, (r->events_cnt - drop) * sizeof(r->events[0]));
+	r->events_cnt -= drop;
+	for (size_t i = 0; i < r->snapshots_cnt; i++) {
+		r->snapshots[i].event_idx -= drop;
 	}
 }
 
+static void reorder_replay(SurviveKalmanTracker *tracker, const SurviveKalmanTrackerEvent *ev) {
+	struct SurviveKalmanTrackerReorder *r = &tracker->reorder;
+
+	// After anything already fused at the same time, and from the last snapshot before that
+	size_t idx = r->events_cnt;
+	while (idx > 0 && r->events[idx - 1].time > ev->time) {
+		idx--;
+	}
+	size_t snapshot_idx = r->snapshots_cnt - 1;
+	while (snapshot_idx > 0 && r->snapshots[snapshot_idx].event_idx > idx) {
+		snapshot_idx--;
+	}
+
+	*reorder_insert_event(r, idx) = *ev;
+	for (size_t i = r->snapshots_cnt; i-- > snapshot_idx;) {
+		undo_light_variance(tracker, &r->snapshots[i]);
+	}
+	r->snapshots_cnt = snapshot_idx + 1;
+	reorder_restore_snapshot(tracker, &r->snapshots[snapshot_idx]);
+
+	// Light collected since the last sync isn't part of the filter state; keep it clear of the replayed batches
+	LightInfo pending[sizeof(tracker->savedLight) / sizeof(tracker->savedLight[0])];
+	uint32_t pending_cnt = tracker->savedLight_idx;
+	memcpy(pending, tracker->savedLight, pending_cnt * sizeof(pending[0]));
+
+	r->replaying = true;
+	size_t start = r->snapshots[snapshot_idx].event_idx;
+	for (size_t i = start; i < r->events_cnt; i++) {
+		if (i > start && r->events[i].time - r->snapshots[r->snapshots_cnt - 1].time >= r->snapshot_interval) {
+			reorder_take_snapshot(tracker, i);
+		}
+		r->latest_time = r->events[i].time;
+		apply_event(tracker, &r->events[i]);
+	}
+	r->replaying = false;
+
+	memcpy(tracker->savedLight, pending, pending_cnt * sizeof(pending[0]));
+	tracker->savedLight_idx = pending_cnt;
+
+	r->stats.replays++;
+	r->stats.replayed_events += r->events_cnt - start;
+
+	// Nothing is reported while replaying, so report once the filter has caught back up
+	if (r->events_cnt > 0) {
+		SURVIVE_PROFILE_STAGE(tracker->so->ctx, report,
+							  survive_kalman_tracker_report_state(event_hdr(&r->events[r->events_cnt - 1]), tracker));
+	}
+}
+
+static void reorder_submit(SurviveKalmanTracker *tracker, const SurviveKalmanTrackerEvent *ev) {
+	struct SurviveKalmanTrackerReorder *r = &tracker->reorder;
+	if (r->window <= 0 || r->replaying) {
+		SurviveKalmanTrackerEvent copy = *ev;
+		apply_event(tracker, &copy);
+		return;
+	}
+
+	if (ev->time >= r->latest_time) {
+		if (r->snapshots_cnt == 0 || ev->time - r->snapshots[r->snapshots_cnt - 1].time >= r->snapshot_interval) {
+			reorder_take_snapshot(tracker, r->events_cnt);
+		}
+
+		SurviveKalmanTrackerEvent *logged = reorder_insert_event(r, r->events_cnt);
+		*logged = *ev;
+		r->latest_time = ev->time;
+		apply_event(tracker, logged);
+		reorder_prune(r);
+		return;
+	}
+
+	FLT lateness = r->latest_time - ev->time;
+	if (lateness > r->window || r->snapshots_cnt == 0 || ev->time < r->snapshots[0].time) {
+		r->stats.late_dropped++;
+		return;
+	}
+
+	r->stats.max_lateness = linmath_max(r->stats.max_lateness, lateness);
+	reorder_replay(tracker, ev);
+}
+
+static void reorder_reset(struct SurviveKalmanTrackerReorder *r) {
+	r->events_cnt = 0;
+	r->snapshots_cnt = 0;
+	r->latest_time = 0;
+}
+
 typedef void (*survive_attach_detach_fn)(SurviveContext *ctx, const char *tag, FLT *var);
 
+static void smoother_predict(void *user, FLT dt, const FLT *x0, FLT *x1, FLT *F) {
+	SurviveKalmanTracker *tracker = user;
+	size_t n = tracker->model.state_cnt, e = tracker->model.P.rows;
+	CnMat x0_mat = cnMat(n, 1, (FLT *)x0), x1_mat = cnMat(n, 1, x1), F_mat = cnMat(e, e, F);
+	if (tracker->use_error_state) {
+		survive_kalman_error_tracker_predict_jac(dt, &tracker->model, &x0_mat, &x1_mat, &F_mat);
+	} else {
+		survive_kalman_tracker_predict_jac(dt, &tracker->model, &x0_mat, &x1_mat, &F_mat);
+	}
+}
+
+// The same process noise cnkalman adds over dt
+static void smoother_process_noise(void *user, FLT dt, const FLT *x, FLT *Q) {
+	SurviveKalmanTracker *tracker = user;
+	size_t n = tracker->model.state_cnt, e = tracker->model.P.rows;
+	CnMat x_mat = cnMat(n, 1, (FLT *)x), Q_mat = cnMat(e, e, Q);
+	memset(Q, 0, e * e * sizeof(FLT));
+	if (tracker->noise_model == 0) {
+		survive_kalman_tracker_process_noise(&tracker->params, tracker->use_error_state, dt, &x_mat, &Q_mat);
+	}
+	const CnMat *spv = &tracker->model.state_variance_per_second;
+	for (size_t i = 0; i < (size_t)spv->rows && i < e; i++) {
+		Q[i * e + i] += cn_as_const_vector(spv)[i] * dt;
+	}
+}
+
+static void smoother_difference(void *user, const FLT *x1, const FLT *x0, FLT *E) {
+	SurviveKalmanTracker *tracker = user;
+	size_t n = tracker->model.state_cnt;
+	SurviveKalmanModel state0 = copy_model(x0, n), state1 = copy_model(x1, n);
+	SurviveKalmanErrorModel error_state = {0};
+	SurviveKalmanModelToErrorModel(&error_state, &state1, &state0);
+	memcpy(E, &error_state, tracker->model.P.rows * sizeof(FLT));
+}
+
+static void smoother_add(void *user, const FLT *x0, const FLT *E, FLT *x1) {
+	SurviveKalmanTracker *tracker = user;
+	size_t n = tracker->model.state_cnt;
+	if (!tracker->use_error_state) {
+		addnd(x1, x0, E, n);
+		quatnormalize(x1 + 3, x1 + 3);
+		return;
+	}
+
+	SurviveKalmanModel state = copy_model(x0, n), out = {0};
+	SurviveKalmanErrorModel error_state = {0};
+	memcpy(&error_state, E, tracker->model.P.rows * sizeof(FLT));
+	SurviveKalmanModelAddErrorModel(&out, &state, &error_state);
+	memcpy(x1, &out, n * sizeof(FLT));
+}
+
+// Smoothed poses go out at the live report rate, and not while the filter wouldn't have reported them
+static void smoother_emit(void *user, const SurviveKalmanSmootherNode *node, const FLT *smoothed) {
+	SurviveKalmanTracker *tracker = user;
+	SurviveObject *so = tracker->so;
+
+	if (tracker->smoother_last_emit > 0 &&
+		node->t - tracker->smoother_last_emit < linmath_max(tracker->min_report_time, 0)) {
+		return;
+	}
+
+	size_t e = tracker->model.P.rows;
+	FLT var_diag[SURVIVE_MODEL_MAX_STATE_CNT] = {0};
+	for (size_t i = 0; i < e; i++) {
+		var_diag[i] = node->P[i * e + i];
+	}
+	if (tracker->report_threshold_var > 0 && normnd2(var_diag, e) >= tracker->report_threshold_var) {
+		return;
+	}
+	tracker->smoother_last_emit = node->t;
+
+	SurviveKalmanModel state = copy_model(smoothed, tracker->model.state_cnt);
+	SurvivePose head2world = state.Pose;
+	if (!tracker->report_in_imu) {
+		ApplyPoseToPose(&head2world, &state.Pose, &so->head2imu);
+	}
+	head2world.Pos[2] -= so->ctx->floor_offset;
+	survive_recording_smoothed_pose_process(so, node->runtime, &head2world);
+}
+
+static void smoother_push(SurviveKalmanTracker *tracker, survive_long_timecode timecode) {
+	SurviveObject *so = tracker->so;
+	FLT t = tracker->model.t;
+	FLT runtime_offset =
+		SurviveSensorActivations_runtime(&so->activations, timecode) * 1e-6 - timecode / (FLT)so->timebase_hz;
+	survive_kalman_smoother_push(tracker->smoother, t, t + runtime_offset, timecode, (const FLT *)&tracker->state,
+								 tracker->model.P.data);
+}
+
 void survive_kalman_tracker_reinit(SurviveKalmanTracker *tracker) {
 	memset(&tracker->stats, 0, sizeof(tracker->stats));
+	reorder_reset(&tracker->reorder);
+
+	// The states held are still good; smoothing across the reset isn't
+	if (tracker->smoother) {
+		survive_kalman_smoother_flush(tracker->smoother);
+		tracker->smoother_last_emit = 0;
+	}
+
+	uint32_t seq = tracker->published.seq;
+	SURVIVE_SEQ_STORE_RELEASE(&tracker->published.seq, seq + 1);
+	SURVIVE_SEQ_FENCE_RELEASE();
+	tracker->published.data.t = 0;
+	SURVIVE_SEQ_STORE_RELEASE(&tracker->published.seq, seq + 2);
 
 	tracker->report_ignore_start_cnt = 0;
 	tracker->last_light_time = 0;
@@ -1313,6 +2028,13 @@ void survive_kalman_tracker_init(SurviveKalmanTracker *tracker, SurviveObject *s
 	// more than any actual normalized quat could be off by.
 
 	SurviveKalmanTracker_attach_config(tracker->so->ctx, tracker);
+	tracker->report_in_imu = survive_configi(tracker->so->ctx, "report-in-imu", SC_GET, 0);
+
+	// Replaying would apply joint model updates to the lighthouses a second time
+	if (tracker->reorder.window > 0 && tracker->joint_lightcap_ratio >= 0) {
+		SV_WARN("kalman-reorder-window isn't supported with kalman-joint-model-lightcap; disabling reordering");
+		tracker->reorder.window = 0;
+	}
 
 	bool use_imu = (bool)survive_configi(ctx, "use-imu", SC_GET, 1);
 	if (!use_imu) {
@@ -1416,12 +2138,42 @@ void survive_kalman_tracker_init(SurviveKalmanTracker *tracker, SurviveObject *s
 	//tracker->lightcap_model.error_state_model = false;
 	tracker->lightcap_model.term_criteria.max_iterations = 10;
 
+	if (tracker->square_root && (tracker->use_error_state || tracker->noise_model != 0 ||
+								 tracker->lightcap_model.adaptive || !survive_kalman_fixed_supported(state_cnt))) {
+		SV_WARN("kalman-square-root isn't available for this model configuration (%d states); using the generic "
+				"update",
+				(int)state_cnt);
+		tracker->square_root = false;
+	}
+
     cnkalman_meas_model_init(&tracker->model, "obs", &tracker->obs_model, tracker->obs_axisangle_model ? map_obs_data_axisangle : map_obs_data);
 	cnkalman_meas_model_t_obj_obs_attach_config(ctx, &tracker->obs_model);
 	tracker->obs_model.term_criteria.max_iterations = 10;
 
 	survive_kalman_tracker_reinit(tracker);
 
+	if (tracker->smoother_lag > 0) {
+		if (tracker->reorder.window > tracker->smoother_lag) {
+			SV_WARN("kalman-smoother-lag is shorter than kalman-reorder-window; raising it to %f",
+					tracker->reorder.window);
+			tracker->smoother_lag = tracker->reorder.window;
+		}
+		if (ctx->private_members->smoothed_recording == 0) {
+			SV_WARN("kalman-smoother-lag is set, but there is no smoothed-record to write to");
+		}
+
+		SurviveKalmanSmootherModel model = {.state_cnt = state_cnt,
+											.error_cnt = tracker->model.P.rows,
+											.user = tracker,
+											.predict = smoother_predict,
+											.process_noise = smoother_process_noise,
+											.difference = tracker->use_error_state ? smoother_difference : 0,
+											.add = smoother_add};
+		tracker->smoother = SV_CALLOC(sizeof(SurviveKalmanSmoother));
+		survive_kalman_smoother_init(tracker->smoother, &model, tracker->smoother_lag, tracker->smoother_max_nodes,
+									 smoother_emit, tracker);
+	}
+
 	SV_VERBOSE(10, "Tracker config for %s (%d state count)", survive_colorize_codename(tracker->so), (int)state_cnt);
 }
 
@@ -1469,12 +2221,28 @@ void survive_kalman_tracker_stats(SurviveKalmanTracker *tracker) {
 
 	SV_VERBOSE(5, "\t%-32s %u", "late imu", tracker->stats.late_imu_dropped);
 	SV_VERBOSE(5, "\t%-32s %u", "late light", tracker->stats.late_light_dropped);
+	if (tracker->reorder.window > 0) {
+		SV_VERBOSE(5, "\t%-32s %u replays, %u events, %u dropped, %7.3fms max", "reordering",
+				   tracker->reorder.stats.replays, tracker->reorder.stats.replayed_events,
+				   tracker->reorder.stats.late_dropped, tracker->reorder.stats.max_lateness * 1000.);
+	}
 	//joint_model_sensor_cnt_sum
 	SV_VERBOSE(5, "\t%-32s %7.7f avg cnt %8d dropped", "joint model", tracker->stats.joint_model_sensor_cnt_sum / (FLT) tracker->joint_model.stats.total_runs,
 			   tracker->stats.joint_model_dropped);
 	SV_VERBOSE(5, "\t%-32s %7.7f avg cnt %8d dropped", "lightcap model", tracker->stats.lightcap_model_sensor_cnt_sum / (FLT) tracker->lightcap_model.stats.total_runs,
 			   tracker->stats.lightcap_model_dropped);
 
+	if (tracker->smoother) {
+		SV_VERBOSE(5, "\t%-32s %u pushed, %u emitted, %u passes, %u rolled back, %u singular", "smoother",
+				   (unsigned)tracker->smoother->stats.pushed, (unsigned)tracker->smoother->stats.emitted,
+				   (unsigned)tracker->smoother->stats.passes, (unsigned)tracker->smoother->stats.truncated,
+				   (unsigned)tracker->smoother->stats.singular);
+	}
+	if (tracker->square_root || tracker->stability.lost_tracking) {
+		SV_VERBOSE(5, "\t%-32s %u resets, %u covariance repairs", "stability", tracker->stability.lost_tracking,
+				   tracker->stability.covariance_repairs);
+	}
+
 	SV_VERBOSE(5, "\t%-32s %u of %u (%2.2f%%)", "Dropped poses", (unsigned)tracker->stats.dropped_poses,
 			   (unsigned)(tracker->stats.reported_poses + tracker->stats.dropped_poses),
 			   100. * tracker->stats.dropped_poses /
@@ -1566,11 +2334,26 @@ void survive_kalman_tracker_stats(SurviveKalmanTracker *tracker) {
 void survive_kalman_tracker_free(SurviveKalmanTracker *tracker) {
 	SurviveContext *ctx = tracker->so->ctx;
 
+	if (tracker->smoother) {
+		survive_kalman_smoother_flush(tracker->smoother);
+	}
 	survive_kalman_tracker_stats(tracker);
+	if (tracker->smoother) {
+		survive_kalman_smoother_free(tracker->smoother);
+		free(tracker->smoother);
+		tracker->smoother = 0;
+	}
 
 	cnkalman_state_free(&tracker->model);
 	cnkalman_state_free(&tracker->imu_bias_model);
 
+	for (size_t i = 0; i < tracker->reorder.snapshots_capacity; i++) {
+		free(tracker->reorder.snapshots[i].P);
+		free(tracker->reorder.snapshots[i].light_undo);
+	}
+	free(tracker->reorder.snapshots);
+	free(tracker->reorder.events);
+
 	cnkalman_meas_model_t_joint_lightcap_detach_config(tracker->so->ctx, &tracker->joint_model);
 	cnkalman_meas_model_t_obj_imu_detach_config(tracker->so->ctx, &tracker->imu_model);
 	cnkalman_meas_model_t_obj_obs_detach_config(tracker->so->ctx, &tracker->obs_model);
@@ -1589,6 +2372,7 @@ void survive_kalman_tracker_lost_tracking(SurviveKalmanTracker *tracker, bool al
 			tracker->light_residuals_all,
 			SurviveSensorActivations_stationary_time(&tracker->so->activations) / 48000000.);
 	tracker->light_residuals_all = 0;
+	tracker->stability.lost_tracking++;
 	{
 		tracker->so->OutPoseIMU = (SurvivePose){0};
 		tracker->so->poseConfidence = 0;
@@ -1606,11 +2390,13 @@ void survive_kalman_tracker_lost_tracking(SurviveKalmanTracker *tracker, bool al
 	}
 
 	if (!objectsAreValid) {
+		survive_get_lh_lock(ctx);
 	  ctx->floor_offset = 0;
 		for (int lh = 0; lh < ctx->activeLighthouses; lh++) {
 			ctx->bsd[lh].PositionSet = 0;
 			SV_WARN("Lost tracking for LH%d %f", lh, tracker->light_residuals[lh]);
 		}
+		survive_release_lh_lock(ctx);
 	}
 }
 
@@ -1633,6 +2419,13 @@ bool survive_kalman_tracker_check_valid(SurviveKalmanTracker *tracker) {
 void survive_kalman_tracker_report_state(PoserData *pd, SurviveKalmanTracker *tracker) {
 	SurvivePose pose = {0};
 	normalize_model(tracker);
+	// Every posterior is a smoother node, replayed ones included
+	if (tracker->smoother && tracker->model.t > 0) {
+		smoother_push(tracker, pd->timecode);
+	}
+	if (tracker->reorder.replaying) {
+		return;
+	}
 
 	FLT t = pd->timecode / (FLT)tracker->so->timebase_hz;
 
@@ -1740,6 +2533,7 @@ void survive_kalman_tracker_report_state(PoserData *pd, SurviveKalmanTracker *tr
     }
 
     tracker->previous_state = tracker->state;
+	survive_kalman_tracker_publish_state(tracker, pd->timecode);
     copy3d(so->acceleration, tracker->state.Acc);
 	SV_VERBOSE(110, "%s confidence %7.7f", survive_colorize_codename(so), 1. / p_threshold);
 	if (so->OutPose_timecode < pd->timecode) {
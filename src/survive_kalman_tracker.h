@@ -35,6 +35,86 @@ struct SurviveKalmanTracker_Params {
 	FLT initial_variance_imu_correction;
 };
 
+typedef enum SurviveKalmanTrackerEventType {
+	SurviveKalmanTrackerEvent_imu,
+	SurviveKalmanTrackerEvent_light,
+	SurviveKalmanTrackerEvent_obs,
+} SurviveKalmanTrackerEventType;
+
+/**
+ * A measurement as it was handed to the tracker, kept so it can be fused again after a late one is slotted in ahead of
+ * it. Light is kept per batch -- the contents of savedLight at the time it was integrated.
+ */
+typedef struct SurviveKalmanTrackerEvent {
+	FLT time;
+	SurviveKalmanTrackerEventType type;
+	union {
+		PoserDataIMU imu;
+		struct {
+			PoserData hdr;
+			uint32_t cnt;
+			LightInfo meas[32];
+		} light;
+		struct {
+			PoserData hdr;
+			SurvivePose pose;
+			int R_rows, R_cols;
+			FLT R[7 * 7];
+		} obs;
+	};
+} SurviveKalmanTrackerEvent;
+
+struct SurviveKalmanTrackerSnapshot;
+
+/**
+ * Lets measurements arrive out of order, e.g. IMU and light for one object coming in through different USB threads.
+ *
+ * Every measurement fused in the last 'window' seconds is logged, and every 'snapshot_interval' seconds the filter
+ * state is copied off. Measurements which are in order are fused immediately, same as without reordering; a late one
+ * rolls the filter back to the last snapshot before it and re-runs everything after it in timestamp order. Anything
+ * older than the window is dropped.
+ */
+struct SurviveKalmanTrackerReorder {
+	FLT window, snapshot_interval;
+
+	// Time of the newest measurement fused so far
+	FLT latest_time;
+	bool replaying;
+
+	SurviveKalmanTrackerEvent *events;
+	size_t events_cnt, events_capacity;
+
+	struct SurviveKalmanTrackerSnapshot *snapshots;
+	size_t snapshots_cnt, snapshots_capacity;
+
+	struct {
+		uint32_t replays;
+		uint32_t replayed_events;
+		uint32_t late_dropped;
+		FLT max_lateness;
+	} stats;
+};
+
+/**
+ * Copy of the filter state made each time a pose is reported, for readers which don't hold the context lock.
+ *
+ * It is a seqlock: the tracker makes 'seq' odd while it writes and even again when done, and a reader retries its copy
+ * if 'seq' was odd or changed underneath it. The tracker never waits on readers.
+ */
+struct SurviveKalmanTrackerPublished {
+	uint32_t seq;
+	struct {
+		// Filter time, on the device clock; 0 until the first report
+		FLT t;
+		// Add to a device time to get survive_run_time
+		FLT runtime_offset;
+		SurviveKalmanModel state;
+		SurvivePose head2imu;
+		FLT floor_offset;
+		bool report_in_imu;
+	} data;
+};
+
 /**
  * The kalman model as it pertains to LH tracking has a state space like so:
  *
@@ -72,8 +152,10 @@ typedef struct SurviveKalmanTracker {
 	FLT report_sampled_cloud;
 
 	bool minimize_state_space, use_error_state;
+	bool square_root;
 	bool use_raw_obs;
 	bool show_raw_obs;
+	bool report_in_imu;
 
 	FLT joint_lightcap_ratio;
 	int joint_min_sensor_cnt;
@@ -97,6 +179,12 @@ typedef struct SurviveKalmanTracker {
 
 	const char* datalog_tag;
 
+	// Kept across reinit and stats resets so a whole session can be compared between filter formulations
+	struct {
+		uint32_t lost_tracking;
+		uint32_t covariance_repairs;
+	} stability;
+
 	struct {
 		uint32_t late_imu_dropped;
 		uint32_t late_light_dropped;
@@ -150,15 +238,41 @@ typedef struct SurviveKalmanTracker {
 
 	struct variance_tracker imu_variance, pose_variance;
 	struct variance_tracker light_variance[NUM_GEN2_LIGHTHOUSES][SENSORS_PER_OBJECT][2];
+
+	struct SurviveKalmanTrackerReorder reorder;
+	struct SurviveKalmanTrackerPublished published;
+
+	// Only allocated when kalman-smoother-lag is set; see survive_kalman_smoother.h
+	FLT smoother_lag;
+	int smoother_max_nodes;
+	FLT smoother_last_emit;
+	struct SurviveKalmanSmoother *smoother;
 } SurviveKalmanTracker;
 
 SURVIVE_EXPORT SurviveVelocity survive_kalman_tracker_velocity(const SurviveKalmanTracker *tracker);
 SURVIVE_EXPORT bool survive_kalman_tracker_predict_variance(const SurviveKalmanTracker *tracker, FLT time, CnMat* P);
 SURVIVE_EXPORT void survive_kalman_tracker_predict(const SurviveKalmanTracker *tracker, FLT time, SurvivePose *out);
+/**
+ * Lock free; predicts head2world at 'runtime' (survive_run_time clock) from the last published state.
+ *
+ * @return false if nothing has been published yet
+ */
+SURVIVE_EXPORT bool survive_kalman_tracker_predict_published(const SurviveKalmanTracker *tracker, FLT runtime,
+															 SurvivePose *head2world);
+/**
+ * Copies the current filter state out for survive_kalman_tracker_predict_published. Called with the tracker's ingest
+ * lock held each time a pose is reported; there must only ever be one writer at a time.
+ */
+SURVIVE_EXPORT void survive_kalman_tracker_publish_state(SurviveKalmanTracker *tracker, survive_long_timecode timecode);
 SURVIVE_EXPORT void survive_kalman_tracker_init(SurviveKalmanTracker *tracker, SurviveObject *so);
 SURVIVE_EXPORT void survive_kalman_tracker_free(SurviveKalmanTracker *tracker);
 SURVIVE_EXPORT void survive_kalman_tracker_integrate_imu(SurviveKalmanTracker *tracker, PoserDataIMU *data);
 SURVIVE_EXPORT void survive_kalman_tracker_integrate_light(SurviveKalmanTracker *tracker, PoserDataLight *data);
+/**
+ * @return How many more light measurements the tracker saves before it integrates them without waiting for a sync
+ * (light-batch-size); SIZE_MAX without a tracker
+ */
+SURVIVE_EXPORT size_t survive_kalman_tracker_light_until_batch(const SurviveKalmanTracker *tracker);
 
 SURVIVE_EXPORT void survive_kalman_tracker_integrate_observation(PoserData *pd, SurviveKalmanTracker *tracker,
 																 const SurvivePose *pose, const struct CnMat *R);
@@ -172,6 +286,14 @@ SURVIVE_EXPORT void survive_kalman_tracker_process_noise(const struct SurviveKal
 SURVIVE_EXPORT bool survive_kalman_tracker_imu_measurement_model(void *user, const struct CnMat *Z,
 																 const struct CnMat *x_t, struct CnMat *y,
 																 struct CnMat *H_k);
+/**
+ * The measurement model the light update runs, for the Z->rows measurements in savedLight from savedLight_idx on:
+ * y = Z - h(x_t), clamped to lightcap_max_error when that is set. With H_k the generated LightMeas functions give h
+ * and the jacobian; without it h comes from the reprojection model's batch function when it has one.
+ */
+SURVIVE_EXPORT bool survive_kalman_tracker_light_measurement_model(SurviveKalmanTracker *tracker, const struct CnMat *Z,
+																   const struct CnMat *x_t, struct CnMat *y,
+																   struct CnMat *H_k);
 SURVIVE_EXPORT void survive_kalman_tracker_correct_imu(SurviveKalmanTracker *tracker, LinmathVec3d out, const LinmathVec3d accel);
 
 #define MEAS_MDL_CONFIG(prefix, x, default_iterations, default_max_error)                                              \
@@ -0,0 +1,86 @@
+#include "survive_name_index.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <survive.h>
+
+static size_t hash_name(const char *name) {
+	// FNV-1a
+	uint32_t h = 2166136261u;
+	for (; *name; name++) {
+		h = (h ^ (uint8_t)*name) * 16777619u;
+	}
+	return h;
+}
+
+// Slot holding name, or the empty slot where it would go
+static size_t find_slot(const survive_name_index *index, const char *name) {
+	size_t mask = index->capacity - 1;
+	size_t i = hash_name(name) & mask;
+	while (index->entries[i].name && strcmp(index->entries[i].name, name) != 0) {
+		i = (i + 1) & mask;
+	}
+	return i;
+}
+
+static void grow(survive_name_index *index) {
+	survive_name_index old = *index;
+	index->capacity = old.capacity ? old.capacity * 2 : 16;
+	index->entries = SV_CALLOC_N(index->capacity, sizeof(survive_name_index_entry));
+	for (size_t i = 0; i < old.capacity; i++) {
+		if (old.entries[i].name) {
+			index->entries[find_slot(index, old.entries[i].name)] = old.entries[i];
+		}
+	}
+	free(old.entries);
+}
+
+void *survive_name_index_get(const survive_name_index *index, const char *name) {
+	if (index->cnt == 0) {
+		return 0;
+	}
+	return index->entries[find_slot(index, name)].value;
+}
+
+void survive_name_index_put(survive_name_index *index, const char *name, void *value) {
+	// Keep the load under a half so probes stay short
+	if (2 * (index->cnt + 1) > index->capacity) {
+		grow(index);
+	}
+
+	survive_name_index_entry *entry = &index->entries[find_slot(index, name)];
+	if (entry->name == 0) {
+		index->cnt++;
+	}
+	entry->name = name;
+	entry->value = value;
+}
+
+bool survive_name_index_remove(survive_name_index *index, const char *name) {
+	if (index->cnt == 0) {
+		return false;
+	}
+
+	size_t mask = index->capacity - 1;
+	size_t hole = find_slot(index, name);
+	if (index->entries[hole].name == 0) {
+		return false;
+	}
+
+	// Shift back any entry further along the run which would no longer be reachable past the hole
+	for (size_t i = (hole + 1) & mask; index->entries[i].name; i = (i + 1) & mask) {
+		size_t home = hash_name(index->entries[i].name) & mask;
+		if (((i - home) & mask) >= ((i - hole) & mask)) {
+			index->entries[hole] = index->entries[i];
+			hole = i;
+		}
+	}
+	index->entries[hole] = (survive_name_index_entry){0};
+	index->cnt--;
+	return true;
+}
+
+void survive_name_index_free(survive_name_index *index) {
+	free(index->entries);
+	*index = (survive_name_index){0};
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "survive_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Hash table from names to pointers; open addressing with linear probing.
+ *
+ * The index doesn't copy names. Every name put in has to stay valid and unchanged until it is removed, which is
+ * natural when the name lives in the object it maps to (SurviveObject::codename for instance).
+ */
+typedef struct survive_name_index_entry {
+	const char *name;
+	void *value;
+} survive_name_index_entry;
+
+typedef struct survive_name_index {
+	survive_name_index_entry *entries;
+	// Always zero or a power of two
+	size_t capacity;
+	size_t cnt;
+} survive_name_index;
+
+/**
+ * @return The value stored under name, or 0
+ */
+SURVIVE_EXPORT void *survive_name_index_get(const survive_name_index *index, const char *name);
+/**
+ * Adds name, or replaces the value already stored under it.
+ */
+SURVIVE_EXPORT void survive_name_index_put(survive_name_index *index, const char *name, void *value);
+/**
+ * @return Whether name was in the index
+ */
+SURVIVE_EXPORT bool survive_name_index_remove(survive_name_index *index, const char *name);
+SURVIVE_EXPORT void survive_name_index_free(survive_name_index *index);
+
+#ifdef __cplusplus
+};
+#endif
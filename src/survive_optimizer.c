@@ -14,7 +14,10 @@
 
 #include "mpfit/mpfit.h"
 #include "survive_default_devices.h"
+#include "survive_internal.h"
 #include "survive_kalman_tracker.h"
+#include "survive_optimizer_sparse.h"
+#include "survive_private.h"
 #include "survive_recording.h"
 
 #if !defined(__FreeBSD__) && !defined(__APPLE__)
@@ -44,6 +47,10 @@ STRUCT_CONFIG_SECTION(survive_optimizer_settings)
 	STRUCT_CONFIG_ITEM("mpfit-optimize-scale-threshold", "Treat scale as mutable", -1, t->optimize_scale_threshold)
 	STRUCT_CONFIG_ITEM("mpfit-current-pos-bias", "", -1, t->current_pos_bias)
 	STRUCT_CONFIG_ITEM("mpfit-current-rot-bias", "", -1, t->current_rot_bias)
+	STRUCT_CONFIG_ITEM("optimizer-threads", "Threads used to evaluate the optimizer's residuals and jacobian", 1,
+					   t->threads)
+	STRUCT_CONFIG_ITEM("optimizer-sparse", "Solve with the sparse Schur complement backend instead of mpfit", 0,
+					   t->sparse)
 END_STRUCT_CONFIG_SECTION(survive_optimizer_settings)
 
 static char *object_parameter_names[] = {"Pose x",	   "Pose y",	 "Pose z",	  "Pose Rot w",
@@ -451,10 +458,136 @@ static void ApplyDualPoseToPoint(const survive_optimizer *mpfit_ctx, LinmathVec3
     }
 }
 
+static inline void add_stats_term(survive_optimizer *mpfunc_ctx, FLT *stat, int *stat_cnt, size_t meas_idx, FLT term) {
+	if (mpfunc_ctx->stats_terms) {
+		mpfunc_ctx->stats_terms[meas_idx] = term;
+	} else {
+		*stat += term;
+		(*stat_cnt)++;
+	}
+}
+
+// Light residuals are queued up and reprojected this many at a time so the model can share work between points
+#define LIGHT_RESIDUAL_BATCH 64
+
+enum light_residual_kind { light_residual_x = 0, light_residual_y = 1, light_residual_pair = 2 };
+
+typedef struct light_residual_batch {
+	FLT *deviates;
+	size_t cnt;
+	size_t meas_idx[LIGHT_RESIDUAL_BATCH];
+	const survive_optimizer_measurement *meas[LIGHT_RESIDUAL_BATCH];
+	enum light_residual_kind kind[LIGHT_RESIDUAL_BATCH];
+	LinmathPoint3d ptInLH[LIGHT_RESIDUAL_BATCH];
+} light_residual_batch;
+
+// Sets the deviate for meas and returns its error term for the stats
+static inline FLT record_light_residual(survive_optimizer *mpfunc_ctx, FLT *deviates, size_t meas_idx,
+										const survive_optimizer_measurement *meas, FLT value) {
+	FLT correction = get_lighthouse_correction_for(mpfunc_ctx, meas->light.object, meas->light.lh, meas->light.axis);
+	FLT error = fix_infinity(value - meas->light.value - correction);
+	deviates[meas_idx] = error / meas->variance;
+	return error * error;
+}
+
+static inline void add_light_stats_term(survive_optimizer *mpfunc_ctx, size_t meas_idx, FLT term) {
+	add_stats_term(mpfunc_ctx, &mpfunc_ctx->stats.sensor_error, &mpfunc_ctx->stats.sensor_error_cnt, meas_idx, term);
+}
+
+static void light_residual_batch_flush(survive_optimizer *mpfunc_ctx, light_residual_batch *batch) {
+	const survive_reproject_model_t *reprojectModel = mpfunc_ctx->reprojectModel;
+	bool done[LIGHT_RESIDUAL_BATCH] = {0};
+	size_t entries[LIGHT_RESIDUAL_BATCH];
+	FLT x[LIGHT_RESIDUAL_BATCH], y[LIGHT_RESIDUAL_BATCH], z[LIGHT_RESIDUAL_BATCH];
+	FLT out[2][LIGHT_RESIDUAL_BATCH];
+	FLT terms[LIGHT_RESIDUAL_BATCH][2];
+
+	// One call per lighthouse and kind, so each call only reprojects the axes it needs
+	for (size_t i = 0; i < batch->cnt; i++) {
+		if (done[i])
+			continue;
+
+		const int lh = batch->meas[i]->light.lh;
+		const enum light_residual_kind kind = batch->kind[i];
+		size_t n = 0;
+		for (size_t j = i; j < batch->cnt; j++) {
+			if (done[j] || batch->meas[j]->light.lh != lh || batch->kind[j] != kind)
+				continue;
+			done[j] = true;
+			entries[n] = j;
+			x[n] = batch->ptInLH[j][0];
+			y[n] = batch->ptInLH[j][1];
+			z[n] = batch->ptInLH[j][2];
+			n++;
+		}
+
+		const struct BaseStationCal *cal = survive_optimizer_get_calibration(mpfunc_ctx, lh);
+		reprojectModel->reprojectXYBatch(cal, n, x, y, z, kind != light_residual_y ? out[0] : 0,
+										 kind != light_residual_x ? out[1] : 0);
+
+		for (size_t k = 0; k < n; k++) {
+			size_t entry = entries[k];
+			if (kind == light_residual_pair) {
+				for (int axis = 0; axis < 2; axis++) {
+					terms[entry][axis] = record_light_residual(mpfunc_ctx, batch->deviates,
+															   batch->meas_idx[entry] + axis,
+															   batch->meas[entry] + axis, out[axis][k]);
+				}
+			} else {
+				terms[entry][0] = record_light_residual(mpfunc_ctx, batch->deviates, batch->meas_idx[entry],
+														batch->meas[entry], out[kind][k]);
+			}
+		}
+	}
+
+	// Stats are summed in the order the measurements were queued, not the order they were reprojected in, so the
+	// totals come out the same however the batch is grouped and on every thread count
+	for (size_t i = 0; i < batch->cnt; i++) {
+		for (int axis = 0; axis < (batch->kind[i] == light_residual_pair ? 2 : 1); axis++)
+			add_light_stats_term(mpfunc_ctx, batch->meas_idx[i] + axis, terms[i][axis]);
+	}
+	batch->cnt = 0;
+}
+
+/**
+ * Queues the residual(s) for meas; pairs are meas[0] and meas[1]. Models without a batch function are evaluated
+ * straight away.
+ */
+static inline void light_residual_batch_add(survive_optimizer *mpfunc_ctx, light_residual_batch *batch,
+											size_t meas_idx, const survive_optimizer_measurement *meas,
+											enum light_residual_kind kind, const LinmathPoint3d ptInLH) {
+	const survive_reproject_model_t *reprojectModel = mpfunc_ctx->reprojectModel;
+	if (reprojectModel->reprojectXYBatch == 0) {
+		if (kind == light_residual_pair) {
+			FLT out[2];
+			reprojectModel->reprojectXY(survive_optimizer_get_calibration(mpfunc_ctx, meas->light.lh), ptInLH, out);
+			for (int axis = 0; axis < 2; axis++) {
+				FLT term = record_light_residual(mpfunc_ctx, batch->deviates, meas_idx + axis, meas + axis, out[axis]);
+				add_light_stats_term(mpfunc_ctx, meas_idx + axis, term);
+			}
+		} else {
+			FLT out = reprojectModel->reprojectAxisFn[kind](
+				survive_optimizer_get_calibration(mpfunc_ctx, meas->light.lh), ptInLH);
+			add_light_stats_term(mpfunc_ctx, meas_idx,
+								 record_light_residual(mpfunc_ctx, batch->deviates, meas_idx, meas, out));
+		}
+		return;
+	}
+
+	size_t i = batch->cnt++;
+	batch->meas_idx[i] = meas_idx;
+	batch->meas[i] = meas;
+	batch->kind[i] = kind;
+	copy3d(batch->ptInLH[i], ptInLH);
+	if (batch->cnt == LIGHT_RESIDUAL_BATCH)
+		light_residual_batch_flush(mpfunc_ctx, batch);
+}
+
 static inline void run_pair_measurement(survive_optimizer *mpfunc_ctx, size_t meas_idx,
 										const survive_optimizer_measurement *meas, const CnMat *ang_vel_jacb,
 										const LinmathDualPose *obj2world, const LinmathDualPose *obj2lh,
-										const LinmathDualPose *world2lh, const FLT *pt, FLT *deviates, FLT **derivs) {
+										const LinmathDualPose *world2lh, const FLT *pt, light_residual_batch *batch,
+										FLT **derivs) {
 	const survive_reproject_model_t *reprojectModel = mpfunc_ctx->reprojectModel;
 	const int lh = meas->light.lh;
 	const struct BaseStationCal *cal = survive_optimizer_get_calibration(mpfunc_ctx, lh);
@@ -462,30 +595,9 @@ static inline void run_pair_measurement(survive_optimizer *mpfunc_ctx, size_t me
 	LinmathPoint3d sensorPtInLH;
     ApplyDualPoseToPoint(mpfunc_ctx, sensorPtInLH, obj2lh, pt);
 
-	FLT out[2];
-	reprojectModel->reprojectXY(cal, sensorPtInLH, out);
 	assert(meas[0].light.axis == 0);
 	assert(meas[1].light.axis == 1);
-#ifndef NDEBUG
-	if (reprojectModel->reprojectAxisFn[0]) {
-		/*FLT check[] = {reprojectModel->reprojectAxisangleFullXyFn[0](obj2lh, pt, world2lh, cal),
-					   reprojectModel->reprojectAxisangleFullXyFn[1](obj2lh, pt, world2lh, cal + 1)};
-					   */
-		FLT check[] = {reprojectModel->reprojectAxisFn[0](cal, sensorPtInLH),
-					   reprojectModel->reprojectAxisFn[1](cal, sensorPtInLH)};
-		for (int i = 0; i < 2; i++)
-			assert(fabs(check[i] - out[i]) < 1e-5);
-	}
-#endif
-
-	for (int i = 0; i < 2; i++) {
-		FLT correction = get_lighthouse_correction_for(mpfunc_ctx, meas->light.object, meas->light.lh, i);
-
-	    FLT error =  fix_infinity(out[i] - meas[i].light.value - correction);
-		deviates[i] = error / meas[i].variance;
-        mpfunc_ctx->stats.sensor_error += error * error;
-        mpfunc_ctx->stats.sensor_error_cnt++;
-	}
+	light_residual_batch_add(mpfunc_ctx, batch, meas_idx, meas, light_residual_pair, sensorPtInLH);
 
 	if (derivs) {
         int pose_size = mpfunc_ctx->settings->use_quat_model ? 7 : 6;
@@ -564,7 +676,8 @@ static inline void run_pair_measurement(survive_optimizer *mpfunc_ctx, size_t me
 static void run_single_measurement(survive_optimizer *mpfunc_ctx, size_t meas_idx,
 								   const survive_optimizer_measurement *meas, const CnMat *ang_vel_jacb,
 								   const LinmathDualPose *obj2world, const LinmathDualPose *obj2lh,
-								   const LinmathDualPose *world2lh, const FLT *pt, FLT *deviates, FLT **derivs) {
+								   const LinmathDualPose *world2lh, const FLT *pt, light_residual_batch *batch,
+								   FLT **derivs) {
 	const survive_reproject_model_t *reprojectModel = mpfunc_ctx->reprojectModel;
 	const int lh = meas->light.lh;
 
@@ -574,14 +687,8 @@ static void run_single_measurement(survive_optimizer *mpfunc_ctx, size_t meas_id
 	LinmathPoint3d sensorPtInLH;
     ApplyDualPoseToPoint(mpfunc_ctx, sensorPtInLH, obj2lh, pt);
 
-	FLT out = reprojectModel->reprojectAxisFn[meas->light.axis](cal, sensorPtInLH);
-	FLT correction = get_lighthouse_correction_for(mpfunc_ctx, meas->light.object, meas->light.lh, meas->light.axis);
-	//SurviveObject * so = mpfunc_ctx->sos[meas->light.object];
-	//assert(so->lh_correction[meas->light.lh][meas->light.axis] == correction);
-	FLT error = fix_infinity(out - meas->light.value - correction);
-	deviates[0] = error / meas->variance;
-    mpfunc_ctx->stats.sensor_error += error * error;
-    mpfunc_ctx->stats.sensor_error_cnt++;
+	light_residual_batch_add(mpfunc_ctx, batch, meas_idx, meas, (enum light_residual_kind)meas->light.axis,
+							 sensorPtInLH);
 
 	if (derivs) {
         int pose_size = mpfunc_ctx->settings->use_quat_model ? 7 : 6;
@@ -816,22 +923,27 @@ static void handle_accel_meas(survive_optimizer *mpfunc_ctx, survive_optimizer_m
 		}
 	}
 
-	mpfunc_ctx->stats.object_up_error += error * error;
-	mpfunc_ctx->stats.object_up_error_cnt++;
+	add_stats_term(mpfunc_ctx, &mpfunc_ctx->stats.object_up_error, &mpfunc_ctx->stats.object_up_error_cnt, meas_idx,
+				   error * error);
 }
 
-static int mpfunc(int m, int n, FLT *p, FLT *deviates, FLT **derivs, void *private) {
-	survive_optimizer *mpfunc_ctx = private;
-
-	assert(survive_optimizer_get_meas_size(mpfunc_ctx) == m);
-	assert(survive_optimizer_get_parameters_count(mpfunc_ctx) == n);
-
-    mpfunc_ctx->stats.sensor_error = 0; mpfunc_ctx->stats.sensor_error_cnt = 0;
-    mpfunc_ctx->stats.object_up_error = 0; mpfunc_ctx->stats.object_up_error_cnt = 0;
-    mpfunc_ctx->stats.params_error = 0; mpfunc_ctx->stats.params_error_cnt = 0;
-
-    mpfunc_ctx->parameters = p;
+// If the next two measurements are joined; handle the full pair. This lets us just calculate sensorPtInLH once
+static inline bool light_meas_pairs_with_next(const survive_optimizer *mpfunc_ctx, size_t mea_block_idx) {
+	const survive_optimizer_measurement *meas = &mpfunc_ctx->measurements[mea_block_idx];
+	return mea_block_idx + 1 < mpfunc_ctx->measurementsCnt && mpfunc_ctx->disableVelocity == true &&
+		   meas[0].meas_type == survive_optimizer_measurement_type_light &&
+		   meas[1].meas_type == survive_optimizer_measurement_type_light && meas[0].light.axis == 0 &&
+		   meas[1].light.axis == 1 && meas[0].light.sensor_idx == meas[1].light.sensor_idx && !meas[1].invalid &&
+		   !mpfunc_ctx->settings->disallow_pair_calc;
+}
 
+/**
+ * Evaluates measurement blocks [block_start, block_end). Every cache used here is rebuilt on the first light
+ * measurement of the range, so any split that doesn't fall inside a pair gives the same output as one pass over
+ * everything.
+ */
+static void mpfunc_range(survive_optimizer *mpfunc_ctx, FLT *p, FLT *deviates, FLT **derivs, size_t block_start,
+						 size_t block_end, int meas_idx) {
 	LinmathDualPose *cameras = (LinmathDualPose*)survive_optimizer_get_camera(mpfunc_ctx);
 
 	int start = survive_optimizer_get_camera_index(mpfunc_ctx);
@@ -846,10 +958,9 @@ static int mpfunc(int m, int n, FLT *p, FLT *deviates, FLT **derivs, void *priva
 	CN_CREATE_STACK_MAT(ang_velocity_jac, ang_size, ang_size);
 	cn_set_diag_val(&ang_velocity_jac, 1);
 
-	int meas_count = m;
-	int meas_idx = 0;
+	light_residual_batch light_batch = {.deviates = deviates};
 
-	for (int mea_block_idx = 0; mea_block_idx < mpfunc_ctx->measurementsCnt; mea_block_idx++) {
+	for (size_t mea_block_idx = block_start; mea_block_idx < block_end; mea_block_idx++) {
 		survive_optimizer_measurement *meas = &mpfunc_ctx->measurements[mea_block_idx];
 
 		if (meas->invalid) {
@@ -868,18 +979,12 @@ static int mpfunc(int m, int n, FLT *p, FLT *deviates, FLT **derivs, void *priva
 				derivs[parameter_index][meas_idx] = 1. / (meas->variance + 1e-10);
 			}
 
-			mpfunc_ctx->stats.params_error_cnt++;
-			mpfunc_ctx->stats.params_error += deviates[meas_idx] * deviates[meas_idx];
+			add_stats_term(mpfunc_ctx, &mpfunc_ctx->stats.params_error, &mpfunc_ctx->stats.params_error_cnt, meas_idx,
+						   deviates[meas_idx] * deviates[meas_idx]);
 			break;
 		}
 		case survive_optimizer_measurement_type_light: {
-			// If the next two measurements are joined; handle the full pair. This lets us just calculate
-			// sensorPtInLH once
-			const bool nextIsPair =
-				mea_block_idx + 1 < mpfunc_ctx->measurementsCnt && mpfunc_ctx->disableVelocity == true &&
-				meas[1].meas_type == survive_optimizer_measurement_type_light && meas[0].light.axis == 0 &&
-				meas[1].light.axis == 1 && meas[0].light.sensor_idx == meas[1].light.sensor_idx && !meas[1].invalid &&
-				!mpfunc_ctx->settings->disallow_pair_calc;
+			const bool nextIsPair = light_meas_pairs_with_next(mpfunc_ctx, mea_block_idx);
 
 			const int lh = meas->light.lh;
 			const FLT *sensor_points = survive_optimizer_get_sensors(mpfunc_ctx, meas->light.object);
@@ -980,12 +1085,12 @@ static int mpfunc(int m, int n, FLT *p, FLT *deviates, FLT **derivs, void *priva
 
 			if (nextIsPair) {
 				run_pair_measurement(mpfunc_ctx, meas_idx, meas, &ang_velocity_jac, &obj2world, &obj2lh[lh], world2lh,
-									 pt, deviates + meas_idx, derivs);
+									 pt, &light_batch, derivs);
 				meas_idx++;
 				mea_block_idx++;
 			} else {
 				run_single_measurement(mpfunc_ctx, meas_idx, meas, &ang_velocity_jac, &obj2world, &obj2lh[lh], world2lh,
-									   pt, deviates + meas_idx, derivs);
+									   pt, &light_batch, derivs);
 			}
 
 			break;
@@ -1057,6 +1162,265 @@ static int mpfunc(int m, int n, FLT *p, FLT *deviates, FLT **derivs, void *priva
 		meas_idx += meas->size;
 	}
 
+	light_residual_batch_flush(mpfunc_ctx, &light_batch);
+}
+
+// Below this many measurement blocks per thread, handing work to the pool costs more than it saves
+#define SURVIVE_OPTIMIZER_MIN_BLOCKS_PER_THREAD 32
+#define SURVIVE_OPTIMIZER_MAX_THREADS 32
+
+typedef struct survive_optimizer_job {
+	survive_optimizer optimizer;
+	FLT *p, *deviates, **derivs;
+	size_t block_start, block_end;
+	int meas_idx;
+} survive_optimizer_job;
+
+typedef struct survive_optimizer_worker {
+	struct survive_optimizer_pool *pool;
+	og_thread_t thread;
+	og_sema_t start;
+	survive_optimizer_job job;
+} survive_optimizer_worker;
+
+struct survive_optimizer_pool {
+	bool busy; // Guarded by optimizer_pool_lock; only one optimizer at a time gets the workers
+	bool quit;
+	og_sema_t done;
+	size_t worker_cnt;
+	// Room for SURVIVE_OPTIMIZER_MAX_THREADS - 1 workers; threads are started as callers ask for more of them
+	survive_optimizer_worker *workers;
+
+	// Per measurement error terms; only touched by whoever holds the pool
+	FLT *stats_terms;
+	size_t stats_terms_cnt;
+};
+
+static void *survive_optimizer_worker_fn(void *_worker) {
+	survive_optimizer_worker *worker = _worker;
+	struct survive_optimizer_pool *pool = worker->pool;
+	while (true) {
+		OGLockSema(worker->start);
+		if (pool->quit)
+			break;
+
+		survive_optimizer_job *job = &worker->job;
+		mpfunc_range(&job->optimizer, job->p, job->deviates, job->derivs, job->block_start, job->block_end,
+					 job->meas_idx);
+		OGUnlockSema(pool->done);
+	}
+	return 0;
+}
+
+/**
+ * Returns 0 if another optimizer is already using the pool; the caller should just run serially then. Otherwise the
+ * pool is grown to at least worker_cnt workers.
+ */
+static struct survive_optimizer_pool *survive_optimizer_acquire_pool(SurviveContext *ctx, size_t worker_cnt) {
+	struct SurviveContext_private *pctx = ctx->private_members;
+	OGLockMutex(pctx->optimizer_pool_lock);
+
+	struct survive_optimizer_pool *pool = pctx->optimizer_pool;
+	if (pool == 0) {
+		pool = pctx->optimizer_pool = SV_CALLOC(sizeof(struct survive_optimizer_pool));
+		pool->done = OGCreateSema();
+		pool->workers = SV_CALLOC_N(SURVIVE_OPTIMIZER_MAX_THREADS - 1, sizeof(survive_optimizer_worker));
+	}
+
+	if (pool->busy) {
+		pool = 0;
+	} else {
+		pool->busy = true;
+
+		size_t started = pool->worker_cnt;
+		for (; pool->worker_cnt < worker_cnt; pool->worker_cnt++) {
+			survive_optimizer_worker *worker = &pool->workers[pool->worker_cnt];
+			worker->pool = pool;
+			worker->start = OGCreateSema();
+			worker->thread = OGCreateThread(survive_optimizer_worker_fn, "optimizer", worker);
+		}
+		if (started != pool->worker_cnt)
+			SV_VERBOSE(10, "Started %d optimizer worker threads", (int)(pool->worker_cnt - started));
+	}
+
+	OGUnlockMutex(pctx->optimizer_pool_lock);
+	return pool;
+}
+
+static void survive_optimizer_release_pool(SurviveContext *ctx, struct survive_optimizer_pool *pool) {
+	struct SurviveContext_private *pctx = ctx->private_members;
+	OGLockMutex(pctx->optimizer_pool_lock);
+	pool->busy = false;
+	OGUnlockMutex(pctx->optimizer_pool_lock);
+}
+
+void survive_optimizer_free_thread_pool(SurviveContext *ctx) {
+	struct SurviveContext_private *pctx = ctx->private_members;
+	struct survive_optimizer_pool *pool = pctx->optimizer_pool;
+	if (pool == 0)
+		return;
+
+	pool->quit = true;
+	for (size_t i = 0; i < pool->worker_cnt; i++) {
+		OGUnlockSema(pool->workers[i].start);
+		OGJoinThread(pool->workers[i].thread);
+		OGDeleteSema(pool->workers[i].start);
+	}
+	OGDeleteSema(pool->done);
+	free(pool->workers);
+	free(pool->stats_terms);
+	free(pool);
+	pctx->optimizer_pool = 0;
+}
+
+static inline int measurement_object(const survive_optimizer_measurement *meas) {
+	return meas->meas_type == survive_optimizer_measurement_type_light ? meas->light.object : -1;
+}
+
+/**
+ * Splits the measurement blocks into at most 'parts' contiguous ranges of roughly equal size. Splits prefer to land
+ * where the measurements switch objects, and never land between the two halves of a light pair since those are
+ * evaluated together.
+ */
+static size_t survive_optimizer_partition(const survive_optimizer *ctx, size_t parts, size_t *block_starts,
+										  int *meas_starts) {
+	size_t cnt = ctx->measurementsCnt;
+	size_t chunk = cnt / parts;
+
+	size_t part = 1;
+	block_starts[0] = 0;
+	meas_starts[0] = 0;
+
+	size_t candidate = 0;
+	int candidate_meas_idx = 0;
+	int meas_idx = 0;
+	for (size_t b = 0; b < cnt && part < parts; b++) {
+		const survive_optimizer_measurement *meas = &ctx->measurements[b];
+		size_t target = part * chunk;
+		bool can_split = b > 0 && !(!meas[-1].invalid && light_meas_pairs_with_next(ctx, b - 1));
+
+		if (b >= target && can_split) {
+			if (candidate == 0) {
+				candidate = b;
+				candidate_meas_idx = meas_idx;
+			}
+
+			bool object_change = measurement_object(meas) != measurement_object(meas - 1);
+			if (object_change || b >= target + chunk / 2) {
+				block_starts[part] = object_change ? b : candidate;
+				meas_starts[part] = object_change ? meas_idx : candidate_meas_idx;
+				part++;
+				candidate = 0;
+			}
+		}
+
+		meas_idx += meas->size;
+	}
+
+	block_starts[part] = cnt;
+	return part;
+}
+
+// Adds the per measurement error terms in block order; which is the order the serial path sums them in too, so the
+// stats are bit identical on every thread count.
+static void survive_optimizer_sum_stats_terms(survive_optimizer *optimizer, const FLT *terms) {
+	int meas_idx = 0;
+	for (size_t i = 0; i < optimizer->measurementsCnt; i++) {
+		const survive_optimizer_measurement *meas = &optimizer->measurements[i];
+		if (!meas->invalid) {
+			switch (meas->meas_type) {
+			case survive_optimizer_measurement_type_light:
+				optimizer->stats.sensor_error += terms[meas_idx];
+				optimizer->stats.sensor_error_cnt++;
+				break;
+			case survive_optimizer_measurement_type_object_accel:
+			case survive_optimizer_measurement_type_camera_accel:
+				optimizer->stats.object_up_error += terms[meas_idx];
+				optimizer->stats.object_up_error_cnt++;
+				break;
+			case survive_optimizer_measurement_type_parameters_bias:
+				optimizer->stats.params_error += terms[meas_idx];
+				optimizer->stats.params_error_cnt++;
+				break;
+			default:
+				break;
+			}
+		}
+		meas_idx += meas->size;
+	}
+}
+
+void survive_optimizer_evaluate(survive_optimizer *mpfunc_ctx, FLT *p, FLT *deviates, FLT **derivs) {
+	mpfunc_ctx->stats.sensor_error = 0; mpfunc_ctx->stats.sensor_error_cnt = 0;
+	mpfunc_ctx->stats.object_up_error = 0; mpfunc_ctx->stats.object_up_error_cnt = 0;
+	mpfunc_ctx->stats.params_error = 0; mpfunc_ctx->stats.params_error_cnt = 0;
+
+	mpfunc_ctx->parameters = p;
+
+	SurviveContext *ctx = (mpfunc_ctx->sos && mpfunc_ctx->sos[0]) ? mpfunc_ctx->sos[0]->ctx : 0;
+	size_t cnt = mpfunc_ctx->measurementsCnt;
+
+	size_t threads = mpfunc_ctx->settings->threads > 1 ? mpfunc_ctx->settings->threads : 1;
+	if (threads > SURVIVE_OPTIMIZER_MAX_THREADS)
+		threads = SURVIVE_OPTIMIZER_MAX_THREADS;
+	if (threads > cnt / SURVIVE_OPTIMIZER_MIN_BLOCKS_PER_THREAD)
+		threads = cnt / SURVIVE_OPTIMIZER_MIN_BLOCKS_PER_THREAD;
+
+	struct survive_optimizer_pool *pool = 0;
+	if (threads > 1 && ctx && ctx->private_members)
+		pool = survive_optimizer_acquire_pool(ctx, threads - 1);
+
+	if (pool == 0) {
+		mpfunc_range(mpfunc_ctx, p, deviates, derivs, 0, cnt, 0);
+		return;
+	}
+
+	if (threads > pool->worker_cnt + 1)
+		threads = pool->worker_cnt + 1;
+
+	size_t block_starts[SURVIVE_OPTIMIZER_MAX_THREADS + 1];
+	int meas_starts[SURVIVE_OPTIMIZER_MAX_THREADS + 1];
+	size_t parts = survive_optimizer_partition(mpfunc_ctx, threads, block_starts, meas_starts);
+
+	size_t meas_size = survive_optimizer_get_meas_size(mpfunc_ctx);
+	if (pool->stats_terms_cnt < meas_size) {
+		pool->stats_terms = SV_REALLOC(pool->stats_terms, meas_size * sizeof(FLT));
+		pool->stats_terms_cnt = meas_size;
+	}
+	FLT *stats_terms = pool->stats_terms;
+	for (size_t i = 1; i < parts; i++) {
+		survive_optimizer_worker *worker = &pool->workers[i - 1];
+		worker->job = (survive_optimizer_job){.optimizer = *mpfunc_ctx,
+											  .p = p,
+											  .deviates = deviates,
+											  .derivs = derivs,
+											  .block_start = block_starts[i],
+											  .block_end = block_starts[i + 1],
+											  .meas_idx = meas_starts[i]};
+		worker->job.optimizer.stats_terms = stats_terms;
+		OGUnlockSema(worker->start);
+	}
+
+	survive_optimizer first_part = *mpfunc_ctx;
+	first_part.stats_terms = stats_terms;
+	mpfunc_range(&first_part, p, deviates, derivs, 0, block_starts[1], 0);
+
+	for (size_t i = 1; i < parts; i++) {
+		OGLockSema(pool->done);
+	}
+	survive_optimizer_release_pool(ctx, pool);
+
+	survive_optimizer_sum_stats_terms(mpfunc_ctx, stats_terms);
+}
+
+static int mpfunc(int m, int n, FLT *p, FLT *deviates, FLT **derivs, void *private) {
+	survive_optimizer *mpfunc_ctx = private;
+
+	assert(survive_optimizer_get_meas_size(mpfunc_ctx) == m);
+	assert(survive_optimizer_get_parameters_count(mpfunc_ctx) == n);
+
+	survive_optimizer_evaluate(mpfunc_ctx, p, deviates, derivs);
+
 	if (mpfunc_ctx->needsFiltering) {
 		assert(derivs == 0);
 		filter_measurements(mpfunc_ctx, deviates);
@@ -1337,8 +1701,14 @@ int survive_optimizer_run(survive_optimizer *optimizer, struct mp_result_struct
 	//CN_CREATE_STACK_MAT(J, nfree, meas_count);
 	//result->jac = J.data;
 
-	int rtn = mpfit(mpfunc, meas_count, survive_optimizer_get_parameters_count(optimizer), optimizer->parameters,
+	int rtn = 0;
+	if (optimizer->settings->sparse && survive_optimizer_sparse_lm_supported(optimizer, result)) {
+		rtn = survive_optimizer_sparse_lm(mpfunc, meas_count, survive_optimizer_get_parameters_count(optimizer),
+										  optimizer->parameters, optimizer->mp_parameters_info, cfg, optimizer, result);
+	} else {
+		rtn = mpfit(mpfunc, meas_count, survive_optimizer_get_parameters_count(optimizer), optimizer->parameters,
 					optimizer->mp_parameters_info, cfg, optimizer, result);
+	}
 	optimizer->parameters = params;
 
 	FLT rchisqr = linmath_max(1, result->bestnorm / nfree);
@@ -1504,12 +1874,19 @@ void survive_optimizer_serialize(const survive_optimizer *opt, const char *fn) {
 	fclose(f);
 }
 
-survive_optimizer *survive_optimizer_load(const char *fn) {
-	survive_optimizer *opt = calloc(sizeof(survive_optimizer), 1);
+// Serialized problems don't carry their settings; callers can swap in their own once the problem is loaded.
+static survive_optimizer_settings load_default_settings = {
+	.optimize_scale_threshold = -1, .current_pos_bias = -1, .current_rot_bias = -1, .threads = 1};
 
+survive_optimizer *survive_optimizer_load(const char *fn) {
 	FILE *f = fopen(fn, "r");
 	if (f == 0)
 		return 0;
+
+	survive_optimizer *opt = calloc(sizeof(survive_optimizer), 1);
+	opt->settings = &load_default_settings;
+	opt->disableVelocity = true;
+	opt->objectUpVectorVariance = -1;
 	int read_count = 0;
 
 #ifndef LINE_MAX
@@ -1532,9 +1909,20 @@ survive_optimizer *survive_optimizer_load(const char *fn) {
 	assert(success);
 
 	(void)read_count;
-	assert(param_count == survive_optimizer_get_parameters_count(opt));
 
 	SURVIVE_OPTIMIZER_SETUP_HEAP_BUFFERS(*opt, 0);
+	if (param_count != survive_optimizer_get_parameters_count(opt)) {
+		fprintf(stderr, "%s has %d parameters; expected %d\n", fn, param_count,
+				survive_optimizer_get_parameters_count(opt));
+		fclose(f);
+		free(opt->parameters);
+		free(opt->mp_parameters_info);
+		free(opt->parameters_info);
+		free(opt->measurements);
+		free(opt->sos);
+		free(opt);
+		return 0;
+	}
 
 	for (int i = 0; i < survive_optimizer_get_parameters_count(opt); i++) {
 		struct mp_par_struct *info = &opt->mp_parameters_info[i];
@@ -1556,10 +1944,12 @@ survive_optimizer *survive_optimizer_load(const char *fn) {
 	}
 
 	read_count = fscanf(f, "\n");
-	read_count = fscanf(f, "measurementsCnt %lu\n", &opt->measurementsCnt);
+	size_t measurementsCnt = 0;
+	read_count = fscanf(f, "measurementsCnt %lu\n", &measurementsCnt);
 	read_count = fscanf(f, "\t#<lh> <axis> <sensor_idx> <object_idx> <value> <variance>\n");
-	for (int i = 0; i < opt->measurementsCnt; i++) {
-		survive_optimizer_measurement *meas = &opt->measurements[i];
+	for (int i = 0; i < measurementsCnt; i++) {
+		survive_optimizer_measurement *meas =
+			survive_optimizer_emplace_meas(opt, survive_optimizer_measurement_type_light);
 		read_count = fscanf(f, "\t%hhu", &meas->light.lh);
 		read_count = fscanf(f, " %hhu", &meas->light.axis);
 		read_count = fscanf(f, " %hhu", &meas->light.sensor_idx);
@@ -1588,7 +1978,10 @@ survive_optimizer *survive_optimizer_load(const char *fn) {
 			fclose(fp);
 		}
 	}
-	opt->sos[0] = so;
+	// Only the first object's name is serialized; multi object problems share its configuration
+	for (int i = 0; i < opt->poseLength; i++) {
+		opt->sos[i] = so;
+	}
 
 	return opt;
 }
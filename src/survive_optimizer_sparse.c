@@ -0,0 +1,874 @@
+#include "survive_optimizer_sparse.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define POSE_SIZE 7
+
+// Lambda is rescaled every step; once it gets this large the steps are too small to matter
+#define SPARSE_LM_MAX_LAMBDA 1e32
+
+typedef struct sparse_pose_block {
+	bool active[POSE_SIZE];
+	bool singular[POSE_SIZE];
+
+	// Only rows in [row_start, row_end) can have entries in this block's columns
+	size_t row_start, row_end;
+	FLT *jac; // POSE_SIZE columns of row_end - row_start rows
+
+	FLT U[POSE_SIZE * POSE_SIZE], L[POSE_SIZE * POSE_SIZE];
+	FLT g[POSE_SIZE], u[POSE_SIZE];
+
+	// W = J_pose^T J_global and Y = U^-1 W; POSE_SIZE x global_cnt, row major. Only the global columns in w_cols are
+	// ever non zero.
+	FLT *W, *Y;
+	int *w_cols;
+	size_t w_col_cnt;
+} sparse_pose_block;
+
+typedef struct sparse_lm {
+	survive_optimizer *optimizer;
+	mp_func funct;
+	int m, npar;
+	const mp_par *pars;
+	int nfev;
+
+	size_t pose_cnt;
+	sparse_pose_block *blocks;
+	int *row_block; // Pose block each row touches, or -1
+
+	// Every free parameter which isn't part of a pose; lighthouses, calibration, scale, corrections
+	size_t global_cnt;
+	int *global_idx;
+	FLT *global_jac; // global_cnt columns of m rows
+
+	FLT **derivs;
+
+	// Non zero global columns of each row; rebuilt every time the jacobian is
+	size_t *row_nz_start;
+	int *row_nz;
+	size_t row_nz_size;
+
+	FLT *V, *S, *g_global, *rhs;
+	bool *singular_global;
+
+	FLT *diag; // Marquardt scaling; npar, only ever grows like mpfit's
+	FLT *step, *Jh;
+} sparse_lm;
+
+static void *sparse_calloc(size_t num, size_t size) { return SV_CALLOC_N(num ? num : 1, size); }
+
+/**
+ * In place Cholesky factorization of the symmetric, row major n x n matrix A into its lower triangle.
+ *
+ * Without 'singular' any non positive pivot fails the factorization. With it, pivots at or below tol^2 * max(diag) are
+ * flagged as rank deficient and their row and column are decoupled, which is how mpfit's covariance treats them.
+ */
+static bool cholesky_factor(FLT *A, size_t n, FLT tol, bool *singular) {
+	FLT max_diag = 0;
+	for (size_t i = 0; i < n; i++) {
+		if (A[i * n + i] > max_diag)
+			max_diag = A[i * n + i];
+	}
+	FLT threshold = tol * tol * max_diag;
+
+	for (size_t j = 0; j < n; j++) {
+		FLT d = A[j * n + j];
+		for (size_t k = 0; k < j; k++)
+			d -= A[j * n + k] * A[j * n + k];
+
+		bool rank_deficient = !(d > threshold);
+		if (singular)
+			singular[j] = rank_deficient;
+		if (rank_deficient) {
+			if (singular == 0)
+				return false;
+			for (size_t k = 0; k < j; k++)
+				A[j * n + k] = 0;
+			A[j * n + j] = 1;
+			for (size_t i = j + 1; i < n; i++)
+				A[i * n + j] = 0;
+			continue;
+		}
+
+		FLT l = FLT_SQRT(d);
+		A[j * n + j] = l;
+		for (size_t i = j + 1; i < n; i++) {
+			FLT v = A[i * n + j];
+			for (size_t k = 0; k < j; k++)
+				v -= A[i * n + k] * A[j * n + k];
+			A[i * n + j] = v / l;
+		}
+	}
+	return true;
+}
+
+// Solves L L^T x = x in place; rank deficient entries come back as 0
+static void cholesky_solve(const FLT *L, size_t n, const bool *singular, FLT *x) {
+	for (size_t i = 0; i < n; i++) {
+		if (singular && singular[i]) {
+			x[i] = 0;
+			continue;
+		}
+		FLT v = x[i];
+		for (size_t k = 0; k < i; k++)
+			v -= L[i * n + k] * x[k];
+		x[i] = v / L[i * n + i];
+	}
+	for (size_t i = n; i-- > 0;) {
+		if (singular && singular[i]) {
+			x[i] = 0;
+			continue;
+		}
+		FLT v = x[i];
+		for (size_t k = i + 1; k < n; k++)
+			v -= L[k * n + i] * x[k];
+		x[i] = v / L[i * n + i];
+	}
+}
+
+static int measurement_pose(const survive_optimizer *optimizer, const survive_optimizer_measurement *meas) {
+	// This has to agree with which pose columns mpfunc writes for each measurement type
+	switch (meas->meas_type) {
+	case survive_optimizer_measurement_type_light:
+		return meas->light.object;
+	case survive_optimizer_measurement_type_object_accel:
+		return meas->pose_acc.object;
+	case survive_optimizer_measurement_type_fixed_rotation:
+		return meas->fixed_rotation.obj < optimizer->poseLength ? meas->fixed_rotation.obj : -1;
+	case survive_optimizer_measurement_type_parameters_bias: {
+		int idx = meas->parameter_bias.parameter_index;
+		return idx >= 0 && idx < optimizer->poseLength * POSE_SIZE ? idx / POSE_SIZE : -1;
+	}
+	default:
+		return -1;
+	}
+}
+
+bool survive_optimizer_sparse_lm_supported(const survive_optimizer *optimizer, const mp_result *result) {
+	if (result && result->jac)
+		return false;
+
+	int npar = survive_optimizer_get_parameters_count(optimizer);
+	for (int i = 0; i < npar; i++) {
+		if (!optimizer->mp_parameters_info[i].fixed && optimizer->mp_parameters_info[i].side != 3)
+			return false;
+	}
+	return true;
+}
+
+static void sparse_lm_init(sparse_lm *lm) {
+	survive_optimizer *optimizer = lm->optimizer;
+	int m = lm->m, npar = lm->npar;
+
+	lm->pose_cnt = optimizer->poseLength;
+	lm->blocks = sparse_calloc(lm->pose_cnt, sizeof(sparse_pose_block));
+	lm->row_block = sparse_calloc(m, sizeof(int));
+	lm->derivs = sparse_calloc(npar, sizeof(FLT *));
+	lm->diag = sparse_calloc(npar, sizeof(FLT));
+	lm->step = sparse_calloc(npar, sizeof(FLT));
+	lm->Jh = sparse_calloc(m, sizeof(FLT));
+
+	for (size_t i = 0; i < lm->pose_cnt; i++) {
+		lm->blocks[i].row_start = m;
+		lm->blocks[i].row_end = 0;
+	}
+
+	size_t row = 0;
+	for (size_t i = 0; i < optimizer->measurementsCnt; i++) {
+		const survive_optimizer_measurement *meas = &optimizer->measurements[i];
+		int pose = measurement_pose(optimizer, meas);
+		assert(pose < (int)lm->pose_cnt);
+		for (size_t j = 0; j < meas->size; j++)
+			lm->row_block[row + j] = pose;
+
+		if (pose >= 0) {
+			sparse_pose_block *block = &lm->blocks[pose];
+			if (block->row_start > row)
+				block->row_start = row;
+			if (block->row_end < row + meas->size)
+				block->row_end = row + meas->size;
+		}
+		row += meas->size;
+	}
+	assert(row == m);
+
+	for (int i = 0; i < npar; i++) {
+		if (!lm->pars[i].fixed && i >= lm->pose_cnt * POSE_SIZE)
+			lm->global_cnt++;
+	}
+	size_t ng = lm->global_cnt;
+	lm->global_idx = sparse_calloc(ng, sizeof(int));
+	lm->global_jac = sparse_calloc(ng * m, sizeof(FLT));
+	for (int i = lm->pose_cnt * POSE_SIZE, k = 0; i < npar; i++) {
+		if (!lm->pars[i].fixed) {
+			lm->derivs[i] = lm->global_jac + (size_t)k * m;
+			lm->global_idx[k++] = i;
+		}
+	}
+
+	for (size_t i = 0; i < lm->pose_cnt; i++) {
+		sparse_pose_block *block = &lm->blocks[i];
+		size_t rows = block->row_end > block->row_start ? block->row_end - block->row_start : 0;
+		block->jac = sparse_calloc(POSE_SIZE * rows, sizeof(FLT));
+		block->W = sparse_calloc(POSE_SIZE * ng, sizeof(FLT));
+		block->Y = sparse_calloc(POSE_SIZE * ng, sizeof(FLT));
+		block->w_cols = sparse_calloc(ng, sizeof(int));
+		for (int j = 0; j < POSE_SIZE; j++) {
+			block->active[j] = !lm->pars[i * POSE_SIZE + j].fixed;
+			// mpfunc indexes columns by absolute row; offset the compact column so rows outside of this block's range
+			// are never addressed.
+			if (block->active[j] && rows)
+				lm->derivs[i * POSE_SIZE + j] = block->jac + j * rows - block->row_start;
+		}
+	}
+
+	lm->row_nz_start = sparse_calloc(m + 1, sizeof(size_t));
+	lm->V = sparse_calloc(ng * ng, sizeof(FLT));
+	lm->S = sparse_calloc(ng * ng, sizeof(FLT));
+	lm->g_global = sparse_calloc(ng, sizeof(FLT));
+	lm->rhs = sparse_calloc(ng, sizeof(FLT));
+	lm->singular_global = sparse_calloc(ng, sizeof(bool));
+}
+
+static void sparse_lm_free(sparse_lm *lm) {
+	for (size_t i = 0; i < lm->pose_cnt; i++) {
+		free(lm->blocks[i].jac);
+		free(lm->blocks[i].W);
+		free(lm->blocks[i].Y);
+		free(lm->blocks[i].w_cols);
+	}
+	free(lm->blocks);
+	free(lm->row_block);
+	free(lm->derivs);
+	free(lm->diag);
+	free(lm->step);
+	free(lm->Jh);
+	free(lm->global_idx);
+	free(lm->global_jac);
+	free(lm->row_nz_start);
+	free(lm->row_nz);
+	free(lm->V);
+	free(lm->S);
+	free(lm->g_global);
+	free(lm->rhs);
+	free(lm->singular_global);
+}
+
+static inline FLT block_jac(const sparse_pose_block *block, int j, size_t row) {
+	return block->jac[j * (block->row_end - block->row_start) + row - block->row_start];
+}
+
+// Returns the sum of squares of the deviates, or NAN if any of them isn't finite
+static FLT sparse_lm_evaluate(sparse_lm *lm, FLT *x, FLT *fvec, bool with_jacobian) {
+	memset(fvec, 0, lm->m * sizeof(FLT));
+	if (with_jacobian) {
+		for (size_t i = 0; i < lm->pose_cnt; i++) {
+			sparse_pose_block *block = &lm->blocks[i];
+			if (block->row_end > block->row_start)
+				memset(block->jac, 0, POSE_SIZE * (block->row_end - block->row_start) * sizeof(FLT));
+		}
+		memset(lm->global_jac, 0, lm->global_cnt * lm->m * sizeof(FLT));
+	}
+
+	lm->funct(lm->m, lm->npar, x, fvec, with_jacobian ? lm->derivs : 0, lm->optimizer);
+	lm->nfev++;
+
+	FLT norm = 0;
+	for (int i = 0; i < lm->m; i++)
+		norm += fvec[i] * fvec[i];
+	return isfinite(norm) ? norm : NAN;
+}
+
+/**
+ * Builds the pieces of the undamped normal equations J^T J = [U W; W^T V] and the gradient J^T f from the last
+ * jacobian evaluation.
+ */
+static void sparse_lm_build(sparse_lm *lm, const FLT *fvec) {
+	size_t m = lm->m, ng = lm->global_cnt;
+
+	memset(lm->row_nz_start, 0, (m + 1) * sizeof(size_t));
+	for (size_t k = 0; k < ng; k++) {
+		const FLT *col = lm->global_jac + k * m;
+		for (size_t r = 0; r < m; r++)
+			lm->row_nz_start[r + 1] += col[r] != 0;
+	}
+	for (size_t r = 0; r < m; r++)
+		lm->row_nz_start[r + 1] += lm->row_nz_start[r];
+	if (lm->row_nz_start[m] > lm->row_nz_size) {
+		lm->row_nz_size = lm->row_nz_start[m];
+		lm->row_nz = SV_REALLOC(lm->row_nz, lm->row_nz_size * sizeof(int));
+	}
+	// Fill column by column so each row's list comes out sorted; row_nz_start[r] is used as the fill cursor and ends
+	// up at the start of row r + 1, so shift it back afterwards.
+	for (size_t k = 0; k < ng; k++) {
+		const FLT *col = lm->global_jac + k * m;
+		for (size_t r = 0; r < m; r++) {
+			if (col[r] != 0)
+				lm->row_nz[lm->row_nz_start[r]++] = k;
+		}
+	}
+	for (size_t r = m; r > 0; r--)
+		lm->row_nz_start[r] = lm->row_nz_start[r - 1];
+	lm->row_nz_start[0] = 0;
+
+	memset(lm->V, 0, ng * ng * sizeof(FLT));
+	memset(lm->g_global, 0, ng * sizeof(FLT));
+	for (size_t r = 0; r < m; r++) {
+		for (size_t a = lm->row_nz_start[r]; a < lm->row_nz_start[r + 1]; a++) {
+			int ka = lm->row_nz[a];
+			FLT ja = lm->global_jac[ka * m + r];
+			lm->g_global[ka] += ja * fvec[r];
+			for (size_t b = a; b < lm->row_nz_start[r + 1]; b++) {
+				int kb = lm->row_nz[b];
+				lm->V[ka * ng + kb] += ja * lm->global_jac[kb * m + r];
+			}
+		}
+	}
+	for (size_t a = 0; a < ng; a++) {
+		for (size_t b = a + 1; b < ng; b++)
+			lm->V[b * ng + a] = lm->V[a * ng + b];
+	}
+
+	for (size_t i = 0; i < lm->pose_cnt; i++) {
+		sparse_pose_block *block = &lm->blocks[i];
+		memset(block->U, 0, sizeof(block->U));
+		memset(block->g, 0, sizeof(block->g));
+		memset(block->W, 0, POSE_SIZE * ng * sizeof(FLT));
+
+		for (size_t r = block->row_start; r < block->row_end; r++) {
+			if (lm->row_block[r] != i)
+				continue;
+
+			FLT jp[POSE_SIZE] = {0};
+			for (int a = 0; a < POSE_SIZE; a++) {
+				if (block->active[a])
+					jp[a] = block_jac(block, a, r);
+			}
+
+			for (int a = 0; a < POSE_SIZE; a++) {
+				if (jp[a] == 0)
+					continue;
+				block->g[a] += jp[a] * fvec[r];
+				for (int b = a; b < POSE_SIZE; b++)
+					block->U[a * POSE_SIZE + b] += jp[a] * jp[b];
+				for (size_t nz = lm->row_nz_start[r]; nz < lm->row_nz_start[r + 1]; nz++) {
+					int k = lm->row_nz[nz];
+					block->W[a * ng + k] += jp[a] * lm->global_jac[k * m + r];
+				}
+			}
+		}
+		for (int a = 0; a < POSE_SIZE; a++) {
+			for (int b = a + 1; b < POSE_SIZE; b++)
+				block->U[b * POSE_SIZE + a] = block->U[a * POSE_SIZE + b];
+		}
+
+		block->w_col_cnt = 0;
+		for (size_t k = 0; k < ng; k++) {
+			bool used = false;
+			for (int a = 0; a < POSE_SIZE && !used; a++)
+				used = block->W[a * ng + k] != 0;
+			if (used)
+				block->w_cols[block->w_col_cnt++] = k;
+		}
+	}
+}
+
+static FLT *diag_for_pose(sparse_lm *lm, size_t pose) { return lm->diag + pose * POSE_SIZE; }
+static FLT *diag_for_global(sparse_lm *lm, size_t k) { return lm->diag + lm->global_idx[k]; }
+
+static void sparse_lm_update_diag(sparse_lm *lm) {
+	for (size_t i = 0; i < lm->pose_cnt; i++) {
+		for (int a = 0; a < POSE_SIZE; a++) {
+			FLT *d = diag_for_pose(lm, i) + a;
+			if (lm->blocks[i].U[a * POSE_SIZE + a] > *d)
+				*d = lm->blocks[i].U[a * POSE_SIZE + a];
+		}
+	}
+	for (size_t k = 0; k < lm->global_cnt; k++) {
+		FLT *d = diag_for_global(lm, k);
+		if (lm->V[k * lm->global_cnt + k] > *d)
+			*d = lm->V[k * lm->global_cnt + k];
+	}
+}
+
+static inline FLT damping(const FLT *diag, FLT lambda) { return lambda * (*diag > 0 ? *diag : 1); }
+
+/**
+ * Factors U + damping for every pose block and computes Y = U^-1 W and u = U^-1 g with it. Inactive pose parameters
+ * get an identity row and column so they come out of every solve as 0.
+ */
+static bool sparse_lm_factor_blocks(sparse_lm *lm, FLT lambda, FLT covtol, bool covariance) {
+	size_t ng = lm->global_cnt;
+	for (size_t i = 0; i < lm->pose_cnt; i++) {
+		sparse_pose_block *block = &lm->blocks[i];
+		memcpy(block->L, block->U, sizeof(block->L));
+		for (int a = 0; a < POSE_SIZE; a++) {
+			if (!block->active[a]) {
+				for (int b = 0; b < POSE_SIZE; b++)
+					block->L[a * POSE_SIZE + b] = block->L[b * POSE_SIZE + a] = 0;
+				block->L[a * POSE_SIZE + a] = 1;
+			} else if (!covariance) {
+				block->L[a * POSE_SIZE + a] += damping(diag_for_pose(lm, i) + a, lambda);
+			}
+		}
+
+		if (!cholesky_factor(block->L, POSE_SIZE, covtol, covariance ? block->singular : 0))
+			return false;
+		const bool *singular = covariance ? block->singular : 0;
+
+		for (int a = 0; a < POSE_SIZE; a++)
+			block->u[a] = block->active[a] ? block->g[a] : 0;
+		cholesky_solve(block->L, POSE_SIZE, singular, block->u);
+
+		for (size_t c = 0; c < block->w_col_cnt; c++) {
+			int k = block->w_cols[c];
+			FLT col[POSE_SIZE];
+			for (int a = 0; a < POSE_SIZE; a++)
+				col[a] = block->W[a * ng + k];
+			cholesky_solve(block->L, POSE_SIZE, singular, col);
+			for (int a = 0; a < POSE_SIZE; a++)
+				block->Y[a * ng + k] = col[a];
+		}
+	}
+	return true;
+}
+
+// S = V - sum(W_i^T U_i^-1 W_i), plus damping on the diagonal
+static void sparse_lm_schur_complement(sparse_lm *lm, FLT lambda, bool covariance) {
+	size_t ng = lm->global_cnt;
+	memcpy(lm->S, lm->V, ng * ng * sizeof(FLT));
+	for (size_t k = 0; k < ng; k++) {
+		lm->rhs[k] = -lm->g_global[k];
+		if (!covariance)
+			lm->S[k * ng + k] += damping(diag_for_global(lm, k), lambda);
+	}
+
+	for (size_t i = 0; i < lm->pose_cnt; i++) {
+		const sparse_pose_block *block = &lm->blocks[i];
+		for (size_t ca = 0; ca < block->w_col_cnt; ca++) {
+			int ka = block->w_cols[ca];
+			for (int t = 0; t < POSE_SIZE; t++)
+				lm->rhs[ka] += block->W[t * ng + ka] * block->u[t];
+
+			for (size_t cb = ca; cb < block->w_col_cnt; cb++) {
+				int kb = block->w_cols[cb];
+				FLT v = 0;
+				for (int t = 0; t < POSE_SIZE; t++)
+					v += block->W[t * ng + ka] * block->Y[t * ng + kb];
+				lm->S[ka * ng + kb] -= v;
+				if (ka != kb)
+					lm->S[kb * ng + ka] -= v;
+			}
+		}
+	}
+}
+
+/**
+ * Solves (J^T J + lambda diag) step = -J^T f by eliminating the pose blocks. Fails if the damped system isn't
+ * positive definite; the caller should bump lambda and try again.
+ */
+static bool sparse_lm_solve(sparse_lm *lm, FLT lambda) {
+	size_t ng = lm->global_cnt;
+	if (!sparse_lm_factor_blocks(lm, lambda, 0, false))
+		return false;
+
+	sparse_lm_schur_complement(lm, lambda, false);
+	if (!cholesky_factor(lm->S, ng, 0, 0))
+		return false;
+	cholesky_solve(lm->S, ng, 0, lm->rhs);
+
+	memset(lm->step, 0, lm->npar * sizeof(FLT));
+	for (size_t k = 0; k < ng; k++)
+		lm->step[lm->global_idx[k]] = lm->rhs[k];
+
+	for (size_t i = 0; i < lm->pose_cnt; i++) {
+		const sparse_pose_block *block = &lm->blocks[i];
+		FLT *step = lm->step + i * POSE_SIZE;
+		for (int a = 0; a < POSE_SIZE; a++) {
+			if (!block->active[a])
+				continue;
+			FLT v = -block->u[a];
+			for (size_t c = 0; c < block->w_col_cnt; c++) {
+				int k = block->w_cols[c];
+				v -= block->Y[a * ng + k] * lm->rhs[k];
+			}
+			step[a] = v;
+		}
+	}
+	return true;
+}
+
+// Decrease of the linear model, |f|^2 - |f + J step|^2
+static FLT sparse_lm_predicted_reduction(sparse_lm *lm, const FLT *fvec) {
+	size_t m = lm->m;
+	memset(lm->Jh, 0, m * sizeof(FLT));
+	for (size_t i = 0; i < lm->pose_cnt; i++) {
+		const sparse_pose_block *block = &lm->blocks[i];
+		const FLT *step = lm->step + i * POSE_SIZE;
+		for (int a = 0; a < POSE_SIZE; a++) {
+			if (!block->active[a] || step[a] == 0)
+				continue;
+			for (size_t r = block->row_start; r < block->row_end; r++)
+				lm->Jh[r] += block_jac(block, a, r) * step[a];
+		}
+	}
+	for (size_t k = 0; k < lm->global_cnt; k++) {
+		FLT s = lm->step[lm->global_idx[k]];
+		if (s == 0)
+			continue;
+		const FLT *col = lm->global_jac + k * m;
+		for (size_t r = 0; r < m; r++)
+			lm->Jh[r] += col[r] * s;
+	}
+
+	FLT rtn = 0;
+	for (size_t r = 0; r < m; r++)
+		rtn -= lm->Jh[r] * (2 * fvec[r] + lm->Jh[r]);
+	return rtn;
+}
+
+// max |J_j^T f| / (|J_j| |f|) over the free parameters; the cosine mpfit's gtol test uses
+static FLT sparse_lm_gradient_norm(sparse_lm *lm, FLT fnorm) {
+	FLT rtn = 0;
+	for (size_t i = 0; i < lm->pose_cnt; i++) {
+		const sparse_pose_block *block = &lm->blocks[i];
+		for (int a = 0; a < POSE_SIZE; a++) {
+			FLT jnorm = block->U[a * POSE_SIZE + a];
+			if (block->active[a] && jnorm > 0)
+				rtn = linmath_max(rtn, fabs(block->g[a]) / FLT_SQRT(jnorm * fnorm));
+		}
+	}
+	for (size_t k = 0; k < lm->global_cnt; k++) {
+		FLT jnorm = lm->V[k * lm->global_cnt + k];
+		if (jnorm > 0)
+			rtn = linmath_max(rtn, fabs(lm->g_global[k]) / FLT_SQRT(jnorm * fnorm));
+	}
+	return rtn;
+}
+
+static FLT scaled_norm(const sparse_lm *lm, const FLT *v) {
+	FLT rtn = 0;
+	for (int i = 0; i < lm->npar; i++) {
+		if (!lm->pars[i].fixed)
+			rtn += lm->diag[i] * v[i] * v[i];
+	}
+	return FLT_SQRT(rtn);
+}
+
+/**
+ * Fills covar_free with (J^T J)^-1 over the free parameters using the block inverse
+ *
+ *   cov_global = S^-1
+ *   cov_i,global = -U_i^-1 W_i S^-1
+ *   cov_i,j = delta_ij U_i^-1 + U_i^-1 W_i S^-1 W_j^T U_j^-1
+ *
+ * Rank deficient directions get zero rows and columns, as with mpfit.
+ */
+static void sparse_lm_covariance(sparse_lm *lm, FLT covtol, int nfree, FLT *covar_free) {
+	size_t ng = lm->global_cnt;
+	memset(covar_free, 0, (size_t)nfree * nfree * sizeof(FLT));
+
+	sparse_lm_factor_blocks(lm, 0, covtol, true);
+	sparse_lm_schur_complement(lm, 0, true);
+	cholesky_factor(lm->S, ng, covtol, lm->singular_global);
+
+	int *free_idx = sparse_calloc(lm->npar, sizeof(int));
+	for (int i = 0, f = 0; i < lm->npar; i++)
+		free_idx[i] = lm->pars[i].fixed ? -1 : f++;
+
+	FLT *S_inv = sparse_calloc(ng * ng, sizeof(FLT));
+	FLT *col = sparse_calloc(ng, sizeof(FLT));
+	for (size_t k = 0; k < ng; k++) {
+		memset(col, 0, ng * sizeof(FLT));
+		col[k] = 1;
+		cholesky_solve(lm->S, ng, lm->singular_global, col);
+		for (size_t j = 0; j < ng; j++)
+			S_inv[j * ng + k] = col[j];
+	}
+	for (size_t a = 0; a < ng; a++) {
+		for (size_t b = 0; b < ng; b++)
+			covar_free[free_idx[lm->global_idx[a]] * nfree + free_idx[lm->global_idx[b]]] = S_inv[a * ng + b];
+	}
+
+	// Z_i = U_i^-1 W_i S^-1
+	FLT *Z = sparse_calloc(lm->pose_cnt * POSE_SIZE * ng, sizeof(FLT));
+	for (size_t i = 0; i < lm->pose_cnt; i++) {
+		const sparse_pose_block *block = &lm->blocks[i];
+		FLT *Zi = Z + i * POSE_SIZE * ng;
+		for (int t = 0; t < POSE_SIZE; t++) {
+			for (size_t c = 0; c < block->w_col_cnt; c++) {
+				int a = block->w_cols[c];
+				FLT y = block->Y[t * ng + a];
+				for (size_t k = 0; k < ng; k++)
+					Zi[t * ng + k] += y * S_inv[a * ng + k];
+			}
+		}
+	}
+
+	for (size_t i = 0; i < lm->pose_cnt; i++) {
+		const sparse_pose_block *block = &lm->blocks[i];
+		const FLT *Zi = Z + i * POSE_SIZE * ng;
+
+		FLT U_inv[POSE_SIZE * POSE_SIZE];
+		for (int s = 0; s < POSE_SIZE; s++) {
+			FLT e[POSE_SIZE] = {0};
+			e[s] = 1;
+			cholesky_solve(block->L, POSE_SIZE, block->singular, e);
+			for (int t = 0; t < POSE_SIZE; t++)
+				U_inv[t * POSE_SIZE + s] = e[t];
+		}
+
+		for (int t = 0; t < POSE_SIZE; t++) {
+			int ft = free_idx[i * POSE_SIZE + t];
+			if (ft < 0)
+				continue;
+
+			for (size_t k = 0; k < ng; k++) {
+				int fk = free_idx[lm->global_idx[k]];
+				covar_free[ft * nfree + fk] = covar_free[fk * nfree + ft] = -Zi[t * ng + k];
+			}
+
+			for (size_t j = 0; j < lm->pose_cnt; j++) {
+				const sparse_pose_block *other = &lm->blocks[j];
+				for (int s = 0; s < POSE_SIZE; s++) {
+					int fs = free_idx[j * POSE_SIZE + s];
+					if (fs < 0)
+						continue;
+
+					FLT v = i == j ? U_inv[t * POSE_SIZE + s] : 0;
+					for (size_t c = 0; c < other->w_col_cnt; c++) {
+						int a = other->w_cols[c];
+						v += Zi[t * ng + a] * other->Y[s * ng + a];
+					}
+					covar_free[ft * nfree + fs] = v;
+				}
+			}
+		}
+	}
+
+	free(Z);
+	free(col);
+	free(S_inv);
+	free(free_idx);
+}
+
+int survive_optimizer_sparse_lm(mp_func funct, int m, int npar, FLT *xall, mp_par *pars, mp_config *config,
+								survive_optimizer *optimizer, mp_result *result) {
+	mp_config conf = {.ftol = 1e-10, .xtol = 1e-10, .gtol = 1e-10, .maxiter = 200, .covtol = 1e-14, .nprint = 1};
+	if (config) {
+		if (config->ftol > 0)
+			conf.ftol = config->ftol;
+		if (config->xtol > 0)
+			conf.xtol = config->xtol;
+		if (config->gtol > 0)
+			conf.gtol = config->gtol;
+		if (config->maxiter > 0)
+			conf.maxiter = config->maxiter;
+		if (config->maxiter == MP_NO_ITER)
+			conf.maxiter = 0;
+		if (config->covtol > 0)
+			conf.covtol = config->covtol;
+		if (config->nprint >= 0)
+			conf.nprint = config->nprint;
+		conf.normtol = config->normtol;
+		conf.maxfev = config->maxfev;
+	}
+
+	if (funct == 0)
+		return MP_ERR_FUNC;
+	if (m <= 0 || xall == 0)
+		return MP_ERR_NPOINTS;
+
+	int nfree = 0;
+	for (int i = 0; i < npar; i++) {
+		if (pars[i].fixed)
+			continue;
+		nfree++;
+		if (pars[i].limited[0] && pars[i].limited[1] && pars[i].limits[0] >= pars[i].limits[1])
+			return MP_ERR_BOUNDS;
+		if ((pars[i].limited[0] && xall[i] < pars[i].limits[0]) || (pars[i].limited[1] && xall[i] > pars[i].limits[1]))
+			return MP_ERR_INITBOUNDS;
+	}
+	if (nfree == 0)
+		return MP_ERR_NFREE;
+	if (m < nfree)
+		return MP_ERR_DOF;
+
+	sparse_lm lm = {.optimizer = optimizer, .funct = funct, .m = m, .npar = npar, .pars = pars};
+	sparse_lm_init(&lm);
+
+	FLT *x = SV_MALLOC(npar * sizeof(FLT));
+	FLT *xnew = SV_MALLOC(npar * sizeof(FLT));
+	FLT *fvec = sparse_calloc(m, sizeof(FLT));
+	FLT *fvec_new = sparse_calloc(m, sizeof(FLT));
+	memcpy(x, xall, npar * sizeof(FLT));
+
+	int info = 0, iter = 1;
+	FLT fnorm = sparse_lm_evaluate(&lm, x, fvec, false);
+	FLT orignorm = fnorm;
+	if (isnan(fnorm))
+		info = MP_ERR_NAN;
+	if (conf.maxiter == 0)
+		info = MP_MAXITER;
+
+	FLT lambda = -1, nu = 2;
+	while (info == 0) {
+		sparse_lm_evaluate(&lm, x, fvec, true);
+		sparse_lm_build(&lm, fvec);
+		sparse_lm_update_diag(&lm);
+
+		if (lambda < 0) {
+			FLT max_diag = 0;
+			for (int i = 0; i < npar; i++)
+				max_diag = linmath_max(max_diag, lm.diag[i]);
+			lambda = 1e-3 * (max_diag > 0 ? max_diag : 1);
+		}
+
+		if (fnorm == 0 || sparse_lm_gradient_norm(&lm, fnorm) <= conf.gtol) {
+			info = MP_OK_DIR;
+			break;
+		}
+
+		FLT xnorm = scaled_norm(&lm, x);
+		bool accepted = false;
+		while (!accepted && info == 0) {
+			if (lambda > SPARSE_LM_MAX_LAMBDA) {
+				info = MP_XTOL;
+				break;
+			}
+			if (!sparse_lm_solve(&lm, lambda)) {
+				lambda *= nu;
+				nu *= 2;
+				continue;
+			}
+
+			// Project the step back onto the parameter limits
+			for (int i = 0; i < npar; i++) {
+				xnew[i] = x[i] + lm.step[i];
+				if (pars[i].fixed)
+					continue;
+				if (pars[i].limited[0] && xnew[i] < pars[i].limits[0])
+					xnew[i] = pars[i].limits[0];
+				if (pars[i].limited[1] && xnew[i] > pars[i].limits[1])
+					xnew[i] = pars[i].limits[1];
+				lm.step[i] = xnew[i] - x[i];
+			}
+
+			FLT pred = sparse_lm_predicted_reduction(&lm, fvec);
+			FLT hnorm = scaled_norm(&lm, lm.step);
+			FLT fnorm1 = sparse_lm_evaluate(&lm, xnew, fvec_new, false);
+
+			FLT actred = isnan(fnorm1) ? -1 : (fnorm - fnorm1) / fnorm;
+			FLT prered = pred / fnorm;
+			FLT ratio = pred > 0 && !isnan(fnorm1) ? (fnorm - fnorm1) / pred : 0;
+			FLT prior_fnorm = fnorm;
+
+			if (ratio >= 1e-4) {
+				accepted = true;
+				memcpy(x, xnew, npar * sizeof(FLT));
+				FLT *tmp = fvec;
+				fvec = fvec_new;
+				fvec_new = tmp;
+				fnorm = fnorm1;
+				iter++;
+
+				FLT r = 2 * ratio - 1;
+				lambda *= linmath_max(1. / 3., 1 - r * r * r);
+				nu = 2;
+			} else {
+				lambda *= nu;
+				nu *= 2;
+			}
+
+			// Same tests, in the same order, as mpfit
+			bool chi_converged = fabs(actred) <= conf.ftol && prered <= conf.ftol && .5 * ratio <= 1;
+			if (chi_converged)
+				info = MP_OK_CHI;
+			if (!isnan(fnorm1) && linmath_max(prior_fnorm, fnorm1) < conf.normtol)
+				info = MP_OK_NORM;
+			if (hnorm <= conf.xtol * xnorm)
+				info = chi_converged ? MP_OK_BOTH : MP_OK_PAR;
+			if (info != 0)
+				break;
+
+			if ((conf.maxfev > 0 && lm.nfev >= conf.maxfev) || iter >= conf.maxiter)
+				info = MP_MAXITER;
+			if (fabs(actred) <= MP_MACHEP0 && prered <= MP_MACHEP0 && .5 * ratio <= 1)
+				info = MP_FTOL;
+			if (hnorm <= MP_MACHEP0 * xnorm)
+				info = MP_XTOL;
+		}
+	}
+
+	memcpy(xall, x, npar * sizeof(FLT));
+
+	bool wants_covariance = result && (result->covar || result->xerror || result->covar_free);
+	// Like mpfit, leave the optimizer evaluated at the final parameters
+	if (wants_covariance || (info > 0 && conf.nprint > 0)) {
+		sparse_lm_evaluate(&lm, xall, fvec, wants_covariance);
+	}
+
+	if (wants_covariance) {
+		sparse_lm_build(&lm, fvec);
+
+		FLT *covar_free = result->covar_free ? result->covar_free : sparse_calloc((size_t)nfree * nfree, sizeof(FLT));
+		sparse_lm_covariance(&lm, conf.covtol, nfree, covar_free);
+
+		int *ifree = sparse_calloc(nfree, sizeof(int));
+		for (int i = 0, j = 0; i < npar; i++) {
+			if (!pars[i].fixed)
+				ifree[j++] = i;
+		}
+		if (result->covar) {
+			memset(result->covar, 0, (size_t)npar * npar * sizeof(FLT));
+			for (int j = 0; j < nfree; j++) {
+				for (int i = 0; i < nfree; i++)
+					result->covar[ifree[j] * npar + ifree[i]] = covar_free[j * nfree + i];
+			}
+		}
+		if (result->xerror) {
+			memset(result->xerror, 0, npar * sizeof(FLT));
+			for (int j = 0; j < nfree; j++) {
+				FLT cc = covar_free[j * nfree + j];
+				if (cc > 0)
+					result->xerror[ifree[j]] = FLT_SQRT(cc);
+			}
+		}
+
+		free(ifree);
+		if (covar_free != result->covar_free)
+			free(covar_free);
+	}
+
+	if (result) {
+		int npegged = 0;
+		for (int i = 0; i < npar; i++) {
+			if ((pars[i].limited[0] && pars[i].limits[0] == xall[i]) ||
+				(pars[i].limited[1] && pars[i].limits[1] == xall[i]))
+				npegged++;
+		}
+
+		strcpy(result->version, MPFIT_VERSION);
+		result->bestnorm = fnorm;
+		result->orignorm = orignorm;
+		result->status = info;
+		result->niter = iter;
+		result->nfev = lm.nfev;
+		result->npar = npar;
+		result->nfree = nfree;
+		result->npegged = npegged;
+		result->nfunc = m;
+		if (result->resid)
+			memcpy(result->resid, fvec, m * sizeof(FLT));
+	}
+
+	free(x);
+	free(xnew);
+	free(fvec);
+	free(fvec_new);
+	sparse_lm_free(&lm);
+	return info;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "survive_optimizer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Sparse Levenberg-Marquardt backend for survive_optimizer problems.
+ *
+ * Every measurement touches at most one object pose, so J^T J has a block arrow shape: a 7x7 block per pose on the
+ * diagonal plus a dense border for everything else (lighthouses, calibration, scale, corrections). The normal
+ * equations are solved by eliminating the pose blocks with a Schur complement, which leaves a dense system the size of
+ * the non pose parameters. Cost and memory grow linearly with the number of poses instead of the O(m n^2) of mpfit's
+ * dense QR.
+ *
+ * Takes the same arguments and returns the same MP_* status codes as mpfit; 'funct' is called with 'optimizer' as its
+ * private data. result->covar_free, covar, xerror and resid are filled in when requested; jac is not.
+ */
+int survive_optimizer_sparse_lm(mp_func funct, int m, int npar, FLT *xall, mp_par *pars, mp_config *config,
+								survive_optimizer *optimizer, mp_result *result);
+
+/**
+ * The sparse backend needs analytic derivatives for every free parameter and doesn't fill in result->jac; returns
+ * false if the problem needs mpfit.
+ */
+bool survive_optimizer_sparse_lm_supported(const survive_optimizer *optimizer, const mp_result *result);
+
+#ifdef __cplusplus
+};
+#endif
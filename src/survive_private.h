@@ -1,5 +1,7 @@
 #pragma once
 
+#include "survive_name_index.h"
+
 struct SurviveExternalPose {
 	char name[32];
 	SurvivePose pose;
@@ -7,6 +9,13 @@ struct SurviveExternalPose {
 
 struct SurviveContext_private {
 	og_sema_t poll_sema;
+
+	bool sharded_pipeline;
+	og_mutex_t lh_lock;
+
+	og_mutex_t optimizer_pool_lock;
+	struct survive_optimizer_pool *optimizer_pool;
+
 	survive_run_time_fn runTimeFn;
 	void *runTimeFnUser;
 	double lastRunTime;
@@ -14,6 +23,29 @@ struct SurviveContext_private {
 	double callbackStatsTimeBetween;
 	double lastCallbackStats;
 
+	// Only allocated with --profile-stages
+	struct survive_profile *profile;
+
+	// Only opened with --smoothed-record
+	struct SurviveRecordingData *smoothed_recording;
+
+	// Only opened with --shm-publish
+	struct survive_shm_publisher *shm_publisher;
+
+	// ctx->objs by codename; kept in step by survive_add_object and survive_unlink_object
+	survive_name_index objects_by_name;
+
 	struct SurviveExternalPose ExternalPoses[16];
 	SurvivePose external2world;
-};
\ No newline at end of file
+};
+
+// Takes the object out of ctx->objs and the name index without freeing it; false if it wasn't there
+bool survive_unlink_object(SurviveContext *ctx, SurviveObject *obj);
+
+// Joins and frees the worker threads used for threaded optimizer evaluation, if any were started
+void survive_optimizer_free_thread_pool(SurviveContext *ctx);
+
+// Stage timing; see survive_profile.h
+struct survive_profile *survive_profile_create();
+void survive_profile_free(struct survive_profile *profile);
+void survive_profile_output_stats(SurviveContext *ctx);
@@ -4,6 +4,7 @@
 #include "survive_config.h"
 #include "survive_default_devices.h"
 #include "survive_recording.h"
+#include "survive_shm_publisher.h"
 #include <assert.h>
 #include <survive.h>
 
@@ -14,9 +15,14 @@
 #include "survive_str.h"
 
 #include "survive_private.h"
+#include "survive_profile.h"
 
 void survive_default_button_process(SurviveObject *so, enum SurviveInputEvent eventType, enum SurviveButton buttonId,
 									const enum SurviveAxis *axisIds, const SurviveAxisVal_t *axisValues) {
+	struct survive_shm_publisher *shm_publisher = so->ctx->private_members->shm_publisher;
+	if (shm_publisher) {
+		survive_shm_publisher_button(shm_publisher, so);
+	}
 }
 
 STATIC_CONFIG_ITEM(REPORT_IN_IMU, "report-in-imu", 'b', "Debug option to output poses in IMU space.", 0)
@@ -47,12 +53,22 @@ void survive_default_pose_process(SurviveObject *so, survive_long_timecode timec
 	so->OutPose = *pose;
 	so->OutPose_timecode = timecode;
 	survive_recording_raw_pose_process(so, timecode, pose);
+
+	struct survive_shm_publisher *shm_publisher = so->ctx->private_members->shm_publisher;
+	if (shm_publisher) {
+		survive_shm_publisher_pose(shm_publisher, so, timecode, pose);
+	}
 }
 void survive_default_velocity_process(SurviveObject *so, survive_long_timecode timecode,
 									  const SurviveVelocity *velocity) {
 	survive_recording_velocity_process(so, timecode, velocity);
 	so->velocity = *velocity;
 	so->velocity_timecode = timecode;
+
+	struct survive_shm_publisher *shm_publisher = so->ctx->private_members->shm_publisher;
+	if (shm_publisher) {
+		survive_shm_publisher_velocity(shm_publisher, so, timecode, velocity);
+	}
 }
 
 void survive_default_external_velocity_process(SurviveContext *ctx, const char *name, const SurviveVelocity *vel) {
@@ -187,6 +203,8 @@ void survive_default_ootx_received_process(struct SurviveContext *ctx, uint8_t b
 
 void survive_default_raw_lighthouse_pose_process(SurviveContext *ctx, uint8_t lighthouse,
 											 const SurvivePose *lighthouse_pose) {
+	// Posers of different objects land here from their own threads in sharded mode
+	survive_get_lh_lock(ctx);
 	bool notSet = ctx->bsd[lighthouse].PositionSet == 0;
 	if (lighthouse_pose) {
 		for (int i = 0; i < 3; i++)
@@ -239,6 +257,7 @@ void survive_default_raw_lighthouse_pose_process(SurviveContext *ctx, uint8_t li
 	SurvivePose external_pose = ctx->bsd[lighthouse].Pose;
 	external_pose.Pos[2] -= ctx->floor_offset;
 	calculate_external2world(ctx);
+	survive_release_lh_lock(ctx);
 
 	SURVIVE_INVOKE_HOOK(lighthouse_pose, ctx, lighthouse, &external_pose);
 }
@@ -378,13 +397,13 @@ void survive_default_imu_process(SurviveObject *so, int mask, const FLT *accelgy
 		.mag = {accelgyromag[6], accelgyromag[7], accelgyromag[8]},
 	};
 
-	SurviveSensorActivations_add_imu(&so->activations, &imu);
-
 	SurviveContext *ctx = so->ctx;
 
+	SURVIVE_PROFILE_STAGE(ctx, sensor_activations, SurviveSensorActivations_add_imu(&so->activations, &imu));
+
 	SV_VERBOSE(300, "%s %s %x (%7.3f): " Point6_format, survive_colorize(so->codename), survive_colorize("IMU"),
 			   timecode, longTimecode / 48000000., LINMATH_VEC3_EXPAND(imu.accel), LINMATH_VEC3_EXPAND(imu.gyro))
-	survive_kalman_tracker_integrate_imu(so->tracker, &imu);
+	SURVIVE_PROFILE_STAGE(ctx, kalman_imu, survive_kalman_tracker_integrate_imu(so->tracker, &imu));
 	SURVIVE_POSER_INVOKE(so, &imu);
 
 	survive_recording_imu_process(so, mask, accelgyromag, timecode, id);
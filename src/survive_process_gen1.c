@@ -2,6 +2,7 @@
 
 #include "ootx_decoder.h"
 #include "survive_kalman_tracker.h"
+#include "survive_profile.h"
 #include "survive_recording.h"
 
 #define TICKS_PER_ROTATION 400000
@@ -50,7 +51,8 @@ void survive_default_light_process(SurviveObject *so, int sensor_id, int acode,
 		};
 
 		if (sensor_id == -3)
-			SurviveSensorActivations_add_sync(&so->activations, &l.common);
+			SURVIVE_PROFILE_STAGE(ctx, sensor_activations,
+								  SurviveSensorActivations_add_sync(&so->activations, &l.common));
 
 		ootx_decoder_context *decoderContext = ctx->bsd[lh].ootx_data;
 		uint32_t ootxOffset = decoderContext ? decoderContext->offset : 0;
@@ -58,7 +60,7 @@ void survive_default_light_process(SurviveObject *so, int sensor_id, int acode,
 		SV_VERBOSE(600, "%s Sync    %8x %3d.%2d.%d %8u %u %d %d / %d", survive_colorize_codename(so),
 				   ctx->bsd[lh].BaseStationID, sensor_id, lh, acode & 1, timecode, length, acode & 2 > 0, ootxOffset,
 				   ootxTotalOffset);
-		survive_kalman_tracker_integrate_light(so->tracker, &l.common);
+		SURVIVE_PROFILE_STAGE(ctx, kalman_light, survive_kalman_tracker_integrate_light(so->tracker, &l.common));
 		SURVIVE_POSER_INVOKE(so, &l);
 		SURVIVE_INVOKE_HOOK_SO(light_pulse, so, sensor_id, acode, timecode, length_sec, lh);
 
@@ -90,6 +92,14 @@ void survive_default_lightcap_process(SurviveObject *so, const LightcapElement *
 	survive_notify_gen1(so, "Lightcap called");
 }
 
+void survive_default_lightcaps_process(SurviveObject *so, const LightcapElement *les, size_t cnt, uint8_t *decisions) {
+	for (size_t i = 0; i < cnt; i++) {
+		SURVIVE_INVOKE_HOOK_SO(lightcap, so, &les[i]);
+		if (decisions)
+			decisions[i] = SURVIVE_LIGHTCAP_FORWARDED;
+	}
+}
+
 void survive_default_angle_process(SurviveObject *so, int sensor_id, int acode, uint32_t timecode, FLT length,
 								   FLT angle, uint32_t lh) {
 	survive_notify_gen1(so, "Default angle called");
@@ -116,8 +126,10 @@ void survive_default_angle_process(SurviveObject *so, int sensor_id, int acode,
 	so->stats.hit_from_lhs[lh]++;
 	// Simulate the use of only one lighthouse in playback mode.
 	if (lh < ctx->activeLighthouses) {
-		if (SurviveSensorActivations_add(&so->activations, &l)) {
-			survive_kalman_tracker_integrate_light(so->tracker, &l.common);
+		bool accepted = false;
+		SURVIVE_PROFILE_STAGE(ctx, sensor_activations, accepted = SurviveSensorActivations_add(&so->activations, &l));
+		if (accepted) {
+			SURVIVE_PROFILE_STAGE(ctx, kalman_light, survive_kalman_tracker_integrate_light(so->tracker, &l.common));
 			so->stats.accepted_data[lh]++;
 			SURVIVE_POSER_INVOKE(so, &l);
 		} else {
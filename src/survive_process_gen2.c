@@ -3,7 +3,9 @@
 #include "survive_config.h"
 #include "survive_internal.h"
 #include "survive_kalman_tracker.h"
+#include "survive_profile.h"
 #include "survive_recording.h"
+#include "survive_seqlock.h"
 #include <assert.h>
 #include <math.h>
 #include <survive.h>
@@ -156,6 +158,12 @@ void survive_ootx_free_decoder_context(struct SurviveContext *ctx, int bsd_idx)
 }
 void survive_ootx_behavior(SurviveObject *so, int8_t bsd_idx, int8_t lh_version, int ootx) {
 	struct SurviveContext *ctx = so->ctx;
+	if (ctx->bsd[bsd_idx].OOTXChecked) {
+		return;
+	}
+
+	// The decoder belongs to the lighthouse, and a finished packet updates its calibration and pose
+	survive_get_lh_lock(ctx);
 	if (ctx->bsd[bsd_idx].OOTXChecked == false) {
 		ootx_decoder_context *decoderContext = ctx->bsd[bsd_idx].ootx_data;
 
@@ -185,11 +193,16 @@ void survive_ootx_behavior(SurviveObject *so, int8_t bsd_idx, int8_t lh_version,
 			}
 		}
 	}
+	survive_release_lh_lock(ctx);
 }
 
 SURVIVE_EXPORT void survive_default_sync_process(SurviveObject *so, survive_channel channel, survive_timecode timecode,
 												 bool ootx, bool gen) {
 	struct SurviveContext *ctx = so->ctx;
+
+	// Whatever was swept since the last sync goes out before this one is counted
+	survive_flush_sweep_angles(so);
+
 	int8_t bsd_idx = survive_get_bsd_idx(ctx, channel);
 	if (bsd_idx == -1) {
 		SV_WARN("Invalid channel requested(%d) for %s", channel, so->codename)
@@ -258,7 +271,10 @@ SURVIVE_EXPORT void survive_default_sync_process(SurviveObject *so, survive_chan
 							}};
 
 	if (bsd_idx < ctx->activeLighthouses) {
-		if (SurviveSensorActivations_add_gen2(&so->activations, &l) == false) {
+		bool accepted = false;
+		SURVIVE_PROFILE_STAGE(ctx, sensor_activations,
+							  accepted = SurviveSensorActivations_add_gen2(&so->activations, &l));
+		if (accepted == false) {
 			so->stats.rejected_data[bsd_idx]++;
 		} else {
 			so->stats.accepted_data[bsd_idx]++;
@@ -268,7 +284,7 @@ SURVIVE_EXPORT void survive_default_sync_process(SurviveObject *so, survive_chan
 	so->stats.hit_from_lhs[bsd_idx]++;
 
 	if (ctx->lh_version != -1) {
-		survive_kalman_tracker_integrate_light(so->tracker, &l.common);
+		SURVIVE_PROFILE_STAGE(ctx, kalman_light, survive_kalman_tracker_integrate_light(so->tracker, &l.common));
 		SURVIVE_POSER_INVOKE(so, &l);
 	}
 }
@@ -334,6 +350,8 @@ SURVIVE_EXPORT void survive_default_sweep_process(SurviveObject *so, survive_cha
 
 	survive_timecode last_sweep = so->last_sync_time[bsd_idx];
 	if (last_sweep == 0) {
+		// No sync to wait for; what was swept before it was lost shouldn't wait either
+		survive_flush_sweep_angles(so);
 		return;
 	}
 	assert(channel <= NUM_GEN2_LIGHTHOUSES);
@@ -361,6 +379,7 @@ SURVIVE_EXPORT void survive_default_sweep_process(SurviveObject *so, survive_cha
 		SV_VERBOSE(100, "Dropping light data ch %d sync: %fms rotations missed: %d (at %u)", channel,
 				   time_since_sync * 1000., rotations_since, timecode);
 		so->stats.dropped_light[bsd_idx]++;
+		survive_flush_sweep_angles(so);
 		return;
 	}
 
@@ -373,59 +392,142 @@ SURVIVE_EXPORT void survive_default_sweep_process(SurviveObject *so, survive_cha
 			   timecode);
 
 	FLT angle_for_axis[2] = {angle - 2. / 3. * LINMATHPI, angle - 4. / 3. * LINMATHPI};
-	int8_t plane = determine_plane(so, bsd_idx, angle);
+	int8_t plane = -1;
+	SURVIVE_PROFILE_STAGE(ctx, disambiguation, plane = determine_plane(so, bsd_idx, angle));
 	SV_DATA_LOG("time_since_sync[%d,%d,%d]", &time_since_sync, 1, channel, sensor_id, plane);
 
 	so->stats.hit_from_lhs[bsd_idx]++;
 
-	if (plane >= 0)
-		SURVIVE_INVOKE_HOOK_SO(sweep_angle, so, channel, sensor_id, timecode, plane, angle_for_axis[plane]);
+	if (plane < 0)
+		return;
+
+	so->pending_angles[so->pending_angle_cnt++] = (SurviveSweepAngle){.timecode = timecode,
+																	  .run_time = survive_run_time(ctx),
+																	  .angle = angle_for_axis[plane],
+																	  .channel = channel,
+																	  .sensor_id = sensor_id,
+																	  .plane = plane};
+
+	// The tracker integrates its saved light once it holds light-batch-size measurements. Handing the batch on no
+	// later than that keeps the update at the same place among the IMU samples as going angle by angle; otherwise it
+	// would land after them and the tracker would have to roll back and replay.
+	if (so->pending_angle_cnt == SURVIVE_SWEEP_ANGLE_BATCH_MAX ||
+		so->pending_angle_cnt >= survive_kalman_tracker_light_until_batch(so->tracker))
+		survive_flush_sweep_angles(so);
 }
 
-SURVIVE_EXPORT void survive_default_sweep_angle_process(SurviveObject *so, survive_channel channel, int sensor_id,
-														survive_timecode timecode, int8_t plane, FLT angle) {
-	struct SurviveContext *ctx = so->ctx;
-	int8_t bsd_idx = survive_get_bsd_idx(ctx, channel);
-	if (bsd_idx == -1) {
-		SV_WARN("Invalid channel requested(%d) for %s", channel, so->codename)
+void survive_flush_sweep_angles(SurviveObject *so) {
+	size_t cnt = so->pending_angle_cnt;
+	if (cnt == 0)
 		return;
-	}
 
-	PoserDataLightGen2 l = {
-		.common =
-			{
-				.hdr =
-					{
-						.pt = POSERDATA_LIGHT_GEN2,
-						.timecode = SurviveSensorActivations_long_timecode_light(&so->activations, timecode),
-					},
-				.sensor_id = sensor_id,
-				.angle = angle,
-				.lh = bsd_idx,
-			},
-		.plane = plane,
-		.sync = so->sync_count[bsd_idx]};
-
-	SV_VERBOSE(500, "%s %7.3f Sensor ch%2d.%02d.%d %+8.3fdeg", survive_colorize(so->codename), survive_run_time(ctx),
-			   channel, sensor_id, plane, angle / LINMATHPI * 180.);
+	so->pending_angle_cnt = 0;
+	SURVIVE_INVOKE_HOOK_SO(sweep_angle_batch, so, so->pending_angles, cnt);
+}
+
+/**
+ * Each stage runs over the whole batch before the next one starts. Batches end no later than a sync or the tracker's
+ * light-batch-size, the two points where the tracker integrates its saved light, so it updates at the same place in
+ * the data as going angle by angle. Sensor activations and posers do see the light after any IMU samples which came
+ * in while the batch was held.
+ */
+static void process_sweep_angles(SurviveObject *so, const SurviveSweepAngle *angles, size_t cnt) {
+	struct SurviveContext *ctx = so->ctx;
+	PoserDataLightGen2 ls[SURVIVE_SWEEP_ANGLE_BATCH_MAX];
+	bool accepted[SURVIVE_SWEEP_ANGLE_BATCH_MAX] = {0};
+	size_t l_cnt = 0;
+
+	for (size_t i = 0; i < cnt; i++) {
+		const SurviveSweepAngle *a = &angles[i];
+		int8_t bsd_idx = survive_get_bsd_idx(ctx, a->channel);
+		if (bsd_idx == -1) {
+			SV_WARN("Invalid channel requested(%d) for %s", a->channel, so->codename)
+			continue;
+		}
+
+		ls[l_cnt++] = (PoserDataLightGen2){
+			.common =
+				{
+					.hdr =
+						{
+							.pt = POSERDATA_LIGHT_GEN2,
+							.timecode = SurviveSensorActivations_long_timecode_light(&so->activations, a->timecode),
+						},
+					.sensor_id = a->sensor_id,
+					.angle = a->angle,
+					.lh = bsd_idx,
+				},
+			.plane = a->plane,
+			.sync = so->sync_count[bsd_idx]};
+
+		SV_VERBOSE(500, "%s %7.3f Sensor ch%2d.%02d.%d %+8.3fdeg", survive_colorize(so->codename),
+				   survive_run_time(ctx), a->channel, a->sensor_id, a->plane, a->angle / LINMATHPI * 180.);
+	}
 
 	// Simulate the use of only one lighthouse in playback mode.
-	if (bsd_idx < ctx->activeLighthouses) {
-		if (SurviveSensorActivations_add_gen2(&so->activations, &l) == false) {
-			so->stats.rejected_data[bsd_idx]++;
-		} else {
-			so->stats.accepted_data[bsd_idx]++;
-			survive_kalman_tracker_integrate_light(so->tracker, &l.common);
+	SURVIVE_PROFILE_STAGE(ctx, sensor_activations, {
+		for (size_t i = 0; i < l_cnt; i++) {
+			int lh = ls[i].common.lh;
+			if (lh >= ctx->activeLighthouses)
+				continue;
+
+			accepted[i] = SurviveSensorActivations_add_gen2(&so->activations, &ls[i]);
+			if (accepted[i]) {
+				so->stats.accepted_data[lh]++;
+			} else {
+				so->stats.rejected_data[lh]++;
+			}
 		}
+	});
+
+	SURVIVE_PROFILE_STAGE(ctx, kalman_light, {
+		for (size_t i = 0; i < l_cnt; i++) {
+			if (accepted[i])
+				survive_kalman_tracker_integrate_light(so->tracker, &ls[i].common);
+		}
+	});
+
+	survive_recording_sweep_angles_process(so, angles, cnt);
+
+	for (size_t i = 0; i < l_cnt; i++) {
+		SURVIVE_POSER_INVOKE(so, &ls[i]);
 	}
+}
 
-	survive_recording_sweep_angle_process(so, channel, sensor_id, timecode, plane, angle);
-	SURVIVE_POSER_INVOKE(so, &l);
+SURVIVE_EXPORT void survive_default_sweep_angle_process(SurviveObject *so, survive_channel channel, int sensor_id,
+														survive_timecode timecode, int8_t plane, FLT angle) {
+	SurviveSweepAngle a = {.timecode = timecode,
+						   .run_time = survive_run_time(so->ctx),
+						   .angle = angle,
+						   .channel = channel,
+						   .sensor_id = sensor_id,
+						   .plane = plane};
+	process_sweep_angles(so, &a, 1);
+}
+
+SURVIVE_EXPORT void survive_default_sweep_angle_batch_process(SurviveObject *so, const SurviveSweepAngle *angles,
+															  size_t cnt) {
+	// Whoever replaced sweep_angle still gets every angle, one call each
+	if (so->ctx->sweep_angleproc != survive_default_sweep_angle_process) {
+		for (size_t i = 0; i < cnt; i++) {
+			const SurviveSweepAngle *a = &angles[i];
+			SURVIVE_INVOKE_HOOK_SO(sweep_angle, so, a->channel, a->sensor_id, a->timecode, a->plane, a->angle);
+		}
+		return;
+	}
+
+	while (cnt > 0) {
+		size_t chunk = cnt < SURVIVE_SWEEP_ANGLE_BATCH_MAX ? cnt : SURVIVE_SWEEP_ANGLE_BATCH_MAX;
+		process_sweep_angles(so, angles, chunk);
+		angles += chunk;
+		cnt -= chunk;
+	}
 }
 
 SURVIVE_EXPORT void survive_default_gen_detected_process(SurviveObject *so, int lh_version) {
 	SurviveContext *ctx = so->ctx;
 
+	survive_get_lh_lock(ctx);
 	if (ctx->lh_version != -1) {
 		static bool seenWarning = false;
 		if (seenWarning == false) {
@@ -434,6 +536,7 @@ SURVIVE_EXPORT void survive_default_gen_detected_process(SurviveObject *so, int
 		}
 
 		ctx->lh_version = 3;
+		survive_release_lh_lock(ctx);
 		return;
 	}
 	assert(ctx->lh_version == -1);
@@ -449,10 +552,16 @@ SURVIVE_EXPORT void survive_default_gen_detected_process(SurviveObject *so, int
 
 	for (int i = 0; i < ctx->objs_ct; i++) {
 		// When the USB devices transition; they reset their clock or something -- so clear out old data.
-		SurviveSensorActivations_reset(&ctx->objs[i]->activations);
+		// Sharded, the other objects may be ingesting right now, so they clear their own.
+		if (ctx->objs[i] == so || !survive_is_sharded(ctx)) {
+			SurviveSensorActivations_reset(&ctx->objs[i]->activations);
+		} else {
+			SURVIVE_SEQ_STORE_RELEASE(&ctx->objs[i]->activations_reset_pending, 1);
+		}
 	}
 
 	ctx->lh_version = lh_version;
 	survive_configi(ctx, "configed-lighthouse-gen", SC_OVERRIDE | SC_SETCONFIG, lh_version + 1);
 	config_save(ctx);
+	survive_release_lh_lock(ctx);
 }
@@ -0,0 +1,161 @@
+#include "survive_profile.h"
+#include "os_generic.h"
+#include "survive_internal.h"
+#include "survive_private.h"
+
+#include <math.h>
+#include <string.h>
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+// 8 buckets per octave of nanoseconds; the last bucket catches everything past ~4s
+#define PROFILE_BUCKETS_PER_OCTAVE 8
+#define PROFILE_BUCKETS 256
+
+typedef struct survive_profile_histogram {
+	uint64_t buckets[PROFILE_BUCKETS];
+	uint64_t count;
+	double total_s, max_s;
+} survive_profile_histogram;
+
+struct survive_profile {
+	og_mutex_t lock;
+	survive_profile_histogram stages[survive_profile_stage_count];
+};
+
+static const char *stage_names[survive_profile_stage_count] = {
+	"disambiguation", "sensor_activations", "poser", "kalman_light", "kalman_imu", "report",
+};
+
+// gettimeofday only has microsecond resolution, which is about the length of most of the stages
+static double profile_now() {
+#ifdef _WIN32
+	return OGGetAbsoluteTime();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+static int bucket_for(double seconds) {
+	double ns = seconds * 1e9;
+	if (ns <= 1)
+		return 0;
+	int idx = (int)(PROFILE_BUCKETS_PER_OCTAVE * log2(ns));
+	return idx >= PROFILE_BUCKETS ? PROFILE_BUCKETS - 1 : idx;
+}
+
+// Geometric center of the bucket, in seconds
+static double bucket_value(int idx) { return pow(2., (idx + .5) / PROFILE_BUCKETS_PER_OCTAVE) * 1e-9; }
+
+static double histogram_percentile(const survive_profile_histogram *h, double p) {
+	if (h->count == 0)
+		return 0;
+
+	uint64_t target = (uint64_t)ceil(p * h->count);
+	if (target == 0)
+		target = 1;
+
+	uint64_t seen = 0;
+	for (int i = 0; i < PROFILE_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen >= target)
+			return linmath_min(bucket_value(i), h->max_s);
+	}
+	return h->max_s;
+}
+
+struct survive_profile *survive_profile_create() {
+	struct survive_profile *profile = SV_CALLOC(sizeof(struct survive_profile));
+	profile->lock = OGCreateMutex();
+	return profile;
+}
+
+void survive_profile_free(struct survive_profile *profile) {
+	if (profile == 0)
+		return;
+	OGDeleteMutex(profile->lock);
+	free(profile);
+}
+
+void survive_profile_output_stats(SurviveContext *ctx) {
+	if (!survive_profile_enabled(ctx))
+		return;
+
+	SV_VERBOSE(5, "Stage timing:");
+	SV_VERBOSE(5, "\t%-20s %10s %10s %10s %10s %10s", "stage", "count", "avg(us)", "p50(us)", "p99(us)", "max(us)");
+	for (int i = 0; i < survive_profile_stage_count; i++) {
+		survive_profile_stage_stats stats;
+		survive_profile_get_stats(ctx, i, &stats);
+		if (stats.count == 0)
+			continue;
+		SV_VERBOSE(5, "\t%-20s %10u %10.2f %10.2f %10.2f %10.2f", stage_names[i], (unsigned)stats.count,
+				   stats.total_s / stats.count * 1e6, stats.p50_s * 1e6, stats.p99_s * 1e6, stats.max_s * 1e6);
+	}
+}
+
+SURVIVE_EXPORT const char *survive_profile_stage_name(survive_profile_stage stage) {
+	if (stage < 0 || stage >= survive_profile_stage_count)
+		return "unknown";
+	return stage_names[stage];
+}
+
+SURVIVE_EXPORT bool survive_profile_enabled(const SurviveContext *ctx) {
+	return ctx && ctx->private_members && ctx->private_members->profile;
+}
+
+SURVIVE_EXPORT double survive_profile_start(const SurviveContext *ctx) {
+	return survive_profile_enabled(ctx) ? profile_now() : 0;
+}
+
+SURVIVE_EXPORT void survive_profile_end(SurviveContext *ctx, survive_profile_stage stage, double start) {
+	if (start == 0)
+		return;
+	survive_profile_record(ctx, stage, profile_now() - start);
+}
+
+SURVIVE_EXPORT void survive_profile_record(SurviveContext *ctx, survive_profile_stage stage, double seconds) {
+	if (!survive_profile_enabled(ctx) || stage < 0 || stage >= survive_profile_stage_count)
+		return;
+
+	struct survive_profile *profile = ctx->private_members->profile;
+	survive_profile_histogram *h = &profile->stages[stage];
+	int bucket = bucket_for(seconds);
+
+	OGLockMutex(profile->lock);
+	h->buckets[bucket]++;
+	h->count++;
+	h->total_s += seconds;
+	if (seconds > h->max_s)
+		h->max_s = seconds;
+	OGUnlockMutex(profile->lock);
+}
+
+SURVIVE_EXPORT void survive_profile_get_stats(const SurviveContext *ctx, survive_profile_stage stage,
+											  survive_profile_stage_stats *stats) {
+	memset(stats, 0, sizeof(*stats));
+	if (!survive_profile_enabled(ctx) || stage < 0 || stage >= survive_profile_stage_count)
+		return;
+
+	struct survive_profile *profile = ctx->private_members->profile;
+	OGLockMutex(profile->lock);
+	const survive_profile_histogram *h = &profile->stages[stage];
+	stats->count = h->count;
+	stats->total_s = h->total_s;
+	stats->max_s = h->max_s;
+	stats->p50_s = histogram_percentile(h, .5);
+	stats->p99_s = histogram_percentile(h, .99);
+	OGUnlockMutex(profile->lock);
+}
+
+SURVIVE_EXPORT void survive_profile_reset(SurviveContext *ctx) {
+	if (!survive_profile_enabled(ctx))
+		return;
+
+	struct survive_profile *profile = ctx->private_members->profile;
+	OGLockMutex(profile->lock);
+	memset(profile->stages, 0, sizeof(profile->stages));
+	OGUnlockMutex(profile->lock);
+}
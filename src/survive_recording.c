@@ -25,7 +25,9 @@
 #include "os_generic.h"
 #include "stdarg.h"
 
+#include "survive_binary_recording.h"
 #include "survive_gz.h"
+#include "survive_private.h"
 
 typedef struct SurviveRecordingData {
 	SurviveContext *ctx;
@@ -36,6 +38,34 @@ typedef struct SurviveRecordingData {
 	bool writeAngle;
 	int writeDataMatrix;
 	gzFile output_file;
+
+	// Set instead of output_file when recording to the binary format. Text lines that have no typed record are
+	// accumulated in pending_text until their newline and written as a single TEXT record.
+	survive_binary_writer *binary_file;
+	char *pending_text;
+	size_t pending_text_length, pending_text_size;
+	double pending_text_time;
+
+	// Threaded posers write poses while drivers write raw data
+	og_mutex_t lock;
+
+	// With record-async, text lines are formatted into 'staging' and a writer thread does all of the compression and
+	// IO. Lines written in several pieces are put together in 'partial_line' under 'lock', so whether to stage or drop
+	// is decided once per line. 'staging_lock' guards the buffers and stats; it is always taken last, never nested, so
+	// a producer can wait on 'space_cv' for the writer thread while still holding 'lock'.
+	bool async;
+	bool dropWhenFull;
+	int32_t bufferKB;
+	char *staging, *writing;
+	size_t staging_length, staging_size, max_staging_length;
+	char *partial_line;
+	size_t partial_line_length, partial_line_size;
+	bool writer_quit;
+	og_thread_t writer_thread;
+	og_mutex_t staging_lock;
+	og_cv_t writer_cv, space_cv;
+
+	survive_recording_stats stats;
 } SurviveRecordingData;
 
 // clang-format off
@@ -45,15 +75,251 @@ STRUCT_CONFIG_SECTION(SurviveRecordingData)
     STRUCT_CONFIG_ITEM("record-cal-imu", "Whether or not to output calibrated imu data", 0, t->writeCalIMU)
 	STRUCT_CONFIG_ITEM("record-angle", "Whether or not to output angle data", 1, t->writeAngle)
 	STRUCT_CONFIG_ITEM("record-data-matrices", "Whether or not to output data matrices", 0, t->writeDataMatrix)
+	STRUCT_CONFIG_ITEM("record-async", "Compress and write text recordings from a background thread", 1, t->async)
+	STRUCT_CONFIG_ITEM("record-buffer-kb", "Size of the staging buffer for record-async, in KB", 4096, t->bufferKB)
+	STRUCT_CONFIG_ITEM("record-drop-when-full", "Drop lines instead of waiting when the record-async buffer is full", 0,
+					   t->dropWhenFull)
 END_STRUCT_CONFIG_SECTION(SurviveRecordingData)
 	// clang-format on
 
 	STATIC_CONFIG_ITEM(RECORD, "record", 's', "File to record to if you wish to make a recording.", "")
 	STATIC_CONFIG_ITEM(RECORD_STDOUT, "record-stdout", 'b', "Whether or not to dump recording data to stdout", 0)
+	STATIC_CONFIG_ITEM(SMOOTHED_RECORD, "smoothed-record", 's',
+					   "File to write smoothed poses to. Needs kalman-smoother-lag to be set.", "")
+
+static void write_binary_text(SurviveRecordingData *recordingData, double ts, const char *string, size_t len) {
+	if (len == 0)
+		return;
+
+	if (recordingData->pending_text_length == 0)
+		recordingData->pending_text_time = ts;
+
+	size_t needed = recordingData->pending_text_length + len;
+	if (needed > recordingData->pending_text_size) {
+		recordingData->pending_text_size = needed * 2;
+		recordingData->pending_text = SV_REALLOC(recordingData->pending_text, recordingData->pending_text_size);
+	}
+	memcpy(recordingData->pending_text + recordingData->pending_text_length, string, len);
+	recordingData->pending_text_length = needed;
+
+	if (string[len - 1] == '\n') {
+		survive_binary_writer_write_text(recordingData->binary_file, recordingData->pending_text_time,
+										 recordingData->pending_text, recordingData->pending_text_length);
+		recordingData->pending_text_length = 0;
+	}
+}
+
+static void write_binary_vtext(SurviveRecordingData *recordingData, double ts, const char *format, va_list args) {
+	char buffer[512];
+	va_list args_copy;
+	va_copy(args_copy, args);
+	int len = vsnprintf(buffer, sizeof(buffer), format, args_copy);
+	va_end(args_copy);
+
+	if (len < 0)
+		return;
+	if (len < sizeof(buffer)) {
+		write_binary_text(recordingData, ts, buffer, len);
+		return;
+	}
+
+	char *large_buffer = SV_MALLOC(len + 1);
+	vsnprintf(large_buffer, len + 1, format, args);
+	write_binary_text(recordingData, ts, large_buffer, len);
+	free(large_buffer);
+}
+
+// Takes staging_lock. The line is either staged whole or, with record-drop-when-full, dropped whole.
+static void stage_line(SurviveRecordingData *recordingData, const char *string, size_t len) {
+	OGLockMutex(recordingData->staging_lock);
+	survive_recording_stats *stats = &recordingData->stats;
+	if (recordingData->staging_length + len > recordingData->staging_size) {
+		if (recordingData->dropWhenFull) {
+			stats->dropped_lines++;
+			stats->dropped_bytes += len;
+			OGUnlockMutex(recordingData->staging_lock);
+			return;
+		}
+		stats->stall_cnt++;
+	}
+
+	// Backpressure; wait for the writer thread to take the buffer. Lines longer than the whole buffer go in pieces,
+	// which is safe since other producers are held off by 'lock'.
+	double start = 0;
+	while (len) {
+		size_t space = recordingData->staging_size - recordingData->staging_length;
+		if (space == 0) {
+			if (start == 0)
+				start = OGRelativeTime();
+			OGSignalCond(recordingData->writer_cv);
+			OGWaitCond(recordingData->space_cv, recordingData->staging_lock);
+			continue;
+		}
+
+		size_t take = len < space ? len : space;
+		memcpy(recordingData->staging + recordingData->staging_length, string, take);
+		recordingData->staging_length += take;
+		string += take;
+		len -= take;
+	}
+	if (start != 0)
+		stats->stall_time += OGRelativeTime() - start;
+
+	if (recordingData->staging_length > recordingData->max_staging_length)
+		recordingData->max_staging_length = recordingData->staging_length;
+	if (recordingData->staging_length >= recordingData->staging_size / 4)
+		OGSignalCond(recordingData->writer_cv);
+	OGUnlockMutex(recordingData->staging_lock);
+}
+
+/*
+ * Called with recordingData->lock held. Pieces of a line are collected until the one with the newline, so the line
+ * reaches stage_line in one go.
+ */
+static void stage_text(SurviveRecordingData *recordingData, const char *string, size_t len) {
+	bool ends_line = string[len - 1] == '\n';
+	if (ends_line && recordingData->partial_line_length == 0) {
+		stage_line(recordingData, string, len);
+		return;
+	}
+
+	size_t needed = recordingData->partial_line_length + len;
+	if (needed > recordingData->partial_line_size) {
+		recordingData->partial_line_size = needed * 2;
+		recordingData->partial_line = SV_REALLOC(recordingData->partial_line, recordingData->partial_line_size);
+	}
+	memcpy(recordingData->partial_line + recordingData->partial_line_length, string, len);
+	recordingData->partial_line_length = needed;
+
+	if (ends_line) {
+		stage_line(recordingData, recordingData->partial_line, recordingData->partial_line_length);
+		recordingData->partial_line_length = 0;
+	}
+}
+
+static void write_gz_text(SurviveRecordingData *recordingData, const char *string, size_t len) {
+	if (len == 0)
+		return;
+
+	if (recordingData->writer_thread) {
+		OGLockMutex(recordingData->lock);
+		stage_text(recordingData, string, len);
+		OGUnlockMutex(recordingData->lock);
+	} else {
+		gzwrite(recordingData->output_file, string, len);
+	}
+}
+
+// Formats the whole line, timestamp included, so it reaches the output in one piece
+static void write_gz_vtext(SurviveRecordingData *recordingData, const double *ts, const char *format, va_list args) {
+	char buffer[512];
+	int offset = ts ? snprintf(buffer, sizeof(buffer), FLT_PRINTF, *ts) : 0;
+
+	va_list args_copy;
+	va_copy(args_copy, args);
+	int len = vsnprintf(buffer + offset, sizeof(buffer) - offset, format, args_copy);
+	va_end(args_copy);
+
+	if (len < 0)
+		return;
+	if (offset + len < sizeof(buffer)) {
+		write_gz_text(recordingData, buffer, offset + len);
+		return;
+	}
+
+	char *large_buffer = SV_MALLOC(offset + len + 1);
+	memcpy(large_buffer, buffer, offset);
+	vsnprintf(large_buffer + offset, len + 1, format, args);
+	write_gz_text(recordingData, large_buffer, offset + len);
+	free(large_buffer);
+}
+
+static void *recording_writer_thread(void *_recordingData) {
+	SurviveRecordingData *recordingData = _recordingData;
+
+	OGLockMutex(recordingData->staging_lock);
+	for (;;) {
+		while (!recordingData->writer_quit && recordingData->staging_length < recordingData->staging_size / 4)
+			OGWaitCond(recordingData->writer_cv, recordingData->staging_lock);
+		if (recordingData->writer_quit && recordingData->staging_length == 0)
+			break;
+
+		char *buffer = recordingData->staging;
+		size_t len = recordingData->staging_length;
+		recordingData->staging = recordingData->writing;
+		recordingData->writing = buffer;
+		recordingData->staging_length = 0;
+		OGBroadcastCond(recordingData->space_cv);
+		OGUnlockMutex(recordingData->staging_lock);
+
+		// Only this thread touches output_file while it runs
+		gzwrite(recordingData->output_file, buffer, len);
+
+		OGLockMutex(recordingData->staging_lock);
+		recordingData->stats.written_bytes += len;
+	}
+	OGUnlockMutex(recordingData->staging_lock);
+	return 0;
+}
+
+static void start_writer_thread(SurviveRecordingData *recordingData) {
+	recordingData->staging_size = (size_t)(recordingData->bufferKB > 0 ? recordingData->bufferKB : 1) * 1024;
+	recordingData->staging = SV_MALLOC(recordingData->staging_size);
+	recordingData->writing = SV_MALLOC(recordingData->staging_size);
+	recordingData->staging_lock = OGCreateMutex();
+	recordingData->writer_cv = OGCreateConditionVariable();
+	recordingData->space_cv = OGCreateConditionVariable();
+	recordingData->writer_thread = OGCreateThread(recording_writer_thread, "recording writer", recordingData);
+}
+
+// Writes out whatever is still staged and joins the writer thread
+static void stop_writer_thread(SurviveRecordingData *recordingData) {
+	SurviveContext *ctx = recordingData->ctx;
+
+	OGLockMutex(recordingData->staging_lock);
+	recordingData->writer_quit = true;
+	OGSignalCond(recordingData->writer_cv);
+	OGUnlockMutex(recordingData->staging_lock);
+	OGJoinThread(recordingData->writer_thread);
+	recordingData->writer_thread = 0;
+
+	const survive_recording_stats *stats = &recordingData->stats;
+	SV_VERBOSE(10, "Recording writer wrote %" PRIu64 " bytes; buffer high water mark %zu/%zu bytes",
+			   stats->written_bytes, recordingData->max_staging_length, recordingData->staging_size);
+	if (stats->stall_cnt) {
+		SV_VERBOSE(10, "Recording writer buffer was full %" PRIu64 " times; writers waited %.3fs in total",
+				   stats->stall_cnt, stats->stall_time);
+	}
+	if (stats->dropped_lines) {
+		SV_WARN("Recording dropped %" PRIu64 " lines (%" PRIu64 " bytes); consider a larger --record-buffer-kb",
+				stats->dropped_lines, stats->dropped_bytes);
+	}
+
+	OGDeleteConditionVariable(recordingData->writer_cv);
+	OGDeleteConditionVariable(recordingData->space_cv);
+	OGDeleteMutex(recordingData->staging_lock);
+	free(recordingData->staging);
+	free(recordingData->writing);
+	free(recordingData->partial_line);
+}
+
+SURVIVE_EXPORT survive_recording_stats survive_recording_get_stats(struct SurviveRecordingData *recordingData) {
+	survive_recording_stats stats = {0};
+	if (recordingData && recordingData->writer_thread) {
+		OGLockMutex(recordingData->staging_lock);
+		stats = recordingData->stats;
+		OGUnlockMutex(recordingData->staging_lock);
+	}
+	return stats;
+}
 
 	static void write_to_output_raw(SurviveRecordingData *recordingData, const char *string, int len) {
 		if (recordingData->output_file) {
-			gzwrite(recordingData->output_file, string, len);
+			write_gz_text(recordingData, string, len);
+		}
+
+		if (recordingData->binary_file) {
+			write_binary_text(recordingData, survive_run_time(recordingData->ctx), string, len);
 		}
 
 		if (recordingData->alwaysWriteStdOut) {
@@ -61,11 +327,36 @@ END_STRUCT_CONFIG_SECTION(SurviveRecordingData)
 		}
 }
 
-#ifdef SURVIVE_HEX_FLOATS
-#define FLT_PRINTF "%0.6a "
-#else
-#define FLT_PRINTF "%0.6f "
-#endif
+/**
+ * Writes a typed record when recording to the binary format.
+ *
+ * @return false if the recording is text based and the caller should write out the text line instead.
+ */
+static bool write_binary_record_at(SurviveRecordingData *recordingData, double ts, uint8_t type, const char *dev,
+								   const void *data, uint32_t length) {
+	if (recordingData->binary_file == 0) {
+		return false;
+	}
+
+	OGLockMutex(recordingData->lock);
+	survive_binary_writer_write(recordingData->binary_file, ts, type, dev, data, length);
+
+	if (recordingData->alwaysWriteStdOut) {
+		char buffer[512];
+		survive_binary_record record = {.hdr = {.time = ts, .length = length, .type = type}, .data = data};
+		strncpy(record.hdr.dev, dev, sizeof(record.hdr.dev));
+		if (survive_binary_record_format(&record, buffer, sizeof(buffer)) > 0) {
+			fprintf(stdout, FLT_PRINTF "%s", ts, buffer);
+		}
+	}
+	OGUnlockMutex(recordingData->lock);
+	return true;
+}
+
+static bool write_binary_record(SurviveRecordingData *recordingData, uint8_t type, const char *dev, const void *data,
+								uint32_t length) {
+	return write_binary_record_at(recordingData, survive_run_time(recordingData->ctx), type, dev, data, length);
+}
 
 SURVIVE_EXPORT void survive_recording_write_matrix(struct SurviveRecordingData *recordingData, const SurviveObject *so,
 												   int lvl, const char *name, const CnMat *M) {
@@ -73,36 +364,58 @@ SURVIVE_EXPORT void survive_recording_write_matrix(struct SurviveRecordingData *
 		return;
 	}
 
+	OGLockMutex(recordingData->lock);
 	survive_recording_write_to_output(recordingData, "%s DATA_MATRIX %s %d %d ", so ? so->codename : "g", name, M->rows,
 									  M->cols);
 	for (int i = 0; i < M->rows * M->cols; i++) {
 		survive_recording_write_to_output_nopreamble(recordingData, "%f ", M->data[i]);
 	}
 	survive_recording_write_to_output_nopreamble(recordingData, "\n");
+	OGUnlockMutex(recordingData->lock);
 }
-void survive_recording_write_to_output(struct SurviveRecordingData *recordingData, const char *format, ...) {
-	if (!recordingData) {
-		return;
-	}
-
-	double ts = survive_run_time(recordingData->ctx);
-
+static void vwrite_to_output_at(SurviveRecordingData *recordingData, double ts, const char *format, va_list args) {
+	OGLockMutex(recordingData->lock);
 	if (recordingData->output_file) {
-		va_list args;
-		va_start(args, format);
-		gzprintf(recordingData->output_file, FLT_PRINTF, ts);
-		gzvprintf(recordingData->output_file, format, args);
+		va_list args_copy;
+		va_copy(args_copy, args);
+		write_gz_vtext(recordingData, &ts, format, args_copy);
+		va_end(args_copy);
+	}
 
-		va_end(args);
+	if (recordingData->binary_file) {
+		va_list args_copy;
+		va_copy(args_copy, args);
+		write_binary_vtext(recordingData, ts, format, args_copy);
+		va_end(args_copy);
 	}
 
 	if (recordingData->alwaysWriteStdOut) {
-		va_list args;
-		va_start(args, format);
+		va_list args_copy;
+		va_copy(args_copy, args);
 		fprintf(stdout, FLT_PRINTF, ts);
-		vfprintf(stdout, format, args);
-		va_end(args);
+		vfprintf(stdout, format, args_copy);
+		va_end(args_copy);
+	}
+	OGUnlockMutex(recordingData->lock);
+}
+
+void survive_recording_write_to_output(struct SurviveRecordingData *recordingData, const char *format, ...) {
+	if (!recordingData) {
+		return;
 	}
+
+	va_list args;
+	va_start(args, format);
+	vwrite_to_output_at(recordingData, survive_run_time(recordingData->ctx), format, args);
+	va_end(args);
+}
+
+// As survive_recording_write_to_output, but stamped with 'ts' instead of the current run time
+static void write_to_output_at(struct SurviveRecordingData *recordingData, double ts, const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	vwrite_to_output_at(recordingData, ts, format, args);
+	va_end(args);
 }
 
 void survive_recording_write_to_output_nopreamble(struct SurviveRecordingData *recordingData, const char *format, ...) {
@@ -110,11 +423,18 @@ void survive_recording_write_to_output_nopreamble(struct SurviveRecordingData *r
 		return;
 	}
 
+	OGLockMutex(recordingData->lock);
 	if (recordingData->output_file) {
 		va_list args;
 		va_start(args, format);
-		gzvprintf(recordingData->output_file, format, args);
+		write_gz_vtext(recordingData, 0, format, args);
+		va_end(args);
+	}
 
+	if (recordingData->binary_file) {
+		va_list args;
+		va_start(args, format);
+		write_binary_vtext(recordingData, survive_run_time(recordingData->ctx), format, args);
 		va_end(args);
 	}
 
@@ -124,6 +444,7 @@ void survive_recording_write_to_output_nopreamble(struct SurviveRecordingData *r
 		vfprintf(stdout, format, args);
 		va_end(args);
 	}
+	OGUnlockMutex(recordingData->lock);
 }
 void survive_recording_disconnect_process(struct SurviveObject *so) {
 	SurviveRecordingData *recordingData = so->ctx ? so->ctx->recptr : 0;
@@ -141,10 +462,12 @@ void survive_recording_config_process(SurviveObject *so, char *ct0conf, int len)
 		if (buffer[i] == '\n' || buffer[i] == '\r')
 			buffer[i] = ' ';
 
+	OGLockMutex(recordingData->lock);
 	survive_recording_write_to_output(recordingData, "%s CONFIG ", so->codename);
 	write_to_output_raw(recordingData, buffer, len);
 
 	write_to_output_raw(recordingData, "\r\n", 2);
+	OGUnlockMutex(recordingData->lock);
 
 	free(buffer);
 }
@@ -181,6 +504,17 @@ void survive_recording_raw_pose_process(SurviveObject *so, uint8_t lighthouse, c
 		so->codename, pose->Pos[0], pose->Pos[1], pose->Pos[2], pose->Rot[0], pose->Rot[1], pose->Rot[2], pose->Rot[3]);
 }
 
+void survive_recording_smoothed_pose_process(SurviveObject *so, FLT runtime, const SurvivePose *pose) {
+	SurviveRecordingData *recordingData = so->ctx->private_members->smoothed_recording;
+	if (recordingData == 0)
+		return;
+
+	write_to_output_at(
+		recordingData, runtime,
+		"%s POSE " FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF "\r\n", so->codename,
+		pose->Pos[0], pose->Pos[1], pose->Pos[2], pose->Rot[0], pose->Rot[1], pose->Rot[2], pose->Rot[3]);
+}
+
 void survive_recording_external_velocity_process(SurviveContext *ctx, const char *name, const SurviveVelocity *pose) {
 	SurviveRecordingData *recordingData = ctx->recptr;
 	if (recordingData == 0)
@@ -220,18 +554,55 @@ void survive_recording_sync_process(SurviveObject *so, survive_channel channel,
 		return;
 	}
 
+	survive_binary_sync record = {.timecode = timecode, .channel = channel, .ootx = ootx, .gen = gen};
+	if (write_binary_record(recordingData, SURVIVE_BINARY_RECORD_SYNC, dev, &record, sizeof(record)))
+		return;
+
 	survive_recording_write_to_output(recordingData, SYNC_PRINTF, SYNC_PRINTF_ARGS);
 }
 
-void survive_recording_sweep_angle_process(SurviveObject *so, survive_channel channel, int sensor_id,
-										   survive_timecode timecode, int8_t plane, FLT angle) {
+void survive_recording_sweep_angles_process(SurviveObject *so, const SurviveSweepAngle *angles, size_t cnt) {
 	SurviveRecordingData *recordingData = so->ctx->recptr;
-	if (!recordingData || !recordingData->writeAngle) {
+	if (!recordingData || !recordingData->writeAngle || cnt == 0) {
 		return;
 	}
 
+	// The whole batch goes out under one lock, and text lines are formatted into one write. Each line keeps the time
+	// its angle came in rather than when the batch was handed on.
 	const char *dev = so->codename;
-	survive_recording_write_to_output(recordingData, SWEEP_ANGLE_PRINTF, SWEEP_ANGLE_PRINTF_ARGS);
+	char buffer[4096];
+	size_t len = 0;
+
+	OGLockMutex(recordingData->lock);
+	for (size_t i = 0; i < cnt; i++) {
+		survive_channel channel = angles[i].channel;
+		int sensor_id = angles[i].sensor_id;
+		survive_timecode timecode = angles[i].timecode;
+		int8_t plane = angles[i].plane;
+		FLT angle = angles[i].angle;
+		double ts = angles[i].run_time;
+
+		survive_binary_sweep_angle record = {
+			.angle = angle, .timecode = timecode, .sensor_id = sensor_id, .channel = channel, .plane = plane};
+		if (write_binary_record_at(recordingData, ts, SURVIVE_BINARY_RECORD_SWEEP_ANGLE, dev, &record,
+								   sizeof(record)))
+			continue;
+
+		char line[256];
+		int line_len = snprintf(line, sizeof(line), FLT_PRINTF, ts);
+		line_len += snprintf(line + line_len, sizeof(line) - line_len, SWEEP_ANGLE_PRINTF, SWEEP_ANGLE_PRINTF_ARGS);
+		if (line_len < 0 || (size_t)line_len >= sizeof(line))
+			continue;
+
+		if (len + line_len > sizeof(buffer)) {
+			write_to_output_raw(recordingData, buffer, len);
+			len = 0;
+		}
+		memcpy(buffer + len, line, line_len);
+		len += line_len;
+	}
+	write_to_output_raw(recordingData, buffer, len);
+	OGUnlockMutex(recordingData->lock);
 }
 
 void survive_recording_sweep_process(SurviveObject *so, survive_channel channel, int sensor_id,
@@ -246,6 +617,10 @@ void survive_recording_sweep_process(SurviveObject *so, survive_channel channel,
 		return;
 
 	const char *dev = so->codename;
+	survive_binary_sweep record = {.timecode = timecode, .sensor_id = sensor_id, .channel = channel, .flag = flag};
+	if (write_binary_record(recordingData, SURVIVE_BINARY_RECORD_SWEEP, dev, &record, sizeof(record)))
+		return;
+
 	survive_recording_write_to_output(recordingData, SWEEP_PRINTF, SWEEP_PRINTF_ARGS);
 }
 
@@ -277,8 +652,12 @@ void survive_recording_lightcap(SurviveObject *so, LightcapElement *le) {
 		return;
 
 	if (recordingData->writeRawLight) {
-		survive_recording_write_to_output(recordingData, "%s C %d %u %u\r\n", so->codename, le->sensor_id,
-										  le->timestamp, le->length);
+		survive_binary_lightcap record = {.timestamp = le->timestamp, .length = le->length, .sensor_id = le->sensor_id};
+		if (write_binary_record(recordingData, SURVIVE_BINARY_RECORD_LIGHTCAP, so->codename, &record, sizeof(record)))
+			return;
+
+		survive_recording_write_to_output(recordingData, LIGHTCAP_PRINTF, so->codename, le->sensor_id, le->timestamp,
+										  le->length);
 	}
 }
 
@@ -292,9 +671,20 @@ void survive_recording_light_process(struct SurviveObject *so, int sensor_id, in
 	  return;
 	}
 	
+	if (acode >= -1 && acode <= 7) {
+		survive_binary_light record = {.timecode = timecode,
+									   .length = length,
+									   .lh = lh,
+									   .sensor_id = sensor_id,
+									   .acode = acode,
+									   .timeinsweep = timeinsweep};
+		if (write_binary_record(recordingData, SURVIVE_BINARY_RECORD_LIGHT, so->codename, &record, sizeof(record)))
+			return;
+	}
+
 	if (acode == -1) {
-		survive_recording_write_to_output(recordingData, "%s S %d %d %d %u %u %u\r\n", so->codename, sensor_id, acode,
-										  timeinsweep, timecode, length, lh);
+		survive_recording_write_to_output(recordingData, LIGHT_SYNC_PRINTF, so->codename, sensor_id, acode, timeinsweep,
+										  timecode, length, lh);
 		return;
 	}
 
@@ -324,8 +714,8 @@ void survive_recording_light_process(struct SurviveObject *so, int sensor_id, in
 		break;
 	}
 
-	survive_recording_write_to_output(recordingData, "%s %s %s %d %d %d %u %u %u\r\n", so->codename, LH_ID, LH_Axis,
-									  sensor_id, acode, timeinsweep, timecode, length, lh);
+	survive_recording_write_to_output(recordingData, LIGHT_PRINTF, so->codename, LH_ID, LH_Axis, sensor_id, acode,
+									  timeinsweep, timecode, length, lh);
 }
 
 void survive_recording_imu_scales(struct SurviveObject *so, int gyro_scale_mode, int acc_scale_mode) {
@@ -348,12 +738,17 @@ void survive_recording_imu_process(struct SurviveObject *so, int mask, const FLT
 		return;
 	}
 
-	survive_recording_write_to_output(recordingData,
-									  "%s I %d %u " FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF
-									  " " FLT_PRINTF FLT_PRINTF FLT_PRINTF "%d\r\n",
-									  so->codename, mask, timecode, accelgyro[0], accelgyro[1], accelgyro[2],
-									  accelgyro[3], accelgyro[4], accelgyro[5], accelgyro[6], accelgyro[7],
-									  accelgyro[8], id);
+	if (recordingData->binary_file) {
+		survive_binary_imu record = {.timecode = timecode, .mask = mask, .id = id};
+		for (int i = 0; i < 9; i++)
+			record.accelgyromag[i] = accelgyro[i];
+		write_binary_record(recordingData, SURVIVE_BINARY_RECORD_IMU, so->codename, &record, sizeof(record));
+		return;
+	}
+
+	survive_recording_write_to_output(recordingData, IMU_PRINTF, so->codename, 'I', mask, timecode, accelgyro[0],
+									  accelgyro[1], accelgyro[2], accelgyro[3], accelgyro[4], accelgyro[5],
+									  accelgyro[6], accelgyro[7], accelgyro[8], id);
 }
 
 void survive_recording_raw_imu_process(struct SurviveObject *so, int mask, const FLT *accelgyro, uint32_t timecode,
@@ -366,21 +761,46 @@ void survive_recording_raw_imu_process(struct SurviveObject *so, int mask, const
 		return;
 	}
 
-	survive_recording_write_to_output(recordingData,
-									  "%s i %d %u " FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF
-									  " " FLT_PRINTF FLT_PRINTF FLT_PRINTF "%d\r\n",
-									  so->codename, mask, timecode, accelgyro[0], accelgyro[1], accelgyro[2],
-									  accelgyro[3], accelgyro[4], accelgyro[5], accelgyro[6], accelgyro[7],
-									  accelgyro[8], id);
+	if (recordingData->binary_file) {
+		survive_binary_imu record = {.timecode = timecode, .mask = mask, .id = id};
+		for (int i = 0; i < 9; i++)
+			record.accelgyromag[i] = accelgyro[i];
+		write_binary_record(recordingData, SURVIVE_BINARY_RECORD_RAW_IMU, so->codename, &record, sizeof(record));
+		return;
+	}
+
+	survive_recording_write_to_output(recordingData, IMU_PRINTF, so->codename, 'i', mask, timecode, accelgyro[0],
+									  accelgyro[1], accelgyro[2], accelgyro[3], accelgyro[4], accelgyro[5],
+									  accelgyro[6], accelgyro[7], accelgyro[8], id);
+}
+
+static void close_recording(SurviveRecordingData *recordingData) {
+	if (recordingData->writer_thread)
+		stop_writer_thread(recordingData);
+	if (recordingData->output_file)
+		gzclose(recordingData->output_file);
+	if (recordingData->binary_file) {
+		if (recordingData->pending_text_length)
+			write_binary_text(recordingData, recordingData->pending_text_time, "\n", 1);
+		survive_binary_writer_close(recordingData->binary_file);
+	}
+	free(recordingData->pending_text);
+	OGDeleteMutex(recordingData->lock);
+	free(recordingData);
 }
 
 void survive_destroy_recording(SurviveContext *ctx) {
 	if (ctx->recptr) {
 		SurviveRecordingData_detach_config(ctx, ctx->recptr);
-		gzclose(ctx->recptr->output_file);
-		free(ctx->recptr);
+		close_recording(ctx->recptr);
 		ctx->recptr = 0;
 	}
+
+	struct SurviveContext_private *pctx = ctx->private_members;
+	if (pctx && pctx->smoothed_recording) {
+		close_recording(pctx->smoothed_recording);
+		pctx->smoothed_recording = 0;
+	}
 }
 
 void survive_record_config(SurviveContext *ctx, const char *tag, uint8_t type, const char *desc, const char *def_value,
@@ -390,13 +810,58 @@ void survive_record_config(SurviveContext *ctx, const char *tag, uint8_t type, c
 	survive_recording_write_to_output(ctx->recptr, "OPTION %s %c %s\n", tag, type, buf);
 }
 
+/*
+ * Opens a text (optionally gzipped) or binary recording, depending on the extension. USB captures are handled by the
+ * usbmon driver and aren't opened here.
+ */
+static bool open_recording_file(SurviveRecordingData *recordingData, const char *filename) {
+	SurviveContext *ctx = recordingData->ctx;
+	if (strstr(filename, SURVIVE_BINARY_RECORDING_EXTENSION)) {
+		recordingData->binary_file = survive_binary_writer_open(filename, 6);
+		if (recordingData->binary_file == 0) {
+			SV_INFO("Could not open %s for writing", filename);
+			return false;
+		}
+		SV_INFO("Recording to '%s' in binary format", filename);
+		return true;
+	}
+
+	bool useCompression = strncmp(filename + strlen(filename) - 3, ".gz", 3) == 0;
+	recordingData->output_file = gzopen(filename, useCompression ? "w6F" : "wT");
+	if (recordingData->output_file == 0) {
+		SV_INFO("Could not open %s for writing", filename);
+		return false;
+	}
+	SV_INFO("Recording to '%s' Compression: %d", filename, useCompression);
+	return true;
+}
+
+static void install_smoothed_recording(SurviveContext *ctx) {
+	const char *smoothed_file = survive_configs(ctx, SMOOTHED_RECORD_TAG, SC_GET, "");
+	if (strlen(smoothed_file) == 0)
+		return;
+
+	SurviveRecordingData *recordingData = SV_CALLOC(sizeof(struct SurviveRecordingData));
+	recordingData->ctx = ctx;
+	recordingData->lock = OGCreateMutex();
+	if (!open_recording_file(recordingData, smoothed_file)) {
+		OGDeleteMutex(recordingData->lock);
+		free(recordingData);
+		return;
+	}
+	ctx->private_members->smoothed_recording = recordingData;
+}
+
 void survive_install_recording(SurviveContext *ctx) {
 	const char *dataout_file = survive_configs(ctx, "record", SC_GET, "");
 	int record_to_stdout = survive_configi(ctx, "record-stdout", SC_GET, 0);
 
+	install_smoothed_recording(ctx);
+
 	if (strlen(dataout_file) > 0 || record_to_stdout) {
 		ctx->recptr = SV_CALLOC(sizeof(struct SurviveRecordingData));
 		ctx->recptr->ctx = ctx;
+		ctx->recptr->lock = OGCreateMutex();
 		SurviveRecordingData_attach_config(ctx, ctx->recptr);
 		if (strlen(dataout_file) > 0) {
 			if (strstr(dataout_file, ".pcap")) {
@@ -408,18 +873,14 @@ void survive_install_recording(SurviveContext *ctx) {
 				SV_WARN("Playback file %s is a USB packet capture, but the usbmon playback driver does not exist.",
 						dataout_file);
 				return;
-			} else {
-
-				bool useCompression = strncmp(dataout_file + strlen(dataout_file) - 3, ".gz", 3) == 0;
-
-				ctx->recptr->output_file = gzopen(dataout_file, useCompression ? "w6F" : "wT");
-				if (ctx->recptr->output_file == 0) {
-					SV_INFO("Could not open %s for writing", dataout_file);
-					free(ctx->recptr);
-					ctx->recptr = 0;
-					return;
-				}
-				SV_INFO("Recording to '%s' Compression: %d", dataout_file, useCompression);
+			} else if (!open_recording_file(ctx->recptr, dataout_file)) {
+				SurviveRecordingData_detach_config(ctx, ctx->recptr);
+				OGDeleteMutex(ctx->recptr->lock);
+				free(ctx->recptr);
+				ctx->recptr = 0;
+				return;
+			} else if (ctx->recptr->output_file && ctx->recptr->async) {
+				start_writer_thread(ctx->recptr);
 			}
 		}
 
@@ -28,7 +28,40 @@
 #define SYNC_SCANF "%s Y %"SCN_CHANNEL" %u %"SCN_FLAG" %"SCN_GEN"\n"
 #define SYNC_PRINTF "%s Y %"PRI_CHANNEL" %u %"PRI_FLAG" %"PRI_GEN"\n"
 
+#ifdef SURVIVE_HEX_FLOATS
+#define FLT_PRINTF "%0.6a "
+#else
+#define FLT_PRINTF "%0.6f "
+#endif
+
+// 'I' for calibrated, 'i' for raw: int mask, survive_timecode timecode, FLT accelgyromag[9], int id
+#define IMU_PRINTF                                                                                                     \
+	"%s %c %d %u " FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF FLT_PRINTF " " FLT_PRINTF FLT_PRINTF         \
+		FLT_PRINTF "%d\r\n"
+
+// int sensor_id, uint32_t timestamp, uint32_t length
+#define LIGHTCAP_PRINTF "%s C %d %u %u\r\n"
+
+// const char* LH_ID, const char* LH_Axis, int sensor_id, int acode, int timeinsweep, uint32_t timecode, uint32_t length,
+// uint32_t lh
+#define LIGHT_PRINTF "%s %s %s %d %d %d %u %u %u\r\n"
+// As above, for acode == -1
+#define LIGHT_SYNC_PRINTF "%s S %d %d %d %u %u %u\r\n"
+
 struct SurviveRecordingData;
+
+// Counters for the record-async writer thread
+typedef struct survive_recording_stats {
+	uint64_t written_bytes;
+	// Lines dropped whole because the staging buffer was full; only with record-drop-when-full
+	uint64_t dropped_lines, dropped_bytes;
+	// Lines which had to wait for the writer thread, and how long they waited in total
+	uint64_t stall_cnt;
+	double stall_time;
+} survive_recording_stats;
+// All zero unless the recording has a writer thread
+SURVIVE_EXPORT survive_recording_stats survive_recording_get_stats(struct SurviveRecordingData *recordingData);
+
 SURVIVE_EXPORT void survive_recording_write_matrix(struct SurviveRecordingData *recordingData, const SurviveObject *so,
 												   int lvl, const char *name, const CnMat *M);
 SURVIVE_EXPORT void survive_recording_write_to_output(struct SurviveRecordingData *recordingData, const char *format,
@@ -50,12 +83,13 @@ void survive_recording_button_process(SurviveObject *so, enum SurviveInputEvent
 									  const enum SurviveAxis *axisIds, const SurviveAxisVal_t *axisVals);
 void survive_recording_angle_process(struct SurviveObject *so, int sensor_id, int acode, uint32_t timecode, FLT length,
 									 FLT angle, uint32_t lh);
-void survive_recording_sweep_angle_process(SurviveObject *so, survive_channel channel, int sensor_id,
-										   survive_timecode timecode, int8_t plane, FLT angle);
+void survive_recording_sweep_angles_process(SurviveObject *so, const SurviveSweepAngle *angles, size_t cnt);
 void survive_recording_sync_process(SurviveObject *so, survive_channel channel, survive_timecode timecode, bool ootx,
 									bool gen);
 
 void survive_recording_external_pose_process(SurviveContext *ctx, const char *name, const SurvivePose *pose);
+// Written to the smoothed-record file, stamped with the runtime the pose is for rather than when it was written
+void survive_recording_smoothed_pose_process(SurviveObject *so, FLT runtime, const SurvivePose *pose);
 void survive_recording_external_velocity_process(SurviveContext *ctx, const char *name,
 												 const SurviveVelocity *velocity);
 
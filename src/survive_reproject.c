@@ -10,9 +10,15 @@
 #ifdef BUILD_LH1_SUPPORT
 #include "generated/survive_reproject.generated.h"
 #endif
-static inline FLT survive_reproject_axis(const BaseStationCal *bcal, FLT axis_value, FLT other_axis_value, FLT Z,
-										 bool invert_axis_value) {
-	FLT ang = (FLT)M_PI_2 - (invert_axis_value ? -1.f : 1.f) * (FLT_ATAN2(axis_value, Z));
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// atan_axis is atan2(axis_value, Z) and atan_other atan2(other_axis_value, Z); each is used by both axes, so the batch
+// function only works them out once per point
+static inline FLT reproject_axis(const BaseStationCal *bcal, FLT atan_axis, FLT atan_other, FLT mag,
+								 FLT other_axis_value, bool invert_axis_value) {
+	FLT ang = (FLT)M_PI_2 - (invert_axis_value ? -1.f : 1.f) * atan_axis;
 
 	const FLT phase = bcal->phase;
 	const FLT curve = bcal->curve;
@@ -20,18 +26,23 @@ static inline FLT survive_reproject_axis(const BaseStationCal *bcal, FLT axis_va
 	const FLT gibPhase = bcal->gibpha;
 	const FLT gibMag = bcal->gibmag;
 
-	const FLT mag = FLT_SQRT(axis_value * axis_value + Z * Z);
-
 	ang -= phase;
 	FLT asin_arg = linmath_enforce_range((tilt)*other_axis_value / mag, -1, 1);
 	ang -= FLT_ASIN(asin_arg);
 	ang -= FLT_COS(gibPhase + ang) * gibMag;
-	ang += curve * FLT_ATAN2(other_axis_value, Z) * FLT_ATAN2(other_axis_value, Z);
+	ang += curve * atan_other * atan_other;
 
 	assert(!isnan(ang));
 	return ang;
 }
 
+static inline FLT survive_reproject_axis(const BaseStationCal *bcal, FLT axis_value, FLT other_axis_value, FLT Z,
+										 bool invert_axis_value) {
+	const FLT mag = FLT_SQRT(axis_value * axis_value + Z * Z);
+	return reproject_axis(bcal, FLT_ATAN2(axis_value, Z), FLT_ATAN2(other_axis_value, Z), mag, other_axis_value,
+						  invert_axis_value);
+}
+
 static inline FLT survive_reproject_axis_x_inline(const BaseStationCal *bcal, LinmathVec3d const ptInLh) {
 	return survive_reproject_axis(&bcal[0], ptInLh[0], ptInLh[1], -ptInLh[2], false) - (FLT)M_PI / 2.f;
 }
@@ -53,6 +64,104 @@ void survive_reproject_xy(const BaseStationCal *bcal, LinmathVec3d const ptInLh,
 	out[1] = survive_reproject_axis_y_inline(bcal, ptInLh);
 }
 
+void survive_reproject_xy_batch(const BaseStationCal *bcal, size_t n, const FLT *x, const FLT *y, const FLT *z,
+								FLT *out_x, FLT *out_y) {
+	for (size_t i = 0; i < n; i++) {
+		FLT X = x[i], Y = y[i], Z = -z[i];
+		FLT atanX = FLT_ATAN2(X, Z), atanY = FLT_ATAN2(Y, Z);
+		if (out_x)
+			out_x[i] = reproject_axis(&bcal[0], atanX, atanY, FLT_SQRT(X * X + Z * Z), Y, false) - (FLT)M_PI / 2.f;
+		if (out_y)
+			out_y[i] = reproject_axis(&bcal[1], atanY, atanX, FLT_SQRT(Y * Y + Z * Z), X, true) - (FLT)M_PI / 2.f;
+	}
+}
+
+void survive_reproject_transform_points(const SurvivePose *pose, size_t n, const FLT *x, const FLT *y, const FLT *z,
+										FLT *out_x, FLT *out_y, FLT *out_z) {
+	// Rotating the basis vectors gives the same result as quatrotatevector, unnormalized quaternions included, since
+	// that is linear in the point
+	LinmathVec3d cols[3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+	for (int i = 0; i < 3; i++)
+		quatrotatevector(cols[i], pose->Rot, cols[i]);
+	const FLT *t = pose->Pos;
+
+	size_t i = 0;
+#if defined(USE_DOUBLE) && defined(__AVX2__)
+	__m256d m[3][3], tv[3];
+	for (int r = 0; r < 3; r++) {
+		for (int c = 0; c < 3; c++)
+			m[r][c] = _mm256_set1_pd(cols[c][r]);
+		tv[r] = _mm256_set1_pd(t[r]);
+	}
+	for (; i + 4 <= n; i += 4) {
+		__m256d px = _mm256_loadu_pd(x + i), py = _mm256_loadu_pd(y + i), pz = _mm256_loadu_pd(z + i);
+		__m256d r[3];
+		for (int k = 0; k < 3; k++) {
+			r[k] = _mm256_add_pd(tv[k], _mm256_mul_pd(m[k][0], px));
+			r[k] = _mm256_add_pd(r[k], _mm256_mul_pd(m[k][1], py));
+			r[k] = _mm256_add_pd(r[k], _mm256_mul_pd(m[k][2], pz));
+		}
+		_mm256_storeu_pd(out_x + i, r[0]);
+		_mm256_storeu_pd(out_y + i, r[1]);
+		_mm256_storeu_pd(out_z + i, r[2]);
+	}
+#elif defined(USE_DOUBLE) && defined(__SSE2__)
+	__m128d m[3][3], tv[3];
+	for (int r = 0; r < 3; r++) {
+		for (int c = 0; c < 3; c++)
+			m[r][c] = _mm_set1_pd(cols[c][r]);
+		tv[r] = _mm_set1_pd(t[r]);
+	}
+	for (; i + 2 <= n; i += 2) {
+		__m128d px = _mm_loadu_pd(x + i), py = _mm_loadu_pd(y + i), pz = _mm_loadu_pd(z + i);
+		__m128d r[3];
+		for (int k = 0; k < 3; k++) {
+			r[k] = _mm_add_pd(tv[k], _mm_mul_pd(m[k][0], px));
+			r[k] = _mm_add_pd(r[k], _mm_mul_pd(m[k][1], py));
+			r[k] = _mm_add_pd(r[k], _mm_mul_pd(m[k][2], pz));
+		}
+		_mm_storeu_pd(out_x + i, r[0]);
+		_mm_storeu_pd(out_y + i, r[1]);
+		_mm_storeu_pd(out_z + i, r[2]);
+	}
+#endif
+	for (; i < n; i++) {
+		FLT px = x[i], py = y[i], pz = z[i];
+		out_x[i] = t[0] + cols[0][0] * px + cols[1][0] * py + cols[2][0] * pz;
+		out_y[i] = t[1] + cols[0][1] * px + cols[1][1] * py + cols[2][1] * pz;
+		out_z[i] = t[2] + cols[0][2] * px + cols[1][2] * py + cols[2][2] * pz;
+	}
+}
+
+// Points are transformed and reprojected this many at a time so the scratch space fits on the stack
+#define REPROJECT_BATCH_CHUNK 64
+
+void survive_reproject_full_xy_batch(const survive_reproject_model_t *model, const BaseStationCal *bcal,
+									 const SurvivePose *world2lh, const SurvivePose *obj2world, size_t n, const FLT *x,
+									 const FLT *y, const FLT *z, FLT *out_x, FLT *out_y) {
+	SurvivePose obj2lh;
+	ApplyPoseToPose(&obj2lh, world2lh, obj2world);
+
+	FLT lx[REPROJECT_BATCH_CHUNK], ly[REPROJECT_BATCH_CHUNK], lz[REPROJECT_BATCH_CHUNK];
+	for (size_t i = 0; i < n; i += REPROJECT_BATCH_CHUNK) {
+		size_t cnt = n - i < REPROJECT_BATCH_CHUNK ? n - i : REPROJECT_BATCH_CHUNK;
+		survive_reproject_transform_points(&obj2lh, cnt, x + i, y + i, z + i, lx, ly, lz);
+		if (model->reprojectXYBatch) {
+			model->reprojectXYBatch(bcal, cnt, lx, ly, lz, out_x ? out_x + i : 0, out_y ? out_y + i : 0);
+			continue;
+		}
+
+		for (size_t j = 0; j < cnt; j++) {
+			SurviveAngleReading out;
+			model->reprojectXY(bcal, (LinmathVec3d){lx[j], ly[j], lz[j]}, out);
+			if (out_x)
+				out_x[i + j] = out[0];
+			if (out_y)
+				out_y[i + j] = out[1];
+		}
+	}
+}
+
 void survive_reproject_full(const BaseStationCal *bcal, const SurvivePose *world2lh, const SurvivePose *obj2world,
 							const LinmathVec3d obj_pt, SurviveAngleReading out) {
 	LinmathVec3d world_pt;
@@ -106,6 +215,7 @@ const survive_reproject_model_t SURVIVE_EXPORT survive_reproject_gen1_model = {
 #ifdef BUILD_LH1_SUPPORT
 	.reprojectAxisFn = {survive_reproject_axis_x, survive_reproject_axis_y},
 	.reprojectXY = survive_reproject_xy,
+	.reprojectXYBatch = survive_reproject_xy_batch,
 	.reprojectAxisFullFn = {gen_reproject_axis_x, gen_reproject_axis_y},
 
 	.reprojectAxisJacobFn = {gen_reproject_axis_x_jac_obj_p, gen_reproject_axis_y_jac_obj_p},
@@ -59,49 +59,62 @@ static inline void calc_cal_series(FLT s, FLT *m, FLT *a) {
 	}
 }
 
-static inline FLT survive_reproject_axis_gen2(const BaseStationCal *bcal, FLT X, FLT Y, FLT Z, bool axis) {
-	const FLT phase = bcal->phase;
-	const FLT curve = bcal->curve;
-	const FLT tilt = bcal->tilt;
-	const FLT gibPhase = bcal->gibpha;
-	const FLT gibMag = bcal->gibmag;
-	const FLT ogeePhase = bcal->ogeephase;
-	const FLT ogeeMag = bcal->ogeemag;
-
-	FLT B = atan2(Z, X);
-
-	FLT Ydeg = tilt + (axis ? -1 : 1) * LINMATHPI / 6.;
-	FLT tanA = FLT_TAN(Ydeg);
-	FLT normXZ = FLT_SQRT(X * X + Z * Z);
+// Everything in the model which only depends on the calibration; the batch functions work this out once per call
+typedef struct reproject_axis_gen2_consts {
+	FLT phase, curve, gibPhase, gibMag, ogeePhase, ogeeMag;
+	FLT tanA, sinYdeg, cosYdeg;
+} reproject_axis_gen2_consts;
+
+static inline void reproject_axis_gen2_consts_init(reproject_axis_gen2_consts *c, const BaseStationCal *bcal,
+												   bool axis) {
+	FLT Ydeg = bcal->tilt + (axis ? -1 : 1) * LINMATHPI / 6.;
+	*c = (reproject_axis_gen2_consts){.phase = bcal->phase,
+									  .curve = bcal->curve,
+									  .gibPhase = bcal->gibpha,
+									  .gibMag = bcal->gibmag,
+									  .ogeePhase = bcal->ogeephase,
+									  .ogeeMag = bcal->ogeemag,
+									  .tanA = FLT_TAN(Ydeg),
+									  .sinYdeg = FLT_SIN(Ydeg),
+									  .cosYdeg = FLT_COS(Ydeg)};
+}
 
-	FLT asinArg = tanA * Y / normXZ;
+// B, normXZ and normXYZ don't depend on the axis, so the batch functions share them between x and y
+static inline FLT reproject_axis_gen2(const reproject_axis_gen2_consts *c, FLT Y, FLT B, FLT normXZ, FLT normXYZ) {
+	FLT asinArg = c->tanA * Y / normXZ;
 	FLT asinArg_sanitized = linmath_enforce_range(asinArg, -1, 1);
 
-	FLT sinYdeg = FLT_SIN(Ydeg);
-	FLT cosYdeg = FLT_COS(Ydeg);
-
-	FLT sinPart = FLT_SIN(B - FLT_ASIN(asinArg_sanitized) + ogeePhase) * ogeeMag;
+	FLT sinPart = FLT_SIN(B - FLT_ASIN(asinArg_sanitized) + c->ogeePhase) * c->ogeeMag;
 
-	FLT normXYZ = FLT_SQRT(X * X + Y * Y + Z * Z);
-
-	FLT modAsinArg = linmath_enforce_range(Y / normXYZ / cosYdeg, -1, 1);
+	FLT modAsinArg = linmath_enforce_range(Y / normXYZ / c->cosYdeg, -1, 1);
 
 	FLT asinOut = FLT_ASIN(modAsinArg);
 
 	FLT mod, acc;
 	calc_cal_series(asinOut, &mod, &acc);
 
-	FLT BcalCurved = sinPart + curve;
-	FLT asinArg2 = linmath_enforce_range(asinArg + mod * BcalCurved / (cosYdeg - acc * BcalCurved * sinYdeg), -1, 1);
+	FLT BcalCurved = sinPart + c->curve;
+	FLT asinArg2 =
+		linmath_enforce_range(asinArg + mod * BcalCurved / (c->cosYdeg - acc * BcalCurved * c->sinYdeg), -1, 1);
 
 	FLT asinOut2 = FLT_ASIN(asinArg2);
-	FLT sinOut2 = sin(B - asinOut2 + gibPhase);
+	FLT sinOut2 = sin(B - asinOut2 + c->gibPhase);
 
-	FLT rtn = B - asinOut2 + sinOut2 * gibMag - phase - LINMATHPI_2;
+	FLT rtn = B - asinOut2 + sinOut2 * c->gibMag - c->phase - LINMATHPI_2;
 	assert(!isnan(rtn));
 	return rtn;
 }
 
+static inline FLT survive_reproject_axis_gen2(const BaseStationCal *bcal, FLT X, FLT Y, FLT Z, bool axis) {
+	reproject_axis_gen2_consts c;
+	reproject_axis_gen2_consts_init(&c, bcal, axis);
+
+	FLT B = atan2(Z, X);
+	FLT normXZ = FLT_SQRT(X * X + Z * Z);
+	FLT normXYZ = FLT_SQRT(X * X + Y * Y + Z * Z);
+	return reproject_axis_gen2(&c, Y, B, normXZ, normXYZ);
+}
+
 static inline FLT survive_reproject_axis_x_gen2_inline(const BaseStationCal *bcal, LinmathVec3d const ptInLh) {
 	return survive_reproject_axis_gen2(&bcal[0], ptInLh[0], ptInLh[1], -ptInLh[2], 0);
 }
@@ -125,6 +138,24 @@ void survive_reproject_xy_gen2(const BaseStationCal *bcal, LinmathVec3d const pt
 	assert(!isnan(out[1]));
 }
 
+void survive_reproject_xy_batch_gen2(const BaseStationCal *bcal, size_t n, const FLT *x, const FLT *y, const FLT *z,
+									 FLT *out_x, FLT *out_y) {
+	reproject_axis_gen2_consts c[2];
+	reproject_axis_gen2_consts_init(&c[0], &bcal[0], 0);
+	reproject_axis_gen2_consts_init(&c[1], &bcal[1], 1);
+
+	for (size_t i = 0; i < n; i++) {
+		FLT X = x[i], Y = y[i], Z = -z[i];
+		FLT B = atan2(Z, X);
+		FLT normXZ = FLT_SQRT(X * X + Z * Z);
+		FLT normXYZ = FLT_SQRT(X * X + Y * Y + Z * Z);
+		if (out_x)
+			out_x[i] = reproject_axis_gen2(&c[0], Y, B, normXZ, normXYZ);
+		if (out_y)
+			out_y[i] = reproject_axis_gen2(&c[1], Y, B, normXZ, normXYZ);
+	}
+}
+
 void survive_reproject_from_pose_with_bcal_gen2(const BaseStationCal *bcal, const SurvivePose *world2lh,
 												LinmathVec3d const ptInWorld, SurviveAngleReading out) {
 	LinmathPoint3d ptInLh;
@@ -157,6 +188,7 @@ void survive_reproject_full_gen2(const BaseStationCal *bcal, const SurvivePose *
 const survive_reproject_model_t survive_reproject_gen2_model = {
 	.reprojectAxisFn = {survive_reproject_axis_x_gen2, survive_reproject_axis_y_gen2},
 	.reprojectXY = survive_reproject_xy_gen2,
+	.reprojectXYBatch = survive_reproject_xy_batch_gen2,
 	.reprojectAxisFullFn = {gen_reproject_axis_x_gen2, gen_reproject_axis_y_gen2},
 
 	.reprojectAxisJacobFn = {gen_reproject_axis_x_gen2_jac_obj_p, gen_reproject_axis_y_gen2_jac_obj_p},
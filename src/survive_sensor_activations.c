@@ -21,13 +21,20 @@ STRUCT_CONFIG_ITEM("filter-outlier-minimum-count", "Assumed minimum population f
 
 END_STRUCT_CONFIG_SECTION(SurviveSensorActivations)
 
-bool SurviveSensorActivations_is_reading_valid(const SurviveSensorActivations *self, survive_long_timecode tolerance,
-											   uint32_t sensor_idx, int lh, int axis) {
-	return SurviveSensorActivations_time_since_last_reading(self, sensor_idx, lh, axis) <= tolerance;
+static inline bool has_reading(const SurviveSensorActivations *self, uint32_t sensor_idx, int lh, int axis) {
+	return (self->readings[lh][axis] >> sensor_idx) & 1;
 }
 
-survive_long_timecode SurviveSensorActivations_last_reading(const SurviveSensorActivations *self, uint32_t sensor_idx,
-															int lh, int axis) {
+static inline void mark_reading(SurviveSensorActivations *self, uint32_t sensor_idx, int lh, int axis) {
+	self->readings[lh][axis] |= 1u << sensor_idx;
+	self->lighthouses |= 1u << lh;
+}
+
+static inline survive_long_timecode last_reading(const SurviveSensorActivations *self, uint32_t sensor_idx, int lh,
+												int axis) {
+	if (!has_reading(self, sensor_idx, lh, axis))
+		return UINT64_MAX;
+
 	const survive_long_timecode *data_timecode = self->timecode[sensor_idx][lh];
 	if (self->lh_gen != 1 && lh < 2 && self->lengths[sensor_idx][lh][axis] == 0)
 		return UINT64_MAX;
@@ -38,19 +45,37 @@ survive_long_timecode SurviveSensorActivations_last_reading(const SurviveSensorA
 	return data_timecode[axis];
 }
 
-survive_long_timecode SurviveSensorActivations_time_since_last_reading(const SurviveSensorActivations *self,
-																	   uint32_t sensor_idx, int lh, int axis) {
-	survive_long_timecode last_reading = SurviveSensorActivations_last_reading(self, sensor_idx, lh, axis);
+static inline survive_long_timecode time_since_last_reading(const SurviveSensorActivations *self, uint32_t sensor_idx,
+															int lh, int axis) {
+	survive_long_timecode last = last_reading(self, sensor_idx, lh, axis);
 	survive_long_timecode timecode_now = self->last_light;
 
-	if (last_reading > timecode_now)
+	if (last > timecode_now)
 		return UINT32_MAX;
 
-	return timecode_now - last_reading;
+	return timecode_now - last;
+}
+
+survive_long_timecode SurviveSensorActivations_last_reading(const SurviveSensorActivations *self, uint32_t sensor_idx,
+															int lh, int axis) {
+	return last_reading(self, sensor_idx, lh, axis);
+}
+
+survive_long_timecode SurviveSensorActivations_time_since_last_reading(const SurviveSensorActivations *self,
+																	   uint32_t sensor_idx, int lh, int axis) {
+	return time_since_last_reading(self, sensor_idx, lh, axis);
+}
+
+bool SurviveSensorActivations_is_reading_valid(const SurviveSensorActivations *self, survive_long_timecode tolerance,
+											   uint32_t sensor_idx, int lh, int axis) {
+	return time_since_last_reading(self, sensor_idx, lh, axis) <= tolerance;
 }
 
 bool SurviveSensorActivations_isPairValid(const SurviveSensorActivations *self, uint32_t tolerance,
 										  uint32_t timecode_now, uint32_t idx, int lh) {
+	if (!has_reading(self, idx, lh, 0) || !has_reading(self, idx, lh, 1))
+		return false;
+
 	const survive_long_timecode *data_timecode = self->timecode[idx][lh];
 	if (self->lh_gen != 1 && (self->lengths[idx][lh][0] == 0 || self->lengths[idx][lh][1] == 0))
 		return false;
@@ -197,15 +222,18 @@ SURVIVE_EXPORT void SurviveSensorActivations_valid_counts(SurviveSensorActivatio
 	survive_timecode sensor_time_window = tolerance == 0 ? SurviveSensorActivations_default_tolerance : tolerance;
 	SurviveContext *ctx = self->so->ctx;
 	for (int lh = 0; lh < ctx->activeLighthouses; lh++) {
-		if (!ctx->bsd[lh].PositionSet) {
+		if (!ctx->bsd[lh].PositionSet || !(self->lighthouses & (1u << lh))) {
 			continue;
 		}
 		bool seenLH = false;
-		for (uint8_t sensor = 0; sensor < self->so->sensor_ct; sensor++) {
+		uint32_t sensors = self->readings[lh][0] | self->readings[lh][1];
+		for (uint8_t sensor = 0; sensors && sensor < self->so->sensor_ct; sensor++, sensors >>= 1) {
+			if (!(sensors & 1)) {
+				continue;
+			}
 			bool seenAxis = false;
 			for (uint8_t axis = 0; axis < 2; axis++) {
-				survive_timecode last_reading =
-					SurviveSensorActivations_time_since_last_reading(self, sensor, lh, axis);
+				survive_timecode last_reading = time_since_last_reading(self, sensor, lh, axis);
 				bool isReadingValue = last_reading < sensor_time_window;
 
 				if (isReadingValue) {
@@ -257,6 +285,7 @@ bool SurviveSensorActivations_add_gen2(SurviveSensorActivations *self, struct Po
 			// fprintf(stderr, "Time %f\n", l->hdr.timecode / 48000000.);
 			*data_timecode = l->hdr.timecode;
 			*angle = l->angle;
+			mark_reading(self, l->sensor_id, l->lh, axis);
 		} else {
 			return false;
 		}
@@ -398,6 +427,7 @@ bool SurviveSensorActivations_add(SurviveSensorActivations *self, struct PoserDa
 	*angle = lightData->angle;
 	*data_timecode = lightData->hdr.timecode;
 	*length = (uint32_t)(_lightData->length * 48000000);
+	mark_reading(self, lightData->sensor_id, lightData->lh, axis);
 	if (lightData->hdr.timecode > self->last_light) {
 		if (self->last_light != 0 && lightData->hdr.timecode - self->last_light > 480000000) {
 			SV_WARN("Bad update");
@@ -464,10 +494,22 @@ SURVIVE_EXPORT survive_long_timecode SurviveSensorActivations_long_timecode_ligh
 FLT SurviveSensorActivations_difference(const SurviveSensorActivations *rhs, const SurviveSensorActivations *lhs) {
 	FLT rtn = 0;
 	int cnt = 0;
-	for (size_t i = 0; i < SENSORS_PER_OBJECT; i++) {
+	uint32_t shared[NUM_GEN1_LIGHTHOUSES][2], any = 0;
+	for (size_t lh = 0; lh < NUM_GEN1_LIGHTHOUSES; lh++) {
+		for (size_t axis = 0; axis < 2; axis++) {
+			shared[lh][axis] = rhs->readings[lh][axis] & lhs->readings[lh][axis];
+			any |= shared[lh][axis];
+		}
+	}
+
+	// Sensor major, same as the sum has always been taken in, so the result doesn't change in the last bits
+	for (size_t i = 0; any; i++, any >>= 1) {
+		if (!(any & 1)) {
+			continue;
+		}
 		for (size_t lh = 0; lh < NUM_GEN1_LIGHTHOUSES; lh++) {
 			for (size_t axis = 0; axis < 2; axis++) {
-				if (rhs->lengths[i][lh][axis] > 0 && lhs->lengths[i][lh][axis] > 0) {
+				if (((shared[lh][axis] >> i) & 1) && rhs->lengths[i][lh][axis] > 0 && lhs->lengths[i][lh][axis] > 0) {
 					FLT diff = rhs->angles[i][lh][axis] - lhs->angles[i][lh][axis];
 					rtn += diff * diff;
 					cnt++;
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Barriers for the seqlocks guarding data read without a lock: kalman tracker published state and shared memory
+ * slots.
+ *
+ * The writer stores seq + 1, fences, writes the data and then stores seq + 2 with release order. A reader loads seq,
+ * copies the data, fences and loads seq again; the copy is only good if seq was even and didn't change.
+ */
+
+#ifdef _MSC_VER
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+// _ReadWriteBarrier only stops the compiler; ARM64 also reorders loads and stores in hardware, so use a full fence
+static inline uint32_t survive_seq_load_acquire(const uint32_t *p) {
+	uint32_t v = *(const volatile uint32_t *)p;
+	MemoryBarrier();
+	return v;
+}
+#define SURVIVE_SEQ_LOAD_ACQUIRE(p) survive_seq_load_acquire(p)
+#define SURVIVE_SEQ_STORE_RELEASE(p, v)                                                                                \
+	do {                                                                                                               \
+		MemoryBarrier();                                                                                               \
+		*(volatile uint32_t *)(p) = (v);                                                                               \
+	} while (0)
+#define SURVIVE_SEQ_FENCE_ACQUIRE() MemoryBarrier()
+#define SURVIVE_SEQ_FENCE_RELEASE() MemoryBarrier()
+#else
+#define SURVIVE_SEQ_LOAD_ACQUIRE(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define SURVIVE_SEQ_STORE_RELEASE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define SURVIVE_SEQ_FENCE_ACQUIRE() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define SURVIVE_SEQ_FENCE_RELEASE() __atomic_thread_fence(__ATOMIC_RELEASE)
+#endif
@@ -0,0 +1,251 @@
+#include "survive_shm_publisher.h"
+
+#include <errno.h>
+#include <os_generic.h>
+#include <string.h>
+#include <survive_shm.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "survive_config.h"
+#include "survive_kalman_tracker.h"
+#include "survive_name_index.h"
+#include "survive_private.h"
+#include "survive_seqlock.h"
+
+STATIC_CONFIG_ITEM(SHM_PUBLISH, "shm-publish", 's',
+				   "Name of a shared memory region to publish object state into; see survive_shm.h for readers.", "")
+
+struct survive_shm_publisher {
+	SurviveContext *ctx;
+	SurviveShmHeader *header;
+	char os_name[128];
+#ifdef _WIN32
+	HANDLE mapping;
+#endif
+
+	// Serializes writers; pose, velocity and button updates for one object can come from different threads
+	og_mutex_t lock;
+	// Codename to slot; keys are the codenames stored in the slots themselves
+	survive_name_index slots;
+};
+
+static SurviveShmHeader *map_region(struct survive_shm_publisher *publisher) {
+	SurviveContext *ctx = publisher->ctx;
+#if defined(_WIN32)
+	publisher->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, 0, sizeof(SurviveShmHeader),
+											publisher->os_name);
+	if (publisher->mapping == 0) {
+		SV_WARN("Could not create shared memory region %s (%lu)", publisher->os_name, GetLastError());
+		return 0;
+	}
+	SurviveShmHeader *header =
+		(SurviveShmHeader *)MapViewOfFile(publisher->mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SurviveShmHeader));
+	if (header == 0) {
+		SV_WARN("Could not map shared memory region %s (%lu)", publisher->os_name, GetLastError());
+		CloseHandle(publisher->mapping);
+	}
+	return header;
+#elif defined(__ANDROID__)
+	SV_WARN("Shared memory publishing isn't supported on this platform");
+	return 0;
+#else
+	// Readers may run as other users; they only ever get read access
+	int fd = shm_open(publisher->os_name, O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		SV_WARN("Could not create shared memory region %s (%s)", publisher->os_name, strerror(errno));
+		return 0;
+	}
+	if (ftruncate(fd, sizeof(SurviveShmHeader)) != 0) {
+		SV_WARN("Could not size shared memory region %s (%s)", publisher->os_name, strerror(errno));
+		close(fd);
+		return 0;
+	}
+	void *mapped = mmap(0, sizeof(SurviveShmHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED) {
+		SV_WARN("Could not map shared memory region %s (%s)", publisher->os_name, strerror(errno));
+		return 0;
+	}
+	return (SurviveShmHeader *)mapped;
+#endif
+}
+
+static void unmap_region(struct survive_shm_publisher *publisher) {
+#if defined(_WIN32)
+	UnmapViewOfFile(publisher->header);
+	CloseHandle(publisher->mapping);
+#elif !defined(__ANDROID__)
+	munmap(publisher->header, sizeof(SurviveShmHeader));
+	shm_unlink(publisher->os_name);
+#endif
+}
+
+struct survive_shm_publisher *survive_shm_publisher_open(SurviveContext *ctx, const char *name) {
+	struct survive_shm_publisher *publisher = SV_CALLOC(sizeof(struct survive_shm_publisher));
+	publisher->ctx = ctx;
+	survive_shm_os_name(publisher->os_name, sizeof(publisher->os_name), name);
+
+	SurviveShmHeader *header = publisher->header = map_region(publisher);
+	if (header == 0) {
+		free(publisher);
+		return 0;
+	}
+
+	// The region can outlive a publisher which crashed. Readers check the magic last, so take it away while the
+	// layout is rewritten.
+	uint32_t generation = header->magic == SURVIVE_SHM_MAGIC ? header->generation + 1 : 1;
+	SURVIVE_SEQ_STORE_RELEASE(&header->magic, 0);
+	SURVIVE_SEQ_FENCE_RELEASE();
+	memset((char *)header + sizeof(header->magic), 0, sizeof(SurviveShmHeader) - sizeof(header->magic));
+	header->version = SURVIVE_SHM_VERSION;
+	header->header_size = sizeof(SurviveShmHeader);
+	header->object_size = sizeof(SurviveShmObject);
+	header->max_objects = SURVIVE_SHM_MAX_OBJECTS;
+	header->generation = generation;
+	header->alive = 1;
+	SURVIVE_SEQ_STORE_RELEASE(&header->magic, SURVIVE_SHM_MAGIC);
+
+	publisher->lock = OGCreateMutex();
+	SV_INFO("Publishing object state to shared memory region %s", publisher->os_name);
+	return publisher;
+}
+
+void survive_shm_publisher_close(struct survive_shm_publisher *publisher) {
+	if (publisher == 0) {
+		return;
+	}
+
+	SURVIVE_SEQ_STORE_RELEASE(&publisher->header->alive, 0);
+	unmap_region(publisher);
+	survive_name_index_free(&publisher->slots);
+	OGDeleteMutex(publisher->lock);
+	free(publisher);
+}
+
+// Opens the object's slot for writing, or returns 0 if every slot is taken. Must be followed by end_write.
+static SurviveShmObject *begin_write(struct survive_shm_publisher *publisher, const SurviveObject *so) {
+	SurviveShmHeader *header = publisher->header;
+
+	OGLockMutex(publisher->lock);
+	SurviveShmObject *slot = survive_name_index_get(&publisher->slots, so->codename);
+	if (slot == 0) {
+		if (header->object_cnt >= SURVIVE_SHM_MAX_OBJECTS) {
+			OGUnlockMutex(publisher->lock);
+			return 0;
+		}
+
+		// Readers only look at slots below object_cnt, so the identity is in place before it's published
+		slot = &header->objects[header->object_cnt];
+		strncpy(slot->codename, so->codename, sizeof(slot->codename) - 1);
+		strncpy(slot->serial_number, so->serial_number, sizeof(slot->serial_number) - 1);
+		SURVIVE_SEQ_STORE_RELEASE(&header->object_cnt, header->object_cnt + 1);
+		survive_name_index_put(&publisher->slots, slot->codename, slot);
+
+		SurviveContext *ctx = publisher->ctx;
+		SV_VERBOSE(10, "Publishing %s to shared memory slot %u", so->codename, header->object_cnt - 1);
+	}
+
+	SURVIVE_SEQ_STORE_RELEASE(&slot->seq, slot->seq + 1);
+	SURVIVE_SEQ_FENCE_RELEASE();
+	return slot;
+}
+
+static void end_write(struct survive_shm_publisher *publisher, SurviveShmObject *slot) {
+	slot->runtime = publisher->ctx->private_members ? survive_run_time(publisher->ctx) : 0;
+	slot->update_cnt++;
+	SURVIVE_SEQ_STORE_RELEASE(&slot->seq, slot->seq + 1);
+	OGUnlockMutex(publisher->lock);
+}
+
+// Covariance as of the tracker's latest report; only the position block is meaningful outside the error space
+static void write_covariance(SurviveShmObject *slot, const SurviveObject *so) {
+	const SurviveKalmanTracker *tracker = so->tracker;
+	if (tracker == 0 || tracker->model.P.data == 0) {
+		slot->flags &= ~(SURVIVE_SHM_OBJECT_HAS_POSITION_COVARIANCE | SURVIVE_SHM_OBJECT_HAS_POSE_COVARIANCE);
+		return;
+	}
+
+	int cnt = tracker->use_error_state ? 6 : 3;
+	memset(slot->covariance, 0, sizeof(slot->covariance));
+	for (int i = 0; i < cnt; i++) {
+		for (int j = 0; j < cnt; j++) {
+			slot->covariance[i * 6 + j] = cnMatrixGet(&tracker->model.P, i, j);
+		}
+	}
+	slot->flags |= tracker->use_error_state ? SURVIVE_SHM_OBJECT_HAS_POSE_COVARIANCE
+											: SURVIVE_SHM_OBJECT_HAS_POSITION_COVARIANCE;
+}
+
+void survive_shm_publisher_pose(struct survive_shm_publisher *publisher, SurviveObject *so,
+								survive_long_timecode timecode, const SurvivePose *pose) {
+	SurviveShmObject *slot = begin_write(publisher, so);
+	if (slot == 0) {
+		return;
+	}
+
+	slot->pose_timecode = timecode;
+	for (int i = 0; i < 3; i++) {
+		slot->pose[i] = pose->Pos[i];
+	}
+	for (int i = 0; i < 4; i++) {
+		slot->pose[3 + i] = pose->Rot[i];
+	}
+	slot->flags |= SURVIVE_SHM_OBJECT_HAS_POSE;
+	write_covariance(slot, so);
+	end_write(publisher, slot);
+}
+
+void survive_shm_publisher_velocity(struct survive_shm_publisher *publisher, SurviveObject *so,
+									survive_long_timecode timecode, const SurviveVelocity *velocity) {
+	SurviveShmObject *slot = begin_write(publisher, so);
+	if (slot == 0) {
+		return;
+	}
+
+	slot->velocity_timecode = timecode;
+	for (int i = 0; i < 3; i++) {
+		slot->velocity[i] = velocity->Pos[i];
+		slot->velocity[3 + i] = velocity->AxisAngleRot[i];
+	}
+	slot->flags |= SURVIVE_SHM_OBJECT_HAS_VELOCITY;
+	end_write(publisher, slot);
+}
+
+void survive_shm_publisher_button(struct survive_shm_publisher *publisher, SurviveObject *so) {
+	SurviveShmObject *slot = begin_write(publisher, so);
+	if (slot == 0) {
+		return;
+	}
+
+	slot->buttonmask = so->buttonmask;
+	slot->touchmask = so->touchmask;
+	for (int i = 0; i < SURVIVE_SHM_AXIS_COUNT; i++) {
+		slot->axis[i] = so->axis[i];
+	}
+	end_write(publisher, slot);
+}
+
+void survive_install_shm_publisher(SurviveContext *ctx) {
+	const char *name = survive_configs(ctx, SHM_PUBLISH_TAG, SC_GET, "");
+	if (name[0] == 0) {
+		return;
+	}
+
+	ctx->private_members->shm_publisher = survive_shm_publisher_open(ctx, name);
+}
+
+void survive_destroy_shm_publisher(SurviveContext *ctx) {
+	struct SurviveContext_private *pctx = ctx->private_members;
+	if (pctx && pctx->shm_publisher) {
+		survive_shm_publisher_close(pctx->shm_publisher);
+		pctx->shm_publisher = 0;
+	}
+}
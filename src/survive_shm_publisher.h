@@ -0,0 +1,40 @@
+#pragma once
+
+#include "survive.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Writes object state into the shared memory region described in survive_shm.h, for readers in other processes.
+ *
+ * Each update rewrites the object's slot under its seqlock. Writes from different threads are serialized by the
+ * publisher; readers are never waited on.
+ */
+struct survive_shm_publisher;
+
+/**
+ * Creates (or takes over) the region called name. ctx is only used for logging.
+ *
+ * @return 0 if the region couldn't be created
+ */
+SURVIVE_EXPORT struct survive_shm_publisher *survive_shm_publisher_open(SurviveContext *ctx, const char *name);
+/**
+ * Marks the region as no longer written to and removes its name; readers which already mapped it keep their mapping.
+ */
+SURVIVE_EXPORT void survive_shm_publisher_close(struct survive_shm_publisher *publisher);
+
+SURVIVE_EXPORT void survive_shm_publisher_pose(struct survive_shm_publisher *publisher, SurviveObject *so,
+											   survive_long_timecode timecode, const SurvivePose *pose);
+SURVIVE_EXPORT void survive_shm_publisher_velocity(struct survive_shm_publisher *publisher, SurviveObject *so,
+												   survive_long_timecode timecode, const SurviveVelocity *velocity);
+SURVIVE_EXPORT void survive_shm_publisher_button(struct survive_shm_publisher *publisher, SurviveObject *so);
+
+// Opens the region named by --shm-publish, if there is one
+void survive_install_shm_publisher(SurviveContext *ctx);
+void survive_destroy_shm_publisher(SurviveContext *ctx);
+
+#ifdef __cplusplus
+};
+#endif
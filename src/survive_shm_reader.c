@@ -0,0 +1,130 @@
+// Reader side of survive_shm.h. Built into libsurvive, and also straight into tools which don't link it, so this
+// only depends on the C runtime and the OS.
+
+#include <survive_shm.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "survive_seqlock.h"
+
+void survive_shm_os_name(char *out, size_t len, const char *name) {
+#ifdef _WIN32
+	snprintf(out, len, "Local\\%s", name);
+#else
+	snprintf(out, len, "%s%s", name[0] == '/' ? "" : "/", name);
+#endif
+}
+
+static void unmap(SurviveShmReader *reader) {
+#ifdef _WIN32
+	UnmapViewOfFile(reader->header);
+	CloseHandle(reader->mapping);
+#else
+	munmap((void *)reader->header, sizeof(SurviveShmHeader));
+#endif
+	memset(reader, 0, sizeof(*reader));
+}
+
+bool survive_shm_reader_open(SurviveShmReader *reader, const char *name) {
+	char os_name[128];
+	survive_shm_os_name(os_name, sizeof(os_name), name);
+	memset(reader, 0, sizeof(*reader));
+
+#ifdef _WIN32
+	reader->mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, os_name);
+	if (reader->mapping == 0) {
+		return false;
+	}
+	reader->header = (const SurviveShmHeader *)MapViewOfFile(reader->mapping, FILE_MAP_READ, 0, 0, 0);
+	if (reader->header == 0) {
+		CloseHandle(reader->mapping);
+		return false;
+	}
+#else
+	int fd = shm_open(os_name, O_RDONLY, 0);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SurviveShmHeader)) {
+		close(fd);
+		return false;
+	}
+	void *mapped = mmap(0, sizeof(SurviveShmHeader), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED) {
+		return false;
+	}
+	reader->header = (const SurviveShmHeader *)mapped;
+#endif
+
+	const SurviveShmHeader *header = reader->header;
+	if (SURVIVE_SEQ_LOAD_ACQUIRE(&header->magic) != SURVIVE_SHM_MAGIC || header->version != SURVIVE_SHM_VERSION ||
+		header->header_size != sizeof(SurviveShmHeader) || header->object_size != sizeof(SurviveShmObject)) {
+		unmap(reader);
+		return false;
+	}
+	return true;
+}
+
+void survive_shm_reader_close(SurviveShmReader *reader) {
+	if (reader->header == 0) {
+		return;
+	}
+	unmap(reader);
+}
+
+uint32_t survive_shm_object_count(const SurviveShmReader *reader) {
+	uint32_t cnt = SURVIVE_SEQ_LOAD_ACQUIRE(&reader->header->object_cnt);
+	return cnt < SURVIVE_SHM_MAX_OBJECTS ? cnt : SURVIVE_SHM_MAX_OBJECTS;
+}
+
+bool survive_shm_read_object(const SurviveShmReader *reader, uint32_t idx, SurviveShmObject *out) {
+	if (idx >= survive_shm_object_count(reader)) {
+		return false;
+	}
+
+	const SurviveShmObject *slot = &reader->header->objects[idx];
+	uint32_t seq;
+	do {
+		seq = SURVIVE_SEQ_LOAD_ACQUIRE(&slot->seq);
+		if (seq & 1) {
+			continue;
+		}
+		memcpy(out, (const void *)slot, sizeof(*out));
+		SURVIVE_SEQ_FENCE_ACQUIRE();
+	} while ((seq & 1) || seq != SURVIVE_SEQ_LOAD_ACQUIRE(&slot->seq));
+	out->seq = seq;
+	return true;
+}
+
+int survive_shm_find_object(const SurviveShmReader *reader, const char *codename) {
+	uint32_t cnt = survive_shm_object_count(reader);
+	for (uint32_t i = 0; i < cnt; i++) {
+		// Codenames are written once, before the slot is counted
+		if (strncmp(reader->header->objects[i].codename, codename, sizeof(reader->header->objects[i].codename)) == 0) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+bool survive_shm_publisher_alive(const SurviveShmReader *reader) {
+	return SURVIVE_SEQ_LOAD_ACQUIRE(&reader->header->alive) != 0;
+}
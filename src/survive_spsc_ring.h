@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "survive.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Lock free, fixed size, single producer / single consumer ring of fixed size slots.
+ *
+ * The producer fills the slot returned by survive_spsc_ring_reserve and then publishes it with
+ * survive_spsc_ring_commit; the consumer reads the slot returned by survive_spsc_ring_peek and hands it back with
+ * survive_spsc_ring_pop. No allocation or locking happens after init. When the ring is full, reserve returns 0 and the
+ * overflow counter is bumped; the producer is expected to drop the data.
+ */
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SURVIVE_SPSC_LOAD_ACQUIRE(p) (_ReadWriteBarrier(), *(volatile uint32_t *)(p))
+#define SURVIVE_SPSC_STORE_RELEASE(p, v)                                                                               \
+	do {                                                                                                               \
+		_ReadWriteBarrier();                                                                                           \
+		*(volatile uint32_t *)(p) = (v);                                                                               \
+	} while (0)
+#define SURVIVE_SPSC_CACHELINE __declspec(align(64))
+#else
+#define SURVIVE_SPSC_LOAD_ACQUIRE(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define SURVIVE_SPSC_STORE_RELEASE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define SURVIVE_SPSC_CACHELINE __attribute__((aligned(64)))
+#endif
+
+typedef struct survive_spsc_ring {
+	uint8_t *slots;
+	size_t slot_size;
+	uint32_t capacity, mask;
+
+	// Only written by the producer; index of the next slot to fill
+	SURVIVE_SPSC_CACHELINE uint32_t head;
+	uint32_t overflow_cnt, max_depth;
+
+	// Only written by the consumer; index of the next slot to read
+	SURVIVE_SPSC_CACHELINE uint32_t tail;
+} survive_spsc_ring;
+
+/**
+ * @param capacity rounded up to the next power of two
+ */
+static inline void survive_spsc_ring_init(survive_spsc_ring *ring, size_t slot_size, uint32_t capacity) {
+	uint32_t cap = 1;
+	while (cap < capacity)
+		cap <<= 1;
+
+	ring->slot_size = slot_size;
+	ring->capacity = cap;
+	ring->mask = cap - 1;
+	ring->slots = SV_CALLOC_N(cap, slot_size);
+	ring->head = ring->tail = ring->overflow_cnt = ring->max_depth = 0;
+}
+
+static inline void survive_spsc_ring_free(survive_spsc_ring *ring) {
+	free(ring->slots);
+	ring->slots = 0;
+	ring->capacity = ring->mask = 0;
+}
+
+static inline bool survive_spsc_ring_is_init(const survive_spsc_ring *ring) { return ring->slots != 0; }
+
+// Producer side
+static inline void *survive_spsc_ring_reserve(survive_spsc_ring *ring) {
+	uint32_t tail = SURVIVE_SPSC_LOAD_ACQUIRE(&ring->tail);
+	if (ring->head - tail >= ring->capacity) {
+		ring->overflow_cnt++;
+		return 0;
+	}
+	return ring->slots + (size_t)(ring->head & ring->mask) * ring->slot_size;
+}
+
+static inline void survive_spsc_ring_commit(survive_spsc_ring *ring) {
+	uint32_t head = ring->head + 1;
+	uint32_t depth = head - SURVIVE_SPSC_LOAD_ACQUIRE(&ring->tail);
+	if (depth > ring->max_depth)
+		ring->max_depth = depth;
+	SURVIVE_SPSC_STORE_RELEASE(&ring->head, head);
+}
+
+// Consumer side
+static inline void *survive_spsc_ring_peek(survive_spsc_ring *ring) {
+	uint32_t head = SURVIVE_SPSC_LOAD_ACQUIRE(&ring->head);
+	if (head == ring->tail)
+		return 0;
+	return ring->slots + (size_t)(ring->tail & ring->mask) * ring->slot_size;
+}
+
+static inline void survive_spsc_ring_pop(survive_spsc_ring *ring) {
+	SURVIVE_SPSC_STORE_RELEASE(&ring->tail, ring->tail + 1);
+}
+
+// Safe to call from either side; the answer may be stale by the time it's used.
+static inline uint32_t survive_spsc_ring_depth(const survive_spsc_ring *ring) {
+	return SURVIVE_SPSC_LOAD_ACQUIRE(&ring->head) - SURVIVE_SPSC_LOAD_ACQUIRE(&ring->tail);
+}
+
+#ifdef __cplusplus
+};
+#endif
@@ -0,0 +1,690 @@
+#include "survive_watchman.h"
+#include <string.h>
+
+#define AS_SHORT(a, b) ((uint16_t)(((uint16_t)a) << 8) | (0x00ff & b))
+#define HAS_FLAG(flags, flag) ((flags & (flag)) == (flag))
+
+#define NEED_BYTES(cnt)                                                                                                \
+	if (end - *ptr < (cnt)) {                                                                                          \
+		return SURVIVE_WATCHMAN_ERROR_TRUNCATED;                                                                       \
+	}
+
+static inline uint8_t pop_byte(const uint8_t **ptr) { return *((*ptr)++); }
+static inline int16_t pop_short(const uint8_t **ptr) {
+	uint16_t v = (*ptr)[0] | ((*ptr)[1] << 8);
+	*ptr += 2;
+	return (int16_t)v;
+}
+
+static survive_watchman_event *push_event(survive_watchman_packet *packet, enum survive_watchman_event_type type) {
+	if (packet->event_cnt >= SURVIVE_WATCHMAN_MAX_EVENTS) {
+		return 0;
+	}
+	survive_watchman_event *event = &packet->events[packet->event_cnt++];
+	event->type = type;
+	return event;
+}
+
+static inline survive_timecode fix_time24(survive_timecode time24, survive_timecode refTime) {
+	survive_timecode upper_ref = refTime & 0xFF000000u;
+	survive_timecode lower_ref = refTime & 0x00FFFFFFu;
+
+	if (lower_ref > time24 && lower_ref - time24 > (1 << 23u)) {
+		upper_ref += 0x01000000;
+	} else if (lower_ref < time24 && time24 - lower_ref > (1 << 23u) && upper_ref > 0) {
+		upper_ref -= 0x01000000;
+	}
+
+	return upper_ref | time24;
+}
+
+struct sensorData {
+	uint8_t sensorId;
+	uint8_t edgeCount;
+};
+
+/*
+ * ---=== LIGHT DATA STRUCTURE ===---
+ *
+ * | SensorData  | Time Deltas          | End Timestamp |
+ * ╔═════════════╦══════════════════════╦═══════════════╗
+ * ║ SS SS .. SS ║ DD DD DD DD DD .. DD ║ TT TT TT      ║
+ * ╚═════════════╩══════════════════════╩═══════════════╝
+ *
+ * Three parts to the packet, the sensor data which contains which sensors were triggered, and the times
+ * deltas between rising and falling of the sensor event. There are always two rising/falling events per
+ * sensor though the ordering is not simple as new sensor events may start before others are finished.
+ *
+ * The meaning and associated led with each 'event' is determined by the edge count as encoded within the
+ * sensor data (see below)
+ *
+ * The time deltas use variable length encoding, so we can't determine how many sensors are in the packet
+ * just from the packet length. However, we do know that there are always two times per sensor (rise and
+ * fall), so there are (2*Sensor)-1 deltas in the packet (-1 because the end time is 'known' yielding two
+ * times). Therefore, the general read process is thus:
+ *
+ *  1) Read off timestamp
+ *  2) Read the first byte from the start of the packet
+ *  3) Read one time delta from the end of the packet (We get two times from this since we know the 'end' time)
+ *  4) Repeatedly:
+ *     a) Read one byte from the start of the packet (Led/Flag)
+ *     b) Read two time deltas from the end of the packet (not including timestamp) [See encoding below]
+ *     c) Stop once we've read all data in the packet
+ *
+ *
+ * TT TT TT
+ * ~~~~~~~~
+ *  Timestamp of the last event [Little Endian]
+ *
+ * eg:
+ *  f6 b4 5b = 6010102
+ *
+ * DD
+ * ~~
+ *  Time deltas between events stored as variable length sequences. The lower 7 bits of each byte are
+ *  summed until a byte with the 8th bit set is encountered. [Little endian]
+ *
+ *   8 76543210
+ *  ╔═╦════════╗
+ *  ║S│Value   ║
+ *  ╚═╩════════╝
+ *    ╲  ╲_________ 7 Bits of time delta
+ *     ╲___________ Stop bit (1 = Value complete, 0 = Continue reading)
+ *
+ *  eg:
+ *      0 = 80       [(80 & 7F)                  = 0]
+ *    127 = FF       [(FF & 7F)                  = 127]
+ *    128 = 80 01    [(80 & 7F) + ((01 & 7F)<<7) = 128]
+ *    255 = FF 01    [(FF & 7F) + ((01 & 7F)<<7) = 255]
+ *    256 = 80 02    [(80 & 7F) + ((02 & 7F)<<7) = 256]
+ *  16383 = FF 7F    [(FF & 7F) + ((7F & 7F)<<7) = 16383]
+ *  16384 = 80 80 01 [(80 & 7F) + ((80 & 7F)<<7) + ((01 & 7F)<<14) = 16384]
+ *
+ *
+ *
+ * SS
+ * ~~
+ *  Packed data about which sensor was detected and how many time deltas it's associated event straddles.
+ *  1 Byte per sensor
+ *
+ *   876543 210
+ *  ╔══════╦═══╗
+ *  ║Sensor│EC ║
+ *  ╚══════╩═══╝
+ *    ╲      ╲____ Edge count
+ *     ╲__________ Sensor ID of the event
+ *
+ *  eg:
+ *    2B = Sensor 5, 3 edges [2B>>3 = 5, 2B & 03 = 3]
+ *
+ *
+ * Example full packet
+ * ===================
+ *
+ *   ┌──────┬───────┐
+ *   │Sensor│ Edges │
+ *   ├──────┼───────┤
+ *   │   5  │   3   │
+ *   │  10  │   1   │
+ *   │   9  │   2   │
+ *   │   5  │   0   │
+ *   │  12  │   0   │
+ *   └──────┴───────┘                           End Time : 6010102
+ *              ╲                               ╱
+ *               ╲                             ╱
+ *            ╔════════════════╦═┄┄┄┄┄┄┄┄┄┄┄═╦══════════╗
+ *            ║ 2b 51 4a 28 60 ║ Time Deltas ║ f6 b4 5b ║
+ *            ╚════════════════╩═┄┄┄┄┄┄┄┄┄┄┄═╩══════════╝
+ *                             ╱              ╲
+ *     _______________________╱                ╲_______________________
+ *    ╱                                                                ╲
+ *   ╱                                                                  ╲
+ *  ╔═══════╤═══════╤═══════╤══════════╤═══════╤════╤════╤═══════╤═══════╗
+ *  ║ c7 2e │ e6 66 │ 84 1f │ fb 31 0b │ d9 01 │ da │ ca │ db 02 │ e4 02 ║
+ *  ╠═══════╪═══════╪═══════╪══════════╪═══════╪════╪════╪═══════╪═══════╣
+ *  ║ 5959  | 13158 | 3972  | 186619   | 217   | 90 | 74 | 347   |356    ║
+ *  ╚═══════╧═══════╧═══════╧══════════╧═══════╧════╧════╧═══════╧═══════╝
+ *  │       │       │       │          │       │    │    │       │       │
+ *  ┕━━━━━━«E       │       │          │       │    │    │       │       │ -> Led 12 : 5799310 -> 5805269
+ *                  ┕━━━━━━«D          │       │    │    │       │       │ -> Led 5  : 5818427 -> 5822399
+ *                                     ┕━━━━━━━2━━━━2━━━«C       │       │ -> Led 9  : 6009018 -> 6009399
+ *                                             │    │    ┊       │       │
+ *                                             ┕━━━━3━━━━3━━━━━━━3━━━━━━«A -> Led 5  : 6009235 -> 6010102
+ *                                                  |    ┊       |
+ *                                                  ┕━━━━1━━━━━━«B         -> Led 10 : 6009325 -> 6009746
+ * Read order :
+ *  A : Ends at 'A' - Skip 3 edges to find start
+ *  B : Ends at 'B' - Skip 1 edge to find start
+ *  C : Ends at 'C' - Skip 2 edges to find start
+ *  D : Ends at 'D' (Since the 'end' edges from ABC have already been 'used'), ends at next edge
+ *  E : Ends at 'E' - Ends at next edge
+ *
+ * Returns 0 or a negative error code; the pulses are appended to the packet in ascending time order, and only if
+ * the whole light data decoded.
+ */
+static int decode_light(survive_watchman_packet *packet, survive_timecode reference_time, const uint8_t *payloadPtr,
+						const uint8_t *payloadEndPtr) {
+	if (payloadEndPtr - payloadPtr <= 3) {
+		return 0;
+	}
+
+	if ((*payloadPtr & 0xE0) == 0xE0) {
+		packet->notes |= SURVIVE_WATCHMAN_NOTE_NON_LIGHT_DATA;
+	}
+
+	// Step 1 - Extract deltas between events the corresponding sensors
+	enum { maxTimeIndex = 16, maxEvents = maxTimeIndex >> 1 };
+	size_t timeIndex = 0;
+	// A 17th time can be read before the count gets evened out below
+	uint32_t times[maxTimeIndex + 1] = {0};
+	uint8_t reportOrder[maxTimeIndex] = {0};
+	struct sensorData sensors[maxEvents];
+	LightcapElement les[maxEvents] = {0};
+
+	const uint8_t *idsPtr = payloadPtr;
+	const uint8_t *eventPtr = payloadEndPtr;
+
+	// Last three bytes of light data are the LSB of the time of the last event
+	eventPtr -= 4;
+	uint32_t lastEventTime =
+		((uint32_t)(packet->time >> 8) << 24) | (eventPtr[3] << 16) | (eventPtr[2] << 8) | (eventPtr[1] << 0);
+
+	// The general issue is that the 'time1' field isn't super in sync with the last 3 bytes we use for timing
+	// light events -- it can tip a smidge before those bytes see it or sometimes after. This can cause
+	// wild 1<<24 tick differences which break everything.
+	//
+	// We base it off IMU as a reference because light events can get blocked and it's not out of the ordinary
+	// to not see them for a second or two. (1 << 23) on a 48mhz clock is ~150ms; and the IMU is consistently
+	// much faster than that.
+	if (lastEventTime > reference_time && lastEventTime - reference_time > (1 << 23)) {
+		lastEventTime -= (1 << 24);
+	} else if (reference_time > lastEventTime && reference_time - lastEventTime > (1 << 23)) {
+		lastEventTime += (1 << 24);
+	}
+
+	times[0] = lastEventTime;
+
+	while (idsPtr + (timeIndex >> 1u) < eventPtr) {
+		// Obtain the timing to the previous event
+		// Variable length encoding [if bit 8 is 0, continue into next byte]
+		uint32_t timeDelta = 0;
+		const uint8_t *eventPtrStart = eventPtr;
+		while (true) {
+			timeDelta <<= 7;
+			timeDelta |= (*eventPtr & 0x7F);
+			if (((*(eventPtr--)) & 0x80) == 0x80)
+				break;
+
+			if (idsPtr + (timeIndex >> 1u) > eventPtr) {
+				eventPtr = eventPtrStart;
+				goto exit_while;
+			}
+		}
+		lastEventTime -= timeDelta;
+		if (timeIndex >= maxTimeIndex) {
+			return -8;
+		}
+		// Store the event time
+		times[++timeIndex] = lastEventTime;
+	}
+
+exit_while:
+	if (timeIndex == 0) {
+		return 0;
+	}
+	if (timeIndex % 2 == 0) {
+		timeIndex--;
+		do {
+			eventPtr++;
+		} while ((*eventPtr & 0x80) == 0);
+	}
+
+	size_t sensor_byte_cnt = eventPtr - idsPtr + 1;
+	if (sensor_byte_cnt > ((timeIndex >> 1) + 1)) {
+		// Likely gen2 data
+		idsPtr = eventPtr - (timeIndex >> 1);
+	}
+
+	// There are two time deltas per 'event'
+	for (int i = 0; i < (timeIndex >> 1) + 1; i++) {
+		sensors[i].sensorId = ((*idsPtr) >> 3) & 0x1F;
+		sensors[i].edgeCount = (*idsPtr) & 0x7;
+		idsPtr++;
+	}
+
+	// Step 2 - Convert events to pulses
+	size_t eventCount = (timeIndex + 1) >> 1; // timeIndex>>1 = There are always twice as many time events as sensors
+	timeIndex = -1;
+
+	for (int i = 0; i < eventCount; i++) {
+		// Get the end time (Increment and find the next 'unused' time)
+		while (times[++timeIndex] == 0)
+			if (timeIndex + 1 >= maxTimeIndex) {
+				return -2;
+			}
+		if (timeIndex >= maxTimeIndex) {
+			return -3;
+		}
+
+		// Get the start time
+		size_t startTimeIndex = timeIndex + (sensors[i].edgeCount + 1);
+		if (startTimeIndex >= maxTimeIndex) {
+			return -4;
+		}
+
+		// Store the start index so we can return in ascending time order
+		if (reportOrder[startTimeIndex] != 0) {
+			return -5;
+		}
+		reportOrder[startTimeIndex] = i + 1;
+
+		LightcapElement *le = &les[i];
+		le->sensor_id = sensors[i].sensorId;
+		le->timestamp = times[startTimeIndex];
+		le->length = times[timeIndex] - times[startTimeIndex];
+
+		// Flag the start time as 'used'
+		times[startTimeIndex] = 0;
+	}
+
+	for (int i = 0; i < maxTimeIndex; i++) {
+		if (reportOrder[i] != 0) {
+			const LightcapElement *le = &les[reportOrder[i] - 1];
+			if (!(le->length != 0 || le->timestamp != 0)) {
+				return -6;
+			}
+		}
+	}
+
+	if (packet->event_cnt + eventCount > SURVIVE_WATCHMAN_MAX_EVENTS) {
+		return -7;
+	}
+
+	// Later start times have lower indices
+	for (int i = maxTimeIndex - 1; i >= 0; i--) {
+		if (reportOrder[i] != 0) {
+			push_event(packet, SURVIVE_WATCHMAN_EVENT_LIGHTCAP)->lightcap = les[reportOrder[i] - 1];
+		}
+	}
+
+	return 0;
+}
+
+static enum survive_watchman_status decode_raw1(survive_watchman_packet *packet, survive_timecode reference_time,
+												const uint8_t **ptr, const uint8_t *end) {
+	uint8_t channel = 255;
+
+	while (*ptr < end) {
+		uint8_t data = **ptr;
+
+		if (data & 0x1u) {
+			// Since they flag for this; I assume multiples can appear in a single packet. Need to plug in
+			// second LH to find out...
+
+			if ((data & 0x0Au) != 0) {
+				// Currently I've only ever seen 0x1 if the 1 bit is set; I doubt they left 3 bits on the table
+				// though....
+				packet->notes |= SURVIVE_WATCHMAN_NOTE_UNKNOWN_RAW1;
+				return SURVIVE_WATCHMAN_OK;
+			}
+
+			// encodes like so: 0bcccc ?F?C
+			bool hasConflict = data & 0x04u;
+			if (hasConflict) {
+				packet->notes |= SURVIVE_WATCHMAN_NOTE_CHANNEL_CONFLICT;
+				packet->conflicted_channel = data >> 4u;
+			}
+			channel = data >> 4u;
+			(*ptr)++;
+			continue;
+		}
+
+		NEED_BYTES(4);
+		if (channel == 255) {
+			return SURVIVE_WATCHMAN_ERROR_NO_CHANNEL;
+		}
+
+		const uint8_t *word = *ptr;
+		uint32_t timecode = word[0] | (word[1] << 8) | (word[2] << 16) | ((uint32_t)word[3] << 24);
+		survive_watchman_event *event;
+
+		bool sync = timecode & 0x2u;
+		if (!sync) {
+			//                          O                               SC
+			//                         GO                               YH
+			//                         ET                               NA
+			//                    [??] NX[    24 bit time @ 48mhz      ]CN
+			// encodes like so: 0bXXXX ABTTT TTTT TTTT TTTT TTTT TTTT TTSC
+			if ((event = push_event(packet, SURVIVE_WATCHMAN_EVENT_SYNC)) == 0) {
+				return SURVIVE_WATCHMAN_ERROR_TOO_MANY_EVENTS;
+			}
+			event->sync.channel = channel;
+			event->sync.ootx = (timecode >> 26u) & 1u;
+			event->sync.gen = (timecode >> 27u) & 1u;
+			event->sync.timecode = fix_time24((timecode >> 2u) & 0xFFFFFFu, reference_time);
+		} else {
+			//                                                         SC
+			//                                                         YH
+			//                                                         NA
+			//                    [SNSR][    25 bit time @ 96mhz      ]CN
+			// encodes like so: 0bSSSS STTT TTTT TTTT TTTT TTTT TTTT TFSC
+
+			// Since nothing in libsurvive thinks anything is 96mhz; pass in a flag
+			if ((event = push_event(packet, SURVIVE_WATCHMAN_EVENT_SWEEP)) == 0) {
+				return SURVIVE_WATCHMAN_ERROR_TOO_MANY_EVENTS;
+			}
+			event->sweep.channel = channel;
+			event->sweep.sensor = timecode >> 27u;
+			event->sweep.half_clock = timecode & 0x4u;
+			event->sweep.timecode = fix_time24((timecode >> 3u) & 0xFFFFFFu, reference_time);
+		}
+
+		*ptr += 4;
+	}
+
+	return SURVIVE_WATCHMAN_OK;
+}
+
+static enum survive_watchman_status decode_imu(survive_watchman_packet *packet, survive_timecode *reference_time,
+											   const uint8_t **ptr, const uint8_t *end) {
+	// First byte is higher res time, followed by 6 shorts
+	NEED_BYTES(13);
+	survive_watchman_event *event = push_event(packet, SURVIVE_WATCHMAN_EVENT_IMU);
+	if (event == 0) {
+		return SURVIVE_WATCHMAN_ERROR_TOO_MANY_EVENTS;
+	}
+
+	uint8_t timeLSB = pop_byte(ptr);
+	for (int i = 0; i < 3; i++) {
+		event->imu.accel[i] = pop_short(ptr);
+	}
+	for (int i = 0; i < 3; i++) {
+		event->imu.gyro[i] = pop_short(ptr);
+	}
+	*reference_time = event->imu.timecode = ((uint32_t)packet->time << 16) | (timeLSB << 8);
+	return SURVIVE_WATCHMAN_OK;
+}
+
+static enum survive_watchman_status decode_input(survive_watchman_packet *packet, uint8_t flags, const uint8_t **ptr,
+												 const uint8_t *end) {
+	/*
+	 * Flags for input events are as follows:
+	 *
+	 * ┄╦═╤═╤═╦═╤═╤═╤═╤═╦┄
+	 *  │1│1│1│1│-│t│m│b│
+	 * ┄╩═╧═╧═╩═╧═╧═╧═╧═╩┄
+	 *
+	 * t: Trigger    1 = Trigger data present in event [1 Byte]  ╮
+	 * m: Motion     1 = Motion data present in event [4 Byte]   ├ If all 0, this is a gen 2 event [See below]
+	 * b: Button     1 = Button data present in event [1 Byte]   ╯
+	 *
+	 * Order of data in payload is as follows:
+	 * ┄╦═══════════════╦═══════════════╦═══════════════╦═══════════════╦
+	 *  ║ [Button/b]    ║ [Trigger/t]   ║ [Motion/t]    ║ [IMU Data/I]  ║
+	 * ┄╩═══════════════╩═══════════════╩═══════════════╩═══════════════╩
+	 */
+	survive_watchman_event event = {.type = SURVIVE_WATCHMAN_EVENT_INPUT};
+	bool firstGen = ((flags & 0x7) != 0);
+
+	if (firstGen) {
+		if (HAS_FLAG(flags, 0x1)) {
+			NEED_BYTES(1);
+			event.input.fields |= SURVIVE_WATCHMAN_INPUT_BUTTONS;
+			event.input.buttons = pop_byte(ptr);
+		}
+
+		if (HAS_FLAG(flags, 0x4)) {
+			NEED_BYTES(1);
+			event.input.fields |= SURVIVE_WATCHMAN_INPUT_TRIGGER;
+			event.input.trigger = pop_byte(ptr);
+		}
+
+		if (HAS_FLAG(flags, 0x2)) {
+			NEED_BYTES(4);
+			event.input.fields |= SURVIVE_WATCHMAN_INPUT_TOUCHPAD;
+			event.input.touchpad[0] = pop_short(ptr);
+			event.input.touchpad[1] = pop_short(ptr);
+		}
+	} else {
+		// Second gen event (Eg Knuckles proximity)
+		NEED_BYTES(1);
+		uint8_t genTwoType = pop_byte(ptr); // May be flags, but currently only observed to be 'a1' when knuckles
+		if (genTwoType != 0xA1) {
+			packet->error_byte = genTwoType;
+			return SURVIVE_WATCHMAN_ERROR_UNKNOWN_INPUT;
+		}
+
+		// Resistive contact sensors in buttons, then non-touching proximity to the middle, ring, pinky and index
+		// fingers, then squeeze strength and trackpad force
+		NEED_BYTES(7);
+		event.input.fields |= SURVIVE_WATCHMAN_INPUT_PROXIMITY;
+		event.input.touched = pop_byte(ptr);
+		for (int i = 0; i < 6; i++) {
+			event.input.proximity[i] = pop_byte(ptr);
+		}
+	}
+
+	survive_watchman_event *slot = push_event(packet, SURVIVE_WATCHMAN_EVENT_INPUT);
+	if (slot == 0) {
+		return SURVIVE_WATCHMAN_ERROR_TOO_MANY_EVENTS;
+	}
+	*slot = event;
+	return SURVIVE_WATCHMAN_OK;
+}
+
+static enum survive_watchman_status decode_battery(survive_watchman_packet *packet, const uint8_t **ptr,
+												   const uint8_t *end) {
+	NEED_BYTES(1);
+	survive_watchman_event *event = push_event(packet, SURVIVE_WATCHMAN_EVENT_BATTERY);
+	if (event == 0) {
+		return SURVIVE_WATCHMAN_ERROR_TOO_MANY_EVENTS;
+	}
+	event->battery = pop_byte(ptr);
+	return SURVIVE_WATCHMAN_OK;
+}
+
+static enum survive_watchman_status decode_lightcap(survive_watchman_packet *packet, const uint8_t **ptr,
+													const uint8_t *end, survive_timecode reference_time) {
+	packet->light = *ptr;
+	int light_error = decode_light(packet, reference_time, *ptr, end);
+	if (light_error < 0) {
+		packet->light_error = light_error;
+		return SURVIVE_WATCHMAN_ERROR_LIGHT;
+	}
+	*ptr = end;
+	return SURVIVE_WATCHMAN_OK;
+}
+
+#define CHECK_STATUS(x)                                                                                                \
+	if ((status = (x)) != SURVIVE_WATCHMAN_OK) {                                                                       \
+		return status;                                                                                                 \
+	}
+
+static enum survive_watchman_status decode_v1(survive_watchman_packet *packet, survive_timecode reference_time,
+											  const uint8_t **ptr, const uint8_t *end) {
+	enum survive_watchman_status status;
+
+	/*
+	 * Event Flags
+	 * ===========
+	 *
+	 * If input (button, touch, motion) data is present in packet:
+	 *   ┄╦═╤═╤═╦═╤═╤═╤═╤═╦┄
+	 *    ║1│1│1│1│I│-│-│-║
+	 *   ┄╩═╧═╧═╩═╧═╧═╧═╧═╩┄
+	 *
+	 * If battery data is present in a packet:
+	 *   ┄╦═╤═╤═╦═╤═╤═╤═╤═╦═══════════════╦┄
+	 *    ║1│1│1│0│?│?│?│1║ Battery       ║
+	 *   ┄╩═╧═╧═╩═╧═╧═╧═╧═╩═══════════════╩┄
+	 *    ▲                               │
+	 *    ╰───────────────────────────────╯
+	 *
+	 * If battery data is not present in packet (EG IMU only packets):
+	 *   ┄╦═╤═╤═╦═╤═╤═╤═╤═╦┄
+	 *    ║1│1│1│0│I│?│?│0║
+	 *   ┄╩═╧═╧═╩═╧═╧═╧═╧═╩┄
+	 *
+	 * I: IMU Data      1 = IMU Data present after event (13 Bytes)
+	 *                  0 = No IMU Data present after event
+	 *
+	 * Anything not starting with 111 is light data.
+	 */
+	while (*ptr < end && HAS_FLAG(**ptr, 0xE0)) {
+		// This is some kind of heartbeat
+		if (**ptr == 0xE2) {
+			packet->notes |= SURVIVE_WATCHMAN_NOTE_HEARTBEAT;
+			*ptr = end;
+			return SURVIVE_WATCHMAN_OK;
+		}
+
+		const uint8_t flags = pop_byte(ptr);
+		if (HAS_FLAG(flags, 0x10)) {
+			CHECK_STATUS(decode_input(packet, flags, ptr, end));
+		} else {
+			/*
+			 * Flags for non-input (status) events are as follows:
+			 *
+			 * ┄╦═╤═╤═╦═╤═╤═╤═╤═╦┄
+			 *  │1│1│1│0│-│?│?│b│
+			 * ┄╩═╧═╧═╩═╧═╧═╧═╧═╩┄
+			 *
+			 * b: Battery     1 = Battery data present in event [1 Byte] possibly followed by an another event or
+			 *                    light data
+			 */
+			if ((flags & 0x6) != 0) {
+				packet->error_byte = flags;
+				return SURVIVE_WATCHMAN_ERROR_UNKNOWN_STATUS;
+			}
+
+			if (HAS_FLAG(flags, 0x1)) {
+				CHECK_STATUS(decode_battery(packet, ptr, end));
+				continue;
+			}
+		}
+
+		if (HAS_FLAG(flags, 0x08)) {
+			CHECK_STATUS(decode_imu(packet, &reference_time, ptr, end));
+		}
+		break;
+	}
+
+	// Any remaining data after events (if any) have been read off is light data
+	if (*ptr < end) {
+		return decode_lightcap(packet, ptr, end, reference_time);
+	}
+	return SURVIVE_WATCHMAN_OK;
+}
+
+static enum survive_watchman_status decode_v2(const survive_watchman_decode_params *params,
+											  survive_watchman_packet *packet, const uint8_t **ptr,
+											  const uint8_t *end) {
+	/*
+	 * Watchman protocol V2 has the same time / size breakdown as V1 but is followed with a flags byte:
+	 *   0bIMPL xxxx
+	 *     ||||
+	 *     ||||- Has Light data
+	 *     |||- Has Input
+	 *     ||- Has Metadata
+	 *     |- Has IMU data
+	 *
+	 * and then each of the flagged sections in order IMU, metadata, input, light.
+	 */
+	enum survive_watchman_status status;
+	survive_timecode reference_time = params->reference_time;
+
+	NEED_BYTES(1);
+	uint8_t flags = pop_byte(ptr);
+
+	// Some kind of startup heartbeat?
+	if (flags == 0xe2) {
+		packet->notes |= SURVIVE_WATCHMAN_NOTE_HEARTBEAT;
+		return SURVIVE_WATCHMAN_OK;
+	}
+
+	if (HAS_FLAG(flags, 0x80)) {
+		CHECK_STATUS(decode_imu(packet, &reference_time, ptr, end));
+	}
+
+	// These things happen every 10 seconds
+	if (HAS_FLAG(flags, 0x40)) {
+		NEED_BYTES(1);
+		uint8_t marker_byte = pop_byte(ptr);
+
+		switch (marker_byte) {
+		case 0x80:
+			CHECK_STATUS(decode_battery(packet, ptr, end));
+			break;
+		case 0x20:
+			// Mode?
+			NEED_BYTES(1);
+			*ptr += 1;
+			break;
+		case 0x30:
+			// Only have seen zeros here
+			NEED_BYTES(2);
+			*ptr += 2;
+			break;
+		default:
+			packet->error_byte = marker_byte;
+			return SURVIVE_WATCHMAN_ERROR_UNKNOWN_METADATA;
+		}
+	}
+
+	if (HAS_FLAG(flags, 0x20)) {
+		NEED_BYTES(1);
+		uint8_t input_flags = pop_byte(ptr);
+		CHECK_STATUS(decode_input(packet, input_flags, ptr, end));
+	}
+
+	if (HAS_FLAG(flags, 0x10)) {
+		if (params->raw1) {
+			packet->light = *ptr;
+			return decode_raw1(packet, reference_time, ptr, end);
+		}
+		return decode_lightcap(packet, ptr, end, reference_time);
+	}
+
+	return SURVIVE_WATCHMAN_OK;
+}
+
+bool survive_watchman_decode(const survive_watchman_decode_params *params, const uint8_t *data, size_t length,
+							 survive_watchman_packet *packet) {
+	packet->event_cnt = 0;
+	packet->flags = packet->notes = packet->error_byte = packet->conflicted_channel = 0;
+	packet->light_error = 0;
+	packet->light = 0;
+	packet->payload = packet->payload_end = packet->read_end = data + (length < 3 ? length : 3);
+
+	/*
+	 * ---=== PACKET STRUCTURE ===---
+	 *
+	 * ╔═══════════════╦═══════════════╦═══════════════╦═════════════════════════════════════┄┄┄
+	 * ║Time MSB       ║Size           ║Time LSB       ║ Payload; 'Size - 1' bytes
+	 * ╚═══════════════╩═══════════════╩═══════════════╩═════════════════════════════════════┄┄┄
+	 */
+	if (length < 3 || (size_t)data[1] + 2 > length) {
+		packet->time = length >= 3 ? AS_SHORT(data[0], data[2]) : 0;
+		packet->status = SURVIVE_WATCHMAN_ERROR_SIZE;
+		return false;
+	}
+
+	packet->time = AS_SHORT(data[0], data[2]);
+	if (data[1] == 0) {
+		packet->status = SURVIVE_WATCHMAN_OK;
+		return true;
+	}
+
+	const uint8_t *ptr = packet->payload;
+	const uint8_t *end = packet->payload_end = data + 2 + data[1];
+	packet->flags = ptr < end ? *ptr : 0;
+
+	if (params->v2) {
+		packet->status = decode_v2(params, packet, &ptr, end);
+	} else {
+		packet->status = decode_v1(packet, params->reference_time, &ptr, end);
+	}
+	packet->read_end = ptr;
+
+	return packet->status == SURVIVE_WATCHMAN_OK;
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include "survive.h"
+
+/**
+ * Decoder for the RF packets watchman devices (trackers, controllers, knuckles) send through the dongle.
+ *
+ * survive_watchman_decode turns one packet into a small array of typed events. It has no side effects -- it doesn't
+ * touch any SurviveObject, log, or allocate -- so the driver decodes a packet first and dispatches its events to the
+ * hooks afterwards. Events come out in the order they appear in the packet; light is always last.
+ */
+
+// Each watchman report carries one or two of these
+#define SURVIVE_WATCHMAN_PACKET_SIZE 29
+#define SURVIVE_WATCHMAN_MAX_EVENTS 16
+
+enum survive_watchman_event_type {
+	// Gen1 pulse, with the sensor id as the device reports it
+	SURVIVE_WATCHMAN_EVENT_LIGHTCAP,
+	// Gen2 sync / sweep as reported in raw1 mode
+	SURVIVE_WATCHMAN_EVENT_SYNC,
+	SURVIVE_WATCHMAN_EVENT_SWEEP,
+	SURVIVE_WATCHMAN_EVENT_IMU,
+	SURVIVE_WATCHMAN_EVENT_INPUT,
+	SURVIVE_WATCHMAN_EVENT_BATTERY,
+};
+
+enum survive_watchman_input_fields {
+	SURVIVE_WATCHMAN_INPUT_BUTTONS = 1,
+	SURVIVE_WATCHMAN_INPUT_TRIGGER = 2,
+	SURVIVE_WATCHMAN_INPUT_TOUCHPAD = 4,
+	// Knuckles touch flags, finger proximity and squeeze force
+	SURVIVE_WATCHMAN_INPUT_PROXIMITY = 8,
+};
+
+typedef struct survive_watchman_event {
+	uint8_t type;
+	union {
+		LightcapElement lightcap;
+		struct {
+			uint8_t channel;
+			bool ootx, gen;
+			survive_timecode timecode;
+		} sync;
+		struct {
+			uint8_t channel, sensor;
+			bool half_clock;
+			survive_timecode timecode;
+		} sweep;
+		struct {
+			survive_timecode timecode;
+			int16_t accel[3], gyro[3];
+		} imu;
+		// Raw values off the wire; which ones are present is given by 'fields'
+		struct {
+			uint8_t fields;
+			uint8_t buttons, touched, trigger;
+			int16_t touchpad[2];
+			uint8_t proximity[6];
+		} input;
+		// Charge in the lower 7 bits, high bit set while charging
+		uint8_t battery;
+	};
+} survive_watchman_event;
+
+enum survive_watchman_status {
+	SURVIVE_WATCHMAN_OK = 0,
+	// The size byte claims more data than the packet holds
+	SURVIVE_WATCHMAN_ERROR_SIZE,
+	// A field ran past the end of the payload
+	SURVIVE_WATCHMAN_ERROR_TRUNCATED,
+	// Unrecognized event flags or type byte; 'error_byte' holds it. There is no telling how long the event is, so
+	// decoding stops there.
+	SURVIVE_WATCHMAN_ERROR_UNKNOWN_INPUT,
+	SURVIVE_WATCHMAN_ERROR_UNKNOWN_STATUS,
+	SURVIVE_WATCHMAN_ERROR_UNKNOWN_METADATA,
+	SURVIVE_WATCHMAN_ERROR_TOO_MANY_EVENTS,
+	SURVIVE_WATCHMAN_ERROR_LIGHT,
+	// Gen2 sync or sweep before any channel byte
+	SURVIVE_WATCHMAN_ERROR_NO_CHANNEL,
+};
+
+enum survive_watchman_notes {
+	SURVIVE_WATCHMAN_NOTE_HEARTBEAT = 1,
+	// Gen1 light data started with what looks like an event flags byte
+	SURVIVE_WATCHMAN_NOTE_NON_LIGHT_DATA = 2,
+	// More than one lighthouse is on 'conflicted_channel'
+	SURVIVE_WATCHMAN_NOTE_CHANNEL_CONFLICT = 4,
+	// Gen2 light data had a byte with unknown bits set; the rest of it was skipped
+	SURVIVE_WATCHMAN_NOTE_UNKNOWN_RAW1 = 8,
+};
+
+typedef struct survive_watchman_decode_params {
+	// Protocol with a flags byte up front; everything but gen1 era trackers and wands
+	bool v2;
+	// Light comes as gen2 sync / sweep words rather than gen1 pulses
+	bool raw1;
+	// Light timestamps only carry 24 bits; the upper ones come from the device's last IMU timecode. An IMU event
+	// earlier in the same packet takes over as the reference, as it would once dispatched.
+	survive_timecode reference_time;
+} survive_watchman_decode_params;
+
+typedef struct survive_watchman_packet {
+	uint16_t time;
+	// The first byte of the payload; the v2 flags or the first v1 event flags
+	uint8_t flags;
+	uint8_t status, notes;
+	// Error code of the gen1 light decoder when status is SURVIVE_WATCHMAN_ERROR_LIGHT
+	int8_t light_error;
+	uint8_t error_byte, conflicted_channel;
+
+	// These point into the decoded buffer. 'light' is 0 if decoding never got to light data; if it is set, any error
+	// came from the light data.
+	const uint8_t *payload, *payload_end, *light, *read_end;
+
+	size_t event_cnt;
+	survive_watchman_event events[SURVIVE_WATCHMAN_MAX_EVENTS];
+} survive_watchman_packet;
+
+/**
+ * Decodes a single watchman packet -- time MSB, size, time LSB, then the payload -- into 'packet'. Packets with a zero
+ * size byte decode to nothing.
+ *
+ * @param length Bytes available at 'data', normally SURVIVE_WATCHMAN_PACKET_SIZE
+ * @return Whether the packet decoded without error. Events decoded before an error are kept.
+ */
+SURVIVE_EXPORT bool survive_watchman_decode(const survive_watchman_decode_params *params, const uint8_t *data,
+											size_t length, survive_watchman_packet *packet);
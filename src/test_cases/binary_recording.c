@@ -0,0 +1,130 @@
+#include "../survive_binary_recording.h"
+#include "string.h"
+#include "test_case.h"
+
+static const char *sample_lines[] = {
+	"T20 CONFIG {\"lighthouse_config\": {}}\r\n",
+	"T20 Y 1 123456 0 1\n",
+	"T20 B 1 7 123556 0 +1.234560e-01\n",
+	"T20 W 0 3 123600 1\n",
+	"T20 i 3 998877 0.100000 0.200000 9.800000 0.010000 0.020000 0.030000  0.000000 0.000000 0.000000 0\r\n",
+	"T20 C 5 4000123 120\r\n",
+	"T20 L Y 5 1 2000 4000123 120 0\r\n",
+	"T20 S 5 -1 2000 4000123 120 0\r\n",
+	"T20 POSE 0.000000 0.000000 0.000000 1.000000 0.000000 0.000000 0.000000 \r\n",
+};
+
+TEST(BinaryRecording, TextRoundTrip) {
+	char data[512], text[512];
+	for (int i = 0; i < SURVIVE_ARRAY_SIZE(sample_lines); i++) {
+		survive_binary_record record = {.data = data};
+		int len = survive_binary_record_parse(sample_lines[i], &record.hdr, data, sizeof(data));
+		ASSERT_GE((double)len, 0.);
+
+		bool expect_typed = i != 0 && i != SURVIVE_ARRAY_SIZE(sample_lines) - 1;
+		bool typed = record.hdr.type != SURVIVE_BINARY_RECORD_TEXT;
+		ASSERT_EQ(typed, expect_typed);
+
+		survive_binary_record_format(&record, text, sizeof(text));
+		if (strcmp(text, sample_lines[i]) != 0) {
+			fprintf(stderr, "'%s' != '%s'\n", text, sample_lines[i]);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+TEST(BinaryRecording, WriteReadSeek) {
+	const char *fn = "test_binary_recording.svbr";
+	const int record_cnt = 20000;
+
+	survive_binary_writer *writer = survive_binary_writer_open(fn, 6);
+	if (writer == 0)
+		return -1;
+	ASSERT_EQ(survive_binary_writer_write_text(writer, 0, sample_lines[0], strlen(sample_lines[0])), 0);
+	for (int i = 0; i < record_cnt; i++) {
+		survive_binary_sweep_angle angle = {.angle = i * 1e-4, .timecode = i, .sensor_id = i % 32, .plane = i & 1};
+		ASSERT_EQ(survive_binary_writer_write(writer, i * .001, SURVIVE_BINARY_RECORD_SWEEP_ANGLE, "T20", &angle,
+											  sizeof(angle)),
+				  0);
+	}
+	ASSERT_EQ(survive_binary_writer_close(writer), 0);
+
+	survive_binary_reader *reader = survive_binary_reader_open(fn);
+	if (reader == 0)
+		return -1;
+	ASSERT_GT((double)survive_binary_reader_block_count(reader), 1.);
+	ASSERT_EQ(survive_binary_reader_block_has_text(reader, 0), 1);
+
+	survive_binary_record record;
+	ASSERT_EQ(survive_binary_reader_next(reader, &record), 1);
+	ASSERT_EQ(record.hdr.type, SURVIVE_BINARY_RECORD_TEXT);
+	for (int i = 0; i < record_cnt; i++) {
+		ASSERT_EQ(survive_binary_reader_next(reader, &record), 1);
+		ASSERT_EQ(record.hdr.type, SURVIVE_BINARY_RECORD_SWEEP_ANGLE);
+		const survive_binary_sweep_angle *angle = record.data;
+		ASSERT_EQ(angle->timecode, i);
+		ASSERT_DOUBLE_EQ(angle->angle, i * 1e-4);
+	}
+	ASSERT_EQ(survive_binary_reader_next(reader, &record), 0);
+
+	double seek_time = 12.3456;
+	size_t block = survive_binary_reader_find_block(reader, seek_time);
+	ASSERT_EQ(survive_binary_reader_seek_block(reader, block), 0);
+	ASSERT_EQ(survive_binary_reader_next(reader, &record), 1);
+	ASSERT_EQ(record.block, block);
+	ASSERT_GE(seek_time, record.hdr.time);
+
+	double last_time = record.hdr.time;
+	while (survive_binary_reader_next(reader, &record) > 0 && record.block == block) {
+		last_time = record.hdr.time;
+	}
+	ASSERT_GE(last_time, seek_time - .001);
+
+	survive_binary_reader_close(reader);
+	remove(fn);
+	return 0;
+}
+
+// An index count that can't fit in the file is ignored and the blocks are found by walking their headers
+TEST(BinaryRecording, CorruptIndexCount) {
+	const char *fn = "test_binary_recording_corrupt.svbr";
+	const int record_cnt = 100;
+
+	survive_binary_writer *writer = survive_binary_writer_open(fn, 6);
+	if (writer == 0)
+		return -1;
+	for (int i = 0; i < record_cnt; i++) {
+		survive_binary_sweep_angle angle = {.timecode = i};
+		ASSERT_EQ(survive_binary_writer_write(writer, i * .001, SURVIVE_BINARY_RECORD_SWEEP_ANGLE, "T20", &angle,
+											  sizeof(angle)),
+				  0);
+	}
+	ASSERT_EQ(survive_binary_writer_close(writer), 0);
+
+	// The footer starts with the index offset; the index with its magic and then the entry count
+	FILE *f = fopen(fn, "r+b");
+	uint64_t index_offset = 0;
+	uint32_t cnt = UINT32_MAX;
+	ASSERT_EQ(fseek(f, -16, SEEK_END), 0);
+	ASSERT_EQ(fread(&index_offset, sizeof(index_offset), 1, f), 1);
+	ASSERT_EQ(fseek(f, (long)index_offset + 4, SEEK_SET), 0);
+	ASSERT_EQ(fwrite(&cnt, sizeof(cnt), 1, f), 1);
+	fclose(f);
+
+	survive_binary_reader *reader = survive_binary_reader_open(fn);
+	if (reader == 0)
+		return -1;
+	ASSERT_EQ(survive_binary_reader_block_count(reader), 1);
+
+	survive_binary_record record;
+	for (int i = 0; i < record_cnt; i++) {
+		ASSERT_EQ(survive_binary_reader_next(reader, &record), 1);
+		ASSERT_EQ(((const survive_binary_sweep_angle *)record.data)->timecode, i);
+	}
+	ASSERT_EQ(survive_binary_reader_next(reader, &record), 0);
+
+	survive_binary_reader_close(reader);
+	remove(fn);
+	return 0;
+}
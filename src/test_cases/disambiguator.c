@@ -0,0 +1,170 @@
+#include "../survive_internal.h"
+#include "../survive_default_devices.h"
+#include "string.h"
+#include "test_case.h"
+
+#define SENSOR_CNT 16
+#define CYCLE_TICKS 1600000
+
+#define ACODE_TIMING(acode)                                                                                            \
+	((3000 + ((acode)&1) * 500 + (((acode) >> 1) & 1) * 1000 + (((acode) >> 2) & 1) * 2000) - 250)
+
+typedef struct {
+	int sensor_id, acode, timeinsweep;
+	uint32_t timecode, length, lh;
+} light_event;
+
+typedef struct {
+	light_event *events;
+	size_t cnt, cap;
+} light_log;
+
+static void record_light(SurviveObject *so, int sensor_id, int acode, int timeinsweep, survive_timecode timecode,
+						 survive_timecode length, uint32_t lh) {
+	light_log *log = so->ctx->user_ptr;
+	if (log->cnt == log->cap) {
+		log->cap = log->cap ? log->cap * 2 : 1024;
+		log->events = SV_REALLOC(log->events, log->cap * sizeof(light_event));
+	}
+	log->events[log->cnt++] = (light_event){sensor_id, acode, timeinsweep, timecode, length, lh};
+}
+
+static uint32_t rng = 1;
+static uint32_t next_rand() {
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+static size_t add_sync(LightcapElement *les, uint32_t timestamp, int acode) {
+	size_t cnt = 0;
+	int data = next_rand() % 2 ? 2 : 0;
+	for (int sensor = 0; sensor < SENSOR_CNT; sensor++) {
+		if (next_rand() % 10 == 0)
+			continue;
+		les[cnt++] = (LightcapElement){.sensor_id = sensor,
+									   .length = ACODE_TIMING(acode | data) + (int)(next_rand() % 200) - 100,
+									   .timestamp = timestamp + sensor * 3 + next_rand() % 3};
+	}
+	return cnt;
+}
+
+static size_t add_sweep(LightcapElement *les, uint32_t timestamp, int axis) {
+	size_t cnt = 0;
+	for (int sensor = 0; sensor < SENSOR_CNT; sensor++) {
+		if (next_rand() % 10 == 0)
+			continue;
+		uint32_t hit = 100000 + sensor * 12000 + axis * 30000 + next_rand() % 500;
+		les[cnt++] = (LightcapElement){
+			.sensor_id = sensor, .length = 150 + next_rand() % 250, .timestamp = timestamp + hit};
+
+		// The odd reflection, well after the real hit
+		if (next_rand() % 20 == 0) {
+			les[cnt++] = (LightcapElement){
+				.sensor_id = sensor, .length = 120 + next_rand() % 100, .timestamp = timestamp + hit + 4000};
+		}
+	}
+	return cnt;
+}
+
+/**
+ * Light from two gen1 lighthouses taking turns sweeping, following the table in disambiguator_statebased.c. The
+ * timestamps roll over partway through, and there is a gap of over a second where the object saw nothing.
+ */
+static size_t generate_lightcaps(LightcapElement *les, int cycles) {
+	static const int acodes[4][2] = {{4, 0}, {5, 1}, {0, 4}, {1, 5}};
+	uint32_t start = 0xFFFFFFFFu - 40u * CYCLE_TICKS;
+
+	size_t cnt = 0;
+	for (int cycle = 0; cycle < cycles; cycle++) {
+		if (cycle >= 60 && cycle < 100)
+			continue;
+
+		for (int step = 0; step < 4; step++) {
+			uint32_t t = start + (uint32_t)cycle * CYCLE_TICKS + step * 400000u;
+			cnt += add_sync(les + cnt, t, acodes[step][0]);
+			cnt += add_sync(les + cnt, t + 20000, acodes[step][1]);
+			cnt += add_sweep(les + cnt, t + 40000, step & 1);
+		}
+	}
+
+	// Reflections went in after their sweep's other hits; put everything back in time order
+	for (size_t i = 1; i < cnt; i++) {
+		LightcapElement le = les[i];
+		size_t j = i;
+		for (; j > 0 && (int32_t)(les[j - 1].timestamp - le.timestamp) > 0; j--)
+			les[j] = les[j - 1];
+		les[j] = le;
+	}
+	return cnt;
+}
+
+static SurviveContext *disambiguator_context(light_log *log, const char *name) {
+	char *args[] = {(char *)name, "--v", "0", "--configfile", "test-disambiguator.json"};
+	SurviveContext *ctx = survive_init(SURVIVE_ARRAY_SIZE(args), args);
+	if (ctx == 0)
+		return 0;
+
+	ctx->user_ptr = log;
+	survive_install_lightcap_fn(ctx, (lightcap_process_func)GetDriver("DisambiguatorStateBased"));
+	survive_install_light_fn(ctx, record_light);
+
+	SurviveObject *so = survive_create_device(ctx, "TST", 0, "TS0", 0);
+	so->sensor_ct = SENSOR_CNT;
+	survive_add_object(ctx, so);
+	return ctx;
+}
+
+// The same light fed one element at a time and in packets of up to 10 has to come out as the same light events
+TEST(Disambiguator, BatchMatchesPerElement) {
+	const int cycles = 160;
+	LightcapElement *les = SV_CALLOC_N(cycles * 4 * 4 * SENSOR_CNT, sizeof(LightcapElement));
+	size_t cnt = generate_lightcaps(les, cycles);
+
+	lightcaps_process_func lightcaps = (lightcaps_process_func)GetDriver("LightcapsStateBased");
+	ASSERT_EQ(lightcaps != 0, true);
+
+	light_log per_element = {0}, batched = {0};
+	SurviveContext *per_element_ctx = disambiguator_context(&per_element, "test-disambiguator-per-element");
+	SurviveContext *batched_ctx = disambiguator_context(&batched, "test-disambiguator-batched");
+	ASSERT_EQ(per_element_ctx && batched_ctx, true);
+
+	for (size_t i = 0; i < cnt; i++) {
+		per_element_ctx->lightcapproc(per_element_ctx->objs[0], &les[i]);
+	}
+
+	uint8_t *decisions = SV_CALLOC(cnt);
+	for (size_t i = 0; i < cnt;) {
+		size_t packet = 1 + next_rand() % 10;
+		if (packet > cnt - i)
+			packet = cnt - i;
+		lightcaps(batched_ctx->objs[0], les + i, packet, decisions + i);
+		i += packet;
+	}
+
+	size_t decision_cnts[SURVIVE_LIGHTCAP_FORWARDED + 1] = {0}, sweep_events = 0;
+	for (size_t i = 0; i < cnt; i++) {
+		decision_cnts[decisions[i]]++;
+	}
+	for (size_t i = 0; i < batched.cnt; i++) {
+		sweep_events += batched.events[i].sensor_id >= 0;
+	}
+
+	ASSERT_EQ(per_element.cnt, batched.cnt);
+	ASSERT_EQ(memcmp(per_element.events, batched.events, batched.cnt * sizeof(light_event)), 0);
+
+	// It has to have locked on, and stayed locked through the rollover and the gap, for this to mean anything
+	ASSERT_EQ(sweep_events > cycles * 2 * SENSOR_CNT, true);
+	ASSERT_EQ(decision_cnts[SURVIVE_LIGHTCAP_SWEEP] >= sweep_events, true);
+	ASSERT_EQ(decision_cnts[SURVIVE_LIGHTCAP_SYNC] > decision_cnts[SURVIVE_LIGHTCAP_SYNC_MISS], true);
+	ASSERT_EQ(decision_cnts[SURVIVE_LIGHTCAP_FORWARDED], 0);
+
+	survive_close(per_element_ctx);
+	survive_close(batched_ctx);
+	free(per_element.events);
+	free(batched.events);
+	free(decisions);
+	free(les);
+	return 0;
+}
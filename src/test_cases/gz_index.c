@@ -0,0 +1,115 @@
+#include "../survive_gz.h"
+#include "../survive_gz_index.h"
+#include "string.h"
+#include "test_case.h"
+
+static const int line_cnt = 200000;
+
+static int format_line(char *buffer, size_t len, int i) {
+	// A config line once in a while so there is state to replay
+	if (i % 50000 == 0)
+		return snprintf(buffer, len, "%0.6f T20 CONFIG {\"seq\": %d}\r\n", i * .001, i);
+	return snprintf(buffer, len, "%0.6f T20 W %d %d %d 0\n", i * .001, i % 32, i % 5, i * 7);
+}
+
+static int write_recording(const char *fn) {
+	gzFile f = gzopen(fn, "w6");
+	if (f == 0)
+		return -1;
+	char buffer[128];
+	for (int i = 0; i < line_cnt; i++) {
+		int len = format_line(buffer, sizeof(buffer), i);
+		gzwrite(f, buffer, len);
+	}
+	return gzclose(f) == Z_OK ? 0 : -1;
+}
+
+// Compares the extracted file against lines [first, last] of the recording
+static int check_extract(const char *fn, int first, int last) {
+	gzFile f = gzopen(fn, "r");
+	if (f == 0)
+		return -1;
+
+	char line[128], expected[128];
+	int rtn = 0;
+	for (int i = first; rtn == 0 && i <= last; i++) {
+		format_line(expected, sizeof(expected), i);
+		if (gzgets(f, line, sizeof(line)) == 0 || strcmp(line, expected) != 0) {
+			fprintf(stderr, "Extracted line %d isn't '%s'\n", i, expected);
+			rtn = -1;
+		}
+	}
+	if (rtn == 0 && gzgets(f, line, sizeof(line)) != 0)
+		rtn = -1;
+	gzclose(f);
+	return rtn;
+}
+
+static int build_seek(const char *fn, const char *idx_fn, const char *extract_fn) {
+	ASSERT_EQ(write_recording(fn), 0);
+
+	survive_gz_index *index = survive_gz_index_build(fn, 64 * 1024);
+	if (index == 0)
+		return -1;
+	ASSERT_GT((double)survive_gz_index_point_count(index), 10.);
+	ASSERT_EQ(survive_gz_index_point_offset(index, 0), 0);
+	ASSERT_EQ(survive_gz_index_state_line_count(index), line_cnt / 50000);
+	ASSERT_EQ(survive_gz_index_save(index, idx_fn), 0);
+	survive_gz_index_free(index);
+
+	index = survive_gz_index_load(fn, idx_fn);
+	if (index == 0)
+		return -1;
+
+	char expected[128];
+	char *line = 0;
+	size_t n = 0;
+	double targets[] = {0, 12.3456, 75.5, 150.001, 199.999};
+	for (int t = 0; t < SURVIVE_ARRAY_SIZE(targets); t++) {
+		size_t point = survive_gz_index_find_point(index, targets[t]);
+		ASSERT_GE(targets[t], survive_gz_index_point_time(index, point));
+
+		survive_gz_index_reader *reader = survive_gz_index_reader_open(index, fn, point);
+		if (reader == 0)
+			return -1;
+
+		// The first line after an access point is a whole line, and reading carries on up to the target. Starting
+		// from 0 has to give every line from the first one on.
+		int i = targets[t] == 0 ? 0 : (int)round(survive_gz_index_point_time(index, point) * 1000);
+		for (; i < line_cnt && i * .001 <= targets[t] + 1; i++) {
+			format_line(expected, sizeof(expected), i);
+			ASSERT_GT((double)survive_gz_index_reader_getdelim(reader, &line, &n, '\n'), 0.);
+			if (strcmp(line, expected) != 0) {
+				fprintf(stderr, "'%s' != '%s'\n", line, expected);
+				return -1;
+			}
+		}
+		if (i == line_cnt) {
+			ASSERT_EQ(survive_gz_index_reader_getdelim(reader, &line, &n, '\n'), -1);
+			ASSERT_EQ(survive_gz_index_reader_eof(reader), 1);
+		}
+		survive_gz_index_reader_close(reader);
+	}
+	free(line);
+
+	// Everything from the first line on
+	ASSERT_EQ(survive_gz_index_extract(index, fn, extract_fn, 0, 0.999), 1000);
+	ASSERT_EQ(check_extract(extract_fn, 0, 999), 0);
+
+	// The two configs before the range, then the range itself
+	ASSERT_EQ(survive_gz_index_extract(index, fn, extract_fn, 100, 100.999), 2 + 1000);
+	survive_gz_index_free(index);
+	return 0;
+}
+
+TEST(GzIndex, BuildSeek) {
+	const char *fn = "test_gz_index.rec.gz";
+	const char *idx_fn = "test_gz_index.rec.gz.idx";
+	const char *extract_fn = "test_gz_index_extract.rec";
+
+	int rtn = build_seek(fn, idx_fn, extract_fn);
+	remove(fn);
+	remove(idx_fn);
+	remove(extract_fn);
+	return rtn;
+}
@@ -0,0 +1,232 @@
+#include "../survive_kalman_fixed.h"
+#include "string.h"
+#include "test_case.h"
+
+#define N 16
+
+static FLT rand_range(FLT lo, FLT hi) { return lo + (hi - lo) * rand() / (FLT)RAND_MAX; }
+
+static void random_covariance(FLT *P, size_t n) {
+	FLT A[N * N];
+	for (size_t i = 0; i < n * n; i++)
+		A[i] = rand_range(-1, 1);
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = 0; j < n; j++) {
+			FLT v = i == j ? .1 : 0;
+			for (size_t k = 0; k < n; k++)
+				v += A[i * n + k] * A[j * n + k];
+			P[i * n + j] = v;
+		}
+	}
+}
+
+// Gauss-Jordan with partial pivoting; fine for the small, well conditioned S here
+static void invert(FLT *A, size_t m) {
+	FLT aug[SURVIVE_KALMAN_FIXED_MAX_MEAS][2 * SURVIVE_KALMAN_FIXED_MAX_MEAS];
+	for (size_t i = 0; i < m; i++) {
+		for (size_t j = 0; j < m; j++) {
+			aug[i][j] = A[i * m + j];
+			aug[i][m + j] = i == j;
+		}
+	}
+	for (size_t c = 0; c < m; c++) {
+		size_t p = c;
+		for (size_t r = c + 1; r < m; r++)
+			if (fabs(aug[r][c]) > fabs(aug[p][c]))
+				p = r;
+		for (size_t j = 0; j < 2 * m; j++) {
+			FLT t = aug[c][j];
+			aug[c][j] = aug[p][j];
+			aug[p][j] = t;
+		}
+		FLT d = aug[c][c];
+		for (size_t j = 0; j < 2 * m; j++)
+			aug[c][j] /= d;
+		for (size_t r = 0; r < m; r++) {
+			if (r == c)
+				continue;
+			FLT f = aug[r][c];
+			for (size_t j = 0; j < 2 * m; j++)
+				aug[r][j] -= f * aug[c][j];
+		}
+	}
+	for (size_t i = 0; i < m; i++)
+		for (size_t j = 0; j < m; j++)
+			A[i * m + j] = aug[i][m + j];
+}
+
+struct linear_model {
+	size_t n;
+	FLT H[SURVIVE_KALMAN_FIXED_MAX_MEAS * N];
+};
+
+static bool linear_meas(void *user, const struct CnMat *Z, const struct CnMat *x_t, struct CnMat *y,
+						struct CnMat *H_k) {
+	struct linear_model *model = user;
+	size_t n = model->n;
+	for (int k = 0; k < Z->rows; k++) {
+		FLT h = 0;
+		for (size_t j = 0; j < n; j++)
+			h += model->H[k * n + j] * x_t->data[j];
+		y->data[k] = Z->data[k] - h;
+	}
+	if (H_k)
+		memcpy(H_k->data, model->H, Z->rows * n * sizeof(FLT));
+	return true;
+}
+
+// x += K * (z - H * x); P -= K * H * P; K = P * H^T * (H * P * H^T + R)^-1
+static void reference_update(size_t n, size_t m, FLT *x, FLT *P, const FLT *H, const FLT *Z, const FLT *R) {
+	FLT PHt[N * SURVIVE_KALMAN_FIXED_MAX_MEAS], S[SURVIVE_KALMAN_FIXED_MAX_MEAS * SURVIVE_KALMAN_FIXED_MAX_MEAS];
+	FLT K[N * SURVIVE_KALMAN_FIXED_MAX_MEAS], y[SURVIVE_KALMAN_FIXED_MAX_MEAS], KHP[N * N];
+
+	for (size_t i = 0; i < n; i++)
+		for (size_t k = 0; k < m; k++) {
+			PHt[i * m + k] = 0;
+			for (size_t j = 0; j < n; j++)
+				PHt[i * m + k] += P[i * n + j] * H[k * n + j];
+		}
+	for (size_t k = 0; k < m; k++)
+		for (size_t l = 0; l < m; l++) {
+			S[k * m + l] = k == l ? R[k] : 0;
+			for (size_t j = 0; j < n; j++)
+				S[k * m + l] += H[k * n + j] * PHt[j * m + l];
+		}
+	invert(S, m);
+	for (size_t i = 0; i < n; i++)
+		for (size_t l = 0; l < m; l++) {
+			K[i * m + l] = 0;
+			for (size_t k = 0; k < m; k++)
+				K[i * m + l] += PHt[i * m + k] * S[k * m + l];
+		}
+	for (size_t k = 0; k < m; k++) {
+		y[k] = Z[k];
+		for (size_t j = 0; j < n; j++)
+			y[k] -= H[k * n + j] * x[j];
+	}
+	for (size_t i = 0; i < n; i++)
+		for (size_t k = 0; k < m; k++)
+			x[i] += K[i * m + k] * y[k];
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = 0; j < n; j++) {
+			KHP[i * n + j] = 0;
+			for (size_t k = 0; k < m; k++)
+				KHP[i * n + j] += K[i * m + k] * PHt[j * m + k];
+		}
+	for (size_t i = 0; i < n * n; i++)
+		P[i] -= KHP[i];
+}
+
+static int check_update(size_t n, size_t m) {
+	struct linear_model model = {.n = n};
+	FLT x[N], x_ref[N], P[N * N], P_ref[N * N], Z[SURVIVE_KALMAN_FIXED_MAX_MEAS], R[SURVIVE_KALMAN_FIXED_MAX_MEAS];
+
+	random_covariance(P, n);
+	memcpy(P_ref, P, sizeof(P));
+	for (size_t i = 0; i < n; i++)
+		x[i] = x_ref[i] = rand_range(-1, 1);
+	for (size_t i = 0; i < m * n; i++)
+		model.H[i] = rand_range(-1, 1);
+	for (size_t k = 0; k < m; k++) {
+		Z[k] = rand_range(-1, 1);
+		R[k] = rand_range(.01, .1);
+	}
+
+	CnMat Z_mat = cnMat(m, 1, Z);
+	// A linear model converges in one step, so the iterations after the first shouldn't move anything
+	bool clean = true;
+	FLT err = survive_kalman_fixed_sqrt_update(n, x, P, linear_meas, &model, &Z_mat, R, 5, -1, &clean);
+	ASSERT_GE(err, 0.);
+	ASSERT_EQ(clean, true);
+
+	reference_update(n, m, x_ref, P_ref, model.H, Z, R);
+	ASSERT_DOUBLE_ARRAY_EQ(n, x, x_ref);
+	ASSERT_DOUBLE_ARRAY_EQ(n * n, P, P_ref);
+	return 0;
+}
+
+TEST(KalmanFixed, UpdateMatchesReference) {
+	srand(42);
+	size_t sizes[] = {16, 13, 10, 7};
+	size_t meas[] = {1, 6, 32};
+	for (int i = 0; i < SURVIVE_ARRAY_SIZE(sizes); i++) {
+		ASSERT_EQ(survive_kalman_fixed_supported(sizes[i]), true);
+		for (int j = 0; j < SURVIVE_ARRAY_SIZE(meas); j++) {
+			if (check_update(sizes[i], meas[j]) != 0) {
+				fprintf(stderr, "Mismatch for %d states, %d measurements\n", (int)sizes[i], (int)meas[j]);
+				return -1;
+			}
+		}
+	}
+	ASSERT_EQ(survive_kalman_fixed_supported(15), false);
+	return 0;
+}
+
+TEST(KalmanFixed, PredictMatchesReference) {
+	srand(7);
+	const size_t n = N;
+	FLT P[N * N], P_ref[N * N], F[N * N], Q[N * N];
+	random_covariance(P, n);
+	random_covariance(Q, n);
+	for (size_t i = 0; i < n * n; i++)
+		F[i] = rand_range(-1, 1);
+
+	FLT FP[N * N];
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = 0; j < n; j++) {
+			FP[i * n + j] = 0;
+			for (size_t k = 0; k < n; k++)
+				FP[i * n + j] += F[i * n + k] * P[k * n + j];
+		}
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = 0; j < n; j++) {
+			P_ref[i * n + j] = Q[i * n + j];
+			for (size_t k = 0; k < n; k++)
+				P_ref[i * n + j] += FP[i * n + k] * F[j * n + k];
+		}
+
+	ASSERT_EQ(survive_kalman_fixed_sqrt_predict_covariance(n, P, F, Q), true);
+	ASSERT_DOUBLE_ARRAY_EQ(n * n, P, P_ref);
+	return 0;
+}
+
+// A covariance that round off has pushed slightly indefinite comes out of the square root update usable again
+TEST(KalmanFixed, SqrtRepairsIndefinite) {
+	srand(11);
+	const size_t n = 7;
+	struct linear_model model = {.n = n};
+	FLT x[N] = {0}, P[N * N], Z[1] = {.5}, R[1] = {.01};
+
+	// Rank deficient, then nudged below zero along one direction
+	FLT v[N];
+	for (size_t i = 0; i < n; i++)
+		v[i] = rand_range(-1, 1);
+	for (size_t i = 0; i < n; i++)
+		for (size_t j = 0; j < n; j++)
+			P[i * n + j] = (i == j ? 1e-6 : 0) + v[i] * v[j] - 1e-5 * (i == 0) * (j == 0);
+	for (size_t j = 0; j < n; j++)
+		model.H[j] = j == 0;
+
+	CnMat Z_mat = cnMat(1, 1, Z);
+	bool clean = true;
+	FLT err = survive_kalman_fixed_sqrt_update(n, x, P, linear_meas, &model, &Z_mat, R, 1, -1, &clean);
+	ASSERT_GE(err, 0.);
+	ASSERT_EQ(clean, false);
+
+	// Symmetric, and x^T P x >= 0 for a handful of directions
+	for (size_t i = 0; i < n; i++) {
+		ASSERT_GE(P[i * n + i], 0.);
+		for (size_t j = 0; j < n; j++)
+			ASSERT_DOUBLE_EQ(P[i * n + j], P[j * n + i]);
+	}
+	for (int trial = 0; trial < 16; trial++) {
+		FLT d[N], q = 0;
+		for (size_t i = 0; i < n; i++)
+			d[i] = rand_range(-1, 1);
+		for (size_t i = 0; i < n; i++)
+			for (size_t j = 0; j < n; j++)
+				q += d[i] * P[i * n + j] * d[j];
+		ASSERT_GE(q, -1e-12);
+	}
+	return 0;
+}
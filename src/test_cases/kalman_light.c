@@ -0,0 +1,139 @@
+#include "../survive_default_devices.h"
+#include "../survive_kalman_tracker.h"
+#include "string.h"
+#include "test_case.h"
+
+#define LIGHT_SENSOR_CNT 6
+#define LIGHT_LH_CNT 2
+
+static const SurvivePose light_lh_poses[LIGHT_LH_CNT] = {
+	{.Pos = {-3, .5, 1}, .Rot = {-0.70710678118, 0, 0.70710678118, 0}},
+	{.Pos = {3, -.5, 1.5}, .Rot = {0.70710678118, 0, 0.70710678118, 0}},
+};
+
+static const FLT light_sensors[LIGHT_SENSOR_CNT * 3] = {
+	.05, 0, .02, -.05, 0, .02, 0, .05, .03, 0, -.05, .03, .03, .03, -.04, -.03, -.03, -.04,
+};
+
+static SurviveContext *light_context(const char *name, bool error_state) {
+	char *args[] = {(char *)name,		"--v",	 "0", "--configfile", "test-kalman-light.json", "--kalman-use-error-space",
+					error_state ? "1" : "0"};
+	return survive_init(SURVIVE_ARRAY_SIZE(args), args);
+}
+
+static void setup_lighthouses(SurviveContext *ctx, int lh_version) {
+	ctx->lh_version = lh_version;
+	for (int lh = 0; lh < LIGHT_LH_CNT; lh++) {
+		BaseStationData *bsd = &ctx->bsd[lh];
+		bsd->PositionSet = 1;
+		bsd->Pose = light_lh_poses[lh];
+		for (int axis = 0; axis < 2; axis++) {
+			bsd->fcal[axis] = (BaseStationCal){.phase = .01 * (axis + 1),
+											   .tilt = -.02 + .01 * lh,
+											   .curve = .003,
+											   .gibpha = 1.2 + axis,
+											   .gibmag = .004,
+											   .ogeephase = lh_version ? .7 : 0,
+											   .ogeemag = lh_version ? -.2 : 0};
+		}
+	}
+}
+
+// Light from both lighthouses on both axes for every sensor, lighthouse by lighthouse as the tracker sorts it
+static size_t fill_light(SurviveKalmanTracker *tracker) {
+	size_t n = 0;
+	for (int lh = 0; lh < LIGHT_LH_CNT; lh++) {
+		for (int sensor = 0; sensor < LIGHT_SENSOR_CNT; sensor++) {
+			for (int axis = 0; axis < 2; axis++) {
+				tracker->savedLight[n++] = (LightInfo){.lh = lh, .sensor_idx = sensor, .axis = axis};
+			}
+		}
+	}
+	tracker->savedLight_idx = 0;
+	return n;
+}
+
+// h(x) from the batched path, which the tracker takes whenever it doesn't need a jacobian
+static bool batch_hx(SurviveKalmanTracker *tracker, size_t n, FLT *x, FLT *hx) {
+	FLT zeros[32] = {0};
+	CnMat Z = cnVec(n, zeros), X = cnVec(tracker->model.state_cnt, x), Y = cnVec(n, hx);
+	if (!survive_kalman_tracker_light_measurement_model(tracker, &Z, &X, &Y, 0))
+		return false;
+	for (size_t i = 0; i < n; i++)
+		hx[i] = -hx[i];
+	return true;
+}
+
+/*
+ * Compares the batched h(x) against the generated LightMeas path at a few states, some with a quaternion that isn't
+ * unit length as it is mid update, and the generated jacobian against central differences of the batched h(x). The
+ * position columns are the same in the plain and error state models; the plain model's quaternion columns are checked
+ * as well.
+ */
+static int check_light_model(const char *name, int lh_version, bool error_state) {
+	SurviveContext *ctx = light_context(name, error_state);
+	if (ctx == 0)
+		return -1;
+	setup_lighthouses(ctx, lh_version);
+
+	SurviveObject *so = survive_create_device(ctx, "TST", 0, "TS0", 0);
+	so->sensor_ct = LIGHT_SENSOR_CNT;
+	so->sensor_locations = SV_MALLOC(sizeof(light_sensors));
+	memcpy(so->sensor_locations, light_sensors, sizeof(light_sensors));
+
+	SurviveKalmanTracker *tracker = so->tracker;
+	tracker->lightcap_max_error = 0;
+	ASSERT_EQ(tracker->use_error_state, error_state);
+	size_t n = fill_light(tracker);
+
+	int state_cnt = tracker->model.state_cnt;
+	int cols = error_state ? tracker->model.error_state_size : state_cnt;
+	int checked_cols = error_state ? 3 : 7;
+
+	const SurvivePose states[] = {
+		{.Pos = {0, 0, 1}, .Rot = {1, 0, 0, 0}},
+		{.Pos = {.2, -.1, 1.2}, .Rot = {0.9238795, 0.3826834, 0, 0}},
+		{.Pos = {-.3, .2, .8}, .Rot = {0.8, 0.1, -0.3, 0.45}},
+	};
+	for (int trial = 0; trial < SURVIVE_ARRAY_SIZE(states); trial++) {
+		tracker->state = (SurviveKalmanModel){.Pose = states[trial]};
+		FLT x[64] = {0};
+		ASSERT_EQ((state_cnt <= 64), true);
+		memcpy(x, cn_as_const_vector(&tracker->model.state), state_cnt * sizeof(FLT));
+
+		FLT zeros[32] = {0}, y[32] = {0}, H[32 * 64] = {0}, hx[32] = {0};
+		CnMat Z = cnVec(n, zeros), X = cnVec(state_cnt, x), Y = cnVec(n, y), H_k = cnMat(n, cols, H);
+		ASSERT_EQ(survive_kalman_tracker_light_measurement_model(tracker, &Z, &X, &Y, &H_k), true);
+		ASSERT_EQ(batch_hx(tracker, n, x, hx), true);
+		for (size_t i = 0; i < n; i++) {
+			ASSERT_DOUBLE_EQ(hx[i], -y[i]);
+		}
+
+		for (int col = 0; col < checked_cols; col++) {
+			const FLT step = 1e-6;
+			FLT hx_plus[32], hx_minus[32];
+			FLT saved = x[col];
+			x[col] = saved + step;
+			ASSERT_EQ(batch_hx(tracker, n, x, hx_plus), true);
+			x[col] = saved - step;
+			ASSERT_EQ(batch_hx(tracker, n, x, hx_minus), true);
+			x[col] = saved;
+
+			for (size_t i = 0; i < n; i++) {
+				ASSERT_DOUBLE_EQ(cnMatrixGet(&H_k, i, col), (hx_plus[i] - hx_minus[i]) / (2 * step));
+			}
+		}
+	}
+
+	survive_close(ctx);
+	return 0;
+}
+
+TEST(Kalman, LightBatchMatchesGeneratedGen1) { return check_light_model("test-kalman-light-gen1", 0, false); }
+
+TEST(Kalman, LightBatchMatchesGeneratedGen2) { return check_light_model("test-kalman-light-gen2", 1, false); }
+
+TEST(Kalman, LightBatchMatchesGeneratedErrorState) {
+	ASSERT_EQ(check_light_model("test-kalman-light-error-gen1", 0, true), 0);
+	return check_light_model("test-kalman-light-error-gen2", 1, true);
+}
@@ -0,0 +1,80 @@
+#include "../survive_default_devices.h"
+#include "../survive_kalman_tracker.h"
+#include "os_generic.h"
+#include "string.h"
+#include "test_case.h"
+
+static const int publish_cnt = 200000;
+
+typedef struct {
+	SurviveKalmanTracker *tracker;
+	volatile bool done;
+} published_test;
+
+// Every published pose is (k, 2k, 3k), rotated k / 100 radians around z; with no velocity it predicts to itself
+static void published_pose(int k, SurvivePose *pose) {
+	FLT angle = k / 100.;
+	*pose = (SurvivePose){.Pos = {k, 2 * k, 3 * k}, .Rot = {cos(angle / 2), 0, 0, sin(angle / 2)}};
+}
+
+static void *publish_poses(void *_test) {
+	published_test *test = _test;
+	SurviveKalmanTracker *tracker = test->tracker;
+	for (int k = 1; k <= publish_cnt; k++) {
+		published_pose(k, &tracker->state.Pose);
+		tracker->model.t = k;
+		survive_kalman_tracker_publish_state(tracker, (survive_long_timecode)k * tracker->so->timebase_hz);
+	}
+	test->done = true;
+	return 0;
+}
+
+// Reads through survive_object_predict_pose while another thread keeps publishing; a torn copy would mix two poses
+TEST(Kalman, PredictPublishedWhileWriting) {
+	char *args[] = {"test-kalman-published", "--v", "0", "--configfile", "test-kalman-published.json"};
+	SurviveContext *ctx = survive_init(SURVIVE_ARRAY_SIZE(args), args);
+	if (ctx == 0)
+		return -1;
+
+	SurviveObject *so = survive_create_device(ctx, "TST", 0, "TS0", 0);
+	so->timebase_hz = 48000000;
+	SurviveKalmanTracker tracker = {0};
+	survive_kalman_tracker_init(&tracker, so);
+	tracker.report_in_imu = true;
+	memset(&tracker.state, 0, sizeof(tracker.state));
+	ctx->floor_offset = 0;
+	so->tracker = &tracker;
+
+	SurvivePose pose;
+	ASSERT_EQ(survive_object_predict_pose(so, 0, &pose), false);
+
+	published_test test = {.tracker = &tracker};
+	og_thread_t writer = OGCreateThread(publish_poses, "kalman publisher", &test);
+
+	size_t reads = 0, torn = 0;
+	while (!test.done || reads == 0) {
+		if (!survive_object_predict_pose(so, 0, &pose)) {
+			continue;
+		}
+		reads++;
+
+		// Positions are whole numbers, so anything but an exact match came from two different publishes
+		int k = (int)pose.Pos[0];
+		SurvivePose expected;
+		published_pose(k, &expected);
+		if (memcmp(pose.Pos, expected.Pos, sizeof(pose.Pos)) != 0 || fabs(pose.Rot[0] - expected.Rot[0]) > 1e-7 ||
+			fabs(pose.Rot[3] - expected.Rot[3]) > 1e-7) {
+			torn++;
+		}
+	}
+	OGJoinThread(writer);
+	ASSERT_EQ(torn, 0);
+
+	ASSERT_EQ(survive_object_predict_pose(so, 0, &pose), true);
+	ASSERT_DOUBLE_EQ(pose.Pos[0], publish_cnt);
+
+	so->tracker = 0;
+	survive_kalman_tracker_free(&tracker);
+	survive_close(ctx);
+	return 0;
+}
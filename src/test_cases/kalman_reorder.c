@@ -0,0 +1,217 @@
+#include "../survive_default_devices.h"
+#include "../survive_kalman_tracker.h"
+#include "survive_reproject.h"
+#include "string.h"
+#include "test_case.h"
+
+static const survive_long_timecode timebase_hz = 48000000;
+
+static PoserDataIMU imu_sample(int i) {
+	PoserDataIMU imu = {.hdr = {.pt = POSERDATA_IMU, .timecode = (survive_long_timecode)i * timebase_hz / 1000},
+						.datamask = 3};
+	FLT t = i / 1000.;
+	imu.accel[0] = .1 * sin(t * 3);
+	imu.accel[2] = 1 + .05 * cos(t * 5);
+	imu.gyro[1] = .2 * sin(t * 7);
+	return imu;
+}
+
+static void observe(SurviveKalmanTracker *tracker, int i) {
+	FLT t = i / 1000.;
+	SurvivePose pose = {.Pos = {.01 * t, .02 * sin(t), 1}, .Rot = {1}};
+	PoserData pd = {.pt = POSERDATA_LIGHT, .timecode = (survive_long_timecode)i * timebase_hz / 1000};
+	survive_kalman_tracker_integrate_observation(&pd, tracker, &pose, 0);
+}
+
+#define LIGHT_SENSOR_CNT 8
+
+// A handful of sensors seen by one lighthouse 2m above the object
+static SurviveObject *light_device(SurviveContext *ctx) {
+	SurviveObject *so = survive_create_device(ctx, "TST", 0, "TS0", 0);
+	so->timebase_hz = timebase_hz;
+	so->imu_freq = 1000;
+	so->sensor_ct = LIGHT_SENSOR_CNT;
+	so->sensor_locations = SV_CALLOC(sizeof(FLT) * 3 * LIGHT_SENSOR_CNT);
+	so->sensor_normals = SV_CALLOC(sizeof(FLT) * 3 * LIGHT_SENSOR_CNT);
+	for (int i = 0; i < LIGHT_SENSOR_CNT; i++) {
+		so->sensor_locations[i * 3 + 0] = .05 * cos(i);
+		so->sensor_locations[i * 3 + 1] = .05 * sin(i);
+		so->sensor_locations[i * 3 + 2] = .01 * (i % 3);
+		so->sensor_normals[i * 3 + 2] = 1;
+	}
+
+	// Stationary, so the variance trackers collect samples too
+	so->activations.last_movement = 1;
+	so->activations.last_imu = 10 * timebase_hz;
+
+	ctx->lh_version = 1;
+	ctx->bsd[0].PositionSet = 1;
+	ctx->bsd[0].Pose = (SurvivePose){.Pos = {0, 0, 3}, .Rot = {1}};
+	return so;
+}
+
+typedef struct {
+	PoserDataLightGen2 meas[LIGHT_SENSOR_CNT * 2];
+	// The next sync hands the batch to the filter
+	PoserDataLightGen2 sync;
+} light_batch;
+
+static light_batch light_sample(SurviveContext *ctx, SurviveObject *so, int i) {
+	FLT t = i / 1000.;
+	SurvivePose obj2world = {.Pos = {.01 * t, .02 * sin(t), 1}, .Rot = {1}};
+	SurvivePose world2lh = InvertPoseRtn(&ctx->bsd[0].Pose);
+	survive_long_timecode timecode = (survive_long_timecode)i * timebase_hz / 1000;
+
+	light_batch batch = {.sync = {.common = {.hdr = {.pt = POSERDATA_SYNC_GEN2, .timecode = timecode}}}};
+	for (int j = 0; j < LIGHT_SENSOR_CNT * 2; j++) {
+		int sensor = j / 2, plane = j % 2;
+		PoserDataLightGen2 *l = &batch.meas[j];
+		l->common.hdr = (PoserData){.pt = POSERDATA_LIGHT_GEN2, .timecode = timecode};
+		l->common.sensor_id = sensor;
+		l->plane = plane;
+		l->common.angle = survive_reproject_model(ctx)->reprojectAxisFullFn[plane](
+			&obj2world, &so->sensor_locations[sensor * 3], &world2lh, ctx->bsd[0].fcal + plane);
+	}
+	return batch;
+}
+
+static void integrate_light_batch(SurviveKalmanTracker *tracker, light_batch *batch) {
+	for (int j = 0; j < LIGHT_SENSOR_CNT * 2; j++) {
+		survive_kalman_tracker_integrate_light(tracker, &batch->meas[j].common);
+	}
+	survive_kalman_tracker_integrate_light(tracker, &batch->sync.common);
+}
+
+static int check_variance_eq(const struct variance_tracker *a, const struct variance_tracker *b) {
+	ASSERT_EQ(a->counts, b->counts);
+	ASSERT_EQ(a->variance.n, b->variance.n);
+	ASSERT_EQ(memcmp(a, b, sizeof(*a)), 0);
+	return 0;
+}
+
+// One tracker gets every measurement in order; the other gets some IMU samples a few ms late. Once the late ones are
+// slotted back in they should end up in the same place.
+TEST(Kalman, ReorderMatchesInOrder) {
+	char *args[] = {"test-kalman-reorder", "--v", "0", "--configfile", "test-kalman-reorder.json",
+					"--kalman-reorder-window", ".05"};
+	SurviveContext *ctx = survive_init(SURVIVE_ARRAY_SIZE(args), args);
+	if (ctx == 0)
+		return -1;
+
+	SurviveObject *so = survive_create_device(ctx, "TST", 0, "TS0", 0);
+	so->timebase_hz = timebase_hz;
+	so->imu_freq = 1000;
+
+	SurviveKalmanTracker in_order = {0}, reordered = {0};
+	survive_kalman_tracker_init(&in_order, so);
+	survive_kalman_tracker_init(&reordered, so);
+	ASSERT_GT(reordered.reorder.window, 0.);
+
+	const int delay = 5;
+	PoserDataIMU held = {0};
+	for (int i = 1; i <= 500 + delay; i++) {
+		if (i % 10 == 0) {
+			observe(&in_order, i);
+			observe(&reordered, i);
+		}
+
+		PoserDataIMU imu = imu_sample(i);
+		survive_kalman_tracker_integrate_imu(&in_order, &imu);
+		if (i % 50 == 0) {
+			held = imu;
+		} else {
+			survive_kalman_tracker_integrate_imu(&reordered, &imu);
+		}
+		if (i > 50 && i % 50 == delay) {
+			survive_kalman_tracker_integrate_imu(&reordered, &held);
+		}
+	}
+
+	ASSERT_EQ(reordered.reorder.stats.replays, 10);
+	ASSERT_EQ(reordered.reorder.stats.late_dropped, 0);
+	ASSERT_EQ(in_order.stats.imu_count, reordered.stats.imu_count);
+	ASSERT_DOUBLE_EQ(in_order.model.t, reordered.model.t);
+	ASSERT_DOUBLE_ARRAY_EQ(in_order.model.state_cnt, in_order.model.state.data, reordered.model.state.data);
+	ASSERT_DOUBLE_ARRAY_EQ(in_order.model.P.rows * in_order.model.P.cols, in_order.model.P.data,
+						   reordered.model.P.data);
+
+	// Past the window it's dropped rather than replayed
+	SurviveKalmanModel state = reordered.state;
+	PoserDataIMU too_late = imu_sample(400);
+	survive_kalman_tracker_integrate_imu(&reordered, &too_late);
+	ASSERT_EQ(reordered.reorder.stats.late_dropped, 1);
+	ASSERT_EQ(memcmp(&state, &reordered.state, sizeof(state)), 0);
+
+	survive_kalman_tracker_free(&in_order);
+	survive_kalman_tracker_free(&reordered);
+	survive_close(ctx);
+	return 0;
+}
+
+// Same again with light batches a few ms late. The light, pose and IMU variance trackers should see every sample once
+// even though the replays run the measurements after the late batch through the filter a second time.
+TEST(Kalman, ReorderLateLight) {
+	char *args[] = {"test-kalman-reorder-light", "--v", "0", "--configfile", "test-kalman-reorder-light.json",
+					"--kalman-reorder-window", ".05", "--light-ignore-threshold", "0"};
+	SurviveContext *ctx = survive_init(SURVIVE_ARRAY_SIZE(args), args);
+	if (ctx == 0)
+		return -1;
+
+	SurviveObject *so = light_device(ctx);
+	SurviveKalmanTracker in_order = {0}, reordered = {0};
+	survive_kalman_tracker_init(&in_order, so);
+	survive_kalman_tracker_init(&reordered, so);
+
+	const int delay = 3;
+	light_batch held = {0};
+	for (int i = 1; i <= 500 + delay; i++) {
+		if (i % 10 == 0) {
+			observe(&in_order, i);
+			observe(&reordered, i);
+		}
+
+		PoserDataIMU imu = imu_sample(i);
+		survive_kalman_tracker_integrate_imu(&in_order, &imu);
+		survive_kalman_tracker_integrate_imu(&reordered, &imu);
+
+		if (i % 10 == 5) {
+			light_batch batch = light_sample(ctx, so, i);
+			integrate_light_batch(&in_order, &batch);
+			if (i % 50 == 25) {
+				held = batch;
+			} else {
+				integrate_light_batch(&reordered, &batch);
+			}
+		}
+		if (i % 50 == 25 + delay) {
+			integrate_light_batch(&reordered, &held);
+		}
+	}
+
+	ASSERT_EQ(reordered.reorder.stats.replays, 10);
+	ASSERT_EQ(reordered.reorder.stats.late_dropped, 0);
+	ASSERT_GT((FLT)in_order.stats.lightcap_count, 0.);
+	ASSERT_EQ(in_order.stats.lightcap_count, reordered.stats.lightcap_count);
+	ASSERT_DOUBLE_ARRAY_EQ(in_order.model.state_cnt, in_order.model.state.data, reordered.model.state.data);
+	ASSERT_DOUBLE_ARRAY_EQ(in_order.model.P.rows * in_order.model.P.cols, in_order.model.P.data,
+						   reordered.model.P.data);
+
+	ASSERT_EQ(check_variance_eq(&in_order.imu_variance, &reordered.imu_variance), 0);
+	ASSERT_EQ(check_variance_eq(&in_order.pose_variance, &reordered.pose_variance), 0);
+	ASSERT_GT((FLT)in_order.light_variance[0][0][0].variance.n, 0.);
+	for (int sensor = 0; sensor < LIGHT_SENSOR_CNT; sensor++) {
+		for (int plane = 0; plane < 2; plane++) {
+			ASSERT_EQ(check_variance_eq(&in_order.light_variance[0][sensor][plane],
+										&reordered.light_variance[0][sensor][plane]),
+					  0);
+		}
+	}
+
+	survive_kalman_tracker_free(&in_order);
+	survive_kalman_tracker_free(&reordered);
+	free(so->sensor_locations);
+	free(so->sensor_normals);
+	so->sensor_locations = so->sensor_normals = 0;
+	survive_close(ctx);
+	return 0;
+}
@@ -0,0 +1,162 @@
+#include "../survive_kalman_smoother.h"
+#include "string.h"
+#include "test_case.h"
+
+// Constant velocity in one dimension, with position measurements; small enough to write the full RTS out by hand
+#define STEPS 400
+static const FLT dt = .01, q = .5, r = .01;
+
+static FLT rand_range(FLT lo, FLT hi) { return lo + (hi - lo) * rand() / (FLT)RAND_MAX; }
+
+static void cv_predict(void *user, FLT dt, const FLT *x0, FLT *x1, FLT *F) {
+	x1[0] = x0[0] + dt * x0[1];
+	x1[1] = x0[1];
+	FLT f[] = {1, dt, 0, 1};
+	memcpy(F, f, sizeof(f));
+}
+
+static void cv_process_noise(void *user, FLT dt, const FLT *x, FLT *Q) {
+	Q[0] = q * dt * dt * dt / 3;
+	Q[1] = Q[2] = q * dt * dt / 2;
+	Q[3] = q * dt;
+}
+
+static void predict_P(const FLT *P, FLT dt, FLT *Pp) {
+	FLT Q[4];
+	cv_process_noise(0, dt, 0, Q);
+	// F * P * F^T with F = [1 dt; 0 1]
+	FLT a = P[0] + dt * P[2], b = P[1] + dt * P[3];
+	Pp[0] = a + dt * b + Q[0];
+	Pp[1] = b + Q[1];
+	Pp[2] = P[2] + dt * P[3] + Q[2];
+	Pp[3] = P[3] + Q[3];
+}
+
+struct run {
+	FLT truth[STEPS][2];
+	FLT x[STEPS][2], P[STEPS][4];
+	FLT rts[STEPS][2];
+
+	FLT out[STEPS][2];
+	size_t out_cnt;
+	size_t max_nodes_seen;
+};
+
+static void filter(struct run *run) {
+	FLT x[2] = {0, 0}, P[4] = {1, 0, 0, 1}, v = .3;
+	for (int k = 0; k < STEPS; k++) {
+		v += rand_range(-.05, .05);
+		run->truth[k][0] = (k ? run->truth[k - 1][0] : 0) + dt * v;
+		run->truth[k][1] = v;
+
+		if (k) {
+			FLT F[4], Pp[4], xp[2];
+			cv_predict(0, dt, x, xp, F);
+			predict_P(P, dt, Pp);
+			memcpy(x, xp, sizeof(x));
+			memcpy(P, Pp, sizeof(P));
+		}
+
+		FLT z = run->truth[k][0] + rand_range(-.1, .1);
+		FLT S = P[0] + r, K0 = P[0] / S, K1 = P[2] / S, y = z - x[0];
+		x[0] += K0 * y;
+		x[1] += K1 * y;
+		FLT P0 = P[0], P1 = P[1];
+		P[0] -= K0 * P0;
+		P[1] -= K0 * P1;
+		P[2] -= K1 * P0;
+		P[3] -= K1 * P1;
+
+		memcpy(run->x[k], x, sizeof(x));
+		memcpy(run->P[k], P, sizeof(P));
+	}
+}
+
+static void full_rts(struct run *run) {
+	memcpy(run->rts[STEPS - 1], run->x[STEPS - 1], sizeof(run->rts[0]));
+	for (int k = STEPS - 2; k >= 0; k--) {
+		const FLT *P = run->P[k];
+		FLT Pp[4], xp[2], F[4];
+		predict_P(P, dt, Pp);
+		cv_predict(0, dt, run->x[k], xp, F);
+
+		// G = P * F^T * Pp^-1
+		FLT PFt[4] = {P[0] + dt * P[1], P[1], P[2] + dt * P[3], P[3]};
+		FLT det = Pp[0] * Pp[3] - Pp[1] * Pp[2];
+		FLT inv[4] = {Pp[3] / det, -Pp[1] / det, -Pp[2] / det, Pp[0] / det};
+		FLT G[4] = {PFt[0] * inv[0] + PFt[1] * inv[2], PFt[0] * inv[1] + PFt[1] * inv[3],
+					PFt[2] * inv[0] + PFt[3] * inv[2], PFt[2] * inv[1] + PFt[3] * inv[3]};
+
+		FLT d0 = run->rts[k + 1][0] - xp[0], d1 = run->rts[k + 1][1] - xp[1];
+		run->rts[k][0] = run->x[k][0] + G[0] * d0 + G[1] * d1;
+		run->rts[k][1] = run->x[k][1] + G[2] * d0 + G[3] * d1;
+	}
+}
+
+static void collect(void *user, const SurviveKalmanSmootherNode *node, const FLT *smoothed) {
+	struct run *run = user;
+	memcpy(run->out[run->out_cnt++], smoothed, 2 * sizeof(FLT));
+}
+
+static void smooth(struct run *run, FLT lag, size_t max_nodes) {
+	SurviveKalmanSmootherModel model = {
+		.state_cnt = 2, .error_cnt = 2, .predict = cv_predict, .process_noise = cv_process_noise};
+	SurviveKalmanSmoother smoother;
+	survive_kalman_smoother_init(&smoother, &model, lag, max_nodes, collect, run);
+	run->out_cnt = 0;
+	run->max_nodes_seen = 0;
+	for (int k = 0; k < STEPS; k++) {
+		survive_kalman_smoother_push(&smoother, k * dt, k * dt, k, run->x[k], run->P[k]);
+		if (smoother.nodes_cnt > run->max_nodes_seen)
+			run->max_nodes_seen = smoother.nodes_cnt;
+	}
+	survive_kalman_smoother_flush(&smoother);
+	survive_kalman_smoother_free(&smoother);
+}
+
+static FLT rms_error(FLT (*est)[2], FLT (*truth)[2]) {
+	FLT err = 0;
+	for (int k = 0; k < STEPS; k++)
+		err += (est[k][0] - truth[k][0]) * (est[k][0] - truth[k][0]);
+	return sqrt(err / STEPS);
+}
+
+TEST(KalmanSmoother, MatchesFullRTS) {
+	srand(5);
+	static struct run run;
+	filter(&run);
+	full_rts(&run);
+
+	// A lag longer than the data only smooths once, at the flush; that is the full RTS smoother
+	smooth(&run, 10, STEPS);
+	ASSERT_EQ(run.out_cnt, STEPS);
+	for (int k = 0; k < STEPS; k++)
+		ASSERT_DOUBLE_ARRAY_EQ(2, run.out[k], run.rts[k]);
+
+	ASSERT_GT(rms_error(run.x, run.truth), rms_error(run.rts, run.truth));
+	return 0;
+}
+
+TEST(KalmanSmoother, FixedLagIsBounded) {
+	srand(6);
+	static struct run run;
+	filter(&run);
+	full_rts(&run);
+
+	// Half a second of lag is enough for this model to forget; every pose should land close to the full smoother while
+	// holding no more than two lags worth of nodes
+	smooth(&run, .5, STEPS);
+	ASSERT_EQ(run.out_cnt, STEPS);
+	ASSERT_GE(1. / dt + 1, (FLT)run.max_nodes_seen);
+	FLT max_diff = 0;
+	for (int k = 0; k < STEPS; k++)
+		max_diff = linmath_max(max_diff, fabs(run.out[k][0] - run.rts[k][0]));
+	ASSERT_GT(2e-3, max_diff);
+
+	// Running out of nodes first still emits everything, in order, with at most max_nodes held
+	smooth(&run, 10, 32);
+	ASSERT_EQ(run.out_cnt, STEPS);
+	ASSERT_EQ(run.max_nodes_seen, 32);
+	ASSERT_GT(rms_error(run.x, run.truth), rms_error(run.out, run.truth));
+	return 0;
+}
@@ -0,0 +1,48 @@
+#include "../lfsr_lh2.h"
+#include "test_case.h"
+
+static uint32_t step(uint32_t state, lfsr_poly_t poly) {
+	uint32_t b = 0;
+	for (uint32_t v = state & poly & 0x1ffff; v; v &= v - 1)
+		b ^= 1;
+	return (state << 1u) | b;
+}
+
+// The 32 bits starting at the given position of the polynomial's sequence, which starts from state 1
+static uint32_t window_at(lfsr_poly_t poly, uint32_t position) {
+	uint32_t state = 1;
+	for (uint32_t i = 0; i < position + 15; i++)
+		state = step(state, poly);
+	return state;
+}
+
+TEST(LFSR, DecipherChannel) {
+	for (int i = 0; i < 32; i++) {
+		lfsr_poly_t poly = survive_lh2_poly(i);
+		uint32_t position = 4000 * i + 100;
+
+		// Every bit known, and a run of 17 seven bits below the top; the rest of the mask can't be matched on its own
+		uint32_t positions[4] = {position, position + 350, position - 60, position + 1021};
+		uint32_t masks[4] = {0xffffffff, (0x1ffffu << 8) | 0x83, 0x0ffe0ff7, 0xf7f0fff0};
+		uint32_t samples[4], times[4];
+		for (int k = 0; k < 4; k++) {
+			samples[k] = window_at(poly, positions[k]) & masks[k];
+			times[k] = 48000000 + (positions[k] - position) * 8 + (k % 2 ? 2 : -1);
+		}
+
+		ASSERT_EQ(survive_lh2_possible_polys(samples[0], masks[0]), 1u << i);
+		ASSERT_EQ(survive_lh2_possible_polys(samples[1], masks[1]) & (1u << i), 1u << i);
+		ASSERT_EQ(survive_lh2_possible_polys(samples[2], masks[2]), 0xFFFFFFFF);
+
+		uint32_t output[4] = {0};
+		ASSERT_EQ(survive_decipher_channel(samples, masks, times, output, 4), i);
+		for (int k = 0; k < 4; k++) {
+			ASSERT_EQ(output[k], positions[k]);
+		}
+
+		// A sample no polynomial could produce rules them all out
+		samples[0] ^= 1u << 20;
+		ASSERT_EQ(survive_decipher_channel(samples, masks, times, output, 4), 255);
+	}
+	return 0;
+}
@@ -0,0 +1,44 @@
+#include "../survive_name_index.h"
+#include "test_case.h"
+
+#define NAME_CNT 200
+
+TEST(SurviveUtils, NameIndex) {
+	static char names[NAME_CNT][8];
+	survive_name_index index = {0};
+
+	ASSERT_EQ(survive_name_index_get(&index, "T00"), 0);
+	ASSERT_EQ(survive_name_index_remove(&index, "T00"), false);
+
+	for (int i = 0; i < NAME_CNT; i++) {
+		snprintf(names[i], sizeof(names[i]), "T%02d", i);
+		survive_name_index_put(&index, names[i], names[i]);
+	}
+	ASSERT_EQ(index.cnt, NAME_CNT);
+	for (int i = 0; i < NAME_CNT; i++) {
+		ASSERT_EQ(survive_name_index_get(&index, names[i]), names[i]);
+	}
+	ASSERT_EQ(survive_name_index_get(&index, "T"), 0);
+
+	// Lookups go by the string, not the pointer
+	char key[8] = "T07";
+	ASSERT_EQ(survive_name_index_get(&index, key), names[7]);
+	survive_name_index_put(&index, key, key);
+	ASSERT_EQ(index.cnt, NAME_CNT);
+	ASSERT_EQ(survive_name_index_get(&index, "T07"), key);
+	survive_name_index_put(&index, names[7], names[7]);
+
+	// Removing every other name has to leave the rest reachable, whatever runs they were probed into
+	for (int i = 0; i < NAME_CNT; i += 2) {
+		ASSERT_EQ(survive_name_index_remove(&index, names[i]), true);
+	}
+	ASSERT_EQ(index.cnt, NAME_CNT / 2);
+	for (int i = 0; i < NAME_CNT; i++) {
+		const char *expected = i % 2 ? names[i] : 0;
+		ASSERT_EQ(survive_name_index_get(&index, names[i]), expected);
+	}
+
+	survive_name_index_free(&index);
+	ASSERT_EQ(survive_name_index_get(&index, "T01"), 0);
+	return 0;
+}
@@ -2,6 +2,7 @@
 
 #include "../generated/kalman_kinematics.gen.h"
 #include "survive_optimizer.h"
+#include "survive_reproject_gen2.h"
 #include "test_case.h"
 
 survive_optimizer_settings settings = {
@@ -230,3 +231,252 @@ TEST(Optimizer, SimpleUnderspecced) {
 
 	return  0;
 }
+
+static int evaluate_threaded(SurviveContext *ctx, bool disableVelocity) {
+	survive_optimizer_settings threaded_settings = settings;
+	SurviveObject so = {.ctx = ctx};
+
+	survive_optimizer mpfitctx = default_optimizer();
+	mpfitctx.reprojectModel = &survive_reproject_gen2_model;
+	mpfitctx.poseLength = 4;
+	mpfitctx.cameraLength = 2;
+	mpfitctx.ptsLength = SURVIVE_ARRAY_SIZE(points) / 3;
+	mpfitctx.disableVelocity = disableVelocity;
+	SURVIVE_OPTIMIZER_SETUP_HEAP_BUFFERS(mpfitctx, &so, &so, &so, &so);
+
+	for (int i = 0; i < mpfitctx.poseLength; i++) {
+		SurvivePose pose = {.Pos = {.1 * i, -.1 * i, 0}, .Rot = {.1 * i, .2, -.3}};
+		survive_optimizer_setup_pose_n(&mpfitctx, &pose, i, false, 1);
+	}
+	for (int lh = 0; lh < mpfitctx.cameraLength; lh++) {
+		SurvivePose lh_pose = {.Pos = {lh ? 1 : -1, 0, -5}, .Rot = {1}};
+		survive_optimizer_setup_camera(&mpfitctx, lh, &lh_pose, false, 1);
+	}
+	survive_optimizer_parameter *pt_params =
+		survive_optimizer_emplace_params(&mpfitctx, survive_optimizer_parameter_obj_points, mpfitctx.ptsLength);
+	memcpy(pt_params->p, points, sizeof(points));
+	survive_optimizer_parameter *bsd_params = survive_optimizer_emplace_params(
+		&mpfitctx, survive_optimizer_parameter_camera_parameters, mpfitctx.cameraLength);
+	memset(bsd_params->p, 0, bsd_params->size * sizeof(FLT));
+
+	// Shifts the light pairs so the partition targets fall inside them
+	for (int i = 0; i < 4; i++) {
+		survive_optimizer_measurement *meas =
+			survive_optimizer_emplace_meas(&mpfitctx, survive_optimizer_measurement_type_parameters_bias);
+		meas->parameter_bias.parameter_index = i;
+		meas->variance = 1;
+	}
+
+	int k = 0;
+	for (int obj = 0; obj < mpfitctx.poseLength; obj++) {
+		for (int lh = 0; lh < mpfitctx.cameraLength; lh++) {
+			for (int j = 0; j < mpfitctx.ptsLength; j++) {
+				for (int axis = 0; axis < 2; axis++) {
+					survive_optimizer_measurement *meas =
+						survive_optimizer_emplace_meas(&mpfitctx, survive_optimizer_measurement_type_light);
+					meas->variance = 1e-4;
+					meas->time = .01 * j;
+					meas->light.object = obj;
+					meas->light.lh = lh;
+					meas->light.sensor_idx = j;
+					meas->light.axis = axis;
+					meas->light.value = .01 * (k % 17) - .08;
+					// Break up some of the pairs so the ranges don't line up with them neatly
+					meas->invalid = (k++ % 23) == 0;
+				}
+			}
+		}
+	}
+	mpfitctx.timecode = .1;
+
+	int m = mpfitctx.measurementsCnt;
+	int n = survive_optimizer_get_parameters_count(&mpfitctx);
+	// Serial, then two thread counts; the second has to grow the pool the first one started
+	enum { runs = 3 };
+	FLT *deviates[runs], *jacobian[runs];
+	FLT **derivs[runs];
+	FLT stats[runs][4];
+	for (int run = 0; run < runs; run++) {
+		threaded_settings.threads = run + 1;
+		mpfitctx.settings = &threaded_settings;
+
+		deviates[run] = SV_CALLOC_N(m, sizeof(FLT));
+		jacobian[run] = SV_CALLOC_N(m * n, sizeof(FLT));
+		derivs[run] = SV_CALLOC_N(n, sizeof(FLT *));
+		for (int j = 0; j < n; j++) {
+			if (!mpfitctx.mp_parameters_info[j].fixed)
+				derivs[run][j] = jacobian[run] + j * m;
+		}
+
+		survive_optimizer_evaluate(&mpfitctx, mpfitctx.parameters, deviates[run], derivs[run]);
+		stats[run][0] = mpfitctx.stats.sensor_error;
+		stats[run][1] = mpfitctx.stats.sensor_error_cnt;
+		stats[run][2] = mpfitctx.stats.params_error;
+		stats[run][3] = mpfitctx.stats.params_error_cnt;
+	}
+
+	int rtn = 0;
+	for (int run = 1; run < runs; run++) {
+		if (memcmp(deviates[0], deviates[run], m * sizeof(FLT)) != 0 ||
+			memcmp(jacobian[0], jacobian[run], m * n * sizeof(FLT)) != 0 ||
+			memcmp(stats[0], stats[run], sizeof(stats[0]))) {
+			fprintf(stderr, "Evaluation on %d threads differs from serial evaluation (velocity %d)\n", run + 1,
+					!disableVelocity);
+			rtn = -1;
+		}
+	}
+
+	for (int run = 0; run < runs; run++) {
+		free(deviates[run]);
+		free(jacobian[run]);
+		free(derivs[run]);
+	}
+	free(mpfitctx.parameters_info);
+	free(mpfitctx.sos);
+	SURVIVE_OPTIMIZER_CLEANUP_HEAP_BUFFERS(mpfitctx);
+	return rtn;
+}
+
+TEST(Optimizer, ThreadedEvaluation) {
+	char *args[] = {"test-optimizer", "--v", "0", "--configfile", "test-optimizer-threads.json"};
+	SurviveContext *ctx = survive_init(SURVIVE_ARRAY_SIZE(args), args);
+	if (ctx == 0)
+		return -1;
+
+	int rtn = evaluate_threaded(ctx, true);
+	if (rtn == 0)
+		rtn = evaluate_threaded(ctx, false);
+
+	survive_close(ctx);
+	return rtn;
+}
+
+#define SCENE_POSES 6
+#define SCENE_LHS 2
+
+// Solves a small multi object scene with one free lighthouse; every call starts from the same perturbed state.
+static int solve_scene(bool sparse, SurvivePose *poses, SurvivePose *lh, FLT *cov, mp_result *result) {
+	survive_optimizer_settings scene_settings = settings;
+	scene_settings.sparse = sparse;
+
+	SurviveObject so = {0};
+	survive_optimizer mpfitctx = default_optimizer();
+	mpfitctx.settings = &scene_settings;
+	mpfitctx.reprojectModel = &survive_reproject_gen2_model;
+	mpfitctx.poseLength = SCENE_POSES;
+	mpfitctx.cameraLength = SCENE_LHS;
+	mpfitctx.ptsLength = SURVIVE_ARRAY_SIZE(points) / 3;
+	mpfitctx.nofilter = true;
+	SURVIVE_OPTIMIZER_SETUP_HEAP_BUFFERS(mpfitctx, &so, &so, &so, &so, &so, &so);
+
+	BaseStationCal bcal[2] = {0};
+	SurvivePose lh2world[SCENE_LHS] = {{.Pos = {-1, 0, 3}, .Rot = {1}}, {.Pos = {1.5, .5, 3}, .Rot = {1}}};
+	for (int lh = 0; lh < SCENE_LHS; lh++) {
+		SurvivePose start = lh2world[lh];
+		if (lh > 0) {
+			start.Pos[0] += .03;
+			start.Pos[2] -= .02;
+		}
+		survive_optimizer_setup_camera(&mpfitctx, lh, &start, lh == 0, 1);
+	}
+
+	SurvivePose gt[SCENE_POSES];
+	for (int i = 0; i < SCENE_POSES; i++) {
+		gt[i] = (SurvivePose){.Pos = {.3 * (i % 3) - .3, .4 * (i / 3) - .2, .1 * i}, .Rot = {1, .1 * i, -.2, .05 * i}};
+		quatnormalize(gt[i].Rot, gt[i].Rot);
+
+		SurvivePose start = gt[i];
+		start.Pos[0] += .02;
+		start.Pos[1] -= .01;
+		start.Rot[1] += .03;
+		quatnormalize(start.Rot, start.Rot);
+		survive_optimizer_setup_pose_n(&mpfitctx, &start, i, false, 1);
+	}
+
+	survive_optimizer_parameter *pt_params =
+		survive_optimizer_emplace_params(&mpfitctx, survive_optimizer_parameter_obj_points, mpfitctx.ptsLength);
+	memcpy(pt_params->p, points, sizeof(points));
+	survive_optimizer_parameter *bsd_params = survive_optimizer_emplace_params(
+		&mpfitctx, survive_optimizer_parameter_camera_parameters, mpfitctx.cameraLength);
+	memset(bsd_params->p, 0, bsd_params->size * sizeof(FLT));
+
+	for (int obj = 0; obj < SCENE_POSES; obj++) {
+		for (int lh = 0; lh < SCENE_LHS; lh++) {
+			SurvivePose world2lh = InvertPoseRtn(&lh2world[lh]);
+			for (int j = 0; j < mpfitctx.ptsLength; j++) {
+				SurviveAngleReading angles;
+				survive_reproject_full_gen2(bcal, &world2lh, &gt[obj], &points[j * 3], angles);
+				for (int axis = 0; axis < 2; axis++) {
+					survive_optimizer_measurement *meas =
+						survive_optimizer_emplace_meas(&mpfitctx, survive_optimizer_measurement_type_light);
+					meas->variance = 1e-4;
+					meas->light.object = obj;
+					meas->light.lh = lh;
+					meas->light.sensor_idx = j;
+					meas->light.axis = axis;
+					meas->light.value = angles[axis];
+				}
+			}
+		}
+	}
+
+	int nfree = survive_optimizer_get_free_parameters_count(&mpfitctx);
+	CnMat R = cnMat(nfree, nfree, cov);
+	int status = survive_optimizer_run(&mpfitctx, result, &R);
+
+	memcpy(poses, survive_optimizer_get_pose(&mpfitctx), sizeof(SurvivePose) * SCENE_POSES);
+	memcpy(lh, survive_optimizer_get_camera(&mpfitctx), sizeof(SurvivePose) * SCENE_LHS);
+
+	free(mpfitctx.parameters_info);
+	free(mpfitctx.sos);
+	SURVIVE_OPTIMIZER_CLEANUP_HEAP_BUFFERS(mpfitctx);
+	return status;
+}
+
+TEST(Optimizer, SparseMatchesMpfit) {
+	SurvivePose poses[2][SCENE_POSES], lhs[2][SCENE_LHS];
+	// 6 free parameters per pose plus one free lighthouse, with room for the quaternion expansion
+	size_t cov_size = (SCENE_POSES + 1) * 7;
+	FLT *cov[2];
+	mp_result results[2] = {0};
+
+	for (int run = 0; run < 2; run++) {
+		cov[run] = SV_CALLOC_N(cov_size * cov_size, sizeof(FLT));
+		int status = solve_scene(run == 1, poses[run], lhs[run], cov[run], &results[run]);
+		if (status <= 0) {
+			fprintf(stderr, "Solve failed with %s (sparse %d)\n", survive_optimizer_error(status), run);
+			return -1;
+		}
+	}
+
+	int rtn = 0;
+	if (results[1].bestnorm > 1e-6 || results[0].bestnorm > 1e-6) {
+		fprintf(stderr, "Didn't converge; %g %g\n", results[0].bestnorm, results[1].bestnorm);
+		rtn = -1;
+	}
+
+	for (int i = 0; i < SCENE_POSES; i++) {
+		SurvivePose d = poseDiff(&poses[0][i], &poses[1][i]);
+		if (norm3d(d.Pos) > 1e-6 || fabs(1 - fabs(d.Rot[0])) > 1e-9) {
+			fprintf(stderr, "Pose %d differs between mpfit and sparse solve\n", i);
+			rtn = -1;
+		}
+	}
+	SurvivePose d = poseDiff(&lhs[0][1], &lhs[1][1]);
+	if (norm3d(d.Pos) > 1e-6) {
+		fprintf(stderr, "Lighthouse differs between mpfit and sparse solve\n");
+		rtn = -1;
+	}
+
+	for (size_t i = 0; i < cov_size; i++) {
+		FLT a = cov[0][i * cov_size + i], b = cov[1][i * cov_size + i];
+		if (fabs(a - b) > 1e-2 * fabs(a) + 1e-12) {
+			fprintf(stderr, "Covariance differs at %d; %g vs %g\n", (int)i, a, b);
+			rtn = -1;
+		}
+	}
+
+	free(cov[0]);
+	free(cov[1]);
+	return rtn;
+}
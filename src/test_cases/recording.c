@@ -0,0 +1,133 @@
+#include "../survive_default_devices.h"
+#include "../survive_gz.h"
+#include "../survive_recording.h"
+#include "os_generic.h"
+#include "string.h"
+#include "test_case.h"
+
+#define WRITER_CNT 4
+static const int lines_per_writer = 20000;
+static const char *config_json = "{\"seq\": 1234, \"pad\": \"0123456789012345678901234567890123456789\"}";
+
+typedef struct recording_writer {
+	SurviveObject *so;
+	int config_cnt;
+} recording_writer;
+
+static void *write_lines(void *_writer) {
+	recording_writer *writer = _writer;
+	SurviveObject *so = writer->so;
+	for (int i = 0; i < lines_per_writer; i++) {
+		// CONFIG lines go out in three pieces
+		if (i % 100 == 0) {
+			survive_recording_config_process(so, (char *)config_json, strlen(config_json));
+			writer->config_cnt++;
+		}
+		survive_recording_write_to_output(so->ctx->recptr, "%s TEST %d\r\n", so->codename, i);
+	}
+	return 0;
+}
+
+/*
+ * Writes from several threads at once through a 1KB record-async buffer. Every line in the file has to be whole;
+ * with drop_when_full lines may be missing, but exactly as many as were counted as dropped.
+ */
+static int write_and_check(bool drop_when_full) {
+	const char *fn = "test_recording_async.rec.gz";
+	char *args[] = {"test-recording",
+					"--v",
+					"0",
+					"--configfile",
+					"test-recording.json",
+					"--record",
+					(char *)fn,
+					"--record-buffer-kb",
+					"1",
+					"--record-drop-when-full",
+					drop_when_full ? "1" : "0"};
+	SurviveContext *ctx = survive_init(SURVIVE_ARRAY_SIZE(args), args);
+	if (ctx == 0)
+		return -1;
+	ASSERT_EQ(ctx->recptr != 0, true);
+
+	recording_writer writers[WRITER_CNT] = {0};
+	og_thread_t threads[WRITER_CNT];
+	for (int i = 0; i < WRITER_CNT; i++) {
+		char codename[4] = {'T', 'W', '0' + i, 0};
+		writers[i].so = survive_create_device(ctx, "TST", 0, codename, 0);
+		threads[i] = OGCreateThread(write_lines, "recording test", &writers[i]);
+	}
+	for (int i = 0; i < WRITER_CNT; i++)
+		OGJoinThread(threads[i]);
+
+	survive_recording_stats stats = survive_recording_get_stats(ctx->recptr);
+	for (int i = 0; i < WRITER_CNT; i++)
+		survive_destroy_device(writers[i].so);
+	survive_close(ctx);
+
+	gzFile f = gzopen(fn, "r");
+	if (f == 0)
+		return -1;
+
+	int next_seq[WRITER_CNT] = {0};
+	uint64_t found = 0, produced = 0;
+	char line[1024], expected[1024];
+	int rtn = 0;
+	while (rtn == 0 && gzgets(f, line, sizeof(line))) {
+		double time;
+		char dev[16], op[16];
+		int offset = 0;
+		if (sscanf(line, "%lf %15s %15s %n", &time, dev, op, &offset) < 3)
+			continue;
+
+		int writer = strncmp(dev, "TW", 2) == 0 ? dev[2] - '0' : -1;
+		bool ours = writer >= 0 && writer < WRITER_CNT;
+		if (strcmp(op, "TEST") == 0) {
+			int seq = -1;
+			sscanf(line + offset, "%d", &seq);
+			snprintf(expected, sizeof(expected), "%d\r\n", seq);
+			// Dropped lines leave gaps, but nothing may come out of order
+			if (!ours || strcmp(line + offset, expected) != 0 || seq < next_seq[writer] ||
+				(!drop_when_full && seq != next_seq[writer])) {
+				fprintf(stderr, "Bad or out of order line '%s'\n", line);
+				rtn = -1;
+				break;
+			}
+			next_seq[writer] = seq + 1;
+			found++;
+		} else if (strcmp(op, "CONFIG") == 0) {
+			snprintf(expected, sizeof(expected), "%s\r\n", config_json);
+			if (!ours || strcmp(line + offset, expected) != 0) {
+				fprintf(stderr, "Bad config line '%s'\n", line);
+				rtn = -1;
+			}
+			found++;
+		} else if (strstr(line, " TEST ") || strstr(line, " CONFIG ")) {
+			fprintf(stderr, "Line glued to another record '%s'\n", line);
+			rtn = -1;
+		}
+	}
+	gzclose(f);
+	remove(fn);
+	remove("test-recording.json");
+	if (rtn)
+		return rtn;
+
+	for (int i = 0; i < WRITER_CNT; i++)
+		produced += lines_per_writer + writers[i].config_cnt;
+	ASSERT_EQ(found + stats.dropped_lines, produced);
+	if (drop_when_full) {
+		ASSERT_EQ(stats.stall_cnt, 0);
+	} else {
+		// Whether producers stall depends on how the writer thread is scheduled, so only check that every line
+		// arrived, whole and in order
+		ASSERT_EQ(stats.dropped_lines, 0);
+		for (int i = 0; i < WRITER_CNT; i++)
+			ASSERT_EQ(next_seq[i], lines_per_writer);
+	}
+	return 0;
+}
+
+TEST(Recording, AsyncWriterWaitsWhenFull) { return write_and_check(false); }
+
+TEST(Recording, AsyncWriterDropsWholeLines) { return write_and_check(true); }
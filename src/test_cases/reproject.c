@@ -106,3 +106,77 @@ TEST(Reproject, Extents_gen2) {
 
 	return 0;
 }
+
+static FLT rand_range(FLT lo, FLT hi) { return lo + (hi - lo) * rand() / (FLT)RAND_MAX; }
+
+static void rand_cal(BaseStationCal *cal) {
+	for (int axis = 0; axis < 2; axis++) {
+		cal[axis] = (BaseStationCal){.phase = rand_range(-.05, .05),
+									 .tilt = rand_range(-.05, .05),
+									 .curve = rand_range(-.01, .01),
+									 .gibpha = rand_range(-3, 3),
+									 .gibmag = rand_range(-.02, .02),
+									 .ogeephase = rand_range(-3, 3),
+									 .ogeemag = rand_range(-.5, .5)};
+	}
+}
+
+TEST(Reproject, BatchMatchesScalar) {
+	enum { N = 133 };
+	FLT x[N], y[N], z[N], out_x[N], out_y[N];
+	srand(42);
+
+	for (int trial = 0; trial < 10; trial++) {
+		BaseStationCal cal[2];
+		rand_cal(cal);
+		for (int i = 0; i < N; i++) {
+			x[i] = rand_range(-2, 2);
+			y[i] = rand_range(-2, 2);
+			z[i] = rand_range(-5, -.5);
+		}
+
+		survive_reproject_xy_batch(cal, N, x, y, z, out_x, out_y);
+		for (int i = 0; i < N; i++) {
+			SurviveAngleReading ang;
+			survive_reproject_xy(cal, (LinmathVec3d){x[i], y[i], z[i]}, ang);
+			ASSERT_DOUBLE_EQ(out_x[i], ang[0]);
+			ASSERT_DOUBLE_EQ(out_y[i], ang[1]);
+		}
+
+		survive_reproject_xy_batch_gen2(cal, N, x, y, z, out_x, 0);
+		survive_reproject_xy_batch_gen2(cal, N, x, y, z, 0, out_y);
+		for (int i = 0; i < N; i++) {
+			SurviveAngleReading ang;
+			survive_reproject_xy_gen2(cal, (LinmathVec3d){x[i], y[i], z[i]}, ang);
+			ASSERT_DOUBLE_EQ(out_x[i], ang[0]);
+			ASSERT_DOUBLE_EQ(out_y[i], ang[1]);
+		}
+
+		SurvivePose lh2world = {.Pos = {rand_range(-2, 2), rand_range(-2, 2), 3}};
+		SurvivePose obj2world = {.Pos = {rand_range(-.5, .5), rand_range(-.5, .5), rand_range(0, 1)}};
+		for (int i = 0; i < 4; i++) {
+			lh2world.Rot[i] = rand_range(-1, 1);
+			obj2world.Rot[i] = rand_range(-1, 1);
+		}
+		quatnormalize(lh2world.Rot, lh2world.Rot);
+		quatnormalize(obj2world.Rot, obj2world.Rot);
+		SurvivePose world2lh = InvertPoseRtn(&lh2world);
+
+		for (int i = 0; i < N; i++) {
+			x[i] = rand_range(-.1, .1);
+			y[i] = rand_range(-.1, .1);
+			z[i] = rand_range(-.1, .1);
+		}
+
+		survive_reproject_full_xy_batch(&survive_reproject_gen2_model, cal, &world2lh, &obj2world, N, x, y, z, out_x,
+										out_y);
+		for (int i = 0; i < N; i++) {
+			SurviveAngleReading ang;
+			survive_reproject_full_gen2(cal, &world2lh, &obj2world, (LinmathVec3d){x[i], y[i], z[i]}, ang);
+			ASSERT_DOUBLE_EQ(out_x[i], ang[0]);
+			ASSERT_DOUBLE_EQ(out_y[i], ang[1]);
+		}
+	}
+
+	return 0;
+}
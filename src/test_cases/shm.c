@@ -0,0 +1,74 @@
+#include "../survive_internal.h"
+#include "../survive_private.h"
+#include "../survive_shm_publisher.h"
+#include "survive_shm.h"
+#include "test_case.h"
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#endif
+
+TEST(Survive, ShmPublisher) {
+	SurviveContext *ctx = SV_CALLOC(sizeof(SurviveContext));
+	ctx->private_members = SV_CALLOC(sizeof(struct SurviveContext_private));
+	ctx->log_target = stderr;
+
+	char name[64];
+	snprintf(name, sizeof(name), "survive-test-shm-%d", (int)getpid());
+
+	SurviveShmReader reader;
+	ASSERT_EQ(survive_shm_reader_open(&reader, name), false);
+
+	struct survive_shm_publisher *publisher = survive_shm_publisher_open(ctx, name);
+	ASSERT_EQ(publisher != 0, true);
+	ASSERT_EQ(survive_shm_reader_open(&reader, name), true);
+	ASSERT_EQ(survive_shm_publisher_alive(&reader), true);
+	ASSERT_EQ(survive_shm_object_count(&reader), 0);
+
+	SurviveObject so[2] = {{.ctx = ctx, .codename = "HMD", .serial_number = "LHR-0"},
+						   {.ctx = ctx, .codename = "WM0", .serial_number = "LHR-1"}};
+	SurvivePose pose = {.Pos = {1, 2, 3}, .Rot = {1, 0, 0, 0}};
+	SurviveVelocity velocity = {.Pos = {.1, .2, .3}, .AxisAngleRot = {.4, .5, .6}};
+
+	survive_shm_publisher_pose(publisher, &so[1], 100, &pose);
+	survive_shm_publisher_velocity(publisher, &so[0], 200, &velocity);
+	so[1].buttonmask = 5;
+	so[1].axis[2] = .5;
+	survive_shm_publisher_button(publisher, &so[1]);
+
+	ASSERT_EQ(survive_shm_object_count(&reader), 2);
+	ASSERT_EQ(survive_shm_find_object(&reader, "WM0"), 0);
+	ASSERT_EQ(survive_shm_find_object(&reader, "HMD"), 1);
+	ASSERT_EQ(survive_shm_find_object(&reader, "WM1"), -1);
+
+	SurviveShmObject obj;
+	ASSERT_EQ(survive_shm_read_object(&reader, 0, &obj), true);
+	ASSERT_EQ(strcmp(obj.serial_number, "LHR-1"), 0);
+	ASSERT_EQ(obj.flags, SURVIVE_SHM_OBJECT_HAS_POSE);
+	ASSERT_EQ(obj.update_cnt, 2);
+	ASSERT_EQ(obj.seq, 4);
+	ASSERT_EQ(obj.pose_timecode, 100);
+	for (int i = 0; i < 3; i++) {
+		ASSERT_DOUBLE_EQ(obj.pose[i], pose.Pos[i]);
+	}
+	ASSERT_DOUBLE_EQ(obj.pose[3], 1);
+	ASSERT_EQ(obj.buttonmask, 5);
+	ASSERT_DOUBLE_EQ(obj.axis[2], .5);
+
+	ASSERT_EQ(survive_shm_read_object(&reader, 1, &obj), true);
+	ASSERT_EQ(obj.flags, SURVIVE_SHM_OBJECT_HAS_VELOCITY);
+	ASSERT_EQ(obj.velocity_timecode, 200);
+	ASSERT_DOUBLE_EQ(obj.velocity[5], velocity.AxisAngleRot[2]);
+	ASSERT_EQ(survive_shm_read_object(&reader, 2, &obj), false);
+
+	// Readers keep their mapping past the publisher, but can no longer open the name
+	survive_shm_publisher_close(publisher);
+	ASSERT_EQ(survive_shm_publisher_alive(&reader), false);
+	survive_shm_reader_close(&reader);
+	ASSERT_EQ(survive_shm_reader_open(&reader, name), false);
+
+	free(ctx->private_members);
+	free(ctx);
+	return 0;
+}
@@ -0,0 +1,165 @@
+#define SURVIVE_ENABLE_FULL_API
+#include "../survive_default_devices.h"
+#include "os_generic.h"
+#include "survive_api.h"
+#include "test_case.h"
+
+// None of these start the background thread, so an empty subscription reports Shutdown rather than None
+#define NO_EVENT SurviveSimpleEventType_Shutdown
+
+static SurviveSimpleContext *events_context(const char *name) {
+	char *args[] = {(char *)name, "--v", "0", "--configfile", "test-simple-api-events.json"};
+	return survive_simple_init(SURVIVE_ARRAY_SIZE(args), args);
+}
+
+static SurviveObject *add_device(SurviveSimpleContext *actx, const char *codename) {
+	SurviveContext *ctx = survive_simple_get_ctx(actx);
+	SurviveObject *so = survive_create_device(ctx, "TST", 0, codename, 0);
+	survive_add_object(ctx, so);
+	return so;
+}
+
+static void press(SurviveObject *so) {
+	SURVIVE_INVOKE_HOOK_SO(button, so, SURVIVE_INPUT_EVENT_BUTTON_DOWN, SURVIVE_BUTTON_A, 0, 0);
+}
+
+// External poses are the one kind of event that needs no SurviveObject; x carries a sequence number
+static void publish_external(SurviveSimpleContext *actx, const char *name, int seq) {
+	SurviveContext *ctx = survive_simple_get_ctx(actx);
+	SurvivePose pose = {.Pos = {seq}, .Rot = {1}};
+	SURVIVE_INVOKE_HOOK(external_pose, ctx, name, &pose);
+}
+
+static size_t drain(SurviveSimpleSubscription *sub, enum SurviveSimpleEventType event_type) {
+	size_t cnt = 0;
+	SurviveSimpleEvent event;
+	while (survive_simple_subscription_next_event(sub, &event) != NO_EVENT) {
+		if (event.event_type == event_type)
+			cnt++;
+	}
+	return cnt;
+}
+
+TEST(SimpleApi, SubscriptionFilters) {
+	SurviveSimpleContext *actx = events_context("test-simple-api-filters");
+	ASSERT_EQ(actx != 0, true);
+
+	SurviveSimpleSubscription *all = survive_simple_subscribe(actx, 0);
+	SurviveSimpleSubscriptionParams button_params = {.event_types =
+														 SURVIVE_SIMPLE_EVENT_MASK(SurviveSimpleEventType_ButtonEvent)};
+	SurviveSimpleSubscription *buttons = survive_simple_subscribe(actx, &button_params);
+
+	SurviveObject *ts0 = add_device(actx, "TS0");
+	SurviveObject *ts1 = add_device(actx, "TS1");
+	SurviveSimpleSubscriptionParams object_params = {.object = survive_simple_get_object(actx, "TS0")};
+	ASSERT_EQ(object_params.object != 0, true);
+	SurviveSimpleSubscription *ts0_only = survive_simple_subscribe(actx, &object_params);
+
+	press(ts0);
+	press(ts1);
+	publish_external(actx, "EXT0", 1);
+
+	SurviveSimpleEvent event;
+	ASSERT_EQ(survive_simple_subscription_next_event(ts0_only, &event), SurviveSimpleEventType_ButtonEvent);
+	ASSERT_EQ((survive_simple_get_button_event(&event)->object == object_params.object), true);
+	ASSERT_EQ(survive_simple_subscription_next_event(ts0_only, &event), NO_EVENT);
+
+	ASSERT_EQ(drain(buttons, SurviveSimpleEventType_ButtonEvent), 2);
+
+	ASSERT_EQ(survive_simple_subscription_next_event(all, &event), SurviveSimpleEventType_DeviceAdded);
+	ASSERT_EQ(survive_simple_subscription_next_event(all, &event), SurviveSimpleEventType_DeviceAdded);
+	ASSERT_EQ(survive_simple_subscription_next_event(all, &event), SurviveSimpleEventType_ButtonEvent);
+	ASSERT_EQ(survive_simple_subscription_next_event(all, &event), SurviveSimpleEventType_ButtonEvent);
+	ASSERT_EQ(survive_simple_subscription_next_event(all, &event), SurviveSimpleEventType_PoseUpdateEvent);
+	ASSERT_DOUBLE_EQ(survive_simple_get_pose_updated_event(&event)->pose.Pos[0], 1.);
+	ASSERT_EQ(survive_simple_subscription_next_event(all, &event), NO_EVENT);
+
+	ASSERT_EQ(survive_simple_subscription_dropped(all), 0);
+	ASSERT_EQ(survive_simple_subscription_dropped(buttons), 0);
+	ASSERT_EQ(survive_simple_subscription_dropped(ts0_only), 0);
+
+	// Whatever is still subscribed is freed on close
+	survive_simple_unsubscribe(buttons);
+	survive_simple_close(actx);
+	return 0;
+}
+
+// A full subscription drops the newest events and counts them; what it already holds is kept in order
+TEST(SimpleApi, SubscriptionOverflow) {
+	SurviveSimpleContext *actx = events_context("test-simple-api-overflow");
+	ASSERT_EQ(actx != 0, true);
+
+	SurviveSimpleSubscriptionParams params = {.capacity = 4};
+	SurviveSimpleSubscription *sub = survive_simple_subscribe(actx, &params);
+	SurviveSimpleSubscription *roomy = survive_simple_subscribe(actx, 0);
+
+	for (int i = 0; i < 10; i++)
+		publish_external(actx, "EXT0", i);
+	ASSERT_EQ(survive_simple_subscription_dropped(sub), 6);
+	ASSERT_EQ(survive_simple_subscription_dropped(roomy), 0);
+
+	SurviveSimpleEvent event;
+	for (int i = 0; i < 4; i++) {
+		ASSERT_EQ(survive_simple_subscription_next_event(sub, &event), SurviveSimpleEventType_PoseUpdateEvent);
+		ASSERT_DOUBLE_EQ(survive_simple_get_pose_updated_event(&event)->pose.Pos[0], (FLT)i);
+	}
+	ASSERT_EQ(survive_simple_subscription_next_event(sub, &event), NO_EVENT);
+
+	// Once read, there is room again
+	publish_external(actx, "EXT0", 10);
+	ASSERT_EQ(survive_simple_subscription_next_event(sub, &event), SurviveSimpleEventType_PoseUpdateEvent);
+	ASSERT_DOUBLE_EQ(survive_simple_get_pose_updated_event(&event)->pose.Pos[0], 10.);
+	ASSERT_EQ(survive_simple_subscription_dropped(sub), 6);
+	ASSERT_EQ(drain(roomy, SurviveSimpleEventType_PoseUpdateEvent), 11);
+
+	survive_simple_close(actx);
+	return 0;
+}
+
+static const int published_cnt = 4000;
+
+typedef struct {
+	SurviveSimpleContext *actx;
+	volatile bool done;
+} publisher;
+
+static void *publish_poses(void *_publisher) {
+	publisher *p = _publisher;
+	for (int i = 0; i < published_cnt; i++)
+		publish_external(p->actx, "EXT0", i);
+	p->done = true;
+	return 0;
+}
+
+// Subscriptions come and go while another thread publishes; one that stays open still sees every event in order
+TEST(SimpleApi, UnsubscribeWhilePublishing) {
+	SurviveSimpleContext *actx = events_context("test-simple-api-unsubscribe");
+	ASSERT_EQ(actx != 0, true);
+
+	SurviveSimpleSubscriptionParams steady_params = {.capacity = published_cnt};
+	SurviveSimpleSubscription *steady = survive_simple_subscribe(actx, &steady_params);
+
+	publisher p = {.actx = actx};
+	og_thread_t thread = OGCreateThread(publish_poses, "simple api publisher", &p);
+
+	size_t churned = 0;
+	SurviveSimpleEvent event;
+	while (!p.done || churned == 0) {
+		SurviveSimpleSubscriptionParams params = {.capacity = 2};
+		SurviveSimpleSubscription *sub = survive_simple_subscribe(actx, &params);
+		survive_simple_subscription_next_event(sub, &event);
+		survive_simple_unsubscribe(sub);
+		churned++;
+	}
+	OGJoinThread(thread);
+
+	ASSERT_EQ(survive_simple_subscription_dropped(steady), 0);
+	for (int i = 0; i < published_cnt; i++) {
+		ASSERT_EQ(survive_simple_subscription_next_event(steady, &event), SurviveSimpleEventType_PoseUpdateEvent);
+		ASSERT_DOUBLE_EQ(survive_simple_get_pose_updated_event(&event)->pose.Pos[0], (FLT)i);
+	}
+	ASSERT_EQ(survive_simple_subscription_next_event(steady, &event), NO_EVENT);
+
+	survive_simple_close(actx);
+	return 0;
+}
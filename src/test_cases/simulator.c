@@ -0,0 +1,164 @@
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "test_case.h"
+
+#define SIM_OBJECT_CNT 3
+
+enum sim_event_type { SIM_IMU, SIM_SYNC, SIM_SWEEP, SIM_LIGHT, SIM_ANGLE };
+
+typedef struct {
+	enum sim_event_type type;
+	int obj;
+	int sensor_id;
+	survive_timecode timecode;
+	FLT value;
+} sim_event;
+
+typedef struct {
+	sim_event *events;
+	size_t cnt, capacity;
+	size_t type_cnt[SIM_ANGLE + 1];
+	bool out_of_order;
+	survive_timecode last[SIM_OBJECT_CNT];
+	bool seen[SIM_OBJECT_CNT];
+} sim_log;
+
+static int object_idx(SurviveObject *so) {
+	for (int i = 0; i < so->ctx->objs_ct; i++) {
+		if (so->ctx->objs[i] == so)
+			return i;
+	}
+	return -1;
+}
+
+static void record(SurviveObject *so, enum sim_event_type type, int sensor_id, survive_timecode timecode, FLT value) {
+	sim_log *log = so->ctx->user_ptr;
+	int obj = object_idx(so);
+	if (obj < 0 || obj >= SIM_OBJECT_CNT)
+		return;
+
+	// Every object's events have to come in time order, whichever kind they are
+	if (log->seen[obj] && timecode < log->last[obj])
+		log->out_of_order = true;
+	log->seen[obj] = true;
+	log->last[obj] = timecode;
+
+	if (log->cnt == log->capacity) {
+		log->capacity = log->capacity ? 2 * log->capacity : 1024;
+		log->events = realloc(log->events, log->capacity * sizeof(sim_event));
+	}
+	log->events[log->cnt++] =
+		(sim_event){.type = type, .obj = obj, .sensor_id = sensor_id, .timecode = timecode, .value = value};
+	log->type_cnt[type]++;
+}
+
+static void record_imu(SurviveObject *so, int mask, const FLT *accelgyro, survive_timecode timecode, int id) {
+	record(so, SIM_IMU, -1, timecode, accelgyro[0] + accelgyro[4]);
+}
+
+static void record_sync(SurviveObject *so, survive_channel channel, survive_timecode timeofsync, bool ootx, bool gen) {
+	record(so, SIM_SYNC, channel, timeofsync, 0);
+}
+
+static void record_sweep(SurviveObject *so, survive_channel channel, int sensor_id, survive_timecode timecode,
+						 bool half_clock_flag) {
+	record(so, SIM_SWEEP, sensor_id + channel * 256, timecode, 0);
+}
+
+static void record_light(SurviveObject *so, int sensor_id, int acode, int timeinsweep, survive_timecode timecode,
+						 survive_timecode length, uint32_t lighthouse) {
+	record(so, SIM_LIGHT, sensor_id, timecode, acode);
+}
+
+static void record_angle(SurviveObject *so, int sensor_id, int acode, survive_timecode timecode, FLT length, FLT angle,
+						 uint32_t lh) {
+	record(so, SIM_ANGLE, sensor_id, timecode, angle);
+}
+
+static int run_simulation(const char *lh_gen, const char *lh_cnt, sim_log *log) {
+	const char *config = "test-simulator.json";
+	// A saved config would bring the lighthouses back, which the simulator then doesn't place or seed
+	remove(config);
+
+	char *args[] = {"test-simulator",
+					"--v",
+					"0",
+					"--configfile",
+					(char *)config,
+					"--simulator",
+					"--simulator-objects",
+					"3",
+					"--simulator-lighthouses",
+					(char *)lh_cnt,
+					"--simulator-lh-gen",
+					(char *)lh_gen,
+					"--simulator-seed",
+					"7",
+					"--simulator-time",
+					".5",
+					"--simulator-init-time",
+					".1",
+					"--simulator-speed",
+					"0",
+					"--simulator-show-gt",
+					"0"};
+	SurviveContext *ctx = survive_init(SURVIVE_ARRAY_SIZE(args), args);
+	if (ctx == 0)
+		return -1;
+
+	ctx->user_ptr = log;
+	survive_install_imu_fn(ctx, record_imu);
+	survive_install_sync_fn(ctx, record_sync);
+	survive_install_sweep_fn(ctx, record_sweep);
+	survive_install_light_fn(ctx, record_light);
+	survive_install_angle_fn(ctx, record_angle);
+	while (survive_poll(ctx) == 0) {
+	}
+	survive_close(ctx);
+
+	remove(config);
+	return 0;
+}
+
+// Two runs with the same seed put out the same events, and each object's IMU and light come interleaved in time order
+static int check_simulation(const char *lh_gen, const char *lh_cnt, enum sim_event_type light_type) {
+	sim_log logs[2] = {0};
+	for (int run = 0; run < 2; run++) {
+		ASSERT_EQ(run_simulation(lh_gen, lh_cnt, &logs[run]), 0);
+	}
+
+	int rtn = 0;
+	for (int run = 0; run < 2 && rtn == 0; run++) {
+		if (logs[run].out_of_order || logs[run].type_cnt[SIM_IMU] == 0 || logs[run].type_cnt[light_type] == 0) {
+			fprintf(stderr, "Simulation run %d: out of order %d, %zu imu, %zu light\n", run, logs[run].out_of_order,
+					logs[run].type_cnt[SIM_IMU], logs[run].type_cnt[light_type]);
+			rtn = -1;
+		}
+	}
+
+	if (rtn == 0 && logs[0].cnt != logs[1].cnt) {
+		fprintf(stderr, "Simulation runs had %zu and %zu events\n", logs[0].cnt, logs[1].cnt);
+		rtn = -1;
+	}
+	for (int type = 0; rtn == 0 && type <= SIM_ANGLE; type++) {
+		if (logs[0].type_cnt[type] != logs[1].type_cnt[type])
+			rtn = -1;
+	}
+	for (size_t i = 0; rtn == 0 && i < logs[0].cnt; i++) {
+		const sim_event *a = &logs[0].events[i], *b = &logs[1].events[i];
+		if (a->type != b->type || a->obj != b->obj || a->sensor_id != b->sensor_id || a->timecode != b->timecode ||
+			a->value != b->value) {
+			fprintf(stderr, "Simulation runs differ at event %zu\n", i);
+			rtn = -1;
+		}
+	}
+
+	free(logs[0].events);
+	free(logs[1].events);
+	return rtn;
+}
+
+TEST(Simulator, DeterministicGen1) { return check_simulation("1", "0", SIM_ANGLE); }
+
+TEST(Simulator, DeterministicGen2) { return check_simulation("2", "4", SIM_SWEEP); }
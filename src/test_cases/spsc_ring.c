@@ -0,0 +1,65 @@
+#include "../survive_spsc_ring.h"
+#include "os_generic.h"
+#include "test_case.h"
+
+#define RING_TEST_CNT 1000000
+
+static void *ring_producer(void *_ring) {
+	survive_spsc_ring *ring = _ring;
+	for (uint32_t i = 0; i < RING_TEST_CNT; i++) {
+		uint32_t *slot;
+		while ((slot = survive_spsc_ring_reserve(ring)) == 0) {
+		}
+		*slot = i;
+		survive_spsc_ring_commit(ring);
+	}
+	return 0;
+}
+
+TEST(SPSCRing, Threaded) {
+	survive_spsc_ring ring;
+	survive_spsc_ring_init(&ring, sizeof(uint32_t), 100);
+	ASSERT_EQ(ring.capacity, 128);
+
+	og_thread_t producer = OGCreateThread(ring_producer, "producer", &ring);
+	for (uint32_t i = 0; i < RING_TEST_CNT; i++) {
+		uint32_t *slot;
+		while ((slot = survive_spsc_ring_peek(&ring)) == 0) {
+		}
+		ASSERT_EQ(*slot, i);
+		survive_spsc_ring_pop(&ring);
+	}
+	OGJoinThread(producer);
+
+	ASSERT_EQ(survive_spsc_ring_depth(&ring), 0);
+	ASSERT_GE((double)ring.capacity, (double)ring.max_depth);
+	survive_spsc_ring_free(&ring);
+	return 0;
+}
+
+TEST(SPSCRing, Overflow) {
+	survive_spsc_ring ring;
+	survive_spsc_ring_init(&ring, sizeof(uint32_t), 4);
+
+	for (uint32_t i = 0; i < 6; i++) {
+		uint32_t *slot = survive_spsc_ring_reserve(&ring);
+		if (slot) {
+			*slot = i;
+			survive_spsc_ring_commit(&ring);
+		}
+	}
+	ASSERT_EQ(ring.overflow_cnt, 2);
+	ASSERT_EQ(ring.max_depth, 4);
+	ASSERT_EQ(survive_spsc_ring_depth(&ring), 4);
+
+	for (uint32_t i = 0; i < 4; i++) {
+		uint32_t *slot = survive_spsc_ring_peek(&ring);
+		ASSERT_EQ(*slot, i);
+		survive_spsc_ring_pop(&ring);
+	}
+	if (survive_spsc_ring_peek(&ring) != 0)
+		return -1;
+
+	survive_spsc_ring_free(&ring);
+	return 0;
+}
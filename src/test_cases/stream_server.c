@@ -0,0 +1,159 @@
+#include "../driver_stream_server.h"
+#include "../survive_internal.h"
+#include "../survive_private.h"
+#include "survive_stream.h"
+#include "test_case.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef union {
+	SurviveStreamHeader hdr;
+	SurviveStreamObject object;
+	SurviveStreamPose pose;
+	SurviveStreamVelocity velocity;
+	SurviveStreamStats stats;
+	uint8_t raw[512];
+} stream_message;
+
+static int connect_client(int port, int rcvbuf) {
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (rcvbuf) {
+		setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	}
+	struct timeval timeout = {.tv_sec = 5};
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(port)};
+	inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+// Message type read, or 0 on timeout / hangup
+static int read_message(int fd, stream_message *msg) {
+	if (recv(fd, &msg->hdr, sizeof(msg->hdr), MSG_WAITALL) != sizeof(msg->hdr) || msg->hdr.size > sizeof(*msg)) {
+		return 0;
+	}
+	size_t rest = msg->hdr.size - sizeof(msg->hdr);
+	if (rest && recv(fd, msg->raw + sizeof(msg->hdr), rest, MSG_WAITALL) != rest) {
+		return 0;
+	}
+	return msg->hdr.type;
+}
+
+static void subscribe(int fd, uint32_t type_mask, double min_period, const char *objects) {
+	SurviveStreamSubscribe sub = {
+		.hdr = {.size = sizeof(sub), .type = SURVIVE_STREAM_SUBSCRIBE}, .type_mask = type_mask, .min_period = min_period};
+	strncpy(sub.objects, objects, sizeof(sub.objects) - 1);
+	send(fd, &sub, sizeof(sub), 0);
+}
+
+static void request_stats(int fd) {
+	SurviveStreamHeader req = {.size = sizeof(req), .type = SURVIVE_STREAM_STATS_REQUEST};
+	send(fd, &req, sizeof(req), 0);
+}
+
+TEST(StreamServer, Clients) {
+	SurviveContext *ctx = SV_CALLOC(sizeof(SurviveContext));
+	ctx->private_members = SV_CALLOC(sizeof(struct SurviveContext_private));
+	ctx->log_target = stderr;
+
+	survive_stream_server *server = survive_stream_server_create(ctx, "127.0.0.1", 0, 4096);
+	ASSERT_EQ(server != 0, true);
+
+	SurviveObject hmd = {.ctx = ctx, .codename = "HMD", .serial_number = "LHR-0"};
+	SurviveObject wm0 = {.ctx = ctx, .codename = "WM0", .serial_number = "LHR-1"};
+	SurvivePose pose = {.Rot = {1}};
+	SurviveVelocity velocity = {0};
+	stream_message msg;
+
+	// Filtered down to one object's poses
+	int filtered = connect_client(survive_stream_server_port(server), 0);
+	ASSERT_GE(filtered, 0);
+	subscribe(filtered, SURVIVE_STREAM_MASK(SURVIVE_STREAM_POSE), 0, "WM1,WM0");
+	ASSERT_EQ(read_message(filtered, &msg), SURVIVE_STREAM_STATS);
+
+	pose.Pos[0] = 1;
+	survive_stream_server_pose(server, &hmd, 10, &pose);
+	survive_stream_server_velocity(server, &wm0, 20, &velocity);
+	survive_stream_server_pose(server, &wm0, 30, &pose);
+
+	ASSERT_EQ(read_message(filtered, &msg), SURVIVE_STREAM_OBJECT);
+	ASSERT_EQ(strcmp(msg.object.codename, "WM0"), 0);
+	ASSERT_EQ(strcmp(msg.object.serial_number, "LHR-1"), 0);
+	uint32_t wm0_idx = msg.hdr.object;
+	ASSERT_EQ(read_message(filtered, &msg), SURVIVE_STREAM_POSE);
+	ASSERT_EQ(msg.hdr.object, wm0_idx);
+	ASSERT_EQ(msg.hdr.timecode, 30);
+	ASSERT_DOUBLE_EQ(msg.pose.pose[0], 1.);
+	ASSERT_DOUBLE_EQ(msg.pose.pose[3], 1.);
+
+	// Nothing else was queued ahead of the stats
+	request_stats(filtered);
+	ASSERT_EQ(read_message(filtered, &msg), SURVIVE_STREAM_STATS);
+	ASSERT_EQ(msg.stats.dropped_messages, 0);
+
+	// Rate decimation
+	subscribe(filtered, SURVIVE_STREAM_MASK(SURVIVE_STREAM_POSE), 100, "");
+	ASSERT_EQ(read_message(filtered, &msg), SURVIVE_STREAM_STATS);
+	uint64_t decimated = msg.stats.decimated_messages;
+	for (int i = 0; i < 5; i++) {
+		survive_stream_server_pose(server, &wm0, 40 + i, &pose);
+	}
+	ASSERT_EQ(read_message(filtered, &msg), SURVIVE_STREAM_POSE);
+	ASSERT_EQ(msg.hdr.timecode, 40);
+	request_stats(filtered);
+	ASSERT_EQ(read_message(filtered, &msg), SURVIVE_STREAM_STATS);
+	ASSERT_EQ(msg.stats.decimated_messages - decimated, 4);
+
+	// A client that stops reading loses messages, without holding anything else up
+	int stalled = connect_client(survive_stream_server_port(server), 4096);
+	ASSERT_GE(stalled, 0);
+	request_stats(stalled);
+	ASSERT_EQ(read_message(stalled, &msg), SURVIVE_STREAM_STATS);
+
+	const int pose_cnt = 50000;
+	for (int i = 0; i < pose_cnt; i++) {
+		pose.Pos[0] = i;
+		survive_stream_server_pose(server, &wm0, 100 + i, &pose);
+	}
+
+	// Whatever got through has to be intact and in order
+	struct timeval timeout = {.tv_usec = 200000};
+	setsockopt(stalled, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	int received = 0;
+	double last = -1;
+	int type;
+	while ((type = read_message(stalled, &msg))) {
+		if (type == SURVIVE_STREAM_POSE) {
+			ASSERT_GT(msg.pose.pose[0], last);
+			ASSERT_EQ(msg.hdr.timecode, 100 + (uint64_t)msg.pose.pose[0]);
+			last = msg.pose.pose[0];
+			received++;
+		}
+	}
+	ASSERT_EQ(received > 0, true);
+
+	request_stats(stalled);
+	ASSERT_EQ(read_message(stalled, &msg), SURVIVE_STREAM_STATS);
+	ASSERT_EQ(msg.stats.dropped_messages > 0, true);
+	ASSERT_EQ(msg.stats.dropped_messages + received, pose_cnt);
+	ASSERT_EQ(msg.stats.max_queued_bytes <= 4096, true);
+
+	// Hanging up is noticed; publishing afterwards has nobody to send to
+	close(filtered);
+	close(stalled);
+	usleep(200000);
+	survive_stream_server_pose(server, &wm0, 1, &pose);
+
+	survive_stream_server_free(server);
+	free(ctx->private_members);
+	free(ctx);
+	return 0;
+}
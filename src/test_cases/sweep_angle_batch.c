@@ -0,0 +1,157 @@
+#include "../survive_internal.h"
+#include "../survive_default_devices.h"
+#include "../survive_kalman_tracker.h"
+#include "test_case.h"
+
+// Channel 2 lighthouses spin at 50.3673hz
+#define PERIOD_TICKS 953000u
+#define CHANNEL 2
+
+typedef struct {
+	SurviveSweepAngle angles[256];
+	size_t cnt, calls;
+} angle_log;
+
+static angle_log batched, per_angle;
+
+static void record_batch(SurviveObject *so, const SurviveSweepAngle *angles, size_t cnt) {
+	for (size_t i = 0; i < cnt; i++)
+		batched.angles[batched.cnt++] = angles[i];
+	batched.calls++;
+}
+
+static void record_angle(SurviveObject *so, survive_channel channel, int sensor_id, survive_timecode timecode,
+						 int8_t plane, FLT angle) {
+	per_angle.angles[per_angle.cnt++] = (SurviveSweepAngle){
+		.timecode = timecode, .angle = angle, .channel = channel, .sensor_id = sensor_id, .plane = plane};
+	per_angle.calls++;
+}
+
+static SurviveContext *sweep_context(const char *name) {
+	char *args[] = {(char *)name, "--v", "0", "--configfile", "test-sweep-angle-batch.json"};
+	SurviveContext *ctx = survive_init(SURVIVE_ARRAY_SIZE(args), args);
+	if (ctx == 0)
+		return 0;
+
+	ctx->lh_version = 1;
+	SurviveObject *so = survive_create_device(ctx, "TST", 0, "TS0", 0);
+	so->sensor_ct = 32;
+	survive_add_object(ctx, so);
+	return ctx;
+}
+
+// One sync, then 'sweeps' hits spread over both planes
+static void sweep_period(SurviveObject *so, survive_timecode start, int sweeps) {
+	SURVIVE_INVOKE_HOOK_SO(sync, so, CHANNEL, start, false, false);
+	for (int i = 0; i < sweeps; i++) {
+		survive_timecode offset = (i % 2 ? 650 : 250) * (PERIOD_TICKS / 1000) + i * 97;
+		SURVIVE_INVOKE_HOOK_SO(sweep, so, CHANNEL, i % 32, start + offset, false);
+	}
+}
+
+// Angles swept between syncs come out as one batch once the next sync arrives, or as soon as the tracker would
+// integrate them (light-batch-size, 32 by default)
+TEST(SweepAngleBatch, DeliveredPerSync) {
+	batched = (angle_log){0};
+	SurviveContext *ctx = sweep_context("test-sweep-angle-batch");
+	ASSERT_EQ(ctx != 0, true);
+	survive_install_sweep_angle_batch_fn(ctx, record_batch);
+	SurviveObject *so = ctx->objs[0];
+	size_t tracker_batch = survive_kalman_tracker_light_until_batch(so->tracker);
+	ASSERT_EQ(tracker_batch, 32);
+
+	sweep_period(so, 1000, 0);
+	sweep_period(so, 1000 + PERIOD_TICKS, 10);
+	ASSERT_EQ(batched.calls, 0);
+	ASSERT_EQ(so->pending_angle_cnt, 10);
+
+	sweep_period(so, 1000 + 2 * PERIOD_TICKS, tracker_batch + 6);
+	ASSERT_EQ(batched.calls, 2);
+	ASSERT_EQ(batched.cnt, 10 + tracker_batch);
+
+	survive_flush_sweep_angles(so);
+	ASSERT_EQ(batched.calls, 3);
+	ASSERT_EQ(batched.cnt, 16 + tracker_batch);
+	ASSERT_EQ(ctx->sweep_angle_batch_call_cnt, 3);
+
+	for (size_t i = 0; i < batched.cnt; i++) {
+		size_t hit = i < 10 ? i : i - 10;
+		ASSERT_EQ(batched.angles[i].channel, CHANNEL);
+		ASSERT_EQ(batched.angles[i].sensor_id, hit % 32);
+		ASSERT_EQ(batched.angles[i].plane, hit % 2);
+		// Stamped as they came in
+		ASSERT_EQ(i == 0 || batched.angles[i - 1].run_time <= batched.angles[i].run_time, true);
+	}
+
+	survive_close(ctx);
+	return 0;
+}
+
+// Nothing is left waiting for a sync which isn't coming
+TEST(SweepAngleBatch, FlushedWithoutSync) {
+	batched = (angle_log){0};
+	SurviveContext *ctx = sweep_context("test-sweep-angle-batch-no-sync");
+	ASSERT_EQ(ctx != 0, true);
+	survive_install_sweep_angle_batch_fn(ctx, record_batch);
+	SurviveObject *so = ctx->objs[0];
+
+	// Light from well past the last sync means the object lost it
+	sweep_period(so, 1000, 0);
+	sweep_period(so, 1000 + PERIOD_TICKS, 10);
+	ASSERT_EQ(batched.calls, 0);
+	SURVIVE_INVOKE_HOOK_SO(sweep, so, CHANNEL, 0, 1000 + 20 * PERIOD_TICKS, false);
+	ASSERT_EQ(batched.calls, 1);
+	ASSERT_EQ(batched.cnt, 10);
+	ASSERT_EQ(so->pending_angle_cnt, 0);
+
+	// Removing the device
+	sweep_period(so, 1000 + 30 * PERIOD_TICKS, 0);
+	sweep_period(so, 1000 + 31 * PERIOD_TICKS, 5);
+	ASSERT_EQ(batched.calls, 1);
+	survive_destroy_device(so);
+	ASSERT_EQ(batched.calls, 2);
+	ASSERT_EQ(batched.cnt, 15);
+
+	// Closing the context
+	so = survive_create_device(ctx, "TST", 0, "TS1", 0);
+	so->sensor_ct = 32;
+	survive_add_object(ctx, so);
+	sweep_period(so, 1000, 0);
+	sweep_period(so, 1000 + PERIOD_TICKS, 7);
+	ASSERT_EQ(batched.calls, 2);
+	survive_close(ctx);
+	ASSERT_EQ(batched.calls, 3);
+	ASSERT_EQ(batched.cnt, 22);
+	return 0;
+}
+
+// An installed sweep_angle hook still sees every angle, in order, through the default batch processing
+TEST(SweepAngleBatch, PerAngleFallback) {
+	batched = per_angle = (angle_log){0};
+
+	SurviveContext *batch_ctx = sweep_context("test-sweep-angle-batch-batched");
+	SurviveContext *angle_ctx = sweep_context("test-sweep-angle-batch-per-angle");
+	ASSERT_EQ(batch_ctx && angle_ctx, true);
+	survive_install_sweep_angle_batch_fn(batch_ctx, record_batch);
+	survive_install_sweep_angle_fn(angle_ctx, record_angle);
+
+	for (int period = 0; period < 4; period++) {
+		sweep_period(batch_ctx->objs[0], 1000 + period * PERIOD_TICKS, period * 20);
+		sweep_period(angle_ctx->objs[0], 1000 + period * PERIOD_TICKS, period * 20);
+	}
+
+	ASSERT_EQ(per_angle.cnt, batched.cnt);
+	ASSERT_EQ(per_angle.calls, batched.cnt);
+	// The last period is still pending, bar the first light-batch-size of it
+	ASSERT_EQ(batched.cnt, 20 + 40 + 32);
+	for (size_t i = 0; i < batched.cnt; i++) {
+		ASSERT_EQ(per_angle.angles[i].timecode, batched.angles[i].timecode);
+		ASSERT_EQ(per_angle.angles[i].sensor_id, batched.angles[i].sensor_id);
+		ASSERT_EQ(per_angle.angles[i].plane, batched.angles[i].plane);
+		ASSERT_EQ(per_angle.angles[i].angle == batched.angles[i].angle, true);
+	}
+
+	survive_close(batch_ctx);
+	survive_close(angle_ctx);
+	return 0;
+}
@@ -282,4 +282,101 @@ static int test_path(const char *filename, int main_argc, char **main_argv) {
 	return rtn;
 }
 
-int main(int argc, char **argv) { return test_path(argv[1], argc - 2, argv + 2); }
+typedef struct replay_output {
+	uint8_t *data;
+	size_t len, capacity;
+} replay_output;
+
+static void replay_output_append(replay_output *output, const void *data, size_t len) {
+	if (output->len + len > output->capacity) {
+		output->capacity = (output->len + len) * 2;
+		output->data = SV_REALLOC(output->data, output->capacity);
+	}
+	memcpy(output->data + output->len, data, len);
+	output->len += len;
+}
+
+static void replay_output_pose(SurviveObject *so, survive_long_timecode timecode, const SurvivePose *pose) {
+	replay_output *output = so->ctx->user_ptr;
+	replay_output_append(output, so->codename, sizeof(so->codename));
+	replay_output_append(output, &timecode, sizeof(timecode));
+	replay_output_append(output, pose, sizeof(*pose));
+	survive_default_pose_process(so, timecode, pose);
+}
+
+static void replay_output_velocity(SurviveObject *so, survive_long_timecode timecode, const SurviveVelocity *velocity) {
+	replay_output *output = so->ctx->user_ptr;
+	replay_output_append(output, so->codename, sizeof(so->codename));
+	replay_output_append(output, &timecode, sizeof(timecode));
+	replay_output_append(output, velocity, sizeof(*velocity));
+	survive_default_velocity_process(so, timecode, velocity);
+}
+
+static int play_deterministic(const char *filename, replay_output *output) {
+	char configPath[FILENAME_MAX] = {0};
+	sprintf(configPath, "%s.json", filename);
+
+	// Start from the same config every time; otherwise the second run would load what the first one saved
+	const char *saved_config = "test-replay-reproducible.json";
+	remove(saved_config);
+
+	char *argv[] = {"",
+					"--init-configfile",
+					configPath,
+					"--configfile",
+					(char *)saved_config,
+					"--playback",
+					(char *)filename,
+					"--playback-deterministic",
+					"--no-threaded-posers",
+					"--no-gss-threaded",
+					"--v",
+					"0"};
+	SurviveContext *ctx = survive_init(SURVIVE_ARRAY_SIZE(argv), argv);
+	if (ctx == 0)
+		return -1;
+
+	ctx->user_ptr = output;
+	survive_install_pose_fn(ctx, replay_output_pose);
+	survive_install_velocity_fn(ctx, replay_output_velocity);
+	while (survive_poll(ctx) == 0) {
+	}
+	survive_close(ctx);
+
+	remove(saved_config);
+	return 0;
+}
+
+// Plays the same recording twice with --playback-deterministic; every pose and velocity has to come out byte for byte
+// the same
+static int test_reproducible(const char *filename) {
+	replay_output outputs[2] = {0};
+	int rtn = 0;
+	for (int run = 0; run < 2 && rtn == 0; run++) {
+		rtn = play_deterministic(filename, &outputs[run]);
+	}
+
+	if (rtn == 0 && outputs[0].len == 0) {
+		fprintf(stderr, "TEST FAILED, %s produced no poses\n", filename);
+		rtn = -1;
+	}
+
+	if (rtn == 0 && (outputs[0].len != outputs[1].len || memcmp(outputs[0].data, outputs[1].data, outputs[0].len))) {
+		size_t i = 0;
+		while (i < outputs[0].len && i < outputs[1].len && outputs[0].data[i] == outputs[1].data[i])
+			i++;
+		fprintf(stderr, "TEST FAILED, %s played back differently: %zu vs %zu bytes, first difference at %zu\n",
+				filename, outputs[0].len, outputs[1].len, i);
+		rtn = -2;
+	}
+
+	free(outputs[0].data);
+	free(outputs[1].data);
+	return rtn;
+}
+
+int main(int argc, char **argv) {
+	if (argc > 2 && strcmp(argv[1], "--reproducible") == 0)
+		return test_reproducible(argv[2]);
+	return test_path(argv[1], argc - 2, argv + 2);
+}
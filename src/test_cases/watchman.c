@@ -5,8 +5,10 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "../driver_vive.h"
+#include "../survive_watchman.h"
 
 TEST(ViveDriver, TestWatchmanParsing) {
 
@@ -31,4 +33,83 @@ TEST(ViveDriver, TestWatchmanParsing) {
 		int cnt = parse_watchman_lightcap(0, "WW0", 224, 3761897504, readdata, sizeof(readdata), les, 10);
 	}
 	return 0;
-}
\ No newline at end of file
+}
+TEST(ViveDriver, DecodeWatchmanLight) {
+	uint8_t light[] = {0x88, 0x81, 0xa1, 0x10, 0x00, 0xd3, 0x06, 0x93, 0x03, 0xa3, 0x06, 0xf3, 0x06,
+					   0x83, 0x01, 0xd6, 0x06, 0xe4, 0xa8, 0x0c, 0xd9, 0x07, 0xc1, 0x92, 0xd2};
+	uint8_t packet[SURVIVE_WATCHMAN_PACKET_SIZE] = {224, sizeof(light) + 1, 0};
+	memcpy(packet + 3, light, sizeof(light));
+
+	LightcapElement les[10];
+	int cnt = parse_watchman_lightcap(0, "WW0", 224, 3761897504, light, sizeof(light), les, 10);
+	ASSERT_EQ(cnt > 0, true);
+
+	survive_watchman_decode_params params = {.reference_time = 3761897504};
+	survive_watchman_packet decoded;
+	ASSERT_EQ(survive_watchman_decode(&params, packet, sizeof(packet), &decoded), true);
+	ASSERT_EQ(decoded.event_cnt, cnt);
+
+	// parse_watchman_lightcap reports the latest pulse first
+	for (int i = 0; i < cnt; i++) {
+		ASSERT_EQ(decoded.events[i].type, SURVIVE_WATCHMAN_EVENT_LIGHTCAP);
+		LightcapElement *le = &decoded.events[i].lightcap;
+		ASSERT_EQ(le->sensor_id, les[cnt - 1 - i].sensor_id);
+		ASSERT_EQ(le->length, les[cnt - 1 - i].length);
+		ASSERT_EQ(le->timestamp, les[cnt - 1 - i].timestamp);
+	}
+	return 0;
+}
+
+TEST(ViveDriver, DecodeWatchmanV2) {
+	// clang-format off
+	uint8_t packet[SURVIVE_WATCHMAN_PACKET_SIZE] = {
+		0x12, 25, 0x34,
+		0xF0,										// IMU, metadata, input and light
+		0x56, 1, 0, 0xfe, 0xff, 3, 0, 0xfc, 0xff, 5, 0, 0xfa, 0xff, // IMU
+		0x80, 0xC5,									// Battery; charging at 69%
+		0xF5, 0x04, 0x80,							// Buttons and trigger
+		0x31,										// Channel 3
+		0xb2, 0xa2, 0x91, 0x28,						// Sweep on sensor 5
+	};
+	// clang-format on
+
+	// The IMU in the packet is a better reference than this stale one
+	survive_watchman_decode_params params = {.v2 = true, .raw1 = true, .reference_time = 0x11000000};
+	survive_watchman_packet decoded;
+	ASSERT_EQ(survive_watchman_decode(&params, packet, sizeof(packet), &decoded), true);
+	ASSERT_EQ(decoded.event_cnt, 4);
+	ASSERT_EQ(decoded.read_end, decoded.payload_end);
+
+	survive_watchman_event *imu = &decoded.events[0];
+	ASSERT_EQ(imu->type, SURVIVE_WATCHMAN_EVENT_IMU);
+	ASSERT_EQ(imu->imu.timecode, 0x12345600);
+	ASSERT_EQ(imu->imu.accel[1], -2);
+	ASSERT_EQ(imu->imu.gyro[2], -6);
+
+	ASSERT_EQ(decoded.events[1].type, SURVIVE_WATCHMAN_EVENT_BATTERY);
+	ASSERT_EQ(decoded.events[1].battery, 0xC5);
+
+	survive_watchman_event *input = &decoded.events[2];
+	ASSERT_EQ(input->type, SURVIVE_WATCHMAN_EVENT_INPUT);
+	ASSERT_EQ(input->input.fields, SURVIVE_WATCHMAN_INPUT_BUTTONS | SURVIVE_WATCHMAN_INPUT_TRIGGER);
+	ASSERT_EQ(input->input.buttons, 0x04);
+	ASSERT_EQ(input->input.trigger, 0x80);
+
+	survive_watchman_event *sweep = &decoded.events[3];
+	ASSERT_EQ(sweep->type, SURVIVE_WATCHMAN_EVENT_SWEEP);
+	ASSERT_EQ(sweep->sweep.channel, 3);
+	ASSERT_EQ(sweep->sweep.sensor, 5);
+	ASSERT_EQ(sweep->sweep.timecode, 0x12123456);
+
+	// Cut off partway through the IMU data
+	packet[1] = 8;
+	ASSERT_EQ(survive_watchman_decode(&params, packet, sizeof(packet), &decoded), false);
+	ASSERT_EQ(decoded.status, SURVIVE_WATCHMAN_ERROR_TRUNCATED);
+	ASSERT_EQ(decoded.event_cnt, 0);
+
+	// Claims more than the report holds
+	packet[1] = SURVIVE_WATCHMAN_PACKET_SIZE;
+	ASSERT_EQ(survive_watchman_decode(&params, packet, sizeof(packet), &decoded), false);
+	ASSERT_EQ(decoded.status, SURVIVE_WATCHMAN_ERROR_SIZE);
+	return 0;
+}
@@ -0,0 +1,192 @@
+// Converts recordings between the text (.rec / .rec.gz) and binary (.svbr) formats. The direction is picked from the
+// input; binary recordings are written out as text and anything else is written out as binary.
+//
+// Also builds seek indexes for gz recordings ('--index') and cuts time ranges out of them ('--extract'); see
+// survive_gz_index.h.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <survive.h>
+
+#include "src/survive_binary_recording.h"
+#include "src/survive_gz.h"
+#include "src/survive_gz_index.h"
+#include "src/survive_recording.h"
+
+static bool ends_with(const char *s, const char *suffix) {
+	size_t len = strlen(s), suffix_len = strlen(suffix);
+	return len >= suffix_len && strcmp(s + len - suffix_len, suffix) == 0;
+}
+
+static char *read_line(gzFile f, char **buffer, size_t *size) {
+	size_t len = 0;
+	while (gzgets(f, *buffer + len, (int)(*size - len))) {
+		len += strlen(*buffer + len);
+		if (len > 0 && (*buffer)[len - 1] == '\n')
+			return *buffer;
+
+		*size *= 2;
+		*buffer = SV_REALLOC(*buffer, *size);
+	}
+	return len ? *buffer : 0;
+}
+
+static int text_to_binary(const char *input, const char *output) {
+	gzFile in = gzopen(input, "r");
+	if (in == 0) {
+		fprintf(stderr, "Could not open %s\n", input);
+		return -1;
+	}
+	survive_binary_writer *writer = survive_binary_writer_open(output, 6);
+	if (writer == 0) {
+		fprintf(stderr, "Could not open %s for writing\n", output);
+		gzclose(in);
+		return -1;
+	}
+
+	size_t size = 4096, lineno = 0, records = 0, typed = 0;
+	char *line = SV_MALLOC(size);
+	void *data = 0;
+	size_t data_size = 0;
+	while (read_line(in, &line, &size)) {
+		lineno++;
+		char *rest = 0;
+		double time = strtod(line, &rest);
+		if (rest == line || *rest != ' ')
+			continue;
+		rest++;
+
+		size_t needed = strlen(rest) + SURVIVE_BINARY_RECORD_MAX_TYPED_SIZE;
+		if (needed > data_size) {
+			data_size = needed;
+			data = SV_REALLOC(data, data_size);
+		}
+
+		survive_binary_record_header hdr;
+		int length = survive_binary_record_parse(rest, &hdr, data, data_size);
+		if (length < 0 || survive_binary_writer_write(writer, time, hdr.type, hdr.dev, data, length) != 0) {
+			fprintf(stderr, "Could not convert line %zu: %s", lineno, line);
+			continue;
+		}
+
+		records++;
+		typed += hdr.type != SURVIVE_BINARY_RECORD_TEXT;
+	}
+
+	free(data);
+	free(line);
+	gzclose(in);
+
+	int rtn = survive_binary_writer_close(writer);
+	fprintf(stderr, "Wrote %zu records (%zu typed) to %s\n", records, typed, output);
+	return rtn;
+}
+
+static int binary_to_text(const char *input, const char *output) {
+	survive_binary_reader *reader = survive_binary_reader_open(input);
+	if (reader == 0) {
+		fprintf(stderr, "Could not open %s\n", input);
+		return -1;
+	}
+	gzFile out = gzopen(output, ends_with(output, ".gz") ? "w6F" : "wT");
+	if (out == 0) {
+		fprintf(stderr, "Could not open %s for writing\n", output);
+		survive_binary_reader_close(reader);
+		return -1;
+	}
+
+	size_t size = 4096, records = 0;
+	char *buffer = SV_MALLOC(size);
+	survive_binary_record record;
+	int r;
+	while ((r = survive_binary_reader_next(reader, &record)) > 0) {
+		int len = survive_binary_record_format(&record, buffer, size);
+		if (len >= (int)size) {
+			size = len + 1;
+			buffer = SV_REALLOC(buffer, size);
+			len = survive_binary_record_format(&record, buffer, size);
+		}
+		if (len < 0) {
+			fprintf(stderr, "Skipping record with unknown type %d\n", record.hdr.type);
+			continue;
+		}
+
+		gzprintf(out, FLT_PRINTF, record.hdr.time);
+		gzwrite(out, buffer, len);
+		records++;
+	}
+
+	if (r < 0) {
+		fprintf(stderr, "%s is corrupt after %zu records\n", input, records);
+	}
+
+	free(buffer);
+	gzclose(out);
+	survive_binary_reader_close(reader);
+	fprintf(stderr, "Wrote %zu records to %s\n", records, output);
+	return r < 0 ? -1 : 0;
+}
+
+static int build_index(const char *input) {
+	size_t len = strlen(input) + strlen(SURVIVE_GZ_INDEX_EXTENSION) + 1;
+	char *index_filename = SV_MALLOC(len);
+	snprintf(index_filename, len, "%s" SURVIVE_GZ_INDEX_EXTENSION, input);
+
+	int rtn = -1;
+	survive_gz_index *index = survive_gz_index_build(input, SURVIVE_GZ_INDEX_SPAN);
+	if (index == 0) {
+		fprintf(stderr, "Could not index %s; only single member gzip files can be indexed\n", input);
+	} else if (survive_gz_index_save(index, index_filename) != 0) {
+		fprintf(stderr, "Could not write %s\n", index_filename);
+	} else {
+		fprintf(stderr, "Wrote %zu access points and %zu state lines to %s\n", survive_gz_index_point_count(index),
+				survive_gz_index_state_line_count(index), index_filename);
+		rtn = 0;
+	}
+
+	survive_gz_index_free(index);
+	free(index_filename);
+	return rtn;
+}
+
+static int extract(const char *input, const char *output, double start, double end) {
+	survive_gz_index *index = survive_gz_index_open(input);
+	if (index == 0) {
+		fprintf(stderr, "Could not index %s; only single member gzip files can be indexed\n", input);
+		return -1;
+	}
+
+	int lines = survive_gz_index_extract(index, input, output, start, end);
+	survive_gz_index_free(index);
+	if (lines < 0) {
+		fprintf(stderr, "Could not extract %f-%f from %s to %s\n", start, end, input, output);
+		return -1;
+	}
+	fprintf(stderr, "Wrote %d lines to %s\n", lines, output);
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	if (argc == 3 && strcmp(argv[1], "--index") == 0) {
+		return build_index(argv[2]);
+	}
+	if (argc == 6 && strcmp(argv[1], "--extract") == 0) {
+		return extract(argv[2], argv[3], atof(argv[4]), atof(argv[5]));
+	}
+
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s <input> <output>\n", argv[0]);
+		fprintf(stderr, "  Binary (" SURVIVE_BINARY_RECORDING_EXTENSION ") inputs are converted to text; anything else "
+						"is converted to binary.\n");
+		fprintf(stderr, "       %s --index <input.rec.gz>\n", argv[0]);
+		fprintf(stderr, "       %s --extract <input.rec.gz> <output> <start time> <end time>\n", argv[0]);
+		return -1;
+	}
+
+	if (survive_binary_recording_file_is_binary(argv[1])) {
+		return binary_to_text(argv[1], argv[2]);
+	}
+	return text_to_binary(argv[1], argv[2]);
+}
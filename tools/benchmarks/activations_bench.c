@@ -0,0 +1,102 @@
+// Measures scans over an object's SurviveSensorActivations with few and with many lighthouses. Each lighthouse only
+// sees part of the object, so most of the sensor / lighthouse / axis table is never written; the dense scan is the
+// loop valid_counts used to run over every entry, and it's compared against the library's, which walks the reading
+// masks instead. Both have to agree on the counts.
+//
+// The size it prints is what every object carries, with 2 lighthouses or 16: the masks make scans cheaper, but the
+// dense tables are still there in full, so there is no memory saving to measure.
+//
+// Usage: survive-bench-activations [scans=200000]
+
+#include <libsurvive/survive.h>
+#include <os_generic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_VISIBLE_SENSORS 12
+
+static void dense_counts(const SurviveSensorActivations *self, survive_long_timecode tolerance, uint32_t *meas_cnt,
+						 uint32_t *lh_count) {
+	const SurviveObject *so = self->so;
+	for (int lh = 0; lh < so->ctx->activeLighthouses; lh++) {
+		bool seenLH = false;
+		for (int sensor = 0; sensor < so->sensor_ct; sensor++) {
+			for (int axis = 0; axis < 2; axis++) {
+				if (SurviveSensorActivations_time_since_last_reading(self, sensor, lh, axis) < tolerance) {
+					(*meas_cnt)++;
+					if (!seenLH)
+						(*lh_count)++;
+					seenLH = true;
+				}
+			}
+		}
+	}
+}
+
+static void fill(SurviveObject *so, int lh_cnt) {
+	SurviveSensorActivations *activations = &so->activations;
+	SurviveSensorActivations_reset(activations);
+	activations->params.moveThresholdAng = .02;
+	activations->params.filterLightChange = -2;
+
+	survive_long_timecode timecode = 48000000;
+	for (int lh = 0; lh < lh_cnt; lh++) {
+		// A contiguous run of sensors, as if one side of the object faced this lighthouse
+		int first = rand() % so->sensor_ct;
+		for (int i = 0; i < BENCH_VISIBLE_SENSORS; i++) {
+			for (int plane = 0; plane < 2; plane++) {
+				PoserDataLightGen2 l = {.common = {.hdr = {.pt = POSERDATA_LIGHT_GEN2, .timecode = timecode++},
+												   .sensor_id = (first + i) % so->sensor_ct,
+												   .lh = lh,
+												   .angle = (rand() / (FLT)RAND_MAX - .5)},
+										.plane = plane};
+				SurviveSensorActivations_add_gen2(activations, &l);
+			}
+		}
+	}
+}
+
+static void bench(SurviveObject *so, int lh_cnt, int scans) {
+	SurviveContext *ctx = so->ctx;
+	ctx->activeLighthouses = lh_cnt;
+	for (int lh = 0; lh < lh_cnt; lh++)
+		ctx->bsd[lh].PositionSet = true;
+	fill(so, lh_cnt);
+
+	survive_long_timecode tolerance = 48000000;
+	uint32_t dense_meas = 0, dense_lh = 0, meas = 0, lh = 0;
+
+	double start = OGRelativeTime();
+	for (int i = 0; i < scans; i++)
+		dense_counts(&so->activations, tolerance, &dense_meas, &dense_lh);
+	double dense_s = OGRelativeTime() - start;
+
+	start = OGRelativeTime();
+	for (int i = 0; i < scans; i++)
+		SurviveSensorActivations_valid_counts(&so->activations, tolerance, &meas, &lh, 0, 0);
+	double masked_s = OGRelativeTime() - start;
+
+	printf("%2d lighthouses, %3u live readings of %4u: dense %8.1f ns/scan  masked %8.1f ns/scan  speedup %5.2fx%s\n",
+		   lh_cnt, meas / scans, (unsigned)(2 * so->sensor_ct * lh_cnt), dense_s / scans * 1e9,
+		   masked_s / scans * 1e9, dense_s / (masked_s + 1e-12),
+		   meas == dense_meas && lh == dense_lh ? "" : "  COUNTS DIFFER");
+}
+
+int main(int argc, char **argv) {
+	int scans = argc > 1 ? atoi(argv[1]) : 200000;
+
+	SurviveContext *ctx = SV_CALLOC(sizeof(SurviveContext));
+	SurviveObject *so = SV_CALLOC(sizeof(SurviveObject));
+	so->ctx = ctx;
+	so->sensor_ct = SENSORS_PER_OBJECT;
+	so->activations.so = so;
+
+	printf("sizeof(SurviveSensorActivations) = %u bytes\n", (unsigned)sizeof(SurviveSensorActivations));
+	bench(so, 2, scans);
+	bench(so, NUM_GEN2_LIGHTHOUSES, scans);
+
+	free(so);
+	free(ctx);
+	return 0;
+}
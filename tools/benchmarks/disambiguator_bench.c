@@ -0,0 +1,117 @@
+// Measures the gen1 disambiguator on generated light from two lighthouses taking turns sweeping. The same stream goes
+// through handle_lightcap one element at a time, and through handle_lightcaps a USB packet (9 elements) at a time; both
+// have to produce the same light events. The second stream is light the disambiguator can never lock onto, which
+// keeps it searching.
+//
+// Usage: survive-bench-disambiguator [cycles=2000] [sensors=32]
+
+#include <os_generic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <survive_default_devices.h>
+#include <survive_internal.h>
+
+#define CYCLE_TICKS 1600000
+#define USB_PACKET_ELEMENTS 9
+
+#define ACODE_TIMING(acode)                                                                                            \
+	((3000 + ((acode)&1) * 500 + (((acode) >> 1) & 1) * 1000 + (((acode) >> 2) & 1) * 2000) - 250)
+
+static size_t light_events;
+static uint32_t light_checksum;
+static void count_light(SurviveObject *so, int sensor_id, int acode, int timeinsweep, survive_timecode timecode,
+						survive_timecode length, uint32_t lh) {
+	light_events++;
+	light_checksum = light_checksum * 31 + sensor_id * 7 + acode * 3 + timeinsweep + timecode + length + lh;
+}
+
+static size_t generate(LightcapElement *les, int cycles, int sensors, bool lockable) {
+	static const int acodes[4][2] = {{4, 0}, {5, 1}, {0, 4}, {1, 5}};
+	size_t cnt = 0;
+	for (int cycle = 0; cycle < cycles; cycle++) {
+		for (int step = 0; step < 4; step++) {
+			uint32_t t = 1000 + (uint32_t)cycle * CYCLE_TICKS + step * 400000u;
+			for (int pulse = 0; pulse < 2; pulse++) {
+				int acode = lockable ? acodes[step][pulse] | (rand() % 2 ? 2 : 0) : rand() % 8;
+				for (int sensor = 0; sensor < sensors; sensor++) {
+					les[cnt++] = (LightcapElement){.sensor_id = sensor,
+												   .length = ACODE_TIMING(acode) + rand() % 200 - 100,
+												   .timestamp = t + pulse * 20000 + sensor * 2};
+				}
+			}
+			for (int sensor = 0; sensor < sensors; sensor++) {
+				les[cnt++] = (LightcapElement){.sensor_id = sensor,
+											   .length = 150 + rand() % 250,
+											   .timestamp = t + 100000 + sensor * (250000 / sensors) + rand() % 500};
+			}
+		}
+	}
+	return cnt;
+}
+
+static SurviveContext *bench_context(int sensors) {
+	char *args[] = {"survive-bench-disambiguator", "--v", "0", "--configfile", "survive-bench-disambiguator.json"};
+	SurviveContext *ctx = survive_init(sizeof(args) / sizeof(args[0]), args);
+	if (ctx == 0)
+		return 0;
+
+	ctx->lh_version = 0;
+	survive_install_light_fn(ctx, count_light);
+	survive_add_object(ctx, survive_create_device(ctx, "BEN", 0, "BN0", 0));
+	ctx->objs[0]->sensor_ct = sensors;
+	return ctx;
+}
+
+static double run(const LightcapElement *les, size_t cnt, int sensors, bool batched, size_t *events, uint32_t *sum) {
+	SurviveContext *ctx = bench_context(sensors);
+	if (ctx == 0)
+		exit(-1);
+
+	// survive_startup normally picks these
+	ctx->lightcapproc = (lightcap_process_func)GetDriver("DisambiguatorStateBased");
+	survive_install_lightcaps_fn(ctx, (lightcaps_process_func)GetDriver("LightcapsStateBased"));
+
+	light_events = light_checksum = 0;
+	double start = OGRelativeTime();
+	for (size_t i = 0; i < cnt; i += USB_PACKET_ELEMENTS) {
+		size_t packet = cnt - i < USB_PACKET_ELEMENTS ? cnt - i : USB_PACKET_ELEMENTS;
+		if (batched) {
+			handle_lightcaps(ctx->objs[0], les + i, packet);
+		} else {
+			for (size_t j = 0; j < packet; j++)
+				handle_lightcap(ctx->objs[0], les + i + j);
+		}
+	}
+	double elapsed = OGRelativeTime() - start;
+
+	*events = light_events;
+	*sum = light_checksum;
+	survive_close(ctx);
+	return elapsed;
+}
+
+int main(int argc, char **argv) {
+	int cycles = argc > 1 ? atoi(argv[1]) : 2000;
+	int sensors = argc > 2 ? atoi(argv[2]) : 32;
+	if (sensors > 32)
+		sensors = 32;
+
+	LightcapElement *les = calloc((size_t)cycles * 4 * 3 * sensors, sizeof(LightcapElement));
+	for (int lockable = 1; lockable >= 0; lockable--) {
+		size_t cnt = generate(les, cycles, sensors, lockable);
+
+		size_t serial_events, batched_events;
+		uint32_t serial_sum, batched_sum;
+		double serial_s = run(les, cnt, sensors, false, &serial_events, &serial_sum);
+		double batched_s = run(les, cnt, sensors, true, &batched_events, &batched_sum);
+
+		printf("%-10s %9zu elements: per element %12.0f elements/s  batched %12.0f elements/s  speedup %5.2fx  "
+			   "%zu light events%s\n",
+			   lockable ? "tracking" : "searching", cnt, cnt / serial_s, cnt / batched_s,
+			   serial_s / (batched_s + 1e-12), batched_events,
+			   serial_events == batched_events && serial_sum == batched_sum ? "" : "  LIGHT EVENTS DIFFER");
+	}
+
+	free(les);
+	return 0;
+}
@@ -0,0 +1,125 @@
+// Measures gen2 raw light decoding on packets of 4 samples generated from random polynomials and positions. The
+// bit-serial test is the loop survive_decipher_channel used to run over each polynomial, stepping the LFSR one bit at a
+// time; it's compared against the library's bitsliced test of all 32 at once, and both have to agree on the candidates.
+//
+// Usage: survive-bench-lfsr-lh2 [packets=200000]
+
+#include <lfsr_lh2.h>
+#include <os_generic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_SAMPLES_PER_PACKET 4
+#define BENCH_PERIOD 131071
+
+static uint32_t parity(uint32_t v) {
+	uint32_t c = 0;
+	for (; v; v &= v - 1)
+		c ^= 1;
+	return c;
+}
+
+static uint32_t step(uint32_t state, lfsr_poly_t poly) { return (state << 1u) | parity(state & poly & 0x1ffff); }
+
+static uint32_t step_back(uint32_t state, lfsr_poly_t poly) {
+	uint32_t prev = (state & 0x1ffff) >> 1u;
+	return prev | (((state & 1u) ^ parity(prev & poly)) << 16);
+}
+
+static uint32_t bit_serial_possible_polys(uint32_t sample, uint32_t mask) {
+	int offset = -1;
+	for (int i = 0; i < 15 && offset < 0; i++) {
+		if (((mask >> (15 - i)) & 0x1ffff) == 0x1ffff)
+			offset = i;
+	}
+	if (offset < 0)
+		return 0xFFFFFFFF;
+
+	uint32_t rtn = 0;
+	for (int i = 0; i < 32; i++) {
+		lfsr_poly_t poly = survive_lh2_poly(i);
+		uint32_t state = (sample >> (15 - offset)) & 0x1ffff;
+		for (int j = 0; j < offset; j++)
+			state = step_back(state, poly);
+		for (int j = 0; j < 15; j++)
+			state = step(state, poly);
+		if (((state ^ sample) & mask) == 0)
+			rtn |= 1u << i;
+	}
+	return rtn;
+}
+
+typedef struct packet {
+	int poly;
+	uint32_t sample[BENCH_SAMPLES_PER_PACKET], mask[BENCH_SAMPLES_PER_PACKET], times[BENCH_SAMPLES_PER_PACKET];
+} packet;
+
+static void generate(packet *p) {
+	p->poly = rand() % 32;
+	lfsr_poly_t poly = survive_lh2_poly(p->poly);
+
+	uint32_t state = 1 + rand() % BENCH_PERIOD, bits = 0;
+	for (int i = 0; i < BENCH_SAMPLES_PER_PACKET; i++) {
+		uint32_t window = state;
+		for (int j = 0; j < 15; j++)
+			window = step(window, poly);
+
+		// The first sample always has a run of 17 to match against; the others only sometimes do
+		if (i == 0 || rand() % 2) {
+			p->mask[i] = (0x1ffffu << (rand() % 16)) | (rand() & rand());
+		} else {
+			p->mask[i] = ((0xfffu << (rand() % 4)) | (0xfffu << (16 + rand() % 4))) & ~(1u << (12 + rand() % 4));
+		}
+		p->sample[i] = (window & p->mask[i]) | (rand() & ~p->mask[i]);
+		p->times[i] = 48000000 + bits * 8 + rand() % 5 - 2;
+
+		uint32_t advance = 20 + rand() % 500;
+		bits += advance;
+		for (uint32_t j = 0; j < advance; j++)
+			state = step(state, poly) & 0x1ffff;
+	}
+}
+
+int main(int argc, char **argv) {
+	int packet_cnt = argc > 1 ? atoi(argv[1]) : 200000;
+	packet *packets = calloc(packet_cnt, sizeof(packet));
+	for (int i = 0; i < packet_cnt; i++)
+		generate(&packets[i]);
+	size_t sample_cnt = (size_t)packet_cnt * BENCH_SAMPLES_PER_PACKET;
+
+	double start = OGRelativeTime();
+	survive_lh2_possible_polys(0, 0);
+	double tables_s = OGRelativeTime() - start;
+
+	uint32_t serial_sum = 0, sliced_sum = 0;
+	start = OGRelativeTime();
+	for (int i = 0; i < packet_cnt; i++)
+		for (int j = 0; j < BENCH_SAMPLES_PER_PACKET; j++)
+			serial_sum += bit_serial_possible_polys(packets[i].sample[j], packets[i].mask[j]);
+	double serial_s = OGRelativeTime() - start;
+
+	start = OGRelativeTime();
+	for (int i = 0; i < packet_cnt; i++)
+		for (int j = 0; j < BENCH_SAMPLES_PER_PACKET; j++)
+			sliced_sum += survive_lh2_possible_polys(packets[i].sample[j], packets[i].mask[j]);
+	double sliced_s = OGRelativeTime() - start;
+
+	int decoded = 0;
+	start = OGRelativeTime();
+	for (int i = 0; i < packet_cnt; i++) {
+		uint32_t output[BENCH_SAMPLES_PER_PACKET];
+		decoded += survive_decipher_channel(packets[i].sample, packets[i].mask, packets[i].times, output,
+											BENCH_SAMPLES_PER_PACKET) == packets[i].poly;
+	}
+	double decode_s = OGRelativeTime() - start;
+
+	printf("tables built in %.2f ms\n", tables_s * 1e3);
+	printf("candidate test: bit-serial %12.0f samples/s  bitsliced %12.0f samples/s  speedup %5.2fx%s\n",
+		   sample_cnt / serial_s, sample_cnt / sliced_s, serial_s / (sliced_s + 1e-12),
+		   serial_sum == sliced_sum ? "" : "  CANDIDATES DIFFER");
+	printf("full decode:    %12.0f samples/s, %d of %d packets decoded to their polynomial\n", sample_cnt / decode_s,
+		   decoded, packet_cnt);
+
+	free(packets);
+	return 0;
+}
@@ -0,0 +1,128 @@
+// Measures how long survive_optimizer takes to evaluate the residuals and jacobian of serialized problems as
+// optimizer-threads grows, and checks that every thread count produces output -- deviates, jacobian and error stats --
+// bit identical to the serial path.
+//
+// Problems are the files written by survive_optimizer_serialize -- debug.opt from survive_optimizer_run, for
+// instance. Like survive-solver, the object's sensor positions are read from '<codename>_config.json' in the working
+// directory.
+//
+// Usage: survive-bench-optimizer-threads [max-threads=8] [evaluations=200] problem.opt [problem.opt...]
+
+#include <libsurvive/survive.h>
+#include <os_generic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <survive_optimizer.h>
+
+typedef struct evaluation {
+	FLT *deviates, *jacobian, **derivs;
+	FLT sensor_error, object_up_error, params_error;
+} evaluation;
+
+static void evaluation_init(evaluation *e, const survive_optimizer *opt, int m, int n) {
+	e->deviates = SV_CALLOC_N(m, sizeof(FLT));
+	e->jacobian = SV_CALLOC_N((size_t)m * n, sizeof(FLT));
+	e->derivs = SV_CALLOC_N(n, sizeof(FLT *));
+	for (int j = 0; j < n; j++) {
+		if (!opt->mp_parameters_info[j].fixed)
+			e->derivs[j] = e->jacobian + (size_t)j * m;
+	}
+}
+
+static void evaluation_save_stats(evaluation *e, const survive_optimizer *opt) {
+	e->sensor_error = opt->stats.sensor_error;
+	e->object_up_error = opt->stats.object_up_error;
+	e->params_error = opt->stats.params_error;
+}
+
+static void evaluation_free(evaluation *e) {
+	free(e->deviates);
+	free(e->jacobian);
+	free(e->derivs);
+}
+
+static int bench_problem(SurviveContext *ctx, const char *fn, int max_threads, int evaluations) {
+	survive_optimizer *opt = survive_optimizer_load(fn);
+	if (opt == 0) {
+		fprintf(stderr, "Could not load %s\n", fn);
+		return -1;
+	}
+	if (opt->sos[0]->sensor_locations == 0 || opt->cameraLength == 0) {
+		fprintf(stderr, "%s has no sensor config or no lighthouses; skipping\n", fn);
+		return -1;
+	}
+	for (int i = 0; i < opt->poseLength; i++) {
+		opt->sos[i]->ctx = ctx;
+	}
+
+	survive_optimizer_settings settings = *opt->settings;
+	opt->settings = &settings;
+
+	int m = opt->measurementsCnt;
+	int n = survive_optimizer_get_parameters_count(opt);
+	printf("%s: %d measurements, %d parameters\n", fn, m, n);
+	printf("%8s %14s %8s %10s\n", "threads", "us / eval", "speedup", "identical");
+
+	evaluation serial;
+	evaluation_init(&serial, opt, m, n);
+	settings.threads = 1;
+	survive_optimizer_evaluate(opt, opt->parameters, serial.deviates, serial.derivs);
+	evaluation_save_stats(&serial, opt);
+
+	double serial_time = 0;
+	int rtn = 0;
+	for (int threads = 1; threads <= max_threads; threads *= 2) {
+		settings.threads = threads;
+
+		evaluation e;
+		evaluation_init(&e, opt, m, n);
+
+		double start = OGRelativeTime();
+		for (int i = 0; i < evaluations; i++) {
+			survive_optimizer_evaluate(opt, opt->parameters, e.deviates, e.derivs);
+		}
+		double elapsed = (OGRelativeTime() - start) / evaluations;
+		evaluation_save_stats(&e, opt);
+		if (threads == 1)
+			serial_time = elapsed;
+
+		bool identical = memcmp(serial.deviates, e.deviates, m * sizeof(FLT)) == 0 &&
+						 memcmp(serial.jacobian, e.jacobian, (size_t)m * n * sizeof(FLT)) == 0 &&
+						 serial.sensor_error == e.sensor_error && serial.object_up_error == e.object_up_error &&
+						 serial.params_error == e.params_error;
+		printf("%8d %14.2f %7.2fx %10s\n", threads, elapsed * 1e6, serial_time / (elapsed + 1e-15),
+			   identical ? "yes" : "NO");
+		fflush(stdout);
+
+		if (!identical)
+			rtn = -1;
+		evaluation_free(&e);
+	}
+
+	evaluation_free(&serial);
+	return rtn;
+}
+
+int main(int argc, char **argv) {
+	int max_threads = argc > 1 ? atoi(argv[1]) : 8;
+	int evaluations = argc > 2 ? atoi(argv[2]) : 200;
+	if (argc < 4 || max_threads < 1 || evaluations < 1) {
+		fprintf(stderr, "Usage: %s [max-threads=8] [evaluations=200] problem.opt [problem.opt...]\n", argv[0]);
+		return -1;
+	}
+
+	char *args[] = {argv[0], "--configfile", "survive-bench-optimizer-threads.json", "--v", "0"};
+	SurviveContext *ctx = survive_init(sizeof(args) / sizeof(args[0]), args);
+	if (ctx == 0)
+		return -1;
+
+	int rtn = 0;
+	for (int i = 3; i < argc; i++) {
+		if (bench_problem(ctx, argv[i], max_threads, evaluations) != 0)
+			rtn = -1;
+	}
+
+	survive_close(ctx);
+	return rtn;
+}
@@ -0,0 +1,228 @@
+// Measures how many poser solutions per second libsurvive produces as the number of tracked objects grows, with and
+// without the sharded object pipeline.
+//
+// A synthetic driver feeds noise-free gen2 sync / sweep angle data for N static objects seen by two lighthouses as
+// fast as it can, taking the ingest lock as a USB driver does. A thin poser wrapper counts the SYNC_GEN2 solves that
+// reach the configured poser (MPFIT by default).
+//
+// Usage: survive-bench-pose-throughput [max-trackers=8] [seconds-per-run=5] [extra libsurvive args...]
+
+#include <libsurvive/survive.h>
+#include <math.h>
+#include <os_generic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <survive_reproject_gen2.h>
+
+SURVIVE_EXPORT survive_driver_fn GetDriver(const char *name);
+SURVIVE_EXPORT SurviveObject *survive_create_device(SurviveContext *ctx, const char *driver_name, void *driver,
+													const char *device_name, haptic_func fn);
+
+STATIC_CONFIG_ITEM(POSEBENCH_OBJECTS, "posebench-objects", 'i', "Number of objects the benchmark driver creates", 1)
+STATIC_CONFIG_ITEM(POSEBENCH_POSER, "posebench-poser", 's', "Poser the benchmark poser forwards to", "PoserMPFIT")
+
+#define BENCH_MAX_OBJECTS 32
+#define BENCH_SENSOR_CNT 20
+#define BENCH_LH_CNT 2
+
+static uint32_t solve_counts[BENCH_MAX_OBJECTS];
+static PoserCB inner_poser;
+
+typedef struct BenchDriver {
+	SurviveContext *ctx;
+	SurviveObject *objs[BENCH_MAX_OBJECTS];
+	SurvivePose obj2world[BENCH_MAX_OBJECTS];
+	size_t obj_cnt;
+	survive_timecode timecode;
+	bool *keepRunning;
+} BenchDriver;
+
+static const SurvivePose bench_lh_poses[BENCH_LH_CNT] = {
+	{.Pos = {-3, 0, 1}, .Rot = {-0.70710678118, 0, 0.70710678118, 0}},
+	{.Pos = {3, 0, 1}, .Rot = {0.70710678118, 0, 0.70710678118, 0}},
+};
+
+static int object_index(const SurviveObject *so) { return atoi(so->codename + 1); }
+
+int PoserBenchCount(SurviveObject *so, PoserData *pd) {
+	if (pd->pt == POSERDATA_SYNC_GEN2) {
+		solve_counts[object_index(so)]++;
+	}
+	return inner_poser ? inner_poser(so, pd) : 0;
+}
+REGISTER_LINKTIME(PoserBenchCount)
+
+static char *generate_object_config(FLT r) {
+	size_t len = 256 + BENCH_SENSOR_CNT * 2 * 64;
+	char *cfg = SV_CALLOC(len);
+	char *p = cfg;
+	p += sprintf(p, "{\"lighthouse_config\": {\"modelNormals\": [");
+	for (int pass = 0; pass < 2; pass++) {
+		for (int i = 0; i < BENCH_SENSOR_CNT; i++) {
+			// Fibonacci sphere, upper hemisphere only so everything faces out of the object
+			FLT z = 1. - (i + .5) / (FLT)BENCH_SENSOR_CNT;
+			FLT rr = sqrt(1 - z * z);
+			FLT phi = i * LINMATHPI * (3. - sqrt(5.));
+			FLT s = pass == 0 ? 1. : r;
+			p += sprintf(p, "%s[%f, %f, %f]", i ? ", " : "", s * rr * cos(phi), s * rr * sin(phi), s * z);
+		}
+		p += sprintf(p, pass == 0 ? "], \"modelPoints\": [" : "]}}");
+	}
+	return cfg;
+}
+
+static void feed_object(BenchDriver *driver, size_t idx) {
+	SurviveContext *ctx = driver->ctx;
+	SurviveObject *so = driver->objs[idx];
+
+	survive_get_ingest_lock(ctx, so);
+
+	// The benchmark's lighthouses are set up once before any data flows, so their mode and fcal are read unlocked
+	for (int lh = 0; lh < BENCH_LH_CNT; lh++) {
+		SURVIVE_INVOKE_HOOK_SO(sync, so, ctx->bsd[lh].mode, driver->timecode, false, false);
+
+		SurvivePose world2lh = InvertPoseRtn(&bench_lh_poses[lh]);
+		SurvivePose obj2lh;
+		ApplyPoseToPose(&obj2lh, &world2lh, &driver->obj2world[idx]);
+		for (int sensor = 0; sensor < so->sensor_ct; sensor++) {
+			LinmathPoint3d ptInLh, normalInLh;
+			ApplyPoseToPoint(ptInLh, &obj2lh, so->sensor_locations + sensor * 3);
+			quatrotatevector(normalInLh, obj2lh.Rot, so->sensor_normals + sensor * 3);
+			if (ptInLh[2] >= 0 || dot3d(normalInLh, ptInLh) >= 0)
+				continue;
+
+			SurviveAngleReading ang;
+			survive_reproject_xy_gen2(ctx->bsd[lh].fcal, ptInLh, ang);
+			for (int plane = 0; plane < 2; plane++) {
+				SURVIVE_INVOKE_HOOK_SO(sweep_angle, so, ctx->bsd[lh].mode, sensor, driver->timecode + 1000 + sensor,
+									   plane, ang[plane]);
+			}
+		}
+	}
+
+	survive_release_ingest_lock(ctx, so);
+}
+
+static void *bench_thread(void *_driver) {
+	BenchDriver *driver = _driver;
+	while (driver->keepRunning == 0 || *driver->keepRunning) {
+		for (size_t i = 0; i < driver->obj_cnt; i++) {
+			feed_object(driver, i);
+		}
+		driver->timecode += 48000000 / 50;
+	}
+	return 0;
+}
+
+static int bench_close(SurviveContext *ctx, void *_driver) {
+	free(_driver);
+	return 0;
+}
+
+int DriverRegPoseBench(SurviveContext *ctx) {
+	BenchDriver *driver = SV_CALLOC(sizeof(BenchDriver));
+	driver->ctx = ctx;
+	driver->obj_cnt = survive_configi(ctx, POSEBENCH_OBJECTS_TAG, SC_GET, 1);
+	if (driver->obj_cnt > BENCH_MAX_OBJECTS)
+		driver->obj_cnt = BENCH_MAX_OBJECTS;
+
+	for (int lh = 0; lh < BENCH_LH_CNT; lh++) {
+		ctx->bsd[lh].mode = lh;
+		ctx->bsd[lh].BaseStationID = lh + 1;
+		ctx->bsd[lh].OOTXSet = ctx->bsd[lh].OOTXChecked = true;
+		memset(ctx->bsd[lh].fcal, 0, sizeof(ctx->bsd[lh].fcal));
+		ctx->bsd_map[lh] = lh;
+		SURVIVE_INVOKE_HOOK(raw_lighthouse_pose, ctx, lh, &bench_lh_poses[lh]);
+	}
+	ctx->activeLighthouses = BENCH_LH_CNT;
+	ctx->lh_version = ctx->lh_version_configed = 1;
+
+	char *cfg = generate_object_config(.05);
+	for (size_t i = 0; i < driver->obj_cnt; i++) {
+		char name[4];
+		snprintf(name, sizeof(name), "T%02d", (int)i);
+		SurviveObject *so = survive_create_device(ctx, "BEN", driver, name, 0);
+		SURVIVE_INVOKE_HOOK_SO(config, so, cfg, strlen(cfg));
+
+		FLT ang = 2 * LINMATHPI * i / (FLT)driver->obj_cnt;
+		driver->obj2world[i] = (SurvivePose){.Pos = {.3 * cos(ang), .3 * sin(ang), 1}};
+		FLT euler[3] = {0, 0, ang};
+		quatfromeuler(driver->obj2world[i].Rot, euler);
+
+		driver->objs[i] = so;
+		survive_add_object(ctx, so);
+	}
+	free(cfg);
+
+	driver->keepRunning = survive_add_threaded_driver(ctx, driver, "pose bench", bench_thread, bench_close);
+	return 0;
+}
+REGISTER_LINKTIME(DriverRegPoseBench)
+
+static double run(int trackers, bool sharded, double seconds, int argc, char **argv) {
+	char trackers_str[16];
+	snprintf(trackers_str, sizeof(trackers_str), "%d", trackers);
+
+	char *args[64] = {argv[0],
+					  "--posebench",
+					  "--posebench-objects",
+					  trackers_str,
+					  "--poser",
+					  "BenchCount",
+					  "--threaded-posers",
+					  sharded ? "--sharded-pipeline" : "--no-sharded-pipeline",
+					  "--configfile",
+					  "survive-bench-pose-throughput.json",
+					  "--v",
+					  "0"};
+	int args_cnt = 12;
+	for (int i = 0; i < argc && args_cnt < 63; i++)
+		args[args_cnt++] = argv[i];
+
+	memset(solve_counts, 0, sizeof(solve_counts));
+	SurviveContext *ctx = survive_init(args_cnt, args);
+	if (ctx == 0)
+		return -1;
+
+	const char *inner_name = survive_configs(ctx, POSEBENCH_POSER_TAG, SC_GET, "PoserMPFIT");
+	inner_poser = (PoserCB)GetDriver(inner_name);
+	if (inner_poser == 0) {
+		fprintf(stderr, "Could not find poser '%s'\n", inner_name);
+		survive_close(ctx);
+		return -1;
+	}
+
+	survive_startup(ctx);
+
+	double start = OGRelativeTime();
+	while (OGRelativeTime() - start < seconds && survive_poll(ctx) == 0) {
+	}
+	double elapsed = OGRelativeTime() - start;
+
+	uint32_t total = 0;
+	for (int i = 0; i < trackers; i++)
+		total += solve_counts[i];
+
+	survive_close(ctx);
+	return total / elapsed;
+}
+
+int main(int argc, char **argv) {
+	int max_trackers = argc > 1 ? atoi(argv[1]) : 8;
+	double seconds = argc > 2 ? atof(argv[2]) : 5.;
+	if (max_trackers < 1 || max_trackers > BENCH_MAX_OBJECTS || seconds <= 0) {
+		fprintf(stderr, "Usage: %s [max-trackers=8 (1-%d)] [seconds-per-run=5] [libsurvive args...]\n", argv[0],
+				BENCH_MAX_OBJECTS);
+		return -1;
+	}
+
+	printf("%8s %14s %14s %8s\n", "trackers", "global poses/s", "sharded poses/s", "speedup");
+	for (int trackers = 1; trackers <= max_trackers; trackers *= 2) {
+		double global = run(trackers, false, seconds, argc > 3 ? argc - 3 : 0, argv + 3);
+		double sharded = run(trackers, true, seconds, argc > 3 ? argc - 3 : 0, argv + 3);
+		printf("%8d %14.1f %14.1f %7.2fx\n", trackers, global, sharded, sharded / (global + 1e-10));
+		fflush(stdout);
+	}
+	return 0;
+}
@@ -0,0 +1,175 @@
+// Replays recorded sessions as fast as possible and reports throughput and per stage latency as JSON, so runs can be
+// compared release over release.
+//
+// Each recording is played back with '--playback-factor 0' and '--profile-stages' in its own context. Events are the
+// light, sync and IMU samples which reach the sensor activations; every stage in survive_profile.h gets its count,
+// p50, p99 and max. Peak RSS is for the whole process, so with several recordings it is the high water mark so far.
+//
+// Filter stability is summed over every object's tracker: how often tracking was lost and reset, how often the
+// covariance had to be repaired, and how many poses were reported or dropped. kalman-square-root only applies to the
+// plain state model and only changes light updates, so compare
+// '-- --kalman-use-error-space 0 --kalman-square-root 1' against '-- --kalman-use-error-space 0' rather than against
+// the default filter. The tracker still stores P, not its factor, so this measures the light updates only.
+//
+// Usage: survive-bench [-o results.json] <recording.rec.gz|recording.pcap.gz>... [-- extra libsurvive args...]
+
+#include <libsurvive/survive.h>
+#include <libsurvive/survive_profile.h>
+#include <os_generic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <survive_kalman_tracker.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+static long peak_rss_kb() {
+#ifdef _WIN32
+	return -1;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return -1;
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+#endif
+}
+
+static void write_json_string(FILE *f, const char *s) {
+	fputc('"', f);
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			fputc('\\', f);
+		fputc(*s, f);
+	}
+	fputc('"', f);
+}
+
+static int bench_file(FILE *out, const char *separator, const char *filename, int argc, char **argv) {
+	char configPath[FILENAME_MAX] = {0};
+	snprintf(configPath, sizeof(configPath), "%s.json", filename);
+
+	char *args[64] = {"survive-bench",
+					  "--init-configfile",
+					  configPath,
+					  "--configfile",
+					  "survive-bench.json",
+					  "--playback",
+					  (char *)filename,
+					  "--playback-factor",
+					  "0",
+					  "--profile-stages",
+					  "--v",
+					  "0"};
+	int args_cnt = 12;
+	for (int i = 0; i < argc && args_cnt < 63; i++)
+		args[args_cnt++] = argv[i];
+
+	// Start from an empty config each time so nothing solved for a previous recording carries over
+	remove("survive-bench.json");
+	SurviveContext *ctx = survive_init(args_cnt, args);
+	if (ctx == 0) {
+		fprintf(stderr, "Could not open %s\n", filename);
+		return -1;
+	}
+
+	double start = OGRelativeTime();
+	survive_startup(ctx);
+	while (survive_poll(ctx) == 0) {
+	}
+	double elapsed = OGRelativeTime() - start;
+
+	survive_profile_stage_stats stats[survive_profile_stage_count];
+	for (int i = 0; i < survive_profile_stage_count; i++)
+		survive_profile_get_stats(ctx, i, &stats[i]);
+	uint64_t events = stats[survive_profile_stage_sensor_activations].count;
+
+	fprintf(out, "%s    {\n      \"file\": ", separator);
+	write_json_string(out, filename);
+	fprintf(out, ",\n      \"wall_time_s\": %.6f,\n", elapsed);
+	fprintf(out, "      \"events\": %llu,\n", (unsigned long long)events);
+	fprintf(out, "      \"events_per_s\": %.1f,\n", events / (elapsed + 1e-10));
+	fprintf(out, "      \"peak_rss_kb\": %ld,\n", peak_rss_kb());
+
+	// Read before survive_close; printing the tracker stats clears them
+	size_t lost_tracking = 0, covariance_repairs = 0, reported_poses = 0, dropped_poses = 0;
+	for (int i = 0; i < ctx->objs_ct; i++) {
+		const SurviveKalmanTracker *tracker = ctx->objs[i]->tracker;
+		if (tracker == 0)
+			continue;
+		lost_tracking += tracker->stability.lost_tracking;
+		covariance_repairs += tracker->stability.covariance_repairs;
+		reported_poses += tracker->stats.reported_poses;
+		dropped_poses += tracker->stats.dropped_poses;
+	}
+	fprintf(out,
+			"      \"tracking\": {\"lost_tracking\": %zu, \"covariance_repairs\": %zu, \"reported_poses\": %zu, "
+			"\"dropped_poses\": %zu},\n",
+			lost_tracking, covariance_repairs, reported_poses, dropped_poses);
+	fprintf(out, "      \"stages\": {\n");
+	for (int i = 0; i < survive_profile_stage_count; i++) {
+		fprintf(out,
+				"        \"%s\": {\"count\": %llu, \"total_s\": %.6f, \"p50_us\": %.3f, \"p99_us\": %.3f, \"max_us\": "
+				"%.3f}%s\n",
+				survive_profile_stage_name(i), (unsigned long long)stats[i].count, stats[i].total_s,
+				stats[i].p50_s * 1e6, stats[i].p99_s * 1e6, stats[i].max_s * 1e6,
+				i + 1 < survive_profile_stage_count ? "," : "");
+	}
+	fprintf(out, "      }\n    }");
+
+	survive_close(ctx);
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	const char *output = 0;
+	const char *files[256];
+	int file_cnt = 0;
+
+	int i = 1;
+	for (; i < argc; i++) {
+		if (strcmp(argv[i], "--") == 0) {
+			i++;
+			break;
+		}
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			output = argv[++i];
+		} else if (file_cnt < 256) {
+			files[file_cnt++] = argv[i];
+		}
+	}
+
+	if (file_cnt == 0) {
+		fprintf(stderr, "Usage: %s [-o results.json] <recording>... [-- libsurvive args...]\n", argv[0]);
+		return -1;
+	}
+
+	FILE *out = output ? fopen(output, "w") : stdout;
+	if (out == 0) {
+		fprintf(stderr, "Could not open %s for writing\n", output);
+		return -1;
+	}
+
+	int rtn = 0;
+	fprintf(out, "{\n  \"version\": ");
+	write_json_string(out, survive_build_tag());
+	fprintf(out, ",\n  \"runs\": [\n");
+	for (int f = 0, written = 0; f < file_cnt; f++) {
+		if (bench_file(out, written ? ",\n" : "", files[f], argc - i, argv + i) == 0) {
+			written++;
+		} else {
+			rtn = -1;
+		}
+		fflush(out);
+	}
+	fprintf(out, "\n  ]\n}\n");
+
+	if (out != stdout)
+		fclose(out);
+	return rtn;
+}
@@ -0,0 +1,127 @@
+// Compares the per point reprojection functions against the batch versions in survive_reproject.h for both
+// lighthouse models, and reports the largest difference between them.
+//
+// Each pass reprojects the same random set of points in the lighthouse frame, then the same points again from an
+// object pose through survive_reproject_full_xy_batch.
+//
+// Usage: survive-bench-reproject [points=64] [passes=20000]
+
+#include <libsurvive/survive.h>
+#include <math.h>
+#include <os_generic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <survive_reproject.h>
+#include <survive_reproject_gen2.h>
+
+static FLT rand_range(FLT lo, FLT hi) { return lo + (hi - lo) * rand() / (FLT)RAND_MAX; }
+
+typedef void (*reproject_xy_fn)(const BaseStationCal *bcal, LinmathVec3d const ptInLh, SurviveAngleReading out);
+typedef void (*reproject_full_fn)(const BaseStationCal *bcal, const SurvivePose *world2lh,
+								  const SurvivePose *obj2world, const LinmathVec3d obj_pt, SurviveAngleReading out);
+
+typedef struct bench_points {
+	size_t n;
+	FLT *x, *y, *z, *out_x, *out_y, *check_x, *check_y;
+} bench_points;
+
+static void report(const char *name, size_t points, int passes, double scalar_s, double batch_s,
+				   const bench_points *p) {
+	FLT max_err = 0;
+	for (size_t i = 0; i < p->n; i++) {
+		max_err = linmath_max(max_err, fabs(p->out_x[i] - p->check_x[i]));
+		max_err = linmath_max(max_err, fabs(p->out_y[i] - p->check_y[i]));
+	}
+	double cnt = (double)points * passes;
+	printf("%-8s scalar %8.1f ns/pt  batch %8.1f ns/pt  speedup %5.2fx  max error %g\n", name, scalar_s / cnt * 1e9,
+		   batch_s / cnt * 1e9, scalar_s / (batch_s + 1e-12), max_err);
+}
+
+static void bench_xy(const char *name, reproject_xy_fn xy, survive_reproject_xy_batch_fn_t batch,
+					 const BaseStationCal *cal, bench_points *p, int passes) {
+	double start = OGRelativeTime();
+	for (int pass = 0; pass < passes; pass++) {
+		for (size_t i = 0; i < p->n; i++) {
+			SurviveAngleReading ang;
+			xy(cal, (LinmathVec3d){p->x[i], p->y[i], p->z[i]}, ang);
+			p->check_x[i] = ang[0];
+			p->check_y[i] = ang[1];
+		}
+	}
+	double scalar_s = OGRelativeTime() - start;
+
+	start = OGRelativeTime();
+	for (int pass = 0; pass < passes; pass++) {
+		batch(cal, p->n, p->x, p->y, p->z, p->out_x, p->out_y);
+	}
+	report(name, p->n, passes, scalar_s, OGRelativeTime() - start, p);
+}
+
+static void bench_full(const char *name, reproject_full_fn full, const survive_reproject_model_t *model,
+					   const BaseStationCal *cal, bench_points *p, int passes) {
+	SurvivePose lh2world = {.Pos = {1, 2, 3}, .Rot = {.2, .8, .1, .3}};
+	SurvivePose obj2world = {.Pos = {.1, .2, .5}, .Rot = {.9, .1, -.2, .3}};
+	quatnormalize(lh2world.Rot, lh2world.Rot);
+	quatnormalize(obj2world.Rot, obj2world.Rot);
+	SurvivePose world2lh = InvertPoseRtn(&lh2world);
+
+	double start = OGRelativeTime();
+	for (int pass = 0; pass < passes; pass++) {
+		for (size_t i = 0; i < p->n; i++) {
+			SurviveAngleReading ang;
+			full(cal, &world2lh, &obj2world, (LinmathVec3d){p->x[i], p->y[i], p->z[i]}, ang);
+			p->check_x[i] = ang[0];
+			p->check_y[i] = ang[1];
+		}
+	}
+	double scalar_s = OGRelativeTime() - start;
+
+	start = OGRelativeTime();
+	for (int pass = 0; pass < passes; pass++) {
+		survive_reproject_full_xy_batch(model, cal, &world2lh, &obj2world, p->n, p->x, p->y, p->z, p->out_x,
+										p->out_y);
+	}
+	report(name, p->n, passes, scalar_s, OGRelativeTime() - start, p);
+}
+
+int main(int argc, char **argv) {
+	size_t n = argc > 1 ? atoi(argv[1]) : 64;
+	int passes = argc > 2 ? atoi(argv[2]) : 20000;
+
+	bench_points p = {.n = n};
+	FLT **arrays[] = {&p.x, &p.y, &p.z, &p.out_x, &p.out_y, &p.check_x, &p.check_y};
+	for (int i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++)
+		*arrays[i] = calloc(n, sizeof(FLT));
+
+	BaseStationCal cal[2] = {0};
+	for (int axis = 0; axis < 2; axis++) {
+		cal[axis] = (BaseStationCal){.phase = rand_range(-.05, .05),
+									 .tilt = rand_range(-.05, .05),
+									 .curve = rand_range(-.01, .01),
+									 .gibpha = rand_range(-3, 3),
+									 .gibmag = rand_range(-.02, .02),
+									 .ogeephase = rand_range(-3, 3),
+									 .ogeemag = rand_range(-.5, .5)};
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		p.x[i] = rand_range(-2, 2);
+		p.y[i] = rand_range(-2, 2);
+		p.z[i] = rand_range(-5, -.5);
+	}
+	printf("%u points, %d passes\n", (unsigned)n, passes);
+	bench_xy("gen1", survive_reproject_xy, survive_reproject_xy_batch, cal, &p, passes);
+	bench_xy("gen2", survive_reproject_xy_gen2, survive_reproject_xy_batch_gen2, cal, &p, passes);
+
+	// Sensor positions on a tracked object
+	for (size_t i = 0; i < n; i++) {
+		p.x[i] = rand_range(-.1, .1);
+		p.y[i] = rand_range(-.1, .1);
+		p.z[i] = rand_range(-.1, .1);
+	}
+	bench_full("gen2full", survive_reproject_full_gen2, &survive_reproject_gen2_model, cal, &p, passes);
+
+	for (int i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++)
+		free(*arrays[i]);
+	return 0;
+}
@@ -0,0 +1,70 @@
+// Measures gen2 light processing from sync / sweep hooks down to the tracker, with the angles of each sync period
+// handed on in batches (the default; at most light-batch-size each) and one at a time. The per angle run installs a
+// sweep_angle hook that just calls the default one, which sends the batch back down the one-call-per-angle path.
+//
+// Usage: survive-bench-sweep-angle-batch [periods=20000] [sensors=32]
+
+#include <os_generic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <survive_default_devices.h>
+#include <survive_internal.h>
+
+// Channel 2 lighthouses spin at 50.3673hz
+#define PERIOD_TICKS 953000u
+#define CHANNEL 2
+
+static void forward_sweep_angle(SurviveObject *so, survive_channel channel, int sensor_id, survive_timecode timecode,
+								int8_t plane, FLT angle) {
+	survive_default_sweep_angle_process(so, channel, sensor_id, timecode, plane, angle);
+}
+
+static double run(int periods, int sensors, bool batched, uint32_t *accepted) {
+	char *args[] = {"survive-bench-sweep-angle-batch", "--v", "0", "--configfile",
+					"survive-bench-sweep-angle-batch.json"};
+	SurviveContext *ctx = survive_init(sizeof(args) / sizeof(args[0]), args);
+	if (ctx == 0)
+		exit(-1);
+
+	ctx->lh_version = 1;
+	SurviveObject *so = survive_create_device(ctx, "BEN", 0, "BN0", 0);
+	so->sensor_ct = sensors;
+	survive_add_object(ctx, so);
+	if (!batched)
+		survive_install_sweep_angle_fn(ctx, forward_sweep_angle);
+
+	srand(1);
+	double start = OGRelativeTime();
+	for (int period = 0; period < periods; period++) {
+		survive_timecode sync = 1000 + (survive_timecode)period * PERIOD_TICKS;
+		SURVIVE_INVOKE_HOOK_SO(sync, so, CHANNEL, sync, false, false);
+		for (int plane = 0; plane < 2; plane++) {
+			for (int sensor = 0; sensor < sensors; sensor++) {
+				survive_timecode hit = (plane ? 600 : 200) * (PERIOD_TICKS / 1000) + sensor * 500 + rand() % 100;
+				SURVIVE_INVOKE_HOOK_SO(sweep, so, CHANNEL, sensor, sync + hit, false);
+			}
+		}
+	}
+	double elapsed = OGRelativeTime() - start;
+
+	*accepted = so->stats.accepted_data[survive_get_bsd_idx(ctx, CHANNEL)];
+	survive_close(ctx);
+	return elapsed;
+}
+
+int main(int argc, char **argv) {
+	int periods = argc > 1 ? atoi(argv[1]) : 20000;
+	int sensors = argc > 2 ? atoi(argv[2]) : 32;
+	if (sensors > 32)
+		sensors = 32;
+
+	uint32_t per_angle_accepted, batched_accepted;
+	double per_angle_s = run(periods, sensors, false, &per_angle_accepted);
+	double batched_s = run(periods, sensors, true, &batched_accepted);
+
+	size_t angles = (size_t)periods * sensors * 2;
+	printf("%9zu angles: per angle %12.0f angles/s  batched %12.0f angles/s  speedup %5.2fx%s\n", angles,
+		   angles / per_angle_s, angles / batched_s, per_angle_s / (batched_s + 1e-12),
+		   per_angle_accepted == batched_accepted ? "" : "  ACCEPTED COUNTS DIFFER");
+	return 0;
+}
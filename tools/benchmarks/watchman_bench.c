@@ -0,0 +1,220 @@
+// Measures survive_watchman_decode over watchman RF packets pulled out of a usbmon capture -- a pcap as recorded by
+// driver_usbmon or by wireshark / tcpdump on a usbmonX interface. Every interrupt IN transfer carrying a watchman
+// report (0x23 or 0x24) contributes its one or two packets. Captures have to be uncompressed.
+//
+// Without a capture it runs on generated packets instead: gen1 light behind input and IMU events for v1 devices, and
+// IMU plus raw1 sync / sweep words for v2 ones.
+//
+// Usage: survive-bench-watchman [capture.pcap [v1|v2|raw1]] [passes=200]
+
+#include <os_generic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <survive_watchman.h>
+
+#define VIVE_REPORT_RF_WATCHMAN 0x23
+#define VIVE_REPORT_RF_WATCHMANx2 0x24
+
+#define DLT_USB_LINUX 189
+#define DLT_USB_LINUX_MMAPPED 220
+
+typedef struct packet_list {
+	uint8_t (*packets)[SURVIVE_WATCHMAN_PACKET_SIZE];
+	size_t cnt, cap;
+} packet_list;
+
+static uint8_t *add_packet(packet_list *list) {
+	if (list->cnt == list->cap) {
+		list->cap = list->cap ? list->cap * 2 : 1024;
+		list->packets = realloc(list->packets, list->cap * SURVIVE_WATCHMAN_PACKET_SIZE);
+	}
+	uint8_t *packet = list->packets[list->cnt++];
+	memset(packet, 0, SURVIVE_WATCHMAN_PACKET_SIZE);
+	return packet;
+}
+
+static uint32_t read_u32(const uint8_t *p, bool swap) {
+	return swap ? ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]
+				: ((uint32_t)p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+}
+
+static bool load_capture(packet_list *list, const char *path) {
+	FILE *f = fopen(path, "rb");
+	if (f == 0) {
+		fprintf(stderr, "Could not open %s\n", path);
+		return false;
+	}
+
+	uint8_t header[24];
+	if (fread(header, sizeof(header), 1, f) != 1) {
+		fclose(f);
+		return false;
+	}
+
+	uint32_t magic = read_u32(header, false);
+	bool swap = magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1;
+	if (!swap && magic != 0xa1b2c3d4 && magic != 0xa1b23c4d) {
+		fprintf(stderr, "%s isn't a pcap file\n", path);
+		fclose(f);
+		return false;
+	}
+
+	uint32_t link_type = read_u32(header + 20, swap);
+	size_t usb_header_size = link_type == DLT_USB_LINUX_MMAPPED ? 64 : link_type == DLT_USB_LINUX ? 48 : 0;
+	if (usb_header_size == 0) {
+		fprintf(stderr, "%s has link type %u; expected a usbmon capture\n", path, link_type);
+		fclose(f);
+		return false;
+	}
+
+	uint8_t record[16], data[65536];
+	while (fread(record, sizeof(record), 1, f) == 1) {
+		uint32_t len = read_u32(record + 8, swap);
+		if (len > sizeof(data) || fread(data, len, 1, f) != 1)
+			break;
+
+		// Completed interrupt IN transfers only; usbmon's own header is in host order
+		if (len <= usb_header_size || data[8] != 'C' || data[9] != 1 || (data[10] & 0x80) == 0)
+			continue;
+
+		const uint8_t *report = data + usb_header_size;
+		size_t report_len = len - usb_header_size;
+		int cnt = report[0] == VIVE_REPORT_RF_WATCHMAN ? 1 : report[0] == VIVE_REPORT_RF_WATCHMANx2 ? 2 : 0;
+		for (int i = 0; i < cnt && 1 + (i + 1) * SURVIVE_WATCHMAN_PACKET_SIZE <= report_len; i++) {
+			memcpy(add_packet(list), report + 1 + i * SURVIVE_WATCHMAN_PACKET_SIZE, SURVIVE_WATCHMAN_PACKET_SIZE);
+		}
+	}
+
+	fclose(f);
+	return true;
+}
+
+static size_t put_delta(uint8_t *deltas, size_t cnt, uint32_t delta) {
+	// Deltas are read back to front, most significant group first; the stop bit marks the last group
+	uint8_t groups[5];
+	int n = 0;
+	do {
+		groups[n++] = delta & 0x7f;
+		delta >>= 7;
+	} while (delta);
+	for (int k = n - 1; k >= 0; k--)
+		deltas[cnt++] = groups[k] | (k == 0 ? 0x80 : 0);
+	return cnt;
+}
+
+// Gen1 pulses one after another, latest first, in the watchman light format
+static size_t put_light(uint8_t *out, uint32_t end_time, int pulses) {
+	uint8_t deltas[32];
+	size_t delta_cnt = 0, cnt = 0;
+	for (int p = 0; p < pulses; p++) {
+		out[cnt++] = (rand() % 24) << 3;
+		if (p > 0)
+			delta_cnt = put_delta(deltas, delta_cnt, 200 + rand() % 20000);
+		delta_cnt = put_delta(deltas, delta_cnt, 100 + rand() % 3000);
+	}
+	for (size_t k = 0; k < delta_cnt; k++)
+		out[cnt + delta_cnt - 1 - k] = deltas[k];
+	cnt += delta_cnt;
+	out[cnt++] = end_time;
+	out[cnt++] = end_time >> 8;
+	out[cnt++] = end_time >> 16;
+	return cnt;
+}
+
+static void put_imu(uint8_t *payload, size_t *cnt) {
+	for (int i = 0; i < 13; i++)
+		payload[(*cnt)++] = rand();
+}
+
+static void generate(packet_list *list, size_t cnt, bool v2) {
+	uint32_t now = 0x01000000;
+	for (size_t i = 0; i < cnt; i++) {
+		uint8_t payload[26];
+		size_t n = 0;
+		now += 20000 + rand() % 20000;
+
+		if (v2) {
+			payload[n++] = 0x90;
+			put_imu(payload, &n);
+			payload[n++] = ((rand() % 16) << 4) | 1;
+			for (int w = rand() % 2; w >= 0; w--) {
+				uint32_t word = (rand() % 32u) << 27 | ((now + rand() % 1000) & 0xFFFFFF) << 3 | 0x2;
+				memcpy(payload + n, &word, 4);
+				n += 4;
+			}
+		} else {
+			if (rand() % 4 == 0) {
+				payload[n++] = 0xF9;
+				payload[n++] = rand();
+				put_imu(payload, &n);
+			}
+			n += put_light(payload + n, now, n ? 1 : 1 + rand() % 3);
+		}
+
+		uint8_t *packet = add_packet(list);
+		packet[0] = now >> 24;
+		packet[1] = n + 1;
+		packet[2] = now >> 16;
+		memcpy(packet + 3, payload, n);
+	}
+}
+
+int main(int argc, char **argv) {
+	packet_list list = {0};
+	survive_watchman_decode_params params = {0};
+	int passes = 200;
+
+	bool capture = argc > 1 && atoi(argv[1]) == 0;
+	if (capture) {
+		if (!load_capture(&list, argv[1]))
+			return -1;
+		const char *format = argc > 2 ? argv[2] : "v1";
+		params.v2 = strcmp(format, "v1") != 0;
+		params.raw1 = strcmp(format, "raw1") == 0;
+		if (argc > 3)
+			passes = atoi(argv[3]);
+	} else {
+		if (argc > 1)
+			passes = atoi(argv[1]);
+		generate(&list, 25000, false);
+	}
+
+	if (list.cnt == 0) {
+		fprintf(stderr, "No watchman packets found\n");
+		return -1;
+	}
+
+	for (int run = 0; run < 2; run++) {
+		size_t events = 0, statuses[SURVIVE_WATCHMAN_ERROR_NO_CHANNEL + 1] = {0};
+		survive_watchman_packet decoded;
+
+		double start = OGRelativeTime();
+		for (int pass = 0; pass < passes; pass++) {
+			for (size_t i = 0; i < list.cnt; i++) {
+				survive_watchman_decode(&params, list.packets[i], SURVIVE_WATCHMAN_PACKET_SIZE, &decoded);
+				events += decoded.event_cnt;
+				statuses[decoded.status]++;
+				// The reference would normally follow the device's IMU
+				if (decoded.event_cnt && decoded.events[0].type == SURVIVE_WATCHMAN_EVENT_IMU)
+					params.reference_time = decoded.events[0].imu.timecode;
+			}
+		}
+		double elapsed = OGRelativeTime() - start;
+
+		size_t decoded_cnt = list.cnt * passes;
+		printf("%-4s %8zu packets x %d: %12.0f packets/s %12.0f events/s  %.2f events/packet  %zu errors\n",
+			   params.raw1 ? "raw1" : params.v2 ? "v2" : "v1", list.cnt, passes, decoded_cnt / elapsed,
+			   events / elapsed, events / (double)decoded_cnt, decoded_cnt - statuses[SURVIVE_WATCHMAN_OK]);
+
+		// Generated corpora cover both protocols
+		if (capture)
+			break;
+		list.cnt = 0;
+		generate(&list, 25000, true);
+		params = (survive_watchman_decode_params){.v2 = true, .raw1 = true};
+	}
+
+	free(list.packets);
+	return 0;
+}
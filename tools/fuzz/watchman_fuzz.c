@@ -0,0 +1,51 @@
+// libFuzzer target for survive_watchman_decode. The first input byte picks the protocol, the next four are the
+// reference time, and whatever is left is the packet. Decoding must never read or write out of bounds -- the sanitizers
+// catch that -- and whatever it reports has to be consistent with the buffer it was given.
+//
+// Build with -DENABLE_FUZZERS=ON using clang, then: survive-fuzz-watchman [corpus_dir]
+
+#include <stdlib.h>
+#include <string.h>
+#include <survive_watchman.h>
+
+#define CHECK(x)                                                                                                       \
+	do {                                                                                                               \
+		if (!(x))                                                                                                      \
+			abort();                                                                                                   \
+	} while (0)
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	if (size < 5)
+		return 0;
+
+	survive_watchman_decode_params params = {.v2 = data[0] & 1, .raw1 = data[0] & 2};
+	memcpy(&params.reference_time, data + 1, sizeof(params.reference_time));
+	data += 5;
+	size -= 5;
+
+	// Copy out so reads past the packet land outside the allocation, where ASan sees them
+	uint8_t *packet = malloc(size ? size : 1);
+	memcpy(packet, data, size);
+
+	survive_watchman_packet decoded;
+	bool ok = survive_watchman_decode(&params, packet, size, &decoded);
+
+	CHECK(ok == (decoded.status == SURVIVE_WATCHMAN_OK));
+	CHECK(decoded.status <= SURVIVE_WATCHMAN_ERROR_NO_CHANNEL);
+	CHECK(decoded.event_cnt <= SURVIVE_WATCHMAN_MAX_EVENTS);
+
+	CHECK(decoded.payload <= decoded.payload_end && decoded.payload_end <= packet + size);
+	CHECK(decoded.read_end >= decoded.payload && decoded.read_end <= decoded.payload_end);
+	CHECK(decoded.light == 0 || (decoded.light >= decoded.payload && decoded.light <= decoded.payload_end));
+
+	for (size_t i = 0; i < decoded.event_cnt; i++) {
+		const survive_watchman_event *event = &decoded.events[i];
+		CHECK(event->type <= SURVIVE_WATCHMAN_EVENT_BATTERY);
+		// Light is always last
+		if (i + 1 < decoded.event_cnt && event->type == SURVIVE_WATCHMAN_EVENT_LIGHTCAP)
+			CHECK(decoded.events[i + 1].type == SURVIVE_WATCHMAN_EVENT_LIGHTCAP);
+	}
+
+	free(packet);
+	return 0;
+}
@@ -0,0 +1,50 @@
+// Follows the objects a libsurvive process publishes with '--shm-publish <name>', without linking libsurvive.
+//
+// Usage: survive-shm-reader [name=libsurvive] [period_ms=100]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <survive_shm.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define sleep_ms(ms) Sleep(ms)
+#else
+#include <unistd.h>
+#define sleep_ms(ms) usleep((ms)*1000)
+#endif
+
+int main(int argc, char **argv) {
+	const char *name = argc > 1 ? argv[1] : SURVIVE_SHM_DEFAULT_NAME;
+	int period_ms = argc > 2 ? atoi(argv[2]) : 100;
+
+	SurviveShmReader reader;
+	if (!survive_shm_reader_open(&reader, name)) {
+		fprintf(stderr, "No compatible libsurvive region named '%s'; is a publisher running with --shm-publish %s?\n",
+				name, name);
+		return -1;
+	}
+
+	uint64_t seen[SURVIVE_SHM_MAX_OBJECTS] = {0};
+	while (survive_shm_publisher_alive(&reader)) {
+		uint32_t cnt = survive_shm_object_count(&reader);
+		for (uint32_t i = 0; i < cnt; i++) {
+			SurviveShmObject obj;
+			if (!survive_shm_read_object(&reader, i, &obj) || obj.update_cnt == seen[i] ||
+				!(obj.flags & SURVIVE_SHM_OBJECT_HAS_POSE)) {
+				continue;
+			}
+			seen[i] = obj.update_cnt;
+
+			printf("%10.6f %s %10.6f %10.6f %10.6f %10.6f %10.6f %10.6f %10.6f buttons %08x\n", obj.runtime,
+				   obj.codename, obj.pose[0], obj.pose[1], obj.pose[2], obj.pose[3], obj.pose[4], obj.pose[5],
+				   obj.pose[6], obj.buttonmask);
+		}
+		fflush(stdout);
+		sleep_ms(period_ms);
+	}
+
+	fprintf(stderr, "Publisher stopped\n");
+	survive_shm_reader_close(&reader);
+	return 0;
+}